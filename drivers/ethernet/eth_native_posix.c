@@ -38,6 +38,12 @@ LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 
 #define NET_BUF_TIMEOUT K_MSEC(100)
 
+#define RX_BATCH CONFIG_ETH_NATIVE_POSIX_RX_BATCH
+
+/* How long a frame waits for room in the device before it is dropped */
+#define TX_WAIT_MSEC 10
+#define TX_RETRIES 10
+
 #if defined(CONFIG_NET_VLAN)
 #define ETH_HDR_LEN sizeof(struct net_eth_vlan_hdr)
 #else
@@ -51,6 +57,10 @@ struct eth_context {
 	struct net_linkaddr ll_addr;
 	struct net_if *iface;
 	const char *if_name;
+#if !defined(CONFIG_NET_VLAN)
+	/* Packet allocated for the next received frame */
+	struct net_pkt *rx_pkt;
+#endif
 	int dev_fd;
 	bool init_done;
 	bool status;
@@ -173,22 +183,69 @@ static void update_gptp(struct net_if *iface, struct net_pkt *pkt,
 #define update_gptp(iface, pkt, send)
 #endif /* CONFIG_NET_GPTP */
 
+/* The device is non-blocking for the RX thread. When it is full, wait for
+ * the host to take the queued frames instead of dropping this one.
+ */
+static ssize_t eth_write_frame(int fd, const struct eth_iovec *iov,
+			       int iovcnt)
+{
+	ssize_t ret;
+	int i;
+
+	for (i = 0; i < TX_RETRIES; i++) {
+		ret = eth_write_datav(fd, iov, iovcnt);
+		if (ret != -EAGAIN) {
+			return ret;
+		}
+
+		if (eth_wait_writable(fd, TX_WAIT_MSEC) < 0) {
+			break;
+		}
+	}
+
+	return -EAGAIN;
+}
+
 static int eth_send(struct device *dev, struct net_pkt *pkt)
 {
 	struct eth_context *ctx = dev->driver_data;
+	struct eth_iovec iov[ETH_NATIVE_POSIX_IOV_MAX];
 	int count = net_pkt_get_len(pkt);
+	struct net_buf *buf;
+	int iovcnt = 0;
 	int ret;
 
-	ret = net_pkt_read(pkt, ctx->send, count);
-	if (ret) {
-		return ret;
-	}
-
 	update_gptp(net_pkt_iface(pkt), pkt, true);
 
 	LOG_DBG("Send pkt %p len %d", pkt, count);
 
-	ret = eth_write_data(ctx->dev_fd, ctx->send, count);
+	/* The frame is written from the network buffers directly, unless
+	 * it has too many of them.
+	 */
+	for (buf = pkt->buffer; buf; buf = buf->frags) {
+		if (iovcnt == ARRAY_SIZE(iov)) {
+			break;
+		}
+
+		iov[iovcnt].base = buf->data;
+		iov[iovcnt].len = buf->len;
+		iovcnt++;
+	}
+
+	if (buf) {
+		net_pkt_cursor_init(pkt);
+
+		ret = net_pkt_read(pkt, ctx->send, count);
+		if (ret) {
+			return ret;
+		}
+
+		iov[0].base = ctx->send;
+		iov[0].len = count;
+		iovcnt = 1;
+	}
+
+	ret = eth_write_frame(ctx->dev_fd, iov, iovcnt);
 	if (ret < 0) {
 		LOG_DBG("Cannot send pkt %p (%d)", pkt, ret);
 	}
@@ -287,7 +344,6 @@ error:
 	*status = -ENOBUFS;
 	return NULL;
 }
-#endif
 
 static struct net_pkt *prepare_non_vlan_pkt(struct eth_context *ctx,
 					    int count, int *status)
@@ -313,6 +369,78 @@ static struct net_pkt *prepare_non_vlan_pkt(struct eth_context *ctx,
 
 	return pkt;
 }
+#else
+/* Read the frame directly into the network buffers of a packet, which
+ * avoids going through the receive buffer of the context.
+ */
+static struct net_pkt *read_pkt(struct eth_context *ctx, int fd,
+				int *status)
+{
+	struct eth_iovec iov[ETH_NATIVE_POSIX_IOV_MAX];
+	struct net_pkt *pkt = ctx->rx_pkt;
+	struct net_buf *buf;
+	int iovcnt = 0;
+	ssize_t count;
+	size_t left, len;
+
+	if (!pkt) {
+		pkt = net_pkt_rx_alloc_with_buffer(ctx->iface,
+						   sizeof(ctx->recv),
+						   AF_UNSPEC, 0,
+						   NET_BUF_TIMEOUT);
+		if (!pkt) {
+			*status = -ENOMEM;
+			return NULL;
+		}
+
+		ctx->rx_pkt = pkt;
+	}
+
+	for (buf = pkt->buffer; buf && iovcnt < ARRAY_SIZE(iov);
+	     buf = buf->frags) {
+		iov[iovcnt].base = net_buf_tail(buf);
+		iov[iovcnt].len = net_buf_tailroom(buf);
+		iovcnt++;
+	}
+
+	count = eth_read_datav(fd, iov, iovcnt);
+	if (count <= 0) {
+		/* The packet is kept for the next frame */
+		*status = count < 0 ? count : -EAGAIN;
+		return NULL;
+	}
+
+	ctx->rx_pkt = NULL;
+
+	/* Set the length of the buffers that got data and give back the
+	 * ones that did not.
+	 */
+	left = count;
+
+	for (buf = pkt->buffer; buf; buf = buf->frags) {
+		len = MIN(left, net_buf_tailroom(buf));
+		net_buf_add(buf, len);
+		left -= len;
+
+		if (!left) {
+			if (buf->frags) {
+				net_buf_unref(buf->frags);
+				buf->frags = NULL;
+			}
+
+			break;
+		}
+	}
+
+	net_pkt_cursor_init(pkt);
+
+	*status = 0;
+
+	LOG_DBG("Recv pkt %p len %zd", pkt, count);
+
+	return pkt;
+}
+#endif /* CONFIG_NET_VLAN */
 
 static int read_data(struct eth_context *ctx, int fd)
 {
@@ -320,14 +448,15 @@ static int read_data(struct eth_context *ctx, int fd)
 	struct net_if *iface;
 	struct net_pkt *pkt = NULL;
 	int status;
+
+#if defined(CONFIG_NET_VLAN)
 	int count;
 
 	count = eth_read_data(fd, ctx->recv, sizeof(ctx->recv));
 	if (count <= 0) {
-		return 0;
+		return -EAGAIN;
 	}
 
-#if defined(CONFIG_NET_VLAN)
 	{
 		struct net_eth_hdr *hdr = (struct net_eth_hdr *)(ctx->recv);
 
@@ -346,11 +475,9 @@ static int read_data(struct eth_context *ctx, int fd)
 		}
 	}
 #else
-	{
-		pkt = prepare_non_vlan_pkt(ctx, count, &status);
-		if (!pkt) {
-			return status;
-		}
+	pkt = read_pkt(ctx, fd, &status);
+	if (!pkt) {
+		return status;
 	}
 #endif
 
@@ -367,12 +494,22 @@ static int read_data(struct eth_context *ctx, int fd)
 
 static void eth_rx(struct eth_context *ctx)
 {
+	int i;
+
 	LOG_DBG("Starting ZETH RX thread");
 
 	while (1) {
 		if (net_if_is_up(ctx->iface)) {
 			while (!eth_wait_data(ctx->dev_fd)) {
-				read_data(ctx, ctx->dev_fd);
+				/* Drain a burst of frames before letting the
+				 * other threads run.
+				 */
+				for (i = 0; i < RX_BATCH; i++) {
+					if (read_data(ctx, ctx->dev_fd) < 0) {
+						break;
+					}
+				}
+
 				k_yield();
 			}
 		}
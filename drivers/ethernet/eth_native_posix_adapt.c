@@ -20,9 +20,11 @@
 #include <stdbool.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/uio.h>
 #include <net/if.h>
 #include <time.h>
 #include <arch/posix/posix_trace.h>
@@ -77,6 +79,13 @@ int eth_iface_create(const char *if_name, bool tun_only)
 	}
 #endif
 
+	/* The RX thread drains the device until there is nothing left */
+	if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+		ret = -errno;
+		close(fd);
+		return ret;
+	}
+
 	return fd;
 }
 
@@ -165,14 +174,86 @@ int eth_wait_data(int fd)
 	return -EAGAIN;
 }
 
+/* The device is drained by the host kernel, so the wait does not depend
+ * on Zephyr threads running.
+ */
+int eth_wait_writable(int fd, int timeout_ms)
+{
+	struct pollfd pfd = {
+		.fd = fd,
+		.events = POLLOUT,
+	};
+	int ret;
+
+	ret = poll(&pfd, 1, timeout_ms);
+	if (ret < 0 && errno != EINTR) {
+		return -errno;
+	} else if (ret > 0 && (pfd.revents & POLLOUT)) {
+		return 0;
+	}
+
+	return -EAGAIN;
+}
+
 ssize_t eth_read_data(int fd, void *buf, size_t buf_len)
 {
 	return read(fd, buf, buf_len);
 }
 
-ssize_t eth_write_data(int fd, void *buf, size_t buf_len)
+static int to_host_iov(struct iovec *host_iov, const struct eth_iovec *iov,
+		       int iovcnt)
+{
+	int i;
+
+	if (iovcnt > ETH_NATIVE_POSIX_IOV_MAX) {
+		return -EMSGSIZE;
+	}
+
+	for (i = 0; i < iovcnt; i++) {
+		host_iov[i].iov_base = iov[i].base;
+		host_iov[i].iov_len = iov[i].len;
+	}
+
+	return 0;
+}
+
+/* A TUN/TAP device reads or writes one whole frame per call, the vector
+ * only lets the frame go directly to or from the network buffers.
+ */
+ssize_t eth_read_datav(int fd, const struct eth_iovec *iov, int iovcnt)
+{
+	struct iovec host_iov[ETH_NATIVE_POSIX_IOV_MAX];
+	ssize_t ret;
+
+	ret = to_host_iov(host_iov, iov, iovcnt);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = readv(fd, host_iov, iovcnt);
+	if (ret < 0) {
+		return -errno;
+	}
+
+	return ret;
+}
+
+ssize_t eth_write_datav(int fd, const struct eth_iovec *iov, int iovcnt)
 {
-	return write(fd, buf, buf_len);
+	struct iovec host_iov[ETH_NATIVE_POSIX_IOV_MAX];
+	ssize_t ret;
+
+	ret = to_host_iov(host_iov, iov, iovcnt);
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = writev(fd, host_iov, iovcnt);
+	if (ret < 0) {
+		return -errno;
+	}
+
+	return ret;
 }
 
 #if defined(CONFIG_NET_GPTP)
@@ -25,13 +25,28 @@
 #define ETH_NATIVE_POSIX_STARTUP_SCRIPT_USER ""
 #endif
 
+/* Max number of pieces of a frame read or written in one go. A full frame
+ * fits in this many network buffers of the smallest size.
+ */
+#define ETH_NATIVE_POSIX_IOV_MAX 32
+
+/* Piece of a frame, the host and Zephyr struct iovec cannot be both used
+ * in the same file.
+ */
+struct eth_iovec {
+	void *base;
+	size_t len;
+};
+
 int eth_iface_create(const char *if_name, bool tun_only);
 int eth_iface_remove(int fd);
 int eth_setup_host(const char *if_name);
 int eth_start_script(const char *if_name);
 int eth_wait_data(int fd);
+int eth_wait_writable(int fd, int timeout_ms);
 ssize_t eth_read_data(int fd, void *buf, size_t buf_len);
-ssize_t eth_write_data(int fd, void *buf, size_t buf_len);
+ssize_t eth_read_datav(int fd, const struct eth_iovec *iov, int iovcnt);
+ssize_t eth_write_datav(int fd, const struct eth_iovec *iov, int iovcnt);
 int eth_if_up(const char *if_name);
 int eth_if_down(const char *if_name);
 
@@ -7,8 +7,8 @@
 /**
  * @file
  *
- * PPP driver using uart_pipe. This is meant for network connectivity between
- * two network end points.
+ * PPP driver using uart_pipe, or the UART async API for reception. This is
+ * meant for network connectivity between two network end points.
  */
 
 #define LOG_LEVEL CONFIG_NET_PPP_LOG_LEVEL
@@ -28,13 +28,19 @@ LOG_MODULE_REGISTER(net_ppp, LOG_LEVEL);
 #include <net/net_if.h>
 #include <net/net_core.h>
 #include <drivers/console/uart_pipe.h>
-#include <sys/crc.h>
+#include <drivers/uart.h>
 
 #include "../../subsys/net/ip/net_stats.h"
 #include "../../subsys/net/ip/net_private.h"
+#include "ppp_hdlc.h"
 
 #define UART_BUF_LEN CONFIG_NET_PPP_UART_PIPE_BUF_LEN
 
+#if defined(CONFIG_NET_PPP_ASYNC_UART)
+/* Idle time after which the received data is handed over, in ms */
+#define UART_RX_TIMEOUT 1
+#endif
+
 enum ppp_driver_state {
 	STATE_HDLC_FRAME_START,
 	STATE_HDLC_FRAME_ADDRESS,
@@ -50,9 +56,20 @@ struct ppp_driver_context {
 	/* How much free space we have in the net_pkt */
 	size_t available;
 
+	/* FCS of the data saved in the net_pkt */
+	u16_t fcs;
+
 	/* ppp data is read into this buf */
 	u8_t buf[UART_BUF_LEN];
 
+#if defined(CONFIG_NET_PPP_ASYNC_UART)
+	struct device *dev;
+
+	/* The UART driver fills one buffer while the other one is decoded */
+	u8_t rx_buf[2][UART_BUF_LEN];
+	u8_t rx_next;
+#endif
+
 	/* ppp buf use when sending data */
 	u8_t send_buf[UART_BUF_LEN];
 
@@ -76,8 +93,10 @@ struct ppp_driver_context {
 
 static struct ppp_driver_context ppp_driver_context_data;
 
-static int ppp_save_byte(struct ppp_driver_context *ppp, u8_t byte)
+static int ppp_save_data(struct ppp_driver_context *ppp, const u8_t *data,
+			 size_t len)
 {
+	size_t n;
 	int ret;
 
 	if (!ppp->pkt) {
@@ -93,39 +112,49 @@ static int ppp_save_byte(struct ppp_driver_context *ppp, u8_t byte)
 		net_pkt_cursor_init(ppp->pkt);
 
 		ppp->available = net_pkt_available_buffer(ppp->pkt);
+		ppp->fcs = PPP_HDLC_FCS_INIT;
 	}
 
 	/* Extra debugging can be enabled separately if really
 	 * needed. Normally it would just print too much data.
 	 */
 	if (0) {
-		LOG_DBG("Saving byte %02x", byte);
+		LOG_HEXDUMP_DBG(data, len, "Saving data");
 	}
 
-	/* This is not very intuitive but we must allocate new buffer
-	 * before we write a byte to last available cursor position.
-	 */
-	if (ppp->available == 1) {
-		ret = net_pkt_alloc_buffer(ppp->pkt,
-					   CONFIG_NET_BUF_DATA_SIZE,
-					   AF_UNSPEC, K_NO_WAIT);
-		if (ret < 0) {
-			LOG_ERR("[%p] cannot allocate new data buffer", ppp);
-			goto out_of_mem;
+	if (IS_ENABLED(CONFIG_NET_PPP_VERIFY_FCS)) {
+		ppp->fcs = ppp_hdlc_fcs(ppp->fcs, data, len);
+	}
+
+	while (len > 0) {
+		/* This is not very intuitive but we must allocate new buffer
+		 * before we write a byte to last available cursor position.
+		 */
+		if (ppp->available <= 1) {
+			ret = net_pkt_alloc_buffer(ppp->pkt,
+						   CONFIG_NET_BUF_DATA_SIZE,
+						   AF_UNSPEC, K_NO_WAIT);
+			if (ret < 0) {
+				LOG_ERR("[%p] cannot allocate new data buffer",
+					ppp);
+				goto out_of_mem;
+			}
+
+			ppp->available = net_pkt_available_buffer(ppp->pkt);
 		}
 
-		ppp->available = net_pkt_available_buffer(ppp->pkt);
-	}
+		n = MIN(len, ppp->available - 1);
 
-	if (ppp->available) {
-		ret = net_pkt_write_u8(ppp->pkt, byte);
+		ret = net_pkt_write(ppp->pkt, data, n);
 		if (ret < 0) {
 			LOG_ERR("[%p] Cannot write to pkt %p (%d)",
 				ppp, ppp->pkt, ret);
 			goto out_of_mem;
 		}
 
-		ppp->available--;
+		ppp->available -= n;
+		data += n;
+		len -= n;
 	}
 
 	return 0;
@@ -136,6 +165,11 @@ out_of_mem:
 	return -ENOMEM;
 }
 
+static inline int ppp_save_byte(struct ppp_driver_context *ppp, u8_t byte)
+{
+	return ppp_save_data(ppp, &byte, 1);
+}
+
 static const char *ppp_driver_state_str(enum ppp_driver_state state)
 {
 #if (CONFIG_NET_PPP_LOG_LEVEL >= LOG_LEVEL_DBG)
@@ -175,10 +209,21 @@ static void ppp_change_state(struct ppp_driver_context *ctx,
 
 static int ppp_send_flush(struct ppp_driver_context *ppp, int off)
 {
-	if (!IS_ENABLED(CONFIG_NET_TEST)) {
-		uart_pipe_send(ppp->send_buf, off);
+	if (IS_ENABLED(CONFIG_NET_TEST)) {
+		return 0;
 	}
 
+#if defined(CONFIG_NET_PPP_ASYNC_UART)
+	/* Only the reception uses the async API, as with uart_pipe the
+	 * frames are sent by polling.
+	 */
+	for (int i = 0; i < off; i++) {
+		uart_poll_out(ppp->dev, ppp->send_buf[i]);
+	}
+#else
+	uart_pipe_send(ppp->send_buf, off);
+#endif
+
 	return 0;
 }
 
@@ -198,6 +243,28 @@ static int ppp_send_bytes(struct ppp_driver_context *ppp,
 	return off;
 }
 
+static int ppp_send_escaped(struct ppp_driver_context *ppp,
+			    const u8_t *data, size_t len, int off)
+{
+	size_t consumed;
+
+	while (len > 0) {
+		off += ppp_hdlc_escape(data, len, &ppp->send_buf[off],
+				       sizeof(ppp->send_buf) - off, &consumed);
+		data += consumed;
+		len -= consumed;
+
+		/* Flush also a buffer that is full so that the next
+		 * ppp_send_bytes() has room.
+		 */
+		if (len > 0 || off >= sizeof(ppp->send_buf)) {
+			off = ppp_send_flush(ppp, off);
+		}
+	}
+
+	return off;
+}
+
 #if defined(CONFIG_PPP_CLIENT_CLIENTSERVER)
 
 #define CLIENT "CLIENT"
@@ -285,37 +352,6 @@ static int ppp_input_byte(struct ppp_driver_context *ppp, u8_t byte)
 
 		break;
 
-	case STATE_HDLC_FRAME_DATA:
-		/* If the next frame starts, then send this one
-		 * up in the network stack.
-		 */
-		if (byte == 0x7e) {
-			LOG_DBG("End of pkt (0x%02x)", byte);
-			ppp_change_state(ppp, STATE_HDLC_FRAME_ADDRESS);
-			ret = 0;
-		} else {
-			if (byte == 0x7d) {
-				/* RFC 1662, ch. 4.2 */
-				ppp->next_escaped = true;
-				break;
-			}
-
-			if (ppp->next_escaped) {
-				/* RFC 1662, ch. 4.2 */
-				byte ^= 0x20;
-				ppp->next_escaped = false;
-			}
-
-			ret = ppp_save_byte(ppp, byte);
-			if (ret < 0) {
-				ppp_change_state(ppp, STATE_HDLC_FRAME_START);
-			}
-
-			ret = -EAGAIN;
-		}
-
-		break;
-
 	default:
 		LOG_DBG("[%p] Invalid state %d", ppp, ppp->state);
 		break;
@@ -326,25 +362,9 @@ static int ppp_input_byte(struct ppp_driver_context *ppp, u8_t byte)
 
 static bool ppp_check_fcs(struct ppp_driver_context *ppp)
 {
-	struct net_buf *buf;
-	u16_t crc;
-
-	buf = ppp->pkt->buffer;
-	if (!buf) {
-		return false;
-	}
-
-	crc = crc16_ccitt(0xffff, buf->data, buf->len);
-
-	buf = buf->frags;
-
-	while (buf) {
-		crc = crc16_ccitt(crc, buf->data, buf->len);
-		buf = buf->frags;
-	}
-
-	if (crc != 0xf0b8) {
-		LOG_DBG("Invalid FCS (0x%x)", crc);
+	/* The FCS is computed while the data is saved */
+	if (ppp->fcs != PPP_HDLC_FCS_GOOD) {
+		LOG_DBG("Invalid FCS (0x%x)", ppp->fcs);
 #if defined(CONFIG_NET_STATISTICS_PPP)
 		ppp->stats.chkerr++;
 #endif
@@ -401,40 +421,156 @@ static void ppp_process_msg(struct ppp_driver_context *ppp)
 	ppp->pkt = NULL;
 }
 
-static u8_t *ppp_recv_cb(u8_t *buf, size_t *off)
+static void ppp_frame_end(struct ppp_driver_context *ppp)
 {
-	struct ppp_driver_context *ppp =
-		CONTAINER_OF(buf, struct ppp_driver_context, buf);
-	size_t i, len = *off;
+	if (!ppp->pkt) {
+		return;
+	}
 
-	for (i = 0; i < *off; i++) {
+	/* Ignore empty or too short frames */
+	if (net_pkt_get_len(ppp->pkt) > 3) {
+		ppp_process_msg(ppp);
+	} else {
+		net_pkt_unref(ppp->pkt);
+		ppp->pkt = NULL;
+	}
+}
+
+/* The frame data is decoded in place, in the receive buffer */
+static void ppp_input(struct ppp_driver_context *ppp, u8_t *data, size_t len)
+{
+	size_t i = 0, run, decoded;
+	bool escaped;
+	bool end;
+
+	while (i < len) {
 		if (0) {
 			/* Extra debugging can be enabled separately if really
 			 * needed. Normally it would just print too much data.
 			 */
-			LOG_DBG("[%zd] %02x", i, buf[i]);
+			LOG_DBG("[%zd] %02x", i, data[i]);
 		}
 
-		if (ppp_input_byte(ppp, buf[i]) == 0) {
-			/* Ignore empty or too short frames */
-			if (ppp->pkt && net_pkt_get_len(ppp->pkt) > 3) {
-				ppp_process_msg(ppp);
-				break;
-			}
+		/* Inside a frame the data is decoded and saved a block at
+		 * a time, the flags and the address go through the byte
+		 * state machine.
+		 */
+		if (ppp->state != STATE_HDLC_FRAME_DATA) {
+			(void)ppp_input_byte(ppp, data[i++]);
+			continue;
 		}
-	}
 
-	if (i == *off) {
-		*off = 0;
-	} else {
-		*off = len - i - 1;
+		escaped = ppp->next_escaped;
+		run = ppp_hdlc_unescape(&data[i], len - i, &escaped,
+					&decoded, &end);
+		ppp->next_escaped = escaped;
 
-		memmove(&buf[0], &buf[i + 1], *off);
+		if (decoded > 0 && ppp_save_data(ppp, &data[i], decoded) < 0) {
+			ppp_change_state(ppp, STATE_HDLC_FRAME_START);
+		}
+
+		i += run;
+
+		/* If the next frame starts, then send this one up in the
+		 * network stack.
+		 */
+		if (end) {
+			LOG_DBG("End of pkt");
+			ppp_change_state(ppp, STATE_HDLC_FRAME_ADDRESS);
+			ppp_frame_end(ppp);
+		}
 	}
+}
+
+static u8_t *ppp_recv_cb(u8_t *buf, size_t *off)
+{
+	struct ppp_driver_context *ppp =
+		CONTAINER_OF(buf, struct ppp_driver_context, buf);
+
+	ppp_input(ppp, buf, *off);
+
+	*off = 0;
 
 	return buf;
 }
 
+#if defined(CONFIG_NET_PPP_ASYNC_UART)
+static int ppp_async_rx_enable(struct ppp_driver_context *ppp)
+{
+	ppp->rx_next = 1U;
+
+	return uart_rx_enable(ppp->dev, ppp->rx_buf[0], UART_BUF_LEN,
+			      UART_RX_TIMEOUT);
+}
+
+static void ppp_async_uart_cb(struct uart_event *evt, void *user_data)
+{
+	struct ppp_driver_context *ppp = user_data;
+	int ret;
+
+	switch (evt->type) {
+	case UART_RX_RDY:
+		/* Decoded straight from the buffer of the UART driver */
+		ppp_input(ppp, evt->data.rx.buf + evt->data.rx.offset,
+			  evt->data.rx.len);
+		break;
+
+	case UART_RX_BUF_REQUEST:
+		ret = uart_rx_buf_rsp(ppp->dev, ppp->rx_buf[ppp->rx_next],
+				      UART_BUF_LEN);
+		if (ret < 0) {
+			LOG_ERR("[%p] cannot provide RX buffer (%d)", ppp,
+				ret);
+			break;
+		}
+
+		ppp->rx_next ^= 1U;
+		break;
+
+	case UART_RX_STOPPED:
+		LOG_DBG("[%p] RX stopped (0x%x)", ppp,
+			evt->data.rx_stop.reason);
+		break;
+
+	case UART_RX_DISABLED:
+		/* Stopped by an error, start again */
+		ret = ppp_async_rx_enable(ppp);
+		if (ret < 0) {
+			LOG_ERR("[%p] cannot enable RX (%d)", ppp, ret);
+		}
+
+		break;
+
+	default:
+		break;
+	}
+}
+
+static void ppp_async_uart_init(struct ppp_driver_context *ppp)
+{
+	int ret;
+
+	ppp->dev = device_get_binding(CONFIG_NET_PPP_UART_NAME);
+	if (!ppp->dev) {
+		LOG_ERR("[%p] cannot find UART %s", ppp,
+			CONFIG_NET_PPP_UART_NAME);
+		return;
+	}
+
+	ret = uart_callback_set(ppp->dev, ppp_async_uart_cb, ppp);
+	if (ret < 0) {
+		LOG_ERR("[%p] UART %s has no async API (%d)", ppp,
+			CONFIG_NET_PPP_UART_NAME, ret);
+		return;
+	}
+
+	ret = ppp_async_rx_enable(ppp);
+	if (ret < 0) {
+		LOG_ERR("[%p] cannot enable RX (%d)", ppp, ret);
+	}
+}
+#endif /* CONFIG_NET_PPP_ASYNC_UART */
+
 #if defined(CONFIG_NET_TEST)
 void ppp_driver_feed_data(u8_t *data, int data_len)
 {
@@ -484,15 +620,15 @@ static bool calc_fcs(struct net_pkt *pkt, u16_t *fcs, u16_t protocol)
 	/* HDLC Address and Control fields */
 	c = sys_cpu_to_be16(0xff << 8 | 0x03);
 
-	crc = crc16_ccitt(0xffff, (const u8_t *)&c, sizeof(c));
+	crc = ppp_hdlc_fcs(PPP_HDLC_FCS_INIT, (const u8_t *)&c, sizeof(c));
 
 	if (protocol > 0) {
-		crc = crc16_ccitt(crc, (const u8_t *)&protocol,
-				  sizeof(protocol));
+		crc = ppp_hdlc_fcs(crc, (const u8_t *)&protocol,
+				   sizeof(protocol));
 	}
 
 	while (buf) {
-		crc = crc16_ccitt(crc, buf->data, buf->len);
+		crc = ppp_hdlc_fcs(crc, buf->data, buf->len);
 		buf = buf->frags;
 	}
 
@@ -502,17 +638,6 @@ static bool calc_fcs(struct net_pkt *pkt, u16_t *fcs, u16_t protocol)
 	return true;
 }
 
-static u16_t ppp_escape_byte(u8_t byte, int *offset)
-{
-	if (byte == 0x7e || byte == 0x7d || byte < 0x20) {
-		*offset = 0;
-		return (0x7d << 8) | (byte ^ 0x20);
-	}
-
-	*offset = 1;
-	return byte;
-}
-
 static int ppp_send(struct device *dev, struct net_pkt *pkt)
 {
 	struct ppp_driver_context *ppp = dev->driver_data;
@@ -520,9 +645,8 @@ static int ppp_send(struct device *dev, struct net_pkt *pkt)
 	u16_t protocol = 0;
 	int send_off = 0;
 	u32_t sync_addr_ctrl;
-	u16_t fcs, escaped;
+	u16_t fcs;
 	u8_t byte;
-	int i, offset;
 
 #if defined(CONFIG_NET_TEST)
 	return 0;
@@ -559,15 +683,8 @@ static int ppp_send(struct device *dev, struct net_pkt *pkt)
 				  sizeof(sync_addr_ctrl), send_off);
 
 	if (protocol > 0) {
-		escaped = htons(ppp_escape_byte(protocol, &offset));
-		send_off = ppp_send_bytes(ppp, (u8_t *)&escaped + offset,
-					  offset ? 1 : 2,
-					  send_off);
-
-		escaped = htons(ppp_escape_byte(protocol >> 8, &offset));
-		send_off = ppp_send_bytes(ppp, (u8_t *)&escaped + offset,
-					  offset ? 1 : 2,
-					  send_off);
+		send_off = ppp_send_escaped(ppp, (const u8_t *)&protocol,
+					    sizeof(protocol), send_off);
 	}
 
 	/* Note that we do not print the first four bytes and FCS bytes at the
@@ -579,27 +696,14 @@ static int ppp_send(struct device *dev, struct net_pkt *pkt)
 	}
 
 	while (buf) {
-		for (i = 0; i < buf->len; i++) {
-			/* Escape illegal bytes */
-			escaped = htons(ppp_escape_byte(buf->data[i], &offset));
-			send_off = ppp_send_bytes(ppp,
-						  (u8_t *)&escaped + offset,
-						  offset ? 1 : 2,
-						  send_off);
-		}
-
+		send_off = ppp_send_escaped(ppp, buf->data, buf->len, send_off);
 		buf = buf->frags;
 	}
 
-	escaped = htons(ppp_escape_byte(fcs, &offset));
-	send_off = ppp_send_bytes(ppp, (u8_t *)&escaped + offset,
-				  offset ? 1 : 2,
-				  send_off);
-
-	escaped = htons(ppp_escape_byte(fcs >> 8, &offset));
-	send_off = ppp_send_bytes(ppp, (u8_t *)&escaped + offset,
-				  offset ? 1 : 2,
-				  send_off);
+	/* The FCS is sent least significant byte first, RFC 1662 ch C.2 */
+	fcs = sys_cpu_to_le16(fcs);
+	send_off = ppp_send_escaped(ppp, (const u8_t *)&fcs, sizeof(fcs),
+				    send_off);
 
 	byte = 0x7e;
 	send_off = ppp_send_bytes(ppp, &byte, 1, send_off);
@@ -677,9 +781,15 @@ use_random_mac:
 	/* We do not use uart_pipe for unit tests as the unit test has its
 	 * own handling of UART. See tests/net/ppp/driver for details.
 	 */
-	if (!IS_ENABLED(CONFIG_NET_TEST)) {
-		uart_pipe_register(ppp->buf, sizeof(ppp->buf), ppp_recv_cb);
+	if (IS_ENABLED(CONFIG_NET_TEST)) {
+		return;
 	}
+
+#if defined(CONFIG_NET_PPP_ASYNC_UART)
+	ppp_async_uart_init(ppp);
+#else
+	uart_pipe_register(ppp->buf, sizeof(ppp->buf), ppp_recv_cb);
+#endif
 }
 
 #if defined(CONFIG_NET_STATISTICS_PPP)
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ *
+ * HDLC-like framing of PPP (RFC 1662) on blocks of data. The data is
+ * scanned four bytes at a time for the bytes that need special handling,
+ * and the runs of plain bytes in between are copied as a whole.
+ */
+
+#include <zephyr/types.h>
+#include <string.h>
+#include <sys/util.h>
+
+#include "ppp_hdlc.h"
+
+#define ONES 0x01010101U
+#define HIGHS 0x80808080U
+
+/* FCS lookup table, RFC 1662 ch. C.2 */
+static const u16_t fcs_table[256] = {
+	0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+	0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+	0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
+	0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
+	0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
+	0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
+	0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
+	0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
+	0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
+	0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
+	0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
+	0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
+	0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
+	0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
+	0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
+	0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
+	0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
+	0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
+	0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
+	0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
+	0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
+	0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
+	0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
+	0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
+	0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
+	0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
+	0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
+	0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
+	0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
+	0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
+	0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
+	0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78,
+};
+
+/* Non-zero if a byte of the word is equal to value */
+static inline u32_t has_byte(u32_t word, u8_t value)
+{
+	word ^= ONES * value;
+
+	return (word - ONES) & ~word & HIGHS;
+}
+
+/* Non-zero if a byte of the word is less than value, value <= 128 */
+static inline u32_t has_less(u32_t word, u8_t value)
+{
+	return (word - ONES * value) & ~word & HIGHS;
+}
+
+static inline bool is_special(u8_t byte)
+{
+	return byte == PPP_HDLC_FLAG || byte == PPP_HDLC_ESCAPE;
+}
+
+static inline bool needs_escape(u8_t byte)
+{
+	return is_special(byte) || byte < PPP_HDLC_XOR;
+}
+
+u16_t ppp_hdlc_fcs(u16_t fcs, const u8_t *data, size_t len)
+{
+	while (len--) {
+		fcs = (fcs >> 8) ^ fcs_table[(fcs ^ *data++) & 0xff];
+	}
+
+	return fcs;
+}
+
+size_t ppp_hdlc_scan(const u8_t *data, size_t len)
+{
+	size_t i;
+	u32_t word;
+
+	for (i = 0; i + sizeof(word) <= len; i += sizeof(word)) {
+		memcpy(&word, &data[i], sizeof(word));
+
+		if (has_byte(word, PPP_HDLC_FLAG) |
+		    has_byte(word, PPP_HDLC_ESCAPE)) {
+			break;
+		}
+	}
+
+	for (; i < len; i++) {
+		if (is_special(data[i])) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+/* Length of the data at the start of the block that needs no escaping */
+static size_t plain_len(const u8_t *data, size_t len)
+{
+	size_t i;
+	u32_t word;
+
+	for (i = 0; i + sizeof(word) <= len; i += sizeof(word)) {
+		memcpy(&word, &data[i], sizeof(word));
+
+		if (has_less(word, PPP_HDLC_XOR) |
+		    has_byte(word, PPP_HDLC_FLAG) |
+		    has_byte(word, PPP_HDLC_ESCAPE)) {
+			break;
+		}
+	}
+
+	for (; i < len; i++) {
+		if (needs_escape(data[i])) {
+			break;
+		}
+	}
+
+	return i;
+}
+
+size_t ppp_hdlc_escape(const u8_t *src, size_t len, u8_t *dst,
+		       size_t dst_len, size_t *consumed)
+{
+	size_t in = 0, out = 0, run;
+
+	while (in < len && out < dst_len) {
+		run = plain_len(&src[in], MIN(len - in, dst_len - out));
+
+		memcpy(&dst[out], &src[in], run);
+		in += run;
+		out += run;
+
+		if (in == len || out == dst_len) {
+			break;
+		}
+
+		/* The escaped byte needs two bytes of room, RFC 1662 ch 4.2 */
+		if (dst_len - out < 2) {
+			break;
+		}
+
+		dst[out++] = PPP_HDLC_ESCAPE;
+		dst[out++] = src[in++] ^ PPP_HDLC_XOR;
+	}
+
+	*consumed = in;
+
+	return out;
+}
+
+size_t ppp_hdlc_unescape(u8_t *data, size_t len, bool *escaped,
+			 size_t *decoded, bool *frame_end)
+{
+	size_t in = 0, out = 0, run;
+
+	*frame_end = false;
+
+	while (in < len) {
+		run = ppp_hdlc_scan(&data[in], len - in);
+
+		/* RFC 1662 ch 4.2 */
+		if (*escaped && run > 0) {
+			data[out++] = data[in++] ^ PPP_HDLC_XOR;
+			*escaped = false;
+			continue;
+		}
+
+		if (out != in) {
+			memmove(&data[out], &data[in], run);
+		}
+
+		in += run;
+		out += run;
+
+		if (in == len) {
+			break;
+		}
+
+		if (data[in++] == PPP_HDLC_FLAG) {
+			*escaped = false;
+			*frame_end = true;
+			break;
+		}
+
+		*escaped = true;
+	}
+
+	*decoded = out;
+
+	return in;
+}
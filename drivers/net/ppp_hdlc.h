@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ *
+ * HDLC-like framing of PPP (RFC 1662) on blocks of data.
+ *
+ * This is not to be included by the application.
+ */
+
+#ifndef ZEPHYR_DRIVERS_NET_PPP_HDLC_H_
+#define ZEPHYR_DRIVERS_NET_PPP_HDLC_H_
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define PPP_HDLC_FLAG 0x7e
+#define PPP_HDLC_ESCAPE 0x7d
+#define PPP_HDLC_XOR 0x20
+
+/* Initial FCS value and the value of a good FCS, RFC 1662 ch. C.2 */
+#define PPP_HDLC_FCS_INIT 0xffff
+#define PPP_HDLC_FCS_GOOD 0xf0b8
+
+/**
+ * @brief Update the 16-bit FCS over a block of data.
+ *
+ * @param fcs Current FCS, PPP_HDLC_FCS_INIT at the start of a frame
+ * @param data Data of the frame
+ * @param len Length of the data
+ *
+ * @return Updated FCS
+ */
+u16_t ppp_hdlc_fcs(u16_t fcs, const u8_t *data, size_t len);
+
+/**
+ * @brief Find the first flag or control escape byte in received data.
+ *
+ * @param data Received data
+ * @param len Length of the data
+ *
+ * @return Offset of the first flag or escape byte, len if there is none.
+ */
+size_t ppp_hdlc_scan(const u8_t *data, size_t len);
+
+/**
+ * @brief Escape data to send. The flag and control escape bytes and all
+ * the control characters are escaped, as with the default ACCM.
+ *
+ * @param src Data to send
+ * @param len Length of the data to send
+ * @param dst Buffer for the escaped data
+ * @param dst_len Length of the buffer
+ * @param consumed Set to the length of the data that was escaped, which
+ * is less than len if the buffer is full.
+ *
+ * @return Length of the escaped data in dst.
+ */
+size_t ppp_hdlc_escape(const u8_t *src, size_t len, u8_t *dst,
+		       size_t dst_len, size_t *consumed);
+
+/**
+ * @brief Decode received data in place, up to the end of the frame.
+ *
+ * The escape sequences are removed and the decoded bytes are moved to the
+ * start of the data. Decoding stops after the first flag byte.
+ *
+ * @param data Received data, overwritten by the decoded data
+ * @param len Length of the received data
+ * @param escaped Escape state kept between calls, true if the previous
+ * block ended with a control escape byte. Cleared by a flag byte.
+ * @param decoded Set to the length of the decoded data
+ * @param frame_end Set to true if a flag byte ended the frame
+ *
+ * @return Length of the received data that was consumed, the flag byte
+ * included.
+ */
+size_t ppp_hdlc_unescape(u8_t *data, size_t len, bool *escaped,
+			 size_t *decoded, bool *frame_end);
+
+#endif /* ZEPHYR_DRIVERS_NET_PPP_HDLC_H_ */
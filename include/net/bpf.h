@@ -0,0 +1,279 @@
+/** @file
+ * @brief Classic BPF packet filters
+ *
+ * Filters in the classic BPF instruction set, as used by SO_ATTACH_FILTER
+ * on Linux, can be attached to network interfaces and to packet sockets.
+ * They see the packet as received by the device driver, link layer
+ * header included.
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ZEPHYR_INCLUDE_NET_BPF_H_
+#define ZEPHYR_INCLUDE_NET_BPF_H_
+
+/**
+ * @brief Classic BPF packet filters
+ * @defgroup net_bpf Packet filters
+ * @ingroup networking
+ * @{
+ */
+
+#include <zephyr/types.h>
+#include <errno.h>
+#include <sys/util.h>
+#include <sys/slist.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct net_if;
+struct net_pkt;
+
+/** One filter instruction, same layout as on Linux */
+struct sock_filter {
+	u16_t code;
+	u8_t jt;
+	u8_t jf;
+	u32_t k;
+};
+
+/** Filter program, the option value of SO_ATTACH_FILTER */
+struct sock_fprog {
+	u16_t len;
+	struct sock_filter *filter;
+};
+
+/** @cond INTERNAL_HIDDEN */
+
+/* Instruction classes */
+#define BPF_CLASS(code) ((code) & 0x07)
+#define BPF_LD		0x00
+#define BPF_LDX		0x01
+#define BPF_ST		0x02
+#define BPF_STX		0x03
+#define BPF_ALU		0x04
+#define BPF_JMP		0x05
+#define BPF_RET		0x06
+#define BPF_MISC	0x07
+
+/* ld/ldx fields */
+#define BPF_SIZE(code) ((code) & 0x18)
+#define BPF_W		0x00
+#define BPF_H		0x08
+#define BPF_B		0x10
+#define BPF_MODE(code) ((code) & 0xe0)
+#define BPF_IMM		0x00
+#define BPF_ABS		0x20
+#define BPF_IND		0x40
+#define BPF_MEM		0x60
+#define BPF_LEN		0x80
+#define BPF_MSH		0xa0
+
+/* alu/jmp fields */
+#define BPF_OP(code) ((code) & 0xf0)
+#define BPF_ADD		0x00
+#define BPF_SUB		0x10
+#define BPF_MUL		0x20
+#define BPF_DIV		0x30
+#define BPF_OR		0x40
+#define BPF_AND		0x50
+#define BPF_LSH		0x60
+#define BPF_RSH		0x70
+#define BPF_NEG		0x80
+#define BPF_MOD		0x90
+#define BPF_XOR		0xa0
+
+#define BPF_JA		0x00
+#define BPF_JEQ		0x10
+#define BPF_JGT		0x20
+#define BPF_JGE		0x30
+#define BPF_JSET	0x40
+
+#define BPF_SRC(code) ((code) & 0x08)
+#define BPF_K		0x00
+#define BPF_X		0x08
+
+/* ret fields */
+#define BPF_RVAL(code) ((code) & 0x18)
+#define BPF_A		0x10
+
+/* misc fields */
+#define BPF_MISCOP(code) ((code) & 0xf8)
+#define BPF_TAX		0x00
+#define BPF_TXA		0x80
+
+/** Number of words in the scratch memory */
+#define BPF_MEMWORDS	16
+
+/** Largest program the instruction set allows */
+#define BPF_MAXINSNS	4096
+
+/** @endcond */
+
+/** Build a non-jump instruction */
+#define BPF_STMT(code, k) { (u16_t)(code), 0, 0, k }
+
+/** Build a jump instruction */
+#define BPF_JUMP(code, k, jt, jf) { (u16_t)(code), jt, jf, k }
+
+/**
+ * @typedef net_bpf_func_t
+ * @brief Filter compiled ahead of time to native code.
+ *
+ * It must behave like the classic BPF program it replaces: return 0 if
+ * the packet does not match, and must not block or modify the packet.
+ *
+ * @param pkt Received network packet, cursor at the link layer header
+ * @param user_data User data given in the filter
+ *
+ * @return Non-zero if the packet matches the filter.
+ */
+typedef u32_t (*net_bpf_func_t)(struct net_pkt *pkt, void *user_data);
+
+/** What is done with the packets an interface filter matches */
+enum net_bpf_action {
+	/** Drop the packets that match */
+	NET_BPF_DROP = 0,
+
+	/** Drop the packets that do not match */
+	NET_BPF_ACCEPT,
+
+	/** Give the packets that match the priority of the filter, which
+	 * selects the RX traffic class they are queued to.
+	 */
+	NET_BPF_PRIORITY,
+};
+
+/**
+ * @brief Packet filter attached to a network interface.
+ *
+ * Either insns or func must be set. If func is set, it is called instead
+ * of running the program, which makes it possible to use hand written or
+ * ahead of time compiled versions of filters that run on every packet.
+ */
+struct net_bpf_filter {
+	/** Internal slist node */
+	sys_snode_t node;
+
+	/** Classic BPF program */
+	const struct sock_filter *insns;
+
+	/** Native version of the program */
+	net_bpf_func_t func;
+
+	/** User data passed to func */
+	void *user_data;
+
+	/** Number of instructions in the program */
+	u16_t len;
+
+	/** What to do with the packets the filter matches */
+	enum net_bpf_action action;
+
+	/** Priority of the packets matched by a NET_BPF_PRIORITY filter */
+	u8_t priority;
+
+	/** Internal number of packets the filter is running on */
+	u16_t users;
+
+	/** Internal semaphore given when the last user of a removed filter
+	 * is done with it
+	 */
+	struct k_sem *released;
+};
+
+/**
+ * @brief Check that a program can be run.
+ *
+ * Programs with unknown instructions, jumps that leave the program,
+ * division by a zero constant or out of range scratch memory accesses
+ * are rejected, as are programs that do not end with a return. Jumps can
+ * only go forward, so the time a program runs is bounded by its length.
+ *
+ * @param insns Instructions
+ * @param len Number of instructions
+ *
+ * @return 0 if ok, <0 if error
+ */
+int net_bpf_check(const struct sock_filter *insns, u16_t len);
+
+/**
+ * @brief Run a filter on a packet.
+ *
+ * The program must have been checked with net_bpf_check(). A load from
+ * outside of the packet ends the program with 0, as on Linux.
+ *
+ * @param filter Filter
+ * @param pkt Network packet, offsets are from the start of its data
+ *
+ * @return Value returned by the filter, 0 if the packet does not match.
+ */
+u32_t net_bpf_run(const struct net_bpf_filter *filter, struct net_pkt *pkt);
+
+/**
+ * @brief Attach a filter to a network interface.
+ *
+ * The filter is run on the packets the interface receives before they are
+ * queued for processing. The filter must stay valid until it is detached.
+ * Filters run in the order they were attached, the first one that drops
+ * the packet ends the processing. At most CONFIG_NET_BPF_IFACE_FILTERS
+ * filters can be attached to an interface.
+ *
+ * @param iface Network interface
+ * @param filter Filter
+ *
+ * @return 0 if ok, <0 if error
+ */
+#if defined(CONFIG_NET_BPF)
+int net_bpf_attach(struct net_if *iface, struct net_bpf_filter *filter);
+#else
+static inline int net_bpf_attach(struct net_if *iface,
+				 struct net_bpf_filter *filter)
+{
+	ARG_UNUSED(iface);
+	ARG_UNUSED(filter);
+
+	return -ENOTSUP;
+}
+#endif /* CONFIG_NET_BPF */
+
+/**
+ * @brief Detach a filter from a network interface.
+ *
+ * The filter is not running on any packet anymore when this returns, so
+ * it can be freed. This waits for the running filters and must not be
+ * called from an ISR.
+ *
+ * @param iface Network interface
+ * @param filter Filter
+ *
+ * @return 0 if ok, <0 if error
+ */
+#if defined(CONFIG_NET_BPF)
+int net_bpf_detach(struct net_if *iface, struct net_bpf_filter *filter);
+#else
+static inline int net_bpf_detach(struct net_if *iface,
+				 struct net_bpf_filter *filter)
+{
+	ARG_UNUSED(iface);
+	ARG_UNUSED(filter);
+
+	return -ENOTSUP;
+}
+#endif /* CONFIG_NET_BPF */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* ZEPHYR_INCLUDE_NET_BPF_H_ */
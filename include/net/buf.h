@@ -730,6 +730,12 @@ static inline void net_buf_simple_restore(struct net_buf_simple *buf,
  * count going to 0 will free the net_buf but no the data pointer in it.
  */
 #define NET_BUF_EXTERNAL_DATA  BIT(1)
+/**
+ * Flag indicating that the external data of the buffer must not be written
+ * to, as its owner only lent it for reading. Such net_buf is exclusively
+ * instantiated via net_buf_alloc_with_const_data() function.
+ */
+#define NET_BUF_READ_ONLY      BIT(2)
 
 /**
  * @brief Network buffer representation.
@@ -984,6 +990,82 @@ extern const struct net_buf_data_cb net_buf_var_cb;
 		NET_BUF_POOL_INITIALIZER(_name, &net_buf_data_alloc_##_name,  \
 					 _net_buf_##_name, _count, _destroy)
 
+struct net_buf_pool_slab {
+	struct k_mem_slab *const *slabs;
+	u8_t count;
+};
+
+/** @cond INTERNAL_HIDDEN */
+extern const struct net_buf_data_cb net_buf_slab_cb;
+
+/* Room for the size class and the reference count in front of the data */
+#define NET_BUF_SLAB_HDR_SIZE 4
+/** @endcond */
+
+/**
+ * @def NET_BUF_SLAB_CLASS_DEFINE
+ * @brief Define a size class for pools with size class payloads
+ *
+ * Defines a memory slab holding a number of payloads of the same maximum
+ * size, to be given to NET_BUF_POOL_SLAB_DEFINE. The same class can be
+ * used by several pools. The slab is a global variable, so it can be
+ * referenced from other modules with an extern declaration of a
+ * struct k_mem_slab.
+ *
+ * @param _name      Name of the class variable.
+ * @param _data_size Maximum data payload of the class.
+ * @param _count     Number of payloads in the class.
+ */
+#define NET_BUF_SLAB_CLASS_DEFINE(_name, _data_size, _count)                  \
+	K_MEM_SLAB_DEFINE(_name, NET_BUF_SLAB_HDR_SIZE + (_data_size),        \
+			  _count, 4)
+
+/**
+ * @def NET_BUF_POOL_SLAB_DEFINE
+ * @brief Define a new pool for buffers with size class payloads
+ *
+ * Defines a net_buf_pool struct and the necessary memory storage (array of
+ * structs) for the needed amount of buffers. After this, the buffers can be
+ * accessed from the pool through net_buf_alloc. The pool is defined as a
+ * static variable, so if it needs to be exported outside the current module
+ * this needs to happen with the help of a separate pointer rather than an
+ * extern declaration.
+ *
+ * The data payload of the buffers will be allocated from the smallest of
+ * the size classes, defined with NET_BUF_SLAB_CLASS_DEFINE, that the
+ * requested size fits in. If that class has no free payloads left, the
+ * larger classes are tried, and only if all of them are exhausted the
+ * allocation waits for the class the size fits in best. The size of the
+ * allocated buffer is the payload size of the class it came from. Sizes
+ * larger than the largest class cannot be allocated.
+ *
+ * If provided with a custom destroy callback, this callback is
+ * responsible for eventually calling net_buf_destroy() to complete the
+ * process of returning the buffer to the pool.
+ *
+ * @param _name      Name of the pool variable.
+ * @param _count     Number of buffers in the pool.
+ * @param _destroy   Optional destroy callback when buffer is freed.
+ * @param ...        Pointers to the size classes, smallest one first.
+ */
+#define NET_BUF_POOL_SLAB_DEFINE(_name, _count, _destroy, ...)                \
+	static struct net_buf _net_buf_##_name[_count] __noinit;              \
+	static struct k_mem_slab *const net_buf_slabs_##_name[] = {           \
+		__VA_ARGS__                                                   \
+	};                                                                    \
+	static const struct net_buf_pool_slab net_buf_slab_##_name = {        \
+		.slabs = net_buf_slabs_##_name,                               \
+		.count = ARRAY_SIZE(net_buf_slabs_##_name),                   \
+	};                                                                    \
+	static const struct net_buf_data_alloc net_buf_slab_alloc_##_name = { \
+		.cb = &net_buf_slab_cb,                                       \
+		.alloc_data = (void *)&net_buf_slab_##_name,                  \
+	};                                                                    \
+	struct net_buf_pool _name __net_buf_align                             \
+			__in_section(_net_buf_pool, static, _name) =          \
+		NET_BUF_POOL_INITIALIZER(_name, &net_buf_slab_alloc_##_name,  \
+					 _net_buf_##_name, _count, _destroy)
+
 /**
  * @def NET_BUF_POOL_DEFINE
  * @brief Define a new pool for buffers
@@ -1123,6 +1205,37 @@ struct net_buf *net_buf_alloc_with_data(struct net_buf_pool *pool,
 					k_timeout_t timeout);
 #endif
 
+/**
+ * @brief Allocate a new buffer from a pool with read-only external data.
+ *
+ * Like net_buf_alloc_with_data(), but the buffer is flagged with
+ * NET_BUF_READ_ONLY so that the network stack refuses to write into the
+ * data. The data pointer stays const for the caller.
+ *
+ * @param pool Which pool to allocate the buffer from.
+ * @param data External data pointer
+ * @param size Amount of data in the pointed data buffer.
+ * @param timeout Affects the action taken should the pool be empty,
+ *        see net_buf_alloc_with_data().
+ *
+ * @return New buffer or NULL if out of buffers.
+ */
+static inline struct net_buf *net_buf_alloc_with_const_data(
+					struct net_buf_pool *pool,
+					const void *data, size_t size,
+					k_timeout_t timeout)
+{
+	struct net_buf *buf;
+
+	/* Only read through this buffer, see NET_BUF_READ_ONLY */
+	buf = net_buf_alloc_with_data(pool, (void *)data, size, timeout);
+	if (buf) {
+		buf->flags |= NET_BUF_READ_ONLY;
+	}
+
+	return buf;
+}
+
 /**
  * @brief Get a buffer from a FIFO.
  *
@@ -0,0 +1,147 @@
+/** @file
+ * @brief Packet capture
+ *
+ * Packets received and sent by the network interfaces can be captured in
+ * the pcapng format, to be looked at with Wireshark or tcpdump.
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ZEPHYR_INCLUDE_NET_CAPTURE_H_
+#define ZEPHYR_INCLUDE_NET_CAPTURE_H_
+
+/**
+ * @brief Packet capture
+ * @defgroup net_capture Packet capture
+ * @ingroup networking
+ * @{
+ */
+
+#include <zephyr/types.h>
+#include <errno.h>
+#include <net/net_ip.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct net_bpf_filter;
+
+/**
+ * @typedef net_capture_output_t
+ * @brief Callback that gets the captured data.
+ *
+ * Called from the capture thread with one or more whole pcapng blocks,
+ * the first call after net_capture_start() starting with the section
+ * header.
+ *
+ * @param data Captured data
+ * @param len Length of the data
+ * @param user_data User data given in the configuration
+ */
+typedef void (*net_capture_output_t)(const u8_t *data, size_t len,
+				     void *user_data);
+
+/** Capture configuration */
+struct net_capture_cfg {
+	/** Where to send the capture if the UDP backend is used */
+	struct sockaddr dst;
+
+	/** Filter run on the received link layer frames, NULL to capture
+	 * all of them.
+	 */
+	const struct net_bpf_filter *rx_filter;
+
+	/** Filter run on the sent IP packets, NULL to capture all of them */
+	const struct net_bpf_filter *tx_filter;
+
+	/** If set, gets the captured data instead of the backend */
+	net_capture_output_t output;
+
+	/** User data passed to output */
+	void *user_data;
+
+	/** Number of bytes to capture of each packet, at most and by
+	 * default CONFIG_NET_CAPTURE_SNAPLEN.
+	 */
+	u16_t snaplen;
+};
+
+/** Capture statistics */
+struct net_capture_stats {
+	/** Packets captured */
+	u32_t captured;
+
+	/** Packets not captured because the buffer was full */
+	u32_t dropped;
+};
+
+/**
+ * @brief Start capturing packets.
+ *
+ * The received packets are captured as they are given to the stack by
+ * the device driver, so with their link layer header, and the sent ones
+ * as IP packets before the link layer header is added. The packets
+ * are copied to a buffer, up to the snap length, and written out from
+ * a thread of their own.
+ *
+ * @param cfg Capture configuration
+ *
+ * @return 0 if ok, -EALREADY if capturing already, <0 if the backend
+ * cannot be opened or the configuration is not valid.
+ */
+#if defined(CONFIG_NET_CAPTURE)
+int net_capture_start(const struct net_capture_cfg *cfg);
+#else
+static inline int net_capture_start(const struct net_capture_cfg *cfg)
+{
+	ARG_UNUSED(cfg);
+
+	return -ENOTSUP;
+}
+#endif
+
+/**
+ * @brief Stop capturing packets.
+ *
+ * Writes out the packets still in the buffer and closes the backend.
+ *
+ * @return 0 if ok, -EALREADY if not capturing.
+ */
+#if defined(CONFIG_NET_CAPTURE)
+int net_capture_stop(void);
+#else
+static inline int net_capture_stop(void)
+{
+	return -ENOTSUP;
+}
+#endif
+
+/**
+ * @brief Get the statistics of the current or last capture.
+ *
+ * @param stats Statistics
+ */
+#if defined(CONFIG_NET_CAPTURE)
+void net_capture_get_stats(struct net_capture_stats *stats);
+#else
+static inline void net_capture_get_stats(struct net_capture_stats *stats)
+{
+	stats->captured = 0U;
+	stats->dropped = 0U;
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* ZEPHYR_INCLUDE_NET_CAPTURE_H_ */
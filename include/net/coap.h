@@ -170,6 +170,17 @@ typedef int (*coap_method_t)(struct coap_resource *resource,
 typedef void (*coap_notify_t)(struct coap_resource *resource,
 			      struct coap_observer *observer);
 
+/**
+ * @typedef coap_notify_send_t
+ * @brief Type of the callback sending a notification to one observer,
+ * see coap_resource_notify_packet(). The packet is only valid during
+ * the call, it must be copied to be retransmitted.
+ */
+typedef int (*coap_notify_send_t)(struct coap_resource *resource,
+				  struct coap_observer *observer,
+				  const struct coap_packet *cpkt,
+				  void *user_data);
+
 /**
  * @brief Description of CoAP resource.
  *
@@ -196,6 +207,15 @@ struct coap_observer {
 	u8_t tkl;
 };
 
+/**
+ * @brief Location of an option value in a CoAP packet.
+ */
+struct coap_option_ref {
+	u16_t num; /* Option number */
+	u16_t offset; /* Offset of the option value in the packet data */
+	u16_t len; /* Length of the option value */
+};
+
 /**
  * @brief Representation of a CoAP Packet.
  */
@@ -206,6 +226,14 @@ struct coap_packet {
 	u8_t hdr_len; /* CoAP header length */
 	u16_t opt_len; /* Total options length (delta + len + value) */
 	u16_t delta; /* Used for delta calculation in CoAP packet */
+#if defined(CONFIG_COAP_OPTION_INDEX)
+	/* Options of the packet sorted by number, filled when the packet
+	 * is parsed or built.
+	 */
+	struct coap_option_ref opt_index[CONFIG_COAP_OPTION_INDEX_SIZE];
+	u8_t opt_count; /* Number of options in opt_index */
+	bool opt_index_full; /* The packet has more options than indexed */
+#endif
 };
 
 struct coap_option {
@@ -233,6 +261,7 @@ typedef int (*coap_reply_t)(const struct coap_packet *response,
  */
 struct coap_pending {
 	struct sockaddr addr;
+	u32_t t0; /* Uptime in ms of the last transmission */
 	s32_t timeout;
 	u16_t id;
 	u8_t *data;
@@ -369,6 +398,10 @@ u16_t coap_next_id(void);
  * of the options found
  * @param veclen Number of elements in the options array
  *
+ * If CONFIG_COAP_OPTION_INDEX is enabled, the options are looked up in
+ * the index built by coap_packet_parse() instead of decoding the packet
+ * again.
+ *
  * @return The number of options found in packet matching code,
  * negative on error.
  */
@@ -442,6 +475,24 @@ int coap_packet_append_payload_marker(struct coap_packet *cpkt);
 int coap_packet_append_payload(struct coap_packet *cpkt, u8_t *payload,
 			       u16_t payload_len);
 
+/**
+ * @brief Changes the type, token and message id of a CoAP packet.
+ *
+ * The options and the payload are kept, they are moved if the token
+ * length changes. This allows sending the same message to several
+ * destinations without building it again.
+ *
+ * @param cpkt Packet to be updated
+ * @param type New message type
+ * @param tokenlen New token length
+ * @param token New token, can be NULL if @a tokenlen is 0
+ * @param id New message id
+ *
+ * @return 0 in case of success or negative in case of error.
+ */
+int coap_packet_update_header(struct coap_packet *cpkt, u8_t type,
+			      u8_t tokenlen, const u8_t *token, u16_t id);
+
 /**
  * @brief When a request is received, call the appropriate methods of
  * the matching resources.
@@ -737,8 +788,9 @@ struct coap_reply *coap_response_received(
 	struct coap_reply *replies, size_t len);
 
 /**
- * @brief Returns the next pending about to expire, pending->timeout
- * informs how many ms to next expiration.
+ * @brief Returns the next pending about to expire, so that a single
+ * timer can handle the retransmissions of all the pending requests.
+ * coap_pending_remaining() informs how many ms to next expiration.
  *
  * @param pendings Pointer to the array of #coap_pending structures
  * @param len Size of the array of #coap_pending structures
@@ -749,9 +801,21 @@ struct coap_reply *coap_response_received(
 struct coap_pending *coap_pending_next_to_expire(
 	struct coap_pending *pendings, size_t len);
 
+/**
+ * @brief Returns the time left before the pending request is due for
+ * retransmission.
+ *
+ * @param pending Pending representation
+ *
+ * @return Number of ms to the expiration, 0 if it has expired.
+ */
+s32_t coap_pending_remaining(const struct coap_pending *pending);
+
 /**
  * @brief After a request is sent, user may want to cycle the pending
- * retransmission so the timeout is updated.
+ * retransmission so the timeout is updated. The time of the
+ * transmission is recorded, so this must be called when the request
+ * is sent.
  *
  * @param pending Pending representation to have its timeout updated
  *
@@ -785,6 +849,27 @@ void coap_reply_clear(struct coap_reply *reply);
  */
 int coap_resource_notify(struct coap_resource *resource);
 
+/**
+ * @brief Sends the same notification to every registered observer.
+ *
+ * Unlike coap_resource_notify(), the notification is built once by the
+ * caller. Only its token and message id are changed for each observer
+ * before @a send is called, so notifying many observers does not
+ * encode the options and payload again for each of them. The caller
+ * increments resource->age and uses it as the Observe option value.
+ *
+ * @param resource Resource that was updated
+ * @param cpkt Notification, its token is overwritten
+ * @param send Callback sending the notification to one observer
+ * @param user_data User data passed to @a send
+ *
+ * @return Number of observers the notification was sent to, or
+ * negative in case of error.
+ */
+int coap_resource_notify_packet(struct coap_resource *resource,
+				struct coap_packet *cpkt,
+				coap_notify_send_t send, void *user_data);
+
 /**
  * @brief Returns if this request is enabling observing a resource.
  *
@@ -84,6 +84,13 @@ enum dns_query_type {
 
 /** @endcond */
 
+/**
+ * Returned by dns_resolve_name() when the name was a numeric address. No
+ * query was sent, the callback has already been called and there is
+ * nothing to cancel.
+ */
+#define DNS_RESOLVE_DONE 1
+
 /**
  * Address info struct is passed to callback that gets all the results.
  */
@@ -311,7 +318,8 @@ int dns_resolve_cancel_with_name(struct dns_resolve_context *ctx,
  * @param type What kind of data the caller wants to get.
  * @param dns_id DNS id is returned to the caller. This is needed if one
  * wishes to cancel the query. This can be set to NULL if there is no need
- * to cancel the query.
+ * to cancel the query. It is not set if the answer is given without
+ * sending a query, from the cache or for a numeric address.
  * @param cb Callback to call after the resolving has finished or timeout
  * has happened.
  * @param user_data The user data.
@@ -320,7 +328,8 @@ int dns_resolve_cancel_with_name(struct dns_resolve_context *ctx,
  *            if it takes too long time to finish
  * >0: start the query and let the system timeout it after specified ms
  *
- * @return 0 if resolving was started ok, < 0 otherwise
+ * @return 0 if resolving was started ok, #DNS_RESOLVE_DONE if the name was
+ * a numeric address already given to the callback, < 0 otherwise
  */
 int dns_resolve_name(struct dns_resolve_context *ctx,
 		     const char *query,
@@ -358,7 +367,8 @@ struct dns_resolve_context *dns_resolve_get_default(void);
  * @param type What kind of data the caller wants to get.
  * @param dns_id DNS id is returned to the caller. This is needed if one
  * wishes to cancel the query. This can be set to NULL if there is no need
- * to cancel the query.
+ * to cancel the query. It is not set if the answer is given without
+ * sending a query, from the cache or for a numeric address.
  * @param cb Callback to call after the resolving has finished or timeout
  * has happened.
  * @param user_data The user data.
@@ -367,7 +377,8 @@ struct dns_resolve_context *dns_resolve_get_default(void);
  *            if it takes too long time to finish
  * >0: start the query and let the system timeout it after specified ms
  *
- * @return 0 if resolving was started ok, < 0 otherwise
+ * @return 0 if resolving was started ok, #DNS_RESOLVE_DONE if the name was
+ * a numeric address already given to the callback, < 0 otherwise
  */
 static inline int dns_get_addr_info(const char *query,
 				    enum dns_query_type type,
@@ -399,6 +410,66 @@ static inline int dns_cancel_addr_info(u16_t dns_id)
 	return dns_resolve_cancel(dns_resolve_get_default(), dns_id);
 }
 
+/**
+ * Information about a cached DNS answer, see dns_cache_foreach().
+ */
+struct dns_cache_info {
+	/** Cached host name */
+	const char *name;
+
+	/** Cached addresses, NULL for a negative answer */
+	const struct sockaddr *addr;
+
+	/** Number of cached addresses, 0 for a negative answer */
+	int count;
+
+	/** Status of a negative answer (DNS_EAI_NONAME or DNS_EAI_NODATA) */
+	int status;
+
+	/** Query type of the answer */
+	enum dns_query_type query_type;
+
+	/** Seconds left until the answer expires */
+	u32_t ttl;
+};
+
+/**
+ * @typedef dns_cache_cb_t
+ * @brief Callback used when traversing the DNS cache.
+ *
+ * @param info Information about the cached answer
+ * @param user_data A valid pointer on some user data or NULL
+ */
+typedef void (*dns_cache_cb_t)(const struct dns_cache_info *info,
+			       void *user_data);
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+/**
+ * @brief Go through all the answers in the DNS cache.
+ *
+ * @details Expired answers are skipped.
+ *
+ * @param cb User supplied callback function to call
+ * @param user_data User specified data
+ */
+void dns_cache_foreach(dns_cache_cb_t cb, void *user_data);
+
+/**
+ * @brief Remove all the answers from the DNS cache.
+ */
+void dns_cache_flush(void);
+#else
+static inline void dns_cache_foreach(dns_cache_cb_t cb, void *user_data)
+{
+	ARG_UNUSED(cb);
+	ARG_UNUSED(user_data);
+}
+
+static inline void dns_cache_flush(void)
+{
+}
+#endif /* CONFIG_DNS_RESOLVER_CACHE */
+
 /**
  * @}
  */
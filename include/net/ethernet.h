@@ -126,6 +126,17 @@ enum ethernet_hw_caps {
 
 	/** VLAN Tag stripping */
 	ETHERNET_HW_VLAN_TAG_STRIP	= BIT(14),
+
+	/** TCP segmentation offload supported, see net_pkt_gso_size() */
+	ETHERNET_HW_TSO			= BIT(15),
+
+	/** TX checksum offloading of the UDP and TCP checksum only. The stack
+	 * stores the pseudo header sum in the checksum field, and the device
+	 * adds the sum of the data from the start of the UDP or TCP header to
+	 * the end of the packet, see net_pkt_is_chksum_partial() and
+	 * net_eth_chksum_start().
+	 */
+	ETHERNET_HW_TX_CHKSUM_PARTIAL	= BIT(16),
 };
 
 /** @cond INTERNAL_HIDDEN */
@@ -501,6 +512,25 @@ enum ethernet_hw_caps net_eth_get_hw_capabilities(struct net_if *iface)
 	return eth->get_capabilities(net_if_get_device(iface));
 }
 
+/**
+ * @brief Return where the device starts the checksum of a packet.
+ *
+ * For a packet with net_pkt_is_chksum_partial() set, return the offset of
+ * the UDP or TCP header from the start of the Ethernet frame. The device
+ * sums the data from there to the end of the frame, and stores the result
+ * at net_pkt_chksum_offset() bytes from that offset. Only valid in the
+ * send() function of the driver, when the first fragment of the packet
+ * holds the Ethernet header.
+ *
+ * @param pkt Network packet to send
+ *
+ * @return Offset of the data to checksum
+ */
+static inline u16_t net_eth_chksum_start(struct net_pkt *pkt)
+{
+	return pkt->buffer->len + net_pkt_chksum_start(pkt);
+}
+
 /**
  * @brief Add VLAN tag to the interface.
  *
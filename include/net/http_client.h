@@ -22,6 +22,7 @@
 
 #include <net/net_ip.h>
 #include <net/http_parser.h>
+#include <net/tls_credentials.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -79,6 +80,43 @@ typedef int (*http_header_cb_t)(int sock,
 				struct http_request *req,
 				void *user_data);
 
+/**
+ * @typedef http_chunk_cb_t
+ * @brief Callback used when the request body is sent with chunked transfer
+ * encoding. It is called repeatedly, each call provides the next chunk.
+ *
+ * @param req HTTP request information
+ * @param data Set by the callback to the data of the chunk. The data must
+ *        stay valid until the callback is called again.
+ * @param user_data User specified data specified in http_client_req()
+ *
+ * @return >0 length of the chunk,
+ *          0 if there is no more data, which ends the body,
+ *         <0 if http_client_req() should return the error code to the
+ *            caller.
+ */
+typedef int (*http_chunk_cb_t)(struct http_request *req,
+			       const u8_t **data,
+			       void *user_data);
+
+/**
+ * @typedef http_body_cb_t
+ * @brief Callback used to pass the response body to the application
+ * without copying it. The data points to the receive buffer of the request
+ * and is only valid during the call. Chunked bodies are passed without
+ * the chunk framing.
+ *
+ * @param req HTTP request information
+ * @param data Piece of the response body
+ * @param len Length of the data
+ * @param user_data User specified data specified in http_client_req()
+ *
+ * @return 0 to continue receiving the response, <0 to abort it.
+ */
+typedef int (*http_body_cb_t)(struct http_request *req,
+			      const u8_t *data, size_t len,
+			      void *user_data);
+
 /**
  * @typedef http_response_cb_t
  * @brief Callback used when data is received from the server.
@@ -156,6 +194,9 @@ struct http_client_internal_data {
 	/** Work for handling timeout */
 	struct k_delayed_work work;
 
+	/** Given when the timeout handler is done with the socket */
+	struct k_sem work_done;
+
 	/** HTTP parser context */
 	struct http_parser parser;
 
@@ -170,6 +211,9 @@ struct http_client_internal_data {
 	/** User data */
 	void *user_data;
 
+	/** Received data not yet counted in response.data_len */
+	const u8_t *parse_start;
+
 	/** HTTP socket */
 	int sock;
 
@@ -259,6 +303,20 @@ struct http_request {
 	 * headers will be placed into this field.
 	 */
 	const char **optional_headers;
+
+	/** User supplied callback function to call to get the chunks of
+	 * the payload. If set, the payload is sent with chunked transfer
+	 * encoding so that its length does not need to be known in advance.
+	 * This is ignored if payload_cb is set, and the payload field is
+	 * ignored if this is set.
+	 */
+	http_chunk_cb_t chunk_cb;
+
+	/** User supplied callback function to call for each piece of the
+	 * response body. May be NULL. If set, the response callback is not
+	 * called for the body but only once the response is complete.
+	 */
+	http_body_cb_t body_cb;
 };
 
 /**
@@ -273,11 +331,138 @@ struct http_request {
  *        0 as there would be no time to receive the data.
  * @param user_data User specified data that is passed to the callback.
  *
- * @return <0 if error, >=0 amount of data sent to the server
+ * @return <0 if error, >=0 amount of data sent to the server. If no full
+ * response was received, -ETIMEDOUT is returned when the timeout closed
+ * the socket, and -ECONNRESET when the server closed the connection.
  */
 int http_client_req(int sock, struct http_request *req,
 		    s32_t timeout, void *user_data);
 
+/**
+ * @brief Do several HTTP requests without waiting for the responses in
+ * between (HTTP/1.1 pipelining). All the requests are sent first, then the
+ * responses are received in the same order. The server must support
+ * persistent connections. As a response may arrive in the same segment as
+ * the previous one, the requests should use receive buffers of the same
+ * size.
+ *
+ * @param sock Socket id of the connection.
+ * @param reqs Array of pointers to the HTTP requests
+ * @param count Number of requests in the array
+ * @param timeout Max timeout to wait for each response.
+ * @param user_data User specified data that is passed to the callbacks.
+ *
+ * @return <0 if a request could not be sent, otherwise the number of
+ *         complete responses received. Requests after the last complete
+ *         response were not answered.
+ */
+int http_client_req_pipeline(int sock, struct http_request **reqs,
+			     size_t count, s32_t timeout, void *user_data);
+
+#if defined(CONFIG_HTTP_CLIENT_SESSION)
+/** Persistent connection of a HTTP client session */
+struct http_client_conn {
+	/** Socket of the connection, -1 if not connected */
+	int sock;
+
+	/** Uptime when the connection was last used */
+	s64_t last_used;
+
+	/** Is a request in progress on the connection */
+	bool busy;
+};
+
+/**
+ * HTTP client session. Requests done through a session reuse the
+ * connections to the server as long as the server keeps them alive.
+ */
+struct http_client_session {
+	/** Address of the server */
+	struct sockaddr addr;
+
+	/** Length of the address */
+	socklen_t addrlen;
+
+	/** IPPROTO_TCP, or IPPROTO_TLS_1_2 for HTTPS */
+	int proto;
+
+	/** TLS credentials used for HTTPS, may be set after
+	 * http_client_session_init()
+	 */
+	const sec_tag_t *sec_tag_list;
+
+	/** Number of TLS credentials */
+	size_t sec_tag_list_size;
+
+	/** TLS host name to verify, may be NULL */
+	const char *tls_hostname;
+
+	/** Protects the connection slots */
+	struct k_mutex lock;
+
+	/** Connections to the server */
+	struct http_client_conn conns[CONFIG_HTTP_CLIENT_SESSION_CONNECTIONS];
+};
+
+/**
+ * @brief Initialize a HTTP client session. No connection is created before
+ * the first request.
+ *
+ * @param session HTTP client session
+ * @param addr Address of the server
+ * @param addrlen Length of the address
+ * @param proto IPPROTO_TCP, or IPPROTO_TLS_1_2 for HTTPS
+ *
+ * @return 0 if ok, <0 if error
+ */
+int http_client_session_init(struct http_client_session *session,
+			     const struct sockaddr *addr, socklen_t addrlen,
+			     int proto);
+
+/**
+ * @brief Do a HTTP request using a connection of the session. An idle
+ * connection is reused, otherwise a new one is created. The connection is
+ * kept open after the response if the server allows it. A request that
+ * fails on a reused connection, because the server closed it meanwhile, is
+ * retried once on a new connection if the method is idempotent.
+ *
+ * @param session HTTP client session
+ * @param req HTTP request information
+ * @param timeout Max timeout to wait for the data.
+ * @param user_data User specified data that is passed to the callback.
+ *
+ * @return <0 if error, >=0 amount of data sent to the server. -ECONNRESET
+ * if the connection was closed before the full response, -ETIMEDOUT if
+ * the response did not come in time.
+ */
+int http_client_session_req(struct http_client_session *session,
+			    struct http_request *req, s32_t timeout,
+			    void *user_data);
+
+/**
+ * @brief Do several pipelined HTTP requests using a connection of the
+ * session, see http_client_req_pipeline().
+ *
+ * @param session HTTP client session
+ * @param reqs Array of pointers to the HTTP requests
+ * @param count Number of requests in the array
+ * @param timeout Max timeout to wait for each response.
+ * @param user_data User specified data that is passed to the callbacks.
+ *
+ * @return <0 if error, otherwise the number of complete responses received.
+ */
+int http_client_session_pipeline(struct http_client_session *session,
+				 struct http_request **reqs, size_t count,
+				 s32_t timeout, void *user_data);
+
+/**
+ * @brief Close all the idle connections of a HTTP client session.
+ *
+ * @param session HTTP client session
+ */
+void http_client_session_close(struct http_client_session *session);
+#endif /* CONFIG_HTTP_CLIENT_SESSION */
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,331 @@
+/** @file
+ * @brief HTTP server API
+ *
+ * An API for applications to serve HTTP resources
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ZEPHYR_INCLUDE_NET_HTTP_SERVER_H_
+#define ZEPHYR_INCLUDE_NET_HTTP_SERVER_H_
+
+/**
+ * @brief HTTP server API
+ * @defgroup http_server HTTP server API
+ * @ingroup networking
+ * @{
+ */
+
+#include <kernel.h>
+#include <net/net_ip.h>
+#include <net/http_parser.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if !defined(HTTP_CRLF)
+#define HTTP_CRLF "\r\n"
+#endif
+
+/** Value of content_length in http_server_response_begin() for a response
+ * sent with chunked transfer encoding.
+ */
+#define HTTP_SERVER_CHUNKED -1
+
+/** Kind of a HTTP server resource */
+enum http_server_resource_type {
+	/** Constant data served for GET and HEAD requests */
+	HTTP_SERVER_RESOURCE_STATIC,
+
+	/** Response built by a callback */
+	HTTP_SERVER_RESOURCE_DYNAMIC,
+
+	/** Websocket endpoint, the connection is given to a callback after
+	 * the upgrade handshake.
+	 */
+	HTTP_SERVER_RESOURCE_WEBSOCKET,
+};
+
+struct http_server_client;
+struct http_server_resource;
+
+/** HTTP request received by the server */
+struct http_server_request {
+	/** Client that sent the request, used to send the response */
+	struct http_server_client *client;
+
+	/** Resource of the request */
+	const struct http_server_resource *resource;
+
+	/** The HTTP method: GET, HEAD, POST, ... */
+	enum http_method method;
+
+	/** Request target, not NUL terminated */
+	const char *url;
+
+	/** Length of the request target */
+	size_t url_len;
+
+	/** Request body, without chunk framing. NULL if there is none. */
+	const u8_t *body;
+
+	/** Length of the request body */
+	size_t body_len;
+};
+
+/**
+ * @typedef http_server_resource_cb_t
+ * @brief Callback called for a request to a dynamic resource. It runs in
+ * the server thread and should not block. The response is sent with the
+ * http_server_response_*() functions, a response not ended by the callback
+ * is ended when it returns. The functions do not block either, so the part
+ * of the response that the socket does not take at once must fit in the
+ * send buffer of the connection.
+ *
+ * @param req Received request. Its data is only valid during the call.
+ * @param user_data User data of the resource
+ *
+ * @return 0 if ok, <0 to close the connection. If no response was started,
+ *         a 500 response is sent before.
+ */
+typedef int (*http_server_resource_cb_t)(const struct http_server_request *req,
+					 void *user_data);
+
+/**
+ * @typedef http_server_websocket_cb_t
+ * @brief Callback called when a client has upgraded its connection to a
+ * websocket. The server does not use the socket anymore, the callback
+ * takes ownership of it, see websocket_register().
+ *
+ * @param sock Socket of the connection
+ * @param req Upgrade request
+ * @param user_data User data of the resource
+ *
+ * @return 0 if the socket was taken, <0 if the server must close it.
+ */
+typedef int (*http_server_websocket_cb_t)(int sock,
+					  const struct http_server_request *req,
+					  void *user_data);
+
+/** Resource served by the HTTP server */
+struct http_server_resource {
+	/** Path of the resource. A path ending with '*' matches all the
+	 * paths starting with the part before it.
+	 */
+	const char *path;
+
+	/** Kind of resource */
+	enum http_server_resource_type type;
+
+	/** Content-Type of a static resource, may be NULL */
+	const char *content_type;
+
+	/** Content-Encoding of a static resource, for example "gzip",
+	 * may be NULL
+	 */
+	const char *content_encoding;
+
+	/** Data of a static resource */
+	const u8_t *data;
+
+	/** Length of the data of a static resource */
+	size_t data_len;
+
+	/** Callback of a dynamic resource */
+	http_server_resource_cb_t cb;
+
+	/** Callback of a websocket resource */
+	http_server_websocket_cb_t ws_cb;
+
+	/** User data passed to the callbacks */
+	void *user_data;
+};
+
+/** @cond INTERNAL_HIDDEN */
+
+/** Connection of a client, the application should not touch this */
+struct http_server_client {
+	/** HTTP parser context */
+	struct http_parser parser;
+
+	/** Received data */
+	u8_t buf[CONFIG_HTTP_SERVER_CLIENT_BUFFER_SIZE];
+
+	/** Length of the data in buf */
+	size_t len;
+
+	/** Length of the data in buf given to the parser */
+	size_t parsed;
+
+	/** Output waiting for the socket to be writable */
+	u8_t out_buf[CONFIG_HTTP_SERVER_CLIENT_TX_BUFFER_SIZE];
+
+	/** Length of the data in out_buf */
+	size_t out_len;
+
+	/** Length of the data in out_buf already sent */
+	size_t out_off;
+
+	/** Constant data waiting to be sent after out_buf, such as the
+	 * rest of a static resource
+	 */
+	const u8_t *out_data;
+
+	/** Length of out_data */
+	size_t out_data_len;
+
+	/** Request being received */
+	struct http_server_request req;
+
+	/** Header field being received */
+	const char *field;
+
+	/** Length of the header field */
+	size_t field_len;
+
+	/** Sec-WebSocket-Key header value */
+	const char *ws_key;
+
+	/** Length of the Sec-WebSocket-Key header value */
+	size_t ws_key_len;
+
+	/** Uptime when the connection becomes idle for too long */
+	s64_t deadline;
+
+	/** Uptime when the output is tried again after the socket did not
+	 * take any
+	 */
+	s64_t send_retry;
+
+	/** Socket of the connection, -1 if the slot is free */
+	int sock;
+
+	/** Which header value is being received */
+	u8_t header;
+
+	/** Was a header value the last thing received */
+	u8_t in_value : 1;
+
+	/** Is the request complete */
+	u8_t complete : 1;
+
+	/** Has the response been started */
+	u8_t responding : 1;
+
+	/** Is the response body sent in chunks */
+	u8_t chunked : 1;
+
+	/** Is the connection kept open after the response */
+	u8_t keep_alive : 1;
+
+	/** Is the connection closed once the output is sent */
+	u8_t closing : 1;
+
+	/** Is the connection given to a websocket resource once the
+	 * output is sent
+	 */
+	u8_t upgrading : 1;
+};
+
+/** @endcond */
+
+/** HTTP server context */
+struct http_server_ctx {
+	/** Resources served */
+	const struct http_server_resource *resources;
+
+	/** Number of resources */
+	size_t resources_count;
+
+	/** Listening socket */
+	int listen_sock;
+
+	/** Connected clients */
+	struct http_server_client clients[CONFIG_HTTP_SERVER_MAX_CLIENTS];
+};
+
+/**
+ * @brief Initialize a HTTP server and start listening for connections.
+ *
+ * @param ctx HTTP server context
+ * @param addr Address to listen on
+ * @param addrlen Length of the address
+ * @param resources Resources served, the table must stay valid while the
+ *        server runs
+ * @param count Number of resources in the table
+ *
+ * @return 0 if ok, <0 if error
+ */
+int http_server_init(struct http_server_ctx *ctx,
+		     const struct sockaddr *addr, socklen_t addrlen,
+		     const struct http_server_resource *resources,
+		     size_t count);
+
+/**
+ * @brief Run the HTTP server. All the connections are served from the
+ * calling thread, which waits for the events of the sockets with poll().
+ * At most CONFIG_HTTP_SERVER_MAX_CLIENTS connections are accepted at the
+ * same time, more connections wait in the listen backlog.
+ *
+ * @param ctx HTTP server context
+ *
+ * @return <0 on error, the function does not return otherwise.
+ */
+int http_server_run(struct http_server_ctx *ctx);
+
+/**
+ * @brief Start the response to a request, that is send its headers.
+ *
+ * @param client Client that sent the request
+ * @param status HTTP status code
+ * @param content_type Content-Type of the body, may be NULL
+ * @param content_length Length of the body, or HTTP_SERVER_CHUNKED if the
+ *        length is not known in advance. A HTTP/1.0 client gets such a
+ *        body without framing, and the connection is closed after it.
+ *        Ignored for 1xx, 204 and 304 responses, which have no body.
+ *
+ * @return 0 if ok, <0 if error
+ */
+int http_server_response_begin(struct http_server_client *client, int status,
+			       const char *content_type,
+			       ssize_t content_length);
+
+/**
+ * @brief Send a part of the body of a response. This does not block, the
+ * data that the socket does not take at once is copied to the send buffer
+ * of the connection, and sent when the socket is writable.
+ *
+ * @param client Client that sent the request
+ * @param data Data to send
+ * @param len Length of the data
+ *
+ * @return 0 if ok, -ENOBUFS if the data does not fit in the rest of the
+ *         CONFIG_HTTP_SERVER_CLIENT_TX_BUFFER_SIZE bytes send buffer, other
+ *         <0 if error
+ */
+int http_server_response_write(struct http_server_client *client,
+			       const void *data, size_t len);
+
+/**
+ * @brief End a response.
+ *
+ * @param client Client that sent the request
+ *
+ * @return 0 if ok, <0 if error
+ */
+int http_server_response_end(struct http_server_client *client);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* ZEPHYR_INCLUDE_NET_HTTP_SERVER_H_ */
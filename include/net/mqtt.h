@@ -450,6 +450,16 @@ struct mqtt_internal {
 
 	/** Internal. Remaining payload length to read. */
 	u32_t remaining_payload;
+
+#if defined(CONFIG_MQTT_INFLIGHT_MAX) && (CONFIG_MQTT_INFLIGHT_MAX > 0)
+	/** Internal. Message ids of the QoS 1 and QoS 2 publish messages
+	 *  not acknowledged yet, 0 for a free entry.
+	 */
+	u16_t inflight[CONFIG_MQTT_INFLIGHT_MAX];
+
+	/** Internal. Number of messages in inflight. */
+	u16_t inflight_count;
+#endif
 };
 
 /**
@@ -591,6 +601,50 @@ int mqtt_connect(struct mqtt_client *client);
 int mqtt_publish(struct mqtt_client *client,
 		 const struct mqtt_publish_param *param);
 
+/**
+ * @brief API to publish several messages in one transport write.
+ *
+ * The headers of all the messages are encoded in the transmit buffer,
+ * the payloads are sent from the buffers given in the parameters without
+ * being copied.
+ *
+ * If the inflight window cannot take the QoS 1 and QoS 2 messages, or one of
+ * them cannot be encoded, nothing is sent. If the transport write fails,
+ * the connection is closed and only some of the messages may have reached
+ * the broker. None of them is then accounted as in flight: the QoS 1 and
+ * QoS 2 messages of the batch shall be published again with the DUP flag
+ * set once the client is connected again.
+ *
+ * @param[in] client Client instance for which the procedure is requested.
+ *                   Shall not be NULL.
+ * @param[in] params Parameters of the messages to publish.
+ *                   Shall not be NULL.
+ * @param[in] count Number of messages, at most
+ *                  CONFIG_MQTT_PUBLISH_BATCH_MAX.
+ *
+ * @return 0 or a negative error code (errno.h) indicating reason of failure.
+ *         -EAGAIN if there is no room left in the inflight window for the
+ *         QoS 1 and QoS 2 messages, -EALREADY if the id of a message
+ *         without the DUP flag is still in flight.
+ */
+int mqtt_publish_batch(struct mqtt_client *client,
+		       const struct mqtt_publish_param *params, size_t count);
+
+/**
+ * @brief Get the number of QoS 1 and QoS 2 messages published and not
+ *        acknowledged yet by the broker.
+ *
+ * A message is in flight until its PUBACK (QoS 1) or PUBCOMP (QoS 2) is
+ * received. At most CONFIG_MQTT_INFLIGHT_MAX messages can be in flight,
+ * publishing another one fails with -EAGAIN.
+ *
+ * @param[in] client Client instance for which the procedure is requested.
+ *
+ * @return Number of messages in flight, always 0 if
+ *         CONFIG_MQTT_INFLIGHT_MAX is 0.
+ */
+u32_t mqtt_inflight_count(const struct mqtt_client *client);
+
 /**
  * @brief API used by client to send acknowledgment on receiving QoS1 publish
  *        message. Should be called on reception of @ref MQTT_EVT_PUBLISH with
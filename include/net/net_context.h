@@ -277,6 +277,11 @@ struct net_context {
 		struct k_fifo accept_q;
 	};
 
+#if defined(CONFIG_NET_SOCKETS_EPOLL)
+	/** Event set registrations of the socket */
+	sys_slist_t epoll_items;
+#endif /* CONFIG_NET_SOCKETS_EPOLL */
+
 #if defined(CONFIG_NET_SOCKETS_SOCKOPT_TLS)
 	/** TLS context information */
 	struct tls_context *tls;
@@ -309,9 +314,26 @@ struct net_context {
 			struct sockaddr addr;
 			socklen_t addrlen;
 		} proxy;
+#endif
+#if defined(CONFIG_NET_BPF)
+		/** Packet filter of a packet socket */
+		struct net_bpf_filter *bpf_filter;
+#endif
+#if defined(CONFIG_NET_CONTEXT_RCVBUF)
+		/** Number of RX buffers the received packets can hold,
+		 * 0 for the default quota.
+		 */
+		u16_t rcvbuf;
 #endif
 	} options;
 
+#if defined(CONFIG_NET_CONTEXT_RCVBUF)
+	/** Number of RX buffers held by the received packets that have
+	 * not been freed yet.
+	 */
+	atomic_t rcvbuf_used;
+#endif
+
 	/** Protocol (UDP, TCP or IEEE 802.3 protocol value) */
 	u16_t proto;
 
@@ -955,6 +977,39 @@ int net_context_sendto(struct net_context *context,
 		       s32_t timeout,
 		       void *user_data);
 
+/**
+ * @brief Send a chain of network buffers to a peer without copying.
+ *
+ * @details This function works like net_context_sendto() but instead of
+ * copying the payload into a freshly allocated network packet, a reference
+ * to the given fragment chain is appended to the packet after the protocol
+ * headers. The caller keeps its own reference to the chain and may release
+ * it at any time; the data is freed only after the stack has dropped its
+ * last reference, for example after TCP has received the ACK covering it.
+ * The data in the chain must not be modified until then, so the buffers
+ * would typically come from a pool with a destroy callback that tells the
+ * application when the memory can be reused.
+ * The payload must fit into a single packet, no segmentation is done.
+ *
+ * @param context The network context to use.
+ * @param frags Fragment chain holding the payload.
+ * @param dst_addr Destination address. If NULL, the address set by
+ *        net_context_connect() is used.
+ * @param addrlen Length of the address.
+ * @param cb Caller-supplied callback function.
+ * @param timeout Currently this value is not used.
+ * @param user_data Caller-supplied user data.
+ *
+ * @return numbers of bytes sent on success, a negative errno otherwise
+ */
+int net_context_sendto_frags(struct net_context *context,
+			     struct net_buf *frags,
+			     const struct sockaddr *dst_addr,
+			     socklen_t addrlen,
+			     net_context_send_cb_t cb,
+			     s32_t timeout,
+			     void *user_data);
+
 /**
  * @brief Send data in iovec to a peer specified in msghdr struct.
  *
@@ -1049,6 +1104,8 @@ enum net_context_option {
 	NET_OPT_TIMESTAMP	= 2,
 	NET_OPT_TXTIME		= 3,
 	NET_OPT_SOCKS5		= 4,
+	NET_OPT_BPF_FILTER	= 5,
+	NET_OPT_RCVBUF		= 6,
 };
 
 /**
@@ -114,6 +114,14 @@ int net_send_data(struct net_pkt *pkt);
 #define NET_TC_COUNT 1
 #endif /* CONFIG_NET_TC_TX_COUNT && CONFIG_NET_TC_RX_COUNT */
 
+#if defined(CONFIG_NET_TC_TX_WORKERS) && defined(CONFIG_NET_TC_RX_WORKERS)
+#define NET_TC_TX_WORKERS CONFIG_NET_TC_TX_WORKERS
+#define NET_TC_RX_WORKERS CONFIG_NET_TC_RX_WORKERS
+#else
+#define NET_TC_TX_WORKERS 1
+#define NET_TC_RX_WORKERS 1
+#endif
+
 /* @endcond */
 
 /**
@@ -480,6 +480,11 @@ struct net_if {
 	 */
 	int tx_pending;
 #endif
+
+#if defined(CONFIG_NET_BPF)
+	/** Packet filters run on the packets received by the interface */
+	sys_slist_t bpf_filters;
+#endif
 } __net_if_align;
 
 /**
@@ -1733,6 +1738,19 @@ bool net_if_ipv4_router_rm(struct net_if_router *router);
 bool net_if_ipv4_addr_mask_cmp(struct net_if *iface,
 			       const struct in_addr *addr);
 
+/**
+ * @brief Check if this IPv4 address is part of the subnet of our
+ * network interface.
+ *
+ * @param iface Network interface. This is returned to the caller.
+ * The iface can be NULL in which case we check all the interfaces.
+ * @param addr IPv4 address
+ *
+ * @return True if address is part of our subnet, false otherwise
+ */
+bool net_if_ipv4_addr_onlink(struct net_if **iface,
+			     const struct in_addr *addr);
+
 /**
  * @brief Check if the given IPv4 address is a broadcast address.
  *
@@ -1943,6 +1961,17 @@ bool net_if_need_calc_rx_checksum(struct net_if *iface);
  */
 bool net_if_need_calc_tx_checksum(struct net_if *iface);
 
+/**
+ * @brief Check if the device can finish the UDP and TCP checksum of an
+ * outgoing packet when the stack has calculated the pseudo header sum.
+ * This is only relevant if net_if_need_calc_tx_checksum() returns true.
+ *
+ * @param iface Network interface
+ *
+ * @return True if partial checksum offloading is supported, false otherwise.
+ */
+bool net_if_tx_checksum_partial(struct net_if *iface);
+
 /**
  * @brief Get interface according to index
  *
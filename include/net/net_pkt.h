@@ -138,6 +138,15 @@ struct net_pkt {
 	};
 #endif
 
+	u16_t chksum_start;	/* For outgoing packet with chksum_partial:
+				 * offset of the UDP or TCP header from the
+				 * start of the IP header.
+				 */
+	u8_t chksum_offset;	/* For outgoing packet with chksum_partial:
+				 * offset of the checksum field from
+				 * chksum_start.
+				 */
+
 	u8_t ip_hdr_len;	/* pre-filled in order to avoid func call */
 
 	u8_t overwrite  : 1;	/* Is packet content being overwritten? */
@@ -161,8 +170,21 @@ struct net_pkt {
 
 	u8_t forwarding : 1;	/* Are we forwarding this pkt
 				 * Used only if defined(CONFIG_NET_ROUTE)
+				 * or defined(CONFIG_NET_IPV4_FORWARDING)
 				 */
 	u8_t family     : 3;	/* IPv4 vs IPv6 */
+	u8_t chksum_verified : 1; /* For incoming packet: L4 checksum has
+				   * already been verified, either by the
+				   * device or by the receive offload.
+				   */
+	u8_t chksum_partial : 1; /* For outgoing packet: L4 checksum field
+				  * only holds the pseudo header sum, the
+				  * device must finish the checksum.
+				  */
+	u8_t ip_reassembled : 1; /* For incoming packet: reassembled from
+				  * IP fragments, it has no link layer
+				  * header anymore.
+				  */
 
 	union {
 		u8_t ipv4_auto_arp_msg : 1; /* Is this pkt IPv4 autoconf ARP
@@ -211,6 +233,21 @@ struct net_pkt {
 	u8_t priority;
 #endif
 
+#if defined(CONFIG_NET_GSO)
+	/* For outgoing TCP packet: if non-zero, the packet is larger than
+	 * the link MTU and must be split into segments carrying at most this
+	 * many payload bytes before it is given to the device.
+	 */
+	u16_t gso_size;
+#endif /* CONFIG_NET_GSO */
+
+#if defined(CONFIG_NET_CONTEXT_RCVBUF)
+	/* For incoming packet: number of buffers charged to the receive
+	 * quota of the context, given back when the packet is freed.
+	 */
+	u16_t rcvbuf_charge;
+#endif /* CONFIG_NET_CONTEXT_RCVBUF */
+
 #if defined(CONFIG_NET_VLAN)
 	/* VLAN TCI (Tag Control Information). This contains the Priority
 	 * Code Point (PCP), Drop Eligible Indicator (DEI) and VLAN
@@ -371,6 +408,86 @@ static inline void net_pkt_set_tcp_1st_msg(struct net_pkt *pkt, bool is_1st)
 	pkt->tcp_first_msg = is_1st;
 }
 
+static inline bool net_pkt_is_chksum_verified(struct net_pkt *pkt)
+{
+	return pkt->chksum_verified;
+}
+
+static inline void net_pkt_set_chksum_verified(struct net_pkt *pkt,
+					       bool verified)
+{
+	pkt->chksum_verified = verified;
+}
+
+static inline bool net_pkt_is_chksum_partial(struct net_pkt *pkt)
+{
+	return pkt->chksum_partial;
+}
+
+static inline void net_pkt_set_chksum_partial(struct net_pkt *pkt,
+					      bool partial)
+{
+	pkt->chksum_partial = partial;
+}
+
+static inline u16_t net_pkt_chksum_start(struct net_pkt *pkt)
+{
+	return pkt->chksum_start;
+}
+
+static inline void net_pkt_set_chksum_start(struct net_pkt *pkt,
+					    u16_t start)
+{
+	pkt->chksum_start = start;
+}
+
+static inline u8_t net_pkt_chksum_offset(struct net_pkt *pkt)
+{
+	return pkt->chksum_offset;
+}
+
+static inline void net_pkt_set_chksum_offset(struct net_pkt *pkt,
+					     u8_t offset)
+{
+	pkt->chksum_offset = offset;
+}
+
+static inline bool net_pkt_is_ip_reassembled(struct net_pkt *pkt)
+{
+	return pkt->ip_reassembled;
+}
+
+static inline void net_pkt_set_ip_reassembled(struct net_pkt *pkt,
+					      bool reassembled)
+{
+	pkt->ip_reassembled = reassembled;
+}
+
+#if defined(CONFIG_NET_GSO)
+static inline u16_t net_pkt_gso_size(struct net_pkt *pkt)
+{
+	return pkt->gso_size;
+}
+
+static inline void net_pkt_set_gso_size(struct net_pkt *pkt, u16_t size)
+{
+	pkt->gso_size = size;
+}
+#else
+static inline u16_t net_pkt_gso_size(struct net_pkt *pkt)
+{
+	ARG_UNUSED(pkt);
+
+	return 0;
+}
+
+static inline void net_pkt_set_gso_size(struct net_pkt *pkt, u16_t size)
+{
+	ARG_UNUSED(pkt);
+	ARG_UNUSED(size);
+}
+#endif /* CONFIG_NET_GSO */
+
 #if defined(CONFIG_NET_SOCKETS)
 static inline u8_t net_pkt_eof(struct net_pkt *pkt)
 {
@@ -383,7 +500,7 @@ static inline void net_pkt_set_eof(struct net_pkt *pkt, bool eof)
 }
 #endif
 
-#if defined(CONFIG_NET_ROUTE)
+#if defined(CONFIG_NET_ROUTE) || defined(CONFIG_NET_IPV4_FORWARDING)
 static inline bool net_pkt_forwarding(struct net_pkt *pkt)
 {
 	return pkt->forwarding;
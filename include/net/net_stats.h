@@ -202,6 +202,26 @@ struct net_stats_ipv6_mld {
 	net_stats_t drop;
 };
 
+/**
+ * @brief Neighbor cache statistics, used for both the ARP cache and the
+ * IPv6 neighbor cache
+ */
+struct net_stats_nbr_cache {
+	/** Number of lookups that found a resolved entry */
+	net_stats_t hit;
+
+	/** Number of lookups that did not find a resolved entry */
+	net_stats_t miss;
+
+	/** Number of entries replaced because the cache was full */
+	net_stats_t evict;
+
+	/** Number of entries removed because they were too old or the
+	 * neighbor did not answer anymore
+	 */
+	net_stats_t expire;
+};
+
 /**
  * @brief Network packet transfer times for calculating average TX time
  */
@@ -300,6 +320,16 @@ struct net_stats {
 	struct net_stats_ipv6_mld ipv6_mld;
 #endif
 
+#if defined(CONFIG_NET_STATISTICS_IPV6_NBR_CACHE)
+	/** IPv6 neighbor cache statistics */
+	struct net_stats_nbr_cache ipv6_nbr;
+#endif
+
+#if defined(CONFIG_NET_STATISTICS_ARP)
+	/** ARP cache statistics */
+	struct net_stats_nbr_cache arp;
+#endif
+
 #if NET_TC_COUNT > 1
 	/** Traffic class statistics */
 	struct net_stats_tc tc;
@@ -427,6 +457,62 @@ struct net_stats_ppp {
 	net_stats_t chkerr;
 };
 
+#if defined(CONFIG_NET_STATISTICS_PKT_POOLS)
+/**
+ * @brief Usage of a network packet or buffer pool
+ */
+struct net_stats_pool {
+	/** Largest number of items in use at the same time */
+	net_stats_t max_used;
+
+	/** Number of allocations that failed */
+	net_stats_t alloc_failed;
+};
+
+/**
+ * @brief Failed allocations from one calling site
+ */
+struct net_stats_pool_site {
+	/** Address the allocation function was called from */
+	void *caller;
+
+	/** Number of allocations that failed */
+	net_stats_t alloc_failed;
+};
+
+/**
+ * @brief Network packet and buffer pool statistics.
+ *
+ * These are global, the pools are shared by all the network interfaces.
+ */
+struct net_stats_pkt_pools {
+	/** RX packet pool */
+	struct net_stats_pool rx_pkts;
+
+	/** TX packet pool */
+	struct net_stats_pool tx_pkts;
+
+	/** RX data buffer pool */
+	struct net_stats_pool rx_bufs;
+
+	/** TX data buffer pool */
+	struct net_stats_pool tx_bufs;
+
+	/** Number of received packets dropped because their context held
+	 * its quota of RX buffers already.
+	 */
+	net_stats_t rcvbuf_drop;
+
+	/** Number of received packets dropped to keep the reserved RX
+	 * buffers for TCP and control traffic.
+	 */
+	net_stats_t reserve_drop;
+
+	/** Sites that allocations failed at, unused ones have no caller */
+	struct net_stats_pool_site sites[CONFIG_NET_STATISTICS_PKT_POOLS_SITES];
+};
+#endif /* CONFIG_NET_STATISTICS_PKT_POOLS */
+
 #if defined(CONFIG_NET_STATISTICS_USER_API)
 /* Management part definitions */
 
@@ -448,7 +534,8 @@ enum net_request_stats_cmd {
 	NET_REQUEST_STATS_CMD_GET_TCP,
 	NET_REQUEST_STATS_CMD_GET_ETHERNET,
 	NET_REQUEST_STATS_CMD_GET_PPP,
-	NET_REQUEST_STATS_CMD_GET_PM
+	NET_REQUEST_STATS_CMD_GET_PM,
+	NET_REQUEST_STATS_CMD_GET_PKT_POOLS,
 };
 
 #define NET_REQUEST_STATS_GET_ALL				\
@@ -527,6 +614,13 @@ NET_MGMT_DEFINE_REQUEST_HANDLER(NET_REQUEST_STATS_GET_ETHERNET);
 NET_MGMT_DEFINE_REQUEST_HANDLER(NET_REQUEST_STATS_GET_PPP);
 #endif /* CONFIG_NET_STATISTICS_PPP */
 
+#if defined(CONFIG_NET_STATISTICS_PKT_POOLS)
+#define NET_REQUEST_STATS_GET_PKT_POOLS				\
+	(_NET_STATS_BASE | NET_REQUEST_STATS_CMD_GET_PKT_POOLS)
+
+NET_MGMT_DEFINE_REQUEST_HANDLER(NET_REQUEST_STATS_GET_PKT_POOLS);
+#endif /* CONFIG_NET_STATISTICS_PKT_POOLS */
+
 #endif /* CONFIG_NET_STATISTICS_USER_API */
 
 #if defined(CONFIG_NET_STATISTICS_POWER_MANAGEMENT)
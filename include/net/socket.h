@@ -119,6 +119,39 @@ struct zsock_pollfd {
  *    - 1 - server
  */
 #define TLS_DTLS_ROLE 6
+/** Socket option to enable TLS session resumption. This option accepts and
+ *  returns an integer:
+ *    - 0 - disabled
+ *    - 1 - enabled
+ *
+ *  When enabled on a client socket, the session negotiated with a peer is
+ *  stored after the handshake, and a later connection to the same peer
+ *  address, with the same TLS_HOSTNAME and TLS_SEC_TAG_LIST, resumes it
+ *  (with a session ID or a session ticket) instead of doing a full
+ *  handshake. When enabled on a listening socket, the accepted
+ *  sockets keep the sessions in a server side cache, and issue session
+ *  tickets if supported by mbedTLS. Must be set before connect() or
+ *  listen(). By default, sessions are not resumed.
+ */
+#define TLS_SESSION_CACHE 7
+/** Write-only socket option to remove all the stored TLS client sessions,
+ *  for example when the credentials have changed. The option value is
+ *  ignored.
+ */
+#define TLS_SESSION_CACHE_PURGE 8
+/** Read-only socket option to read the peak amount of mbedTLS heap memory,
+ *  in bytes, that the last TLS handshake of the socket allocated on top of
+ *  what was in use when it started. It returns an integer. Handshakes that
+ *  run at the same time are included in the value. Requires mbedTLS to be
+ *  built with MBEDTLS_MEMORY_BUFFER_ALLOC_C and MBEDTLS_MEMORY_DEBUG.
+ */
+#define TLS_HANDSHAKE_MEM_PEAK 9
+/** Read-only socket option to tell whether the last TLS handshake of a
+ *  client socket with TLS_SESSION_CACHE enabled resumed a stored session.
+ *  It returns an integer, 1 for a resumed session and 0 for a full
+ *  handshake.
+ */
+#define TLS_SESSION_RESUMED 10
 
 /** @} */
 
@@ -131,6 +164,82 @@ struct zsock_pollfd {
 #define TLS_DTLS_ROLE_CLIENT 0 /**< Client role in a DTLS session. */
 #define TLS_DTLS_ROLE_SERVER 1 /**< Server role in a DTLS session. */
 
+/* Valid values for TLS_SESSION_CACHE option */
+#define TLS_SESSION_CACHE_DISABLED 0 /**< Disable TLS session caching. */
+#define TLS_SESSION_CACHE_ENABLED 1 /**< Enable TLS session caching. */
+
+struct net_buf;
+
+/**
+ * @brief Zero-copy receive buffer descriptor
+ *
+ * Filled in by zsock_recvfrom_zc(). The payload starts @a offset bytes
+ * into the data of the first fragment and continues over the following
+ * fragments for a total of @a len bytes. The fragments are read-only and
+ * must be given back by zsock_zc_release() when no longer needed.
+ */
+struct zsock_zc_buf {
+	/** First fragment holding payload data */
+	const struct net_buf *frags;
+	/** Offset of the payload in the first fragment */
+	size_t offset;
+	/** Total length of the payload */
+	size_t len;
+
+	/** @cond INTERNAL_HIDDEN */
+	void *pkt;
+	/** @endcond */
+};
+
+/**
+ * @typedef zsock_zc_sent_cb_t
+ * @brief Callback called when the stack no longer references a buffer
+ *        given to zsock_sendto_zc().
+ *
+ * @param buf Application buffer that can now be reused.
+ * @param len Length of the buffer.
+ * @param user_data User data given to zsock_sendto_zc().
+ */
+typedef void (*zsock_zc_sent_cb_t)(const void *buf, size_t len,
+				   void *user_data);
+
+/* ZSOCK_EPOLL* values are compatible with Linux */
+/** zsock_epoll_ctl: Register a socket */
+#define ZSOCK_EPOLL_CTL_ADD 1
+/** zsock_epoll_ctl: Unregister a socket */
+#define ZSOCK_EPOLL_CTL_DEL 2
+/** zsock_epoll_ctl: Change the events of a registered socket */
+#define ZSOCK_EPOLL_CTL_MOD 3
+
+/** zsock_epoll: Socket is readable */
+#define ZSOCK_EPOLLIN 0x001
+/** zsock_epoll: Socket is writable */
+#define ZSOCK_EPOLLOUT 0x004
+/** zsock_epoll: Error condition (output value only) */
+#define ZSOCK_EPOLLERR 0x008
+/** zsock_epoll: Connection closed by the peer (output value only) */
+#define ZSOCK_EPOLLHUP 0x010
+/** zsock_epoll: Disable the socket after reporting it once */
+#define ZSOCK_EPOLLONESHOT (1U << 30)
+/** zsock_epoll: Report the socket only when new data arrives */
+#define ZSOCK_EPOLLET (1U << 31)
+
+/** User data returned with the events of a socket */
+union zsock_epoll_data {
+	void *ptr;
+	int fd;
+	u32_t u32;
+	u64_t u64;
+};
+
+/** Events of a socket registered with zsock_epoll_ctl() */
+struct zsock_epoll_event {
+	/** ZSOCK_EPOLL* events wanted (input) or ready (output) */
+	u32_t events;
+	/** User data */
+	union zsock_epoll_data data;
+};
+
 struct zsock_addrinfo {
 	struct zsock_addrinfo *ai_next;
 	int ai_flags;
@@ -328,6 +437,80 @@ static inline ssize_t zsock_recv(int sock, void *buf, size_t max_len,
 	return zsock_recvfrom(sock, buf, max_len, flags, NULL, NULL);
 }
 
+/**
+ * @brief Receive data without copying it into an application buffer
+ *
+ * @details
+ * Dequeue the next packet (for stream sockets, the remaining data of the
+ * next received segment) and lend its network buffers to the caller
+ * through @a zc. Only native sockets are supported, for other sockets
+ * (e.g. TLS or offloaded sockets) -1 is returned and errno is set to
+ * EOPNOTSUPP. The buffers stay owned by the caller until
+ * zsock_zc_release() is called, so they should be released quickly to
+ * not exhaust the network buffer pools.
+ * Available if :option:`CONFIG_NET_SOCKETS_ZEROCOPY` is enabled. This
+ * function cannot be called from user mode.
+ *
+ * @param sock Socket descriptor.
+ * @param zc Descriptor filled with the payload location.
+ * @param flags ZSOCK_MSG_DONTWAIT and ZSOCK_MSG_PEEK are supported.
+ * @param src_addr Optional source address of the data (datagram sockets).
+ * @param addrlen Value-result length of @a src_addr.
+ *
+ * @return Length of the payload, 0 on end of stream, -1 on error with
+ *         errno set.
+ */
+ssize_t zsock_recvfrom_zc(int sock, struct zsock_zc_buf *zc, int flags,
+			  struct sockaddr *src_addr, socklen_t *addrlen);
+
+/**
+ * @brief Receive data from a connected peer without copying
+ *
+ * @details
+ * See zsock_recvfrom_zc().
+ */
+static inline ssize_t zsock_recv_zc(int sock, struct zsock_zc_buf *zc,
+				    int flags)
+{
+	return zsock_recvfrom_zc(sock, zc, flags, NULL, NULL);
+}
+
+/**
+ * @brief Give back buffers lent by zsock_recvfrom_zc()
+ *
+ * @param zc Descriptor filled by zsock_recvfrom_zc().
+ */
+void zsock_zc_release(struct zsock_zc_buf *zc);
+
+/**
+ * @brief Send data without copying it into the network stack
+ *
+ * @details
+ * The application buffer is referenced directly by the network packet
+ * instead of being copied. The buffer must not be modified or freed until
+ * @a cb is called, which happens exactly once when the stack drops its
+ * last reference to it: after the datagram was transmitted, after TCP
+ * received the acknowledgment covering it, or on error. The data must fit
+ * into a single packet, otherwise -1 is returned and errno is set to
+ * EMSGSIZE.
+ * Available if :option:`CONFIG_NET_SOCKETS_ZEROCOPY` is enabled. This
+ * function cannot be called from user mode.
+ *
+ * @param sock Socket descriptor.
+ * @param buf Data to send.
+ * @param len Length of the data.
+ * @param flags ZSOCK_MSG_DONTWAIT is supported.
+ * @param dest_addr Destination address, NULL for connected sockets.
+ * @param addrlen Length of @a dest_addr.
+ * @param cb Callback telling when @a buf can be reused.
+ * @param user_data User data passed to @a cb.
+ *
+ * @return Number of bytes sent, -1 on error with errno set.
+ */
+ssize_t zsock_sendto_zc(int sock, const void *buf, size_t len, int flags,
+			const struct sockaddr *dest_addr, socklen_t addrlen,
+			zsock_zc_sent_cb_t cb, void *user_data);
+
 /**
  * @brief Control blocking/non-blocking mode of a socket
  *
@@ -358,6 +541,73 @@ __syscall int zsock_fcntl(int sock, int cmd, int flags);
  */
 __syscall int zsock_poll(struct zsock_pollfd *fds, int nfds, int timeout);
 
+/**
+ * @brief Create an event set for sockets
+ *
+ * @details
+ * Unlike zsock_poll(), which walks over all the given sockets on every
+ * call, the sockets are registered once with zsock_epoll_ctl() and are
+ * put on a ready list by the network stack when data or a connection
+ * arrives, so zsock_epoll_wait() only looks at the sockets with events.
+ * Only native sockets can be registered. The returned descriptor is
+ * freed with zsock_close().
+ * Available if :option:`CONFIG_NET_SOCKETS_EPOLL` is enabled. This
+ * function cannot be called from user mode.
+ * This function is also exposed as ``epoll_create()``
+ * if :option:`CONFIG_NET_SOCKETS_POSIX_NAMES` is defined.
+ *
+ * @param size Ignored, but must be greater than zero (as in Linux).
+ *
+ * @return Event set descriptor, -1 on error with errno set.
+ */
+int zsock_epoll_create(int size);
+
+/**
+ * @brief Register, change or unregister a socket in an event set
+ *
+ * @details
+ * Sockets are level-triggered by default: they are reported by every
+ * zsock_epoll_wait() call as long as they are ready. With
+ * ZSOCK_EPOLLET a socket is reported once each time data or a connection
+ * arrives, and with ZSOCK_EPOLLONESHOT it is reported once and then
+ * disabled until changed with ZSOCK_EPOLL_CTL_MOD. As with zsock_poll(),
+ * sockets are always writable. A closed socket is unregistered from all
+ * the event sets.
+ * Available if :option:`CONFIG_NET_SOCKETS_EPOLL` is enabled. This
+ * function cannot be called from user mode.
+ * This function is also exposed as ``epoll_ctl()``
+ * if :option:`CONFIG_NET_SOCKETS_POSIX_NAMES` is defined.
+ *
+ * @param epfd Event set descriptor.
+ * @param op ZSOCK_EPOLL_CTL_ADD, ZSOCK_EPOLL_CTL_MOD or ZSOCK_EPOLL_CTL_DEL.
+ * @param fd Socket descriptor.
+ * @param event Events and user data, ignored for ZSOCK_EPOLL_CTL_DEL.
+ *
+ * @return 0 if ok, -1 on error with errno set.
+ */
+int zsock_epoll_ctl(int epfd, int op, int fd,
+		    struct zsock_epoll_event *event);
+
+/**
+ * @brief Wait for events on the sockets of an event set
+ *
+ * @details
+ * Available if :option:`CONFIG_NET_SOCKETS_EPOLL` is enabled. This
+ * function cannot be called from user mode.
+ * This function is also exposed as ``epoll_wait()``
+ * if :option:`CONFIG_NET_SOCKETS_POSIX_NAMES` is defined.
+ *
+ * @param epfd Event set descriptor.
+ * @param events Filled with the events of the ready sockets.
+ * @param maxevents Size of @a events.
+ * @param timeout Timeout in milliseconds, -1 to wait forever.
+ *
+ * @return Number of ready sockets, 0 on timeout, -1 on error with errno
+ *         set.
+ */
+int zsock_epoll_wait(int epfd, struct zsock_epoll_event *events,
+		     int maxevents, int timeout);
+
 /**
  * @brief Get various socket options
  *
@@ -634,6 +884,28 @@ static inline int poll(struct zsock_pollfd *fds, int nfds, int timeout)
 	return zsock_poll(fds, nfds, timeout);
 }
 
+#if defined(CONFIG_NET_SOCKETS_EPOLL)
+#define epoll_event zsock_epoll_event
+#define epoll_data zsock_epoll_data
+
+static inline int epoll_create(int size)
+{
+	return zsock_epoll_create(size);
+}
+
+static inline int epoll_ctl(int epfd, int op, int fd,
+			    struct zsock_epoll_event *event)
+{
+	return zsock_epoll_ctl(epfd, op, fd, event);
+}
+
+static inline int epoll_wait(int epfd, struct zsock_epoll_event *events,
+			     int maxevents, int timeout)
+{
+	return zsock_epoll_wait(epfd, events, maxevents, timeout);
+}
+#endif
+
 static inline int getsockopt(int sock, int level, int optname,
 			     void *optval, socklen_t *optlen)
 {
@@ -701,6 +973,16 @@ static inline char *inet_ntop(sa_family_t family, const void *src, char *dst,
 #define POLLHUP ZSOCK_POLLHUP
 #define POLLNVAL ZSOCK_POLLNVAL
 
+#define EPOLL_CTL_ADD ZSOCK_EPOLL_CTL_ADD
+#define EPOLL_CTL_DEL ZSOCK_EPOLL_CTL_DEL
+#define EPOLL_CTL_MOD ZSOCK_EPOLL_CTL_MOD
+#define EPOLLIN ZSOCK_EPOLLIN
+#define EPOLLOUT ZSOCK_EPOLLOUT
+#define EPOLLERR ZSOCK_EPOLLERR
+#define EPOLLHUP ZSOCK_EPOLLHUP
+#define EPOLLONESHOT ZSOCK_EPOLLONESHOT
+#define EPOLLET ZSOCK_EPOLLET
+
 #define MSG_PEEK ZSOCK_MSG_PEEK
 #define MSG_DONTWAIT ZSOCK_MSG_DONTWAIT
 
@@ -726,6 +1008,13 @@ static inline char *inet_ntop(sa_family_t family, const void *src, char *dst,
 #define SO_REUSEADDR 2
 /** sockopt: Async error (ignored, for compatibility) */
 #define SO_ERROR 4
+/** sockopt: Receive buffer size (bytes of RX buffers the socket can hold) */
+#define SO_RCVBUF 8
+
+/** sockopt: Attach a classic BPF filter (struct sock_fprog) */
+#define SO_ATTACH_FILTER 26
+/** sockopt: Detach the filter attached with SO_ATTACH_FILTER */
+#define SO_DETACH_FILTER 27
 
 /** sockopt: Timestamp TX packets */
 #define SO_TIMESTAMPING 37
@@ -126,6 +126,22 @@ struct websocket_request {
 int websocket_connect(int http_sock, struct websocket_request *req,
 		      s32_t timeout, void *user_data);
 
+/**
+ * @brief Turn a socket accepted by a server into a websocket. The HTTP
+ * upgrade handshake must have been done already, for example by the HTTP
+ * server library. The messages sent through the returned socket are not
+ * masked, as required for a server.
+ *
+ * @param sock Socket id of the connection, it must not be closed while the
+ *        websocket is used.
+ * @param recv_buf Temporary buffer for the websocket headers.
+ * @param recv_buf_len Length of the temporary buffer.
+ *
+ * @return Websocket id to be used when sending/receiving Websocket data,
+ *         <0 if error.
+ */
+int websocket_register(int sock, u8_t *recv_buf, size_t recv_buf_len);
+
 /**
  * @brief Send websocket msg to peer.
  *
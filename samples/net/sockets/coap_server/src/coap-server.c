@@ -963,12 +963,6 @@ end:
 	return r;
 }
 
-static int send_notification_packet(const struct sockaddr *addr,
-				    socklen_t addr_len,
-				    u16_t age, u16_t id,
-				    const u8_t *token, u8_t tkl,
-				    bool is_response);
-
 static void retransmit_request(struct k_work *work)
 {
 	struct coap_pending *pending;
@@ -981,21 +975,15 @@ static void retransmit_request(struct k_work *work)
 	if (!coap_pending_cycle(pending)) {
 		k_free(pending->data);
 		coap_pending_clear(pending);
-		return;
 	}
 
-	k_delayed_work_submit(&retransmit_work, pending->timeout);
-}
-
-static void update_counter(struct k_work *work)
-{
-	obs_counter++;
-
-	if (resource_to_notify) {
-		coap_resource_notify(resource_to_notify);
+	pending = coap_pending_next_to_expire(pendings, NUM_PENDINGS);
+	if (!pending) {
+		return;
 	}
 
-	k_delayed_work_submit(&observer_work, K_SECONDS(5));
+	k_delayed_work_submit(&retransmit_work,
+			      coap_pending_remaining(pending));
 }
 
 static int create_pending_request(struct coap_packet *response,
@@ -1021,97 +1009,152 @@ static int create_pending_request(struct coap_packet *response,
 		return 0;
 	}
 
-	k_delayed_work_submit(&retransmit_work, pending->timeout);
+	k_delayed_work_submit(&retransmit_work,
+			      coap_pending_remaining(pending));
 
 	return 0;
 }
 
-static int send_notification_packet(const struct sockaddr *addr,
-				    socklen_t addr_len,
-				    u16_t age, u16_t id,
-				    const u8_t *token, u8_t tkl,
-				    bool is_response)
+static int build_notification_packet(struct coap_packet *response,
+				     u8_t *data, u8_t type, u16_t age,
+				     u16_t id, const u8_t *token, u8_t tkl)
 {
-	struct coap_packet response;
 	char payload[14];
-	u8_t *data;
-	u8_t type;
 	int r;
 
-	if (is_response) {
-		type = COAP_TYPE_ACK;
-	} else {
-		type = COAP_TYPE_CON;
-	}
-
-	if (!is_response) {
-		id = coap_next_id();
-	}
-
-	data = (u8_t *)k_malloc(MAX_COAP_MSG_LEN);
-	if (!data) {
-		return -ENOMEM;
-	}
-
-	r = coap_packet_init(&response, data, MAX_COAP_MSG_LEN,
+	r = coap_packet_init(response, data, MAX_COAP_MSG_LEN,
 			     1, type, tkl, (u8_t *)token,
 			     COAP_RESPONSE_CODE_CONTENT, id);
 	if (r < 0) {
-		goto end;
+		return r;
 	}
 
 	if (age >= 2U) {
-		r = coap_append_option_int(&response, COAP_OPTION_OBSERVE, age);
+		r = coap_append_option_int(response, COAP_OPTION_OBSERVE, age);
 		if (r < 0) {
-			goto end;
+			return r;
 		}
 	}
 
-	r = coap_packet_append_option(&response, COAP_OPTION_CONTENT_FORMAT,
+	r = coap_packet_append_option(response, COAP_OPTION_CONTENT_FORMAT,
 				      &plain_text_format,
 				      sizeof(plain_text_format));
 	if (r < 0) {
-		goto end;
+		return r;
 	}
 
-	r = coap_packet_append_payload_marker(&response);
+	r = coap_packet_append_payload_marker(response);
 	if (r < 0) {
-		goto end;
+		return r;
 	}
 
 	/* The response that coap-client expects */
 	r = snprintk((char *) payload, sizeof(payload),
 		     "Counter: %d\n", obs_counter);
 	if (r < 0) {
-		goto end;
+		return r;
 	}
 
-	r = coap_packet_append_payload(&response, (u8_t *)payload,
-				       strlen(payload));
-	if (r < 0) {
-		goto end;
+	return coap_packet_append_payload(response, (u8_t *)payload,
+					  strlen(payload));
+}
+
+static int send_notification_packet(const struct sockaddr *addr,
+				    socklen_t addr_len,
+				    u16_t age, u16_t id,
+				    const u8_t *token, u8_t tkl)
+{
+	struct coap_packet response;
+	u8_t *data;
+	int r;
+
+	data = (u8_t *)k_malloc(MAX_COAP_MSG_LEN);
+	if (!data) {
+		return -ENOMEM;
 	}
 
-	if (type == COAP_TYPE_CON) {
-		r = create_pending_request(&response, addr);
-		if (r < 0) {
-			goto end;
-		}
+	r = build_notification_packet(&response, data, COAP_TYPE_ACK, age,
+				      id, token, tkl);
+	if (r < 0) {
+		goto end;
 	}
 
 	k_delayed_work_submit(&observer_work, K_SECONDS(5));
 
 	r = send_coap_reply(&response, addr, addr_len);
 
-	/* On succesfull creation of pending request, do not free memory */
-	if (type == COAP_TYPE_CON) {
+end:
+	k_free(data);
+
+	return r;
+}
+
+/* Each observer gets its own copy of the notification, kept by the pending
+ * request until it is acknowledged.
+ */
+static int obs_notify_send(struct coap_resource *resource,
+			   struct coap_observer *observer,
+			   const struct coap_packet *cpkt,
+			   void *user_data)
+{
+	struct coap_packet notification = *cpkt;
+	int r;
+
+	notification.data = (u8_t *)k_malloc(cpkt->max_len);
+	if (!notification.data) {
+		return -ENOMEM;
+	}
+
+	memcpy(notification.data, cpkt->data, cpkt->offset);
+
+	r = create_pending_request(&notification, &observer->addr);
+	if (r < 0) {
+		k_free(notification.data);
 		return r;
 	}
 
+	return send_coap_reply(&notification, &observer->addr,
+			       sizeof(observer->addr));
+}
+
+/* The notification is built once and sent to all the observers */
+static void update_counter(struct k_work *work)
+{
+	struct coap_packet notification;
+	u8_t *data;
+	int r;
+
+	obs_counter++;
+
+	if (!resource_to_notify) {
+		goto resubmit;
+	}
+
+	data = (u8_t *)k_malloc(MAX_COAP_MSG_LEN);
+	if (!data) {
+		goto resubmit;
+	}
+
+	resource_to_notify->age++;
+
+	r = build_notification_packet(&notification, data, COAP_TYPE_CON,
+				      resource_to_notify->age, 0, NULL, 0);
+	if (r < 0) {
+		LOG_ERR("Cannot build notification (%d)", r);
+		goto end;
+	}
+
+	r = coap_resource_notify_packet(resource_to_notify, &notification,
+					obs_notify_send, NULL);
+	if (r < 0) {
+		LOG_ERR("Cannot notify observers (%d)", r);
+	}
+
 end:
 	k_free(data);
 
-	return r;
+resubmit:
+	k_delayed_work_submit(&observer_work, K_SECONDS(5));
 }
 
 static int obs_get(struct coap_resource *resource,
@@ -1154,16 +1197,7 @@ done:
 
 	return send_notification_packet(addr, addr_len,
 					observe ? resource->age : 0,
-					id, token, tkl, true);
-}
-
-static void obs_notify(struct coap_resource *resource,
-		       struct coap_observer *observer)
-{
-	send_notification_packet(&observer->addr,
-				 sizeof(observer->addr),
-				 resource->age, 0,
-				 observer->token, observer->tkl, false);
+					id, token, tkl);
 }
 
 static int core_get(struct coap_resource *resource,
@@ -1278,7 +1312,6 @@ static struct coap_resource resources[] = {
 	},
 	{ .path = obs_path,
 	  .get = obs_get,
-	  .notify = obs_notify,
 	},
 	{ .get = core_get,
 	  .path = core_1_path,
@@ -159,6 +159,76 @@ const struct net_buf_data_cb net_buf_fixed_cb = {
 	.unref = fixed_data_unref,
 };
 
+static u8_t *slab_data_alloc(struct net_buf *buf, size_t *size,
+			     k_timeout_t timeout)
+{
+	struct net_buf_pool *pool = net_buf_pool_get(buf->pool_id);
+	const struct net_buf_pool_slab *slab = pool->alloc->alloc_data;
+	size_t block_size = NET_BUF_SLAB_HDR_SIZE + *size;
+	int best = -1;
+	u8_t *block;
+	int i;
+
+	/* Take the smallest class the data fits in, or a larger one if
+	 * that one has nothing left.
+	 */
+	for (i = 0; i < slab->count; i++) {
+		if (slab->slabs[i]->block_size < block_size) {
+			continue;
+		}
+
+		if (best < 0) {
+			best = i;
+		}
+
+		if (!k_mem_slab_alloc(slab->slabs[i], (void **)&block,
+				      K_NO_WAIT)) {
+			goto found;
+		}
+	}
+
+	if (best < 0 || K_TIMEOUT_EQ(timeout, K_NO_WAIT)) {
+		return NULL;
+	}
+
+	if (k_mem_slab_alloc(slab->slabs[best], (void **)&block, timeout)) {
+		return NULL;
+	}
+
+	i = best;
+
+found:
+	/* Class index and ref count are right before the data */
+	block[NET_BUF_SLAB_HDR_SIZE - 2] = i;
+	block[NET_BUF_SLAB_HDR_SIZE - 1] = 1U;
+
+	*size = slab->slabs[i]->block_size - NET_BUF_SLAB_HDR_SIZE;
+
+	return block + NET_BUF_SLAB_HDR_SIZE;
+}
+
+static void slab_data_unref(struct net_buf *buf, u8_t *data)
+{
+	struct net_buf_pool *pool = net_buf_pool_get(buf->pool_id);
+	const struct net_buf_pool_slab *slab = pool->alloc->alloc_data;
+	u8_t *ref_count;
+	void *block;
+
+	ref_count = data - 1;
+	if (--(*ref_count)) {
+		return;
+	}
+
+	block = data - NET_BUF_SLAB_HDR_SIZE;
+	k_mem_slab_free(slab->slabs[*(data - 2)], &block);
+}
+
+const struct net_buf_data_cb net_buf_slab_cb = {
+	.alloc = slab_data_alloc,
+	.ref   = generic_data_ref,
+	.unref = slab_data_unref,
+};
+
 #if (CONFIG_HEAP_MEM_POOL_SIZE > 0)
 
 static u8_t *heap_data_alloc(struct net_buf *buf, size_t *size,
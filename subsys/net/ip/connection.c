@@ -405,6 +405,26 @@ int net_conn_change_callback(struct net_conn_handle *handle,
 	return 0;
 }
 
+#if defined(CONFIG_NET_BPF)
+int net_conn_set_filter(struct net_conn_handle *handle,
+			struct net_bpf_filter *filter)
+{
+	struct net_conn *conn = (struct net_conn *)handle;
+
+	if (conn < &conns[0] || conn > &conns[CONFIG_NET_MAX_CONN]) {
+		return -EINVAL;
+	}
+
+	if (!(conn->flags & NET_CONN_IN_USE)) {
+		return -ENOENT;
+	}
+
+	net_bpf_sock_filter_set(&conn->filter, filter);
+
+	return 0;
+}
+#endif /* CONFIG_NET_BPF */
+
 static bool conn_addr_cmp(struct net_pkt *pkt,
 			  union net_ip_header *ip_hdr,
 			  struct sockaddr *addr,
@@ -659,6 +679,12 @@ enum net_verdict net_conn_input(struct net_pkt *pkt,
 			}
 		} else if (IS_ENABLED(CONFIG_NET_SOCKETS_PACKET) ||
 			   IS_ENABLED(CONFIG_NET_SOCKETS_CAN)) {
+#if defined(CONFIG_NET_BPF)
+			if (!net_bpf_sock_filter_match(&conn->filter, pkt)) {
+				continue;
+			}
+#endif
+
 			best_rank = 0;
 			best_match = conn;
 		}
@@ -29,6 +29,8 @@ struct net_conn;
 
 struct net_conn_handle;
 
+struct net_bpf_filter;
+
 /**
  * @brief Function that is called by connection subsystem when UDP/TCP
  * packet is received and which matches local and remote IP address
@@ -62,6 +64,11 @@ struct net_conn {
 	/** Possible user to pass to the callback */
 	void *user_data;
 
+#if defined(CONFIG_NET_BPF)
+	/** Packet filter of a packet socket */
+	struct net_bpf_filter *filter;
+#endif
+
 	/** Connection protocol */
 	u16_t proto;
 
@@ -152,6 +159,29 @@ static inline int net_conn_unregister(struct net_conn_handle *handle)
 int net_conn_change_callback(struct net_conn_handle *handle,
 			     net_conn_cb_t cb, void *user_data);
 
+/**
+ * @brief Set the packet filter of a connection. Only packet socket
+ * connections use it.
+ *
+ * @param handle A handle registered with net_conn_register()
+ * @param filter Checked filter, or NULL to remove the filter.
+ *
+ * @return Return 0 if the the change succeed, <0 otherwise.
+ */
+#if defined(CONFIG_NET_BPF)
+int net_conn_set_filter(struct net_conn_handle *handle,
+			struct net_bpf_filter *filter);
+#else
+static inline int net_conn_set_filter(struct net_conn_handle *handle,
+				      struct net_bpf_filter *filter)
+{
+	ARG_UNUSED(handle);
+	ARG_UNUSED(filter);
+
+	return -ENOTSUP;
+}
+#endif
+
 /**
  * @brief Called by net_core.c when a network packet is received.
  *
@@ -572,6 +572,7 @@ drop:
 int net_icmpv4_send_error(struct net_pkt *orig, u8_t type, u8_t code)
 {
 	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	const struct in_addr *src;
 	int err = -EIO;
 	struct net_ipv4_hdr *ip_hdr;
 	struct net_pkt *pkt;
@@ -617,7 +618,17 @@ int net_icmpv4_send_error(struct net_pkt *orig, u8_t type, u8_t code)
 		goto drop_no_pkt;
 	}
 
-	if (net_ipv4_create(pkt, &ip_hdr->dst, &ip_hdr->src) ||
+	/* A packet that was being forwarded is not addressed to us, so
+	 * reply from our own address on the interface it came from.
+	 */
+	if (net_ipv4_is_my_addr(&ip_hdr->dst)) {
+		src = &ip_hdr->dst;
+	} else {
+		src = net_if_ipv4_select_src_addr(net_pkt_iface(orig),
+						  &ip_hdr->src);
+	}
+
+	if (net_ipv4_create(pkt, src, &ip_hdr->src) ||
 	    icmpv4_create(pkt, type, code) ||
 	    net_pkt_memset(pkt, 0, NET_ICMPV4_UNUSED_LEN) ||
 	    net_pkt_copy(pkt, orig, copy_len)) {
@@ -0,0 +1,561 @@
+/** @file
+ * @brief IP fragment reassembly and fragmentation helpers
+ *
+ * The fragments of a datagram are kept in a list sorted by offset. As
+ * fragments normally arrive in order, a new fragment is compared to the
+ * last one first and appended in constant time. The fragment descriptors
+ * come from a common pool, so that the memory held by pending
+ * reassemblies is bounded for both IPv4 and IPv6.
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_ip_frag, CONFIG_NET_IP_FRAGMENT_LOG_LEVEL);
+
+#include <zephyr.h>
+#include <errno.h>
+#include <sys/slist.h>
+
+#include <net/net_core.h>
+#include <net/net_pkt.h>
+#include <net/net_ip.h>
+
+#include "net_private.h"
+#include "ip_fragment.h"
+
+#if defined(CONFIG_NET_IPV6_FRAGMENT)
+#define IPV6_REASSEMBLY_COUNT CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT
+#define IPV6_REASSEMBLY_TIMEOUT K_SECONDS(CONFIG_NET_IPV6_FRAGMENT_TIMEOUT)
+#else
+#define IPV6_REASSEMBLY_COUNT 0
+#define IPV6_REASSEMBLY_TIMEOUT K_NO_WAIT
+#endif
+
+#if defined(CONFIG_NET_IPV4_FRAGMENT)
+#define IPV4_REASSEMBLY_COUNT CONFIG_NET_IPV4_FRAGMENT_MAX_COUNT
+#define IPV4_REASSEMBLY_TIMEOUT K_SECONDS(CONFIG_NET_IPV4_FRAGMENT_TIMEOUT)
+#else
+#define IPV4_REASSEMBLY_COUNT 0
+#define IPV4_REASSEMBLY_TIMEOUT K_NO_WAIT
+#endif
+
+/* Largest payload of a reassembled datagram */
+#define IP_FRAG_MAX_LEN 0xffff
+
+/* How long to wait for a buffer when the payload must be copied */
+#define FRAG_BUF_TIMEOUT K_MSEC(100)
+
+static struct net_ip_reassembly
+reassembly[IPV6_REASSEMBLY_COUNT + IPV4_REASSEMBLY_COUNT];
+
+static struct net_ip_frag frags[CONFIG_NET_IP_FRAGMENT_MAX_PKT];
+static sys_slist_t free_frags;
+static bool reassembly_init_done;
+
+static K_MUTEX_DEFINE(reassembly_lock);
+
+static void reassembly_timeout(struct k_work *work);
+
+static void reassembly_init(void)
+{
+	int i;
+
+	if (reassembly_init_done) {
+		return;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(reassembly); i++) {
+		k_delayed_work_init(&reassembly[i].timer, reassembly_timeout);
+		sys_slist_init(&reassembly[i].frags);
+	}
+
+	sys_slist_init(&free_frags);
+
+	for (i = 0; i < ARRAY_SIZE(frags); i++) {
+		sys_slist_append(&free_frags, &frags[i].node);
+	}
+
+	reassembly_init_done = true;
+}
+
+static size_t addr_len(u8_t family)
+{
+	return family == AF_INET6 ? sizeof(struct in6_addr) :
+		sizeof(struct in_addr);
+}
+
+static void reassembly_release(struct net_ip_reassembly *reass)
+{
+	struct net_ip_frag *frag;
+	sys_snode_t *node;
+
+	NET_DBG("Release %s reassembly id 0x%x, %u fragments",
+		reass->family == AF_INET6 ? "IPv6" : "IPv4", reass->id,
+		reass->count);
+
+	k_delayed_work_cancel(&reass->timer);
+
+	while ((node = sys_slist_get(&reass->frags))) {
+		frag = CONTAINER_OF(node, struct net_ip_frag, node);
+
+		if (frag->pkt) {
+			net_pkt_unref(frag->pkt);
+			frag->pkt = NULL;
+		}
+
+		sys_slist_append(&free_frags, &frag->node);
+	}
+
+	reass->family = AF_UNSPEC;
+	reass->received = 0U;
+	reass->total_len = 0U;
+	reass->count = 0U;
+}
+
+static void reassembly_timeout(struct k_work *work)
+{
+	struct net_ip_reassembly *reass =
+		CONTAINER_OF(work, struct net_ip_reassembly, timer);
+
+	k_mutex_lock(&reassembly_lock, K_FOREVER);
+
+	/* The reassembly might have been completed, or the slot reused,
+	 * while we were waiting for the lock.
+	 */
+	if (reass->family != AF_UNSPEC &&
+	    !k_delayed_work_remaining_get(&reass->timer)) {
+		NET_DBG("Reassembly id 0x%x timed out", reass->id);
+		reassembly_release(reass);
+	}
+
+	k_mutex_unlock(&reassembly_lock);
+}
+
+static struct net_ip_reassembly *reassembly_get(
+					const struct net_ip_frag_info *info)
+{
+	struct net_ip_reassembly *avail = NULL;
+	size_t len = addr_len(info->family);
+	int i, used = 0, max;
+
+	for (i = 0; i < ARRAY_SIZE(reassembly); i++) {
+		struct net_ip_reassembly *reass = &reassembly[i];
+
+		if (reass->family == AF_UNSPEC) {
+			if (!avail) {
+				avail = reass;
+			}
+
+			continue;
+		}
+
+		if (reass->family != info->family) {
+			continue;
+		}
+
+		if (reass->id == info->id && reass->proto == info->proto &&
+		    !memcmp(&reass->src, info->src, len) &&
+		    !memcmp(&reass->dst, info->dst, len)) {
+			return reass;
+		}
+
+		used++;
+	}
+
+	max = info->family == AF_INET6 ? IPV6_REASSEMBLY_COUNT :
+		IPV4_REASSEMBLY_COUNT;
+	if (!avail || used >= max) {
+		return NULL;
+	}
+
+	memcpy(&avail->src, info->src, len);
+	memcpy(&avail->dst, info->dst, len);
+	avail->id = info->id;
+	avail->proto = info->proto;
+	avail->family = info->family;
+
+	k_delayed_work_submit(&avail->timer,
+			      info->family == AF_INET6 ?
+			      IPV6_REASSEMBLY_TIMEOUT :
+			      IPV4_REASSEMBLY_TIMEOUT);
+
+	return avail;
+}
+
+/* Insert the fragment at its place in the sorted list. Returns -EALREADY
+ * for a duplicate of a received fragment and -EINVAL if the fragment
+ * does not fit with the received ones.
+ */
+static int frag_insert(struct net_ip_reassembly *reass,
+		       struct net_ip_frag *frag, bool more)
+{
+	u32_t end = frag->offset + frag->len;
+	struct net_ip_frag *cur, *prev = NULL;
+	u32_t tail_end = 0U;
+
+	cur = SYS_SLIST_PEEK_TAIL_CONTAINER(&reass->frags, cur, node);
+	if (cur) {
+		tail_end = cur->offset + cur->len;
+	}
+
+	if (cur && cur->offset == frag->offset && cur->len == frag->len) {
+		return -EALREADY;
+	}
+
+	if (reass->total_len && end > reass->total_len) {
+		return -EINVAL;
+	}
+
+	if (!more && (tail_end > end ||
+		      (reass->total_len && reass->total_len != end))) {
+		return -EINVAL;
+	}
+
+	if (frag->offset >= tail_end) {
+		sys_slist_append(&reass->frags, &frag->node);
+		return 0;
+	}
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&reass->frags, cur, node) {
+		if (cur->offset == frag->offset && cur->len == frag->len) {
+			return -EALREADY;
+		}
+
+		if (cur->offset >= end) {
+			break;
+		}
+
+		if (cur->offset + cur->len > frag->offset) {
+			return -EINVAL;
+		}
+
+		prev = cur;
+	}
+
+	sys_slist_insert(&reass->frags, prev ? &prev->node : NULL,
+			 &frag->node);
+
+	return 0;
+}
+
+/* Drop the headers of a fragment without moving its payload */
+static int frag_pull_headers(struct net_pkt *pkt, u16_t len)
+{
+	struct net_buf *buf;
+
+	for (buf = pkt->buffer; buf && len; buf = buf->frags) {
+		u16_t rem = MIN(len, buf->len);
+
+		net_buf_pull(buf, rem);
+		len -= rem;
+	}
+
+	return len ? -ENOBUFS : 0;
+}
+
+/* Chain the payload of all the fragments after the first one */
+static struct net_pkt *reassembly_join(struct net_ip_reassembly *reass)
+{
+	struct net_ip_frag *frag, *first;
+	struct net_buf *last;
+	struct net_pkt *pkt;
+	sys_snode_t *node;
+
+	first = SYS_SLIST_PEEK_HEAD_CONTAINER(&reass->frags, first, node);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&reass->frags, frag, node) {
+		if (frag != first &&
+		    frag_pull_headers(frag->pkt, frag->hdr_len)) {
+			NET_ERR("Failed to pull headers");
+			reassembly_release(reass);
+			return NULL;
+		}
+	}
+
+	pkt = first->pkt;
+	first->pkt = NULL;
+
+	last = net_buf_frag_last(pkt->buffer);
+
+	while ((node = sys_slist_get(&reass->frags))) {
+		frag = CONTAINER_OF(node, struct net_ip_frag, node);
+
+		if (frag->pkt) {
+			last->frags = frag->pkt->buffer;
+			last = net_buf_frag_last(frag->pkt->buffer);
+
+			frag->pkt->buffer = NULL;
+			net_pkt_unref(frag->pkt);
+			frag->pkt = NULL;
+		}
+
+		sys_slist_append(&free_frags, &frag->node);
+	}
+
+	NET_DBG("Reassembled id 0x%x, %u fragments, %u bytes", reass->id,
+		reass->count, reass->total_len);
+
+	reassembly_release(reass);
+
+	net_pkt_set_ip_reassembled(pkt, true);
+	net_pkt_cursor_init(pkt);
+
+	return pkt;
+}
+
+enum net_verdict net_ip_reassembly_add(const struct net_ip_frag_info *info,
+				       struct net_pkt *pkt,
+				       struct net_pkt **reassembled)
+{
+	enum net_verdict verdict = NET_DROP;
+	struct net_ip_reassembly *reass;
+	struct net_ip_frag *frag;
+	size_t pkt_len;
+	sys_snode_t *node;
+	u32_t len;
+	int ret;
+
+	*reassembled = NULL;
+
+	pkt_len = net_pkt_get_len(pkt);
+	if (pkt_len < info->hdr_len) {
+		return NET_DROP;
+	}
+
+	len = pkt_len - info->hdr_len;
+
+	/* All fragments but the last one carry a multiple of 8 bytes */
+	if ((info->more && (!len || len % 8)) ||
+	    info->offset + len > IP_FRAG_MAX_LEN) {
+		NET_DBG("Invalid fragment offset %u len %u", info->offset,
+			len);
+		return NET_DROP;
+	}
+
+	k_mutex_lock(&reassembly_lock, K_FOREVER);
+
+	reassembly_init();
+
+	reass = reassembly_get(info);
+	if (!reass) {
+		NET_DBG("Cannot get reassembly slot, dropping pkt %p", pkt);
+		goto out;
+	}
+
+	node = sys_slist_get(&free_frags);
+	if (!node) {
+		NET_DBG("No free fragment, dropping pkt %p", pkt);
+
+		if (!reass->count) {
+			reassembly_release(reass);
+		}
+
+		goto out;
+	}
+
+	frag = CONTAINER_OF(node, struct net_ip_frag, node);
+	frag->offset = info->offset;
+	frag->len = len;
+	frag->hdr_len = info->hdr_len;
+	frag->pkt = NULL;
+
+	ret = frag_insert(reass, frag, info->more);
+	if (ret < 0) {
+		sys_slist_append(&free_frags, &frag->node);
+
+		if (ret == -EALREADY) {
+			NET_DBG("Duplicate fragment offset %u", info->offset);
+		} else {
+			NET_DBG("Overlapping fragment offset %u, dropping "
+				"id 0x%x", info->offset, reass->id);
+			reassembly_release(reass);
+		}
+
+		goto out;
+	}
+
+	frag->pkt = pkt;
+
+	reass->received += len;
+	reass->count++;
+
+	if (!info->more) {
+		reass->total_len = frag->offset + len;
+	}
+
+	NET_DBG("Stored pkt %p id 0x%x offset %u len %u (%u/%u)", pkt,
+		reass->id, frag->offset, len, reass->received,
+		reass->total_len);
+
+	/* There are no overlaps, so once the last fragment has been
+	 * received, all the bytes are there when their count matches.
+	 */
+	if (reass->total_len && reass->received == reass->total_len) {
+		*reassembled = reassembly_join(reass);
+	}
+
+	verdict = NET_OK;
+
+out:
+	k_mutex_unlock(&reassembly_lock);
+
+	return verdict;
+}
+
+void net_ip_frag_foreach(net_ip_frag_cb_t cb, void *user_data)
+{
+	int i;
+
+	k_mutex_lock(&reassembly_lock, K_FOREVER);
+
+	for (i = 0; reassembly_init_done && i < ARRAY_SIZE(reassembly);
+	     i++) {
+		if (reassembly[i].family == AF_UNSPEC) {
+			continue;
+		}
+
+		cb(&reassembly[i], user_data);
+	}
+
+	k_mutex_unlock(&reassembly_lock);
+}
+
+#if CONFIG_NET_IP_FRAGMENT_TX_BUFS > 0
+/* Buffer of the original packet referenced by each fragment buffer */
+static struct net_buf *frag_tx_orig[CONFIG_NET_IP_FRAGMENT_TX_BUFS];
+
+static void frag_tx_destroy(struct net_buf *buf);
+
+NET_BUF_POOL_DEFINE(frag_tx_pool, CONFIG_NET_IP_FRAGMENT_TX_BUFS,
+		    0, 0, frag_tx_destroy);
+
+static void frag_tx_destroy(struct net_buf *buf)
+{
+	struct net_buf *orig = frag_tx_orig[net_buf_id(buf)];
+
+	net_buf_destroy(buf);
+	net_buf_unref(orig);
+}
+#endif /* CONFIG_NET_IP_FRAGMENT_TX_BUFS > 0 */
+
+int net_ip_frag_append_payload(struct net_pkt *frag, struct net_pkt *pkt,
+			       u16_t len)
+{
+#if CONFIG_NET_IP_FRAGMENT_TX_BUFS > 0
+	struct net_pkt_cursor *cursor = &pkt->cursor;
+	struct net_buf *buf;
+	size_t seg;
+
+	while (len) {
+		if (!cursor->buf) {
+			return -ENOBUFS;
+		}
+
+		seg = cursor->buf->len - (cursor->pos - cursor->buf->data);
+		if (!seg) {
+			cursor->buf = cursor->buf->frags;
+			cursor->pos = cursor->buf ? cursor->buf->data : NULL;
+			continue;
+		}
+
+		seg = MIN(seg, len);
+
+		buf = net_buf_alloc_with_data(&frag_tx_pool, cursor->pos, seg,
+					      K_NO_WAIT);
+		if (!buf) {
+			break;
+		}
+
+		frag_tx_orig[net_buf_id(buf)] = net_buf_ref(cursor->buf);
+		net_pkt_append_buffer(frag, buf);
+
+		if (net_pkt_skip(pkt, seg)) {
+			return -ENOBUFS;
+		}
+
+		len -= seg;
+	}
+
+	if (len) {
+		NET_DBG("No fragment buffer, copying %u bytes", len);
+	}
+#endif /* CONFIG_NET_IP_FRAGMENT_TX_BUFS > 0 */
+
+	/* The cursor of the fragment is left alone, as its header buffer
+	 * comes before the buffers appended so far.
+	 */
+	while (len) {
+		struct net_buf *copy;
+		u16_t copy_len;
+
+		copy = net_pkt_get_frag(frag, FRAG_BUF_TIMEOUT);
+		if (!copy) {
+			return -ENOMEM;
+		}
+
+		net_pkt_append_buffer(frag, copy);
+
+		copy_len = MIN(len, net_buf_tailroom(copy));
+		if (net_pkt_read(pkt, net_buf_add(copy, copy_len),
+				 copy_len)) {
+			return -ENOBUFS;
+		}
+
+		len -= copy_len;
+	}
+
+	return 0;
+}
+
+int net_ip_frag_finish_chksum(struct net_pkt *pkt, u8_t proto,
+			      u16_t proto_offset)
+{
+	u16_t chksum = 0U;
+	u16_t offset;
+
+	if (!net_pkt_is_chksum_partial(pkt)) {
+		return 0;
+	}
+
+	if (IS_ENABLED(CONFIG_NET_UDP) && proto == IPPROTO_UDP) {
+		offset = offsetof(struct net_udp_hdr, chksum);
+	} else if (IS_ENABLED(CONFIG_NET_TCP) && proto == IPPROTO_TCP) {
+		offset = offsetof(struct net_tcp_hdr, chksum);
+	} else {
+		return -EINVAL;
+	}
+
+	offset += proto_offset;
+
+	net_pkt_set_overwrite(pkt, true);
+	net_pkt_cursor_init(pkt);
+
+	/* The field holds the pseudo header sum, clear it first */
+	if (net_pkt_skip(pkt, offset) ||
+	    net_pkt_write(pkt, &chksum, sizeof(chksum))) {
+		return -ENOBUFS;
+	}
+
+	if (proto == IPPROTO_UDP) {
+		chksum = net_calc_chksum_udp(pkt);
+	} else {
+		chksum = net_calc_chksum_tcp(pkt);
+	}
+
+	net_pkt_cursor_init(pkt);
+
+	if (net_pkt_skip(pkt, offset) ||
+	    net_pkt_write(pkt, &chksum, sizeof(chksum))) {
+		return -ENOBUFS;
+	}
+
+	net_pkt_set_chksum_partial(pkt, false);
+	net_pkt_cursor_init(pkt);
+
+	return 0;
+}
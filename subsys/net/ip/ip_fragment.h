@@ -0,0 +1,187 @@
+/** @file
+ @brief IP fragment reassembly and fragmentation helpers
+
+ This is not to be included by the application.
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __IP_FRAGMENT_H
+#define __IP_FRAGMENT_H
+
+#include <zephyr/types.h>
+#include <sys/slist.h>
+
+#include <net/net_ip.h>
+#include <net/net_pkt.h>
+
+/** Fragment of a datagram waiting for reassembly. */
+struct net_ip_frag {
+	/** Node in the fragment list of the reassembly, or in the free list */
+	sys_snode_t node;
+
+	/** Received fragment */
+	struct net_pkt *pkt;
+
+	/** Offset of the fragment payload in the datagram payload */
+	u16_t offset;
+
+	/** Length of the fragment payload */
+	u16_t len;
+
+	/** Length of the headers before the fragment payload in pkt */
+	u16_t hdr_len;
+};
+
+/** Store pending IP fragment information that is needed for reassembly. */
+struct net_ip_reassembly {
+	/** Source address of the fragments */
+	union {
+		struct in_addr in_addr;
+		struct in6_addr in6_addr;
+	} src;
+
+	/** Destination address of the fragments */
+	union {
+		struct in_addr in_addr;
+		struct in6_addr in6_addr;
+	} dst;
+
+	/** Timeout for cancelling the reassembly */
+	struct k_delayed_work timer;
+
+	/** Received fragments, sorted by offset without overlaps */
+	sys_slist_t frags;
+
+	/** Fragment identification */
+	u32_t id;
+
+	/** Number of payload bytes received so far */
+	u32_t received;
+
+	/** Length of the datagram payload, 0 until the last fragment is
+	 * received.
+	 */
+	u32_t total_len;
+
+	/** AF_INET or AF_INET6, AF_UNSPEC if this slot is free */
+	u8_t family;
+
+	/** IPv4 protocol of the datagram, 0 for IPv6 */
+	u8_t proto;
+
+	/** Number of fragments in the list */
+	u8_t count;
+};
+
+/** Identification of a received fragment. */
+struct net_ip_frag_info {
+	/** Source address of the fragment */
+	const void *src;
+
+	/** Destination address of the fragment */
+	const void *dst;
+
+	/** Fragment identification */
+	u32_t id;
+
+	/** Offset of the fragment payload in bytes */
+	u16_t offset;
+
+	/** Length of the headers before the fragment payload */
+	u16_t hdr_len;
+
+	/** AF_INET or AF_INET6 */
+	u8_t family;
+
+	/** IPv4 protocol of the datagram, 0 for IPv6 */
+	u8_t proto;
+
+	/** Is this not the last fragment */
+	bool more;
+};
+
+/**
+ * @typedef net_ip_frag_cb_t
+ * @brief Callback used while iterating over pending IP reassemblies.
+ *
+ * @param reass IP fragment reassembly struct
+ * @param user_data A valid pointer on some user data or NULL
+ */
+typedef void (*net_ip_frag_cb_t)(struct net_ip_reassembly *reass,
+				 void *user_data);
+
+#if defined(CONFIG_NET_IP_FRAGMENT)
+/**
+ * @brief Add a received fragment to the reassembly of its datagram.
+ *
+ * The fragments are kept sorted by offset. A fragment following the
+ * last one, which is the usual case, is appended in constant time.
+ * Duplicate fragments are dropped, and a fragment overlapping another
+ * one cancels the whole reassembly (RFC 5722).
+ *
+ * @param info Identification of the fragment
+ * @param pkt Received fragment, its cursor is not used
+ * @param reassembled Set to the reassembled datagram if this fragment
+ * completed it, NULL otherwise. The headers of the datagram are the ones
+ * of the first fragment, the caller must fix them.
+ *
+ * @return NET_OK if the fragment was taken, NET_DROP if the caller must
+ * drop it.
+ */
+enum net_verdict net_ip_reassembly_add(const struct net_ip_frag_info *info,
+				       struct net_pkt *pkt,
+				       struct net_pkt **reassembled);
+
+/**
+ * @brief Go through all the currently pending IP reassemblies.
+ *
+ * @param cb Callback to call for each pending reassembly.
+ * @param user_data User specified data or NULL.
+ */
+void net_ip_frag_foreach(net_ip_frag_cb_t cb, void *user_data);
+
+/**
+ * @brief Append payload of a packet to a fragment without copying it.
+ *
+ * The fragment gets buffers pointing to the data of the original packet,
+ * which keep a reference to the original buffers. If no such buffer is
+ * available, the payload is copied.
+ *
+ * @param frag Fragment being built
+ * @param pkt Original packet, its cursor is at the payload to append and
+ * is moved past it
+ * @param len Length of the payload to append
+ *
+ * @return 0 on success, negative errno otherwise.
+ */
+int net_ip_frag_append_payload(struct net_pkt *frag, struct net_pkt *pkt,
+			       u16_t len);
+
+/**
+ * @brief Finish the upper layer checksum that was left to the device.
+ *
+ * A device cannot complete a checksum spread over several fragments, so
+ * this is done in software before a packet is fragmented.
+ *
+ * @param pkt Network packet to fragment
+ * @param proto IPPROTO_UDP or IPPROTO_TCP
+ * @param proto_offset Offset of the upper layer header in the packet
+ *
+ * @return 0 on success, negative errno otherwise.
+ */
+int net_ip_frag_finish_chksum(struct net_pkt *pkt, u8_t proto,
+			      u16_t proto_offset);
+#else
+static inline void net_ip_frag_foreach(net_ip_frag_cb_t cb, void *user_data)
+{
+	ARG_UNUSED(cb);
+	ARG_UNUSED(user_data);
+}
+#endif /* CONFIG_NET_IP_FRAGMENT */
+
+#endif /* __IP_FRAGMENT_H */
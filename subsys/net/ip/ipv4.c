@@ -23,6 +23,7 @@ LOG_MODULE_REGISTER(net_ipv4, CONFIG_NET_IPV4_LOG_LEVEL);
 #include "udp_internal.h"
 #include "tcp_internal.h"
 #include "ipv4.h"
+#include "route.h"
 
 /* Timeout for various buffer allocations in this file. */
 #define NET_BUF_TIMEOUT K_MSEC(50)
@@ -196,6 +197,138 @@ int net_ipv4_parse_hdr_options(struct net_pkt *pkt,
 }
 #endif
 
+#if defined(CONFIG_NET_IPV4_FORWARDING)
+static struct net_if *ipv4_route_iface(struct net_if *orig_iface,
+				       const struct in_addr *dst)
+{
+	struct net_route_entry_ipv4 *route;
+	struct net_if *iface = NULL;
+
+	/* A directly connected subnet is preferred to any route, so that
+	 * a default route does not take its place.
+	 */
+	if (net_if_ipv4_addr_onlink(&iface, dst)) {
+		return iface;
+	}
+
+	route = net_route_ipv4_lookup(NULL, dst);
+	if (route) {
+		return route->iface;
+	}
+
+	/* Otherwise through the default gateway, unless that is where
+	 * the packet came from.
+	 */
+	iface = net_if_get_default();
+	if (iface && iface != orig_iface && iface->config.ip.ipv4 &&
+	    !net_ipv4_is_addr_unspecified(&iface->config.ip.ipv4->gw)) {
+		return iface;
+	}
+
+	return NULL;
+}
+
+static enum net_verdict ipv4_route_packet(struct net_pkt *pkt)
+{
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	struct net_ipv4_hdr *hdr;
+	struct net_if *iface;
+	u16_t old_ttl;
+
+	net_pkt_cursor_init(pkt);
+
+	hdr = (struct net_ipv4_hdr *)net_pkt_get_data(pkt, &ipv4_access);
+	if (!hdr) {
+		return NET_DROP;
+	}
+
+	if (net_ipv4_is_addr_mcast(&hdr->dst) ||
+	    net_ipv4_is_addr_loopback(&hdr->dst) ||
+	    net_ipv4_is_addr_bcast(net_pkt_iface(pkt), &hdr->dst) ||
+	    net_ipv4_addr_cmp(&hdr->dst, net_ipv4_broadcast_address()) ||
+	    net_ipv4_is_addr_unspecified(&hdr->dst)) {
+		NET_DBG("DROP: not for me");
+		return NET_DROP;
+	}
+
+	if (hdr->ttl <= 1U) {
+		NET_DBG("DROP: TTL exceeded, pkt %p", pkt);
+		net_icmpv4_send_error(pkt, NET_ICMPV4_TIME_EXCEEDED,
+				      NET_ICMPV4_TIME_EXCEEDED_TTL);
+		return NET_DROP;
+	}
+
+	iface = ipv4_route_iface(net_pkt_iface(pkt), &hdr->dst);
+	if (!iface) {
+		NET_DBG("No route to %s pkt %p dropped",
+			log_strdup(net_sprint_ipv4_addr(&hdr->dst)), pkt);
+		net_icmpv4_send_error(pkt, NET_ICMPV4_DST_UNREACH,
+				      NET_ICMPV4_DST_UNREACH_NO_NET);
+		return NET_DROP;
+	}
+
+	if ((sys_get_be16(hdr->offset) & NET_IPV4_DF) &&
+	    net_pkt_get_len(pkt) > net_if_get_mtu(iface)) {
+		NET_DBG("DROP: pkt %p larger than MTU %u and DF set", pkt,
+			net_if_get_mtu(iface));
+		net_icmpv4_send_error(pkt, NET_ICMPV4_DST_UNREACH,
+				      NET_ICMPV4_DST_UNREACH_FRAG);
+		return NET_DROP;
+	}
+
+	/* Without fragmentation the packet would go out as it is */
+	if (!IS_ENABLED(CONFIG_NET_IPV4_FRAGMENT) &&
+	    net_pkt_get_len(pkt) > net_if_get_mtu(iface)) {
+		NET_DBG("DROP: pkt %p larger than MTU %u", pkt,
+			net_if_get_mtu(iface));
+		return NET_DROP;
+	}
+
+	/* The TTL shares a checksummed 16-bit word with the protocol */
+	old_ttl = htons(hdr->ttl << 8 | hdr->proto);
+	hdr->ttl--;
+	hdr->chksum = net_ipv4_chksum_adjust(hdr->chksum, old_ttl,
+					     htons(hdr->ttl << 8 | hdr->proto));
+
+	if (net_pkt_set_data(pkt, &ipv4_access)) {
+		return NET_DROP;
+	}
+
+	/* Any ICMPv4 error above went to the inside host, as it is sent
+	 * before the addresses are translated.
+	 */
+	if (net_ipv4_nat_out(pkt, iface) < 0) {
+		return NET_DROP;
+	}
+
+	NET_DBG("Forward pkt %p from iface %p to %p", pkt,
+		net_pkt_iface(pkt), iface);
+
+	net_pkt_set_orig_iface(pkt, net_pkt_iface(pkt));
+	net_pkt_set_iface(pkt, iface);
+	net_pkt_set_forwarding(pkt, true);
+	net_pkt_set_family(pkt, PF_INET);
+
+	/* The link layer addresses are those of the received frame */
+	net_pkt_lladdr_src(pkt)->addr = NULL;
+	net_pkt_lladdr_dst(pkt)->addr = NULL;
+
+	if (net_send_data(pkt) < 0) {
+		NET_DBG("Cannot forward pkt %p", pkt);
+		return NET_DROP;
+	}
+
+	return NET_OK;
+}
+#else
+static inline enum net_verdict ipv4_route_packet(struct net_pkt *pkt)
+{
+	NET_DBG("DROP: Packet %p not for me", pkt);
+
+	return NET_DROP;
+}
+#endif /* CONFIG_NET_IPV4_FORWARDING */
+
 enum net_verdict net_ipv4_input(struct net_pkt *pkt)
 {
 	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
@@ -263,6 +396,16 @@ enum net_verdict net_ipv4_input(struct net_pkt *pkt)
 		goto drop;
 	}
 
+	if (IS_ENABLED(CONFIG_NET_IPV4_NAT) && net_ipv4_nat_in(pkt)) {
+		/* A reply to a translated connection, for an inside host */
+		verdict = ipv4_route_packet(pkt);
+		if (verdict == NET_DROP) {
+			goto drop;
+		}
+
+		return verdict;
+	}
+
 	if ((!net_ipv4_is_my_addr(&hdr->dst) &&
 	     !net_ipv4_is_addr_mcast(&hdr->dst) &&
 	     !(hdr->proto == IPPROTO_UDP &&
@@ -273,10 +416,31 @@ enum net_verdict net_ipv4_input(struct net_pkt *pkt)
 				   net_ipv4_unspecified_address()))))) ||
 	    (hdr->proto == IPPROTO_TCP &&
 	     net_ipv4_is_addr_bcast(net_pkt_iface(pkt), &hdr->dst))) {
+		if (IS_ENABLED(CONFIG_NET_IPV4_FORWARDING) &&
+		    !net_ipv4_is_my_addr(&hdr->dst)) {
+			verdict = ipv4_route_packet(pkt);
+			if (verdict == NET_DROP) {
+				goto drop;
+			}
+
+			return verdict;
+		}
+
 		NET_DBG("DROP: not for me");
 		goto drop;
 	}
 
+	if (IS_ENABLED(CONFIG_NET_IPV4_FRAGMENT) &&
+	    (sys_get_be16(hdr->offset) &
+	     (NET_IPV4_MF | NET_IPV4_FRAGH_OFFSET_MASK))) {
+		verdict = net_ipv4_handle_fragment_hdr(pkt, hdr);
+		if (verdict == NET_DROP) {
+			goto drop;
+		}
+
+		return verdict;
+	}
+
 	net_pkt_acknowledge_data(pkt, &ipv4_access);
 
 	if (opts_len) {
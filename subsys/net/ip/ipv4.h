@@ -28,6 +28,9 @@
 #define NET_IPV4_OPTS_RR   7   /* Record Route */
 #define NET_IPV4_OPTS_TS   68  /* Timestamp */
 
+/* Flag in the option type telling to copy the option into all fragments */
+#define NET_IPV4_OPTS_COPIED 0x80
+
 /* IPv4 Options Timestamp flags */
 #define NET_IPV4_TS_OPT_TS_ONLY	0 /* Timestamp only */
 #define NET_IPV4_TS_OPT_TS_ADDR	1 /* Timestamp and address */
@@ -35,6 +38,11 @@
 
 #define NET_IPV4_HDR_OPTNS_MAX_LEN 40
 
+/* IPv4 flags and fragment offset field */
+#define NET_IPV4_DF 0x4000 /* Don't Fragment */
+#define NET_IPV4_MF 0x2000 /* More Fragments */
+#define NET_IPV4_FRAGH_OFFSET_MASK 0x1fff
+
 /**
  * @brief Create IPv4 packet in provided net_pkt.
  *
@@ -132,4 +140,156 @@ static inline int net_ipv4_parse_hdr_options(struct net_pkt *pkt,
 }
 #endif
 
+/**
+ * @brief Handles IPv4 fragmented packets.
+ *
+ * @param pkt Network head packet.
+ * @param hdr The IPv4 header of the current packet
+ *
+ * @return Return verdict about the packet
+ */
+#if defined(CONFIG_NET_IPV4_FRAGMENT) && defined(CONFIG_NET_NATIVE_IPV4)
+enum net_verdict net_ipv4_handle_fragment_hdr(struct net_pkt *pkt,
+					      struct net_ipv4_hdr *hdr);
+#else
+static inline
+enum net_verdict net_ipv4_handle_fragment_hdr(struct net_pkt *pkt,
+					      struct net_ipv4_hdr *hdr)
+{
+	ARG_UNUSED(pkt);
+	ARG_UNUSED(hdr);
+
+	return NET_DROP;
+}
+#endif /* CONFIG_NET_IPV4_FRAGMENT */
+
+/**
+ * @brief Prepare IPv4 packet for sending. If the packet is larger than
+ * the MTU of the network interface, it is split into fragments that are
+ * sent instead of it.
+ *
+ * @param pkt Network packet
+ *
+ * @return NET_OK if the packet can be sent as is, NET_CONTINUE if it was
+ * fragmented and released, NET_DROP if it cannot be sent.
+ */
+#if defined(CONFIG_NET_IPV4_FRAGMENT) && defined(CONFIG_NET_NATIVE_IPV4)
+enum net_verdict net_ipv4_prepare_for_send(struct net_pkt *pkt);
+#else
+static inline enum net_verdict net_ipv4_prepare_for_send(struct net_pkt *pkt)
+{
+	ARG_UNUSED(pkt);
+
+	return NET_OK;
+}
+#endif /* CONFIG_NET_IPV4_FRAGMENT */
+
+/**
+ * @brief Update an Internet checksum for a 16-bit word of the data it
+ * covers changing, as in RFC 1624. The values can be in either byte
+ * order, as long as it is the same for all of them.
+ *
+ * @param chksum Checksum field
+ * @param old_val Old value of the word
+ * @param new_val New value of the word
+ *
+ * @return New value of the checksum field
+ */
+static inline u16_t net_ipv4_chksum_adjust(u16_t chksum, u16_t old_val,
+					   u16_t new_val)
+{
+	u32_t sum = (u16_t)~chksum + (u16_t)~old_val + new_val;
+
+	sum = (sum & 0xffff) + (sum >> 16);
+	sum = (sum & 0xffff) + (sum >> 16);
+
+	return ~sum;
+}
+
+/**
+ * @brief Update an Internet checksum for a 32-bit word of the data it
+ * covers changing, such as an IPv4 address.
+ *
+ * @param chksum Checksum field
+ * @param old_val Old value of the word
+ * @param new_val New value of the word
+ *
+ * @return New value of the checksum field
+ */
+static inline u16_t net_ipv4_chksum_adjust32(u16_t chksum, u32_t old_val,
+					     u32_t new_val)
+{
+	chksum = net_ipv4_chksum_adjust(chksum, old_val >> 16, new_val >> 16);
+
+	return net_ipv4_chksum_adjust(chksum, old_val & 0xffff,
+				      new_val & 0xffff);
+}
+
+/**
+ * @brief Translate the address and port of the inside host in a packet
+ * forwarded to the external interface of the NAT.
+ *
+ * @param pkt Network packet, with the cursor anywhere
+ * @param iface Network interface that the packet will be sent to
+ *
+ * @return 0 if the packet was translated or needs no translation,
+ * <0 if it must be dropped.
+ */
+#if defined(CONFIG_NET_IPV4_NAT)
+int net_ipv4_nat_out(struct net_pkt *pkt, struct net_if *iface);
+#else
+static inline int net_ipv4_nat_out(struct net_pkt *pkt, struct net_if *iface)
+{
+	ARG_UNUSED(pkt);
+	ARG_UNUSED(iface);
+
+	return 0;
+}
+#endif
+
+/**
+ * @brief Translate a reply received on the external interface of the NAT
+ * back to the address and port of the inside host.
+ *
+ * @param pkt Network packet, with the cursor anywhere
+ *
+ * @return True if the packet was translated and must be forwarded,
+ * false if it is not part of a translated connection.
+ */
+#if defined(CONFIG_NET_IPV4_NAT)
+bool net_ipv4_nat_in(struct net_pkt *pkt);
+#else
+static inline bool net_ipv4_nat_in(struct net_pkt *pkt)
+{
+	ARG_UNUSED(pkt);
+
+	return false;
+}
+#endif
+
+#if defined(CONFIG_NET_IPV4_NAT)
+/**
+ * @brief Translate the connections that are forwarded out of a network
+ * interface. The connections tracked for the previous external
+ * interface, if any, are forgotten.
+ *
+ * @param iface External network interface
+ *
+ * @return 0 if ok, <0 if error
+ */
+int net_ipv4_nat_enable(struct net_if *iface);
+
+/**
+ * @brief Stop translating, and forget the tracked connections.
+ */
+void net_ipv4_nat_disable(void);
+
+/**
+ * @brief Initialize the connection tracking table.
+ */
+void net_ipv4_nat_init(void);
+#else
+#define net_ipv4_nat_init(...)
+#endif /* CONFIG_NET_IPV4_NAT */
+
 #endif /* __IPV4_H */
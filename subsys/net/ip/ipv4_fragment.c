@@ -0,0 +1,392 @@
+/** @file
+ * @brief IPv4 Fragment related functions
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_DECLARE(net_ipv4, CONFIG_NET_IPV4_LOG_LEVEL);
+
+#include <errno.h>
+#include <string.h>
+#include <sys/atomic.h>
+#include <net/net_core.h>
+#include <net/net_pkt.h>
+#include <net/net_stats.h>
+#include <net/net_context.h>
+#include "net_private.h"
+#include "ipv4.h"
+#include "ip_fragment.h"
+
+/* Largest value of the IPv4 total length */
+#define IPV4_MAX_LEN 0xffff
+
+#define BUF_ALLOC_TIMEOUT K_MSEC(100)
+
+static atomic_t ipv4_frag_id;
+
+/* Fix the IPv4 header of the reassembled packet and feed it back to the
+ * IP stack.
+ */
+static void reassembly_finish(struct net_pkt *pkt)
+{
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	struct net_ipv4_hdr *hdr;
+
+	net_pkt_set_overwrite(pkt, true);
+	net_pkt_cursor_init(pkt);
+
+	hdr = (struct net_ipv4_hdr *)net_pkt_get_data(pkt, &ipv4_access);
+	if (!hdr) {
+		goto error;
+	}
+
+	hdr->len = htons(net_pkt_get_len(pkt));
+	hdr->offset[0] = 0U;
+	hdr->offset[1] = 0U;
+	hdr->chksum = 0U;
+	hdr->chksum = net_calc_chksum_ipv4(pkt);
+
+	net_pkt_set_data(pkt, &ipv4_access);
+
+	NET_DBG("New pkt %p IPv4 len is %zd bytes", pkt,
+		net_pkt_get_len(pkt));
+
+	/* As the packet does not contain link layer header anymore, it is
+	 * not passed to L2 by process_data().
+	 */
+	if (net_recv_data(net_pkt_iface(pkt), pkt) >= 0) {
+		return;
+	}
+error:
+	net_pkt_unref(pkt);
+}
+
+enum net_verdict net_ipv4_handle_fragment_hdr(struct net_pkt *pkt,
+					      struct net_ipv4_hdr *hdr)
+{
+	u16_t flag = sys_get_be16(hdr->offset);
+	struct net_ip_frag_info info;
+	struct net_pkt *reassembled;
+	enum net_verdict verdict;
+
+	info.src = &hdr->src;
+	info.dst = &hdr->dst;
+	info.id = sys_get_be16(hdr->id);
+	info.offset = (flag & NET_IPV4_FRAGH_OFFSET_MASK) * 8U;
+	info.hdr_len = (hdr->vhl & NET_IPV4_IHL_MASK) * 4U;
+	info.family = AF_INET;
+	info.proto = hdr->proto;
+	info.more = flag & NET_IPV4_MF;
+
+	/* The reassembled packet must fit in the IPv4 total length */
+	if (info.offset + net_pkt_get_len(pkt) > IPV4_MAX_LEN) {
+		NET_DBG("DROP: fragment offset %u too large", info.offset);
+		return NET_DROP;
+	}
+
+	/* The header pointer is not valid anymore after this call */
+	verdict = net_ip_reassembly_add(&info, pkt, &reassembled);
+	if (verdict == NET_OK && reassembled) {
+		reassembly_finish(reassembled);
+	}
+
+	return verdict;
+}
+
+/* Keep the options with the copied flag set, the ones that go into all
+ * the fragments after the first one (RFC 791 ch. 3.2), and pad them to a
+ * multiple of 4 bytes. Returns the length of the copied options.
+ */
+static int ipv4_copied_opts(const u8_t *opts, u8_t opts_len, u8_t *copied)
+{
+	u8_t copied_len = 0U;
+	u8_t i = 0U;
+	u8_t len;
+
+	while (i < opts_len) {
+		if (opts[i] == NET_IPV4_OPTS_EO) {
+			break;
+		}
+
+		if (opts[i] == NET_IPV4_OPTS_NOP) {
+			i++;
+			continue;
+		}
+
+		if (i + 1 >= opts_len) {
+			return -EINVAL;
+		}
+
+		len = opts[i + 1];
+		if (len < 2 || len > opts_len - i) {
+			return -EINVAL;
+		}
+
+		if (opts[i] & NET_IPV4_OPTS_COPIED) {
+			memcpy(copied + copied_len, opts + i, len);
+			copied_len += len;
+		}
+
+		i += len;
+	}
+
+	while (copied_len % 4U) {
+		copied[copied_len++] = NET_IPV4_OPTS_EO;
+	}
+
+	return copied_len;
+}
+
+static int send_ipv4_fragment(struct net_pkt *pkt, u16_t hdr_len,
+			      const u8_t *opts, u8_t opts_len,
+			      u16_t frag_offset, u16_t fit_len, u16_t flag)
+{
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	struct net_ipv4_hdr *hdr;
+	struct net_pkt *frag_pkt;
+	int ret;
+
+	frag_pkt = net_pkt_alloc_with_buffer(net_pkt_iface(pkt), opts_len,
+					     AF_INET, 0, BUF_ALLOC_TIMEOUT);
+	if (!frag_pkt) {
+		return -ENOMEM;
+	}
+
+	net_pkt_cursor_init(pkt);
+
+	/* The options of the original header are replaced by the ones
+	 * given for this fragment.
+	 */
+	if (net_pkt_copy(frag_pkt, pkt, sizeof(struct net_ipv4_hdr)) ||
+	    net_pkt_write(frag_pkt, opts, opts_len) ||
+	    net_pkt_skip(pkt, hdr_len - sizeof(struct net_ipv4_hdr) +
+			 frag_offset)) {
+		ret = -ENOBUFS;
+		goto fail;
+	}
+
+	/* The payload references the data of the original packet */
+	ret = net_ip_frag_append_payload(frag_pkt, pkt, fit_len);
+	if (ret < 0) {
+		goto fail;
+	}
+
+	ret = -ENOBUFS;
+
+	net_pkt_set_ip_hdr_len(frag_pkt, sizeof(struct net_ipv4_hdr));
+	net_pkt_set_ipv4_opts_len(frag_pkt, opts_len);
+	net_pkt_set_overwrite(frag_pkt, true);
+	net_pkt_cursor_init(frag_pkt);
+
+	hdr = (struct net_ipv4_hdr *)net_pkt_get_data(frag_pkt, &ipv4_access);
+	if (!hdr) {
+		goto fail;
+	}
+
+	hdr->vhl = 0x40 | ((sizeof(struct net_ipv4_hdr) + opts_len) / 4U);
+	hdr->len = htons(net_pkt_get_len(frag_pkt));
+	sys_put_be16(flag, hdr->offset);
+	hdr->chksum = 0U;
+
+	if (net_if_need_calc_tx_checksum(net_pkt_iface(frag_pkt))) {
+		hdr->chksum = net_calc_chksum_ipv4(frag_pkt);
+	}
+
+	if (net_pkt_set_data(frag_pkt, &ipv4_access)) {
+		goto fail;
+	}
+
+	ret = net_send_data(frag_pkt);
+	if (ret < 0) {
+		goto fail;
+	}
+
+	/* Let this packet to be sent and hopefully it will release
+	 * the memory that can be utilized for next sent IPv4 fragment.
+	 */
+	k_yield();
+
+	return 0;
+
+fail:
+	NET_DBG("Cannot send fragment (%d)", ret);
+	net_pkt_unref(frag_pkt);
+
+	return ret;
+}
+
+static int net_ipv4_send_fragmented_pkt(struct net_pkt *pkt, u16_t mtu)
+{
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	u8_t copied[NET_IPV4_HDR_OPTNS_MAX_LEN];
+	u8_t opts[NET_IPV4_HDR_OPTNS_MAX_LEN];
+	struct net_ipv4_hdr *hdr;
+	u16_t frag_offset;
+	u16_t base_offset;
+	u8_t opts_len;
+	int copied_len;
+	u16_t hdr_len;
+	size_t length;
+	bool more;
+	int fit_len;
+	u16_t flag;
+	u8_t proto;
+	int ret;
+
+	net_pkt_set_overwrite(pkt, true);
+	net_pkt_cursor_init(pkt);
+
+	hdr = (struct net_ipv4_hdr *)net_pkt_get_data(pkt, &ipv4_access);
+	if (!hdr) {
+		return -ENOBUFS;
+	}
+
+	hdr_len = (hdr->vhl & NET_IPV4_IHL_MASK) * 4U;
+	proto = hdr->proto;
+
+	/* A forwarded fragment is split further. The pieces keep its
+	 * identification and take its place in the original datagram.
+	 * Otherwise all the fragments share a new identification.
+	 */
+	flag = sys_get_be16(hdr->offset);
+	if (net_pkt_forwarding(pkt)) {
+		base_offset = (flag & NET_IPV4_FRAGH_OFFSET_MASK) * 8U;
+		more = flag & NET_IPV4_MF;
+	} else {
+		sys_put_be16((u16_t)atomic_inc(&ipv4_frag_id), hdr->id);
+		base_offset = 0U;
+		more = false;
+	}
+
+	if (net_pkt_set_data(pkt, &ipv4_access)) {
+		return -ENOBUFS;
+	}
+
+	opts_len = hdr_len - sizeof(struct net_ipv4_hdr);
+	if (net_pkt_read(pkt, opts, opts_len)) {
+		return -ENOBUFS;
+	}
+
+	copied_len = ipv4_copied_opts(opts, opts_len, copied);
+	if (copied_len < 0) {
+		NET_DBG("Invalid IPv4 options");
+		return copied_len;
+	}
+
+	/* The device cannot finish a checksum spread over the fragments */
+	if (proto == IPPROTO_UDP || proto == IPPROTO_TCP) {
+		ret = net_ip_frag_finish_chksum(pkt, proto, hdr_len);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	/* The payload of all fragments but the last one must be a
+	 * multiple of 8 bytes.
+	 */
+	fit_len = (mtu - hdr_len) & ~7;
+	if (fit_len <= 0) {
+		NET_DBG("No room for IPv4 payload MTU %d hdr_len %d", mtu,
+			hdr_len);
+		return -EINVAL;
+	}
+
+	frag_offset = 0U;
+
+	length = net_pkt_get_len(pkt) - hdr_len;
+	while (length) {
+		bool final = false;
+
+		if (fit_len >= length) {
+			final = true;
+			fit_len = length;
+		}
+
+		flag = (base_offset + frag_offset) / 8U;
+		if (!final || more) {
+			flag |= NET_IPV4_MF;
+		}
+
+		/* Only the first fragment carries all the options */
+		if (base_offset + frag_offset == 0U) {
+			ret = send_ipv4_fragment(pkt, hdr_len, opts, opts_len,
+						 frag_offset, fit_len, flag);
+		} else {
+			ret = send_ipv4_fragment(pkt, hdr_len, copied,
+						 copied_len, frag_offset,
+						 fit_len, flag);
+		}
+		if (ret < 0) {
+			return ret;
+		}
+
+		length -= fit_len;
+		frag_offset += fit_len;
+	}
+
+	return 0;
+}
+
+enum net_verdict net_ipv4_prepare_for_send(struct net_pkt *pkt)
+{
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	size_t pkt_len = net_pkt_get_len(pkt);
+	struct net_ipv4_hdr *hdr;
+	u16_t mtu;
+	int ret;
+
+	/* Packets built for segmentation offload are split into TCP
+	 * segments instead.
+	 */
+	if (net_pkt_gso_size(pkt)) {
+		return NET_OK;
+	}
+
+	mtu = net_if_get_mtu(net_pkt_iface(pkt));
+	if (mtu == 0U) {
+		mtu = NET_IPV4_MTU;
+	}
+
+	if (pkt_len <= mtu) {
+		return NET_OK;
+	}
+
+	net_pkt_cursor_init(pkt);
+
+	hdr = (struct net_ipv4_hdr *)net_pkt_get_data(pkt, &ipv4_access);
+	if (!hdr) {
+		return NET_DROP;
+	}
+
+	if (sys_get_be16(hdr->offset) & NET_IPV4_DF) {
+		NET_DBG("DROP: pkt %p len %zd larger than MTU %u and DF set",
+			pkt, pkt_len, mtu);
+		return NET_DROP;
+	}
+
+	ret = net_ipv4_send_fragmented_pkt(pkt, mtu);
+	if (ret < 0) {
+		NET_DBG("Cannot fragment IPv4 pkt (%d)", ret);
+		return NET_DROP;
+	}
+
+	/* We "fake" the sending of the packet here so that a TCP resend
+	 * takes a new reference, like in net_ipv6_prepare_for_send().
+	 */
+	if (IS_ENABLED(CONFIG_NET_TCP)) {
+		net_pkt_set_sent(pkt, true);
+	}
+
+	/* We need to unref here because we simulate the packet sending. */
+	net_pkt_unref(pkt);
+
+	/* The packet is now split and its fragments were sent separately
+	 * to the network.
+	 */
+	return NET_CONTINUE;
+}
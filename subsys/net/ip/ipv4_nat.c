@@ -0,0 +1,619 @@
+/** @file
+ * @brief IPv4 network address and port translation
+ *
+ * TCP, UDP and ICMPv4 echo packets that are forwarded out of the external
+ * interface get the address of that interface, and an external port of
+ * their connection, as source. The ICMPv4 echo identifier stands for the
+ * port. The replies to that address and port get the address and port of
+ * the inside host back as destination.
+ *
+ * The connections are kept in a fixed table, and found through two hash
+ * tables: one by the inside address and port and the remote address and
+ * port, for the packets going out, and one by the external port, for the
+ * replies. Timed out connections are reclaimed when they are looked up,
+ * or when the table is full.
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_ipv4_nat, CONFIG_NET_IPV4_NAT_LOG_LEVEL);
+
+#include <kernel.h>
+#include <spinlock.h>
+#include <errno.h>
+#include <stddef.h>
+#include <sys/slist.h>
+#include <random/rand32.h>
+#include <net/net_core.h>
+#include <net/net_pkt.h>
+#include <net/net_if.h>
+
+#include "net_private.h"
+#include "icmpv4.h"
+#include "ipv4.h"
+#include "tcp_internal.h"
+
+#define NAT_PORT_COUNT (CONFIG_NET_IPV4_NAT_PORT_MAX - \
+			CONFIG_NET_IPV4_NAT_PORT_MIN + 1)
+
+BUILD_ASSERT(CONFIG_NET_IPV4_NAT_PORT_MIN <= CONFIG_NET_IPV4_NAT_PORT_MAX);
+
+/* One bucket per connection keeps the chains short */
+#define NAT_HASH_SIZE CONFIG_NET_IPV4_NAT_MAX_CONNS
+
+/* Connection flags */
+#define NAT_CONN_REPLIED BIT(0) /* A packet has come back */
+#define NAT_CONN_FIN_OUT BIT(1) /* TCP FIN sent by the inside host */
+#define NAT_CONN_FIN_IN  BIT(2) /* TCP FIN sent by the remote host */
+#define NAT_CONN_RST     BIT(3) /* TCP RST sent by either one */
+
+struct nat_conn {
+	/* In the inside hash table, or in the free list */
+	sys_snode_t int_node;
+	/* In the external port hash table */
+	sys_snode_t ext_node;
+	struct in_addr int_addr;
+	struct in_addr rem_addr;
+	/* Uptime in milliseconds when the connection times out */
+	u32_t expiry;
+	/* The ports are in network byte order */
+	u16_t int_port;
+	u16_t rem_port;
+	u16_t ext_port;
+	u8_t proto;
+	u8_t flags;
+};
+
+/* Addresses and ports of a packet. The ICMPv4 echo identifier is the port
+ * of the inside host, and the port of the remote host is 0.
+ */
+struct nat_tuple {
+	struct in_addr src;
+	struct in_addr dst;
+	u16_t src_port;
+	u16_t dst_port;
+	u8_t proto;
+};
+
+struct nat_pkt {
+	struct net_ipv4_hdr *ip;
+	/* The transport header, in the packet */
+	u8_t *l4;
+	u8_t src_port_off;
+	u8_t dst_port_off;
+	u8_t chksum_off;
+	struct nat_tuple tuple;
+};
+
+struct nat_icmp_echo_hdr {
+	struct net_icmp_hdr hdr;
+	struct net_icmpv4_echo_req echo;
+} __packed;
+
+static struct nat_conn conns[CONFIG_NET_IPV4_NAT_MAX_CONNS];
+static sys_slist_t int_hash[NAT_HASH_SIZE];
+static sys_slist_t ext_hash[NAT_HASH_SIZE];
+static sys_slist_t free_conns;
+
+static struct net_if *ext_iface;
+static u16_t next_port;
+
+static struct k_spinlock lock;
+
+static u32_t int_bucket(u8_t proto, const struct in_addr *int_addr,
+			u16_t int_port, const struct in_addr *rem_addr,
+			u16_t rem_port)
+{
+	u32_t hash;
+
+	hash = int_addr->s_addr * 0x9e3779b1U;
+	hash ^= rem_addr->s_addr + (hash << 6) + (hash >> 2);
+	hash ^= ((u32_t)int_port << 16 | rem_port) + (hash << 6) +
+		(hash >> 2);
+	hash ^= proto;
+
+	return (hash ^ (hash >> 16)) % NAT_HASH_SIZE;
+}
+
+static u32_t ext_bucket(u8_t proto, u16_t ext_port)
+{
+	/* The ports are allocated in turn, so they spread evenly */
+	return (ntohs(ext_port) ^ proto) % NAT_HASH_SIZE;
+}
+
+static inline bool conn_is_expired(struct nat_conn *conn, u32_t now)
+{
+	return (s32_t)(now - conn->expiry) >= 0;
+}
+
+static u32_t conn_timeout(struct nat_conn *conn)
+{
+	switch (conn->proto) {
+	case IPPROTO_TCP:
+		if (!(conn->flags & NAT_CONN_REPLIED) ||
+		    (conn->flags & NAT_CONN_RST) ||
+		    ((conn->flags & NAT_CONN_FIN_OUT) &&
+		     (conn->flags & NAT_CONN_FIN_IN))) {
+			return CONFIG_NET_IPV4_NAT_TCP_TRANS_TIMEOUT *
+				MSEC_PER_SEC;
+		}
+
+		return CONFIG_NET_IPV4_NAT_TCP_TIMEOUT * MSEC_PER_SEC;
+	case IPPROTO_UDP:
+		return CONFIG_NET_IPV4_NAT_UDP_TIMEOUT * MSEC_PER_SEC;
+	default:
+		return CONFIG_NET_IPV4_NAT_ICMP_TIMEOUT * MSEC_PER_SEC;
+	}
+}
+
+static void conn_free(struct nat_conn *conn)
+{
+	sys_slist_find_and_remove(&int_hash[int_bucket(conn->proto,
+						       &conn->int_addr,
+						       conn->int_port,
+						       &conn->rem_addr,
+						       conn->rem_port)],
+				  &conn->int_node);
+	sys_slist_find_and_remove(&ext_hash[ext_bucket(conn->proto,
+						       conn->ext_port)],
+				  &conn->ext_node);
+
+	sys_slist_prepend(&free_conns, &conn->int_node);
+}
+
+static struct nat_conn *conn_find_int(const struct nat_tuple *tuple,
+				      u32_t now)
+{
+	sys_slist_t *bucket = &int_hash[int_bucket(tuple->proto, &tuple->src,
+						   tuple->src_port,
+						   &tuple->dst,
+						   tuple->dst_port)];
+	struct nat_conn *conn;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(bucket, conn, int_node) {
+		if (conn->proto != tuple->proto ||
+		    conn->int_port != tuple->src_port ||
+		    conn->rem_port != tuple->dst_port ||
+		    !net_ipv4_addr_cmp(&conn->int_addr, &tuple->src) ||
+		    !net_ipv4_addr_cmp(&conn->rem_addr, &tuple->dst)) {
+			continue;
+		}
+
+		if (conn_is_expired(conn, now)) {
+			conn_free(conn);
+			return NULL;
+		}
+
+		return conn;
+	}
+
+	return NULL;
+}
+
+static struct nat_conn *conn_find_ext(u8_t proto, u16_t ext_port, u32_t now)
+{
+	sys_slist_t *bucket = &ext_hash[ext_bucket(proto, ext_port)];
+	struct nat_conn *conn;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(bucket, conn, ext_node) {
+		if (conn->proto != proto || conn->ext_port != ext_port) {
+			continue;
+		}
+
+		if (conn_is_expired(conn, now)) {
+			conn_free(conn);
+			return NULL;
+		}
+
+		return conn;
+	}
+
+	return NULL;
+}
+
+static struct nat_conn *conn_alloc(u32_t now)
+{
+	sys_snode_t *node;
+	int i;
+
+	node = sys_slist_get(&free_conns);
+	if (!node) {
+		/* Every connection is in use, reclaim the timed out ones */
+		for (i = 0; i < ARRAY_SIZE(conns); i++) {
+			if (conn_is_expired(&conns[i], now)) {
+				conn_free(&conns[i]);
+			}
+		}
+
+		node = sys_slist_get(&free_conns);
+		if (!node) {
+			return NULL;
+		}
+	}
+
+	return CONTAINER_OF(node, struct nat_conn, int_node);
+}
+
+static int port_alloc(u8_t proto, u32_t now, u16_t *ext_port)
+{
+	u16_t port;
+	int i;
+
+	/* Fewer ports than connections are in use, so this ends well
+	 * before going through the whole range.
+	 */
+	for (i = 0; i < NAT_PORT_COUNT; i++) {
+		port = htons(CONFIG_NET_IPV4_NAT_PORT_MIN + next_port);
+
+		next_port = (next_port + 1) % NAT_PORT_COUNT;
+
+		if (!conn_find_ext(proto, port, now)) {
+			*ext_port = port;
+			return 0;
+		}
+	}
+
+	return -EADDRINUSE;
+}
+
+static struct nat_conn *conn_add(const struct nat_tuple *tuple, u32_t now)
+{
+	struct nat_conn *conn;
+	u16_t ext_port;
+
+	conn = conn_alloc(now);
+	if (!conn) {
+		NET_DBG("No free connection");
+		return NULL;
+	}
+
+	if (port_alloc(tuple->proto, now, &ext_port) < 0) {
+		NET_DBG("No free port");
+		sys_slist_prepend(&free_conns, &conn->int_node);
+		return NULL;
+	}
+
+	net_ipaddr_copy(&conn->int_addr, &tuple->src);
+	net_ipaddr_copy(&conn->rem_addr, &tuple->dst);
+	conn->int_port = tuple->src_port;
+	conn->rem_port = tuple->dst_port;
+	conn->ext_port = ext_port;
+	conn->proto = tuple->proto;
+	conn->flags = 0U;
+
+	sys_slist_prepend(&int_hash[int_bucket(conn->proto, &conn->int_addr,
+					       conn->int_port, &conn->rem_addr,
+					       conn->rem_port)],
+			  &conn->int_node);
+	sys_slist_prepend(&ext_hash[ext_bucket(conn->proto, ext_port)],
+			  &conn->ext_node);
+
+	NET_DBG("New %s connection from %s:%u via port %u",
+		net_proto2str(AF_INET, conn->proto),
+		log_strdup(net_sprint_ipv4_addr(&conn->int_addr)),
+		ntohs(conn->int_port), ntohs(conn->ext_port));
+
+	return conn;
+}
+
+static void conn_update(struct nat_conn *conn, struct nat_pkt *np,
+			bool outbound, u32_t now)
+{
+	if (!outbound) {
+		conn->flags |= NAT_CONN_REPLIED;
+	}
+
+	if (conn->proto == IPPROTO_TCP) {
+		u8_t flags = ((struct net_tcp_hdr *)np->l4)->flags;
+
+		if (flags & NET_TCP_RST) {
+			conn->flags |= NAT_CONN_RST;
+		}
+
+		if (flags & NET_TCP_FIN) {
+			conn->flags |= outbound ? NAT_CONN_FIN_OUT :
+				NAT_CONN_FIN_IN;
+		}
+	}
+
+	conn->expiry = now + conn_timeout(conn);
+}
+
+/* Find the addresses and ports of a packet. The headers are accessed in
+ * place, so they can be changed through np.
+ */
+static int nat_parse(struct net_pkt *pkt, bool outbound, struct nat_pkt *np)
+{
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(tcp_access, struct net_tcp_hdr);
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(udp_access, struct net_udp_hdr);
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(icmp_access,
+					      struct nat_icmp_echo_hdr);
+	struct net_pkt_data_access *l4_access;
+	struct nat_icmp_echo_hdr *icmp_hdr;
+
+	net_pkt_cursor_init(pkt);
+
+	np->ip = (struct net_ipv4_hdr *)net_pkt_get_data(pkt, &ipv4_access);
+	if (!np->ip) {
+		return -ENOBUFS;
+	}
+
+	/* Only the first fragment has the ports */
+	if (sys_get_be16(np->ip->offset) &
+	    (NET_IPV4_MF | NET_IPV4_FRAGH_OFFSET_MASK)) {
+		return -ENOTSUP;
+	}
+
+	switch (np->ip->proto) {
+	case IPPROTO_TCP:
+		l4_access = &tcp_access;
+		np->chksum_off = offsetof(struct net_tcp_hdr, chksum);
+		break;
+	case IPPROTO_UDP:
+		l4_access = &udp_access;
+		np->chksum_off = offsetof(struct net_udp_hdr, chksum);
+		break;
+	case IPPROTO_ICMP:
+		l4_access = &icmp_access;
+		np->chksum_off = offsetof(struct net_icmp_hdr, chksum);
+		break;
+	default:
+		return -EPROTONOSUPPORT;
+	}
+
+	if (net_pkt_skip(pkt, (np->ip->vhl & NET_IPV4_IHL_MASK) * 4U)) {
+		return -ENOBUFS;
+	}
+
+	np->l4 = net_pkt_get_data(pkt, l4_access);
+	if (!np->l4) {
+		return -ENOBUFS;
+	}
+
+	np->tuple.proto = np->ip->proto;
+	net_ipaddr_copy(&np->tuple.src, &np->ip->src);
+	net_ipaddr_copy(&np->tuple.dst, &np->ip->dst);
+
+	if (np->tuple.proto != IPPROTO_ICMP) {
+		np->src_port_off = offsetof(struct net_udp_hdr, src_port);
+		np->dst_port_off = offsetof(struct net_udp_hdr, dst_port);
+		np->tuple.src_port = UNALIGNED_GET((u16_t *)(np->l4 +
+							     np->src_port_off));
+		np->tuple.dst_port = UNALIGNED_GET((u16_t *)(np->l4 +
+							     np->dst_port_off));
+		return 0;
+	}
+
+	/* Errors about the connections are not translated */
+	icmp_hdr = (struct nat_icmp_echo_hdr *)np->l4;
+	if (icmp_hdr->hdr.type != (outbound ? NET_ICMPV4_ECHO_REQUEST :
+				   NET_ICMPV4_ECHO_REPLY) ||
+	    icmp_hdr->hdr.code != 0U) {
+		return -ENOTSUP;
+	}
+
+	np->src_port_off = offsetof(struct nat_icmp_echo_hdr, echo.identifier);
+	np->dst_port_off = np->src_port_off;
+
+	if (outbound) {
+		np->tuple.src_port = UNALIGNED_GET(&icmp_hdr->echo.identifier);
+		np->tuple.dst_port = 0U;
+	} else {
+		np->tuple.src_port = 0U;
+		np->tuple.dst_port = UNALIGNED_GET(&icmp_hdr->echo.identifier);
+	}
+
+	return 0;
+}
+
+/* Replace the source or destination address and port, and update the
+ * checksums for the change instead of computing them again.
+ */
+static void nat_rewrite(struct nat_pkt *np, bool src,
+			const struct in_addr *addr, u16_t port)
+{
+	struct in_addr *ip_addr = src ? &np->ip->src : &np->ip->dst;
+	u16_t *port_field = (u16_t *)(np->l4 + (src ? np->src_port_off :
+						np->dst_port_off));
+	u16_t *chksum_field = (u16_t *)(np->l4 + np->chksum_off);
+	u32_t old_addr = UNALIGNED_GET(&ip_addr->s_addr);
+	u16_t old_port = UNALIGNED_GET(port_field);
+	u16_t chksum;
+
+	UNALIGNED_PUT(addr->s_addr, &ip_addr->s_addr);
+	UNALIGNED_PUT(port, port_field);
+
+	np->ip->chksum = net_ipv4_chksum_adjust32(np->ip->chksum, old_addr,
+						  addr->s_addr);
+
+	chksum = UNALIGNED_GET(chksum_field);
+
+	if (np->tuple.proto == IPPROTO_UDP && chksum == 0U) {
+		/* The sender did not compute one */
+		return;
+	}
+
+	/* The ICMPv4 checksum does not cover a pseudo header */
+	if (np->tuple.proto != IPPROTO_ICMP) {
+		chksum = net_ipv4_chksum_adjust32(chksum, old_addr,
+						  addr->s_addr);
+	}
+
+	chksum = net_ipv4_chksum_adjust(chksum, old_port, port);
+
+	if (np->tuple.proto == IPPROTO_UDP && chksum == 0U) {
+		chksum = 0xffff;
+	}
+
+	UNALIGNED_PUT(chksum, chksum_field);
+}
+
+int net_ipv4_nat_out(struct net_pkt *pkt, struct net_if *iface)
+{
+	const struct in_addr *ext_addr;
+	struct nat_conn *conn;
+	k_spinlock_key_t key;
+	struct nat_pkt np;
+	u16_t ext_port;
+	u32_t now;
+	int ret;
+
+	if (!ext_iface || iface != ext_iface ||
+	    net_pkt_iface(pkt) == ext_iface) {
+		return 0;
+	}
+
+	/* Whatever cannot be translated must not leak out with the
+	 * address of the inside host.
+	 */
+	ret = nat_parse(pkt, true, &np);
+	if (ret < 0) {
+		NET_DBG("Cannot translate pkt %p (%d)", pkt, ret);
+		return ret;
+	}
+
+	ext_addr = net_if_ipv4_select_src_addr(iface, &np.tuple.dst);
+	if (net_ipv4_is_addr_unspecified(ext_addr)) {
+		NET_DBG("No address on iface %p", iface);
+		return -EADDRNOTAVAIL;
+	}
+
+	now = k_uptime_get_32();
+
+	key = k_spin_lock(&lock);
+
+	conn = conn_find_int(&np.tuple, now);
+	if (!conn) {
+		conn = conn_add(&np.tuple, now);
+		if (!conn) {
+			k_spin_unlock(&lock, key);
+			return -ENOMEM;
+		}
+	}
+
+	conn_update(conn, &np, true, now);
+	ext_port = conn->ext_port;
+
+	k_spin_unlock(&lock, key);
+
+	nat_rewrite(&np, true, ext_addr, ext_port);
+
+	return 0;
+}
+
+bool net_ipv4_nat_in(struct net_pkt *pkt)
+{
+	struct nat_conn *conn;
+	struct in_addr int_addr;
+	struct net_if *iface;
+	k_spinlock_key_t key;
+	struct nat_pkt np;
+	u16_t int_port;
+	u32_t now;
+
+	if (!ext_iface || net_pkt_iface(pkt) != ext_iface) {
+		return false;
+	}
+
+	if (nat_parse(pkt, false, &np) < 0 ||
+	    ntohs(np.tuple.dst_port) < CONFIG_NET_IPV4_NAT_PORT_MIN ||
+	    ntohs(np.tuple.dst_port) > CONFIG_NET_IPV4_NAT_PORT_MAX ||
+	    !net_if_ipv4_addr_lookup(&np.tuple.dst, &iface) ||
+	    iface != ext_iface) {
+		goto not_translated;
+	}
+
+	now = k_uptime_get_32();
+
+	key = k_spin_lock(&lock);
+
+	conn = conn_find_ext(np.tuple.proto, np.tuple.dst_port, now);
+	if (!conn || conn->rem_port != np.tuple.src_port ||
+	    !net_ipv4_addr_cmp(&conn->rem_addr, &np.tuple.src)) {
+		/* Only the remote host of the connection can reply */
+		k_spin_unlock(&lock, key);
+		goto not_translated;
+	}
+
+	conn_update(conn, &np, false, now);
+	net_ipaddr_copy(&int_addr, &conn->int_addr);
+	int_port = conn->int_port;
+
+	k_spin_unlock(&lock, key);
+
+	nat_rewrite(&np, false, &int_addr, int_port);
+
+	return true;
+
+not_translated:
+	/* The packet is processed as usual, from the IPv4 header */
+	net_pkt_cursor_init(pkt);
+
+	return false;
+}
+
+static void conns_flush(void)
+{
+	int i;
+
+	sys_slist_init(&free_conns);
+
+	for (i = 0; i < NAT_HASH_SIZE; i++) {
+		sys_slist_init(&int_hash[i]);
+		sys_slist_init(&ext_hash[i]);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(conns); i++) {
+		sys_slist_append(&free_conns, &conns[i].int_node);
+	}
+}
+
+int net_ipv4_nat_enable(struct net_if *iface)
+{
+	k_spinlock_key_t key;
+
+	if (!iface) {
+		return -EINVAL;
+	}
+
+	key = k_spin_lock(&lock);
+
+	conns_flush();
+	ext_iface = iface;
+
+	k_spin_unlock(&lock, key);
+
+	NET_DBG("Translating connections out of iface %p", iface);
+
+	return 0;
+}
+
+void net_ipv4_nat_disable(void)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&lock);
+
+	ext_iface = NULL;
+	conns_flush();
+
+	k_spin_unlock(&lock, key);
+}
+
+void net_ipv4_nat_init(void)
+{
+	conns_flush();
+
+	/* Start from a random port, so that the ports are harder to guess */
+	next_port = sys_rand32_get() % NAT_PORT_COUNT;
+
+	NET_DBG("Allocated %d NAT connections (%zu bytes)",
+		CONFIG_NET_IPV4_NAT_MAX_CONNS,
+		sizeof(conns) + sizeof(int_hash) + sizeof(ext_hash));
+}
@@ -27,23 +27,7 @@ LOG_MODULE_DECLARE(net_ipv6, CONFIG_NET_IPV6_LOG_LEVEL);
 #include "6lo.h"
 #include "route.h"
 #include "net_stats.h"
-
-/* Timeout for various buffer allocations in this file. */
-#define NET_BUF_TIMEOUT K_MSEC(50)
-
-#if defined(CONFIG_NET_IPV6_FRAGMENT_TIMEOUT)
-#define IPV6_REASSEMBLY_TIMEOUT K_SECONDS(CONFIG_NET_IPV6_FRAGMENT_TIMEOUT)
-#else
-#define IPV6_REASSEMBLY_TIMEOUT K_SECONDS(5)
-#endif /* CONFIG_NET_IPV6_FRAGMENT_TIMEOUT */
-
-#define FRAG_BUF_WAIT K_MSEC(10) /* how long to max wait for a buffer */
-
-static void reassembly_timeout(struct k_work *work);
-static bool reassembly_init_done;
-
-static struct net_ipv6_reassembly
-reassembly[CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT];
+#include "ip_fragment.h"
 
 int net_ipv6_find_last_ext_hdr(struct net_pkt *pkt, u16_t *next_hdr_off,
 			       u16_t *last_hdr_off)
@@ -119,110 +103,10 @@ fail:
 	return -EINVAL;
 }
 
-static struct net_ipv6_reassembly *reassembly_get(u32_t id,
-						  struct in6_addr *src,
-						  struct in6_addr *dst)
-{
-	int i, avail = -1;
-
-	for (i = 0; i < CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT; i++) {
-
-		if (k_delayed_work_remaining_get(&reassembly[i].timer) &&
-		    reassembly[i].id == id &&
-		    net_ipv6_addr_cmp(src, &reassembly[i].src) &&
-		    net_ipv6_addr_cmp(dst, &reassembly[i].dst)) {
-			return &reassembly[i];
-		}
-
-		if (k_delayed_work_remaining_get(&reassembly[i].timer)) {
-			continue;
-		}
-
-		if (avail < 0) {
-			avail = i;
-		}
-	}
-
-	if (avail < 0) {
-		return NULL;
-	}
-
-	k_delayed_work_submit(&reassembly[avail].timer,
-			      IPV6_REASSEMBLY_TIMEOUT);
-
-	net_ipaddr_copy(&reassembly[avail].src, src);
-	net_ipaddr_copy(&reassembly[avail].dst, dst);
-
-	reassembly[avail].id = id;
-
-	return &reassembly[avail];
-}
-
-static bool reassembly_cancel(u32_t id,
-			      struct in6_addr *src,
-			      struct in6_addr *dst)
-{
-	int i, j;
-
-	NET_DBG("Cancel 0x%x", id);
-
-	for (i = 0; i < CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT; i++) {
-		s32_t remaining;
-
-		if (reassembly[i].id != id ||
-		    !net_ipv6_addr_cmp(src, &reassembly[i].src) ||
-		    !net_ipv6_addr_cmp(dst, &reassembly[i].dst)) {
-			continue;
-		}
-
-		remaining = k_delayed_work_remaining_get(&reassembly[i].timer);
-		if (remaining) {
-			k_delayed_work_cancel(&reassembly[i].timer);
-		}
-
-		NET_DBG("IPv6 reassembly id 0x%x remaining %d ms",
-			reassembly[i].id, remaining);
-
-		reassembly[i].id = 0U;
-
-		for (j = 0; j < NET_IPV6_FRAGMENTS_MAX_PKT; j++) {
-			if (!reassembly[i].pkt[j]) {
-				continue;
-			}
-
-			NET_DBG("[%d] IPv6 reassembly pkt %p %zd bytes data",
-				j, reassembly[i].pkt[j],
-				net_pkt_get_len(reassembly[i].pkt[j]));
-
-			net_pkt_unref(reassembly[i].pkt[j]);
-			reassembly[i].pkt[j] = NULL;
-		}
-
-		return true;
-	}
-
-	return false;
-}
-
-static void reassembly_info(char *str, struct net_ipv6_reassembly *reass)
-{
-	NET_DBG("%s id 0x%x src %s dst %s remain %d ms", str, reass->id,
-		log_strdup(net_sprint_ipv6_addr(&reass->src)),
-		log_strdup(net_sprint_ipv6_addr(&reass->dst)),
-		k_delayed_work_remaining_get(&reass->timer));
-}
-
-static void reassembly_timeout(struct k_work *work)
-{
-	struct net_ipv6_reassembly *reass =
-		CONTAINER_OF(work, struct net_ipv6_reassembly, timer);
-
-	reassembly_info("Reassembly cancelled", reass);
-
-	reassembly_cancel(reass->id, &reass->src, &reass->dst);
-}
-
-static void reassemble_packet(struct net_ipv6_reassembly *reass)
+/* Remove the fragment header from the reassembled packet, fix its IPv6
+ * header and feed it back to the IP stack.
+ */
+static void reassembly_finish(struct net_pkt *pkt)
 {
 	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv6_access, struct net_ipv6_hdr);
 	NET_PKT_DATA_ACCESS_DEFINE(frag_access, struct net_ipv6_frag_hdr);
@@ -230,59 +114,10 @@ static void reassemble_packet(struct net_ipv6_reassembly *reass)
 		struct net_ipv6_hdr *hdr;
 		struct net_ipv6_frag_hdr *frag_hdr;
 	} ipv6;
-
-	struct net_pkt *pkt;
-	struct net_buf *last;
 	u8_t next_hdr;
-	int i, len;
-
-	k_delayed_work_cancel(&reass->timer);
-
-	NET_ASSERT(reass->pkt[0]);
-
-	last = net_buf_frag_last(reass->pkt[0]->buffer);
-
-	/* We start from 2nd packet which is then appended to
-	 * the first one.
-	 */
-	for (i = 1; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
-		int removed_len;
-
-		pkt = reass->pkt[i];
-
-		net_pkt_cursor_init(pkt);
-
-		/* Get rid of IPv6 and fragment header which are at
-		 * the beginning of the fragment.
-		 */
-		removed_len = net_pkt_ipv6_fragment_start(pkt) +
-			      sizeof(struct net_ipv6_frag_hdr);
-
-		NET_DBG("Removing %d bytes from start of pkt %p",
-			removed_len, pkt->buffer);
-
-		if (net_pkt_pull(pkt, removed_len)) {
-			NET_ERR("Failed to pull headers");
-			reassembly_cancel(reass->id, &reass->src, &reass->dst);
-			return;
-		}
-
-		/* Attach the data to previous pkt */
-		last->frags = pkt->buffer;
-		last = net_buf_frag_last(pkt->buffer);
+	int len;
 
-		pkt->buffer = NULL;
-		reass->pkt[i] = NULL;
-
-		net_pkt_unref(pkt);
-	}
-
-	pkt = reass->pkt[0];
-	reass->pkt[0] = NULL;
-
-	/* Next we need to strip away the fragment header from the first packet
-	 * and set the various pointers and values in packet.
-	 */
+	net_pkt_set_overwrite(pkt, true);
 	net_pkt_cursor_init(pkt);
 
 	if (net_pkt_skip(pkt, net_pkt_ipv6_fragment_start(pkt))) {
@@ -349,104 +184,15 @@ error:
 	net_pkt_unref(pkt);
 }
 
-void net_ipv6_frag_foreach(net_ipv6_frag_cb_t cb, void *user_data)
-{
-	int i;
-
-	for (i = 0; reassembly_init_done &&
-		     i < CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT; i++) {
-		if (!k_delayed_work_remaining_get(&reassembly[i].timer)) {
-			continue;
-		}
-
-		cb(&reassembly[i], user_data);
-	}
-}
-
-/* Verify that we have all the fragments received and in correct order.
- */
-static bool fragment_verify(struct net_ipv6_reassembly *reass)
-{
-	u16_t offset;
-	int i, prev_len;
-
-	prev_len = net_pkt_get_len(reass->pkt[0]);
-	offset = net_pkt_ipv6_fragment_offset(reass->pkt[0]);
-
-	NET_DBG("pkt %p offset %u", reass->pkt[0], offset);
-
-	if (offset != 0U) {
-		return false;
-	}
-
-	for (i = 1; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
-		offset = net_pkt_ipv6_fragment_offset(reass->pkt[i]);
-
-		NET_DBG("pkt %p offset %u prev_len %d", reass->pkt[i],
-			offset, prev_len);
-
-		if (prev_len < offset) {
-			/* Something wrong with the offset value */
-			return false;
-		}
-
-		prev_len = net_pkt_get_len(reass->pkt[i]);
-	}
-
-	return true;
-}
-
-static int shift_packets(struct net_ipv6_reassembly *reass, int pos)
-{
-	int i;
-
-	for (i = pos + 1; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
-		if (!reass->pkt[i]) {
-			NET_DBG("Moving [%d] %p (offset 0x%x) to [%d]",
-				pos, reass->pkt[pos],
-				net_pkt_ipv6_fragment_offset(reass->pkt[pos]),
-				i);
-
-			/* Do we have enough space in packet array to make
-			 * the move?
-			 */
-			if (((i - pos) + 1) >
-			    (NET_IPV6_FRAGMENTS_MAX_PKT - i)) {
-				return -ENOMEM;
-			}
-
-			memmove(&reass->pkt[i], &reass->pkt[pos],
-				sizeof(void *) * (i - pos));
-
-			return 0;
-		}
-	}
-
-	return -EINVAL;
-}
-
 enum net_verdict net_ipv6_handle_fragment_hdr(struct net_pkt *pkt,
 					      struct net_ipv6_hdr *hdr,
 					      u8_t nexthdr)
 {
-	struct net_ipv6_reassembly *reass = NULL;
+	struct net_ip_frag_info info;
+	struct net_pkt *reassembled;
+	enum net_verdict verdict;
 	u16_t flag;
-	bool found;
-	u8_t more;
 	u32_t id;
-	int i;
-
-	if (!reassembly_init_done) {
-		/* Static initializing does not work here because of the array
-		 * so we must do it at runtime.
-		 */
-		for (i = 0; i < CONFIG_NET_IPV6_FRAGMENT_MAX_COUNT; i++) {
-			k_delayed_work_init(&reassembly[i].timer,
-					    reassembly_timeout);
-		}
-
-		reassembly_init_done = true;
-	}
 
 	/* Each fragment has a fragment header, however since we already
 	 * read the nexthdr part of it, we are not going to use
@@ -456,109 +202,39 @@ enum net_verdict net_ipv6_handle_fragment_hdr(struct net_pkt *pkt,
 	if (net_pkt_skip(pkt, 1) || /* reserved */
 	    net_pkt_read_be16(pkt, &flag) ||
 	    net_pkt_read_be32(pkt, &id)) {
-		goto drop;
-	}
-
-	reass = reassembly_get(id, &hdr->src, &hdr->dst);
-	if (!reass) {
-		NET_DBG("Cannot get reassembly slot, dropping pkt %p", pkt);
-		goto drop;
+		return NET_DROP;
 	}
 
-	more = flag & 0x01;
 	net_pkt_set_ipv6_fragment_offset(pkt, flag & 0xfff8);
 
-	if (!reass->pkt[0]) {
-		NET_DBG("Storing pkt %p to slot %d offset %d",
-			pkt, 0, net_pkt_ipv6_fragment_offset(pkt));
-		reass->pkt[0] = pkt;
-
-		reassembly_info("Reassembly 1st pkt", reass);
-
-		/* Wait for more fragments to receive. */
-		goto accept;
-	}
-
-	/* The fragments might come in wrong order so place them
-	 * in reassembly chain in correct order.
-	 */
-	for (i = 0, found = false; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
-		if (reass->pkt[i]) {
-			if (net_pkt_ipv6_fragment_offset(reass->pkt[i]) <
-			    net_pkt_ipv6_fragment_offset(pkt)) {
-				continue;
-			}
-
-			/* Make room for this fragment. If there is no room,
-			 * then it will discard the whole reassembly.
-			 */
-			if (shift_packets(reass, i)) {
-				break;
-			}
-		}
-
-		NET_DBG("Storing pkt %p to slot %d offset %d",
-			pkt, i, net_pkt_ipv6_fragment_offset(pkt));
-		reass->pkt[i] = pkt;
-		found = true;
-
-		break;
-	}
-
-	if (!found) {
-		/* We could not add this fragment into our saved fragment
-		 * list. We must discard the whole packet at this point.
+	info.src = &hdr->src;
+	info.dst = &hdr->dst;
+	info.id = id;
+	info.offset = flag & 0xfff8;
+	info.hdr_len = net_pkt_ipv6_fragment_start(pkt) +
+		       sizeof(struct net_ipv6_frag_hdr);
+	info.family = AF_INET6;
+	info.proto = 0U;
+	info.more = flag & 0x01;
+
+	if (info.more && (net_pkt_get_len(pkt) - info.hdr_len) % 8) {
+		/* Fragment length is not multiple of 8, discard
+		 * the packet and send parameter problem error
+		 * pointing to the payload length (RFC 8200 ch 4.5).
 		 */
-		NET_DBG("No slots available for 0x%x", reass->id);
-		net_pkt_unref(pkt);
-		goto drop;
-	}
-
-	if (more) {
-		if (net_pkt_get_len(pkt) % 8) {
-			/* Fragment length is not multiple of 8, discard
-			 * the packet and send parameter problem error.
-			 */
-			net_icmpv6_send_error(pkt, NET_ICMPV6_PARAM_PROBLEM,
-					      NET_ICMPV6_PARAM_PROB_OPTION, 0);
-			goto drop;
-		}
-
-		reassembly_info("Reassembly nth pkt", reass);
-
-		NET_DBG("More fragments to be received");
-		goto accept;
-	}
-
-	reassembly_info("Reassembly last pkt", reass);
-
-	if (!fragment_verify(reass)) {
-		NET_DBG("Reassembled IPv6 verify failed, dropping id %u",
-			reass->id);
-
-		/* Let the caller release the already inserted pkt */
-		if (i < NET_IPV6_FRAGMENTS_MAX_PKT) {
-			reass->pkt[i] = NULL;
-		}
-
-		net_pkt_unref(pkt);
-		goto drop;
+		net_icmpv6_send_error(pkt, NET_ICMPV6_PARAM_PROBLEM,
+				      NET_ICMPV6_PARAM_PROB_HEADER,
+				      offsetof(struct net_ipv6_hdr, len));
+		return NET_DROP;
 	}
 
-	/* The last fragment received, reassemble the packet */
-	reassemble_packet(reass);
-
-accept:
-	return NET_OK;
-
-drop:
-	if (reass) {
-		if (reassembly_cancel(reass->id, &reass->src, &reass->dst)) {
-			return NET_OK;
-		}
+	verdict = net_ip_reassembly_add(&info, pkt, &reassembled);
+	if (verdict == NET_OK && reassembled) {
+		/* The last fragment received, reassemble the packet */
+		reassembly_finish(reassembled);
 	}
 
-	return NET_DROP;
+	return verdict;
 }
 
 #define BUF_ALLOC_TIMEOUT K_MSEC(100)
@@ -576,7 +252,7 @@ static int send_ipv6_fragment(struct net_pkt *pkt,
 	struct net_ipv6_frag_hdr *frag_hdr;
 	struct net_pkt *frag_pkt;
 
-	frag_pkt = net_pkt_alloc_with_buffer(net_pkt_iface(pkt), fit_len +
+	frag_pkt = net_pkt_alloc_with_buffer(net_pkt_iface(pkt),
 					     net_pkt_ipv6_ext_len(pkt) +
 					     NET_IPV6_FRAGH_LEN,
 					     AF_INET6, 0, BUF_ALLOC_TIMEOUT);
@@ -621,14 +297,20 @@ static int send_ipv6_fragment(struct net_pkt *pkt,
 				 net_pkt_ipv6_ext_len(pkt) +
 				 sizeof(struct net_ipv6_frag_hdr));
 
-	/* Finally we copy the payload part of this fragment from
-	 * the original packet
+	/* Finally we append the payload part of this fragment, which
+	 * references the data of the original packet.
 	 */
-	if (net_pkt_skip(pkt, frag_offset) ||
-	    net_pkt_copy(frag_pkt, pkt, fit_len)) {
+	if (net_pkt_skip(pkt, frag_offset)) {
+		goto fail;
+	}
+
+	ret = net_ip_frag_append_payload(frag_pkt, pkt, fit_len);
+	if (ret < 0) {
 		goto fail;
 	}
 
+	ret = -ENOBUFS;
+
 	net_pkt_cursor_init(frag_pkt);
 
 	if (net_ipv6_finalize(frag_pkt, frag_pkt_next_hdr) < 0) {
@@ -674,6 +356,8 @@ int net_ipv6_send_fragmented_pkt(struct net_if *iface, struct net_pkt *pkt,
 		return ret;
 	}
 
+	net_pkt_set_overwrite(pkt, true);
+
 	net_pkt_cursor_init(pkt);
 
 	if (net_pkt_skip(pkt, next_hdr_off) ||
@@ -683,6 +367,12 @@ int net_ipv6_send_fragmented_pkt(struct net_if *iface, struct net_pkt *pkt,
 		return -ENOBUFS;
 	}
 
+	/* The device cannot finish a checksum spread over the fragments */
+	ret = net_ip_frag_finish_chksum(pkt, next_hdr, last_hdr_off);
+	if (ret < 0) {
+		return ret;
+	}
+
 	/* The Maximum payload can fit into each packet after IPv6 header,
 	 * Extenstion headers and Fragmentation header.
 	 */
@@ -117,11 +117,84 @@ const char *net_ipv6_nbr_state2str(enum net_ipv6_nbr_state state)
 	return "<invalid state>";
 }
 
+/* Neighbors are also linked in a hash table indexed by IPv6 address, so
+ * that the lookup done for every sent packet does not need to go through
+ * the whole pool. The chains hold pool indexes. An entry is moved to its
+ * new chain when it is reused, and released entries are skipped by the
+ * lookup until then.
+ */
+#define NBR_HASH_SIZE CONFIG_NET_IPV6_MAX_NEIGHBORS
+#define NBR_HASH_END 0xff
+
+static u8_t nbr_hash[NBR_HASH_SIZE] = {
+	[0 ... (NBR_HASH_SIZE - 1)] = NBR_HASH_END,
+};
+
+static u8_t nbr_hash_next[CONFIG_NET_IPV6_MAX_NEIGHBORS];
+
+static u8_t nbr_hash_bucket[CONFIG_NET_IPV6_MAX_NEIGHBORS] = {
+	[0 ... (CONFIG_NET_IPV6_MAX_NEIGHBORS - 1)] = NBR_HASH_END,
+};
+
 static inline struct net_nbr *get_nbr(int idx)
 {
 	return &net_neighbor_pool[idx].nbr;
 }
 
+static inline int get_nbr_idx(struct net_nbr *nbr)
+{
+	return ((u8_t *)nbr - (u8_t *)net_neighbor_pool) /
+		sizeof(net_neighbor_pool[0]);
+}
+
+static u8_t nbr_hash_get(const struct in6_addr *addr)
+{
+	u32_t hash = UNALIGNED_GET(&addr->s6_addr32[2]) ^
+		     UNALIGNED_GET(&addr->s6_addr32[3]);
+
+	hash *= 0x9e3779b1U;
+
+	return (hash >> 16) % NBR_HASH_SIZE;
+}
+
+static void nbr_hash_remove(int idx)
+{
+	u8_t *link;
+
+	if (nbr_hash_bucket[idx] == NBR_HASH_END) {
+		return;
+	}
+
+	link = &nbr_hash[nbr_hash_bucket[idx]];
+
+	while (*link != NBR_HASH_END) {
+		if (*link == idx) {
+			*link = nbr_hash_next[idx];
+			break;
+		}
+
+		link = &nbr_hash_next[*link];
+	}
+
+	nbr_hash_bucket[idx] = NBR_HASH_END;
+}
+
+static void nbr_hash_add(struct net_nbr *nbr)
+{
+	int idx = get_nbr_idx(nbr);
+	u8_t bucket = nbr_hash_get(&net_ipv6_nbr_data(nbr)->addr);
+
+	if (nbr_hash_bucket[idx] == bucket) {
+		return;
+	}
+
+	nbr_hash_remove(idx);
+
+	nbr_hash_next[idx] = nbr_hash[bucket];
+	nbr_hash[bucket] = idx;
+	nbr_hash_bucket[idx] = bucket;
+}
+
 static inline struct net_nbr *get_nbr_from_data(struct net_ipv6_nbr_data *data)
 {
 	int i;
@@ -259,9 +332,10 @@ static struct net_nbr *nbr_lookup(struct net_nbr_table *table,
 				  struct net_if *iface,
 				  const struct in6_addr *addr)
 {
-	int i;
+	u8_t i;
 
-	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+	for (i = nbr_hash[nbr_hash_get(addr)]; i != NBR_HASH_END;
+	     i = nbr_hash_next[i]) {
 		struct net_nbr *nbr = get_nbr(i);
 
 		if (!nbr->ref) {
@@ -408,6 +482,8 @@ static void nbr_init(struct net_nbr *nbr, struct net_if *iface,
 	nbr->iface = iface;
 
 	net_ipaddr_copy(&net_ipv6_nbr_data(nbr)->addr, addr);
+	nbr_hash_add(nbr);
+
 	ipv6_nbr_set_state(nbr, state);
 	net_ipv6_nbr_data(nbr)->is_router = is_router;
 	net_ipv6_nbr_data(nbr)->pending = NULL;
@@ -542,6 +618,8 @@ static void ipv6_nd_remove_old_stale_nbr(void)
 			return;
 		}
 
+		net_stats_update_ipv6_nbr_evict(nbr->iface);
+
 		net_ipv6_nbr_rm(nbr->iface,
 				&net_ipv6_nbr_data(nbr)->addr);
 	}
@@ -787,9 +865,11 @@ enum net_verdict net_ipv6_prepare_for_send(struct net_pkt *pkt)
 
 #if defined(CONFIG_NET_IPV6_FRAGMENT)
 	/* If we have already fragmented the packet, the fragment id will
-	 * contain a proper value and we can skip other checks.
+	 * contain a proper value and we can skip other checks. Packets
+	 * built for segmentation offload are split into TCP segments
+	 * instead.
 	 */
-	if (net_pkt_ipv6_fragment_id(pkt) == 0U) {
+	if (net_pkt_ipv6_fragment_id(pkt) == 0U && !net_pkt_gso_size(pkt)) {
 		u16_t mtu = net_if_get_mtu(net_pkt_iface(pkt));
 		size_t pkt_len = net_pkt_get_len(pkt);
 
@@ -901,6 +981,8 @@ try_send:
 	if (nbr && nbr->idx != NET_NBR_LLADDR_UNKNOWN) {
 		struct net_linkaddr_storage *lladdr;
 
+		net_stats_update_ipv6_nbr_hit(net_pkt_iface(pkt));
+
 		lladdr = net_nbr_get_lladdr(nbr->idx);
 
 		net_pkt_lladdr_dst(pkt)->addr = lladdr->addr;
@@ -924,6 +1006,8 @@ try_send:
 		return NET_OK;
 	}
 
+	net_stats_update_ipv6_nbr_miss(net_pkt_iface(pkt));
+
 #if defined(CONFIG_NET_IPV6_ND)
 	/* We need to send NS and wait for NA before sending the packet. */
 	ret = net_ipv6_send_ns(net_pkt_iface(pkt), pkt,
@@ -1439,6 +1523,7 @@ static void ipv6_nd_reachable_timeout(struct k_work *work)
 
 		case NET_IPV6_NBR_STATE_INCOMPLETE:
 			if (data->ns_count >= MAX_MULTICAST_SOLICIT) {
+				net_stats_update_ipv6_nbr_expire(nbr->iface);
 				net_ipv6_nbr_rm(nbr->iface, &data->addr);
 			} else {
 				data->ns_count++;
@@ -1468,6 +1553,7 @@ static void ipv6_nd_reachable_timeout(struct k_work *work)
 			NET_DBG("nbr %p removing stale address %s",
 				nbr,
 				log_strdup(net_sprint_ipv6_addr(&data->addr)));
+			net_stats_update_ipv6_nbr_expire(nbr->iface);
 			net_ipv6_nbr_rm(nbr->iface, &data->addr);
 			break;
 
@@ -1484,6 +1570,7 @@ static void ipv6_nd_reachable_timeout(struct k_work *work)
 
 		case NET_IPV6_NBR_STATE_PROBE:
 			if (data->ns_count >= MAX_UNICAST_SOLICIT) {
+				net_stats_update_ipv6_nbr_expire(nbr->iface);
 				net_ipv6_nbr_rm(nbr->iface, &data->addr);
 			} else {
 				data->ns_count++;
@@ -0,0 +1,720 @@
+/** @file
+ * @brief Classic BPF packet filters
+ *
+ * Interpreter for classic BPF programs, and the filters run on the packets
+ * received by network interfaces and packet sockets. The programs are
+ * checked when they are attached, so the interpreter does not need to
+ * check the jumps or the scratch memory accesses.
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_bpf, CONFIG_NET_BPF_LOG_LEVEL);
+
+#include <kernel.h>
+#include <string.h>
+#include <sys/byteorder.h>
+
+#include <net/net_core.h>
+#include <net/net_pkt.h>
+#include <net/net_if.h>
+#include <net/bpf.h>
+
+#include "net_private.h"
+
+/* Protects the filter lists of the interfaces, the socket filters and the
+ * number of packets each filter is running on. Filters run without it, on
+ * a reference taken with it held, and detaching a filter waits for these
+ * runs to end.
+ */
+static struct k_spinlock lock;
+
+#if CONFIG_NET_BPF_SOCK_FILTERS > 0
+struct bpf_sock_filter {
+	struct net_bpf_filter filter;
+	struct sock_filter insns[CONFIG_NET_BPF_MAX_INSNS];
+};
+
+K_MEM_SLAB_DEFINE(sock_filters, sizeof(struct bpf_sock_filter),
+		  CONFIG_NET_BPF_SOCK_FILTERS, 4);
+#endif
+
+static bool insn_is_valid(u16_t code)
+{
+	switch (code) {
+	case BPF_LD | BPF_W | BPF_ABS:
+	case BPF_LD | BPF_H | BPF_ABS:
+	case BPF_LD | BPF_B | BPF_ABS:
+	case BPF_LD | BPF_W | BPF_IND:
+	case BPF_LD | BPF_H | BPF_IND:
+	case BPF_LD | BPF_B | BPF_IND:
+	case BPF_LD | BPF_W | BPF_LEN:
+	case BPF_LD | BPF_IMM:
+	case BPF_LD | BPF_MEM:
+	case BPF_LDX | BPF_W | BPF_LEN:
+	case BPF_LDX | BPF_B | BPF_MSH:
+	case BPF_LDX | BPF_IMM:
+	case BPF_LDX | BPF_MEM:
+	case BPF_ST:
+	case BPF_STX:
+	case BPF_ALU | BPF_ADD | BPF_K:
+	case BPF_ALU | BPF_ADD | BPF_X:
+	case BPF_ALU | BPF_SUB | BPF_K:
+	case BPF_ALU | BPF_SUB | BPF_X:
+	case BPF_ALU | BPF_MUL | BPF_K:
+	case BPF_ALU | BPF_MUL | BPF_X:
+	case BPF_ALU | BPF_DIV | BPF_K:
+	case BPF_ALU | BPF_DIV | BPF_X:
+	case BPF_ALU | BPF_MOD | BPF_K:
+	case BPF_ALU | BPF_MOD | BPF_X:
+	case BPF_ALU | BPF_AND | BPF_K:
+	case BPF_ALU | BPF_AND | BPF_X:
+	case BPF_ALU | BPF_OR | BPF_K:
+	case BPF_ALU | BPF_OR | BPF_X:
+	case BPF_ALU | BPF_XOR | BPF_K:
+	case BPF_ALU | BPF_XOR | BPF_X:
+	case BPF_ALU | BPF_LSH | BPF_K:
+	case BPF_ALU | BPF_LSH | BPF_X:
+	case BPF_ALU | BPF_RSH | BPF_K:
+	case BPF_ALU | BPF_RSH | BPF_X:
+	case BPF_ALU | BPF_NEG:
+	case BPF_JMP | BPF_JA:
+	case BPF_JMP | BPF_JEQ | BPF_K:
+	case BPF_JMP | BPF_JEQ | BPF_X:
+	case BPF_JMP | BPF_JGT | BPF_K:
+	case BPF_JMP | BPF_JGT | BPF_X:
+	case BPF_JMP | BPF_JGE | BPF_K:
+	case BPF_JMP | BPF_JGE | BPF_X:
+	case BPF_JMP | BPF_JSET | BPF_K:
+	case BPF_JMP | BPF_JSET | BPF_X:
+	case BPF_RET | BPF_K:
+	case BPF_RET | BPF_A:
+	case BPF_MISC | BPF_TAX:
+	case BPF_MISC | BPF_TXA:
+		return true;
+	}
+
+	return false;
+}
+
+int net_bpf_check(const struct sock_filter *insns, u16_t len)
+{
+	const struct sock_filter *insn;
+	u16_t pc;
+
+	if (!insns || len == 0U || len > CONFIG_NET_BPF_MAX_INSNS) {
+		return -EINVAL;
+	}
+
+	for (pc = 0U; pc < len; pc++) {
+		/* Instructions a jump from here can skip */
+		u32_t remain = len - pc - 1U;
+
+		insn = &insns[pc];
+
+		if (!insn_is_valid(insn->code)) {
+			NET_DBG("Invalid instruction 0x%04x at %u",
+				insn->code, pc);
+			return -EINVAL;
+		}
+
+		switch (BPF_CLASS(insn->code)) {
+		case BPF_LD:
+		case BPF_LDX:
+			if (BPF_MODE(insn->code) == BPF_MEM &&
+			    insn->k >= BPF_MEMWORDS) {
+				return -EINVAL;
+			}
+
+			break;
+		case BPF_ST:
+		case BPF_STX:
+			if (insn->k >= BPF_MEMWORDS) {
+				return -EINVAL;
+			}
+
+			break;
+		case BPF_ALU:
+			if (BPF_SRC(insn->code) != BPF_K) {
+				break;
+			}
+
+			if ((BPF_OP(insn->code) == BPF_DIV ||
+			     BPF_OP(insn->code) == BPF_MOD) && insn->k == 0U) {
+				return -EINVAL;
+			}
+
+			if ((BPF_OP(insn->code) == BPF_LSH ||
+			     BPF_OP(insn->code) == BPF_RSH) && insn->k >= 32U) {
+				return -EINVAL;
+			}
+
+			break;
+		case BPF_JMP:
+			if (BPF_OP(insn->code) == BPF_JA) {
+				if (insn->k >= remain) {
+					return -EINVAL;
+				}
+			} else if (insn->jt >= remain || insn->jf >= remain) {
+				return -EINVAL;
+			}
+
+			break;
+		}
+	}
+
+	if (BPF_CLASS(insns[len - 1].code) != BPF_RET) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* Pointer to len bytes of packet data at offset, copied to buf if they
+ * are not contiguous. NULL if they are not all in the packet.
+ */
+static const u8_t *pkt_data(struct net_pkt *pkt, u32_t offset, u8_t len,
+			    u8_t *buf)
+{
+	struct net_buf *frag = pkt->buffer;
+	u8_t copied = 0U;
+	u16_t count;
+
+	while (frag && offset >= frag->len) {
+		offset -= frag->len;
+		frag = frag->frags;
+	}
+
+	if (!frag) {
+		return NULL;
+	}
+
+	if (frag->len - offset >= len) {
+		return frag->data + offset;
+	}
+
+	while (copied < len) {
+		if (!frag) {
+			return NULL;
+		}
+
+		count = MIN(len - copied, frag->len - offset);
+		memcpy(buf + copied, frag->data + offset, count);
+
+		copied += count;
+		offset = 0U;
+		frag = frag->frags;
+	}
+
+	return buf;
+}
+
+static bool pkt_load(struct net_pkt *pkt, u32_t offset, u16_t size, u32_t *val)
+{
+	const u8_t *ptr;
+	u8_t buf[4];
+
+	switch (size) {
+	case BPF_W:
+		ptr = pkt_data(pkt, offset, 4, buf);
+		if (ptr) {
+			*val = sys_get_be32(ptr);
+		}
+
+		break;
+	case BPF_H:
+		ptr = pkt_data(pkt, offset, 2, buf);
+		if (ptr) {
+			*val = sys_get_be16(ptr);
+		}
+
+		break;
+	default:
+		ptr = pkt_data(pkt, offset, 1, buf);
+		if (ptr) {
+			*val = *ptr;
+		}
+
+		break;
+	}
+
+	return ptr != NULL;
+}
+
+static u32_t bpf_exec(const struct sock_filter *insn, struct net_pkt *pkt)
+{
+	u32_t mem[BPF_MEMWORDS] = { 0 };
+	u32_t a = 0U;
+	u32_t x = 0U;
+	u32_t offset;
+
+	/* The program has been checked: it ends with a return, and the jumps
+	 * stay inside of it and only go forward.
+	 */
+	for (;; insn++) {
+		switch (insn->code) {
+		case BPF_LD | BPF_W | BPF_ABS:
+		case BPF_LD | BPF_H | BPF_ABS:
+		case BPF_LD | BPF_B | BPF_ABS:
+			if (!pkt_load(pkt, insn->k, BPF_SIZE(insn->code), &a)) {
+				return 0;
+			}
+
+			break;
+		case BPF_LD | BPF_W | BPF_IND:
+		case BPF_LD | BPF_H | BPF_IND:
+		case BPF_LD | BPF_B | BPF_IND:
+			offset = x + insn->k;
+			if (offset < x ||
+			    !pkt_load(pkt, offset, BPF_SIZE(insn->code), &a)) {
+				return 0;
+			}
+
+			break;
+		case BPF_LDX | BPF_B | BPF_MSH:
+			if (!pkt_load(pkt, insn->k, BPF_B, &x)) {
+				return 0;
+			}
+
+			x = (x & 0x0f) << 2;
+			break;
+		case BPF_LD | BPF_W | BPF_LEN:
+			a = net_pkt_get_len(pkt);
+			break;
+		case BPF_LDX | BPF_W | BPF_LEN:
+			x = net_pkt_get_len(pkt);
+			break;
+		case BPF_LD | BPF_IMM:
+			a = insn->k;
+			break;
+		case BPF_LDX | BPF_IMM:
+			x = insn->k;
+			break;
+		case BPF_LD | BPF_MEM:
+			a = mem[insn->k];
+			break;
+		case BPF_LDX | BPF_MEM:
+			x = mem[insn->k];
+			break;
+		case BPF_ST:
+			mem[insn->k] = a;
+			break;
+		case BPF_STX:
+			mem[insn->k] = x;
+			break;
+		case BPF_ALU | BPF_ADD | BPF_K:
+			a += insn->k;
+			break;
+		case BPF_ALU | BPF_ADD | BPF_X:
+			a += x;
+			break;
+		case BPF_ALU | BPF_SUB | BPF_K:
+			a -= insn->k;
+			break;
+		case BPF_ALU | BPF_SUB | BPF_X:
+			a -= x;
+			break;
+		case BPF_ALU | BPF_MUL | BPF_K:
+			a *= insn->k;
+			break;
+		case BPF_ALU | BPF_MUL | BPF_X:
+			a *= x;
+			break;
+		case BPF_ALU | BPF_DIV | BPF_K:
+			a /= insn->k;
+			break;
+		case BPF_ALU | BPF_DIV | BPF_X:
+			if (x == 0U) {
+				return 0;
+			}
+
+			a /= x;
+			break;
+		case BPF_ALU | BPF_MOD | BPF_K:
+			a %= insn->k;
+			break;
+		case BPF_ALU | BPF_MOD | BPF_X:
+			if (x == 0U) {
+				return 0;
+			}
+
+			a %= x;
+			break;
+		case BPF_ALU | BPF_AND | BPF_K:
+			a &= insn->k;
+			break;
+		case BPF_ALU | BPF_AND | BPF_X:
+			a &= x;
+			break;
+		case BPF_ALU | BPF_OR | BPF_K:
+			a |= insn->k;
+			break;
+		case BPF_ALU | BPF_OR | BPF_X:
+			a |= x;
+			break;
+		case BPF_ALU | BPF_XOR | BPF_K:
+			a ^= insn->k;
+			break;
+		case BPF_ALU | BPF_XOR | BPF_X:
+			a ^= x;
+			break;
+		case BPF_ALU | BPF_LSH | BPF_K:
+			a <<= insn->k;
+			break;
+		case BPF_ALU | BPF_LSH | BPF_X:
+			a = x < 32U ? a << x : 0U;
+			break;
+		case BPF_ALU | BPF_RSH | BPF_K:
+			a >>= insn->k;
+			break;
+		case BPF_ALU | BPF_RSH | BPF_X:
+			a = x < 32U ? a >> x : 0U;
+			break;
+		case BPF_ALU | BPF_NEG:
+			a = -a;
+			break;
+		case BPF_JMP | BPF_JA:
+			insn += insn->k;
+			break;
+		case BPF_JMP | BPF_JEQ | BPF_K:
+			insn += (a == insn->k) ? insn->jt : insn->jf;
+			break;
+		case BPF_JMP | BPF_JEQ | BPF_X:
+			insn += (a == x) ? insn->jt : insn->jf;
+			break;
+		case BPF_JMP | BPF_JGT | BPF_K:
+			insn += (a > insn->k) ? insn->jt : insn->jf;
+			break;
+		case BPF_JMP | BPF_JGT | BPF_X:
+			insn += (a > x) ? insn->jt : insn->jf;
+			break;
+		case BPF_JMP | BPF_JGE | BPF_K:
+			insn += (a >= insn->k) ? insn->jt : insn->jf;
+			break;
+		case BPF_JMP | BPF_JGE | BPF_X:
+			insn += (a >= x) ? insn->jt : insn->jf;
+			break;
+		case BPF_JMP | BPF_JSET | BPF_K:
+			insn += (a & insn->k) ? insn->jt : insn->jf;
+			break;
+		case BPF_JMP | BPF_JSET | BPF_X:
+			insn += (a & x) ? insn->jt : insn->jf;
+			break;
+		case BPF_RET | BPF_K:
+			return insn->k;
+		case BPF_RET | BPF_A:
+			return a;
+		case BPF_MISC | BPF_TAX:
+			x = a;
+			break;
+		case BPF_MISC | BPF_TXA:
+			a = x;
+			break;
+		default:
+			return 0;
+		}
+	}
+}
+
+u32_t net_bpf_run(const struct net_bpf_filter *filter, struct net_pkt *pkt)
+{
+	if (filter->func) {
+		return filter->func(pkt, filter->user_data);
+	}
+
+	return bpf_exec(filter->insns, pkt);
+}
+
+/* Called with the lock held */
+static void filter_release(struct net_bpf_filter *filter)
+{
+	filter->users--;
+
+	if (!filter->users && filter->released) {
+		k_sem_give(filter->released);
+		filter->released = NULL;
+	}
+}
+
+static void filter_put(struct net_bpf_filter *filter)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&lock);
+	filter_release(filter);
+	k_spin_unlock(&lock, key);
+}
+
+/* Wait until a filter that can no longer be found is not running anymore */
+static void filter_wait(struct net_bpf_filter *filter)
+{
+	struct k_sem released;
+	k_spinlock_key_t key;
+	u16_t users;
+
+	k_sem_init(&released, 0, 1);
+
+	key = k_spin_lock(&lock);
+
+	users = filter->users;
+	if (users) {
+		filter->released = &released;
+	}
+
+	k_spin_unlock(&lock, key);
+
+	if (users) {
+		k_sem_take(&released, K_FOREVER);
+	}
+}
+
+int net_bpf_attach(struct net_if *iface, struct net_bpf_filter *filter)
+{
+	struct net_bpf_filter *attached;
+	k_spinlock_key_t key;
+	int count = 0;
+	int ret = 0;
+
+	NET_ASSERT(iface);
+	NET_ASSERT(filter);
+
+	if (!filter->func) {
+		ret = net_bpf_check(filter->insns, filter->len);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	if (filter->action > NET_BPF_PRIORITY ||
+	    filter->priority > NET_PRIORITY_NC) {
+		return -EINVAL;
+	}
+
+	key = k_spin_lock(&lock);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&iface->bpf_filters, attached, node) {
+		if (attached == filter) {
+			ret = -EALREADY;
+			goto out;
+		}
+
+		count++;
+	}
+
+	if (count >= CONFIG_NET_BPF_IFACE_FILTERS) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	filter->users = 0U;
+	filter->released = NULL;
+	sys_slist_append(&iface->bpf_filters, &filter->node);
+
+out:
+	k_spin_unlock(&lock, key);
+
+	if (!ret) {
+		NET_DBG("Filter %p attached to iface %p", filter, iface);
+	}
+
+	return ret;
+}
+
+int net_bpf_detach(struct net_if *iface, struct net_bpf_filter *filter)
+{
+	k_spinlock_key_t key;
+	bool found;
+
+	NET_ASSERT(iface);
+	NET_ASSERT(filter);
+
+	key = k_spin_lock(&lock);
+	found = sys_slist_find_and_remove(&iface->bpf_filters, &filter->node);
+	k_spin_unlock(&lock, key);
+
+	if (!found) {
+		return -ENOENT;
+	}
+
+	filter_wait(filter);
+
+	NET_DBG("Filter %p detached from iface %p", filter, iface);
+
+	return 0;
+}
+
+enum net_verdict net_bpf_input(struct net_if *iface, struct net_pkt *pkt)
+{
+	struct net_bpf_filter *filters[CONFIG_NET_BPF_IFACE_FILTERS];
+	enum net_verdict verdict = NET_CONTINUE;
+	struct net_bpf_filter *filter;
+	k_spinlock_key_t key;
+	int count = 0;
+	bool match;
+	int i;
+
+	if (sys_slist_is_empty(&iface->bpf_filters)) {
+		return NET_CONTINUE;
+	}
+
+	/* Take the filters attached now, and run them with the lock
+	 * released.
+	 */
+	key = k_spin_lock(&lock);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&iface->bpf_filters, filter, node) {
+		filter->users++;
+		filters[count++] = filter;
+	}
+
+	k_spin_unlock(&lock, key);
+
+	for (i = 0; i < count; i++) {
+		filter = filters[i];
+		match = net_bpf_run(filter, pkt) != 0U;
+
+		if (filter->action == NET_BPF_PRIORITY) {
+			if (match) {
+				net_pkt_set_priority(pkt, filter->priority);
+			}
+
+			continue;
+		}
+
+		if (match == (filter->action == NET_BPF_DROP)) {
+			NET_DBG("pkt %p dropped by filter %p", pkt, filter);
+			verdict = NET_DROP;
+			break;
+		}
+	}
+
+	key = k_spin_lock(&lock);
+
+	for (i = 0; i < count; i++) {
+		filter_release(filters[i]);
+	}
+
+	k_spin_unlock(&lock, key);
+
+	return verdict;
+}
+
+#if CONFIG_NET_BPF_SOCK_FILTERS > 0
+int net_bpf_sock_filter_alloc(const struct sock_fprog *prog,
+			      struct net_bpf_filter **filter)
+{
+	struct bpf_sock_filter *sock_filter;
+	int ret;
+
+	if (!prog->filter || prog->len == 0U ||
+	    prog->len > CONFIG_NET_BPF_MAX_INSNS) {
+		return -EINVAL;
+	}
+
+	if (k_mem_slab_alloc(&sock_filters, (void **)&sock_filter,
+			     K_NO_WAIT)) {
+		return -ENOMEM;
+	}
+
+	memcpy(sock_filter->insns, prog->filter,
+	       prog->len * sizeof(struct sock_filter));
+
+	ret = net_bpf_check(sock_filter->insns, prog->len);
+	if (ret < 0) {
+		k_mem_slab_free(&sock_filters, (void **)&sock_filter);
+		return ret;
+	}
+
+	(void)memset(&sock_filter->filter, 0, sizeof(sock_filter->filter));
+	sock_filter->filter.insns = sock_filter->insns;
+	sock_filter->filter.len = prog->len;
+
+	*filter = &sock_filter->filter;
+
+	return 0;
+}
+
+void net_bpf_sock_filter_free(struct net_bpf_filter *filter)
+{
+	struct bpf_sock_filter *sock_filter;
+
+	if (!filter) {
+		return;
+	}
+
+	sock_filter = CONTAINER_OF(filter, struct bpf_sock_filter, filter);
+
+	k_mem_slab_free(&sock_filters, (void **)&sock_filter);
+}
+#else
+int net_bpf_sock_filter_alloc(const struct sock_fprog *prog,
+			      struct net_bpf_filter **filter)
+{
+	ARG_UNUSED(prog);
+	ARG_UNUSED(filter);
+
+	return -ENOMEM;
+}
+
+void net_bpf_sock_filter_free(struct net_bpf_filter *filter)
+{
+	ARG_UNUSED(filter);
+}
+#endif /* CONFIG_NET_BPF_SOCK_FILTERS > 0 */
+
+void net_bpf_sock_filter_set(struct net_bpf_filter **slot,
+			     struct net_bpf_filter *filter)
+{
+	struct net_bpf_filter *old;
+	k_spinlock_key_t key;
+
+	if (filter) {
+		filter->users = 0U;
+		filter->released = NULL;
+	}
+
+	key = k_spin_lock(&lock);
+	old = *slot;
+	*slot = filter;
+	k_spin_unlock(&lock, key);
+
+	if (old) {
+		filter_wait(old);
+	}
+}
+
+bool net_bpf_sock_filter_match(struct net_bpf_filter **slot,
+			       struct net_pkt *pkt)
+{
+	struct net_bpf_filter *filter;
+	k_spinlock_key_t key;
+	bool match;
+
+	if (!*slot) {
+		return true;
+	}
+
+	key = k_spin_lock(&lock);
+
+	filter = *slot;
+	if (filter) {
+		filter->users++;
+	}
+
+	k_spin_unlock(&lock, key);
+
+	if (!filter) {
+		return true;
+	}
+
+	match = net_bpf_run(filter, pkt) != 0U;
+
+	filter_put(filter);
+
+	return match;
+}
@@ -0,0 +1,544 @@
+/** @file
+ * @brief Packet capture
+ *
+ * The packets are written as pcapng enhanced packet blocks to a ring
+ * buffer, from the RX path of the drivers and from the TX threads, and
+ * the capture thread writes them out to the backend. Every interface has
+ * two interface description blocks, one for the received link layer
+ * frames and one for the sent IP packets.
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_capture, CONFIG_NET_CAPTURE_LOG_LEVEL);
+
+#include <kernel.h>
+#include <string.h>
+#include <sys/ring_buffer.h>
+
+#include <net/net_core.h>
+#include <net/net_pkt.h>
+#include <net/net_if.h>
+#include <net/net_context.h>
+#include <net/bpf.h>
+#include <net/capture.h>
+
+#if defined(CONFIG_NET_CAPTURE_BACKEND_UART)
+#include <drivers/uart.h>
+#elif defined(CONFIG_NET_CAPTURE_BACKEND_FS)
+#include <fs/fs.h>
+#elif defined(CONFIG_NET_CAPTURE_BACKEND_POSIX)
+#include <stdio.h>
+#include <soc.h>
+#include <cmdline.h>
+#endif
+
+#include "net_private.h"
+
+#define PCAPNG_SHB		0x0A0D0D0AU
+#define PCAPNG_IDB		0x00000001U
+#define PCAPNG_EPB		0x00000006U
+#define PCAPNG_BYTE_ORDER	0x1A2B3C4DU
+
+#define PCAPNG_OPT_EPB_FLAGS	2U
+#define PCAPNG_EPB_INBOUND	1U
+#define PCAPNG_EPB_OUTBOUND	2U
+
+#define LINKTYPE_ETHERNET	1U
+#define LINKTYPE_PPP		9U
+#define LINKTYPE_RAW		101U
+#define LINKTYPE_IEEE802_15_4	230U
+
+/* Block type, length, interface, timestamp, captured and original length */
+#define EPB_HDR_LEN		(7 * sizeof(u32_t))
+
+/* Flags option, end of options and block length */
+#define EPB_TRAILER_LEN		(4 * sizeof(u32_t))
+
+/* Two 16 bit fields of a block, in the order they are in memory */
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define PCAPNG_U16_PAIR(first, second) (((u32_t)(first) << 16) | (second))
+#else
+#define PCAPNG_U16_PAIR(first, second) (((u32_t)(second) << 16) | (first))
+#endif
+
+#define EPB_LEN(caplen)		(EPB_HDR_LEN + ROUND_UP(caplen, 4) +	\
+				 EPB_TRAILER_LEN)
+
+bool net_capture_active;
+
+static struct {
+	const struct net_bpf_filter *rx_filter;
+	const struct net_bpf_filter *tx_filter;
+	net_capture_output_t output;
+	void *user_data;
+	struct net_capture_stats stats;
+	u16_t snaplen;
+} capture;
+
+/* Serializes the writers of the ring buffer and the reader */
+static struct k_spinlock lock;
+
+RING_BUF_DECLARE(capture_ring, CONFIG_NET_CAPTURE_BUF_SIZE);
+
+/* Held while writing out, so that stopping waits for the thread */
+static K_MUTEX_DEFINE(output_lock);
+static K_SEM_DEFINE(capture_sem, 0, 1);
+
+K_THREAD_STACK_DEFINE(capture_stack, CONFIG_NET_CAPTURE_STACK_SIZE);
+static struct k_thread capture_thread_data;
+static bool capture_thread_created;
+
+/* Largest block, the section header and interface blocks are smaller */
+static u32_t block_buf[EPB_LEN(CONFIG_NET_CAPTURE_SNAPLEN) / sizeof(u32_t)];
+
+#if defined(CONFIG_NET_CAPTURE_BACKEND_UART)
+static struct device *uart_dev;
+
+static int backend_open(const struct net_capture_cfg *cfg)
+{
+	uart_dev = device_get_binding(CONFIG_NET_CAPTURE_UART_NAME);
+	if (!uart_dev) {
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+static void backend_output(const u8_t *data, size_t len)
+{
+	while (len--) {
+		uart_poll_out(uart_dev, *data++);
+	}
+}
+
+static void backend_close(void)
+{
+}
+
+#elif defined(CONFIG_NET_CAPTURE_BACKEND_UDP)
+static struct net_context *udp_ctx;
+static struct sockaddr udp_dst;
+
+static int backend_open(const struct net_capture_cfg *cfg)
+{
+	memcpy(&udp_dst, &cfg->dst, sizeof(udp_dst));
+
+	return net_context_get(udp_dst.sa_family, SOCK_DGRAM, IPPROTO_UDP,
+			       &udp_ctx);
+}
+
+/* Each block goes in a datagram of its own */
+static void backend_output(const u8_t *data, size_t len)
+{
+	socklen_t addrlen = udp_dst.sa_family == AF_INET6 ?
+		sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+	int ret;
+
+	ret = net_context_sendto(udp_ctx, data, len, &udp_dst, addrlen,
+				 NULL, K_FOREVER, NULL);
+	if (ret < 0) {
+		NET_DBG("Cannot send capture (%d)", ret);
+	}
+}
+
+static void backend_close(void)
+{
+	net_context_put(udp_ctx);
+	udp_ctx = NULL;
+}
+
+#elif defined(CONFIG_NET_CAPTURE_BACKEND_FS)
+static struct fs_file_t capture_file;
+
+static int backend_open(const struct net_capture_cfg *cfg)
+{
+	(void)fs_unlink(CONFIG_NET_CAPTURE_FILE_NAME);
+
+	return fs_open(&capture_file, CONFIG_NET_CAPTURE_FILE_NAME);
+}
+
+static void backend_output(const u8_t *data, size_t len)
+{
+	ssize_t ret;
+
+	ret = fs_write(&capture_file, data, len);
+	if (ret < 0) {
+		NET_DBG("Cannot write capture (%d)", (int)ret);
+	}
+}
+
+static void backend_close(void)
+{
+	(void)fs_close(&capture_file);
+}
+
+#elif defined(CONFIG_NET_CAPTURE_BACKEND_POSIX)
+static const char *file_name;
+static FILE *out_stream;
+
+static int backend_open(const struct net_capture_cfg *cfg)
+{
+	if (file_name == NULL) {
+		file_name = "capture.pcapng";
+	}
+
+	out_stream = fopen(file_name, "wb");
+	if (!out_stream) {
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static void backend_output(const u8_t *data, size_t len)
+{
+	fwrite(data, len, 1, out_stream);
+	fflush(out_stream);
+}
+
+static void backend_close(void)
+{
+	fclose(out_stream);
+	out_stream = NULL;
+}
+
+static void capture_posix_option(void)
+{
+	static struct args_struct_t capture_option[] = {
+		{
+			.manual = false,
+			.is_mandatory = false,
+			.is_switch = false,
+			.option = "capture-file",
+			.name = "file_name",
+			.type = 's',
+			.dest = (void *)&file_name,
+			.call_when_found = NULL,
+			.descript = "File name for the packet capture.",
+		},
+		ARG_TABLE_ENDMARKER
+	};
+
+	native_add_command_line_opts(capture_option);
+}
+
+NATIVE_TASK(capture_posix_option, PRE_BOOT_1, 1);
+
+#else /* CONFIG_NET_CAPTURE_BACKEND_NONE */
+
+static int backend_open(const struct net_capture_cfg *cfg)
+{
+	/* Only the output callback can be used */
+	return -ENOTSUP;
+}
+
+static void backend_output(const u8_t *data, size_t len)
+{
+}
+
+static void backend_close(void)
+{
+}
+#endif
+
+static void capture_output(const u8_t *data, size_t len)
+{
+	if (capture.output) {
+		capture.output(data, len, capture.user_data);
+	} else {
+		backend_output(data, len);
+	}
+}
+
+/* Packets sent by the capture itself are not captured */
+static inline bool capture_own_pkt(struct net_pkt *pkt)
+{
+#if defined(CONFIG_NET_CAPTURE_BACKEND_UDP)
+	return udp_ctx && net_pkt_context(pkt) == udp_ctx;
+#else
+	return false;
+#endif
+}
+
+static u16_t capture_link_type(struct net_if *iface)
+{
+#if defined(CONFIG_NET_L2_ETHERNET)
+	if (net_if_l2(iface) == &NET_L2_GET_NAME(ETHERNET)) {
+		return LINKTYPE_ETHERNET;
+	}
+#endif
+#if defined(CONFIG_NET_L2_IEEE802154)
+	if (net_if_l2(iface) == &NET_L2_GET_NAME(IEEE802154)) {
+		return LINKTYPE_IEEE802_15_4;
+	}
+#endif
+#if defined(CONFIG_NET_L2_PPP)
+	if (net_if_l2(iface) == &NET_L2_GET_NAME(PPP)) {
+		return LINKTYPE_PPP;
+	}
+#endif
+
+	return LINKTYPE_RAW;
+}
+
+static void capture_write_headers(void)
+{
+	struct net_if *iface;
+	int i;
+
+	block_buf[0] = PCAPNG_SHB;
+	block_buf[1] = 28U;
+	block_buf[2] = PCAPNG_BYTE_ORDER;
+	block_buf[3] = PCAPNG_U16_PAIR(1, 0);	/* Version 1.0 */
+	block_buf[4] = 0xffffffffU;	/* Section length not known */
+	block_buf[5] = 0xffffffffU;
+	block_buf[6] = 28U;
+
+	capture_output((u8_t *)block_buf, 28);
+
+	/* Interface 2 * (index - 1) gets the frames received by the
+	 * network interface, and the next one the sent IP packets.
+	 */
+	for (i = 1; (iface = net_if_get_by_index(i)) != NULL; i++) {
+		block_buf[0] = PCAPNG_IDB;
+		block_buf[1] = 20U;
+		block_buf[2] = PCAPNG_U16_PAIR(capture_link_type(iface), 0);
+		block_buf[3] = capture.snaplen;
+		block_buf[4] = 20U;
+
+		capture_output((u8_t *)block_buf, 20);
+
+		block_buf[2] = PCAPNG_U16_PAIR(LINKTYPE_RAW, 0);
+
+		capture_output((u8_t *)block_buf, 20);
+	}
+}
+
+/* Write out the blocks in the ring buffer */
+static void capture_flush(void)
+{
+	k_spinlock_key_t key;
+	u32_t len;
+
+	while (true) {
+		key = k_spin_lock(&lock);
+
+		len = ring_buf_get(&capture_ring, (u8_t *)block_buf,
+				   2 * sizeof(u32_t));
+		if (len) {
+			len = block_buf[1];
+			ring_buf_get(&capture_ring, (u8_t *)&block_buf[2],
+				     len - 2 * sizeof(u32_t));
+		}
+
+		k_spin_unlock(&lock, key);
+
+		if (!len) {
+			break;
+		}
+
+		capture_output((u8_t *)block_buf, len);
+	}
+}
+
+static void capture_thread(void)
+{
+	while (true) {
+		k_sem_take(&capture_sem, K_FOREVER);
+
+		k_mutex_lock(&output_lock, K_FOREVER);
+
+		if (net_capture_active) {
+			capture_flush();
+		}
+
+		k_mutex_unlock(&output_lock);
+	}
+}
+
+void net_capture_pkt(struct net_if *iface, struct net_pkt *pkt, bool tx)
+{
+	const struct net_bpf_filter *filter;
+	u32_t hdr[EPB_HDR_LEN / sizeof(u32_t)];
+	u32_t trailer[EPB_TRAILER_LEN / sizeof(u32_t)];
+	static const u8_t pad[3];
+	k_spinlock_key_t key;
+	struct net_buf *buf;
+	size_t orig_len, caplen, left, len;
+	u64_t ts;
+
+	if (tx) {
+		sa_family_t family = net_pkt_family(pkt);
+
+		/* Only IP packets are sent without their link layer
+		 * header at this point.
+		 */
+		if ((family != AF_INET && family != AF_INET6) ||
+		    capture_own_pkt(pkt)) {
+			return;
+		}
+
+		filter = capture.tx_filter;
+	} else {
+		filter = capture.rx_filter;
+	}
+
+	if (IS_ENABLED(CONFIG_NET_BPF) && filter &&
+	    net_bpf_run(filter, pkt) == 0U) {
+		return;
+	}
+
+	orig_len = net_pkt_get_len(pkt);
+	caplen = MIN(orig_len, capture.snaplen);
+	ts = k_ticks_to_us_floor64(k_uptime_ticks());
+
+	hdr[0] = PCAPNG_EPB;
+	hdr[1] = EPB_LEN(caplen);
+	hdr[2] = (net_if_get_by_iface(iface) - 1) * 2 + tx;
+	hdr[3] = ts >> 32;
+	hdr[4] = (u32_t)ts;
+	hdr[5] = caplen;
+	hdr[6] = orig_len;
+
+	trailer[0] = PCAPNG_U16_PAIR(PCAPNG_OPT_EPB_FLAGS, sizeof(u32_t));
+	trailer[1] = tx ? PCAPNG_EPB_OUTBOUND : PCAPNG_EPB_INBOUND;
+	trailer[2] = 0U;
+	trailer[3] = hdr[1];
+
+	key = k_spin_lock(&lock);
+
+	if (!net_capture_active) {
+		k_spin_unlock(&lock, key);
+		return;
+	}
+
+	if (ring_buf_space_get(&capture_ring) < hdr[1]) {
+		capture.stats.dropped++;
+		k_spin_unlock(&lock, key);
+		return;
+	}
+
+	ring_buf_put(&capture_ring, (u8_t *)hdr, sizeof(hdr));
+
+	for (buf = pkt->buffer, left = caplen; buf && left;
+	     buf = buf->frags) {
+		len = MIN(buf->len, left);
+		ring_buf_put(&capture_ring, buf->data, len);
+		left -= len;
+	}
+
+	ring_buf_put(&capture_ring, pad, ROUND_UP(caplen, 4) - caplen);
+	ring_buf_put(&capture_ring, (u8_t *)trailer, sizeof(trailer));
+
+	capture.stats.captured++;
+
+	k_spin_unlock(&lock, key);
+
+	k_sem_give(&capture_sem);
+}
+
+int net_capture_start(const struct net_capture_cfg *cfg)
+{
+	k_spinlock_key_t key;
+	int ret;
+
+	if (cfg->snaplen > CONFIG_NET_CAPTURE_SNAPLEN ||
+	    (!IS_ENABLED(CONFIG_NET_BPF) &&
+	     (cfg->rx_filter || cfg->tx_filter))) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&output_lock, K_FOREVER);
+
+	if (net_capture_active) {
+		ret = -EALREADY;
+		goto out;
+	}
+
+	if (!cfg->output) {
+		ret = backend_open(cfg);
+		if (ret < 0) {
+			NET_DBG("Cannot open capture backend (%d)", ret);
+			goto out;
+		}
+	}
+
+	capture.rx_filter = cfg->rx_filter;
+	capture.tx_filter = cfg->tx_filter;
+	capture.output = cfg->output;
+	capture.user_data = cfg->user_data;
+	capture.snaplen = cfg->snaplen ? cfg->snaplen :
+		CONFIG_NET_CAPTURE_SNAPLEN;
+	memset(&capture.stats, 0, sizeof(capture.stats));
+
+	capture_write_headers();
+
+	if (!capture_thread_created) {
+		k_thread_create(&capture_thread_data, capture_stack,
+				K_THREAD_STACK_SIZEOF(capture_stack),
+				(k_thread_entry_t)capture_thread,
+				NULL, NULL, NULL,
+				K_LOWEST_APPLICATION_THREAD_PRIO, 0,
+				K_NO_WAIT);
+		k_thread_name_set(&capture_thread_data, "net_capture");
+		capture_thread_created = true;
+	}
+
+	key = k_spin_lock(&lock);
+	ring_buf_reset(&capture_ring);
+	net_capture_active = true;
+	k_spin_unlock(&lock, key);
+
+	ret = 0;
+
+out:
+	k_mutex_unlock(&output_lock);
+
+	return ret;
+}
+
+int net_capture_stop(void)
+{
+	k_spinlock_key_t key;
+	int ret = 0;
+
+	k_mutex_lock(&output_lock, K_FOREVER);
+
+	if (!net_capture_active) {
+		ret = -EALREADY;
+		goto out;
+	}
+
+	key = k_spin_lock(&lock);
+	net_capture_active = false;
+	k_spin_unlock(&lock, key);
+
+	capture_flush();
+
+	if (!capture.output) {
+		backend_close();
+	}
+
+	NET_DBG("Captured %u packets, dropped %u", capture.stats.captured,
+		capture.stats.dropped);
+
+out:
+	k_mutex_unlock(&output_lock);
+
+	return ret;
+}
+
+void net_capture_get_stats(struct net_capture_stats *stats)
+{
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&lock);
+	memcpy(stats, &capture.stats, sizeof(*stats));
+	k_spin_unlock(&lock, key);
+}
@@ -25,6 +25,7 @@ LOG_MODULE_REGISTER(net_ctx, CONFIG_NET_CONTEXT_LOG_LEVEL);
 #include <net/net_offload.h>
 #include <net/ethernet.h>
 #include <net/socket_can.h>
+#include <net/bpf.h>
 
 #include "connection.h"
 #include "net_private.h"
@@ -339,6 +340,17 @@ int net_context_unref(struct net_context *context)
 
 	net_tcp_unref(context);
 
+#if defined(CONFIG_NET_BPF)
+	if (context->options.bpf_filter) {
+		if (context->conn_handler) {
+			(void)net_conn_set_filter(context->conn_handler, NULL);
+		}
+
+		net_bpf_sock_filter_free(context->options.bpf_filter);
+		context->options.bpf_filter = NULL;
+	}
+#endif
+
 	if (context->conn_handler) {
 		if (IS_ENABLED(CONFIG_NET_TCP) || IS_ENABLED(CONFIG_NET_UDP) ||
 		    IS_ENABLED(CONFIG_NET_SOCKETS_CAN)) {
@@ -1113,6 +1125,22 @@ static int get_context_priority(struct net_context *context,
 #endif
 }
 
+static int get_context_rcvbuf(struct net_context *context,
+			      void *value, size_t *len)
+{
+#if defined(CONFIG_NET_CONTEXT_RCVBUF)
+	*((int *)value) = rcvbuf_quota(context) * RCVBUF_BUF_SIZE;
+
+	if (len) {
+		*len = sizeof(int);
+	}
+
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
 static int get_context_timepstamp(struct net_context *context,
 				  void *value, size_t *len)
 {
@@ -1186,15 +1214,19 @@ static int get_context_txtime(struct net_context *context,
 #endif
 }
 
-/* If buf is not NULL, then use it. Otherwise read the data to be written
- * to net_pkt from msghdr.
+/* If frags is not NULL, a reference to the fragment chain is appended to
+ * net_pkt, so the data is not copied. If buf is not NULL, then use it.
+ * Otherwise read the data to be written to net_pkt from msghdr.
  */
 static int context_write_data(struct net_pkt *pkt, const void *buf,
-			      int buf_len, const struct msghdr *msghdr)
+			      int buf_len, const struct msghdr *msghdr,
+			      struct net_buf *frags)
 {
 	int ret = 0;
 
-	if (msghdr) {
+	if (frags) {
+		net_pkt_append_buffer(pkt, net_buf_ref(frags));
+	} else if (msghdr) {
 		int i;
 
 		for (i = 0; i < msghdr->msg_iovlen; i++) {
@@ -1216,6 +1248,7 @@ static int context_setup_udp_packet(struct net_context *context,
 				    const void *buf,
 				    size_t len,
 				    const struct msghdr *msg,
+				    struct net_buf *frags,
 				    const struct sockaddr *dst_addr,
 				    socklen_t addrlen)
 {
@@ -1257,7 +1290,7 @@ static int context_setup_udp_packet(struct net_context *context,
 		return ret;
 	}
 
-	ret = context_write_data(pkt, buf, len, msg);
+	ret = context_write_data(pkt, buf, len, msg, frags);
 	if (ret) {
 		return ret;
 	}
@@ -1283,6 +1316,43 @@ static void context_finalize_packet(struct net_context *context,
 	}
 }
 
+#if defined(CONFIG_NET_GSO)
+static bool context_use_gso(struct net_context *context, size_t len)
+{
+	struct net_if *iface = net_context_get_iface(context);
+
+	return net_context_get_ip_proto(context) == IPPROTO_TCP &&
+		net_if_l2(iface) == &NET_L2_GET_NAME(ETHERNET) &&
+		len > net_tcp_get_send_mss(context->tcp);
+}
+
+/* Put all the TCP data in one packet even if it does not fit the MTU. The
+ * packet is split into segments of the size TCP would otherwise have used,
+ * the MSS of the peer bounded by the MTU, when it is handed to L2.
+ */
+static struct net_pkt *context_alloc_pkt_gso(struct net_context *context,
+					     size_t len, s32_t timeout)
+{
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_alloc_on_iface(net_context_get_iface(context), timeout);
+	if (!pkt) {
+		return NULL;
+	}
+
+	net_pkt_set_family(pkt, net_context_get_family(context));
+	net_pkt_set_context(pkt, context);
+	net_pkt_set_gso_size(pkt, net_tcp_get_send_mss(context->tcp));
+
+	if (net_pkt_alloc_buffer(pkt, len, IPPROTO_TCP, timeout)) {
+		net_pkt_unref(pkt);
+		return NULL;
+	}
+
+	return pkt;
+}
+#endif /* CONFIG_NET_GSO */
+
 static struct net_pkt *context_alloc_pkt(struct net_context *context,
 					 size_t len, s32_t timeout)
 {
@@ -1308,6 +1378,11 @@ static struct net_pkt *context_alloc_pkt(struct net_context *context,
 
 		return pkt;
 	}
+#endif
+#if defined(CONFIG_NET_GSO)
+	if (context_use_gso(context, len)) {
+		return context_alloc_pkt_gso(context, len, timeout);
+	}
 #endif
 	pkt = net_pkt_alloc_with_buffer(net_context_get_iface(context), len,
 					net_context_get_family(context),
@@ -1320,6 +1395,62 @@ static struct net_pkt *context_alloc_pkt(struct net_context *context,
 	return pkt;
 }
 
+/* Allocate a net_pkt that will carry caller supplied fragments. Only the
+ * protocol headers are allocated here, the payload is adopted later on.
+ */
+static struct net_pkt *context_alloc_pkt_frags(struct net_context *context,
+					       s32_t timeout)
+{
+	enum net_ip_protocol proto = net_context_get_ip_proto(context);
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_alloc_on_iface(net_context_get_iface(context), timeout);
+	if (!pkt) {
+		return NULL;
+	}
+
+	net_pkt_set_family(pkt, net_context_get_family(context));
+	net_pkt_set_context(pkt, context);
+
+	/* TCP allocates its own header buffer when preparing the segment,
+	 * so the payload must be the first buffer of the packet there.
+	 */
+	if (proto != IPPROTO_TCP &&
+	    net_pkt_alloc_buffer(pkt, 0, proto, timeout)) {
+		net_pkt_unref(pkt);
+		return NULL;
+	}
+
+	return pkt;
+}
+
+/* Maximum payload that fits into one packet without IP fragmentation */
+static size_t context_max_payload(struct net_context *context)
+{
+	size_t mtu = net_if_get_mtu(net_context_get_iface(context));
+	size_t hdr_len = 0;
+
+	if (IS_ENABLED(CONFIG_NET_IPV6) &&
+	    net_context_get_family(context) == AF_INET6) {
+		hdr_len = NET_IPV6H_LEN;
+	} else if (IS_ENABLED(CONFIG_NET_IPV4) &&
+		   net_context_get_family(context) == AF_INET) {
+		hdr_len = NET_IPV4H_LEN;
+	}
+
+	if (net_context_get_ip_proto(context) == IPPROTO_TCP) {
+		hdr_len += NET_TCPH_LEN;
+	} else if (net_context_get_ip_proto(context) == IPPROTO_UDP) {
+		hdr_len += NET_UDPH_LEN;
+	}
+
+	if (mtu == 0) {
+		mtu = NET_IPV6_MTU;
+	}
+
+	return mtu > hdr_len ? mtu - hdr_len : 0;
+}
+
 static void set_pkt_txtime(struct net_pkt *pkt, const struct msghdr *msghdr)
 {
 	struct cmsghdr *cmsg;
@@ -1342,6 +1473,7 @@ static int context_sendto(struct net_context *context,
 			  size_t len,
 			  const struct sockaddr *dst_addr,
 			  socklen_t addrlen,
+			  struct net_buf *frags,
 			  net_context_send_cb_t cb,
 			  s32_t timeout,
 			  void *user_data,
@@ -1479,15 +1611,27 @@ static int context_sendto(struct net_context *context,
 		}
 	}
 
-	pkt = context_alloc_pkt(context, len, PKT_WAIT_TIME);
-	if (!pkt) {
-		return -ENOMEM;
-	}
+	if (frags) {
+		len = net_buf_frags_len(frags);
+		if (len > context_max_payload(context)) {
+			return -EMSGSIZE;
+		}
+
+		pkt = context_alloc_pkt_frags(context, PKT_WAIT_TIME);
+		if (!pkt) {
+			return -ENOMEM;
+		}
+	} else {
+		pkt = context_alloc_pkt(context, len, PKT_WAIT_TIME);
+		if (!pkt) {
+			return -ENOMEM;
+		}
 
-	tmp_len = net_pkt_available_payload_buffer(
+		tmp_len = net_pkt_available_payload_buffer(
 				pkt, net_context_get_ip_proto(context));
-	if (tmp_len < len) {
-		len = tmp_len;
+		if (tmp_len < len) {
+			len = tmp_len;
+		}
 	}
 
 	context->send_cb = cb;
@@ -1546,7 +1690,7 @@ static int context_sendto(struct net_context *context,
 
 	if (IS_ENABLED(CONFIG_NET_OFFLOAD) &&
 	    net_if_is_ip_offloaded(net_context_get_iface(context))) {
-		ret = context_write_data(pkt, buf, len, msghdr);
+		ret = context_write_data(pkt, buf, len, msghdr, frags);
 		if (ret < 0) {
 			goto fail;
 		}
@@ -1564,7 +1708,7 @@ static int context_sendto(struct net_context *context,
 	} else if (IS_ENABLED(CONFIG_NET_UDP) &&
 	    net_context_get_ip_proto(context) == IPPROTO_UDP) {
 		ret = context_setup_udp_packet(context, pkt, buf, len, msghdr,
-					       dst_addr, addrlen);
+					       frags, dst_addr, addrlen);
 		if (ret < 0) {
 			goto fail;
 		}
@@ -1575,7 +1719,7 @@ static int context_sendto(struct net_context *context,
 	} else if (IS_ENABLED(CONFIG_NET_TCP) &&
 		   net_context_get_ip_proto(context) == IPPROTO_TCP) {
 
-		ret = context_write_data(pkt, buf, len, msghdr);
+		ret = context_write_data(pkt, buf, len, msghdr, frags);
 		if (ret < 0) {
 			goto fail;
 		}
@@ -1589,7 +1733,7 @@ static int context_sendto(struct net_context *context,
 		ret = net_tcp_send_data(context, cb, user_data);
 	} else if (IS_ENABLED(CONFIG_NET_SOCKETS_PACKET) &&
 		   net_context_get_family(context) == AF_PACKET) {
-		ret = context_write_data(pkt, buf, len, msghdr);
+		ret = context_write_data(pkt, buf, len, msghdr, frags);
 		if (ret < 0) {
 			goto fail;
 		}
@@ -1600,7 +1744,7 @@ static int context_sendto(struct net_context *context,
 	} else if (IS_ENABLED(CONFIG_NET_SOCKETS_CAN) &&
 		   net_context_get_family(context) == AF_CAN &&
 		   net_context_get_ip_proto(context) == CAN_RAW) {
-		ret = context_write_data(pkt, buf, len, msghdr);
+		ret = context_write_data(pkt, buf, len, msghdr, frags);
 		if (ret < 0) {
 			goto fail;
 		}
@@ -1661,7 +1805,7 @@ int net_context_send(struct net_context *context,
 	}
 
 	ret = context_sendto(context, buf, len, &context->remote,
-			     addrlen, cb, timeout, user_data, false);
+			     addrlen, NULL, cb, timeout, user_data, false);
 unlock:
 	k_mutex_unlock(&context->lock);
 
@@ -1679,7 +1823,7 @@ int net_context_sendmsg(struct net_context *context,
 
 	k_mutex_lock(&context->lock, K_FOREVER);
 
-	ret = context_sendto(context, msghdr, 0, NULL, 0,
+	ret = context_sendto(context, msghdr, 0, NULL, 0, NULL,
 			     cb, timeout, user_data, true);
 
 	k_mutex_unlock(&context->lock);
@@ -1700,7 +1844,7 @@ int net_context_sendto(struct net_context *context,
 
 	k_mutex_lock(&context->lock, K_FOREVER);
 
-	ret = context_sendto(context, buf, len, dst_addr, addrlen,
+	ret = context_sendto(context, buf, len, dst_addr, addrlen, NULL,
 			     cb, timeout, user_data, true);
 
 	k_mutex_unlock(&context->lock);
@@ -1708,6 +1852,123 @@ int net_context_sendto(struct net_context *context,
 	return ret;
 }
 
+int net_context_sendto_frags(struct net_context *context,
+			     struct net_buf *frags,
+			     const struct sockaddr *dst_addr,
+			     socklen_t addrlen,
+			     net_context_send_cb_t cb,
+			     s32_t timeout,
+			     void *user_data)
+{
+	int ret;
+
+	if (!frags) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&context->lock, K_FOREVER);
+
+	if (!dst_addr) {
+		if (!(context->flags & NET_CONTEXT_REMOTE_ADDR_SET)) {
+			ret = -EDESTADDRREQ;
+			goto unlock;
+		}
+
+		dst_addr = &context->remote;
+
+		if (IS_ENABLED(CONFIG_NET_IPV6) &&
+		    net_context_get_family(context) == AF_INET6) {
+			addrlen = sizeof(struct sockaddr_in6);
+		} else if (IS_ENABLED(CONFIG_NET_IPV4) &&
+			   net_context_get_family(context) == AF_INET) {
+			addrlen = sizeof(struct sockaddr_in);
+		} else {
+			ret = -EOPNOTSUPP;
+			goto unlock;
+		}
+	}
+
+	ret = context_sendto(context, NULL, 0, dst_addr, addrlen, frags,
+			     cb, timeout, user_data, true);
+
+unlock:
+	k_mutex_unlock(&context->lock);
+
+	return ret;
+}
+
+#if defined(CONFIG_NET_CONTEXT_RCVBUF)
+#if defined(CONFIG_NET_BUF_FIXED_DATA_SIZE)
+#define RCVBUF_BUF_SIZE CONFIG_NET_BUF_DATA_SIZE
+#elif defined(CONFIG_NET_BUF_SLAB_DATA_SIZE)
+#define RCVBUF_BUF_SIZE CONFIG_NET_BUF_SLAB_MEDIUM_SIZE
+#else
+#define RCVBUF_BUF_SIZE (CONFIG_NET_BUF_DATA_POOL_SIZE /		\
+			 CONFIG_NET_BUF_RX_COUNT)
+#endif
+
+#define RCVBUF_DEFAULT MAX(CONFIG_NET_BUF_RX_COUNT *			\
+			   CONFIG_NET_CONTEXT_RCVBUF_DEFAULT / 100, 1)
+
+static inline u16_t rcvbuf_quota(struct net_context *context)
+{
+	return context->options.rcvbuf ? context->options.rcvbuf :
+		RCVBUF_DEFAULT;
+}
+
+/* Charge the buffers of a received packet to the context, returns false if
+ * the packet must be dropped instead.
+ */
+static bool rcvbuf_charge(struct net_context *context, struct net_pkt *pkt)
+{
+	struct net_buf_pool *rx_data;
+	struct net_buf *buf;
+	atomic_val_t used;
+	u16_t count = 0U;
+
+	if (pkt->rcvbuf_charge) {
+		return true;
+	}
+
+	for (buf = pkt->buffer; buf; buf = buf->frags) {
+		count++;
+	}
+
+	/* TCP data has been acknowledged already when it gets here, and
+	 * the receive window bounds what the peer can send.
+	 */
+	if (net_context_get_ip_proto(context) != IPPROTO_TCP) {
+		net_pkt_get_info(NULL, NULL, &rx_data, NULL);
+
+		if (rx_data->avail_count < CONFIG_NET_BUF_RX_RESERVE) {
+			net_stats_update_reserve_drop();
+			return false;
+		}
+
+		/* A context that holds nothing always gets the packet, even
+		 * if it is larger than the quota.
+		 */
+		used = atomic_get(&context->rcvbuf_used);
+		if (used && used + count > rcvbuf_quota(context)) {
+			net_stats_update_rcvbuf_drop();
+			return false;
+		}
+	}
+
+	atomic_add(&context->rcvbuf_used, count);
+	pkt->rcvbuf_charge = count;
+
+	return true;
+}
+
+void net_context_rcvbuf_release(struct net_context *context, u16_t count)
+{
+	atomic_sub(&context->rcvbuf_used, count);
+}
+#else
+#define rcvbuf_charge(...) true
+#endif /* CONFIG_NET_CONTEXT_RCVBUF */
+
 enum net_verdict net_context_packet_received(struct net_conn *conn,
 					     struct net_pkt *pkt,
 					     union net_ip_header *ip_hdr,
@@ -1732,6 +1993,11 @@ enum net_verdict net_context_packet_received(struct net_conn *conn,
 		goto unlock;
 	}
 
+	if (!rcvbuf_charge(context, pkt)) {
+		NET_DBG("Context %p over its receive quota", context);
+		goto unlock;
+	}
+
 	if (net_context_get_ip_proto(context) == IPPROTO_TCP) {
 		net_stats_update_tcp_recv(net_pkt_iface(pkt),
 					  net_pkt_remaining_data(pkt));
@@ -1880,6 +2146,13 @@ static int recv_raw(struct net_context *context,
 				user_data,
 				&context->conn_handler);
 
+#if defined(CONFIG_NET_BPF)
+	if (!ret && context->options.bpf_filter) {
+		(void)net_conn_set_filter(context->conn_handler,
+					  context->options.bpf_filter);
+	}
+#endif
+
 	return ret;
 }
 
@@ -2071,6 +2344,69 @@ static int set_context_proxy(struct net_context *context,
 #endif
 }
 
+static int set_context_rcvbuf(struct net_context *context,
+			      const void *value, size_t len)
+{
+#if defined(CONFIG_NET_CONTEXT_RCVBUF)
+	int size;
+
+	if (len != sizeof(int)) {
+		return -EINVAL;
+	}
+
+	size = *((int *)value);
+	if (size <= 0) {
+		return -EINVAL;
+	}
+
+	/* The quota is kept in buffers, rounded up */
+	context->options.rcvbuf = MIN(ceiling_fraction(size, RCVBUF_BUF_SIZE),
+				      UINT16_MAX);
+
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+static int set_context_bpf_filter(struct net_context *context,
+				  const void *value, size_t len)
+{
+#if defined(CONFIG_NET_BPF)
+	struct net_bpf_filter *filter = NULL;
+	int ret;
+
+	if (net_context_get_family(context) != AF_PACKET) {
+		return -EOPNOTSUPP;
+	}
+
+	/* No value detaches the filter */
+	if (value) {
+		if (len != sizeof(struct sock_fprog)) {
+			return -EINVAL;
+		}
+
+		ret = net_bpf_sock_filter_alloc(value, &filter);
+		if (ret < 0) {
+			return ret;
+		}
+	} else if (!context->options.bpf_filter) {
+		return -ENOENT;
+	}
+
+	if (context->conn_handler) {
+		(void)net_conn_set_filter(context->conn_handler, filter);
+	}
+
+	net_bpf_sock_filter_free(context->options.bpf_filter);
+	context->options.bpf_filter = filter;
+
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
 int net_context_set_option(struct net_context *context,
 			   enum net_context_option option,
 			   const void *value, size_t len)
@@ -2098,6 +2434,12 @@ int net_context_set_option(struct net_context *context,
 	case NET_OPT_SOCKS5:
 		ret = set_context_proxy(context, value, len);
 		break;
+	case NET_OPT_BPF_FILTER:
+		ret = set_context_bpf_filter(context, value, len);
+		break;
+	case NET_OPT_RCVBUF:
+		ret = set_context_rcvbuf(context, value, len);
+		break;
 	}
 
 	k_mutex_unlock(&context->lock);
@@ -2132,6 +2474,12 @@ int net_context_get_option(struct net_context *context,
 	case NET_OPT_SOCKS5:
 		ret = get_context_proxy(context, value, len);
 		break;
+	case NET_OPT_BPF_FILTER:
+		ret = -ENOTSUP;
+		break;
+	case NET_OPT_RCVBUF:
+		ret = get_context_rcvbuf(context, value, len);
+		break;
 	}
 
 	k_mutex_unlock(&context->lock);
@@ -40,6 +40,7 @@ LOG_MODULE_REGISTER(net_core, CONFIG_NET_CORE_LOG_LEVEL);
 #include "ipv6.h"
 
 #include "icmpv4.h"
+#include "ipv4.h"
 
 #include "dhcpv4.h"
 
@@ -55,6 +56,39 @@ LOG_MODULE_REGISTER(net_core, CONFIG_NET_CORE_LOG_LEVEL);
 
 #include "net_stats.h"
 
+static enum net_verdict process_ip(struct net_pkt *pkt, bool is_loopback)
+{
+	/* IP version and header length. */
+	switch (NET_IPV6_HDR(pkt)->vtc & 0xf0) {
+#if defined(CONFIG_NET_IPV6)
+	case 0x60:
+		return net_ipv6_input(pkt, is_loopback);
+#endif
+#if defined(CONFIG_NET_IPV4)
+	case 0x40:
+		return net_ipv4_input(pkt);
+#endif
+	}
+
+	NET_DBG("Unknown IP family packet (0x%x)",
+		NET_IPV6_HDR(pkt)->vtc & 0xf0);
+	net_stats_update_ip_errors_protoerr(net_pkt_iface(pkt));
+	net_stats_update_ip_errors_vhlerr(net_pkt_iface(pkt));
+
+	return NET_DROP;
+}
+
+/* Pass a packet released by the receive offload to the IP layer */
+static void gro_deliver(struct net_pkt *pkt)
+{
+	net_pkt_cursor_init(pkt);
+
+	if (process_ip(pkt, false) != NET_OK) {
+		NET_DBG("Dropping pkt %p", pkt);
+		net_pkt_unref(pkt);
+	}
+}
+
 static inline enum net_verdict process_data(struct net_pkt *pkt,
 					    bool is_loopback)
 {
@@ -66,12 +100,12 @@ static inline enum net_verdict process_data(struct net_pkt *pkt,
 		return ret;
 	}
 
-#if defined(CONFIG_NET_IPV6_FRAGMENT)
+#if defined(CONFIG_NET_IP_FRAGMENT)
 	/* If the packet is routed back to us when we have reassembled
-	 * an IPv6 packet, then do not pass it to L2 as the packet does
+	 * an IP packet, then do not pass it to L2 as the packet does
 	 * not have link layer headers in it.
 	 */
-	if (net_pkt_ipv6_fragment_start(pkt)) {
+	if (net_pkt_is_ip_reassembled(pkt)) {
 		locally_routed = true;
 	}
 #endif
@@ -107,24 +141,14 @@ static inline enum net_verdict process_data(struct net_pkt *pkt,
 	 */
 	net_pkt_cursor_init(pkt);
 
-	/* IP version and header length. */
-	switch (NET_IPV6_HDR(pkt)->vtc & 0xf0) {
-#if defined(CONFIG_NET_IPV6)
-	case 0x60:
-		return net_ipv6_input(pkt, is_loopback);
-#endif
-#if defined(CONFIG_NET_IPV4)
-	case 0x40:
-		return net_ipv4_input(pkt);
-#endif
+	if (!is_loopback && !locally_routed) {
+		ret = net_gro_receive(pkt, gro_deliver);
+		if (ret != NET_CONTINUE) {
+			return ret;
+		}
 	}
 
-	NET_DBG("Unknown IP family packet (0x%x)",
-		NET_IPV6_HDR(pkt)->vtc & 0xf0);
-	net_stats_update_ip_errors_protoerr(net_pkt_iface(pkt));
-	net_stats_update_ip_errors_vhlerr(net_pkt_iface(pkt));
-
-	return NET_DROP;
+	return process_ip(pkt, is_loopback);
 }
 
 static void processing_data(struct net_pkt *pkt, bool is_loopback)
@@ -308,6 +332,15 @@ int net_send_data(struct net_pkt *pkt)
 		 * to RX processing.
 		 */
 		NET_DBG("Loopback pkt %p back to us", pkt);
+
+		/* A checksum left for the device to finish was never
+		 * completed, and the data did not leave the host anyway.
+		 */
+		if (net_pkt_is_chksum_partial(pkt)) {
+			net_pkt_set_chksum_partial(pkt, false);
+			net_pkt_set_chksum_verified(pkt, true);
+		}
+
 		processing_data(pkt, true);
 		return 0;
 	}
@@ -351,6 +384,8 @@ static void process_rx_packet(struct k_work *work)
 	pkt = CONTAINER_OF(work, struct net_pkt, work);
 
 	net_rx(net_pkt_iface(pkt), pkt);
+
+	net_gro_complete(gro_deliver);
 }
 
 static void net_queue_rx(struct net_if *iface, struct net_pkt *pkt)
@@ -400,6 +435,17 @@ int net_recv_data(struct net_if *iface, struct net_pkt *pkt)
 
 	net_pkt_set_iface(pkt, iface);
 
+	net_capture_rx(iface, pkt);
+
+	/* The filters look at the link layer header, which a reassembled
+	 * packet does not have. Its fragments went through them already.
+	 */
+	if (!net_pkt_is_ip_reassembled(pkt) &&
+	    net_bpf_input(iface, pkt) == NET_DROP) {
+		net_pkt_unref(pkt);
+		return 0;
+	}
+
 	net_queue_rx(iface, pkt);
 
 	return 0;
@@ -423,6 +469,8 @@ static inline void l3_init(void)
 	net_tcp_init();
 
 	net_route_init();
+	net_route_ipv4_init();
+	net_ipv4_nat_init();
 
 	NET_DBG("Network L3 init done");
 }
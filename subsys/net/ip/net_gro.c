@@ -0,0 +1,523 @@
+/** @file
+ * @brief Generic receive offload for TCP
+ *
+ * Consecutive in-order TCP segments of the same flow are merged into one
+ * network packet before they are passed to the IP layer, so that the IP,
+ * TCP and connection handling is done only once for all of them.
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_gro, CONFIG_NET_TCP_LOG_LEVEL);
+
+#include <zephyr.h>
+#include <string.h>
+
+#include <net/net_core.h>
+#include <net/net_pkt.h>
+#include <net/net_if.h>
+
+#include "net_private.h"
+#include "tcp_internal.h"
+
+/* How many packets an RX thread can process before the segments held for
+ * a flow are passed on, even if the RX queue never runs empty.
+ */
+#define GRO_MAX_AGE 32
+
+/* Largest value of the IPv4 total length and IPv6 payload length */
+#define GRO_MAX_LEN 0xffff
+
+#define GRO_TCP_OPTS_MAX_LEN 40
+
+struct gro_flow {
+	/** Held packet, or NULL if this entry is free */
+	struct net_pkt *pkt;
+
+	/** Sequence number the next segment must have */
+	u32_t next_seq;
+
+	/** Acknowledgment number of all the merged segments */
+	u32_t ack;
+
+	/** Value of the table tick when the packet was held */
+	u32_t tick;
+
+	/** Length of the held IP packet */
+	u32_t len;
+
+	u16_t src_port;
+	u16_t dst_port;
+
+	/** Window advertised by the latest segment */
+	u8_t wnd[2];
+
+	/** TCP flags to add to the held segment */
+	u8_t flags;
+
+	/** Number of merged segments */
+	u8_t segs;
+
+	u8_t ip_hdr_len;
+	u8_t tcp_hdr_len;
+	u8_t opts[GRO_TCP_OPTS_MAX_LEN];
+};
+
+struct gro_table {
+	struct gro_flow flows[CONFIG_NET_GRO_FLOWS];
+
+	/** Number of packets seen by the RX thread owning this table */
+	u32_t tick;
+
+	/** Number of flows with a held packet */
+	int held;
+};
+
+/* Parsed headers of a received segment */
+struct gro_seg {
+	union {
+		struct net_ipv4_hdr *ipv4;
+		struct net_ipv6_hdr *ipv6;
+	};
+	sa_family_t family;
+	u16_t src_port;
+	u16_t dst_port;
+	u32_t seq;
+	u32_t ack;
+	u32_t len;
+	u32_t payload_len;
+	u8_t wnd[2];
+	u8_t flags;
+	u8_t ip_hdr_len;
+	u8_t tcp_hdr_len;
+	u8_t opts[GRO_TCP_OPTS_MAX_LEN];
+};
+
+/* Each RX thread has its own table, a flow is always handled by the same
+ * thread so no locking is needed.
+ */
+static struct gro_table gro_tables[NET_TC_RX_COUNT * NET_TC_RX_WORKERS];
+
+static bool gro_parse_ip(struct net_pkt *pkt, struct gro_seg *seg)
+{
+	if (IS_ENABLED(CONFIG_NET_IPV4) &&
+	    (NET_IPV4_HDR(pkt)->vhl & 0xf0) == 0x40) {
+		NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access,
+						      struct net_ipv4_hdr);
+		struct net_ipv4_hdr *hdr;
+
+		hdr = (struct net_ipv4_hdr *)net_pkt_get_data(pkt,
+							       &ipv4_access);
+		/* No options and no fragments */
+		if (!hdr || hdr->vhl != 0x45 || hdr->proto != IPPROTO_TCP ||
+		    (hdr->offset[0] & 0x3f) || hdr->offset[1]) {
+			return false;
+		}
+
+		seg->ipv4 = hdr;
+		seg->family = AF_INET;
+		seg->ip_hdr_len = sizeof(struct net_ipv4_hdr);
+		seg->len = ntohs(hdr->len);
+	} else if (IS_ENABLED(CONFIG_NET_IPV6) &&
+		   (NET_IPV6_HDR(pkt)->vtc & 0xf0) == 0x60) {
+		NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv6_access,
+						      struct net_ipv6_hdr);
+		struct net_ipv6_hdr *hdr;
+
+		hdr = (struct net_ipv6_hdr *)net_pkt_get_data(pkt,
+							       &ipv6_access);
+		/* No extension headers */
+		if (!hdr || hdr->nexthdr != IPPROTO_TCP) {
+			return false;
+		}
+
+		seg->ipv6 = hdr;
+		seg->family = AF_INET6;
+		seg->ip_hdr_len = sizeof(struct net_ipv6_hdr);
+		seg->len = ntohs(hdr->len) + sizeof(struct net_ipv6_hdr);
+	} else {
+		return false;
+	}
+
+	return seg->len <= net_pkt_get_len(pkt);
+}
+
+static bool gro_parse(struct net_pkt *pkt, struct gro_seg *seg)
+{
+	NET_PKT_DATA_ACCESS_DEFINE(tcp_access, struct net_tcp_hdr);
+	struct net_tcp_hdr *tcp_hdr;
+	bool ret = false;
+
+	if (!gro_parse_ip(pkt, seg) || net_pkt_skip(pkt, seg->ip_hdr_len)) {
+		goto out;
+	}
+
+	tcp_hdr = (struct net_tcp_hdr *)net_pkt_get_data(pkt, &tcp_access);
+	if (!tcp_hdr) {
+		goto out;
+	}
+
+	seg->tcp_hdr_len = NET_TCP_HDR_LEN(tcp_hdr);
+	if (seg->tcp_hdr_len < sizeof(struct net_tcp_hdr) ||
+	    seg->ip_hdr_len + seg->tcp_hdr_len > seg->len) {
+		goto out;
+	}
+
+	seg->src_port = tcp_hdr->src_port;
+	seg->dst_port = tcp_hdr->dst_port;
+	seg->seq = sys_get_be32(tcp_hdr->seq);
+	seg->ack = sys_get_be32(tcp_hdr->ack);
+	seg->flags = tcp_hdr->flags;
+	memcpy(seg->wnd, tcp_hdr->wnd, sizeof(seg->wnd));
+	seg->payload_len = seg->len - seg->ip_hdr_len - seg->tcp_hdr_len;
+
+	if (net_pkt_skip(pkt, sizeof(struct net_tcp_hdr)) ||
+	    net_pkt_read(pkt, seg->opts,
+			 seg->tcp_hdr_len - sizeof(struct net_tcp_hdr))) {
+		goto out;
+	}
+
+	ret = true;
+out:
+	net_pkt_cursor_init(pkt);
+
+	return ret;
+}
+
+static bool gro_same_flow(struct gro_flow *flow, struct gro_seg *seg)
+{
+	struct net_pkt *held = flow->pkt;
+
+	if (net_pkt_family(held) != seg->family) {
+		return false;
+	}
+
+	if (IS_ENABLED(CONFIG_NET_IPV4) && seg->family == AF_INET) {
+		if (!net_ipv4_addr_cmp(&NET_IPV4_HDR(held)->src,
+				       &seg->ipv4->src) ||
+		    !net_ipv4_addr_cmp(&NET_IPV4_HDR(held)->dst,
+				       &seg->ipv4->dst)) {
+			return false;
+		}
+	} else if (IS_ENABLED(CONFIG_NET_IPV6) && seg->family == AF_INET6) {
+		if (!net_ipv6_addr_cmp(&NET_IPV6_HDR(held)->src,
+				       &seg->ipv6->src) ||
+		    !net_ipv6_addr_cmp(&NET_IPV6_HDR(held)->dst,
+				       &seg->ipv6->dst)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static struct gro_flow *gro_lookup(struct gro_table *table,
+				   struct gro_seg *seg)
+{
+	int i;
+
+	if (!table->held) {
+		return NULL;
+	}
+
+	for (i = 0; i < CONFIG_NET_GRO_FLOWS; i++) {
+		struct gro_flow *flow = &table->flows[i];
+
+		if (!flow->pkt) {
+			continue;
+		}
+
+		if (flow->src_port == seg->src_port &&
+		    flow->dst_port == seg->dst_port &&
+		    gro_same_flow(flow, seg)) {
+			return flow;
+		}
+	}
+
+	return NULL;
+}
+
+/* Check that the segment only carries in-sequence data, and that the
+ * checksums we are about to lose are valid.
+ */
+static bool gro_seg_is_mergeable(struct net_pkt *pkt, struct gro_seg *seg)
+{
+	if (!seg->payload_len || !(seg->flags & NET_TCP_ACK) ||
+	    (seg->flags & ~(NET_TCP_ACK | NET_TCP_PSH))) {
+		return false;
+	}
+
+	/* Remove the link layer padding */
+	if (net_pkt_get_len(pkt) > seg->len) {
+		net_pkt_update_length(pkt, seg->len);
+		net_pkt_trim_buffer(pkt);
+	}
+
+	net_pkt_set_family(pkt, seg->family);
+	net_pkt_set_ip_hdr_len(pkt, seg->ip_hdr_len);
+
+	if (IS_ENABLED(CONFIG_NET_IPV4) && seg->family == AF_INET) {
+		net_pkt_set_ipv4_opts_len(pkt, 0);
+	} else if (IS_ENABLED(CONFIG_NET_IPV6)) {
+		net_pkt_set_ipv6_ext_len(pkt, 0);
+	}
+
+	if (net_pkt_is_chksum_verified(pkt) ||
+	    !net_if_need_calc_rx_checksum(net_pkt_iface(pkt))) {
+		return true;
+	}
+
+#if defined(CONFIG_NET_IPV4)
+	if (seg->family == AF_INET && net_calc_chksum_ipv4(pkt) != 0U) {
+		return false;
+	}
+#endif
+
+	if (IS_ENABLED(CONFIG_NET_TCP_CHECKSUM)) {
+		if (net_calc_chksum_tcp(pkt) != 0U) {
+			return false;
+		}
+
+		net_pkt_set_chksum_verified(pkt, true);
+	}
+
+	return true;
+}
+
+static bool gro_can_merge(struct gro_flow *flow, struct gro_seg *seg)
+{
+	return seg->seq == flow->next_seq && seg->ack == flow->ack &&
+		seg->tcp_hdr_len == flow->tcp_hdr_len &&
+		flow->len + seg->payload_len <= GRO_MAX_LEN &&
+		!memcmp(seg->opts, flow->opts,
+			seg->tcp_hdr_len - sizeof(struct net_tcp_hdr));
+}
+
+/* Write the new lengths, window and flags to the held packet */
+static void gro_update_headers(struct gro_flow *flow)
+{
+	NET_PKT_DATA_ACCESS_DEFINE(tcp_access, struct net_tcp_hdr);
+	struct net_pkt *pkt = flow->pkt;
+	struct net_tcp_hdr *tcp_hdr;
+
+#if defined(CONFIG_NET_IPV4)
+	if (net_pkt_family(pkt) == AF_INET) {
+		NET_IPV4_HDR(pkt)->len = htons(flow->len);
+		NET_IPV4_HDR(pkt)->chksum = 0U;
+		NET_IPV4_HDR(pkt)->chksum = net_calc_chksum_ipv4(pkt);
+	}
+#endif
+#if defined(CONFIG_NET_IPV6)
+	if (net_pkt_family(pkt) == AF_INET6) {
+		NET_IPV6_HDR(pkt)->len =
+			htons(flow->len - sizeof(struct net_ipv6_hdr));
+	}
+#endif
+
+	net_pkt_cursor_init(pkt);
+	net_pkt_set_overwrite(pkt, true);
+
+	if (net_pkt_skip(pkt, flow->ip_hdr_len)) {
+		return;
+	}
+
+	tcp_hdr = (struct net_tcp_hdr *)net_pkt_get_data(pkt, &tcp_access);
+	if (!tcp_hdr) {
+		return;
+	}
+
+	tcp_hdr->flags |= flow->flags;
+	memcpy(tcp_hdr->wnd, flow->wnd, sizeof(tcp_hdr->wnd));
+
+	net_pkt_set_data(pkt, &tcp_access);
+	net_pkt_cursor_init(pkt);
+}
+
+static void gro_flush(struct gro_table *table, struct gro_flow *flow,
+		      net_gro_deliver_cb_t deliver)
+{
+	struct net_pkt *pkt = flow->pkt;
+
+	NET_DBG("Flush pkt %p, %u segments len %u", pkt, flow->segs,
+		flow->len);
+
+	if (flow->segs > 1) {
+		gro_update_headers(flow);
+	}
+
+	flow->pkt = NULL;
+	table->held--;
+
+	deliver(pkt);
+}
+
+static void gro_hold(struct gro_table *table, struct gro_flow *flow,
+		     struct net_pkt *pkt, struct gro_seg *seg)
+{
+	flow->pkt = pkt;
+	flow->next_seq = seg->seq + seg->payload_len;
+	flow->ack = seg->ack;
+	flow->tick = table->tick;
+	flow->len = seg->len;
+	flow->src_port = seg->src_port;
+	flow->dst_port = seg->dst_port;
+	flow->flags = 0U;
+	flow->segs = 1U;
+	flow->ip_hdr_len = seg->ip_hdr_len;
+	flow->tcp_hdr_len = seg->tcp_hdr_len;
+	memcpy(flow->wnd, seg->wnd, sizeof(flow->wnd));
+	memcpy(flow->opts, seg->opts,
+	       seg->tcp_hdr_len - sizeof(struct net_tcp_hdr));
+
+	table->held++;
+}
+
+/* Remove the IP and TCP headers of a merged segment, without moving the
+ * payload.
+ */
+static void gro_pull_headers(struct net_pkt *pkt, size_t len)
+{
+	while (pkt->buffer && len) {
+		size_t pull = MIN(len, pkt->buffer->len);
+
+		net_buf_pull(pkt->buffer, pull);
+		len -= pull;
+
+		if (!pkt->buffer->len) {
+			pkt->buffer = net_buf_frag_del(NULL, pkt->buffer);
+		}
+	}
+}
+
+static void gro_merge(struct gro_flow *flow, struct net_pkt *pkt,
+		      struct gro_seg *seg)
+{
+	gro_pull_headers(pkt, seg->ip_hdr_len + seg->tcp_hdr_len);
+
+	net_pkt_append_buffer(flow->pkt, pkt->buffer);
+	pkt->buffer = NULL;
+	net_pkt_unref(pkt);
+
+	flow->next_seq += seg->payload_len;
+	flow->len += seg->payload_len;
+	flow->flags |= seg->flags & NET_TCP_PSH;
+	flow->segs++;
+	memcpy(flow->wnd, seg->wnd, sizeof(flow->wnd));
+}
+
+static struct gro_flow *gro_get_free(struct gro_table *table,
+				     net_gro_deliver_cb_t deliver)
+{
+	struct gro_flow *oldest = NULL;
+	int i;
+
+	for (i = 0; i < CONFIG_NET_GRO_FLOWS; i++) {
+		struct gro_flow *flow = &table->flows[i];
+
+		if (!flow->pkt) {
+			return flow;
+		}
+
+		if (!oldest || (s32_t)(flow->tick - oldest->tick) < 0) {
+			oldest = flow;
+		}
+	}
+
+	gro_flush(table, oldest, deliver);
+
+	return oldest;
+}
+
+enum net_verdict net_gro_receive(struct net_pkt *pkt,
+				 net_gro_deliver_cb_t deliver)
+{
+	struct gro_table *table;
+	struct gro_flow *flow;
+	struct gro_seg seg;
+	int worker;
+
+	worker = net_tc_rx_worker();
+	if (worker < 0) {
+		return NET_CONTINUE;
+	}
+
+	table = &gro_tables[worker];
+	table->tick++;
+
+	if (!gro_parse(pkt, &seg)) {
+		return NET_CONTINUE;
+	}
+
+	flow = gro_lookup(table, &seg);
+
+	if (!gro_seg_is_mergeable(pkt, &seg)) {
+		/* Keep the segments of the flow in order */
+		if (flow) {
+			gro_flush(table, flow, deliver);
+		}
+
+		return NET_CONTINUE;
+	}
+
+	if (flow) {
+		if (gro_can_merge(flow, &seg)) {
+			gro_merge(flow, pkt, &seg);
+
+			if ((flow->flags & NET_TCP_PSH) ||
+			    flow->segs >= CONFIG_NET_GRO_MAX_SEGMENTS) {
+				gro_flush(table, flow, deliver);
+			}
+
+			return NET_OK;
+		}
+
+		gro_flush(table, flow, deliver);
+	}
+
+	/* Nothing will be merged after a pushed segment */
+	if (seg.flags & NET_TCP_PSH) {
+		return NET_CONTINUE;
+	}
+
+	flow = gro_get_free(table, deliver);
+	gro_hold(table, flow, pkt, &seg);
+
+	return NET_OK;
+}
+
+void net_gro_complete(net_gro_deliver_cb_t deliver)
+{
+	struct gro_table *table;
+	bool idle;
+	int worker;
+	int i;
+
+	worker = net_tc_rx_worker();
+	if (worker < 0) {
+		return;
+	}
+
+	table = &gro_tables[worker];
+	if (!table->held) {
+		return;
+	}
+
+	/* Like the end of a NAPI poll in other stacks: once there is nothing
+	 * more to receive, there is nothing to wait for either.
+	 */
+	idle = net_tc_rx_worker_is_idle(worker);
+
+	for (i = 0; i < CONFIG_NET_GRO_FLOWS; i++) {
+		struct gro_flow *flow = &table->flows[i];
+
+		if (flow->pkt &&
+		    (idle || table->tick - flow->tick >= GRO_MAX_AGE)) {
+			gro_flush(table, flow, deliver);
+		}
+	}
+}
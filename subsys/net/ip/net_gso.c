@@ -0,0 +1,243 @@
+/** @file
+ * @brief Generic segmentation offload for TCP
+ *
+ * TCP can build packets that are larger than the link MTU. They are split
+ * into MTU sized segments here, just before they are handed to L2, unless
+ * the device can do the segmentation by itself.
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_gso, CONFIG_NET_TCP_LOG_LEVEL);
+
+#include <zephyr.h>
+#include <string.h>
+
+#include <net/net_core.h>
+#include <net/net_pkt.h>
+#include <net/net_if.h>
+#include <net/ethernet.h>
+
+#include "net_private.h"
+#include "tcp_internal.h"
+
+#define GSO_ALLOC_TIMEOUT K_MSEC(100)
+
+static bool gso_hw_tso(struct net_if *iface)
+{
+	return net_if_l2(iface) == &NET_L2_GET_NAME(ETHERNET) &&
+		(net_eth_get_hw_capabilities(iface) & ETHERNET_HW_TSO);
+}
+
+/* Return the length of the IP and TCP headers of the packet */
+static int gso_hdr_len(struct net_pkt *pkt, u32_t *seq)
+{
+	NET_PKT_DATA_ACCESS_DEFINE(tcp_access, struct net_tcp_hdr);
+	size_t ip_hdr_len = net_pkt_ip_hdr_len(pkt) + net_pkt_ip_opts_len(pkt);
+	struct net_tcp_hdr *tcp_hdr;
+
+	net_pkt_cursor_init(pkt);
+	net_pkt_set_overwrite(pkt, true);
+
+	if (net_pkt_skip(pkt, ip_hdr_len)) {
+		return -EINVAL;
+	}
+
+	tcp_hdr = (struct net_tcp_hdr *)net_pkt_get_data(pkt, &tcp_access);
+	if (!tcp_hdr) {
+		return -EINVAL;
+	}
+
+	*seq = sys_get_be32(tcp_hdr->seq);
+
+	return ip_hdr_len + NET_TCP_HDR_LEN(tcp_hdr);
+}
+
+static void gso_copy_attributes(struct net_pkt *seg, struct net_pkt *pkt)
+{
+	net_pkt_set_family(seg, net_pkt_family(pkt));
+	net_pkt_set_ip_hdr_len(seg, net_pkt_ip_hdr_len(pkt));
+	net_pkt_set_priority(seg, net_pkt_priority(pkt));
+	net_pkt_set_vlan_tag(seg, net_pkt_vlan_tag(pkt));
+
+	memcpy(net_pkt_lladdr_src(seg), net_pkt_lladdr_src(pkt),
+	       sizeof(struct net_linkaddr));
+	memcpy(net_pkt_lladdr_dst(seg), net_pkt_lladdr_dst(pkt),
+	       sizeof(struct net_linkaddr));
+
+	if (IS_ENABLED(CONFIG_NET_IPV4) && net_pkt_family(pkt) == AF_INET) {
+		net_pkt_set_ipv4_ttl(seg, net_pkt_ipv4_ttl(pkt));
+		net_pkt_set_ipv4_opts_len(seg, net_pkt_ipv4_opts_len(pkt));
+	} else if (IS_ENABLED(CONFIG_NET_IPV6) &&
+		   net_pkt_family(pkt) == AF_INET6) {
+		net_pkt_set_ipv6_hop_limit(seg, net_pkt_ipv6_hop_limit(pkt));
+		net_pkt_set_ipv6_ext_len(seg, net_pkt_ipv6_ext_len(pkt));
+	}
+}
+
+/* Fix the IP length, the TCP sequence number and flags, and the checksums
+ * of a segment.
+ */
+static int gso_finalize(struct net_pkt *seg, size_t ip_hdr_len,
+			u32_t seq, bool last)
+{
+	NET_PKT_DATA_ACCESS_DEFINE(tcp_access, struct net_tcp_hdr);
+	size_t len = net_pkt_get_len(seg);
+	struct net_tcp_hdr *tcp_hdr;
+
+#if defined(CONFIG_NET_IPV4)
+	if (net_pkt_family(seg) == AF_INET) {
+		NET_IPV4_HDR(seg)->len = htons(len);
+		NET_IPV4_HDR(seg)->chksum = 0U;
+
+		if (net_if_need_calc_tx_checksum(net_pkt_iface(seg))) {
+			NET_IPV4_HDR(seg)->chksum = net_calc_chksum_ipv4(seg);
+		}
+	}
+#endif
+#if defined(CONFIG_NET_IPV6)
+	if (net_pkt_family(seg) == AF_INET6) {
+		NET_IPV6_HDR(seg)->len =
+			htons(len - sizeof(struct net_ipv6_hdr));
+	}
+#endif
+
+	net_pkt_cursor_init(seg);
+	net_pkt_set_overwrite(seg, true);
+
+	if (net_pkt_skip(seg, ip_hdr_len)) {
+		return -EINVAL;
+	}
+
+	tcp_hdr = (struct net_tcp_hdr *)net_pkt_get_data(seg, &tcp_access);
+	if (!tcp_hdr) {
+		return -EINVAL;
+	}
+
+	sys_put_be32(seq, tcp_hdr->seq);
+
+	/* Only the last segment ends the write */
+	if (!last) {
+		tcp_hdr->flags &= ~(NET_TCP_PSH | NET_TCP_FIN);
+	}
+
+	tcp_hdr->chksum = 0U;
+	net_pkt_set_data(seg, &tcp_access);
+
+	net_pkt_cursor_init(seg);
+	net_pkt_skip(seg, ip_hdr_len);
+
+	/* No need to get tcp_hdr again */
+	tcp_hdr->chksum = net_calc_chksum_tx(seg, IPPROTO_TCP);
+
+	net_pkt_set_data(seg, &tcp_access);
+
+	net_pkt_cursor_init(seg);
+
+	return 0;
+}
+
+static struct net_pkt *gso_segment(struct net_pkt *pkt, size_t hdr_len,
+				   size_t offset, size_t len, u32_t seq,
+				   bool last)
+{
+	struct net_pkt *seg;
+
+	seg = net_pkt_alloc_with_buffer(net_pkt_iface(pkt), hdr_len + len,
+					AF_UNSPEC, 0, GSO_ALLOC_TIMEOUT);
+	if (!seg) {
+		return NULL;
+	}
+
+	gso_copy_attributes(seg, pkt);
+
+	/* Headers of the original packet, then the payload of the segment */
+	net_pkt_cursor_init(pkt);
+
+	if (net_pkt_copy(seg, pkt, hdr_len) ||
+	    net_pkt_skip(pkt, offset) ||
+	    net_pkt_copy(seg, pkt, len)) {
+		goto fail;
+	}
+
+	if (gso_finalize(seg, net_pkt_ip_hdr_len(pkt) +
+			 net_pkt_ip_opts_len(pkt), seq, last)) {
+		goto fail;
+	}
+
+	return seg;
+
+fail:
+	net_pkt_unref(seg);
+	return NULL;
+}
+
+int net_gso_send(struct net_if *iface, struct net_pkt *pkt)
+{
+	size_t mss = net_pkt_gso_size(pkt);
+	size_t payload_len, offset;
+	int sent = 0;
+	int hdr_len;
+	u32_t seq;
+	int ret = 0;
+
+	if (!mss || gso_hw_tso(iface)) {
+		return net_if_l2(iface)->send(iface, pkt);
+	}
+
+	hdr_len = gso_hdr_len(pkt, &seq);
+	if (hdr_len < 0) {
+		return hdr_len;
+	}
+
+	payload_len = net_pkt_get_len(pkt) - hdr_len;
+	if (payload_len <= mss) {
+		net_pkt_cursor_init(pkt);
+		return net_if_l2(iface)->send(iface, pkt);
+	}
+
+	NET_DBG("Split pkt %p of %zu bytes in %zu byte segments", pkt,
+		payload_len, mss);
+
+	for (offset = 0; offset < payload_len; offset += mss) {
+		size_t len = MIN(mss, payload_len - offset);
+		struct net_pkt *seg;
+
+		seg = gso_segment(pkt, hdr_len, offset, len, seq + offset,
+				  offset + len == payload_len);
+		if (!seg) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		ret = net_if_l2(iface)->send(iface, seg);
+		if (ret < 0) {
+			net_pkt_unref(seg);
+			break;
+		}
+
+		sent += ret;
+	}
+
+	if (ret < 0) {
+		if (!sent) {
+			return ret;
+		}
+
+		/* The first segments are already on the wire, so this is
+		 * reported as a short send, the rest is retransmitted by TCP
+		 * as for a lost segment.
+		 */
+		NET_DBG("Only %d bytes of pkt %p sent (%d)", sent, pkt, ret);
+	}
+
+	/* Released like L2 does after a successful send */
+	net_pkt_unref(pkt);
+
+	return sent;
+}
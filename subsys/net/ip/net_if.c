@@ -21,6 +21,7 @@ LOG_MODULE_REGISTER(net_if, CONFIG_NET_IF_LOG_LEVEL);
 
 #include "net_private.h"
 #include "ipv6.h"
+#include "ipv4.h"
 #include "ipv4_autoconf_internal.h"
 
 #include "net_stats.h"
@@ -85,6 +86,182 @@ static struct {
 } ipv4_addresses[CONFIG_NET_IF_MAX_IPV4_COUNT];
 #endif /* CONFIG_NET_IPV4 */
 
+#if defined(CONFIG_NET_IF_ADDR_HASH)
+/* The unicast addresses of all the interfaces, in open addressing hash
+ * tables with linear probing. Lookups do not take a lock, they start over
+ * if addr_hash_seq has changed meanwhile. It is odd while a table is
+ * being changed.
+ */
+struct addr_hash_entry {
+	struct net_if_addr *ifaddr;
+	struct net_if *iface;
+	u32_t hash;
+};
+
+typedef bool (*addr_hash_match_t)(struct net_if_addr *ifaddr,
+				  const void *addr);
+
+static struct k_spinlock addr_hash_lock;
+static atomic_t addr_hash_seq;
+
+/* At most half full, so that the probe sequences stay short */
+#if defined(CONFIG_NET_NATIVE_IPV6)
+static struct addr_hash_entry ipv6_addr_hash[2 * NET_IF_MAX_IPV6_ADDR *
+					     CONFIG_NET_IF_MAX_IPV6_COUNT];
+#endif
+
+#if defined(CONFIG_NET_NATIVE_IPV4)
+static struct addr_hash_entry ipv4_addr_hash[2 * NET_IF_MAX_IPV4_ADDR *
+					     CONFIG_NET_IF_MAX_IPV4_COUNT];
+#endif
+
+static inline u32_t addr_hash_mix(u32_t hash, u32_t word)
+{
+	hash = (hash ^ word) * 0x9e3779b1U;
+
+	return hash ^ (hash >> 16);
+}
+
+static void addr_hash_add(struct addr_hash_entry *table, size_t size,
+			  u32_t hash, struct net_if *iface,
+			  struct net_if_addr *ifaddr)
+{
+	k_spinlock_key_t key;
+	size_t i;
+
+	key = k_spin_lock(&addr_hash_lock);
+	atomic_inc(&addr_hash_seq);
+
+	/* There is a slot in the table for every address slot, so there
+	 * is always a free entry.
+	 */
+	for (i = hash % size; table[i].ifaddr; i = (i + 1) % size) {
+	}
+
+	table[i].hash = hash;
+	table[i].iface = iface;
+	table[i].ifaddr = ifaddr;
+
+	atomic_inc(&addr_hash_seq);
+	k_spin_unlock(&addr_hash_lock, key);
+}
+
+/* Called with addr_hash_lock held and addr_hash_seq odd */
+static void addr_hash_del_entry(struct addr_hash_entry *table, size_t size,
+				size_t i)
+{
+	size_t j = i;
+	size_t home;
+
+	/* Move back the entries that follow in the same probe sequence,
+	 * so that no lookup stops at the hole.
+	 */
+	for (;;) {
+		j = (j + 1) % size;
+
+		if (!table[j].ifaddr) {
+			break;
+		}
+
+		home = table[j].hash % size;
+
+		if ((j > i && (home <= i || home > j)) ||
+		    (j < i && home <= i && home > j)) {
+			table[i] = table[j];
+			i = j;
+		}
+	}
+
+	table[i].ifaddr = NULL;
+	table[i].iface = NULL;
+}
+
+static void addr_hash_del(struct addr_hash_entry *table, size_t size,
+			  u32_t hash, struct net_if_addr *ifaddr)
+{
+	k_spinlock_key_t key;
+	size_t i;
+
+	key = k_spin_lock(&addr_hash_lock);
+	atomic_inc(&addr_hash_seq);
+
+	for (i = hash % size; table[i].ifaddr; i = (i + 1) % size) {
+		if (table[i].ifaddr == ifaddr) {
+			addr_hash_del_entry(table, size, i);
+			break;
+		}
+	}
+
+	atomic_inc(&addr_hash_seq);
+	k_spin_unlock(&addr_hash_lock, key);
+}
+
+static void addr_hash_del_iface(struct addr_hash_entry *table, size_t size,
+				struct net_if *iface)
+{
+	k_spinlock_key_t key;
+	size_t i = 0;
+
+	key = k_spin_lock(&addr_hash_lock);
+	atomic_inc(&addr_hash_seq);
+
+	/* An entry moved back to i by a removal is checked again */
+	while (i < size) {
+		if (table[i].ifaddr && table[i].iface == iface) {
+			addr_hash_del_entry(table, size, i);
+			continue;
+		}
+
+		i++;
+	}
+
+	atomic_inc(&addr_hash_seq);
+	k_spin_unlock(&addr_hash_lock, key);
+}
+
+static struct net_if_addr *addr_hash_lookup(struct addr_hash_entry *table,
+					    size_t size, u32_t hash,
+					    addr_hash_match_t match,
+					    const void *addr,
+					    struct net_if **ret)
+{
+	struct net_if_addr *found, *ifaddr;
+	struct net_if *found_iface;
+	atomic_val_t seq;
+	size_t i, count;
+
+	do {
+		seq = atomic_get(&addr_hash_seq);
+		found = NULL;
+		found_iface = NULL;
+
+		/* The same address can be on several interfaces, return
+		 * it for the first one like a walk of the interfaces would.
+		 */
+		for (i = hash % size, count = 0;
+		     count < size && (ifaddr = table[i].ifaddr) != NULL;
+		     i = (i + 1) % size, count++) {
+			if (table[i].hash != hash || !match(ifaddr, addr)) {
+				continue;
+			}
+
+			if (!found || table[i].iface < found_iface) {
+				found = ifaddr;
+				found_iface = table[i].iface;
+			}
+		}
+
+		compiler_barrier();
+	} while ((seq & 1) || atomic_get(&addr_hash_seq) != seq);
+
+	if (found && ret) {
+		*ret = found_iface;
+	}
+
+	return found;
+}
+#endif /* CONFIG_NET_IF_ADDR_HASH */
+
 /* We keep track of the link callbacks in this list.
  */
 static sys_slist_t link_callbacks;
@@ -204,7 +381,13 @@ static bool net_if_tx(struct net_if *iface, struct net_pkt *pkt)
 			pkt_priority = net_pkt_priority(pkt);
 		}
 
-		status = net_if_l2(iface)->send(iface, pkt);
+		net_capture_tx(iface, pkt);
+
+		if (IS_ENABLED(CONFIG_NET_GSO) && net_pkt_gso_size(pkt)) {
+			status = net_gso_send(iface, pkt);
+		} else {
+			status = net_if_l2(iface)->send(iface, pkt);
+		}
 
 		if (IS_ENABLED(CONFIG_NET_CONTEXT_TIMESTAMP) && status >= 0 &&
 		    context) {
@@ -383,10 +566,13 @@ enum net_verdict net_if_send_data(struct net_if *iface, struct net_pkt *pkt)
 #endif
 
 	/* If the ll dst address is not set check if it is present in the nbr
-	 * cache.
+	 * cache. Packets larger than the MTU are fragmented here too.
 	 */
 	if (IS_ENABLED(CONFIG_NET_IPV6) && net_pkt_family(pkt) == AF_INET6) {
 		verdict = net_ipv6_prepare_for_send(pkt);
+	} else if (IS_ENABLED(CONFIG_NET_IPV4) &&
+		   net_pkt_family(pkt) == AF_INET) {
+		verdict = net_ipv4_prepare_for_send(pkt);
 	}
 
 done:
@@ -764,6 +950,51 @@ static void iface_router_init(void)
 #endif
 
 #if defined(CONFIG_NET_NATIVE_IPV6)
+#if defined(CONFIG_NET_IF_ADDR_HASH)
+static u32_t ipv6_addr_hash_key(const struct in6_addr *addr)
+{
+	u32_t hash = 0U;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		hash = addr_hash_mix(hash, UNALIGNED_GET(&addr->s6_addr32[i]));
+	}
+
+	return hash;
+}
+
+static bool ipv6_addr_hash_match(struct net_if_addr *ifaddr,
+				 const void *addr)
+{
+	return ifaddr->is_used && ifaddr->address.family == AF_INET6 &&
+		net_ipv6_addr_cmp(&ifaddr->address.in6_addr, addr);
+}
+
+static inline void ipv6_addr_hash_add(struct net_if *iface,
+				      struct net_if_addr *ifaddr)
+{
+	addr_hash_add(ipv6_addr_hash, ARRAY_SIZE(ipv6_addr_hash),
+		      ipv6_addr_hash_key(&ifaddr->address.in6_addr),
+		      iface, ifaddr);
+}
+
+static inline void ipv6_addr_hash_del(struct net_if_addr *ifaddr)
+{
+	addr_hash_del(ipv6_addr_hash, ARRAY_SIZE(ipv6_addr_hash),
+		      ipv6_addr_hash_key(&ifaddr->address.in6_addr), ifaddr);
+}
+
+static inline void ipv6_addr_hash_del_iface(struct net_if *iface)
+{
+	addr_hash_del_iface(ipv6_addr_hash, ARRAY_SIZE(ipv6_addr_hash),
+			    iface);
+}
+#else
+#define ipv6_addr_hash_add(...)
+#define ipv6_addr_hash_del(...)
+#define ipv6_addr_hash_del_iface(...)
+#endif /* CONFIG_NET_IF_ADDR_HASH */
+
 int net_if_config_ipv6_get(struct net_if *iface, struct net_if_ipv6 **ipv6)
 {
 	int i;
@@ -807,6 +1038,8 @@ int net_if_config_ipv6_put(struct net_if *iface)
 			continue;
 		}
 
+		ipv6_addr_hash_del_iface(iface);
+
 		iface->config.ip.ipv6 = NULL;
 		ipv6_addresses[i].iface = NULL;
 
@@ -1150,6 +1383,11 @@ static inline void iface_ipv6_nd_init(void)
 struct net_if_addr *net_if_ipv6_addr_lookup(const struct in6_addr *addr,
 					    struct net_if **ret)
 {
+#if defined(CONFIG_NET_IF_ADDR_HASH)
+	return addr_hash_lookup(ipv6_addr_hash, ARRAY_SIZE(ipv6_addr_hash),
+				ipv6_addr_hash_key(addr), ipv6_addr_hash_match,
+				addr, ret);
+#else
 	struct net_if *iface;
 
 	for (iface = __net_if_start; iface != __net_if_end; iface++) {
@@ -1181,6 +1419,7 @@ struct net_if_addr *net_if_ipv6_addr_lookup(const struct in6_addr *addr,
 	}
 
 	return NULL;
+#endif
 }
 
 struct net_if_addr *net_if_ipv6_addr_lookup_by_iface(struct net_if *iface,
@@ -1460,6 +1699,8 @@ struct net_if_addr *net_if_ipv6_addr_add(struct net_if *iface,
 		net_if_addr_init(&ipv6->unicast[i], addr, addr_type,
 				 vlifetime);
 
+		ipv6_addr_hash_add(iface, &ipv6->unicast[i]);
+
 		NET_DBG("[%d] interface %p address %s type %s added", i,
 			iface, log_strdup(net_sprint_ipv6_addr(addr)),
 			net_addr_type2str(addr_type));
@@ -1526,6 +1767,8 @@ bool net_if_ipv6_addr_rm(struct net_if *iface, const struct in6_addr *addr)
 			}
 		}
 
+		ipv6_addr_hash_del(&ipv6->unicast[i]);
+
 		ipv6->unicast[i].is_used = false;
 
 		net_ipv6_addr_create_solicited_node(addr, &maddr);
@@ -2515,6 +2758,45 @@ struct in6_addr *net_if_ipv6_get_global_addr(enum net_addr_state state,
 #endif /* CONFIG_NET_IPV6 */
 
 #if defined(CONFIG_NET_NATIVE_IPV4)
+#if defined(CONFIG_NET_IF_ADDR_HASH)
+static inline u32_t ipv4_addr_hash_key(const struct in_addr *addr)
+{
+	return addr_hash_mix(0U, UNALIGNED_GET(&addr->s4_addr32[0]));
+}
+
+static bool ipv4_addr_hash_match(struct net_if_addr *ifaddr,
+				 const void *addr)
+{
+	return ifaddr->is_used && ifaddr->address.family == AF_INET &&
+		ifaddr->address.in_addr.s_addr ==
+		UNALIGNED_GET(&((const struct in_addr *)addr)->s4_addr32[0]);
+}
+
+static inline void ipv4_addr_hash_add(struct net_if *iface,
+				      struct net_if_addr *ifaddr)
+{
+	addr_hash_add(ipv4_addr_hash, ARRAY_SIZE(ipv4_addr_hash),
+		      ipv4_addr_hash_key(&ifaddr->address.in_addr),
+		      iface, ifaddr);
+}
+
+static inline void ipv4_addr_hash_del(struct net_if_addr *ifaddr)
+{
+	addr_hash_del(ipv4_addr_hash, ARRAY_SIZE(ipv4_addr_hash),
+		      ipv4_addr_hash_key(&ifaddr->address.in_addr), ifaddr);
+}
+
+static inline void ipv4_addr_hash_del_iface(struct net_if *iface)
+{
+	addr_hash_del_iface(ipv4_addr_hash, ARRAY_SIZE(ipv4_addr_hash),
+			    iface);
+}
+#else
+#define ipv4_addr_hash_add(...)
+#define ipv4_addr_hash_del(...)
+#define ipv4_addr_hash_del_iface(...)
+#endif /* CONFIG_NET_IF_ADDR_HASH */
+
 int net_if_config_ipv4_get(struct net_if *iface, struct net_if_ipv4 **ipv4)
 {
 	int i;
@@ -2558,6 +2840,8 @@ int net_if_config_ipv4_put(struct net_if *iface)
 			continue;
 		}
 
+		ipv4_addr_hash_del_iface(iface);
+
 		iface->config.ip.ipv4 = NULL;
 		ipv4_addresses[i].iface = NULL;
 
@@ -2620,6 +2904,35 @@ bool net_if_ipv4_addr_mask_cmp(struct net_if *iface,
 	return false;
 }
 
+bool net_if_ipv4_addr_onlink(struct net_if **iface,
+			     const struct in_addr *addr)
+{
+	struct net_if *tmp;
+
+	for (tmp = __net_if_start; tmp != __net_if_end; tmp++) {
+		struct net_if_ipv4 *ipv4 = tmp->config.ip.ipv4;
+
+		if (iface && *iface && *iface != tmp) {
+			continue;
+		}
+
+		/* Without a netmask every address would match */
+		if (!ipv4 || !ipv4->netmask.s_addr) {
+			continue;
+		}
+
+		if (net_if_ipv4_addr_mask_cmp(tmp, addr)) {
+			if (iface) {
+				*iface = tmp;
+			}
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static bool ipv4_is_broadcast_address(struct net_if *iface,
 				      const struct in_addr *addr)
 {
@@ -2833,6 +3146,11 @@ const struct in_addr *net_if_ipv4_select_src_addr(struct net_if *dst_iface,
 struct net_if_addr *net_if_ipv4_addr_lookup(const struct in_addr *addr,
 					    struct net_if **ret)
 {
+#if defined(CONFIG_NET_IF_ADDR_HASH)
+	return addr_hash_lookup(ipv4_addr_hash, ARRAY_SIZE(ipv4_addr_hash),
+				ipv4_addr_hash_key(addr), ipv4_addr_hash_match,
+				addr, ret);
+#else
 	struct net_if *iface;
 
 	for (iface = __net_if_start; iface != __net_if_end; iface++) {
@@ -2862,6 +3180,7 @@ struct net_if_addr *net_if_ipv4_addr_lookup(const struct in_addr *addr,
 	}
 
 	return NULL;
+#endif
 }
 
 int z_impl_net_if_ipv4_addr_lookup_by_index(const struct in_addr *addr)
@@ -3037,6 +3356,11 @@ struct net_if_addr *net_if_ipv4_addr_add(struct net_if *iface,
 	}
 
 	if (ifaddr) {
+		if (ifaddr->is_used) {
+			/* Replacing an overridable address */
+			ipv4_addr_hash_del(ifaddr);
+		}
+
 		ifaddr->is_used = true;
 		ifaddr->address.family = AF_INET;
 		ifaddr->address.in_addr.s4_addr32[0] =
@@ -3056,6 +3380,8 @@ struct net_if_addr *net_if_ipv4_addr_add(struct net_if *iface,
 		 */
 		ifaddr->addr_state = NET_ADDR_PREFERRED;
 
+		ipv4_addr_hash_add(iface, ifaddr);
+
 		NET_DBG("[%d] interface %p address %s type %s added", i, iface,
 			log_strdup(net_sprint_ipv4_addr(addr)),
 			net_addr_type2str(addr_type));
@@ -3089,6 +3415,8 @@ bool net_if_ipv4_addr_rm(struct net_if *iface, const struct in_addr *addr)
 			continue;
 		}
 
+		ipv4_addr_hash_del(&ipv4->unicast[i]);
+
 		ipv4->unicast[i].is_used = false;
 
 		NET_DBG("[%d] interface %p address %s removed",
@@ -3437,6 +3765,11 @@ bool net_if_need_calc_tx_checksum(struct net_if *iface)
 	return need_calc_checksum(iface, ETHERNET_HW_TX_CHKSUM_OFFLOAD);
 }
 
+bool net_if_tx_checksum_partial(struct net_if *iface)
+{
+	return !need_calc_checksum(iface, ETHERNET_HW_TX_CHKSUM_PARTIAL);
+}
+
 bool net_if_need_calc_rx_checksum(struct net_if *iface)
 {
 	return need_calc_checksum(iface, ETHERNET_HW_RX_CHKSUM_OFFLOAD);
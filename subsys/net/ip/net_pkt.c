@@ -39,6 +39,7 @@ LOG_MODULE_REGISTER(net_pkt, CONFIG_NET_PKT_LOG_LEVEL);
 #include <net/udp.h>
 
 #include "net_private.h"
+#include "net_stats.h"
 #include "tcp_internal.h"
 
 /* Find max header size of IP protocol (IPv4 or IPv6) */
@@ -79,7 +80,8 @@ LOG_MODULE_REGISTER(net_pkt, CONFIG_NET_PKT_LOG_LEVEL);
 /* Make sure that IP + TCP/UDP/ICMP headers fit into one fragment. This
  * makes possible to cast a fragment pointer to protocol header struct.
  */
-#if CONFIG_NET_BUF_DATA_SIZE < (MAX_IP_PROTO_LEN + MAX_NEXT_PROTO_LEN)
+#if defined(CONFIG_NET_BUF_FIXED_DATA_SIZE) && \
+	CONFIG_NET_BUF_DATA_SIZE < (MAX_IP_PROTO_LEN + MAX_NEXT_PROTO_LEN)
 #if defined(STRING2)
 #undef STRING2
 #endif
@@ -93,6 +95,11 @@ LOG_MODULE_REGISTER(net_pkt, CONFIG_NET_PKT_LOG_LEVEL);
 #error "Too small net_buf fragment size"
 #endif
 
+#if defined(CONFIG_NET_BUF_SLAB_DATA_SIZE) && \
+	CONFIG_NET_BUF_SLAB_LARGE_SIZE < (MAX_IP_PROTO_LEN + MAX_NEXT_PROTO_LEN)
+#error "Too small net_buf large data size"
+#endif
+
 #if CONFIG_NET_PKT_RX_COUNT <= 0
 #error "Minimum value for CONFIG_NET_PKT_RX_COUNT is 1"
 #endif
@@ -119,7 +126,21 @@ NET_BUF_POOL_FIXED_DEFINE(rx_bufs, CONFIG_NET_BUF_RX_COUNT,
 NET_BUF_POOL_FIXED_DEFINE(tx_bufs, CONFIG_NET_BUF_TX_COUNT,
 			  CONFIG_NET_BUF_DATA_SIZE, NULL);
 
-#else /* !CONFIG_NET_BUF_FIXED_DATA_SIZE */
+#elif defined(CONFIG_NET_BUF_SLAB_DATA_SIZE)
+
+NET_BUF_SLAB_CLASS_DEFINE(small_data, CONFIG_NET_BUF_SLAB_SMALL_SIZE,
+			  CONFIG_NET_BUF_SLAB_SMALL_COUNT);
+NET_BUF_SLAB_CLASS_DEFINE(medium_data, CONFIG_NET_BUF_SLAB_MEDIUM_SIZE,
+			  CONFIG_NET_BUF_SLAB_MEDIUM_COUNT);
+NET_BUF_SLAB_CLASS_DEFINE(large_data, CONFIG_NET_BUF_SLAB_LARGE_SIZE,
+			  CONFIG_NET_BUF_SLAB_LARGE_COUNT);
+
+NET_BUF_POOL_SLAB_DEFINE(rx_bufs, CONFIG_NET_BUF_RX_COUNT, NULL,
+			 &small_data, &medium_data, &large_data);
+NET_BUF_POOL_SLAB_DEFINE(tx_bufs, CONFIG_NET_BUF_TX_COUNT, NULL,
+			 &small_data, &medium_data, &large_data);
+
+#else /* CONFIG_NET_BUF_VARIABLE_DATA_SIZE */
 
 NET_BUF_POOL_VAR_DEFINE(rx_bufs, CONFIG_NET_BUF_RX_COUNT,
 			CONFIG_NET_BUF_DATA_POOL_SIZE, NULL);
@@ -128,6 +149,91 @@ NET_BUF_POOL_VAR_DEFINE(tx_bufs, CONFIG_NET_BUF_TX_COUNT,
 
 #endif /* CONFIG_NET_BUF_FIXED_DATA_SIZE */
 
+#if defined(CONFIG_NET_STATISTICS_PKT_POOLS)
+/* Address the public allocation function was called from */
+#define ALLOC_CALLER() __builtin_return_address(0)
+
+static void slab_update_stats(struct k_mem_slab *slab, bool failed)
+{
+	struct net_stats_pool *stats;
+
+	if (slab == &rx_pkts) {
+		stats = &net_stats_pkt_pools.rx_pkts;
+	} else if (slab == &tx_pkts) {
+		stats = &net_stats_pkt_pools.tx_pkts;
+	} else {
+		return;
+	}
+
+	net_stats_update_pool(stats, failed, k_mem_slab_num_used_get(slab));
+}
+
+static void pool_update_stats(struct net_buf_pool *pool, bool failed)
+{
+	struct net_stats_pool *stats;
+
+	if (pool == &rx_bufs) {
+		stats = &net_stats_pkt_pools.rx_bufs;
+	} else if (pool == &tx_bufs) {
+		stats = &net_stats_pkt_pools.tx_bufs;
+	} else {
+		return;
+	}
+
+	net_stats_update_pool(stats, failed,
+			      pool->buf_count - pool->avail_count);
+}
+
+static void site_update_stats(void *caller)
+{
+	struct net_stats_pool_site *site;
+	k_spinlock_key_t key;
+	int i;
+
+	/* Two failing sites must not take the same free slot */
+	key = k_spin_lock(&net_stats_pkt_pools_lock);
+
+	for (i = 0; i < ARRAY_SIZE(net_stats_pkt_pools.sites); i++) {
+		site = &net_stats_pkt_pools.sites[i];
+
+		if (!site->caller) {
+			site->caller = caller;
+		}
+
+		if (site->caller == caller) {
+			site->alloc_failed++;
+			break;
+		}
+	}
+
+	k_spin_unlock(&net_stats_pkt_pools_lock, key);
+}
+
+static struct net_pkt *pkt_check_site(struct net_pkt *pkt, void *caller)
+{
+	if (!pkt) {
+		site_update_stats(caller);
+	}
+
+	return pkt;
+}
+
+static int buffer_check_site(int ret, void *caller)
+{
+	if (ret < 0) {
+		site_update_stats(caller);
+	}
+
+	return ret;
+}
+#else
+#define ALLOC_CALLER() NULL
+#define slab_update_stats(...)
+#define pool_update_stats(...)
+#define pkt_check_site(pkt, caller) (pkt)
+#define buffer_check_site(ret, caller) (ret)
+#endif /* CONFIG_NET_STATISTICS_PKT_POOLS */
+
 /* Allocation tracking is only available if separately enabled */
 #if defined(CONFIG_NET_DEBUG_NET_PKT_ALLOC)
 struct net_pkt_alloc {
@@ -582,6 +688,12 @@ done:
 		return;
 	}
 
+#if defined(CONFIG_NET_CONTEXT_RCVBUF)
+	if (pkt->rcvbuf_charge) {
+		net_context_rcvbuf_release(pkt->context, pkt->rcvbuf_charge);
+	}
+#endif
+
 	if (pkt->frags) {
 		net_pkt_frag_unref(pkt->frags);
 	}
@@ -846,7 +958,46 @@ void net_pkt_print(void)
 
 /* New allocator and API starts here */
 
-#if defined(CONFIG_NET_BUF_FIXED_DATA_SIZE)
+#if defined(CONFIG_NET_BUF_FIXED_DATA_SIZE) || \
+	defined(CONFIG_NET_BUF_SLAB_DATA_SIZE)
+
+#if defined(CONFIG_NET_BUF_SLAB_DATA_SIZE)
+/* When the class the size fits in and the larger ones are used up, take
+ * the largest smaller block that is free and let the caller chain the rest.
+ * Only when no block at all is free is the best fitting class waited for.
+ */
+static struct net_buf *pkt_alloc_slab_buffer(struct net_buf_pool *pool,
+					     size_t size, s32_t timeout)
+{
+	static const size_t class_sizes[] = {
+		CONFIG_NET_BUF_SLAB_LARGE_SIZE,
+		CONFIG_NET_BUF_SLAB_MEDIUM_SIZE,
+		CONFIG_NET_BUF_SLAB_SMALL_SIZE,
+	};
+	struct net_buf *buf;
+	int i;
+
+	size = MIN(size, CONFIG_NET_BUF_SLAB_LARGE_SIZE);
+
+	for (i = 0; i < ARRAY_SIZE(class_sizes); i++) {
+		if (i > 0 && class_sizes[i] >= size) {
+			continue;
+		}
+
+		buf = net_buf_alloc_len(pool, MIN(size, class_sizes[i]),
+					K_NO_WAIT);
+		if (buf) {
+			return buf;
+		}
+	}
+
+	if (timeout == K_NO_WAIT) {
+		return NULL;
+	}
+
+	return net_buf_alloc_len(pool, size, timeout);
+}
+#endif
 
 #if NET_LOG_LEVEL >= LOG_LEVEL_DBG
 static struct net_buf *pkt_alloc_buffer(struct net_buf_pool *pool,
@@ -864,7 +1015,11 @@ static struct net_buf *pkt_alloc_buffer(struct net_buf_pool *pool,
 	while (size) {
 		struct net_buf *new;
 
+#if defined(CONFIG_NET_BUF_FIXED_DATA_SIZE)
 		new = net_buf_alloc_fixed(pool, timeout);
+#else
+		new = pkt_alloc_slab_buffer(pool, size, timeout);
+#endif
 		if (!new) {
 			goto error;
 		}
@@ -908,7 +1063,7 @@ error:
 	return NULL;
 }
 
-#else /* !CONFIG_NET_BUF_FIXED_DATA_SIZE */
+#else /* CONFIG_NET_BUF_VARIABLE_DATA_SIZE */
 
 #if NET_LOG_LEVEL >= LOG_LEVEL_DBG
 static struct net_buf *pkt_alloc_buffer(struct net_buf_pool *pool,
@@ -963,6 +1118,13 @@ static size_t pkt_buffer_length(struct net_pkt *pkt,
 
 		max_len = MAX(max_len, NET_IPV6_MTU);
 	} else if (IS_ENABLED(CONFIG_NET_IPV4) && family == AF_INET) {
+		if (IS_ENABLED(CONFIG_NET_IPV4_FRAGMENT) && (size > max_len)) {
+			/* We support larger packets if IPv4 fragmentation is
+			 * enabled.
+			 */
+			max_len = size;
+		}
+
 		max_len = MAX(max_len, NET_IPV4_MTU);
 	} else { /* family == AF_UNSPEC */
 #if defined (CONFIG_NET_L2_ETHERNET)
@@ -979,6 +1141,13 @@ static size_t pkt_buffer_length(struct net_pkt *pkt,
 		}
 	}
 
+	if (IS_ENABLED(CONFIG_NET_GSO) && net_pkt_gso_size(pkt)) {
+		/* The packet is split into MTU sized segments only when it
+		 * is handed to L2, see net_gso_send().
+		 */
+		max_len = MAX(max_len, CONFIG_NET_GSO_MAX_SIZE);
+	}
+
 	max_len -= existing;
 
 	return MIN(size, max_len);
@@ -1085,17 +1254,17 @@ void net_pkt_trim_buffer(struct net_pkt *pkt)
 }
 
 #if NET_LOG_LEVEL >= LOG_LEVEL_DBG
-int net_pkt_alloc_buffer_debug(struct net_pkt *pkt,
-			       size_t size,
-			       enum net_ip_protocol proto,
-			       s32_t timeout,
-			       const char *caller,
-			       int line)
+static int pkt_alloc_data(struct net_pkt *pkt,
+			  size_t size,
+			  enum net_ip_protocol proto,
+			  s32_t timeout,
+			  const char *caller,
+			  int line)
 #else
-int net_pkt_alloc_buffer(struct net_pkt *pkt,
-			 size_t size,
-			 enum net_ip_protocol proto,
-			 s32_t timeout)
+static int pkt_alloc_data(struct net_pkt *pkt,
+			  size_t size,
+			  enum net_ip_protocol proto,
+			  s32_t timeout)
 #endif
 {
 	u32_t alloc_start = k_uptime_get_32();
@@ -1149,6 +1318,8 @@ int net_pkt_alloc_buffer(struct net_pkt *pkt,
 	buf = pkt_alloc_buffer(pool, alloc_len, timeout);
 #endif
 
+	pool_update_stats(pool, !buf);
+
 	if (!buf) {
 #if NET_LOG_LEVEL >= LOG_LEVEL_DBG
 		NET_ERR("Data buffer (%zd) allocation failed (%s:%d)",
@@ -1164,6 +1335,30 @@ int net_pkt_alloc_buffer(struct net_pkt *pkt,
 	return 0;
 }
 
+#if NET_LOG_LEVEL >= LOG_LEVEL_DBG
+int net_pkt_alloc_buffer_debug(struct net_pkt *pkt,
+			       size_t size,
+			       enum net_ip_protocol proto,
+			       s32_t timeout,
+			       const char *caller,
+			       int line)
+#else
+int net_pkt_alloc_buffer(struct net_pkt *pkt,
+			 size_t size,
+			 enum net_ip_protocol proto,
+			 s32_t timeout)
+#endif
+{
+#if NET_LOG_LEVEL >= LOG_LEVEL_DBG
+	return buffer_check_site(pkt_alloc_data(pkt, size, proto, timeout,
+						caller, line),
+				 ALLOC_CALLER());
+#else
+	return buffer_check_site(pkt_alloc_data(pkt, size, proto, timeout),
+				 ALLOC_CALLER());
+#endif
+}
+
 #if NET_LOG_LEVEL >= LOG_LEVEL_DBG
 static struct net_pkt *pkt_alloc(struct k_mem_slab *slab, s32_t timeout,
 				 const char *caller, int line)
@@ -1179,6 +1374,9 @@ static struct net_pkt *pkt_alloc(struct k_mem_slab *slab, s32_t timeout)
 	}
 
 	ret = k_mem_slab_alloc(slab, (void **)&pkt, timeout);
+
+	slab_update_stats(slab, ret != 0);
+
 	if (ret) {
 		return NULL;
 	}
@@ -1232,9 +1430,10 @@ struct net_pkt *net_pkt_alloc(s32_t timeout)
 #endif
 {
 #if NET_LOG_LEVEL >= LOG_LEVEL_DBG
-	return pkt_alloc(&tx_pkts, timeout, caller, line);
+	return pkt_check_site(pkt_alloc(&tx_pkts, timeout, caller, line),
+			      ALLOC_CALLER());
 #else
-	return pkt_alloc(&tx_pkts, timeout);
+	return pkt_check_site(pkt_alloc(&tx_pkts, timeout), ALLOC_CALLER());
 #endif
 }
 
@@ -1252,9 +1451,10 @@ struct net_pkt *net_pkt_alloc_from_slab(struct k_mem_slab *slab,
 	}
 
 #if NET_LOG_LEVEL >= LOG_LEVEL_DBG
-	return pkt_alloc(slab, timeout, caller, line);
+	return pkt_check_site(pkt_alloc(slab, timeout, caller, line),
+			      ALLOC_CALLER());
 #else
-	return pkt_alloc(slab, timeout);
+	return pkt_check_site(pkt_alloc(slab, timeout), ALLOC_CALLER());
 #endif
 }
 
@@ -1266,9 +1466,10 @@ struct net_pkt *net_pkt_rx_alloc(s32_t timeout)
 #endif
 {
 #if NET_LOG_LEVEL >= LOG_LEVEL_DBG
-	return pkt_alloc(&rx_pkts, timeout, caller, line);
+	return pkt_check_site(pkt_alloc(&rx_pkts, timeout, caller, line),
+			      ALLOC_CALLER());
 #else
-	return pkt_alloc(&rx_pkts, timeout);
+	return pkt_check_site(pkt_alloc(&rx_pkts, timeout), ALLOC_CALLER());
 #endif
 }
 
@@ -1307,9 +1508,12 @@ struct net_pkt *net_pkt_alloc_on_iface(struct net_if *iface, s32_t timeout)
 #endif
 {
 #if NET_LOG_LEVEL >= LOG_LEVEL_DBG
-	return pkt_alloc_on_iface(&tx_pkts, iface, timeout, caller, line);
+	return pkt_check_site(pkt_alloc_on_iface(&tx_pkts, iface, timeout,
+						 caller, line),
+			      ALLOC_CALLER());
 #else
-	return pkt_alloc_on_iface(&tx_pkts, iface, timeout);
+	return pkt_check_site(pkt_alloc_on_iface(&tx_pkts, iface, timeout),
+			      ALLOC_CALLER());
 #endif
 }
 
@@ -1323,9 +1527,12 @@ struct net_pkt *net_pkt_rx_alloc_on_iface(struct net_if *iface, s32_t timeout)
 #endif
 {
 #if NET_LOG_LEVEL >= LOG_LEVEL_DBG
-	return pkt_alloc_on_iface(&rx_pkts, iface, timeout, caller, line);
+	return pkt_check_site(pkt_alloc_on_iface(&rx_pkts, iface, timeout,
+						 caller, line),
+			      ALLOC_CALLER());
 #else
-	return pkt_alloc_on_iface(&rx_pkts, iface, timeout);
+	return pkt_check_site(pkt_alloc_on_iface(&rx_pkts, iface, timeout),
+			      ALLOC_CALLER());
 #endif
 }
 
@@ -1374,10 +1581,9 @@ pkt_alloc_with_buffer(struct k_mem_slab *slab,
 	}
 
 #if NET_LOG_LEVEL >= LOG_LEVEL_DBG
-	ret = net_pkt_alloc_buffer_debug(pkt, size, proto, timeout,
-					 caller, line);
+	ret = pkt_alloc_data(pkt, size, proto, timeout, caller, line);
 #else
-	ret = net_pkt_alloc_buffer(pkt, size, proto, timeout);
+	ret = pkt_alloc_data(pkt, size, proto, timeout);
 #endif
 
 	if (ret) {
@@ -1405,11 +1611,14 @@ struct net_pkt *net_pkt_alloc_with_buffer(struct net_if *iface,
 #endif
 {
 #if NET_LOG_LEVEL >= LOG_LEVEL_DBG
-	return pkt_alloc_with_buffer(&tx_pkts, iface, size, family,
-				     proto, timeout, caller, line);
+	return pkt_check_site(pkt_alloc_with_buffer(&tx_pkts, iface, size,
+						    family, proto, timeout,
+						    caller, line),
+			      ALLOC_CALLER());
 #else
-	return pkt_alloc_with_buffer(&tx_pkts, iface, size, family,
-				     proto, timeout);
+	return pkt_check_site(pkt_alloc_with_buffer(&tx_pkts, iface, size,
+						    family, proto, timeout),
+			      ALLOC_CALLER());
 #endif
 }
 
@@ -1430,11 +1639,14 @@ struct net_pkt *net_pkt_rx_alloc_with_buffer(struct net_if *iface,
 #endif
 {
 #if NET_LOG_LEVEL >= LOG_LEVEL_DBG
-	return pkt_alloc_with_buffer(&rx_pkts, iface, size, family,
-					proto, timeout, caller, line);
+	return pkt_check_site(pkt_alloc_with_buffer(&rx_pkts, iface, size,
+						    family, proto, timeout,
+						    caller, line),
+			      ALLOC_CALLER());
 #else
-	return pkt_alloc_with_buffer(&rx_pkts, iface, size, family,
-					proto, timeout);
+	return pkt_check_site(pkt_alloc_with_buffer(&rx_pkts, iface, size,
+						    family, proto, timeout),
+			      ALLOC_CALLER());
 #endif
 }
 
@@ -1541,6 +1753,14 @@ static int net_pkt_cursor_operate(struct net_pkt *pkt,
 			break;
 		}
 
+		if (write && (copy || data) &&
+		    (c_op->buf->flags & NET_BUF_READ_ONLY)) {
+			/* Data lent by the application, e.g. for a zero-copy
+			 * send, is only read.
+			 */
+			return -EPERM;
+		}
+
 		if (length < d_len) {
 			len = length;
 		} else {
@@ -1706,6 +1926,9 @@ static void clone_pkt_attributes(struct net_pkt *pkt, struct net_pkt *clone_pkt)
 	net_pkt_set_timestamp(clone_pkt, net_pkt_timestamp(pkt));
 	net_pkt_set_priority(clone_pkt, net_pkt_priority(pkt));
 	net_pkt_set_orig_iface(clone_pkt, net_pkt_orig_iface(pkt));
+	net_pkt_set_chksum_partial(clone_pkt, net_pkt_is_chksum_partial(pkt));
+	net_pkt_set_chksum_start(clone_pkt, net_pkt_chksum_start(pkt));
+	net_pkt_set_chksum_offset(clone_pkt, net_pkt_chksum_offset(pkt));
 
 	if (IS_ENABLED(CONFIG_NET_IPV4) && net_pkt_family(pkt) == AF_INET) {
 		net_pkt_set_ipv4_ttl(clone_pkt, net_pkt_ipv4_ttl(pkt));
@@ -78,6 +78,9 @@ static inline enum net_verdict net_ipv6_input(struct net_pkt *pkt,
 #endif
 extern bool net_tc_submit_to_tx_queue(u8_t tc, struct net_pkt *pkt);
 extern void net_tc_submit_to_rx_queue(u8_t tc, struct net_pkt *pkt);
+extern u32_t net_tc_flow_hash(struct net_pkt *pkt, bool l2);
+extern int net_tc_rx_worker(void);
+extern bool net_tc_rx_worker_is_idle(int worker);
 extern enum net_verdict net_promisc_mode_input(struct net_pkt *pkt);
 
 char *net_sprint_addr(sa_family_t af, const void *addr);
@@ -103,6 +106,11 @@ static inline int net_context_get_timestamp(struct net_context *context,
 }
 #endif
 
+#if defined(CONFIG_NET_CONTEXT_RCVBUF)
+/* Give back the buffers a freed packet had charged to its context */
+void net_context_rcvbuf_release(struct net_context *context, u16_t count);
+#endif
+
 #if defined(CONFIG_COAP)
 /**
  * @brief CoAP init function declaration. It belongs here because we don't want
@@ -138,6 +146,169 @@ enum net_verdict net_gptp_recv(struct net_if *iface, struct net_pkt *pkt);
 #define net_gptp_recv(iface, pkt) NET_DROP
 #endif /* CONFIG_NET_GPTP */
 
+typedef void (*net_gro_deliver_cb_t)(struct net_pkt *pkt);
+
+#if defined(CONFIG_NET_GRO)
+
+/**
+ * @brief Try to merge a received TCP segment with the segments held
+ * for the same flow. Called from the RX thread after L2 processing,
+ * when the packet cursor is at the IP header.
+ *
+ * @param pkt Received network packet
+ * @param deliver Called for every held packet that is passed on to
+ *        the IP layer
+ *
+ * @return NET_OK if the packet was held or merged, NET_CONTINUE if it
+ * must be processed normally.
+ */
+enum net_verdict net_gro_receive(struct net_pkt *pkt,
+				 net_gro_deliver_cb_t deliver);
+
+/**
+ * @brief Called after each received packet. Passes on the held packets
+ * if the RX queue of the calling thread is empty, or if they have been
+ * held for too long.
+ *
+ * @param deliver Called for every held packet that is passed on
+ */
+void net_gro_complete(net_gro_deliver_cb_t deliver);
+#else
+static inline enum net_verdict net_gro_receive(struct net_pkt *pkt,
+					       net_gro_deliver_cb_t deliver)
+{
+	ARG_UNUSED(pkt);
+	ARG_UNUSED(deliver);
+
+	return NET_CONTINUE;
+}
+
+static inline void net_gro_complete(net_gro_deliver_cb_t deliver)
+{
+	ARG_UNUSED(deliver);
+}
+#endif /* CONFIG_NET_GRO */
+
+#if defined(CONFIG_NET_BPF)
+struct net_bpf_filter;
+struct sock_fprog;
+
+/**
+ * @brief Run the filters attached to a network interface on a packet it
+ * received. Called before the packet is queued for processing.
+ *
+ * @param iface Network interface
+ * @param pkt Received network packet
+ *
+ * @return NET_DROP if a filter dropped the packet, NET_CONTINUE otherwise.
+ */
+enum net_verdict net_bpf_input(struct net_if *iface, struct net_pkt *pkt);
+
+/**
+ * @brief Allocate a socket filter and copy a checked program to it.
+ *
+ * @param prog Program given to SO_ATTACH_FILTER
+ * @param filter Allocated filter
+ *
+ * @return 0 if ok, -EINVAL if the program is not valid, -ENOMEM if there
+ * are no free socket filters.
+ */
+int net_bpf_sock_filter_alloc(const struct sock_fprog *prog,
+			      struct net_bpf_filter **filter);
+
+/**
+ * @brief Free a socket filter. It must not be set in any slot anymore.
+ *
+ * @param filter Filter, can be NULL
+ */
+void net_bpf_sock_filter_free(struct net_bpf_filter *filter);
+
+/**
+ * @brief Set the filter of a connection. The previous filter is not
+ * running anymore when this returns.
+ *
+ * @param slot Where the connection keeps its filter
+ * @param filter New filter, or NULL to remove the filter
+ */
+void net_bpf_sock_filter_set(struct net_bpf_filter **slot,
+			     struct net_bpf_filter *filter);
+
+/**
+ * @brief Run the filter of a connection on a packet.
+ *
+ * @param slot Where the connection keeps its filter
+ * @param pkt Received network packet
+ *
+ * @return True if there is no filter or if the packet matches it.
+ */
+bool net_bpf_sock_filter_match(struct net_bpf_filter **slot,
+			       struct net_pkt *pkt);
+#else
+static inline enum net_verdict net_bpf_input(struct net_if *iface,
+					     struct net_pkt *pkt)
+{
+	ARG_UNUSED(iface);
+	ARG_UNUSED(pkt);
+
+	return NET_CONTINUE;
+}
+#endif /* CONFIG_NET_BPF */
+
+#if defined(CONFIG_NET_CAPTURE)
+extern bool net_capture_active;
+
+/**
+ * @brief Capture a packet.
+ *
+ * @param iface Network interface
+ * @param pkt Network packet, received frame or sent IP packet
+ * @param tx True if the packet is sent
+ */
+void net_capture_pkt(struct net_if *iface, struct net_pkt *pkt, bool tx);
+
+static inline void net_capture_rx(struct net_if *iface, struct net_pkt *pkt)
+{
+	/* A reassembled packet has no link layer header, its fragments
+	 * were captured when received.
+	 */
+	if (net_capture_active && !net_pkt_is_ip_reassembled(pkt)) {
+		net_capture_pkt(iface, pkt, false);
+	}
+}
+
+static inline void net_capture_tx(struct net_if *iface, struct net_pkt *pkt)
+{
+	if (net_capture_active) {
+		net_capture_pkt(iface, pkt, true);
+	}
+}
+#else
+static inline void net_capture_rx(struct net_if *iface, struct net_pkt *pkt)
+{
+	ARG_UNUSED(iface);
+	ARG_UNUSED(pkt);
+}
+
+static inline void net_capture_tx(struct net_if *iface, struct net_pkt *pkt)
+{
+	ARG_UNUSED(iface);
+	ARG_UNUSED(pkt);
+}
+#endif /* CONFIG_NET_CAPTURE */
+
+/**
+ * @brief Give a packet to L2, splitting it into TCP segments first if it
+ * is larger than the MTU and the device cannot do it by itself.
+ *
+ * @param iface Network interface
+ * @param pkt Network packet, released on success like by L2 send
+ *
+ * @return Number of bytes sent, or negative errno if nothing was sent.
+ * If only the first segments could be sent, the packet is released and
+ * the number of bytes of these segments is returned.
+ */
+int net_gso_send(struct net_if *iface, struct net_pkt *pkt);
+
 #if defined(CONFIG_NET_IPV6_FRAGMENT)
 int net_ipv6_send_fragmented_pkt(struct net_if *iface, struct net_pkt *pkt,
 				 u16_t pkt_len);
@@ -160,7 +331,8 @@ extern u16_t net_calc_chksum(struct net_pkt *pkt, u8_t proto);
  * @param user_data	User data passed as an argument
  *
  * @return NET_OK	if the packet is consumed through the recv_cb
- *         NET_DROP	if the recv_cb isn't set
+ *         NET_DROP	if the recv_cb isn't set, or if the context
+ *			holds its quota of RX buffers already
  */
 enum net_verdict net_context_packet_received(struct net_conn *conn,
 					     struct net_pkt *pkt,
@@ -199,6 +371,19 @@ static inline u16_t net_calc_chksum_tcp(struct net_pkt *pkt)
 	return net_calc_chksum(pkt, IPPROTO_TCP);
 }
 
+/* Return the pseudo header sum of the packet, in network byte order, for
+ * a device that finishes the checksum (ETHERNET_HW_TX_CHKSUM_PARTIAL).
+ */
+extern u16_t net_calc_chksum_partial(struct net_pkt *pkt, u8_t proto);
+
+/* Return the value of the checksum field of an outgoing UDP or TCP packet,
+ * which is either the full checksum, the pseudo header sum if the device
+ * finishes the checksum, or zero if the device calculates it. The checksum
+ * field must be zero when this is called. For the pseudo header sum, the
+ * checksum start and offset of the packet are set as well.
+ */
+extern u16_t net_calc_chksum_tx(struct net_pkt *pkt, u8_t proto);
+
 static inline char *net_sprint_ll_addr(const u8_t *ll, u8_t ll_len)
 {
 	static char buf[sizeof("xx:xx:xx:xx:xx:xx:xx:xx")];
@@ -37,6 +37,10 @@ LOG_MODULE_REGISTER(net_shell, LOG_LEVEL_DBG);
 
 #include "ipv6.h"
 
+#if defined(CONFIG_NET_IP_FRAGMENT)
+#include "ip_fragment.h"
+#endif
+
 #if defined(CONFIG_NET_ARP)
 #include "ethernet/arp.h"
 #endif
@@ -235,8 +239,10 @@ struct ethernet_capabilities {
 static struct ethernet_capabilities eth_hw_caps[] = {
 	EC(ETHERNET_HW_TX_CHKSUM_OFFLOAD, "TX checksum offload"),
 	EC(ETHERNET_HW_RX_CHKSUM_OFFLOAD, "RX checksum offload"),
+	EC(ETHERNET_HW_TX_CHKSUM_PARTIAL, "TX checksum offload (partial)"),
 	EC(ETHERNET_HW_VLAN,              "Virtual LAN"),
 	EC(ETHERNET_HW_VLAN_TAG_STRIP,    "VLAN Tag stripping"),
+	EC(ETHERNET_HW_TSO,               "TCP segmentation offload"),
 	EC(ETHERNET_AUTO_NEGOTIATION_SET, "Auto negotiation"),
 	EC(ETHERNET_LINK_10BASE_T,        "10 Mbits"),
 	EC(ETHERNET_LINK_100BASE_T,       "100 Mbits"),
@@ -622,6 +628,26 @@ static void iface_per_route_cb(struct net_if *iface, void *user_data)
 }
 #endif /* CONFIG_NET_ROUTE */
 
+#if defined(CONFIG_NET_ROUTE_IPV4) && defined(CONFIG_NET_NATIVE)
+static void route_ipv4_cb(struct net_route_entry_ipv4 *entry, void *user_data)
+{
+	struct net_shell_user_data *data = user_data;
+	const struct shell *shell = data->shell;
+	const char *extra;
+
+	PR("IPv4 prefix : %s/%d\t", net_sprint_ipv4_addr(&entry->addr),
+	   entry->prefix_len);
+
+	if (net_ipv4_is_addr_unspecified(&entry->gw)) {
+		PR("on link");
+	} else {
+		PR("via %s", net_sprint_ipv4_addr(&entry->gw));
+	}
+
+	PR(" (iface %p %s)\n", entry->iface, iface2str(entry->iface, &extra));
+}
+#endif /* CONFIG_NET_ROUTE_IPV4 */
+
 #if defined(CONFIG_NET_ROUTE_MCAST) && defined(CONFIG_NET_NATIVE)
 static void route_mcast_cb(struct net_route_entry_mcast *entry,
 			   void *user_data)
@@ -867,6 +893,16 @@ static void print_net_pm_stats(const struct shell *shell, struct net_if *iface)
 #endif
 }
 
+#if defined(CONFIG_NET_STATISTICS_IPV6_NBR_CACHE) || \
+	defined(CONFIG_NET_STATISTICS_ARP)
+static inline u32_t hit_rate(net_stats_t hit, net_stats_t miss)
+{
+	u64_t lookups = (u64_t)hit + miss;
+
+	return lookups ? (u32_t)((hit * 100ULL) / lookups) : 0U;
+}
+#endif
+
 static void net_shell_print_statistics(struct net_if *iface, void *user_data)
 {
 	struct net_shell_user_data *data = user_data;
@@ -901,6 +937,16 @@ static void net_shell_print_statistics(struct net_if *iface, void *user_data)
 	   GET_STAT(iface, ipv6_mld.sent),
 	   GET_STAT(iface, ipv6_mld.drop));
 #endif /* CONFIG_NET_STATISTICS_MLD */
+#if defined(CONFIG_NET_STATISTICS_IPV6_NBR_CACHE)
+	PR("IPv6 nbr hit   %d\tmiss\t%d\tevict\t%d\texpire\t%d\t"
+	   "hit rate %u%%\n",
+	   GET_STAT(iface, ipv6_nbr.hit),
+	   GET_STAT(iface, ipv6_nbr.miss),
+	   GET_STAT(iface, ipv6_nbr.evict),
+	   GET_STAT(iface, ipv6_nbr.expire),
+	   hit_rate(GET_STAT(iface, ipv6_nbr.hit),
+		    GET_STAT(iface, ipv6_nbr.miss)));
+#endif /* CONFIG_NET_STATISTICS_IPV6_NBR_CACHE */
 #endif /* CONFIG_NET_STATISTICS_IPV6 */
 
 #if defined(CONFIG_NET_STATISTICS_IPV4) && defined(CONFIG_NET_NATIVE_IPV4)
@@ -909,6 +955,15 @@ static void net_shell_print_statistics(struct net_if *iface, void *user_data)
 	   GET_STAT(iface, ipv4.sent),
 	   GET_STAT(iface, ipv4.drop),
 	   GET_STAT(iface, ipv4.forwarded));
+#if defined(CONFIG_NET_STATISTICS_ARP)
+	PR("ARP hit        %d\tmiss\t%d\tevict\t%d\texpire\t%d\t"
+	   "hit rate %u%%\n",
+	   GET_STAT(iface, arp.hit),
+	   GET_STAT(iface, arp.miss),
+	   GET_STAT(iface, arp.evict),
+	   GET_STAT(iface, arp.expire),
+	   hit_rate(GET_STAT(iface, arp.hit), GET_STAT(iface, arp.miss)));
+#endif /* CONFIG_NET_STATISTICS_ARP */
 #endif /* CONFIG_NET_STATISTICS_IPV4 */
 
 	PR("IP vhlerr      %d\thblener\t%d\tlblener\t%d\n",
@@ -1220,50 +1275,59 @@ static void tcp_sent_list_cb(struct net_tcp *tcp, void *user_data)
 #endif /* CONFIG_NET_TCP_LOG_LEVEL >= LOG_LEVEL_DBG */
 #endif
 
-#if defined(CONFIG_NET_IPV6_FRAGMENT)
-static void ipv6_frag_cb(struct net_ipv6_reassembly *reass,
-			 void *user_data)
+#if defined(CONFIG_NET_IP_FRAGMENT)
+static void ip_frag_cb(struct net_ip_reassembly *reass,
+		       void *user_data)
 {
 	struct net_shell_user_data *data = user_data;
 	const struct shell *shell = data->shell;
 	int *count = data->user_data;
 	char src[ADDR_LEN];
-	int i;
+	struct net_ip_frag *frag;
+	int i = 0;
 
 	if (!*count) {
-		PR("\nIPv6 reassembly Id         Remain "
+		PR("\nIP reassembly   Id         Remain Received "
 		   "Src             \tDst\n");
 	}
 
-	snprintk(src, ADDR_LEN, "%s", net_sprint_ipv6_addr(&reass->src));
+	if (IS_ENABLED(CONFIG_NET_IPV6) && reass->family == AF_INET6) {
+		snprintk(src, ADDR_LEN, "%s",
+			 net_sprint_ipv6_addr(&reass->src.in6_addr));
+	} else {
+		snprintk(src, ADDR_LEN, "%s",
+			 net_sprint_ipv4_addr(&reass->src.in_addr));
+	}
 
-	PR("%p      0x%08x  %5d %16s\t%16s\n",
+	PR("%p      0x%08x  %5d %8u %16s\t%16s\n",
 	   reass, reass->id,
 	   k_delayed_work_remaining_get(&reass->timer),
-	   src, net_sprint_ipv6_addr(&reass->dst));
+	   reass->received, src,
+	   reass->family == AF_INET6 ?
+	   net_sprint_ipv6_addr(&reass->dst.in6_addr) :
+	   net_sprint_ipv4_addr(&reass->dst.in_addr));
 
-	for (i = 0; i < NET_IPV6_FRAGMENTS_MAX_PKT; i++) {
-		if (reass->pkt[i]) {
-			struct net_buf *frag = reass->pkt[i]->frags;
+	SYS_SLIST_FOR_EACH_CONTAINER(&reass->frags, frag, node) {
+		struct net_buf *buf = frag->pkt->frags;
 
-			PR("[%d] pkt %p->", i, reass->pkt[i]);
+		PR("[%d] offset %u len %u pkt %p->", i++, frag->offset,
+		   frag->len, frag->pkt);
 
-			while (frag) {
-				PR("%p", frag);
+		while (buf) {
+			PR("%p", buf);
 
-				frag = frag->frags;
-				if (frag) {
-					PR("->");
-				}
+			buf = buf->frags;
+			if (buf) {
+				PR("->");
 			}
-
-			PR("\n");
 		}
+
+		PR("\n");
 	}
 
 	(*count)++;
 }
-#endif /* CONFIG_NET_IPV6_FRAGMENT */
+#endif /* CONFIG_NET_IP_FRAGMENT */
 
 #if defined(CONFIG_NET_DEBUG_NET_PKT_ALLOC)
 static void allocs_cb(struct net_pkt *pkt,
@@ -1481,10 +1545,10 @@ static int cmd_net_conn(const struct shell *shell, size_t argc, char *argv[])
 
 #endif
 
-#if defined(CONFIG_NET_IPV6_FRAGMENT)
+#if defined(CONFIG_NET_IP_FRAGMENT)
 	count = 0;
 
-	net_ipv6_frag_foreach(ipv6_frag_cb, &user_data);
+	net_ip_frag_foreach(ip_frag_cb, &user_data);
 
 	/* Do not print anything if no fragments are pending atm */
 #endif
@@ -1538,7 +1602,8 @@ static void dns_result_cb(enum dns_resolve_status status,
 		return;
 	}
 
-	if (status == DNS_EAI_FAIL) {
+	if (status == DNS_EAI_FAIL || status == DNS_EAI_NONAME ||
+	    status == DNS_EAI_NODATA) {
 		PR_WARNING("dns: No such name found.\n");
 		return;
 	}
@@ -1640,6 +1705,90 @@ static int cmd_net_dns_cancel(const struct shell *shell, size_t argc,
 	return 0;
 }
 
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+static void dns_cache_cb(const struct dns_cache_info *info, void *user_data)
+{
+	struct net_shell_user_data *data = user_data;
+	const struct shell *shell = data->shell;
+	int *count = data->user_data;
+	const char *type;
+	int i;
+
+	if (*count == 0) {
+		PR("     TTL Type Name / Addresses\n");
+	}
+
+	(*count)++;
+
+	type = info->query_type == DNS_QUERY_TYPE_A ? "A" : "AAAA";
+
+	if (!info->count) {
+		PR("%8u %-4s %s %s\n", info->ttl, type, info->name,
+		   info->status == DNS_EAI_NONAME ? "(no such name)" :
+		   "(no data)");
+		return;
+	}
+
+	PR("%8u %-4s %s\n", info->ttl, type, info->name);
+
+	for (i = 0; i < info->count; i++) {
+		if (info->addr[i].sa_family == AF_INET) {
+			PR("\t\t%s\n", net_sprint_ipv4_addr(
+				   &net_sin(&info->addr[i])->sin_addr));
+		} else if (info->addr[i].sa_family == AF_INET6) {
+			PR("\t\t%s\n", net_sprint_ipv6_addr(
+				   &net_sin6(&info->addr[i])->sin6_addr));
+		}
+	}
+}
+#endif
+
+static int cmd_net_dns_cache(const struct shell *shell, size_t argc,
+			     char *argv[])
+{
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	struct net_shell_user_data user_data;
+	int count = 0;
+#endif
+
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	user_data.shell = shell;
+	user_data.user_data = &count;
+
+	dns_cache_foreach(dns_cache_cb, &user_data);
+
+	if (count == 0) {
+		PR("DNS cache is empty.\n");
+	}
+#else
+	PR_INFO("Set %s to enable %s support.\n", "CONFIG_DNS_RESOLVER_CACHE",
+		"DNS cache");
+#endif
+
+	return 0;
+}
+
+static int cmd_net_dns_flush(const struct shell *shell, size_t argc,
+			     char *argv[])
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	dns_cache_flush();
+
+	PR("DNS cache flushed.\n");
+#else
+	PR_INFO("Set %s to enable %s support.\n", "CONFIG_DNS_RESOLVER_CACHE",
+		"DNS cache");
+#endif
+
+	return 0;
+}
+
 static int cmd_net_dns_query(const struct shell *shell, size_t argc,
 			     char *argv[])
 {
@@ -1678,7 +1827,7 @@ static int cmd_net_dns_query(const struct shell *shell, size_t argc,
 				(void *)shell, DNS_TIMEOUT);
 	if (ret < 0) {
 		PR_WARNING("Cannot resolve '%s' (%d)\n", host, ret);
-	} else {
+	} else if (ret != DNS_RESOLVE_DONE) {
 		PR("Query for '%s' sent.\n", host);
 	}
 #else
@@ -2655,6 +2804,56 @@ static void context_info(struct net_context *context, void *user_data)
 	info->pos++;
 #endif /* CONFIG_NET_CONTEXT_NET_PKT_POOL */
 }
+
+#if defined(CONFIG_NET_STATISTICS_PKT_POOLS)
+static void print_pool_stats(const struct shell *shell)
+{
+	struct net_stats_pkt_pools *stats = &net_stats_pkt_pools;
+	int i;
+
+	PR("\nPool\t\tMax used\tFailed\n");
+	PR("RX\t\t%u\t\t%u\n", stats->rx_pkts.max_used,
+	   stats->rx_pkts.alloc_failed);
+	PR("TX\t\t%u\t\t%u\n", stats->tx_pkts.max_used,
+	   stats->tx_pkts.alloc_failed);
+	PR("RX DATA\t\t%u\t\t%u\n", stats->rx_bufs.max_used,
+	   stats->rx_bufs.alloc_failed);
+	PR("TX DATA\t\t%u\t\t%u\n", stats->tx_bufs.max_used,
+	   stats->tx_bufs.alloc_failed);
+
+	PR("RX dropped over quota %u, to keep the reserve %u\n",
+	   stats->rcvbuf_drop, stats->reserve_drop);
+
+	if (!stats->sites[0].caller) {
+		return;
+	}
+
+	PR("\nCaller\t\tFailed\n");
+
+	for (i = 0; i < ARRAY_SIZE(stats->sites); i++) {
+		if (!stats->sites[i].caller) {
+			break;
+		}
+
+		PR("%p\t%u\n", stats->sites[i].caller,
+		   stats->sites[i].alloc_failed);
+	}
+}
+#endif /* CONFIG_NET_STATISTICS_PKT_POOLS */
+
+#if defined(CONFIG_NET_CONTEXT_RCVBUF)
+static void context_rcvbuf(struct net_context *context, void *user_data)
+{
+	const struct shell *shell = user_data;
+	int rcvbuf = 0;
+	size_t len = sizeof(rcvbuf);
+
+	(void)net_context_get_option(context, NET_OPT_RCVBUF, &rcvbuf, &len);
+
+	PR("%p\t%d\t%d\n", context, (int)atomic_get(&context->rcvbuf_used),
+	   rcvbuf);
+}
+#endif /* CONFIG_NET_CONTEXT_RCVBUF */
 #endif /* CONFIG_NET_OFFLOAD || CONFIG_NET_NATIVE */
 
 static int cmd_net_mem(const struct shell *shell, size_t argc, char *argv[])
@@ -2668,7 +2867,13 @@ static int cmd_net_mem(const struct shell *shell, size_t argc, char *argv[])
 
 	net_pkt_get_info(&rx, &tx, &rx_data, &tx_data);
 
+#if defined(CONFIG_NET_BUF_FIXED_DATA_SIZE)
 	PR("Fragment length %d bytes\n", CONFIG_NET_BUF_DATA_SIZE);
+#elif defined(CONFIG_NET_BUF_SLAB_DATA_SIZE)
+	PR("Data size classes %d/%d/%d bytes\n",
+	   CONFIG_NET_BUF_SLAB_SMALL_SIZE, CONFIG_NET_BUF_SLAB_MEDIUM_SIZE,
+	   CONFIG_NET_BUF_SLAB_LARGE_SIZE);
+#endif
 
 	PR("Network buffer pools:\n");
 
@@ -2699,6 +2904,16 @@ static int cmd_net_mem(const struct shell *shell, size_t argc, char *argv[])
 		"CONFIG_NET_BUF_POOL_USAGE", "net_buf allocation");
 #endif /* CONFIG_NET_BUF_POOL_USAGE */
 
+#if defined(CONFIG_NET_STATISTICS_PKT_POOLS)
+	print_pool_stats(shell);
+#endif
+
+#if defined(CONFIG_NET_CONTEXT_RCVBUF)
+	PR("\nContext\t\tRX bufs\tSO_RCVBUF\n");
+
+	net_context_foreach(context_rcvbuf, (void *)shell);
+#endif
+
 	if (IS_ENABLED(CONFIG_NET_CONTEXT_NET_PKT_POOL)) {
 		struct net_shell_user_data user_data;
 		struct ctx_info info;
@@ -3308,11 +3523,10 @@ static int cmd_net_route(const struct shell *shell, size_t argc, char *argv[])
 	ARG_UNUSED(argv);
 
 #if defined(CONFIG_NET_NATIVE)
-#if defined(CONFIG_NET_ROUTE) || defined(CONFIG_NET_ROUTE_MCAST)
+#if defined(CONFIG_NET_ROUTE) || defined(CONFIG_NET_ROUTE_MCAST) || \
+	defined(CONFIG_NET_ROUTE_IPV4)
 	struct net_shell_user_data user_data;
-#endif
 
-#if defined(CONFIG_NET_ROUTE) || defined(CONFIG_NET_ROUTE_MCAST)
 	user_data.shell = shell;
 #endif
 
@@ -3326,6 +3540,15 @@ static int cmd_net_route(const struct shell *shell, size_t argc, char *argv[])
 #if defined(CONFIG_NET_ROUTE_MCAST)
 	net_if_foreach(iface_per_mcast_route_cb, &user_data);
 #endif
+
+#if defined(CONFIG_NET_ROUTE_IPV4)
+	PR("\nIPv4 routes\n");
+	PR("===========\n");
+
+	if (net_route_ipv4_foreach(route_ipv4_cb, &user_data) == 0) {
+		PR("\t<none>\n");
+	}
+#endif
 #endif
 	return 0;
 }
@@ -4111,8 +4334,12 @@ SHELL_STATIC_SUBCMD_SET_CREATE(net_cmd_arp,
 );
 
 SHELL_STATIC_SUBCMD_SET_CREATE(net_cmd_dns,
+	SHELL_CMD(cache, NULL, "Show the cached DNS answers.",
+		  cmd_net_dns_cache),
 	SHELL_CMD(cancel, NULL, "Cancel all pending requests.",
 		  cmd_net_dns_cancel),
+	SHELL_CMD(flush, NULL, "Remove all answers from the DNS cache.",
+		  cmd_net_dns_flush),
 	SHELL_CMD(query, NULL,
 		  "'net dns <hostname> [A or AAAA]' queries IPv4 address "
 		  "(default) or IPv6 address for a host name.",
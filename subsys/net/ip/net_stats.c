@@ -29,6 +29,25 @@ LOG_MODULE_REGISTER(net_stats, NET_LOG_LEVEL);
  */
 struct net_stats net_stats = { 0 };
 
+#if defined(CONFIG_NET_STATISTICS_PKT_POOLS)
+struct net_stats_pkt_pools net_stats_pkt_pools;
+struct k_spinlock net_stats_pkt_pools_lock;
+
+/* Copy the pool stats to data in one go, or clear them if data is NULL */
+static void pkt_pools_copy(void *data)
+{
+	k_spinlock_key_t key = k_spin_lock(&net_stats_pkt_pools_lock);
+
+	if (data) {
+		memcpy(data, &net_stats_pkt_pools, sizeof(net_stats_pkt_pools));
+	} else {
+		memset(&net_stats_pkt_pools, 0, sizeof(net_stats_pkt_pools));
+	}
+
+	k_spin_unlock(&net_stats_pkt_pools_lock, key);
+}
+#endif
+
 #if defined(CONFIG_NET_STATISTICS_PERIODIC_OUTPUT)
 
 #define PRINT_STATISTICS_INTERVAL K_SECONDS(30)
@@ -97,6 +116,13 @@ static inline void stats(struct net_if *iface)
 			 GET_STAT(iface, ipv6_mld.sent),
 			 GET_STAT(iface, ipv6_mld.drop));
 #endif /* CONFIG_NET_STATISTICS_MLD */
+#if defined(CONFIG_NET_STATISTICS_IPV6_NBR_CACHE)
+		NET_INFO("IPv6 nbr hit   %d\tmiss\t%d\tevict\t%d\texpire\t%d",
+			 GET_STAT(iface, ipv6_nbr.hit),
+			 GET_STAT(iface, ipv6_nbr.miss),
+			 GET_STAT(iface, ipv6_nbr.evict),
+			 GET_STAT(iface, ipv6_nbr.expire));
+#endif /* CONFIG_NET_STATISTICS_IPV6_NBR_CACHE */
 #endif /* CONFIG_NET_STATISTICS_IPV6 */
 
 #if defined(CONFIG_NET_STATISTICS_IPV4)
@@ -105,6 +131,13 @@ static inline void stats(struct net_if *iface)
 			 GET_STAT(iface, ipv4.sent),
 			 GET_STAT(iface, ipv4.drop),
 			 GET_STAT(iface, ipv4.forwarded));
+#if defined(CONFIG_NET_STATISTICS_ARP)
+		NET_INFO("ARP hit        %d\tmiss\t%d\tevict\t%d\texpire\t%d",
+			 GET_STAT(iface, arp.hit),
+			 GET_STAT(iface, arp.miss),
+			 GET_STAT(iface, arp.evict),
+			 GET_STAT(iface, arp.expire));
+#endif /* CONFIG_NET_STATISTICS_ARP */
 #endif /* CONFIG_NET_STATISTICS_IPV4 */
 
 		NET_INFO("IP vhlerr      %d\thblener\t%d\tlblener\t%d",
@@ -302,6 +335,12 @@ static int net_stats_get(u32_t mgmt_request, struct net_if *iface,
 		len_chk = sizeof(struct net_stats_pm);
 		src = GET_STAT_ADDR(iface, pm);
 		break;
+#endif
+#if defined(CONFIG_NET_STATISTICS_PKT_POOLS)
+	case NET_REQUEST_STATS_CMD_GET_PKT_POOLS:
+		len_chk = sizeof(struct net_stats_pkt_pools);
+		src = &net_stats_pkt_pools;
+		break;
 #endif
 	}
 
@@ -309,6 +348,13 @@ static int net_stats_get(u32_t mgmt_request, struct net_if *iface,
 		return -EINVAL;
 	}
 
+#if defined(CONFIG_NET_STATISTICS_PKT_POOLS)
+	if (src == &net_stats_pkt_pools) {
+		pkt_pools_copy(data);
+		return 0;
+	}
+#endif
+
 	memcpy(data, src, len);
 
 	return 0;
@@ -361,6 +407,11 @@ NET_MGMT_REGISTER_REQUEST_HANDLER(NET_REQUEST_STATS_GET_PM,
 				  net_stats_get);
 #endif
 
+#if defined(CONFIG_NET_STATISTICS_PKT_POOLS)
+NET_MGMT_REGISTER_REQUEST_HANDLER(NET_REQUEST_STATS_GET_PKT_POOLS,
+				  net_stats_get);
+#endif
+
 #endif /* CONFIG_NET_STATISTICS_USER_API */
 
 void net_stats_reset(struct net_if *iface)
@@ -372,4 +423,8 @@ void net_stats_reset(struct net_if *iface)
 
 	net_if_stats_reset_all();
 	memset(&net_stats, 0, sizeof(net_stats));
+
+#if defined(CONFIG_NET_STATISTICS_PKT_POOLS)
+	pkt_pools_copy(NULL);
+#endif
 }
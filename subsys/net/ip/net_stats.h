@@ -318,6 +318,64 @@ static inline void net_stats_update_ipv6_mld_drop(struct net_if *iface)
 #define net_stats_update_ipv6_mld_drop(iface)
 #endif /* CONFIG_NET_STATISTICS_MLD */
 
+#if defined(CONFIG_NET_STATISTICS_ARP) && defined(CONFIG_NET_NATIVE)
+/* ARP cache stats */
+
+static inline void net_stats_update_arp_hit(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.arp.hit++);
+}
+
+static inline void net_stats_update_arp_miss(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.arp.miss++);
+}
+
+static inline void net_stats_update_arp_evict(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.arp.evict++);
+}
+
+static inline void net_stats_update_arp_expire(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.arp.expire++);
+}
+#else
+#define net_stats_update_arp_hit(iface)
+#define net_stats_update_arp_miss(iface)
+#define net_stats_update_arp_evict(iface)
+#define net_stats_update_arp_expire(iface)
+#endif /* CONFIG_NET_STATISTICS_ARP */
+
+#if defined(CONFIG_NET_STATISTICS_IPV6_NBR_CACHE) && defined(CONFIG_NET_NATIVE)
+/* IPv6 neighbor cache stats */
+
+static inline void net_stats_update_ipv6_nbr_hit(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.ipv6_nbr.hit++);
+}
+
+static inline void net_stats_update_ipv6_nbr_miss(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.ipv6_nbr.miss++);
+}
+
+static inline void net_stats_update_ipv6_nbr_evict(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.ipv6_nbr.evict++);
+}
+
+static inline void net_stats_update_ipv6_nbr_expire(struct net_if *iface)
+{
+	UPDATE_STAT(iface, stats.ipv6_nbr.expire++);
+}
+#else
+#define net_stats_update_ipv6_nbr_hit(iface)
+#define net_stats_update_ipv6_nbr_miss(iface)
+#define net_stats_update_ipv6_nbr_evict(iface)
+#define net_stats_update_ipv6_nbr_expire(iface)
+#endif /* CONFIG_NET_STATISTICS_IPV6_NBR_CACHE */
+
 #if (defined(CONFIG_NET_CONTEXT_TIMESTAMP) || \
 	defined(CONFIG_NET_PKT_TXTIME_STATS)) && defined(CONFIG_NET_STATISTICS)
 static inline void net_stats_update_tx_time(struct net_if *iface,
@@ -487,6 +545,51 @@ static inline void net_stats_add_suspend_end_time(struct net_if *iface,
 #define net_stats_add_suspend_end_time(iface, time)
 #endif
 
+#if defined(CONFIG_NET_STATISTICS_PKT_POOLS) && defined(CONFIG_NET_NATIVE)
+/* Packet and buffer pool stats, these are only global. The pools are used
+ * from several threads and from ISRs, so the stats are updated under a lock.
+ */
+
+extern struct net_stats_pkt_pools net_stats_pkt_pools;
+extern struct k_spinlock net_stats_pkt_pools_lock;
+
+static inline void net_stats_update_pool(struct net_stats_pool *pool,
+					 bool failed, u32_t used)
+{
+	k_spinlock_key_t key = k_spin_lock(&net_stats_pkt_pools_lock);
+
+	if (failed) {
+		pool->alloc_failed++;
+	} else if (used > pool->max_used) {
+		pool->max_used = used;
+	}
+
+	k_spin_unlock(&net_stats_pkt_pools_lock, key);
+}
+
+static inline void net_stats_update_rcvbuf_drop(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&net_stats_pkt_pools_lock);
+
+	net_stats_pkt_pools.rcvbuf_drop++;
+
+	k_spin_unlock(&net_stats_pkt_pools_lock, key);
+}
+
+static inline void net_stats_update_reserve_drop(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&net_stats_pkt_pools_lock);
+
+	net_stats_pkt_pools.reserve_drop++;
+
+	k_spin_unlock(&net_stats_pkt_pools_lock, key);
+}
+#else
+#define net_stats_update_pool(pool, failed, used)
+#define net_stats_update_rcvbuf_drop()
+#define net_stats_update_reserve_drop()
+#endif /* CONFIG_NET_STATISTICS_PKT_POOLS */
+
 #if defined(CONFIG_NET_STATISTICS_PERIODIC_OUTPUT) \
 	&& defined(CONFIG_NET_NATIVE)
 /* A simple periodic statistic printer, used only in net core */
@@ -13,36 +13,253 @@ LOG_MODULE_REGISTER(net_tc, CONFIG_NET_TC_LOG_LEVEL);
 #include <net/net_core.h>
 #include <net/net_pkt.h>
 #include <net/net_stats.h>
+#include <net/ethernet.h>
 
 #include "net_private.h"
 #include "net_stats.h"
 #include "net_tc_mapping.h"
+#include "ipv4.h"
 
 /* Stacks for TX work queue */
-K_THREAD_STACK_ARRAY_DEFINE(tx_stack, NET_TC_TX_COUNT,
+K_THREAD_STACK_ARRAY_DEFINE(tx_stack, NET_TC_TX_COUNT * NET_TC_TX_WORKERS,
 			    CONFIG_NET_TX_STACK_SIZE);
 
 /* Stacks for RX work queue */
-K_THREAD_STACK_ARRAY_DEFINE(rx_stack, NET_TC_RX_COUNT,
+K_THREAD_STACK_ARRAY_DEFINE(rx_stack, NET_TC_RX_COUNT * NET_TC_RX_WORKERS,
 			    CONFIG_NET_RX_STACK_SIZE);
 
-static struct net_traffic_class tx_classes[NET_TC_TX_COUNT];
-static struct net_traffic_class rx_classes[NET_TC_RX_COUNT];
+static struct net_traffic_class tx_classes[NET_TC_TX_COUNT][NET_TC_TX_WORKERS];
+static struct net_traffic_class rx_classes[NET_TC_RX_COUNT][NET_TC_RX_WORKERS];
+
+static inline u32_t flow_hash_add(u32_t hash, u32_t val)
+{
+	/* Multiplicative hashing with the golden ratio */
+	return (hash ^ val) * 0x9e3779b1U;
+}
+
+static u32_t flow_hash_addr(u32_t hash, const u8_t *addr, size_t len)
+{
+	u32_t val;
+	size_t i;
+
+	for (i = 0; i < len; i += sizeof(u32_t)) {
+		memcpy(&val, addr + i, sizeof(u32_t));
+		hash = flow_hash_add(hash, val);
+	}
+
+	return hash;
+}
+
+static u32_t flow_hash_ports(struct net_pkt *pkt, u32_t hash)
+{
+	u32_t ports;
+
+	/* Source and destination ports are the first 4 bytes of both
+	 * the UDP and the TCP header.
+	 */
+	if (net_pkt_read(pkt, &ports, sizeof(ports))) {
+		return hash;
+	}
+
+	return flow_hash_add(hash, ports);
+}
+
+static u32_t flow_hash_ipv4(struct net_pkt *pkt)
+{
+	NET_PKT_DATA_ACCESS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	struct net_ipv4_hdr *hdr;
+	u32_t hash = 0U;
+	u8_t hdr_len;
+
+	hdr = (struct net_ipv4_hdr *)net_pkt_get_data(pkt, &ipv4_access);
+	if (!hdr) {
+		return 0U;
+	}
+
+	hash = flow_hash_addr(hash, hdr->src.s4_addr, sizeof(hdr->src));
+	hash = flow_hash_addr(hash, hdr->dst.s4_addr, sizeof(hdr->dst));
+	hash = flow_hash_add(hash, hdr->proto);
+
+	/* Fragments carry no ports except the first one, so hash only
+	 * the addresses to keep all the fragments together.
+	 */
+	if ((hdr->offset[0] & 0x3f) || hdr->offset[1]) {
+		return hash;
+	}
+
+	if (hdr->proto != IPPROTO_TCP && hdr->proto != IPPROTO_UDP) {
+		return hash;
+	}
+
+	hdr_len = (hdr->vhl & NET_IPV4_IHL_MASK) * 4U;
+	if (net_pkt_skip(pkt, hdr_len)) {
+		return hash;
+	}
+
+	return flow_hash_ports(pkt, hash);
+}
+
+static u32_t flow_hash_ipv6(struct net_pkt *pkt)
+{
+	NET_PKT_DATA_ACCESS_DEFINE(ipv6_access, struct net_ipv6_hdr);
+	struct net_ipv6_hdr *hdr;
+	u32_t hash = 0U;
+
+	hdr = (struct net_ipv6_hdr *)net_pkt_get_data(pkt, &ipv6_access);
+	if (!hdr) {
+		return 0U;
+	}
+
+	hash = flow_hash_addr(hash, hdr->src.s6_addr, sizeof(hdr->src));
+	hash = flow_hash_addr(hash, hdr->dst.s6_addr, sizeof(hdr->dst));
+	hash = flow_hash_add(hash, hdr->nexthdr);
+
+	/* Extension headers are not walked, fragments and packets with
+	 * options are hashed by addresses only.
+	 */
+	if (hdr->nexthdr != IPPROTO_TCP && hdr->nexthdr != IPPROTO_UDP) {
+		return hash;
+	}
+
+	if (net_pkt_skip(pkt, sizeof(struct net_ipv6_hdr))) {
+		return hash;
+	}
+
+	return flow_hash_ports(pkt, hash);
+}
+
+#if defined(CONFIG_NET_L2_ETHERNET)
+/* Skip the Ethernet header, returns false if the payload is not IP */
+static bool flow_skip_eth_hdr(struct net_pkt *pkt)
+{
+	u16_t type;
+
+	if (net_pkt_skip(pkt, 2 * sizeof(struct net_eth_addr)) ||
+	    net_pkt_read_be16(pkt, &type)) {
+		return false;
+	}
+
+	if (type == NET_ETH_PTYPE_VLAN) {
+		if (net_pkt_skip(pkt, sizeof(u16_t)) ||
+		    net_pkt_read_be16(pkt, &type)) {
+			return false;
+		}
+	}
+
+	return type == NET_ETH_PTYPE_IP || type == NET_ETH_PTYPE_IPV6;
+}
+#endif
+
+/* Compute a hash of the flow the packet belongs to. All the packets of a
+ * flow get the same hash, non IP packets get 0. If l2 is set, the packet
+ * still has its link layer header, which is only understood for Ethernet
+ * and for the dummy L2 that has no header at all.
+ */
+u32_t net_tc_flow_hash(struct net_pkt *pkt, bool l2)
+{
+	struct net_pkt_cursor backup;
+	struct net_pkt_cursor l3;
+	u32_t hash = 0U;
+	u8_t vhl;
+
+	net_pkt_cursor_backup(pkt, &backup);
+	net_pkt_cursor_init(pkt);
+
+	if (l2) {
+		const struct net_l2 *iface_l2 = net_if_l2(net_pkt_iface(pkt));
+		bool is_ip = false;
+
+#if defined(CONFIG_NET_L2_ETHERNET)
+		if (iface_l2 == &NET_L2_GET_NAME(ETHERNET)) {
+			is_ip = flow_skip_eth_hdr(pkt);
+		}
+#endif
+#if defined(CONFIG_NET_L2_DUMMY)
+		if (iface_l2 == &NET_L2_GET_NAME(DUMMY)) {
+			is_ip = true;
+		}
+#endif
+		ARG_UNUSED(iface_l2);
+
+		if (!is_ip) {
+			goto out;
+		}
+	}
+
+	/* Peek the IP version from the first byte of the header */
+	net_pkt_cursor_backup(pkt, &l3);
+
+	if (net_pkt_read_u8(pkt, &vhl)) {
+		goto out;
+	}
+
+	net_pkt_cursor_restore(pkt, &l3);
+
+	if (IS_ENABLED(CONFIG_NET_IPV4) && (vhl & 0xf0) == 0x40) {
+		hash = flow_hash_ipv4(pkt);
+	} else if (IS_ENABLED(CONFIG_NET_IPV6) && (vhl & 0xf0) == 0x60) {
+		hash = flow_hash_ipv6(pkt);
+	}
+
+out:
+	net_pkt_cursor_restore(pkt, &backup);
+
+	return hash ^ (hash >> 16);
+}
 
 bool net_tc_submit_to_tx_queue(u8_t tc, struct net_pkt *pkt)
 {
+	int worker = 0;
+
 	if (k_work_pending(net_pkt_work(pkt))) {
 		return false;
 	}
 
-	k_work_submit_to_queue(&tx_classes[tc].work_q, net_pkt_work(pkt));
+	if (NET_TC_TX_WORKERS > 1) {
+		worker = net_tc_flow_hash(pkt, false) % NET_TC_TX_WORKERS;
+	}
+
+	k_work_submit_to_queue(&tx_classes[tc][worker].work_q,
+			       net_pkt_work(pkt));
 
 	return true;
 }
 
 void net_tc_submit_to_rx_queue(u8_t tc, struct net_pkt *pkt)
 {
-	k_work_submit_to_queue(&rx_classes[tc].work_q, net_pkt_work(pkt));
+	int worker = 0;
+
+	if (NET_TC_RX_WORKERS > 1) {
+		worker = net_tc_flow_hash(pkt, true) % NET_TC_RX_WORKERS;
+	}
+
+	k_work_submit_to_queue(&rx_classes[tc][worker].work_q,
+			       net_pkt_work(pkt));
+}
+
+int net_tc_rx_worker(void)
+{
+	k_tid_t current = k_current_get();
+	int i, j;
+
+	for (i = 0; i < NET_TC_RX_COUNT; i++) {
+		for (j = 0; j < NET_TC_RX_WORKERS; j++) {
+			if (current == &rx_classes[i][j].work_q.thread) {
+				return i * NET_TC_RX_WORKERS + j;
+			}
+		}
+	}
+
+	return -1;
+}
+
+bool net_tc_rx_worker_is_idle(int worker)
+{
+	struct net_traffic_class *rx_class =
+		&rx_classes[worker / NET_TC_RX_WORKERS]
+			   [worker % NET_TC_RX_WORKERS];
+
+	return k_queue_is_empty(&rx_class->work_q.queue);
 }
 
 int net_tx_priority2tc(enum net_priority prio)
@@ -212,13 +429,33 @@ static void net_tc_rx_stats_priority_setup(struct net_if *iface,
 }
 #endif
 
+/* Pin the worker threads of a traffic class to the CPUs in round-robin
+ * order, so that the flows are spread across the cores.
+ */
+static void tc_worker_pin(struct k_work_q *work_q, int worker)
+{
+#if defined(CONFIG_SMP) && defined(CONFIG_SCHED_CPU_MASK)
+	k_tid_t thread = &work_q->thread;
+
+	/* CPU mask can only be changed while the thread is not runnable */
+	k_thread_suspend(thread);
+	k_thread_cpu_mask_clear(thread);
+	k_thread_cpu_mask_enable(thread, worker % CONFIG_MP_NUM_CPUS);
+	k_thread_resume(thread);
+#else
+	ARG_UNUSED(work_q);
+	ARG_UNUSED(worker);
+#endif
+}
+
 /* Create workqueue for each traffic class we are using. All the network
  * traffic goes through these classes. There needs to be at least one traffic
- * class in the system.
+ * class in the system. Each class can be served by several worker threads,
+ * in which case the packets are dispatched to them by flow.
  */
 void net_tc_tx_init(void)
 {
-	int i;
+	int i, j;
 
 	BUILD_ASSERT(NET_TC_TX_COUNT > 0);
 
@@ -230,25 +467,36 @@ void net_tc_tx_init(void)
 		u8_t thread_priority;
 
 		thread_priority = tx_tc2thread(i);
-		tx_classes[i].tc = thread_priority;
-
-		NET_DBG("[%d] Starting TX queue %p stack size %zd "
-			"prio %d (%d)", i,
-			&tx_classes[i].work_q.queue,
-			K_THREAD_STACK_SIZEOF(tx_stack[i]),
-			thread_priority, K_PRIO_COOP(thread_priority));
-
-		k_work_q_start(&tx_classes[i].work_q,
-			       tx_stack[i],
-			       K_THREAD_STACK_SIZEOF(tx_stack[i]),
-			       K_PRIO_COOP(thread_priority));
-		k_thread_name_set(&tx_classes[i].work_q.thread, "tx_workq");
+
+		for (j = 0; j < NET_TC_TX_WORKERS; j++) {
+			struct net_traffic_class *tx_class = &tx_classes[i][j];
+			int idx = i * NET_TC_TX_WORKERS + j;
+
+			tx_class->tc = thread_priority;
+
+			NET_DBG("[%d/%d] Starting TX queue %p stack size %zd "
+				"prio %d (%d)", i, j,
+				&tx_class->work_q.queue,
+				K_THREAD_STACK_SIZEOF(tx_stack[idx]),
+				thread_priority, K_PRIO_COOP(thread_priority));
+
+			k_work_q_start(&tx_class->work_q,
+				       tx_stack[idx],
+				       K_THREAD_STACK_SIZEOF(tx_stack[idx]),
+				       K_PRIO_COOP(thread_priority));
+			k_thread_name_set(&tx_class->work_q.thread,
+					  "tx_workq");
+
+			if (NET_TC_TX_WORKERS > 1) {
+				tc_worker_pin(&tx_class->work_q, j);
+			}
+		}
 	}
 }
 
 void net_tc_rx_init(void)
 {
-	int i;
+	int i, j;
 
 	BUILD_ASSERT(NET_TC_RX_COUNT > 0);
 
@@ -260,18 +508,29 @@ void net_tc_rx_init(void)
 		u8_t thread_priority;
 
 		thread_priority = rx_tc2thread(i);
-		rx_classes[i].tc = thread_priority;
-
-		NET_DBG("[%d] Starting RX queue %p stack size %zd "
-			"prio %d (%d)", i,
-			&rx_classes[i].work_q.queue,
-			K_THREAD_STACK_SIZEOF(rx_stack[i]),
-			thread_priority, K_PRIO_COOP(thread_priority));
-
-		k_work_q_start(&rx_classes[i].work_q,
-			       rx_stack[i],
-			       K_THREAD_STACK_SIZEOF(rx_stack[i]),
-			       K_PRIO_COOP(thread_priority));
-		k_thread_name_set(&rx_classes[i].work_q.thread, "rx_workq");
+
+		for (j = 0; j < NET_TC_RX_WORKERS; j++) {
+			struct net_traffic_class *rx_class = &rx_classes[i][j];
+			int idx = i * NET_TC_RX_WORKERS + j;
+
+			rx_class->tc = thread_priority;
+
+			NET_DBG("[%d/%d] Starting RX queue %p stack size %zd "
+				"prio %d (%d)", i, j,
+				&rx_class->work_q.queue,
+				K_THREAD_STACK_SIZEOF(rx_stack[idx]),
+				thread_priority, K_PRIO_COOP(thread_priority));
+
+			k_work_q_start(&rx_class->work_q,
+				       rx_stack[idx],
+				       K_THREAD_STACK_SIZEOF(rx_stack[idx]),
+				       K_PRIO_COOP(thread_priority));
+			k_thread_name_set(&rx_class->work_q.thread,
+					  "rx_workq");
+
+			if (NET_TC_RX_WORKERS > 1) {
+				tc_worker_pin(&rx_class->work_q, j);
+			}
+		}
 	}
 }
@@ -21,6 +21,9 @@ LOG_MODULE_REGISTER(net_sockets_raw, CONFIG_NET_SOCKETS_LOG_LEVEL);
 
 enum net_verdict net_packet_socket_input(struct net_pkt *pkt)
 {
+	sa_family_t orig_family = net_pkt_family(pkt);
+	enum net_verdict verdict;
+
 	/* Currently we are skipping L2 layer verification and not
 	 * removing L2 header from packet.
 	 * TODO :
@@ -38,5 +41,15 @@ enum net_verdict net_packet_socket_input(struct net_pkt *pkt)
 
 	net_pkt_set_family(pkt, AF_PACKET);
 
-	return net_conn_input(pkt, NULL, ETH_P_ALL, NULL);
+	verdict = net_conn_input(pkt, NULL, ETH_P_ALL, NULL);
+	if (verdict != NET_DROP) {
+		return verdict;
+	}
+
+	/* No packet socket took the packet, for instance because their
+	 * filters did not match it, so let the stack process it.
+	 */
+	net_pkt_set_family(pkt, orig_family);
+
+	return NET_CONTINUE;
 }
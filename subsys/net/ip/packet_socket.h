@@ -20,10 +20,9 @@
  *
  * @param pkt Network packet
  *
- * @return NET_OK if the packet was consumed, NET_DROP if
- * the packet parsing failed and the caller should handle
- * the received packet. If corresponding IP protocol support is
- * disabled, the function will always return NET_DROP.
+ * @return NET_OK if the packet was consumed by a packet socket,
+ * NET_CONTINUE if no packet socket took it and the caller should
+ * process it.
  */
 #if defined(CONFIG_NET_SOCKETS_PACKET)
 enum net_verdict net_packet_socket_input(struct net_pkt *pkt);
@@ -16,6 +16,7 @@ LOG_MODULE_REGISTER(net_route, CONFIG_NET_ROUTE_LOG_LEVEL);
 #include <limits.h>
 #include <zephyr/types.h>
 #include <sys/slist.h>
+#include <sys/dlist.h>
 
 #include <net/net_pkt.h>
 #include <net/net_core.h>
@@ -28,6 +29,7 @@ LOG_MODULE_REGISTER(net_route, CONFIG_NET_ROUTE_LOG_LEVEL);
 #include "icmpv6.h"
 #include "nbr.h"
 #include "route.h"
+#include "route_lpm.h"
 
 #if !defined(NET_ROUTE_EXTRA_DATA_SIZE)
 #define NET_ROUTE_EXTRA_DATA_SIZE 0
@@ -36,7 +38,47 @@ LOG_MODULE_REGISTER(net_route, CONFIG_NET_ROUTE_LOG_LEVEL);
 /* We keep track of the routes in a separate list so that we can remove
  * the oldest routes (at tail) if needed.
  */
-static sys_slist_t routes;
+static sys_dlist_t routes = SYS_DLIST_STATIC_INIT(&routes);
+
+#if defined(CONFIG_NET_ROUTE_LPM)
+/* Longest prefix match index of the routes, a trie of N prefixes needs
+ * at most 2 * N - 1 nodes.
+ */
+static struct net_route_lpm_node route_lpm_nodes[2 * CONFIG_NET_MAX_ROUTES];
+static struct net_route_lpm route_lpm;
+#endif
+
+#if CONFIG_NET_ROUTE_CACHE_SIZE > 0
+/* Recent lookups. An entry is valid while route_gen is the same as when
+ * it was stored, and the routing table changes bump route_gen.
+ */
+struct route_cache_entry {
+	struct in6_addr dst;
+	struct net_if *iface;
+	struct net_route_entry *route;
+	u32_t gen;
+};
+
+static struct route_cache_entry route_cache[CONFIG_NET_ROUTE_CACHE_SIZE];
+static u32_t route_gen = 1U;
+
+static inline struct route_cache_entry *route_cache_slot(struct in6_addr *dst)
+{
+	u32_t hash = UNALIGNED_GET(&dst->s6_addr32[2]) ^
+		     UNALIGNED_GET(&dst->s6_addr32[3]);
+
+	hash ^= hash >> 16;
+
+	return &route_cache[(hash ^ (hash >> 8)) % CONFIG_NET_ROUTE_CACHE_SIZE];
+}
+
+static inline void route_cache_flush(void)
+{
+	route_gen++;
+}
+#else
+#define route_cache_flush(...)
+#endif
 
 static void net_route_nexthop_remove(struct net_nbr *nbr)
 {
@@ -253,12 +295,35 @@ static int nbr_nexthop_put(struct net_nbr *nbr)
 /* Route was accessed, so place it in front of the routes list */
 static inline void update_route_access(struct net_route_entry *route)
 {
-	sys_slist_find_and_remove(&routes, &route->node);
-	sys_slist_prepend(&routes, &route->node);
+	sys_dlist_remove(&route->node);
+	sys_dlist_prepend(&routes, &route->node);
 }
 
-struct net_route_entry *net_route_lookup(struct net_if *iface,
-					 struct in6_addr *dst)
+#if defined(CONFIG_NET_ROUTE_LPM)
+static bool route_iface_match(sys_snode_t *entry, void *user_data)
+{
+	struct net_route_entry *route =
+		CONTAINER_OF(entry, struct net_route_entry, lpm_node);
+
+	return route->iface == user_data;
+}
+
+static struct net_route_entry *route_find(struct net_if *iface,
+					  struct in6_addr *dst)
+{
+	sys_snode_t *entry;
+
+	entry = net_route_lpm_lookup(&route_lpm, dst->s6_addr, 128,
+				     iface ? route_iface_match : NULL, iface);
+	if (!entry) {
+		return NULL;
+	}
+
+	return CONTAINER_OF(entry, struct net_route_entry, lpm_node);
+}
+#else
+static struct net_route_entry *route_find(struct net_if *iface,
+					  struct in6_addr *dst)
 {
 	struct net_route_entry *route, *found = NULL;
 	u8_t longest_match = 0U;
@@ -286,6 +351,32 @@ struct net_route_entry *net_route_lookup(struct net_if *iface,
 		}
 	}
 
+	return found;
+}
+#endif /* CONFIG_NET_ROUTE_LPM */
+
+struct net_route_entry *net_route_lookup(struct net_if *iface,
+					 struct in6_addr *dst)
+{
+	struct net_route_entry *found;
+#if CONFIG_NET_ROUTE_CACHE_SIZE > 0
+	struct route_cache_entry *cached = route_cache_slot(dst);
+
+	if (cached->gen == route_gen && cached->iface == iface &&
+	    net_ipv6_addr_cmp(&cached->dst, dst)) {
+		found = cached->route;
+	} else {
+		found = route_find(iface, dst);
+
+		net_ipaddr_copy(&cached->dst, dst);
+		cached->iface = iface;
+		cached->route = found;
+		cached->gen = route_gen;
+	}
+#else
+	found = route_find(iface, dst);
+#endif
+
 	if (found) {
 		net_route_info("Found", found, dst);
 
@@ -353,9 +444,7 @@ struct net_route_entry *net_route_add(struct net_if *iface,
 	nbr = nbr_new(iface, addr, prefix_len);
 	if (!nbr) {
 		/* Remove the oldest route and try again */
-		sys_snode_t *last = sys_slist_peek_tail(&routes);
-
-		sys_slist_find_and_remove(&routes, last);
+		sys_dnode_t *last = sys_dlist_peek_tail(&routes);
 
 		route = CONTAINER_OF(last,
 				     struct net_route_entry,
@@ -401,7 +490,19 @@ struct net_route_entry *net_route_add(struct net_if *iface,
 	route = net_route_data(nbr);
 	route->iface = iface;
 
-	sys_slist_prepend(&routes, &route->node);
+#if defined(CONFIG_NET_ROUTE_LPM)
+	if (net_route_lpm_add(&route_lpm, addr->s6_addr, prefix_len,
+			      &route->lpm_node) < 0) {
+		NET_ERR("No room in the route index!");
+		net_nbr_unref(tmp);
+		nbr_free(nbr);
+		return NULL;
+	}
+#endif
+
+	route_cache_flush();
+
+	sys_dlist_prepend(&routes, &route->node);
 
 	tmp = nbr_nexthop_get(iface, nexthop);
 
@@ -441,6 +542,11 @@ int net_route_del(struct net_route_entry *route)
 		return -EINVAL;
 	}
 
+	nbr = net_route_get_nbr(route);
+	if (!nbr) {
+		return -ENOENT;
+	}
+
 #if defined(CONFIG_NET_MGMT_EVENT_INFO)
 	net_ipaddr_copy(&info.addr, &route->addr);
 	info.prefix_len = route->prefix_len;
@@ -454,12 +560,14 @@ int net_route_del(struct net_route_entry *route)
 	net_mgmt_event_notify(NET_EVENT_IPV6_ROUTE_DEL, route->iface);
 #endif
 
-	sys_slist_find_and_remove(&routes, &route->node);
+	sys_dlist_remove(&route->node);
 
-	nbr = net_route_get_nbr(route);
-	if (!nbr) {
-		return -ENOENT;
-	}
+#if defined(CONFIG_NET_ROUTE_LPM)
+	(void)net_route_lpm_del(&route_lpm, route->addr.s6_addr,
+				route->prefix_len, &route->lpm_node);
+#endif
+
+	route_cache_flush();
 
 	net_route_info("Deleted", route, &route->addr);
 
@@ -845,6 +953,11 @@ int net_route_packet_if(struct net_pkt *pkt, struct net_if *iface)
 
 void net_route_init(void)
 {
+#if defined(CONFIG_NET_ROUTE_LPM)
+	net_route_lpm_init(&route_lpm, route_lpm_nodes,
+			   ARRAY_SIZE(route_lpm_nodes));
+#endif
+
 	NET_DBG("Allocated %d routing entries (%zu bytes)",
 		CONFIG_NET_MAX_ROUTES, sizeof(net_route_entries_pool));
 
@@ -15,6 +15,7 @@
 
 #include <kernel.h>
 #include <sys/slist.h>
+#include <sys/dlist.h>
 
 #include <net/net_ip.h>
 
@@ -46,7 +47,14 @@ struct net_route_entry {
 	 * we can remove it if we run out of available routes.
 	 * The oldest one is the last entry in the list.
 	 */
-	sys_snode_t node;
+	sys_dnode_t node;
+
+#if defined(CONFIG_NET_ROUTE_LPM)
+	/** Node in the list of routes to the same prefix in the longest
+	 * prefix match index.
+	 */
+	sys_snode_t lpm_node;
+#endif
 
 	/** List of neighbors that the routes go through. */
 	sys_slist_t nexthop;
@@ -272,6 +280,88 @@ int net_route_packet(struct net_pkt *pkt, struct in6_addr *nexthop);
  */
 int net_route_packet_if(struct net_pkt *pkt, struct net_if *iface);
 
+/**
+ * @brief IPv4 route entry.
+ */
+struct net_route_entry_ipv4 {
+	/** Node in the list of routes to the same prefix in the longest
+	 * prefix match index.
+	 */
+	sys_snode_t lpm_node;
+
+	/** Network interface for the route. */
+	struct net_if *iface;
+
+	/** IPv4 prefix of the route, the host bits are zero. */
+	struct in_addr addr;
+
+	/** Gateway, unspecified if the prefix is on the link. */
+	struct in_addr gw;
+
+	/** IPv4 prefix length. */
+	u8_t prefix_len;
+
+	/** Is this entry in use or not */
+	bool is_used;
+};
+
+typedef void (*net_route_ipv4_cb_t)(struct net_route_entry_ipv4 *entry,
+				    void *user_data);
+
+/**
+ * @brief Add a route to the IPv4 routing table. If the table has a route
+ * to the same prefix on the same interface, its gateway is updated.
+ *
+ * @param iface Network interface that this route is tied to.
+ * @param addr IPv4 prefix.
+ * @param prefix_len Length of the prefix, 0 for a default route.
+ * @param gw Gateway, NULL or unspecified if the prefix is on the link.
+ *
+ * @return Return created route entry, NULL if could not be created.
+ */
+struct net_route_entry_ipv4 *net_route_ipv4_add(struct net_if *iface,
+						const struct in_addr *addr,
+						u8_t prefix_len,
+						const struct in_addr *gw);
+
+/**
+ * @brief Delete a route from the IPv4 routing table.
+ *
+ * @param entry Existing route entry.
+ *
+ * @return 0 if ok, <0 if error
+ */
+int net_route_ipv4_del(struct net_route_entry_ipv4 *entry);
+
+/**
+ * @brief Lookup the IPv4 route with the longest prefix matching a
+ * destination.
+ *
+ * @param iface Network interface. If NULL, then check against all interfaces.
+ * @param dst Destination IPv4 address.
+ *
+ * @return Route entry, NULL if not found.
+ */
+struct net_route_entry_ipv4 *net_route_ipv4_lookup(struct net_if *iface,
+						   const struct in_addr *dst);
+
+/**
+ * @brief Go through all the IPv4 routing entries and call callback
+ * for each entry that is in use.
+ *
+ * @param cb User supplied callback function to call.
+ * @param user_data User specified data.
+ *
+ * @return Total number of IPv4 routing entries found.
+ */
+int net_route_ipv4_foreach(net_route_ipv4_cb_t cb, void *user_data);
+
+#if defined(CONFIG_NET_ROUTE_IPV4) && defined(CONFIG_NET_NATIVE)
+void net_route_ipv4_init(void);
+#else
+#define net_route_ipv4_init(...)
+#endif /* CONFIG_NET_ROUTE_IPV4 */
+
 #if defined(CONFIG_NET_ROUTE) && defined(CONFIG_NET_NATIVE)
 void net_route_init(void);
 #else
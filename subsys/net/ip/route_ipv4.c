@@ -0,0 +1,184 @@
+/** @file
+ * @brief IPv4 route handling.
+ *
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_route_ipv4, CONFIG_NET_ROUTE_IPV4_LOG_LEVEL);
+
+#include <kernel.h>
+#include <zephyr/types.h>
+#include <sys/slist.h>
+
+#include <net/net_core.h>
+#include <net/net_ip.h>
+
+#include "net_private.h"
+#include "route.h"
+#include "route_lpm.h"
+
+static struct net_route_entry_ipv4 routes[CONFIG_NET_MAX_IPV4_ROUTES];
+
+/* A trie of N prefixes needs at most 2 * N - 1 nodes */
+static struct net_route_lpm_node lpm_nodes[2 * CONFIG_NET_MAX_IPV4_ROUTES];
+static struct net_route_lpm lpm;
+
+static inline struct net_route_entry_ipv4 *route_entry(sys_snode_t *node)
+{
+	return CONTAINER_OF(node, struct net_route_entry_ipv4, lpm_node);
+}
+
+static inline u32_t prefix_mask(u8_t prefix_len)
+{
+	return prefix_len ? htonl(0xffffffff << (32 - prefix_len)) : 0;
+}
+
+static bool route_iface_match(sys_snode_t *entry, void *user_data)
+{
+	return route_entry(entry)->iface == user_data;
+}
+
+static struct net_route_entry_ipv4 *route_find(struct net_if *iface,
+					       const struct in_addr *addr,
+					       u8_t prefix_len)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(routes); i++) {
+		struct net_route_entry_ipv4 *route = &routes[i];
+
+		if (route->is_used && route->iface == iface &&
+		    route->prefix_len == prefix_len &&
+		    route->addr.s_addr ==
+		    (addr->s_addr & prefix_mask(prefix_len))) {
+			return route;
+		}
+	}
+
+	return NULL;
+}
+
+struct net_route_entry_ipv4 *net_route_ipv4_add(struct net_if *iface,
+						const struct in_addr *addr,
+						u8_t prefix_len,
+						const struct in_addr *gw)
+{
+	struct net_route_entry_ipv4 *route;
+	int i;
+
+	NET_ASSERT(iface);
+	NET_ASSERT(addr);
+
+	if (prefix_len > 32) {
+		return NULL;
+	}
+
+	route = route_find(iface, addr, prefix_len);
+	if (route) {
+		NET_DBG("Update route to %s/%d",
+			log_strdup(net_sprint_ipv4_addr(addr)), prefix_len);
+		goto set_gw;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(routes); i++) {
+		if (!routes[i].is_used) {
+			route = &routes[i];
+			break;
+		}
+	}
+
+	if (!route) {
+		NET_DBG("No free IPv4 route entry");
+		return NULL;
+	}
+
+	if (net_route_lpm_add(&lpm, addr->s4_addr, prefix_len,
+			      &route->lpm_node) < 0) {
+		NET_ERR("No room in the route index!");
+		return NULL;
+	}
+
+	route->iface = iface;
+	route->addr.s_addr = addr->s_addr & prefix_mask(prefix_len);
+	route->prefix_len = prefix_len;
+	route->is_used = true;
+
+	NET_DBG("Added route to %s/%d (iface %p)",
+		log_strdup(net_sprint_ipv4_addr(addr)), prefix_len, iface);
+
+set_gw:
+	if (gw) {
+		net_ipaddr_copy(&route->gw, gw);
+	} else {
+		route->gw.s_addr = INADDR_ANY;
+	}
+
+	return route;
+}
+
+int net_route_ipv4_del(struct net_route_entry_ipv4 *route)
+{
+	if (!route) {
+		return -EINVAL;
+	}
+
+	if (!route->is_used) {
+		return -ENOENT;
+	}
+
+	(void)net_route_lpm_del(&lpm, route->addr.s4_addr, route->prefix_len,
+				&route->lpm_node);
+
+	route->is_used = false;
+
+	NET_DBG("Deleted route to %s/%d",
+		log_strdup(net_sprint_ipv4_addr(&route->addr)),
+		route->prefix_len);
+
+	return 0;
+}
+
+struct net_route_entry_ipv4 *net_route_ipv4_lookup(struct net_if *iface,
+						   const struct in_addr *dst)
+{
+	sys_snode_t *entry;
+
+	entry = net_route_lpm_lookup(&lpm, dst->s4_addr, 32,
+				     iface ? route_iface_match : NULL, iface);
+	if (!entry) {
+		return NULL;
+	}
+
+	return route_entry(entry);
+}
+
+int net_route_ipv4_foreach(net_route_ipv4_cb_t cb, void *user_data)
+{
+	int i, ret = 0;
+
+	for (i = 0; i < ARRAY_SIZE(routes); i++) {
+		if (!routes[i].is_used) {
+			continue;
+		}
+
+		cb(&routes[i], user_data);
+
+		ret++;
+	}
+
+	return ret;
+}
+
+void net_route_ipv4_init(void)
+{
+	net_route_lpm_init(&lpm, lpm_nodes, ARRAY_SIZE(lpm_nodes));
+
+	NET_DBG("Allocated %d IPv4 routing entries (%zu bytes)",
+		CONFIG_NET_MAX_IPV4_ROUTES, sizeof(routes) + sizeof(lpm_nodes));
+}
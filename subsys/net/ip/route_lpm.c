@@ -0,0 +1,249 @@
+/** @file
+ * @brief Longest prefix match index of the routing tables
+ *
+ * The prefixes are kept in a path compressed binary trie. A lookup visits
+ * at most one node per distinct prefix length on the path to the address,
+ * instead of comparing the address with every route.
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/types.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/util.h>
+
+#include "route_lpm.h"
+
+static inline u8_t key_bit(const u8_t *key, u8_t bit)
+{
+	return (key[bit / 8U] >> (7 - (bit % 8U))) & 1;
+}
+
+/* Number of leading bits, at most max, that the keys have in common */
+static u8_t common_len(const u8_t *key1, const u8_t *key2, u8_t max)
+{
+	u8_t len = 0U;
+	u8_t diff;
+
+	while (len < max) {
+		diff = key1[len / 8U] ^ key2[len / 8U];
+		if (diff) {
+			len += __builtin_clz(diff) - 24;
+			break;
+		}
+
+		len += 8U;
+	}
+
+	return MIN(len, max);
+}
+
+static bool is_prefix(const struct net_route_lpm_node *node, const u8_t *addr)
+{
+	return common_len(node->key, addr, node->prefix_len) ==
+		node->prefix_len;
+}
+
+static struct net_route_lpm_node *node_alloc(struct net_route_lpm *lpm,
+					     const u8_t *key, u8_t prefix_len)
+{
+	struct net_route_lpm_node *node = lpm->free;
+	u8_t bytes = prefix_len / 8U;
+	u8_t remain = prefix_len % 8U;
+
+	lpm->free = node->child[0];
+
+	memset(node, 0, sizeof(*node));
+
+	memcpy(node->key, key, bytes);
+
+	if (remain) {
+		node->key[bytes] = key[bytes] & (0xff << (8 - remain));
+	}
+
+	node->prefix_len = prefix_len;
+	sys_slist_init(&node->entries);
+
+	return node;
+}
+
+static void node_free(struct net_route_lpm *lpm,
+		      struct net_route_lpm_node *node)
+{
+	node->child[0] = lpm->free;
+	lpm->free = node;
+}
+
+static bool have_free_nodes(struct net_route_lpm *lpm, int count)
+{
+	struct net_route_lpm_node *node = lpm->free;
+
+	while (node && count > 0) {
+		node = node->child[0];
+		count--;
+	}
+
+	return count == 0;
+}
+
+void net_route_lpm_init(struct net_route_lpm *lpm,
+			struct net_route_lpm_node *nodes, size_t count)
+{
+	size_t i;
+
+	lpm->root = NULL;
+	lpm->free = NULL;
+
+	for (i = 0; i < count; i++) {
+		node_free(lpm, &nodes[i]);
+	}
+}
+
+int net_route_lpm_add(struct net_route_lpm *lpm, const u8_t *key,
+		      u8_t prefix_len, sys_snode_t *entry)
+{
+	struct net_route_lpm_node **link = &lpm->root;
+	struct net_route_lpm_node *node, *branch, *leaf;
+	u8_t common;
+
+	while ((node = *link) != NULL) {
+		common = common_len(node->key, key,
+				    MIN(node->prefix_len, prefix_len));
+
+		if (common == node->prefix_len) {
+			if (common == prefix_len) {
+				/* Another route to the same prefix */
+				sys_slist_append(&node->entries, entry);
+				return 0;
+			}
+
+			link = &node->child[key_bit(key, common)];
+			continue;
+		}
+
+		if (common == prefix_len) {
+			/* The new prefix goes between this node and its
+			 * parent.
+			 */
+			if (!lpm->free) {
+				return -ENOMEM;
+			}
+
+			leaf = node_alloc(lpm, key, prefix_len);
+			leaf->child[key_bit(node->key, common)] = node;
+			sys_slist_append(&leaf->entries, entry);
+			*link = leaf;
+
+			return 0;
+		}
+
+		/* The prefixes diverge, branch where they do */
+		if (!have_free_nodes(lpm, 2)) {
+			return -ENOMEM;
+		}
+
+		branch = node_alloc(lpm, key, common);
+		leaf = node_alloc(lpm, key, prefix_len);
+
+		branch->child[key_bit(key, common)] = leaf;
+		branch->child[key_bit(node->key, common)] = node;
+		sys_slist_append(&leaf->entries, entry);
+		*link = branch;
+
+		return 0;
+	}
+
+	if (!lpm->free) {
+		return -ENOMEM;
+	}
+
+	leaf = node_alloc(lpm, key, prefix_len);
+	sys_slist_append(&leaf->entries, entry);
+	*link = leaf;
+
+	return 0;
+}
+
+int net_route_lpm_del(struct net_route_lpm *lpm, const u8_t *key,
+		      u8_t prefix_len, sys_snode_t *entry)
+{
+	struct net_route_lpm_node **parent_link = NULL;
+	struct net_route_lpm_node **link = &lpm->root;
+	struct net_route_lpm_node *node, *parent;
+
+	while ((node = *link) != NULL) {
+		if (node->prefix_len > prefix_len || !is_prefix(node, key)) {
+			return -ENOENT;
+		}
+
+		if (node->prefix_len == prefix_len) {
+			break;
+		}
+
+		parent_link = link;
+		link = &node->child[key_bit(key, node->prefix_len)];
+	}
+
+	if (!node || !sys_slist_find_and_remove(&node->entries, entry)) {
+		return -ENOENT;
+	}
+
+	if (!sys_slist_is_empty(&node->entries) ||
+	    (node->child[0] && node->child[1])) {
+		/* Still needed, as a prefix or as a branch */
+		return 0;
+	}
+
+	*link = node->child[0] ? node->child[0] : node->child[1];
+	node_free(lpm, node);
+
+	if (*link || !parent_link) {
+		return 0;
+	}
+
+	/* The parent may now be a branch with a single child */
+	parent = *parent_link;
+
+	if (sys_slist_is_empty(&parent->entries)) {
+		*parent_link = parent->child[0] ? parent->child[0] :
+			parent->child[1];
+		node_free(lpm, parent);
+	}
+
+	return 0;
+}
+
+sys_snode_t *net_route_lpm_lookup(struct net_route_lpm *lpm,
+				  const u8_t *addr, u8_t addr_len,
+				  net_route_lpm_match_t match,
+				  void *user_data)
+{
+	struct net_route_lpm_node *node = lpm->root;
+	sys_snode_t *found = NULL;
+	sys_snode_t *entry;
+
+	/* The prefixes get longer on the way down, so the last route that
+	 * matches is the one with the longest prefix.
+	 */
+	while (node && node->prefix_len <= addr_len && is_prefix(node, addr)) {
+		SYS_SLIST_FOR_EACH_NODE(&node->entries, entry) {
+			if (!match || match(entry, user_data)) {
+				found = entry;
+				break;
+			}
+		}
+
+		if (node->prefix_len == addr_len) {
+			break;
+		}
+
+		node = node->child[key_bit(addr, node->prefix_len)];
+	}
+
+	return found;
+}
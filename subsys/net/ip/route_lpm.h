@@ -0,0 +1,126 @@
+/** @file
+ * @brief Longest prefix match index of the routing tables
+ *
+ * This is not to be included by the application.
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __ROUTE_LPM_H
+#define __ROUTE_LPM_H
+
+#include <zephyr/types.h>
+#include <sys/slist.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Longest key of the index in bytes, enough for an IPv6 address */
+#define NET_ROUTE_LPM_KEY_LEN 16
+
+/**
+ * @brief Node of a path compressed binary trie. A node either holds the
+ * routes of one prefix, or only branches to two longer prefixes.
+ */
+struct net_route_lpm_node {
+	/** Longer prefixes, indexed by the bit after this prefix. Links
+	 * the free nodes in child[0].
+	 */
+	struct net_route_lpm_node *child[2];
+
+	/** Routes of exactly this prefix */
+	sys_slist_t entries;
+
+	/** Prefix, the bits after prefix_len are zero */
+	u8_t key[NET_ROUTE_LPM_KEY_LEN];
+
+	/** Length of the prefix in bits */
+	u8_t prefix_len;
+};
+
+/**
+ * @brief Longest prefix match index. A trie of N prefixes uses at most
+ * 2 * N - 1 nodes.
+ */
+struct net_route_lpm {
+	/** Shortest prefix, NULL if the index is empty */
+	struct net_route_lpm_node *root;
+
+	/** Free nodes */
+	struct net_route_lpm_node *free;
+};
+
+/**
+ * @typedef net_route_lpm_match_t
+ * @brief Callback checking if a route found by net_route_lpm_lookup() can
+ * be used.
+ *
+ * @param entry Route entry node
+ * @param user_data User data given to net_route_lpm_lookup()
+ *
+ * @return True if the route can be used.
+ */
+typedef bool (*net_route_lpm_match_t)(sys_snode_t *entry, void *user_data);
+
+/**
+ * @brief Initialize an index.
+ *
+ * @param lpm Index to initialize
+ * @param nodes Nodes used by the index
+ * @param count Number of nodes
+ */
+void net_route_lpm_init(struct net_route_lpm *lpm,
+			struct net_route_lpm_node *nodes, size_t count);
+
+/**
+ * @brief Add a route to the index.
+ *
+ * @param lpm Index
+ * @param key Prefix of the route
+ * @param prefix_len Length of the prefix in bits
+ * @param entry Node of the route entry
+ *
+ * @return 0 if ok, -ENOMEM if there are not enough free nodes.
+ */
+int net_route_lpm_add(struct net_route_lpm *lpm, const u8_t *key,
+		      u8_t prefix_len, sys_snode_t *entry);
+
+/**
+ * @brief Remove a route from the index.
+ *
+ * @param lpm Index
+ * @param key Prefix of the route, as given to net_route_lpm_add()
+ * @param prefix_len Length of the prefix in bits
+ * @param entry Node of the route entry
+ *
+ * @return 0 if ok, -ENOENT if the route is not in the index.
+ */
+int net_route_lpm_del(struct net_route_lpm *lpm, const u8_t *key,
+		      u8_t prefix_len, sys_snode_t *entry);
+
+/**
+ * @brief Find the route with the longest prefix matching an address.
+ *
+ * @param lpm Index
+ * @param addr Address
+ * @param addr_len Length of the address in bits
+ * @param match Callback filtering the routes, NULL to accept all of them
+ * @param user_data User data passed to the callback
+ *
+ * @return Node of the route entry, NULL if no route matches.
+ */
+sys_snode_t *net_route_lpm_lookup(struct net_route_lpm *lpm,
+				  const u8_t *addr, u8_t addr_len,
+				  net_route_lpm_match_t match,
+				  void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __ROUTE_LPM_H */
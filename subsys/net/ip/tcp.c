@@ -707,6 +707,18 @@ u16_t net_tcp_get_recv_mss(const struct net_tcp *tcp)
 	return 0;
 }
 
+u16_t net_tcp_get_send_mss(const struct net_tcp *tcp)
+{
+	u16_t mss = net_tcp_get_recv_mss(tcp);
+
+	/* The peer may take less than the interface MTU allows */
+	if (tcp->send_mss && tcp->send_mss < mss) {
+		mss = tcp->send_mss;
+	}
+
+	return mss;
+}
+
 static void net_tcp_set_syn_opt(struct net_tcp *tcp, u8_t *options,
 				u8_t *optionlen)
 {
@@ -966,7 +978,7 @@ int net_tcp_send_pkt(struct net_pkt *pkt)
 			     net_pkt_ip_opts_len(pkt));
 
 		/* No need to get tcp_hdr again */
-		tcp_hdr->chksum = net_calc_chksum_tcp(pkt);
+		tcp_hdr->chksum = net_calc_chksum_tx(pkt, IPPROTO_TCP);
 
 		net_pkt_set_data(pkt, &tcp_access);
 	}
@@ -1380,10 +1392,7 @@ int net_tcp_finalize(struct net_pkt *pkt)
 	}
 
 	tcp_hdr->chksum = 0U;
-
-	if (net_if_need_calc_tx_checksum(net_pkt_iface(pkt))) {
-		tcp_hdr->chksum = net_calc_chksum_tcp(pkt);
-	}
+	tcp_hdr->chksum = net_calc_chksum_tx(pkt, IPPROTO_TCP);
 
 	return net_pkt_set_data(pkt, &tcp_access);
 }
@@ -2292,9 +2301,20 @@ NET_CONN_CB(tcp_synack_received)
 		/* Remove the temporary connection handler and register
 		 * a proper now as we have an established connection.
 		 */
+		struct net_tcp_options tcp_opts = {
+			.mss = NET_TCP_DEFAULT_MSS,
+		};
 		struct sockaddr local_addr;
 		struct sockaddr remote_addr;
 
+		if (net_tcp_parse_opts(pkt, NET_TCP_HDR_LEN(tcp_hdr) -
+				       sizeof(struct net_tcp_hdr),
+				       &tcp_opts) < 0) {
+			return NET_DROP;
+		}
+
+		context->tcp->send_mss = tcp_opts.mss;
+
 		tcp_copy_ip_addr_from_hdr(net_pkt_family(pkt), ip_hdr, tcp_hdr,
 					  &remote_addr, true);
 		tcp_copy_ip_addr_from_hdr(net_pkt_family(pkt), ip_hdr, tcp_hdr,
@@ -2728,6 +2748,7 @@ struct net_tcp_hdr *net_tcp_input(struct net_pkt *pkt,
 
 	if (IS_ENABLED(CONFIG_NET_TCP_CHECKSUM) &&
 	    net_if_need_calc_rx_checksum(net_pkt_iface(pkt)) &&
+	    !net_pkt_is_chksum_verified(pkt) &&
 	    net_calc_chksum_tcp(pkt) != 0U) {
 		NET_DBG("DROP: checksum mismatch");
 		goto drop;
@@ -1173,10 +1173,7 @@ int net_tcp_finalize(struct net_pkt *pkt)
 	}
 
 	tcp_hdr->chksum = 0U;
-
-	if (net_if_need_calc_tx_checksum(net_pkt_iface(pkt))) {
-		tcp_hdr->chksum = net_calc_chksum_tcp(pkt);
-	}
+	tcp_hdr->chksum = net_calc_chksum_tx(pkt, IPPROTO_TCP);
 
 	return net_pkt_set_data(pkt, &tcp_access);
 }
@@ -1188,6 +1185,7 @@ struct net_tcp_hdr *net_tcp_input(struct net_pkt *pkt,
 
 	if (IS_ENABLED(CONFIG_NET_TCP_CHECKSUM) &&
 			net_if_need_calc_rx_checksum(net_pkt_iface(pkt)) &&
+			!net_pkt_is_chksum_verified(pkt) &&
 			net_calc_chksum_tcp(pkt) != 0U) {
 		NET_DBG("DROP: checksum mismatch");
 		goto drop;
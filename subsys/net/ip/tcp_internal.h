@@ -484,6 +484,24 @@ static inline u16_t net_tcp_get_recv_mss(const struct net_tcp *tcp)
 }
 #endif
 
+/**
+ * @brief Returns the MSS to send with on a given TCP context, that is the
+ * smallest of the MSS announced by the peer and of the MSS of the interface.
+ *
+ * @param tcp TCP context
+ *
+ * @return Maximum Segment Size
+ */
+#if defined(CONFIG_NET_NATIVE_TCP)
+u16_t net_tcp_get_send_mss(const struct net_tcp *tcp);
+#else
+static inline u16_t net_tcp_get_send_mss(const struct net_tcp *tcp)
+{
+	ARG_UNUSED(tcp);
+	return 0;
+}
+#endif
+
 /**
  * @brief Returns the receive window for a given TCP context
  *
@@ -51,9 +51,7 @@ int net_udp_finalize(struct net_pkt *pkt)
 
 	udp_hdr->len = htons(length);
 
-	if (net_if_need_calc_tx_checksum(net_pkt_iface(pkt))) {
-		udp_hdr->chksum = net_calc_chksum_udp(pkt);
-	}
+	udp_hdr->chksum = net_calc_chksum_tx(pkt, IPPROTO_UDP);
 
 	return net_pkt_set_data(pkt, &udp_access);
 }
@@ -162,7 +160,8 @@ struct net_udp_hdr *net_udp_input(struct net_pkt *pkt,
 	}
 
 	if (IS_ENABLED(CONFIG_NET_UDP_CHECKSUM) &&
-	    net_if_need_calc_rx_checksum(net_pkt_iface(pkt))) {
+	    net_if_need_calc_rx_checksum(net_pkt_iface(pkt)) &&
+	    !net_pkt_is_chksum_verified(pkt)) {
 		if (!udp_hdr->chksum) {
 			if (IS_ENABLED(CONFIG_NET_UDP_MISSING_CHECKSUM) &&
 			    net_pkt_family(pkt) == AF_INET) {
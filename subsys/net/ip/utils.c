@@ -17,6 +17,7 @@ LOG_MODULE_REGISTER(net_utils, CONFIG_NET_UTILS_LOG_LEVEL);
 #include <syscall_handler.h>
 #include <zephyr/types.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <string.h>
 #include <errno.h>
 
@@ -25,6 +26,8 @@ LOG_MODULE_REGISTER(net_utils, CONFIG_NET_UTILS_LOG_LEVEL);
 #include <net/net_core.h>
 #include <net/socket_can.h>
 
+#include "net_private.h"
+
 char *net_sprint_addr(sa_family_t af, const void *addr)
 {
 #define NBUFS 3
@@ -489,37 +492,84 @@ int z_vrfy_net_addr_pton(sa_family_t family, const char *src,
 #include <syscalls/net_addr_pton_mrsh.c>
 #endif /* CONFIG_USERSPACE */
 
+/* Add the data, taken as 16-bit words in network byte order, to the one's
+ * complement sum. The data is read 32 bits at a time into a 64-bit
+ * accumulator so that the carries only need to be folded back at the end.
+ * The words are summed in host byte order, which gives the byte swapped
+ * sum on little endian CPUs (RFC 1071, 2.(B)), fixed up after the fold.
+ */
 static u16_t calc_chksum(u16_t sum, const u8_t *data, size_t len)
 {
-	const u8_t *end;
+	u64_t acc = 0U;
 	u16_t tmp;
 
-	end = data + len - 1;
+	if (((uintptr_t)data & 1) == 0U) {
+		const u32_t *word;
+
+		if (((uintptr_t)data & 2) && len >= 2) {
+			acc += *(const u16_t *)data;
+			data += 2;
+			len -= 2;
+		}
+
+		word = (const u32_t *)data;
+
+		while (len >= 16) {
+			acc += word[0];
+			acc += word[1];
+			acc += word[2];
+			acc += word[3];
+			word += 4;
+			len -= 16;
+		}
+
+		while (len >= 4) {
+			acc += *word++;
+			len -= 4;
+		}
 
-	while (data < end) {
-		tmp = (data[0] << 8) + data[1];
-		sum += tmp;
-		if (sum < tmp) {
-			sum++;
+		data = (const u8_t *)word;
+	} else {
+		while (len >= 4) {
+			acc += UNALIGNED_GET((const u32_t *)data);
+			data += 4;
+			len -= 4;
 		}
+	}
 
+	if (len >= 2) {
+		acc += UNALIGNED_GET((const u16_t *)data);
 		data += 2;
+		len -= 2;
 	}
 
-	if (data == end) {
-		tmp = data[0] << 8;
-		sum += tmp;
-		if (sum < tmp) {
-			sum++;
-		}
+	if (len) {
+		/* Odd byte is the most significant byte of the last word */
+		acc += htons((u16_t)(data[0] << 8));
+	}
+
+	acc = (acc & 0xffffffff) + (acc >> 32);
+	acc = (acc & 0xffff) + (acc >> 16);
+	acc = (acc & 0xffff) + (acc >> 16);
+	acc = (acc & 0xffff) + (acc >> 16);
+
+	tmp = ntohs((u16_t)acc);
+
+	sum += tmp;
+	if (sum < tmp) {
+		sum++;
 	}
 
 	return sum;
 }
 
+/* Checksum the packet from the cursor to the end. A fragment of odd length
+ * leaves the first byte of the next fragment to complete the last word.
+ */
 static inline u16_t pkt_calc_chksum(struct net_pkt *pkt, u16_t sum)
 {
 	struct net_pkt_cursor *cur = &pkt->cursor;
+	bool odd = false;
 	size_t len;
 
 	if (!cur->buf || !cur->pos) {
@@ -529,77 +579,147 @@ static inline u16_t pkt_calc_chksum(struct net_pkt *pkt, u16_t sum)
 	len = cur->buf->len - (cur->pos - cur->buf->data);
 
 	while (cur->buf) {
-		sum = calc_chksum(sum, cur->pos, len);
-
-		cur->buf = cur->buf->frags;
-		if (!cur->buf || !cur->buf->len) {
-			break;
-		}
-
-		cur->pos = cur->buf->data;
-
-		if (len % 2) {
+		if (odd && len) {
 			sum += *cur->pos;
 			if (sum < *cur->pos) {
 				sum++;
 			}
 
 			cur->pos++;
-			len = cur->buf->len - 1;
-		} else {
-			len = cur->buf->len;
+			len--;
+			odd = false;
+		}
+
+		sum = calc_chksum(sum, cur->pos, len);
+		odd = odd != (len % 2);
+
+		cur->buf = cur->buf->frags;
+		if (!cur->buf) {
+			break;
 		}
+
+		cur->pos = cur->buf->data;
+		len = cur->buf->len;
 	}
 
 	return sum;
 }
 
-u16_t net_calc_chksum(struct net_pkt *pkt, u8_t proto)
+/* Sum the pseudo header of the upper layer protocol, and leave the cursor
+ * at the start of the upper layer header.
+ */
+static bool calc_chksum_pseudo_hdr(struct net_pkt *pkt, u8_t proto,
+				   u16_t *sum)
 {
 	size_t len = 0U;
-	u16_t sum = 0U;
-	struct net_pkt_cursor backup;
-	bool ow;
+
+	*sum = 0U;
 
 	if (IS_ENABLED(CONFIG_NET_IPV4) &&
 	    net_pkt_family(pkt) == AF_INET) {
 		if (proto != IPPROTO_ICMP) {
 			len = 2 * sizeof(struct in_addr);
-			sum = net_pkt_get_len(pkt) -
+			*sum = net_pkt_get_len(pkt) -
 				net_pkt_ip_hdr_len(pkt) -
 				net_pkt_ipv4_opts_len(pkt) + proto;
 		}
 	} else if (IS_ENABLED(CONFIG_NET_IPV6) &&
 		   net_pkt_family(pkt) == AF_INET6) {
 		len = 2 * sizeof(struct in6_addr);
-		sum =  net_pkt_get_len(pkt) -
+		*sum =  net_pkt_get_len(pkt) -
 			net_pkt_ip_hdr_len(pkt) -
 			net_pkt_ipv6_ext_len(pkt) + proto;
 	} else {
 		NET_DBG("Unknown protocol family %d", net_pkt_family(pkt));
-		return 0;
+		return false;
 	}
 
-	net_pkt_cursor_backup(pkt, &backup);
 	net_pkt_cursor_init(pkt);
+	net_pkt_skip(pkt, net_pkt_ip_hdr_len(pkt) - len);
+
+	*sum = calc_chksum(*sum, pkt->cursor.pos, len);
+	net_pkt_skip(pkt, len + net_pkt_ip_opts_len(pkt));
+
+	return true;
+}
+
+u16_t net_calc_chksum(struct net_pkt *pkt, u8_t proto)
+{
+	struct net_pkt_cursor backup;
+	u16_t sum;
+	bool ow;
+
+	net_pkt_cursor_backup(pkt, &backup);
 
 	ow = net_pkt_is_being_overwritten(pkt);
 	net_pkt_set_overwrite(pkt, true);
 
-	net_pkt_skip(pkt, net_pkt_ip_hdr_len(pkt) - len);
+	if (calc_chksum_pseudo_hdr(pkt, proto, &sum)) {
+		sum = pkt_calc_chksum(pkt, sum);
+		sum = (sum == 0U) ? 0xffff : htons(sum);
+		sum = ~sum;
+	}
 
-	sum = calc_chksum(sum, pkt->cursor.pos, len);
-	net_pkt_skip(pkt, len + net_pkt_ip_opts_len(pkt));
+	net_pkt_cursor_restore(pkt, &backup);
 
-	sum = pkt_calc_chksum(pkt, sum);
+	net_pkt_set_overwrite(pkt, ow);
 
-	sum = (sum == 0U) ? 0xffff : htons(sum);
+	return sum;
+}
+
+u16_t net_calc_chksum_partial(struct net_pkt *pkt, u8_t proto)
+{
+	struct net_pkt_cursor backup;
+	u16_t sum;
+	bool ow;
+
+	net_pkt_cursor_backup(pkt, &backup);
+
+	ow = net_pkt_is_being_overwritten(pkt);
+	net_pkt_set_overwrite(pkt, true);
+
+	if (calc_chksum_pseudo_hdr(pkt, proto, &sum)) {
+		sum = htons(sum);
+	}
 
 	net_pkt_cursor_restore(pkt, &backup);
 
 	net_pkt_set_overwrite(pkt, ow);
 
-	return ~sum;
+	return sum;
+}
+
+u16_t net_calc_chksum_tx(struct net_pkt *pkt, u8_t proto)
+{
+	struct net_if *iface = net_pkt_iface(pkt);
+
+	net_pkt_set_chksum_partial(pkt, false);
+
+	if (!net_if_need_calc_tx_checksum(iface)) {
+		return 0U;
+	}
+
+	if (net_if_tx_checksum_partial(iface)) {
+		net_pkt_set_chksum_partial(pkt, true);
+		net_pkt_set_chksum_start(pkt, net_pkt_ip_hdr_len(pkt) +
+					 net_pkt_ip_opts_len(pkt));
+
+		if (proto == IPPROTO_UDP) {
+			net_pkt_set_chksum_offset(
+				pkt, offsetof(struct net_udp_hdr, chksum));
+		} else {
+			net_pkt_set_chksum_offset(
+				pkt, offsetof(struct net_tcp_hdr, chksum));
+		}
+
+		return net_calc_chksum_partial(pkt, proto);
+	}
+
+	if (proto == IPPROTO_UDP) {
+		return net_calc_chksum_udp(pkt);
+	}
+
+	return net_calc_chksum(pkt, proto);
 }
 
 #if defined(CONFIG_NET_IPV4)
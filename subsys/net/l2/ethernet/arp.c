@@ -19,16 +19,28 @@ LOG_MODULE_REGISTER(net_arp, CONFIG_NET_ARP_LOG_LEVEL);
 
 #include "arp.h"
 #include "net_private.h"
+#include "net_stats.h"
+#include "route.h"
 
 #define NET_BUF_TIMEOUT K_MSEC(100)
 #define ARP_REQUEST_TIMEOUT K_SECONDS(2)
+#define ARP_ENTRY_LIFETIME_MS (CONFIG_NET_ARP_ENTRY_LIFETIME * MSEC_PER_SEC)
+
+/* Resolved entries are found through a hash table indexed by interface and
+ * IPv4 address, so that the lookup done for every sent packet does not
+ * depend on the size of the table.
+ */
+#define ARP_HASH_SIZE CONFIG_NET_ARP_TABLE_SIZE
 
 static bool arp_cache_initialized;
 static struct arp_entry arp_entries[CONFIG_NET_ARP_TABLE_SIZE];
 
-static sys_slist_t arp_free_entries;
-static sys_slist_t arp_pending_entries;
-static sys_slist_t arp_table;
+static sys_dlist_t arp_free_entries;
+static sys_dlist_t arp_pending_entries;
+
+/* Resolved entries, the most recently used one first */
+static sys_dlist_t arp_table;
+static sys_slist_t arp_hash[ARP_HASH_SIZE];
 
 struct k_delayed_work arp_request_timer;
 
@@ -50,14 +62,39 @@ static void arp_entry_cleanup(struct arp_entry *entry, bool pending)
 	(void)memset(&entry->eth, 0, sizeof(struct net_eth_addr));
 }
 
-static struct arp_entry *arp_entry_find(sys_slist_t *list,
-					struct net_if *iface,
-					struct in_addr *dst,
-					sys_snode_t **previous)
+static sys_slist_t *arp_hash_bucket(struct net_if *iface,
+				    struct in_addr *dst)
+{
+	u32_t hash = UNALIGNED_GET(&dst->s_addr) ^
+		     (u32_t)((uintptr_t)iface >> 2);
+
+	/* Spread the host part of the address over all the bits */
+	hash *= 0x9e3779b1U;
+
+	return &arp_hash[(hash >> 16) % ARP_HASH_SIZE];
+}
+
+static void arp_table_add(struct arp_entry *entry)
+{
+	sys_dlist_prepend(&arp_table, &entry->node);
+	sys_slist_prepend(arp_hash_bucket(entry->iface, &entry->ip),
+			  &entry->hash_node);
+}
+
+static void arp_table_remove(struct arp_entry *entry)
+{
+	sys_dlist_remove(&entry->node);
+	sys_slist_find_and_remove(arp_hash_bucket(entry->iface, &entry->ip),
+				  &entry->hash_node);
+}
+
+static struct arp_entry *arp_entry_find(struct net_if *iface,
+					struct in_addr *dst)
 {
 	struct arp_entry *entry;
 
-	SYS_SLIST_FOR_EACH_CONTAINER(list, entry, node) {
+	SYS_SLIST_FOR_EACH_CONTAINER(arp_hash_bucket(iface, dst), entry,
+				     hash_node) {
 		NET_DBG("iface %p dst %s",
 			iface, log_strdup(net_sprint_ipv4_addr(&entry->ip)));
 
@@ -65,63 +102,95 @@ static struct arp_entry *arp_entry_find(sys_slist_t *list,
 		    net_ipv4_addr_cmp(&entry->ip, dst)) {
 			return entry;
 		}
-
-		if (previous) {
-			*previous = &entry->node;
-		}
 	}
 
 	return NULL;
 }
 
+static bool arp_entry_expired(struct arp_entry *entry)
+{
+	if (!CONFIG_NET_ARP_ENTRY_LIFETIME) {
+		return false;
+	}
+
+	return (u32_t)(k_uptime_get_32() - entry->req_start) >=
+		ARP_ENTRY_LIFETIME_MS;
+}
+
 static inline struct arp_entry *arp_entry_find_move_first(struct net_if *iface,
 							  struct in_addr *dst)
 {
-	sys_snode_t *prev = NULL;
 	struct arp_entry *entry;
 
 	NET_DBG("dst %s", log_strdup(net_sprint_ipv4_addr(dst)));
 
-	entry = arp_entry_find(&arp_table, iface, dst, &prev);
-	if (entry) {
-		/* Let's assume the target is going to be accessed
-		 * more than once here in a short time frame. So we
-		 * place the entry first in position into the table
-		 * in order to reduce subsequent find.
+	entry = arp_entry_find(iface, dst);
+	if (!entry) {
+		net_stats_update_arp_miss(iface);
+		return NULL;
+	}
+
+	if (arp_entry_expired(entry)) {
+		/* Resolve the address again, the neighbor might have
+		 * changed its link address or left the network.
 		 */
-		if (&entry->node != sys_slist_peek_head(&arp_table)) {
-			sys_slist_remove(&arp_table, prev, &entry->node);
-			sys_slist_prepend(&arp_table, &entry->node);
-		}
+		NET_DBG("Entry %p for %s expired", entry,
+			log_strdup(net_sprint_ipv4_addr(dst)));
+
+		net_stats_update_arp_expire(iface);
+		net_stats_update_arp_miss(iface);
+
+		arp_table_remove(entry);
+		arp_entry_cleanup(entry, false);
+		sys_dlist_append(&arp_free_entries, &entry->node);
+
+		return NULL;
+	}
+
+	net_stats_update_arp_hit(iface);
+
+	/* Keep the table ordered from the most to the least recently used
+	 * entry, the last one is evicted when the table is full.
+	 */
+	if (!sys_dlist_is_head(&arp_table, &entry->node)) {
+		sys_dlist_remove(&entry->node);
+		sys_dlist_prepend(&arp_table, &entry->node);
 	}
 
 	return entry;
 }
 
-static inline
-struct arp_entry *arp_entry_find_pending(struct net_if *iface,
-					 struct in_addr *dst)
+static struct arp_entry *arp_entry_find_pending(struct net_if *iface,
+						struct in_addr *dst)
 {
+	struct arp_entry *entry;
+
 	NET_DBG("dst %s", log_strdup(net_sprint_ipv4_addr(dst)));
 
-	return arp_entry_find(&arp_pending_entries, iface, dst, NULL);
+	SYS_DLIST_FOR_EACH_CONTAINER(&arp_pending_entries, entry, node) {
+		if (entry->iface == iface &&
+		    net_ipv4_addr_cmp(&entry->ip, dst)) {
+			return entry;
+		}
+	}
+
+	return NULL;
 }
 
 static struct arp_entry *arp_entry_get_pending(struct net_if *iface,
 					       struct in_addr *dst)
 {
-	sys_snode_t *prev = NULL;
 	struct arp_entry *entry;
 
 	NET_DBG("dst %s", log_strdup(net_sprint_ipv4_addr(dst)));
 
-	entry = arp_entry_find(&arp_pending_entries, iface, dst, &prev);
+	entry = arp_entry_find_pending(iface, dst);
 	if (entry) {
 		/* We remove the entry from the pending list */
-		sys_slist_remove(&arp_pending_entries, prev, &entry->node);
+		sys_dlist_remove(&entry->node);
 	}
 
-	if (sys_slist_is_empty(&arp_pending_entries)) {
+	if (sys_dlist_is_empty(&arp_pending_entries)) {
 		k_delayed_work_cancel(&arp_request_timer);
 	}
 
@@ -130,35 +199,38 @@ static struct arp_entry *arp_entry_get_pending(struct net_if *iface,
 
 static struct arp_entry *arp_entry_get_free(void)
 {
-	sys_snode_t *node;
+	sys_dnode_t *node;
 
-	node = sys_slist_peek_head(&arp_free_entries);
+	/* We remove the node from the free list */
+	node = sys_dlist_get(&arp_free_entries);
 	if (!node) {
 		return NULL;
 	}
 
-	/* We remove the node from the free list */
-	sys_slist_remove(&arp_free_entries, NULL, node);
-
 	return CONTAINER_OF(node, struct arp_entry, node);
 }
 
 static struct arp_entry *arp_entry_get_last_from_table(void)
 {
-	sys_snode_t *node;
+	struct arp_entry *entry;
+	sys_dnode_t *node;
 
-	/* We assume last entry is the oldest one,
+	/* The last entry is the least recently used one,
 	 * so is the preferred one to be taken out.
 	 */
 
-	node = sys_slist_peek_tail(&arp_table);
+	node = sys_dlist_peek_tail(&arp_table);
 	if (!node) {
 		return NULL;
 	}
 
-	sys_slist_find_and_remove(&arp_table, node);
+	entry = CONTAINER_OF(node, struct arp_entry, node);
 
-	return CONTAINER_OF(node, struct arp_entry, node);
+	net_stats_update_arp_evict(entry->iface);
+
+	arp_table_remove(entry);
+
+	return entry;
 }
 
 
@@ -166,7 +238,7 @@ static void arp_entry_register_pending(struct arp_entry *entry)
 {
 	NET_DBG("dst %s", log_strdup(net_sprint_ipv4_addr(&entry->ip)));
 
-	sys_slist_append(&arp_pending_entries, &entry->node);
+	sys_dlist_append(&arp_pending_entries, &entry->node);
 
 	entry->req_start = k_uptime_get_32();
 
@@ -184,7 +256,7 @@ static void arp_request_timeout(struct k_work *work)
 
 	ARG_UNUSED(work);
 
-	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&arp_pending_entries,
+	SYS_DLIST_FOR_EACH_CONTAINER_SAFE(&arp_pending_entries,
 					  entry, next, node) {
 		if ((s32_t)(entry->req_start +
 			    ARP_REQUEST_TIMEOUT - current) > 0) {
@@ -193,8 +265,8 @@ static void arp_request_timeout(struct k_work *work)
 
 		arp_entry_cleanup(entry, true);
 
-		sys_slist_remove(&arp_pending_entries, NULL, &entry->node);
-		sys_slist_append(&arp_free_entries, &entry->node);
+		sys_dlist_remove(&entry->node);
+		sys_dlist_append(&arp_free_entries, &entry->node);
 
 		entry = NULL;
 	}
@@ -330,7 +402,21 @@ struct net_pkt *net_arp_prepare(struct net_pkt *pkt,
 	if (!current_ip &&
 	    !net_if_ipv4_addr_mask_cmp(net_pkt_iface(pkt), request_ip)) {
 		struct net_if_ipv4 *ipv4 = net_pkt_iface(pkt)->config.ip.ipv4;
+#if defined(CONFIG_NET_ROUTE_IPV4)
+		struct net_route_entry_ipv4 *route;
 
+		/* A route on this interface takes precedence over the
+		 * default gateway.
+		 */
+		route = net_route_ipv4_lookup(net_pkt_iface(pkt), request_ip);
+		if (route) {
+			if (net_ipv4_is_addr_unspecified(&route->gw)) {
+				addr = request_ip;
+			} else {
+				addr = &route->gw;
+			}
+		} else
+#endif
 		if (ipv4) {
 			addr = &ipv4->gw;
 			if (net_ipv4_is_addr_unspecified(addr)) {
@@ -399,10 +485,9 @@ static void arp_gratuitous(struct net_if *iface,
 			   struct in_addr *src,
 			   struct net_eth_addr *hwaddr)
 {
-	sys_snode_t *prev = NULL;
 	struct arp_entry *entry;
 
-	entry = arp_entry_find(&arp_table, iface, src, &prev);
+	entry = arp_entry_find(iface, src);
 	if (entry) {
 		NET_DBG("Gratuitous ARP hwaddr %s -> %s",
 			log_strdup(net_sprint_ll_addr(
@@ -413,6 +498,7 @@ static void arp_gratuitous(struct net_if *iface,
 					   sizeof(struct net_eth_addr))));
 
 		memcpy(&entry->eth, hwaddr, sizeof(struct net_eth_addr));
+		entry->req_start = k_uptime_get_32();
 	}
 }
 
@@ -434,13 +520,13 @@ static void arp_update(struct net_if *iface,
 		}
 
 		if (force) {
-			sys_snode_t *prev = NULL;
 			struct arp_entry *entry;
 
-			entry = arp_entry_find(&arp_table, iface, src, &prev);
+			entry = arp_entry_find(iface, src);
 			if (entry) {
 				memcpy(&entry->eth, hwaddr,
 				       sizeof(struct net_eth_addr));
+				entry->req_start = k_uptime_get_32();
 			} else {
 				/* Add new entry as it was not found and force
 				 * was set.
@@ -456,7 +542,7 @@ static void arp_update(struct net_if *iface,
 					entry->iface = iface;
 					net_ipaddr_copy(&entry->ip, src);
 					memcpy(&entry->eth, hwaddr, sizeof(entry->eth));
-					sys_slist_prepend(&arp_table, &entry->node);
+					arp_table_add(entry);
 				}
 			}
 		}
@@ -477,9 +563,10 @@ static void arp_update(struct net_if *iface,
 	entry->pending = NULL;
 
 	memcpy(&entry->eth, hwaddr, sizeof(struct net_eth_addr));
+	entry->req_start = k_uptime_get_32();
 
 	/* Inserting entry into the table */
-	sys_slist_prepend(&arp_table, &entry->node);
+	arp_table_add(entry);
 
 	net_if_queue_tx(iface, pkt);
 }
@@ -669,41 +756,36 @@ enum net_verdict net_arp_input(struct net_pkt *pkt,
 
 void net_arp_clear_cache(struct net_if *iface)
 {
-	sys_snode_t *prev = NULL;
 	struct arp_entry *entry, *next;
 
 	NET_DBG("Flushing ARP table");
 
-	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&arp_table, entry, next, node) {
+	SYS_DLIST_FOR_EACH_CONTAINER_SAFE(&arp_table, entry, next, node) {
 		if (iface && iface != entry->iface) {
-			prev = &entry->node;
 			continue;
 		}
 
+		arp_table_remove(entry);
 		arp_entry_cleanup(entry, false);
 
-		sys_slist_remove(&arp_table, prev, &entry->node);
-		sys_slist_prepend(&arp_free_entries, &entry->node);
+		sys_dlist_prepend(&arp_free_entries, &entry->node);
 	}
 
-	prev = NULL;
-
 	NET_DBG("Flushing ARP pending requests");
 
-	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&arp_pending_entries,
+	SYS_DLIST_FOR_EACH_CONTAINER_SAFE(&arp_pending_entries,
 					  entry, next, node) {
 		if (iface && iface != entry->iface) {
-			prev = &entry->node;
 			continue;
 		}
 
 		arp_entry_cleanup(entry, true);
 
-		sys_slist_remove(&arp_pending_entries, prev, &entry->node);
-		sys_slist_prepend(&arp_free_entries, &entry->node);
+		sys_dlist_remove(&entry->node);
+		sys_dlist_prepend(&arp_free_entries, &entry->node);
 	}
 
-	if (sys_slist_is_empty(&arp_pending_entries)) {
+	if (sys_dlist_is_empty(&arp_pending_entries)) {
 		k_delayed_work_cancel(&arp_request_timer);
 	}
 }
@@ -713,7 +795,7 @@ int net_arp_foreach(net_arp_cb_t cb, void *user_data)
 	int ret = 0;
 	struct arp_entry *entry;
 
-	SYS_SLIST_FOR_EACH_CONTAINER(&arp_table, entry, node) {
+	SYS_DLIST_FOR_EACH_CONTAINER(&arp_table, entry, node) {
 		ret++;
 		cb(entry, user_data);
 	}
@@ -729,13 +811,17 @@ void net_arp_init(void)
 		return;
 	}
 
-	sys_slist_init(&arp_free_entries);
-	sys_slist_init(&arp_pending_entries);
-	sys_slist_init(&arp_table);
+	sys_dlist_init(&arp_free_entries);
+	sys_dlist_init(&arp_pending_entries);
+	sys_dlist_init(&arp_table);
+
+	for (i = 0; i < ARP_HASH_SIZE; i++) {
+		sys_slist_init(&arp_hash[i]);
+	}
 
 	for (i = 0; i < CONFIG_NET_ARP_TABLE_SIZE; i++) {
 		/* Inserting entry as free */
-		sys_slist_prepend(&arp_free_entries, &arp_entries[i].node);
+		sys_dlist_prepend(&arp_free_entries, &arp_entries[i].node);
 	}
 
 	k_delayed_work_init(&arp_request_timer, arp_request_timeout);
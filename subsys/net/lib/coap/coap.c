@@ -217,7 +217,7 @@ static int encode_option(struct coap_packet *cpkt, u16_t code,
 		if (!res) {
 			return -EINVAL;
 		}
-	} else if (delta_size == 2U) {
+	} else if (len_size == 2U) {
 		res = append_be16(cpkt, len_ext);
 		if (!res) {
 			return -EINVAL;
@@ -234,6 +234,43 @@ static int encode_option(struct coap_packet *cpkt, u16_t code,
 	return  (1 + delta_size + len_size + len);
 }
 
+static void option_index_add(struct coap_packet *cpkt, u16_t num,
+			     u16_t offset, u16_t len)
+{
+#if defined(CONFIG_COAP_OPTION_INDEX)
+	struct coap_option_ref *ref;
+
+	if (cpkt->opt_count >= ARRAY_SIZE(cpkt->opt_index)) {
+		cpkt->opt_index_full = true;
+		return;
+	}
+
+	ref = &cpkt->opt_index[cpkt->opt_count++];
+	ref->num = num;
+	ref->offset = offset;
+	ref->len = len;
+#endif
+}
+
+static void option_index_shift(struct coap_packet *cpkt, int diff)
+{
+#if defined(CONFIG_COAP_OPTION_INDEX)
+	u8_t i;
+
+	for (i = 0U; i < cpkt->opt_count; i++) {
+		cpkt->opt_index[i].offset += diff;
+	}
+#endif
+}
+
+static void option_index_reset(struct coap_packet *cpkt)
+{
+#if defined(CONFIG_COAP_OPTION_INDEX)
+	cpkt->opt_count = 0U;
+	cpkt->opt_index_full = false;
+#endif
+}
+
 /* TODO Add support for inserting options in proper place
  * and modify other option's delta accordingly.
  */
@@ -268,6 +305,8 @@ int coap_packet_append_option(struct coap_packet *cpkt, u16_t code,
 	cpkt->opt_len += r;
 	cpkt->delta += code;
 
+	option_index_add(cpkt, cpkt->delta, cpkt->offset - len, len);
+
 	return 0;
 }
 
@@ -330,6 +369,42 @@ int coap_packet_append_payload(struct coap_packet *cpkt, u8_t *payload,
 	return append(cpkt, payload, payload_len) ? 0 : -EINVAL;
 }
 
+int coap_packet_update_header(struct coap_packet *cpkt, u8_t type,
+			      u8_t tokenlen, const u8_t *token, u16_t id)
+{
+	int diff;
+
+	if (!cpkt || !cpkt->data || cpkt->hdr_len < BASIC_HEADER_SIZE ||
+	    tokenlen > 8 || (tokenlen && !token)) {
+		return -EINVAL;
+	}
+
+	diff = BASIC_HEADER_SIZE + tokenlen - cpkt->hdr_len;
+	if (diff) {
+		if (diff > cpkt->max_len - cpkt->offset) {
+			return -EINVAL;
+		}
+
+		memmove(cpkt->data + BASIC_HEADER_SIZE + tokenlen,
+			cpkt->data + cpkt->hdr_len,
+			cpkt->offset - cpkt->hdr_len);
+
+		cpkt->hdr_len += diff;
+		cpkt->offset += diff;
+		option_index_shift(cpkt, diff);
+	}
+
+	cpkt->data[0] = (cpkt->data[0] & 0xC0) | ((type & 0x3) << 4) |
+			tokenlen;
+	sys_put_be16(id, &cpkt->data[2]);
+
+	if (tokenlen) {
+		memcpy(cpkt->data + BASIC_HEADER_SIZE, token, tokenlen);
+	}
+
+	return 0;
+}
+
 u8_t *coap_next_token(void)
 {
 	static u32_t rand[2];
@@ -427,9 +502,13 @@ static int decode_delta(u8_t *data, u16_t offset, u16_t *pos, u16_t max_len,
 	return ret;
 }
 
+/* Decode the option at offset. If ref is given, it is set to the
+ * location of the option value, its offset is left to 0 if the payload
+ * marker was found instead.
+ */
 static int parse_option(u8_t *data, u16_t offset, u16_t *pos,
 			u16_t max_len, u16_t *opt_delta, u16_t *opt_len,
-			struct coap_option *option)
+			struct coap_option *option, struct coap_option_ref *ref)
 {
 	u16_t hdr_len;
 	u16_t delta;
@@ -486,6 +565,12 @@ static int parse_option(u8_t *data, u16_t offset, u16_t *pos,
 	*opt_delta += delta;
 	*opt_len += len;
 
+	if (ref) {
+		ref->num = *opt_delta;
+		ref->offset = *pos;
+		ref->len = len;
+	}
+
 	if (r == 0) {
 		if (len == 0U) {
 			return r;
@@ -554,6 +639,7 @@ int coap_packet_parse(struct coap_packet *cpkt, u8_t *data, u16_t len,
 	cpkt->opt_len = 0U;
 	cpkt->hdr_len = 0U;
 	cpkt->delta = 0U;
+	option_index_reset(cpkt);
 
 	/* Token lengths 9-15 are reserved. */
 	tkl = cpkt->data[0] & 0x0f;
@@ -577,14 +663,21 @@ int coap_packet_parse(struct coap_packet *cpkt, u8_t *data, u16_t len,
 	num = 0U;
 
 	while (1) {
+		struct coap_option_ref ref = { 0 };
 		struct coap_option *option;
 
 		option = num < opt_num ? &options[num++] : NULL;
 		ret = parse_option(cpkt->data, offset, &offset, cpkt->max_len,
-				   &delta, &opt_len, option);
+				   &delta, &opt_len, option, &ref);
 		if (ret < 0) {
 			return ret;
-		} else if (ret == 0) {
+		}
+
+		if (ref.offset) {
+			option_index_add(cpkt, ref.num, ref.offset, ref.len);
+		}
+
+		if (ret == 0) {
 			break;
 		}
 	}
@@ -596,6 +689,44 @@ int coap_packet_parse(struct coap_packet *cpkt, u8_t *data, u16_t len,
 	return 0;
 }
 
+#if defined(CONFIG_COAP_OPTION_INDEX)
+static int find_indexed_options(const struct coap_packet *cpkt, u16_t code,
+				struct coap_option *options, u16_t veclen)
+{
+	const struct coap_option_ref *ref;
+	u8_t low = 0U;
+	u8_t high = cpkt->opt_count;
+	u16_t num = 0U;
+
+	/* Find the first option with this number */
+	while (low < high) {
+		u8_t mid = (low + high) / 2U;
+
+		if (cpkt->opt_index[mid].num < code) {
+			low = mid + 1U;
+		} else {
+			high = mid;
+		}
+	}
+
+	for (ref = &cpkt->opt_index[low];
+	     ref < &cpkt->opt_index[cpkt->opt_count] && ref->num == code &&
+	     num < veclen; ref++, num++) {
+		if (ref->len > sizeof(options[num].value)) {
+			NET_ERR("%u is > sizeof(coap_option->value)(%zu)!",
+				ref->len, sizeof(options[num].value));
+			return -EINVAL;
+		}
+
+		options[num].delta = code;
+		options[num].len = ref->len;
+		memcpy(options[num].value, cpkt->data + ref->offset, ref->len);
+	}
+
+	return num;
+}
+#endif /* CONFIG_COAP_OPTION_INDEX */
+
 int coap_find_options(const struct coap_packet *cpkt, u16_t code,
 		      struct coap_option *options, u16_t veclen)
 {
@@ -605,6 +736,12 @@ int coap_find_options(const struct coap_packet *cpkt, u16_t code,
 	u8_t num;
 	int r;
 
+#if defined(CONFIG_COAP_OPTION_INDEX)
+	if (!cpkt->opt_index_full) {
+		return find_indexed_options(cpkt, code, options, veclen);
+	}
+#endif
+
 	offset = cpkt->hdr_len;
 	opt_len = 0U;
 	delta = 0U;
@@ -613,7 +750,7 @@ int coap_find_options(const struct coap_packet *cpkt, u16_t code,
 	while (delta <= code && num < veclen) {
 		r = parse_option(cpkt->data, offset, &offset,
 				 cpkt->max_len, &delta, &opt_len,
-				 &options[num]);
+				 &options[num], NULL);
 		if (r < 0) {
 			return -EINVAL;
 		}
@@ -1157,17 +1294,31 @@ struct coap_pending *coap_pending_next_to_expire(
 	struct coap_pending *pendings, size_t len)
 {
 	struct coap_pending *p, *found = NULL;
+	s32_t remaining, min_remaining = 0;
 	size_t i;
 
 	for (i = 0, p = pendings; i < len; i++, p++) {
-		if (p->timeout && (!found || found->timeout < p->timeout)) {
+		if (!p->timeout) {
+			continue;
+		}
+
+		remaining = coap_pending_remaining(p);
+		if (!found || remaining < min_remaining) {
 			found = p;
+			min_remaining = remaining;
 		}
 	}
 
 	return found;
 }
 
+s32_t coap_pending_remaining(const struct coap_pending *pending)
+{
+	s32_t elapsed = (s32_t)(k_uptime_get_32() - pending->t0);
+
+	return MAX(pending->timeout - elapsed, 0);
+}
+
 /* TODO: random generated initial ACK timeout
  * ACK_TIMEOUT < INIT_ACK_TIMEOUT < ACK_TIMEOUT * ACK_RANDOM_FACTOR
  * where ACK_TIMEOUT = 2 and ACK_RANDOM_FACTOR = 1.5 by default
@@ -1195,6 +1346,7 @@ bool coap_pending_cycle(struct coap_pending *pending)
 {
 	s32_t old = pending->timeout;
 
+	pending->t0 = k_uptime_get_32();
 	pending->timeout = next_timeout(pending->timeout);
 
 	return (old != pending->timeout);
@@ -1315,6 +1467,40 @@ int coap_resource_notify(struct coap_resource *resource)
 	return 0;
 }
 
+int coap_resource_notify_packet(struct coap_resource *resource,
+				struct coap_packet *cpkt,
+				coap_notify_send_t send, void *user_data)
+{
+	struct coap_observer *o;
+	u8_t type;
+	int count = 0;
+	int r;
+
+	if (!resource || !cpkt || !send) {
+		return -EINVAL;
+	}
+
+	type = coap_header_get_type(cpkt);
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&resource->observers, o, list) {
+		r = coap_packet_update_header(cpkt, type, o->tkl, o->token,
+					      coap_next_id());
+		if (r < 0) {
+			return r;
+		}
+
+		r = send(resource, o, cpkt, user_data);
+		if (r < 0) {
+			NET_DBG("Cannot notify observer %p (%d)", o, r);
+			continue;
+		}
+
+		count++;
+	}
+
+	return count;
+}
+
 bool coap_request_is_observe(const struct coap_packet *request)
 {
 	return get_observe_option(request) == 0;
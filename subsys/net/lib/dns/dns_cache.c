@@ -0,0 +1,315 @@
+/** @file
+ * @brief DNS answer cache
+ *
+ * Answers of the DNS servers are cached by name and query type until
+ * their TTL expires. Negative answers are cached too, so that names that
+ * do not resolve are not queried again and again.
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_DECLARE(net_dns_resolve, CONFIG_DNS_RESOLVER_LOG_LEVEL);
+
+#include <zephyr.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <sys/dlist.h>
+
+#include <net/net_ip.h>
+#include <net/dns_resolve.h>
+
+#include "dns_cache.h"
+
+#define MAX_ADDRESSES CONFIG_DNS_RESOLVER_CACHE_MAX_ADDRESSES
+
+struct dns_cache_entry {
+	/** Node in the free list or in the cache list */
+	sys_dnode_t node;
+
+	/** Cached addresses */
+	struct sockaddr addr[MAX_ADDRESSES];
+
+	/** Uptime in ms when the answer expires */
+	s64_t expires;
+
+	/** TTL of the answer in ms, used for the prefetch threshold */
+	u32_t ttl;
+
+	/** Query type */
+	enum dns_query_type type;
+
+	/** Number of addresses, 0 for a negative answer */
+	u8_t count;
+
+	/** Status of a negative answer */
+	s8_t status;
+
+	/** A query refreshing this answer is pending */
+	bool prefetching;
+
+	/** Host name */
+	char name[CONFIG_DNS_RESOLVER_CACHE_NAME_LEN];
+};
+
+static struct dns_cache_entry dns_cache[CONFIG_DNS_RESOLVER_CACHE_SIZE];
+
+/* Most recently used entry first */
+static sys_dlist_t dns_cache_list = SYS_DLIST_STATIC_INIT(&dns_cache_list);
+static sys_dlist_t dns_cache_free = SYS_DLIST_STATIC_INIT(&dns_cache_free);
+static bool dns_cache_initialized;
+
+static K_MUTEX_DEFINE(dns_cache_lock);
+
+static void dns_cache_init(void)
+{
+	int i;
+
+	if (dns_cache_initialized) {
+		return;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(dns_cache); i++) {
+		sys_dlist_append(&dns_cache_free, &dns_cache[i].node);
+	}
+
+	dns_cache_initialized = true;
+}
+
+static void dns_cache_release(struct dns_cache_entry *entry)
+{
+	sys_dlist_remove(&entry->node);
+	sys_dlist_append(&dns_cache_free, &entry->node);
+}
+
+/* Expired entries are released while searching */
+static struct dns_cache_entry *dns_cache_lookup(const char *name,
+						enum dns_query_type type,
+						s64_t now)
+{
+	struct dns_cache_entry *entry, *next;
+
+	SYS_DLIST_FOR_EACH_CONTAINER_SAFE(&dns_cache_list, entry, next, node) {
+		if (entry->expires <= now) {
+			dns_cache_release(entry);
+			continue;
+		}
+
+		if (entry->type == type &&
+		    !strncasecmp(entry->name, name, sizeof(entry->name))) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/* Get the entry of a name, or a new one. A new entry is taken from the
+ * free list, or the least recently used one is replaced. Entries that are
+ * being prefetched are not reused, even if flushed or expired, as their
+ * name is the name of the pending query.
+ */
+static struct dns_cache_entry *dns_cache_get(const char *name,
+					     enum dns_query_type type,
+					     s64_t now)
+{
+	struct dns_cache_entry *entry;
+	sys_dnode_t *node;
+
+	if (strlen(name) >= sizeof(entry->name)) {
+		return NULL;
+	}
+
+	dns_cache_init();
+
+	entry = dns_cache_lookup(name, type, now);
+	if (entry) {
+		sys_dlist_remove(&entry->node);
+		goto found;
+	}
+
+	SYS_DLIST_FOR_EACH_CONTAINER(&dns_cache_free, entry, node) {
+		if (!entry->prefetching) {
+			sys_dlist_remove(&entry->node);
+			goto new_entry;
+		}
+	}
+
+	for (node = sys_dlist_peek_tail(&dns_cache_list); node;
+	     node = sys_dlist_peek_prev(&dns_cache_list, node)) {
+		entry = CONTAINER_OF(node, struct dns_cache_entry, node);
+		if (!entry->prefetching) {
+			break;
+		}
+	}
+
+	if (!node) {
+		return NULL;
+	}
+
+	NET_DBG("Replacing %s", log_strdup(entry->name));
+
+	sys_dlist_remove(&entry->node);
+
+new_entry:
+	strncpy(entry->name, name, sizeof(entry->name) - 1);
+	entry->name[sizeof(entry->name) - 1] = '\0';
+
+	entry->type = type;
+
+found:
+	sys_dlist_prepend(&dns_cache_list, &entry->node);
+
+	return entry;
+}
+
+int dns_cache_find(const char *name, enum dns_query_type type,
+		   struct dns_cache_result *result)
+{
+	struct dns_cache_entry *entry;
+	s64_t now = k_uptime_get();
+	int ret = -ENOENT;
+
+	k_mutex_lock(&dns_cache_lock, K_FOREVER);
+
+	entry = dns_cache_lookup(name, type, now);
+	if (!entry) {
+		goto out;
+	}
+
+	sys_dlist_remove(&entry->node);
+	sys_dlist_prepend(&dns_cache_list, &entry->node);
+
+	memcpy(result->addr, entry->addr,
+	       entry->count * sizeof(struct sockaddr));
+	result->count = entry->count;
+	result->status = entry->count ? DNS_EAI_ALLDONE : entry->status;
+	result->prefetch = NULL;
+
+	if (CONFIG_DNS_RESOLVER_CACHE_PREFETCH > 0 && entry->count &&
+	    !entry->prefetching &&
+	    (u64_t)(entry->expires - now) * 100U <
+	    (u64_t)entry->ttl * CONFIG_DNS_RESOLVER_CACHE_PREFETCH) {
+		entry->prefetching = true;
+		result->prefetch = entry->name;
+	}
+
+	ret = 0;
+
+out:
+	k_mutex_unlock(&dns_cache_lock);
+
+	NET_DBG("%s type %d %s", log_strdup(name), type,
+		ret ? "miss" : "hit");
+
+	return ret;
+}
+
+void dns_cache_add(const char *name, enum dns_query_type type,
+		   const struct sockaddr *addr, int count, u32_t ttl)
+{
+	struct dns_cache_entry *entry;
+	s64_t now = k_uptime_get();
+
+	ttl = MIN(ttl, CONFIG_DNS_RESOLVER_CACHE_MAX_TTL);
+	if (!ttl || count <= 0) {
+		return;
+	}
+
+	k_mutex_lock(&dns_cache_lock, K_FOREVER);
+
+	entry = dns_cache_get(name, type, now);
+	if (entry) {
+		entry->count = MIN(count, MAX_ADDRESSES);
+		memcpy(entry->addr, addr,
+		       entry->count * sizeof(struct sockaddr));
+		entry->ttl = ttl * MSEC_PER_SEC;
+		entry->expires = now + entry->ttl;
+	}
+
+	k_mutex_unlock(&dns_cache_lock);
+}
+
+void dns_cache_add_negative(const char *name, enum dns_query_type type,
+			    int status)
+{
+	struct dns_cache_entry *entry;
+	s64_t now = k_uptime_get();
+
+	if (CONFIG_DNS_RESOLVER_CACHE_NEGATIVE_TTL == 0) {
+		return;
+	}
+
+	k_mutex_lock(&dns_cache_lock, K_FOREVER);
+
+	entry = dns_cache_get(name, type, now);
+	if (entry) {
+		entry->count = 0U;
+		entry->status = status;
+		entry->ttl = CONFIG_DNS_RESOLVER_CACHE_NEGATIVE_TTL *
+			MSEC_PER_SEC;
+		entry->expires = now + entry->ttl;
+	}
+
+	k_mutex_unlock(&dns_cache_lock);
+}
+
+void dns_cache_prefetch_done(const char *name)
+{
+	int i;
+
+	k_mutex_lock(&dns_cache_lock, K_FOREVER);
+
+	for (i = 0; i < ARRAY_SIZE(dns_cache); i++) {
+		if (dns_cache[i].name == name) {
+			dns_cache[i].prefetching = false;
+			break;
+		}
+	}
+
+	k_mutex_unlock(&dns_cache_lock);
+}
+
+void dns_cache_foreach(dns_cache_cb_t cb, void *user_data)
+{
+	struct dns_cache_entry *entry;
+	struct dns_cache_info info;
+	s64_t now = k_uptime_get();
+
+	k_mutex_lock(&dns_cache_lock, K_FOREVER);
+
+	SYS_DLIST_FOR_EACH_CONTAINER(&dns_cache_list, entry, node) {
+		if (entry->expires <= now) {
+			continue;
+		}
+
+		info.name = entry->name;
+		info.addr = entry->count ? entry->addr : NULL;
+		info.count = entry->count;
+		info.status = entry->count ? DNS_EAI_ALLDONE : entry->status;
+		info.query_type = entry->type;
+		info.ttl = (u32_t)((entry->expires - now) / MSEC_PER_SEC);
+
+		cb(&info, user_data);
+	}
+
+	k_mutex_unlock(&dns_cache_lock);
+}
+
+void dns_cache_flush(void)
+{
+	struct dns_cache_entry *entry, *next;
+
+	k_mutex_lock(&dns_cache_lock, K_FOREVER);
+
+	SYS_DLIST_FOR_EACH_CONTAINER_SAFE(&dns_cache_list, entry, next, node) {
+		dns_cache_release(entry);
+	}
+
+	k_mutex_unlock(&dns_cache_lock);
+}
@@ -0,0 +1,81 @@
+/** @file
+ * @brief DNS answer cache used by the resolver
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _DNS_CACHE_H_
+#define _DNS_CACHE_H_
+
+#include <zephyr/types.h>
+#include <net/net_ip.h>
+#include <net/dns_resolve.h>
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+
+struct dns_cache_result {
+	/** Cached addresses */
+	struct sockaddr addr[CONFIG_DNS_RESOLVER_CACHE_MAX_ADDRESSES];
+
+	/** Number of cached addresses */
+	int count;
+
+	/** Final status to pass to the resolve callback */
+	int status;
+
+	/** If set, the answer is about to expire and the caller should
+	 * query this name again. The name stays valid until
+	 * dns_cache_prefetch_done() is called for it.
+	 */
+	const char *prefetch;
+};
+
+/**
+ * @brief Find an unexpired answer from the cache.
+ *
+ * @param name Host name
+ * @param type Query type
+ * @param result Cached answer is copied here
+ *
+ * @return 0 if found, -ENOENT otherwise.
+ */
+int dns_cache_find(const char *name, enum dns_query_type type,
+		   struct dns_cache_result *result);
+
+/**
+ * @brief Store the addresses of an answer in the cache.
+ *
+ * @param name Host name
+ * @param type Query type
+ * @param addr Addresses of the answer
+ * @param count Number of addresses, only the first
+ * CONFIG_DNS_RESOLVER_CACHE_MAX_ADDRESSES are stored.
+ * @param ttl Smallest TTL of the answer records, in seconds
+ */
+void dns_cache_add(const char *name, enum dns_query_type type,
+		   const struct sockaddr *addr, int count, u32_t ttl);
+
+/**
+ * @brief Store a negative answer in the cache.
+ *
+ * @param name Host name
+ * @param type Query type
+ * @param status DNS_EAI_NONAME or DNS_EAI_NODATA
+ */
+void dns_cache_add_negative(const char *name, enum dns_query_type type,
+			    int status);
+
+/**
+ * @brief Mark the prefetch of a name finished.
+ *
+ * @param name The name returned in dns_cache_result.prefetch
+ */
+void dns_cache_prefetch_done(const char *name);
+
+#endif /* CONFIG_DNS_RESOLVER_CACHE */
+
+#endif /* _DNS_CACHE_H_ */
@@ -24,6 +24,7 @@ LOG_MODULE_REGISTER(net_dns_resolve, CONFIG_DNS_RESOLVER_LOG_LEVEL);
 #include <net/net_mgmt.h>
 #include <net/dns_resolve.h>
 #include "dns_pack.h"
+#include "dns_cache.h"
 
 #define DNS_SERVER_COUNT CONFIG_DNS_RESOLVER_MAX_SERVERS
 #define SERVER_COUNT     (DNS_SERVER_COUNT + DNS_MAX_MCAST_SERVERS)
@@ -359,6 +360,47 @@ static inline int get_slot_by_id(struct dns_resolve_context *ctx,
 	return -ENOENT;
 }
 
+/* A response without answer records is a negative answer: either the name
+ * does not exist, or it has no addresses of the queried type (RFC 2308).
+ */
+static int dns_read_negative(struct dns_resolve_context *ctx,
+			     struct dns_msg_t *dns_msg,
+			     u16_t dns_id,
+			     u16_t *query_hash)
+{
+	const char *query_name;
+	int query_idx;
+	int status;
+
+	if (dns_header_qdcount(dns_msg->msg) != 1 ||
+	    dns_unpack_response_query(dns_msg) < 0) {
+		return DNS_EAI_FAIL;
+	}
+
+	query_name = dns_msg->msg + dns_msg->query_offset;
+
+	/* Add \0 and query type (A or AAAA) to the hash */
+	*query_hash = crc16_ansi(query_name, strlen(query_name) + 1 + 2);
+
+	if (dns_header_rcode(dns_msg->msg) == DNS_HEADER_NAMEERROR) {
+		status = DNS_EAI_NONAME;
+	} else {
+		status = DNS_EAI_NODATA;
+	}
+
+	query_idx = get_slot_by_id(ctx, dns_id, *query_hash);
+	if (query_idx < 0) {
+		return DNS_EAI_SYSTEM;
+	}
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	dns_cache_add_negative(ctx->queries[query_idx].query,
+			       ctx->queries[query_idx].query_type, status);
+#endif
+
+	return status;
+}
+
 static int dns_read(struct dns_resolve_context *ctx,
 		    struct net_pkt *pkt,
 		    struct net_buf *dns_data,
@@ -370,6 +412,10 @@ static int dns_read(struct dns_resolve_context *ctx,
 	/* Helper struct to track the dns msg received from the server */
 	struct dns_msg_t dns_msg;
 	u32_t ttl; /* RR ttl, so far it is not passed to caller */
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	struct sockaddr cache_addr[CONFIG_DNS_RESOLVER_CACHE_MAX_ADDRESSES];
+	u32_t cache_ttl = UINT32_MAX;
+#endif
 	u8_t *src, *addr;
 	const char *query_name;
 	int address_size;
@@ -406,6 +452,15 @@ static int dns_read(struct dns_resolve_context *ctx,
 		goto quit;
 	}
 
+	/* mDNS responders do not send negative answers */
+	if (*dns_id > 0 && dns_header_qr(dns_msg.msg) == DNS_RESPONSE &&
+	    dns_header_ancount(dns_msg.msg) == 0 &&
+	    (dns_header_rcode(dns_msg.msg) == DNS_HEADER_NOERROR ||
+	     dns_header_rcode(dns_msg.msg) == DNS_HEADER_NAMEERROR)) {
+		ret = dns_read_negative(ctx, &dns_msg, *dns_id, query_hash);
+		goto quit;
+	}
+
 	ret = dns_unpack_response_header(&dns_msg, *dns_id);
 	if (ret < 0) {
 		ret = DNS_EAI_FAIL;
@@ -468,6 +523,7 @@ static int dns_read(struct dns_resolve_context *ctx,
 				goto quit;
 			}
 
+		query_known:
 			if (ctx->queries[query_idx].query_type ==
 							DNS_QUERY_TYPE_A) {
 				if (net_sin(&info.ai_addr)->sin_family ==
@@ -521,7 +577,15 @@ static int dns_read(struct dns_resolve_context *ctx,
 			src = dns_msg.msg + dns_msg.response_position;
 			memcpy(addr, src, address_size);
 
-		query_known:
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+			if (items < ARRAY_SIZE(cache_addr)) {
+				memcpy(&cache_addr[items], &info.ai_addr,
+				       sizeof(info.ai_addr));
+			}
+
+			cache_ttl = MIN(cache_ttl, ttl);
+#endif
+
 			ctx->queries[query_idx].cb(DNS_EAI_INPROGRESS, &info,
 					ctx->queries[query_idx].user_data);
 			items++;
@@ -584,6 +648,12 @@ static int dns_read(struct dns_resolve_context *ctx,
 		ret = DNS_EAI_NODATA;
 	} else {
 		ret = DNS_EAI_ALLDONE;
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+		dns_cache_add(ctx->queries[query_idx].query,
+			      ctx->queries[query_idx].query_type,
+			      cache_addr, items, cache_ttl);
+#endif
 	}
 
 	if (k_delayed_work_remaining_get(&ctx->queries[query_idx].timer) > 0) {
@@ -880,13 +950,82 @@ static void query_timeout(struct k_work *work)
 					   pending_query->query);
 }
 
-int dns_resolve_name(struct dns_resolve_context *ctx,
-		     const char *query,
-		     enum dns_query_type type,
-		     u16_t *dns_id,
-		     dns_resolve_cb_t cb,
-		     void *user_data,
-		     s32_t timeout)
+static int dns_resolve_name_internal(struct dns_resolve_context *ctx,
+				     const char *query,
+				     enum dns_query_type type,
+				     u16_t *dns_id,
+				     dns_resolve_cb_t cb,
+				     void *user_data,
+				     s32_t timeout,
+				     bool use_cache);
+
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+static void prefetch_cb(enum dns_resolve_status status,
+			struct dns_addrinfo *info,
+			void *user_data)
+{
+	/* The answer was cached already when it was received */
+	if (!info) {
+		dns_cache_prefetch_done(user_data);
+	}
+}
+
+static int dns_resolve_from_cache(struct dns_resolve_context *ctx,
+				  const char *query,
+				  enum dns_query_type type,
+				  dns_resolve_cb_t cb,
+				  void *user_data,
+				  s32_t timeout)
+{
+	struct dns_cache_result result;
+	struct dns_addrinfo info = { 0 };
+	int i;
+
+	if (dns_cache_find(query, type, &result) < 0) {
+		return -ENOENT;
+	}
+
+	for (i = 0; i < result.count; i++) {
+		memcpy(&info.ai_addr, &result.addr[i], sizeof(info.ai_addr));
+		info.ai_family = info.ai_addr.sa_family;
+
+		if (info.ai_family == AF_INET) {
+			info.ai_addrlen = sizeof(struct sockaddr_in);
+		} else {
+			info.ai_addrlen = sizeof(struct sockaddr_in6);
+		}
+
+		cb(DNS_EAI_INPROGRESS, &info, user_data);
+	}
+
+	cb(result.status, NULL, user_data);
+
+	/* Refresh the answer before it expires so that the callers keep
+	 * getting it from the cache.
+	 */
+	if (result.prefetch) {
+		NET_DBG("Prefetching %s", log_strdup(result.prefetch));
+
+		if (dns_resolve_name_internal(ctx, result.prefetch, type, NULL,
+					      prefetch_cb,
+					      (void *)result.prefetch,
+					      timeout, false) < 0) {
+			dns_cache_prefetch_done(result.prefetch);
+		}
+	}
+
+	return 0;
+}
+#endif /* CONFIG_DNS_RESOLVER_CACHE */
+
+static int dns_resolve_name_internal(struct dns_resolve_context *ctx,
+				     const char *query,
+				     enum dns_query_type type,
+				     u16_t *dns_id,
+				     dns_resolve_cb_t cb,
+				     void *user_data,
+				     s32_t timeout,
+				     bool use_cache)
 {
 	struct net_buf *dns_data = NULL;
 	struct net_buf *dns_qname = NULL;
@@ -953,10 +1092,20 @@ int dns_resolve_name(struct dns_resolve_context *ctx,
 		cb(DNS_EAI_INPROGRESS, &info, user_data);
 		cb(DNS_EAI_ALLDONE, NULL, user_data);
 
-		return 0;
+		return DNS_RESOLVE_DONE;
 	}
 
 try_resolve:
+#if defined(CONFIG_DNS_RESOLVER_CACHE)
+	if (use_cache && !dns_resolve_from_cache(ctx, query, type, cb,
+						 user_data, timeout)) {
+		/* Reported through the callback as a query would be, the
+		 * query id is left alone as no query was sent.
+		 */
+		return 0;
+	}
+#endif
+
 	i = get_cb_slot(ctx);
 	if (i < 0) {
 		return -EAGAIN;
@@ -1093,6 +1242,18 @@ quit:
 	return ret;
 }
 
+int dns_resolve_name(struct dns_resolve_context *ctx,
+		     const char *query,
+		     enum dns_query_type type,
+		     u16_t *dns_id,
+		     dns_resolve_cb_t cb,
+		     void *user_data,
+		     s32_t timeout)
+{
+	return dns_resolve_name_internal(ctx, query, type, dns_id, cb,
+					 user_data, timeout, true);
+}
+
 int dns_resolve_close(struct dns_resolve_context *ctx)
 {
 	int i;
@@ -1124,6 +1285,9 @@ int dns_resolve_close(struct dns_resolve_context *ctx)
 
 	ctx->is_used = false;
 
+	/* The answers might not be valid for the next set of servers */
+	dns_cache_flush();
+
 	return 0;
 }
 
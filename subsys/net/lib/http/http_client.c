@@ -27,8 +27,17 @@ LOG_MODULE_REGISTER(net_http, CONFIG_NET_HTTP_LOG_LEVEL);
 #include "net_private.h"
 
 #define HTTP_CONTENT_LEN_SIZE 6
+#define HTTP_CHUNK_LEN_SIZE 10
 #define MAX_SEND_BUF_LEN 192
 
+/* Data received after the end of a response, which belongs to the next
+ * pipelined response.
+ */
+struct http_leftover {
+	const u8_t *data;
+	size_t len;
+};
+
 static ssize_t sendall(int sock, const void *buf, size_t len)
 {
 	while (len) {
@@ -45,6 +54,39 @@ static ssize_t sendall(int sock, const void *buf, size_t len)
 	return 0;
 }
 
+static int sendmsg_all(int sock, struct iovec *iov, int iovcnt)
+{
+	struct msghdr msg = {
+		.msg_iov = iov,
+		.msg_iovlen = iovcnt,
+	};
+	ssize_t out_len;
+
+	while (msg.msg_iovlen) {
+		out_len = sendmsg(sock, &msg, 0);
+		if (out_len < 0) {
+			return -errno;
+		}
+
+		/* Skip what was sent, a partial send can end in the middle
+		 * of a vector.
+		 */
+		while (msg.msg_iovlen && out_len >= msg.msg_iov->iov_len) {
+			out_len -= msg.msg_iov->iov_len;
+			msg.msg_iov++;
+			msg.msg_iovlen--;
+		}
+
+		if (msg.msg_iovlen) {
+			msg.msg_iov->iov_base =
+				(u8_t *)msg.msg_iov->iov_base + out_len;
+			msg.msg_iov->iov_len -= out_len;
+		}
+	}
+
+	return 0;
+}
+
 static int http_send_data(int sock, char *send_buf,
 			  size_t send_buf_max_len, size_t *send_buf_pos,
 			  ...)
@@ -254,6 +296,11 @@ static int on_body(struct http_parser *parser, const char *at, size_t length)
 	req->internal.response.body_found = 1;
 	req->internal.response.processed += length;
 
+	/* Count the data up to the end of this body part */
+	req->internal.response.data_len += (const u8_t *)at + length -
+					   req->internal.parse_start;
+	req->internal.parse_start = (const u8_t *)at + length;
+
 	NET_DBG("Processed %zd length %zd", req->internal.response.processed,
 		length);
 
@@ -262,6 +309,19 @@ static int on_body(struct http_parser *parser, const char *at, size_t length)
 		req->internal.response.http_cb->on_body(parser, at, length);
 	}
 
+	if (req->body_cb) {
+		/* The body is given as is from the receive buffer */
+		if (req->body_cb(req, (const u8_t *)at, length,
+				 req->internal.user_data) < 0) {
+			NET_DBG("Body callback aborted the response");
+			return -ECANCELED;
+		}
+
+		req->internal.response.data_len = 0;
+
+		return 0;
+	}
+
 	if (!req->internal.response.body_start &&
 	    (u8_t *)at != (u8_t *)req->internal.response.recv_buf) {
 		req->internal.response.body_start = (u8_t *)at;
@@ -358,11 +418,10 @@ static int on_message_complete(struct http_parser *parser)
 
 	req->internal.response.message_complete = 1;
 
-	if (req->internal.response.cb) {
-		req->internal.response.cb(&req->internal.response,
-					  HTTP_DATA_FINAL,
-					  req->internal.user_data);
-	}
+	/* Stop the parsing at the end of the response so that the data
+	 * after it is left for the next pipelined response.
+	 */
+	http_parser_pause(parser, 1);
 
 	return 0;
 }
@@ -412,19 +471,51 @@ static void http_client_init_parser(struct http_parser *parser,
 	settings->on_url = on_url;
 }
 
-static int http_wait_data(int sock, struct http_request *req)
+static int http_wait_data(int sock, struct http_request *req,
+			  struct http_leftover *leftover)
 {
 	int total_received = 0;
 	size_t offset = 0;
+	size_t pending = 0;
 	int received, ret;
+	size_t parsed = 0;
+	u8_t *data;
+
+	if (leftover && leftover->len) {
+		/* The beginning of the response was received with the
+		 * previous one.
+		 */
+		if (leftover->len > req->internal.response.recv_buf_len) {
+			return -EMSGSIZE;
+		}
+
+		memmove(req->internal.response.recv_buf, leftover->data,
+			leftover->len);
+		pending = leftover->len;
+		leftover->len = 0;
+	}
 
 	do {
-		received = recv(sock, req->internal.response.recv_buf + offset,
-				req->internal.response.recv_buf_len - offset,
-				0);
+		data = req->internal.response.recv_buf + offset;
+
+		if (pending) {
+			received = pending;
+			pending = 0;
+		} else {
+			received = recv(sock, data,
+					req->internal.response.recv_buf_len -
+					offset, 0);
+		}
+
 		if (received == 0) {
-			/* Connection closed */
+			/* Connection closed, which also ends a response that
+			 * has no length.
+			 */
 			LOG_DBG("Connection closed");
+			(void)http_parser_execute(
+				&req->internal.parser,
+				&req->internal.parser_settings,
+				NULL, 0);
 			ret = total_received;
 			break;
 		} else if (received < 0) {
@@ -433,16 +524,31 @@ static int http_wait_data(int sock, struct http_request *req)
 			ret = -errno;
 			break;
 		} else {
-			req->internal.response.data_len += received;
+			req->internal.parse_start = data;
 
-			(void)http_parser_execute(
+			parsed = http_parser_execute(
 				&req->internal.parser,
 				&req->internal.parser_settings,
-				req->internal.response.recv_buf + offset,
-				received);
+				data, received);
+
+			/* The parser pauses at the end of the response, the
+			 * bytes past it belong to the next pipelined one.
+			 */
+			req->internal.response.data_len += data + parsed -
+						req->internal.parse_start;
+
+			if (HTTP_PARSER_ERRNO(&req->internal.parser) != HPE_OK &&
+			    HTTP_PARSER_ERRNO(&req->internal.parser) !=
+								HPE_PAUSED) {
+				LOG_DBG("HTTP parser error %s",
+					http_errno_name(HTTP_PARSER_ERRNO(
+						&req->internal.parser)));
+				ret = -EBADMSG;
+				break;
+			}
 		}
 
-		total_received += received;
+		total_received += parsed;
 		offset += received;
 
 		if (offset >= req->internal.response.recv_buf_len) {
@@ -450,12 +556,25 @@ static int http_wait_data(int sock, struct http_request *req)
 		}
 
 		if (req->internal.response.message_complete) {
+			if (leftover) {
+				leftover->data = data + parsed;
+				leftover->len = received - parsed;
+			}
+
 			ret = total_received;
 			break;
 		}
 
 	} while (true);
 
+	/* Given once the data of the response is fully counted */
+	if (req->internal.response.message_complete &&
+	    req->internal.response.cb) {
+		req->internal.response.cb(&req->internal.response,
+					  HTTP_DATA_FINAL,
+					  req->internal.user_data);
+	}
+
 	return ret;
 }
 
@@ -465,24 +584,62 @@ static void http_timeout(struct k_work *work)
 		CONTAINER_OF(work, struct http_client_internal_data, work);
 
 	(void)close(data->sock);
+
+	/* Tell the owner of the socket that it is closed */
+	data->sock = -1;
+
+	k_sem_give(&data->work_done);
 }
 
-int http_client_req(int sock, struct http_request *req,
-		    s32_t timeout, void *user_data)
+static int http_send_chunks(int sock, struct http_request *req,
+			    void *user_data)
 {
-	/* Utilize the network usage by sending data in bigger blocks */
-	char send_buf[MAX_SEND_BUF_LEN];
-	const size_t send_buf_max_len = sizeof(send_buf);
-	size_t send_buf_pos = 0;
+	char chunk_len_str[HTTP_CHUNK_LEN_SIZE + sizeof(HTTP_CRLF)];
+	struct iovec iov[3];
 	int total_sent = 0;
-	int ret, total_recv, i;
-	const char *method;
+	const u8_t *data;
+	int ret, len;
 
-	if (sock < 0 || req == NULL || req->response == NULL ||
-	    req->recv_buf == NULL || req->recv_buf_len == 0) {
-		return -EINVAL;
-	}
+	do {
+		data = NULL;
+
+		len = req->chunk_cb(req, &data, user_data);
+		if (len < 0) {
+			return len;
+		}
+
+		if (len > 0 && data == NULL) {
+			return -EINVAL;
+		}
+
+		/* The chunk is sent with its framing in one go, the last
+		 * chunk has no data and is followed by an empty trailer.
+		 */
+		ret = snprintk(chunk_len_str, sizeof(chunk_len_str), "%x%s",
+			       len, HTTP_CRLF);
+
+		iov[0].iov_base = chunk_len_str;
+		iov[0].iov_len = ret;
+		iov[1].iov_base = (void *)data;
+		iov[1].iov_len = len;
+		iov[2].iov_base = (void *)HTTP_CRLF;
+		iov[2].iov_len = sizeof(HTTP_CRLF) - 1;
 
+		ret = sendmsg_all(sock, iov, ARRAY_SIZE(iov));
+		if (ret < 0) {
+			NET_DBG("Cannot send chunk of %d bytes (%d)", len, ret);
+			return ret;
+		}
+
+		total_sent += iov[0].iov_len + len + iov[2].iov_len;
+	} while (len > 0);
+
+	return total_sent;
+}
+
+static void http_client_prepare(int sock, struct http_request *req,
+				s32_t timeout, void *user_data)
+{
 	memset(&req->internal.response, 0, sizeof(req->internal.response));
 
 	req->internal.response.http_cb = req->http_cb;
@@ -492,6 +649,24 @@ int http_client_req(int sock, struct http_request *req,
 	req->internal.user_data = user_data;
 	req->internal.timeout = timeout;
 	req->internal.sock = sock;
+}
+
+static bool http_client_req_valid(int sock, struct http_request *req)
+{
+	return sock >= 0 && req != NULL && req->response != NULL &&
+		req->recv_buf != NULL && req->recv_buf_len != 0;
+}
+
+static int http_send_request(int sock, struct http_request *req,
+			     void *user_data)
+{
+	/* Utilize the network usage by sending data in bigger blocks */
+	char send_buf[MAX_SEND_BUF_LEN];
+	const size_t send_buf_max_len = sizeof(send_buf);
+	size_t send_buf_pos = 0;
+	int total_sent = 0;
+	int ret, i;
+	const char *method;
 
 	method = http_method_str(req->method);
 
@@ -585,6 +760,29 @@ int http_client_req(int sock, struct http_request *req,
 			goto out;
 		}
 
+		total_sent += ret;
+	} else if (req->chunk_cb) {
+		ret = http_send_data(sock, send_buf, send_buf_max_len,
+				     &send_buf_pos, "Transfer-Encoding", ": ",
+				     "chunked", HTTP_CRLF, HTTP_CRLF, NULL);
+		if (ret < 0) {
+			goto out;
+		}
+
+		total_sent += ret;
+
+		ret = http_flush_data(sock, send_buf, send_buf_pos);
+		if (ret < 0) {
+			goto out;
+		}
+
+		send_buf_pos = 0;
+
+		ret = http_send_chunks(sock, req, user_data);
+		if (ret < 0) {
+			goto out;
+		}
+
 		total_sent += ret;
 	} else if (req->payload) {
 		char content_len_str[HTTP_CONTENT_LEN_SIZE];
@@ -632,28 +830,123 @@ int http_client_req(int sock, struct http_request *req,
 
 	NET_DBG("Sent %d bytes", total_sent);
 
+	return total_sent;
+
+out:
+	return ret;
+}
+
+static int http_recv_response(int sock, struct http_request *req,
+			      struct http_leftover *leftover)
+{
+	s32_t timeout = req->internal.timeout;
+	int total_recv;
+
 	http_client_init_parser(&req->internal.parser,
 				&req->internal.parser_settings);
 
 	if (timeout != K_FOREVER && timeout != K_NO_WAIT) {
+		k_sem_init(&req->internal.work_done, 0, 1);
 		k_delayed_work_init(&req->internal.work, http_timeout);
 		(void)k_delayed_work_submit(&req->internal.work, timeout);
 	}
 
-	/* Request is sent, now wait data to be received */
-	total_recv = http_wait_data(sock, req);
+	total_recv = http_wait_data(sock, req, leftover);
 	if (total_recv < 0) {
 		NET_DBG("Wait data failure (%d)", total_recv);
 	} else {
 		NET_DBG("Received %d bytes", total_recv);
 	}
 
-	if (timeout != K_FOREVER && timeout != K_NO_WAIT) {
-		(void)k_delayed_work_cancel(&req->internal.work);
+	if (timeout != K_FOREVER && timeout != K_NO_WAIT &&
+	    k_delayed_work_cancel(&req->internal.work) != 0) {
+		/* The timeout handler runs or has run already. Wait until it
+		 * is done with the socket, which could otherwise be closed
+		 * while the caller already uses it for something else.
+		 */
+		(void)k_sem_take(&req->internal.work_done, K_FOREVER);
+	}
+
+	if (req->internal.sock < 0) {
+		return -ETIMEDOUT;
+	}
+
+	return total_recv;
+}
+
+int http_client_req(int sock, struct http_request *req,
+		    s32_t timeout, void *user_data)
+{
+	int total_sent;
+	int ret;
+
+	if (!http_client_req_valid(sock, req)) {
+		return -EINVAL;
+	}
+
+	http_client_prepare(sock, req, timeout, user_data);
+
+	total_sent = http_send_request(sock, req, user_data);
+	if (total_sent < 0) {
+		return total_sent;
+	}
+
+	/* Request is sent, now wait data to be received */
+	ret = http_recv_response(sock, req, NULL);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (!req->internal.response.message_complete) {
+		/* The connection was closed before the end of the response */
+		return -ECONNRESET;
 	}
 
 	return total_sent;
+}
 
-out:
-	return ret;
+int http_client_req_pipeline(int sock, struct http_request **reqs,
+			     size_t count, s32_t timeout, void *user_data)
+{
+	struct http_leftover leftover = { 0 };
+	int completed = 0;
+	size_t i;
+	int ret;
+
+	for (i = 0; i < count; i++) {
+		if (!http_client_req_valid(sock, reqs[i])) {
+			return -EINVAL;
+		}
+	}
+
+	/* All the requests are sent before the first response is waited
+	 * for, so that the server can process them back to back.
+	 */
+	for (i = 0; i < count; i++) {
+		http_client_prepare(sock, reqs[i], timeout, user_data);
+
+		ret = http_send_request(sock, reqs[i], user_data);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	/* The responses come in the order of the requests. A response can
+	 * begin in the data received for the previous one.
+	 */
+	for (i = 0; i < count; i++) {
+		ret = http_recv_response(sock, reqs[i], &leftover);
+		if (ret < 0 || !reqs[i]->internal.response.message_complete ||
+		    reqs[i]->internal.sock < 0) {
+			break;
+		}
+
+		completed++;
+
+		if (!http_should_keep_alive(&reqs[i]->internal.parser)) {
+			break;
+		}
+	}
+
+	return completed;
 }
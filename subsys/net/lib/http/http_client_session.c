@@ -0,0 +1,306 @@
+/** @file
+ * @brief HTTP client sessions
+ *
+ * Persistent connections shared by the HTTP requests to one server
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_DECLARE(net_http, CONFIG_NET_HTTP_LOG_LEVEL);
+
+#include <kernel.h>
+#include <string.h>
+#include <errno.h>
+#include <stdbool.h>
+
+#include <net/net_ip.h>
+#include <net/socket.h>
+#include <net/http_client.h>
+
+#include "net_private.h"
+
+#define IDLE_TIMEOUT CONFIG_HTTP_CLIENT_SESSION_IDLE_TIMEOUT
+
+static int conn_connect(struct http_client_session *session,
+			struct http_client_conn *conn)
+{
+	int sock, ret;
+
+	sock = socket(session->addr.sa_family, SOCK_STREAM, session->proto);
+	if (sock < 0) {
+		return -errno;
+	}
+
+#if defined(CONFIG_NET_SOCKETS_SOCKOPT_TLS)
+	if (session->sec_tag_list) {
+		ret = setsockopt(sock, SOL_TLS, TLS_SEC_TAG_LIST,
+				 session->sec_tag_list,
+				 session->sec_tag_list_size *
+				 sizeof(sec_tag_t));
+		if (ret < 0) {
+			ret = -errno;
+			goto fail;
+		}
+	}
+
+	if (session->tls_hostname) {
+		ret = setsockopt(sock, SOL_TLS, TLS_HOSTNAME,
+				 session->tls_hostname,
+				 strlen(session->tls_hostname) + 1);
+		if (ret < 0) {
+			ret = -errno;
+			goto fail;
+		}
+	}
+#endif
+
+	ret = connect(sock, &session->addr, session->addrlen);
+	if (ret < 0) {
+		ret = -errno;
+		goto fail;
+	}
+
+	NET_DBG("[%p] New connection (sock %d)", session, sock);
+
+	conn->sock = sock;
+
+	return 0;
+
+fail:
+	NET_DBG("[%p] Cannot connect (%d)", session, ret);
+	(void)close(sock);
+
+	return ret;
+}
+
+static void conn_close(struct http_client_conn *conn)
+{
+	if (conn->sock >= 0) {
+		(void)close(conn->sock);
+		conn->sock = -1;
+	}
+}
+
+/* Take a connection, an idle one is preferred over a new one. The caller
+ * connects the slot if its socket is -1.
+ */
+static struct http_client_conn *conn_get(struct http_client_session *session)
+{
+	struct http_client_conn *conn = NULL;
+	s64_t now = k_uptime_get();
+	int i;
+
+	k_mutex_lock(&session->lock, K_FOREVER);
+
+	for (i = 0; i < ARRAY_SIZE(session->conns); i++) {
+		struct http_client_conn *slot = &session->conns[i];
+
+		if (slot->busy) {
+			continue;
+		}
+
+		/* The server has likely closed a connection idle for long */
+		if (slot->sock >= 0 && now - slot->last_used > IDLE_TIMEOUT) {
+			conn_close(slot);
+		}
+
+		if (slot->sock >= 0) {
+			conn = slot;
+			break;
+		}
+
+		if (!conn) {
+			conn = slot;
+		}
+	}
+
+	if (conn) {
+		conn->busy = true;
+	}
+
+	k_mutex_unlock(&session->lock);
+
+	return conn;
+}
+
+static void conn_put(struct http_client_session *session,
+		     struct http_client_conn *conn, bool keep)
+{
+	k_mutex_lock(&session->lock, K_FOREVER);
+
+	if (keep) {
+		conn->last_used = k_uptime_get();
+	} else {
+		conn_close(conn);
+	}
+
+	conn->busy = false;
+
+	k_mutex_unlock(&session->lock);
+}
+
+/* Can the connection be used for the next request after this one */
+static bool req_keep_alive(struct http_request *req)
+{
+	if (req->internal.sock < 0) {
+		/* Closed by the timeout handler */
+		return false;
+	}
+
+	return req->internal.response.message_complete &&
+		http_should_keep_alive(&req->internal.parser);
+}
+
+/* A request that got no response on a reused connection most likely hit a
+ * connection closed by the server, and it is safe to send it again if the
+ * method is idempotent (RFC 7230 ch 6.3.1).
+ */
+static bool req_can_retry(struct http_request *req)
+{
+	if (req->internal.response.http_status[0] != '\0') {
+		return false;
+	}
+
+	switch (req->method) {
+	case HTTP_GET:
+	case HTTP_HEAD:
+	case HTTP_PUT:
+	case HTTP_DELETE:
+	case HTTP_OPTIONS:
+		return true;
+	default:
+		return false;
+	}
+}
+
+int http_client_session_init(struct http_client_session *session,
+			     const struct sockaddr *addr, socklen_t addrlen,
+			     int proto)
+{
+	int i;
+
+	if (!session || !addr || addrlen > sizeof(session->addr)) {
+		return -EINVAL;
+	}
+
+	memset(session, 0, sizeof(*session));
+
+	memcpy(&session->addr, addr, addrlen);
+	session->addrlen = addrlen;
+	session->proto = proto;
+
+	k_mutex_init(&session->lock);
+
+	for (i = 0; i < ARRAY_SIZE(session->conns); i++) {
+		session->conns[i].sock = -1;
+	}
+
+	return 0;
+}
+
+int http_client_session_req(struct http_client_session *session,
+			    struct http_request *req, s32_t timeout,
+			    void *user_data)
+{
+	struct http_client_conn *conn;
+	bool reused;
+	int ret;
+
+	conn = conn_get(session);
+	if (!conn) {
+		return -EAGAIN;
+	}
+
+	reused = conn->sock >= 0;
+
+	while (true) {
+		if (conn->sock < 0) {
+			ret = conn_connect(session, conn);
+			if (ret < 0) {
+				break;
+			}
+		}
+
+		ret = http_client_req(conn->sock, req, timeout, user_data);
+
+		if (req->internal.sock < 0) {
+			/* The timeout handler closed the socket already */
+			conn->sock = -1;
+		}
+
+		if (reused && req->internal.sock >= 0 &&
+		    req_can_retry(req) && ret < 0) {
+			NET_DBG("[%p] Reused connection failed, retrying",
+				session);
+			conn_close(conn);
+			reused = false;
+			continue;
+		}
+
+		break;
+	}
+
+	conn_put(session, conn, ret >= 0 && req_keep_alive(req));
+
+	return ret;
+}
+
+int http_client_session_pipeline(struct http_client_session *session,
+				 struct http_request **reqs, size_t count,
+				 s32_t timeout, void *user_data)
+{
+	struct http_client_conn *conn;
+	bool keep = false;
+	int ret;
+
+	if (count == 0) {
+		return 0;
+	}
+
+	conn = conn_get(session);
+	if (!conn) {
+		return -EAGAIN;
+	}
+
+	if (conn->sock < 0) {
+		ret = conn_connect(session, conn);
+		if (ret < 0) {
+			goto out;
+		}
+	}
+
+	ret = http_client_req_pipeline(conn->sock, reqs, count, timeout,
+				       user_data);
+
+	/* The connection stays in sync only if all the responses came */
+	if (ret >= 0 && (size_t)ret == count) {
+		keep = req_keep_alive(reqs[count - 1]);
+	} else if (ret >= 0 && reqs[ret]->internal.sock < 0) {
+		conn->sock = -1;
+	}
+
+out:
+	conn_put(session, conn, keep);
+
+	return ret;
+}
+
+void http_client_session_close(struct http_client_session *session)
+{
+	int i;
+
+	k_mutex_lock(&session->lock, K_FOREVER);
+
+	for (i = 0; i < ARRAY_SIZE(session->conns); i++) {
+		if (!session->conns[i].busy) {
+			conn_close(&session->conns[i]);
+		}
+	}
+
+	k_mutex_unlock(&session->lock);
+}
@@ -0,0 +1,1075 @@
+/** @file
+ * @brief HTTP server API
+ *
+ * An API for applications to serve HTTP resources
+ */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_http_server, CONFIG_NET_HTTP_LOG_LEVEL);
+
+#include <kernel.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <stdbool.h>
+
+#include <net/net_ip.h>
+#include <net/socket.h>
+#include <net/http_server.h>
+
+#if defined(CONFIG_HTTP_SERVER_WEBSOCKET)
+#include <sys/base64.h>
+#include <mbedtls/sha1.h>
+#endif
+
+#include "net_private.h"
+
+#define MAX_HEADER_LEN 192
+#define CHUNK_LEN_SIZE 10
+
+#define IDLE_TIMEOUT CONFIG_HTTP_SERVER_IDLE_TIMEOUT
+
+/* The sockets report POLLOUT whether or not they can take more data, so a
+ * connection whose output made no progress is polled again after this
+ * many milliseconds instead of right away.
+ */
+#define SEND_RETRY_TIME 10
+
+#define WS_MAGIC "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define WS_KEY_MAX_LEN 32
+#define WS_SHA1_OUTPUT_LEN 20
+
+/* Outcome of the processing of the received data */
+enum client_state {
+	CLIENT_KEEP = 0,
+	CLIENT_CLOSE,
+	CLIENT_RELEASE,
+	CLIENT_UPGRADE,
+};
+
+/* Header values the server is interested in */
+enum {
+	HEADER_OTHER = 0,
+	HEADER_WS_KEY,
+};
+
+/* Nothing is left to send */
+static inline bool client_out_empty(struct http_server_client *client)
+{
+	return client->out_off == client->out_len && !client->out_data_len;
+}
+
+/* Send what the socket takes without blocking, and queue the rest to be
+ * sent when the socket is writable. The pieces of iov are copied to the
+ * send buffer of the connection, data is constant and only referenced.
+ */
+static int client_send(struct http_server_client *client,
+		       const struct iovec *iov, int iovcnt,
+		       const u8_t *data, size_t data_len)
+{
+	struct iovec vec[4];
+	struct msghdr msg = {
+		.msg_iov = vec,
+	};
+	size_t done = 0;
+	size_t skip, len;
+	ssize_t sent;
+	int i;
+
+	__ASSERT_NO_MSG(iovcnt < ARRAY_SIZE(vec));
+
+	for (i = 0; i < iovcnt; i++) {
+		vec[msg.msg_iovlen++] = iov[i];
+	}
+
+	vec[msg.msg_iovlen].iov_base = (void *)data;
+	vec[msg.msg_iovlen].iov_len = data_len;
+	msg.msg_iovlen++;
+
+	/* Queued output goes first */
+	if (client_out_empty(client)) {
+		sent = sendmsg(client->sock, &msg, MSG_DONTWAIT);
+		if (sent < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				return -errno;
+			}
+		} else {
+			done = sent;
+		}
+	}
+
+	for (i = 0; i < iovcnt; i++) {
+		skip = MIN(done, iov[i].iov_len);
+		done -= skip;
+		len = iov[i].iov_len - skip;
+
+		if (!len) {
+			continue;
+		}
+
+		/* Nothing can be queued after the constant data */
+		if (client->out_data_len ||
+		    len > sizeof(client->out_buf) - client->out_len) {
+			NET_DBG("[%d] Output does not fit in %zd bytes",
+				client->sock, sizeof(client->out_buf));
+			return -ENOBUFS;
+		}
+
+		memcpy(client->out_buf + client->out_len,
+		       (const u8_t *)iov[i].iov_base + skip, len);
+		client->out_len += len;
+	}
+
+	if (done < data_len) {
+		client->out_data = data + done;
+		client->out_data_len = data_len - done;
+	}
+
+	return 0;
+}
+
+/* Send the queued output, returns the number of bytes sent */
+static ssize_t client_flush(struct http_server_client *client)
+{
+	struct iovec iov[2];
+	struct msghdr msg = {
+		.msg_iov = iov,
+	};
+	ssize_t sent;
+	size_t len;
+
+	if (client->out_off < client->out_len) {
+		iov[msg.msg_iovlen].iov_base = client->out_buf +
+			client->out_off;
+		iov[msg.msg_iovlen].iov_len = client->out_len -
+			client->out_off;
+		msg.msg_iovlen++;
+	}
+
+	if (client->out_data_len) {
+		iov[msg.msg_iovlen].iov_base = (void *)client->out_data;
+		iov[msg.msg_iovlen].iov_len = client->out_data_len;
+		msg.msg_iovlen++;
+	}
+
+	sent = sendmsg(client->sock, &msg, MSG_DONTWAIT);
+	if (sent < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return 0;
+		}
+
+		return -errno;
+	}
+
+	len = MIN((size_t)sent, client->out_len - client->out_off);
+	client->out_off += len;
+
+	if (client->out_off == client->out_len) {
+		client->out_off = 0;
+		client->out_len = 0;
+	}
+
+	client->out_data += sent - len;
+	client->out_data_len -= sent - len;
+
+	return sent;
+}
+
+static const char *status_str(int status)
+{
+	switch (status) {
+	case 101:
+		return "Switching Protocols";
+	case 200:
+		return "OK";
+	case 204:
+		return "No Content";
+	case 400:
+		return "Bad Request";
+	case 404:
+		return "Not Found";
+	case 405:
+		return "Method Not Allowed";
+	case 413:
+		return "Payload Too Large";
+	case 500:
+		return "Internal Server Error";
+	case 501:
+		return "Not Implemented";
+	default:
+		break;
+	}
+
+	return "";
+}
+
+static struct http_server_client *client_of(struct http_parser *parser)
+{
+	return CONTAINER_OF(parser, struct http_server_client, parser);
+}
+
+static int on_message_begin(struct http_parser *parser)
+{
+	struct http_server_client *client = client_of(parser);
+
+	memset(&client->req, 0, sizeof(client->req));
+	client->req.client = client;
+	client->field = NULL;
+	client->field_len = 0;
+	client->ws_key = NULL;
+	client->ws_key_len = 0;
+	client->in_value = 0;
+
+	return 0;
+}
+
+/* The whole request is kept in the receive buffer until it is handled, so
+ * the pieces of an element split over several reads are contiguous.
+ */
+static int on_url(struct http_parser *parser, const char *at, size_t length)
+{
+	struct http_server_client *client = client_of(parser);
+
+	if (!client->req.url) {
+		client->req.url = at;
+	}
+
+	client->req.url_len += length;
+
+	return 0;
+}
+
+static int on_header_field(struct http_parser *parser, const char *at,
+			   size_t length)
+{
+	struct http_server_client *client = client_of(parser);
+
+	if (client->in_value || !client->field) {
+		client->field = at;
+		client->field_len = 0;
+		client->in_value = 0;
+	}
+
+	client->field_len += length;
+
+	return 0;
+}
+
+static int on_header_value(struct http_parser *parser, const char *at,
+			   size_t length)
+{
+	struct http_server_client *client = client_of(parser);
+	static const char ws_key[] = "Sec-WebSocket-Key";
+
+	if (!client->in_value) {
+		client->in_value = 1;
+		client->header = HEADER_OTHER;
+
+		if (client->field_len == sizeof(ws_key) - 1 &&
+		    strncasecmp(client->field, ws_key,
+				sizeof(ws_key) - 1) == 0) {
+			client->header = HEADER_WS_KEY;
+			client->ws_key = at;
+		}
+	}
+
+	if (client->header == HEADER_WS_KEY) {
+		client->ws_key_len += length;
+	}
+
+	return 0;
+}
+
+static int on_headers_complete(struct http_parser *parser)
+{
+	struct http_server_client *client = client_of(parser);
+
+	client->req.method = parser->method;
+	client->field = NULL;
+	client->in_value = 0;
+
+	return 0;
+}
+
+static int on_body(struct http_parser *parser, const char *at, size_t length)
+{
+	struct http_server_client *client = client_of(parser);
+	u8_t *end;
+
+	if (!client->req.body) {
+		client->req.body = (const u8_t *)at;
+	}
+
+	/* The chunks of a chunked body are moved over the chunk framing,
+	 * which the parser is done with, so that the body is contiguous.
+	 */
+	end = (u8_t *)client->req.body + client->req.body_len;
+	if ((const char *)end != at) {
+		memmove(end, at, length);
+	}
+
+	client->req.body_len += length;
+
+	return 0;
+}
+
+static int on_message_complete(struct http_parser *parser)
+{
+	struct http_server_client *client = client_of(parser);
+
+	client->complete = 1;
+	client->keep_alive = http_should_keep_alive(parser);
+
+	/* Stop at the end of the request, a pipelined request that follows
+	 * it is parsed once this one is answered.
+	 */
+	http_parser_pause(parser, 1);
+
+	return 0;
+}
+
+static const struct http_parser_settings parser_settings = {
+	.on_message_begin = on_message_begin,
+	.on_url = on_url,
+	.on_header_field = on_header_field,
+	.on_header_value = on_header_value,
+	.on_headers_complete = on_headers_complete,
+	.on_body = on_body,
+	.on_message_complete = on_message_complete,
+};
+
+static void client_reset(struct http_server_client *client)
+{
+	http_parser_init(&client->parser, HTTP_REQUEST);
+
+	memset(&client->req, 0, sizeof(client->req));
+	client->req.client = client;
+	client->complete = 0;
+	client->responding = 0;
+	client->chunked = 0;
+}
+
+/* Informational, 204 and 304 responses end with their headers */
+static bool status_has_body(int status)
+{
+	return status >= 200 && status != 204 && status != 304;
+}
+
+static int build_header(struct http_server_client *client, char *buf,
+			size_t size, int status, const char *content_type,
+			const char *content_encoding, ssize_t content_length)
+{
+	const char *connection = "";
+	int len, ret;
+
+	if (!client->keep_alive) {
+		connection = "Connection: close" HTTP_CRLF;
+	} else if (client->parser.http_minor == 0) {
+		connection = "Connection: keep-alive" HTTP_CRLF;
+	}
+
+	len = snprintk(buf, size, "HTTP/1.1 %d %s" HTTP_CRLF "%s",
+		       status, status_str(status), connection);
+
+	if (content_type && len < (int)size) {
+		len += snprintk(buf + len, size - len,
+				"Content-Type: %s" HTTP_CRLF, content_type);
+	}
+
+	if (content_encoding && len < (int)size) {
+		len += snprintk(buf + len, size - len,
+				"Content-Encoding: %s" HTTP_CRLF,
+				content_encoding);
+	}
+
+	if (len < (int)size) {
+		if (content_length >= 0) {
+			ret = snprintk(buf + len, size - len,
+				       "Content-Length: %zd" HTTP_CRLF HTTP_CRLF,
+				       content_length);
+		} else if (client->chunked) {
+			ret = snprintk(buf + len, size - len,
+				       "Transfer-Encoding: chunked"
+				       HTTP_CRLF HTTP_CRLF);
+		} else {
+			ret = snprintk(buf + len, size - len, HTTP_CRLF);
+		}
+
+		len += ret;
+	}
+
+	if (len >= (int)size) {
+		NET_DBG("Response header does not fit in %zd bytes", size);
+		return -EMSGSIZE;
+	}
+
+	return len;
+}
+
+int http_server_response_begin(struct http_server_client *client, int status,
+			       const char *content_type,
+			       ssize_t content_length)
+{
+	char header[MAX_HEADER_LEN];
+	struct iovec iov;
+	int len;
+
+	if (client->responding) {
+		return -EALREADY;
+	}
+
+	if (!status_has_body(status)) {
+		/* RFC 7230 3.3.2, no Content-Length nor chunks for these */
+		content_length = HTTP_SERVER_CHUNKED;
+	} else if (content_length < 0) {
+		if (client->parser.http_major == 1 &&
+		    client->parser.http_minor == 0) {
+			/* HTTP/1.0 has no chunks, the end of the body is
+			 * the end of the connection.
+			 */
+			client->keep_alive = 0;
+		} else {
+			client->chunked = 1;
+		}
+	}
+
+	len = build_header(client, header, sizeof(header), status,
+			   content_type, NULL, content_length);
+	if (len < 0) {
+		return len;
+	}
+
+	client->responding = 1;
+
+	iov.iov_base = header;
+	iov.iov_len = len;
+
+	return client_send(client, &iov, 1, NULL, 0);
+}
+
+int http_server_response_write(struct http_server_client *client,
+			       const void *data, size_t len)
+{
+	char chunk_len_str[CHUNK_LEN_SIZE + sizeof(HTTP_CRLF)];
+	struct iovec iov[3];
+
+	if (!client->responding) {
+		return -EINVAL;
+	}
+
+	if (len == 0) {
+		/* An empty chunk would end the body */
+		return 0;
+	}
+
+	if (!client->chunked) {
+		iov[0].iov_base = (void *)data;
+		iov[0].iov_len = len;
+
+		return client_send(client, iov, 1, NULL, 0);
+	}
+
+	iov[0].iov_base = chunk_len_str;
+	iov[0].iov_len = snprintk(chunk_len_str, sizeof(chunk_len_str),
+				  "%zx" HTTP_CRLF, len);
+	iov[1].iov_base = (void *)data;
+	iov[1].iov_len = len;
+	iov[2].iov_base = (void *)HTTP_CRLF;
+	iov[2].iov_len = sizeof(HTTP_CRLF) - 1;
+
+	return client_send(client, iov, ARRAY_SIZE(iov), NULL, 0);
+}
+
+int http_server_response_end(struct http_server_client *client)
+{
+	static const char last_chunk[] = "0" HTTP_CRLF HTTP_CRLF;
+	int ret = 0;
+
+	if (!client->responding) {
+		return -EINVAL;
+	}
+
+	if (client->chunked) {
+		ret = client_send(client, NULL, 0, last_chunk,
+				  sizeof(last_chunk) - 1);
+	}
+
+	client->responding = 0;
+	client->chunked = 0;
+
+	return ret;
+}
+
+static int send_status(struct http_server_client *client, int status)
+{
+	if (status >= 400) {
+		client->keep_alive = 0;
+	}
+
+	if (http_server_response_begin(client, status, NULL, 0) < 0) {
+		return -EIO;
+	}
+
+	return http_server_response_end(client);
+}
+
+static int serve_static(struct http_server_client *client,
+			const struct http_server_resource *resource)
+{
+	char header[MAX_HEADER_LEN];
+	struct iovec iov;
+	int len;
+
+	if (client->req.method != HTTP_GET &&
+	    client->req.method != HTTP_HEAD) {
+		return send_status(client, 405);
+	}
+
+	len = build_header(client, header, sizeof(header), 200,
+			   resource->content_type, resource->content_encoding,
+			   resource->data_len);
+	if (len < 0) {
+		return len;
+	}
+
+	/* The header and the data are sent in one go, the data stays where
+	 * it is until it is sent.
+	 */
+	iov.iov_base = header;
+	iov.iov_len = len;
+
+	return client_send(client, &iov, 1, resource->data,
+			   client->req.method == HTTP_HEAD ?
+			   0 : resource->data_len);
+}
+
+static int serve_dynamic(struct http_server_client *client,
+			 const struct http_server_resource *resource)
+{
+	int ret;
+
+	ret = resource->cb(&client->req, resource->user_data);
+	if (ret < 0) {
+		NET_DBG("Resource %s callback failed (%d)", resource->path,
+			ret);
+
+		if (!client->responding) {
+			(void)send_status(client, 500);
+		}
+
+		return ret;
+	}
+
+	if (!client->responding) {
+		return send_status(client, 204);
+	}
+
+	return http_server_response_end(client);
+}
+
+#if defined(CONFIG_HTTP_SERVER_WEBSOCKET)
+/* Give the connection to the websocket resource, once the response to the
+ * upgrade has been sent.
+ */
+static int websocket_handoff(struct http_server_client *client)
+{
+	const struct http_server_resource *resource = client->req.resource;
+	int ret;
+
+	client->upgrading = 0;
+
+	ret = resource->ws_cb(client->sock, &client->req,
+			      resource->user_data);
+	if (ret < 0) {
+		return CLIENT_CLOSE;
+	}
+
+	return CLIENT_RELEASE;
+}
+
+static int serve_websocket(struct http_server_client *client,
+			   const struct http_server_resource *resource)
+{
+	char key_accept[WS_KEY_MAX_LEN + sizeof(WS_MAGIC)];
+	u8_t sha1[WS_SHA1_OUTPUT_LEN];
+	char header[MAX_HEADER_LEN];
+	char accept[32];
+	struct iovec iov;
+	size_t olen;
+	int ret;
+
+	if (!client->parser.upgrade || !client->ws_key ||
+	    client->ws_key_len > WS_KEY_MAX_LEN) {
+		return send_status(client, 400);
+	}
+
+	memcpy(key_accept, client->ws_key, client->ws_key_len);
+	memcpy(key_accept + client->ws_key_len, WS_MAGIC,
+	       sizeof(WS_MAGIC) - 1);
+
+	mbedtls_sha1_ret(key_accept, client->ws_key_len + sizeof(WS_MAGIC) - 1,
+			 sha1);
+
+	ret = base64_encode(accept, sizeof(accept) - 1, &olen, sha1,
+			    sizeof(sha1));
+	if (ret < 0) {
+		return ret;
+	}
+
+	accept[olen] = '\0';
+
+	iov.iov_base = header;
+	iov.iov_len = snprintk(header, sizeof(header),
+			       "HTTP/1.1 101 Switching Protocols" HTTP_CRLF
+			       "Upgrade: websocket" HTTP_CRLF
+			       "Connection: Upgrade" HTTP_CRLF
+			       "Sec-WebSocket-Accept: %s" HTTP_CRLF HTTP_CRLF,
+			       accept);
+
+	ret = client_send(client, &iov, 1, NULL, 0);
+	if (ret < 0) {
+		return ret;
+	}
+
+	client->upgrading = 1;
+
+	if (!client_out_empty(client)) {
+		/* Handed off once the response is out */
+		return CLIENT_UPGRADE;
+	}
+
+	return websocket_handoff(client);
+}
+#else
+static inline int websocket_handoff(struct http_server_client *client)
+{
+	ARG_UNUSED(client);
+
+	return CLIENT_CLOSE;
+}
+
+static int serve_websocket(struct http_server_client *client,
+			   const struct http_server_resource *resource)
+{
+	ARG_UNUSED(resource);
+
+	return send_status(client, 501);
+}
+#endif /* CONFIG_HTTP_SERVER_WEBSOCKET */
+
+static bool path_match(const char *path, const char *url, size_t url_len)
+{
+	size_t len = strlen(path);
+
+	if (len > 0 && path[len - 1] == '*') {
+		return url_len >= len - 1 && strncmp(path, url, len - 1) == 0;
+	}
+
+	return url_len == len && strncmp(path, url, len) == 0;
+}
+
+static const struct http_server_resource *
+find_resource(struct http_server_ctx *ctx, const char *url, size_t url_len)
+{
+	const char *query;
+	size_t i;
+
+	/* The query does not select the resource */
+	query = memchr(url, '?', url_len);
+	if (query) {
+		url_len = query - url;
+	}
+
+	for (i = 0; i < ctx->resources_count; i++) {
+		if (path_match(ctx->resources[i].path, url, url_len)) {
+			return &ctx->resources[i];
+		}
+	}
+
+	return NULL;
+}
+
+static int handle_request(struct http_server_ctx *ctx,
+			  struct http_server_client *client)
+{
+	const struct http_server_resource *resource;
+	int ret;
+
+	NET_DBG("[%d] %s request, url len %zd body len %zd", client->sock,
+		http_method_str(client->req.method), client->req.url_len,
+		client->req.body_len);
+
+	resource = NULL;
+	if (client->req.url) {
+		resource = find_resource(ctx, client->req.url,
+					 client->req.url_len);
+	}
+
+	if (!resource) {
+		ret = send_status(client, 404);
+		goto out;
+	}
+
+	client->req.resource = resource;
+
+	switch (resource->type) {
+	case HTTP_SERVER_RESOURCE_STATIC:
+		ret = serve_static(client, resource);
+		break;
+	case HTTP_SERVER_RESOURCE_DYNAMIC:
+		ret = serve_dynamic(client, resource);
+		break;
+	case HTTP_SERVER_RESOURCE_WEBSOCKET:
+		ret = serve_websocket(client, resource);
+		break;
+	default:
+		ret = send_status(client, 500);
+		break;
+	}
+
+out:
+	if (ret < 0) {
+		return CLIENT_CLOSE;
+	}
+
+	if (ret == CLIENT_RELEASE || ret == CLIENT_UPGRADE) {
+		return ret;
+	}
+
+	/* An upgrade to something else than a websocket is not supported */
+	if (!client->keep_alive || client->parser.upgrade) {
+		return CLIENT_CLOSE;
+	}
+
+	return CLIENT_KEEP;
+}
+
+/* Parse the received data and answer the complete requests in it. A
+ * pipelined request waits until the response to the previous one has been
+ * sent.
+ */
+static int client_process(struct http_server_ctx *ctx,
+			  struct http_server_client *client)
+{
+	enum http_errno err;
+	size_t parsed;
+	int ret;
+
+	while (client->parsed < client->len && client_out_empty(client)) {
+		parsed = http_parser_execute(&client->parser, &parser_settings,
+					     client->buf + client->parsed,
+					     client->len - client->parsed);
+		client->parsed += parsed;
+
+		err = HTTP_PARSER_ERRNO(&client->parser);
+		if (err != HPE_OK && err != HPE_PAUSED) {
+			NET_DBG("[%d] HTTP parser error %s", client->sock,
+				http_errno_name(err));
+			(void)send_status(client, 400);
+			return CLIENT_CLOSE;
+		}
+
+		if (!client->complete) {
+			break;
+		}
+
+		ret = handle_request(ctx, client);
+		if (ret != CLIENT_KEEP) {
+			return ret;
+		}
+
+		/* Move the following request, if any, to the beginning of
+		 * the buffer.
+		 */
+		client->len -= client->parsed;
+		memmove(client->buf, client->buf + client->parsed,
+			client->len);
+		client->parsed = 0;
+
+		client_reset(client);
+	}
+
+	if (client->len == sizeof(client->buf) && client_out_empty(client)) {
+		NET_DBG("[%d] Request does not fit in %zd bytes", client->sock,
+			sizeof(client->buf));
+		(void)send_status(client, 413);
+		return CLIENT_CLOSE;
+	}
+
+	return CLIENT_KEEP;
+}
+
+static int client_recv(struct http_server_ctx *ctx,
+		       struct http_server_client *client)
+{
+	ssize_t len;
+
+	len = recv(client->sock, client->buf + client->len,
+		   sizeof(client->buf) - client->len, MSG_DONTWAIT);
+	if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+		return CLIENT_KEEP;
+	}
+
+	if (len <= 0) {
+		return CLIENT_CLOSE;
+	}
+
+	client->len += len;
+	client->deadline = k_uptime_get() + IDLE_TIMEOUT;
+
+	return client_process(ctx, client);
+}
+
+/* Send the queued output of a writable connection, and carry on with the
+ * connection once it is all sent.
+ */
+static int client_send_ready(struct http_server_ctx *ctx,
+			     struct http_server_client *client)
+{
+	ssize_t sent;
+
+	sent = client_flush(client);
+	if (sent < 0) {
+		return CLIENT_CLOSE;
+	}
+
+	if (sent == 0) {
+		client->send_retry = k_uptime_get() + SEND_RETRY_TIME;
+		return CLIENT_KEEP;
+	}
+
+	client->deadline = k_uptime_get() + IDLE_TIMEOUT;
+
+	if (!client_out_empty(client)) {
+		return CLIENT_KEEP;
+	}
+
+	if (client->closing) {
+		return CLIENT_CLOSE;
+	}
+
+	if (client->upgrading) {
+		return websocket_handoff(client);
+	}
+
+	return client_process(ctx, client);
+}
+
+static void client_accept(struct http_server_ctx *ctx)
+{
+	struct http_server_client *client = NULL;
+	int sock, i;
+
+	sock = accept(ctx->listen_sock, NULL, NULL);
+	if (sock < 0) {
+		NET_DBG("Cannot accept (%d)", -errno);
+		return;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(ctx->clients); i++) {
+		if (ctx->clients[i].sock < 0) {
+			client = &ctx->clients[i];
+			break;
+		}
+	}
+
+	if (!client) {
+		/* Not expected as the listening socket is not polled when
+		 * there is no free slot.
+		 */
+		(void)close(sock);
+		return;
+	}
+
+	client->sock = sock;
+	client->len = 0;
+	client->parsed = 0;
+	client->out_len = 0;
+	client->out_off = 0;
+	client->out_data_len = 0;
+	client->send_retry = 0;
+	client->keep_alive = 1;
+	client->closing = 0;
+	client->upgrading = 0;
+	client->deadline = k_uptime_get() + IDLE_TIMEOUT;
+
+	client_reset(client);
+
+	NET_DBG("[%d] New connection", sock);
+}
+
+static void client_release(struct http_server_client *client, bool do_close)
+{
+	NET_DBG("[%d] Connection %s", client->sock,
+		do_close ? "closed" : "released");
+
+	if (do_close) {
+		(void)close(client->sock);
+	}
+
+	client->sock = -1;
+}
+
+static void client_done(struct http_server_client *client, int state)
+{
+	switch (state) {
+	case CLIENT_CLOSE:
+		if (!client_out_empty(client)) {
+			/* Closed once the last response is out */
+			client->closing = 1;
+			break;
+		}
+
+		client_release(client, true);
+		break;
+	case CLIENT_RELEASE:
+		client_release(client, false);
+		break;
+	default:
+		break;
+	}
+}
+
+int http_server_init(struct http_server_ctx *ctx,
+		     const struct sockaddr *addr, socklen_t addrlen,
+		     const struct http_server_resource *resources,
+		     size_t count)
+{
+	int sock, ret, i;
+
+	if (!ctx || !addr || (!resources && count > 0)) {
+		return -EINVAL;
+	}
+
+	sock = socket(addr->sa_family, SOCK_STREAM, IPPROTO_TCP);
+	if (sock < 0) {
+		return -errno;
+	}
+
+	if (bind(sock, addr, addrlen) < 0 ||
+	    listen(sock, CONFIG_HTTP_SERVER_MAX_CLIENTS) < 0) {
+		ret = -errno;
+		(void)close(sock);
+		return ret;
+	}
+
+	ctx->resources = resources;
+	ctx->resources_count = count;
+	ctx->listen_sock = sock;
+
+	for (i = 0; i < ARRAY_SIZE(ctx->clients); i++) {
+		ctx->clients[i].sock = -1;
+	}
+
+	return 0;
+}
+
+int http_server_run(struct http_server_ctx *ctx)
+{
+	struct pollfd fds[1 + CONFIG_HTTP_SERVER_MAX_CLIENTS];
+	struct http_server_client *polled[CONFIG_HTTP_SERVER_MAX_CLIENTS];
+	struct http_server_client *client;
+	int nfds, nclients, timeout;
+	s64_t now, next;
+	int i, ret;
+
+	while (true) {
+		nfds = 0;
+		nclients = 0;
+		next = 0;
+		now = k_uptime_get();
+
+		/* New connections wait in the backlog while all the client
+		 * slots are in use. A connection with output to send is not
+		 * read from until the output is sent.
+		 */
+		for (i = 0; i < ARRAY_SIZE(ctx->clients); i++) {
+			client = &ctx->clients[i];
+
+			if (client->sock < 0) {
+				continue;
+			}
+
+			fds[1 + nclients].fd = client->sock;
+			fds[1 + nclients].revents = 0;
+
+			if (client_out_empty(client)) {
+				fds[1 + nclients].events = POLLIN;
+			} else if (client->send_retry <= now) {
+				fds[1 + nclients].events = POLLOUT;
+			} else {
+				fds[1 + nclients].events = 0;
+
+				if (!next || client->send_retry < next) {
+					next = client->send_retry;
+				}
+			}
+
+			polled[nclients++] = client;
+
+			if (!next || client->deadline < next) {
+				next = client->deadline;
+			}
+		}
+
+		if (nclients < ARRAY_SIZE(ctx->clients)) {
+			fds[0].fd = ctx->listen_sock;
+		} else {
+			fds[0].fd = -1;
+		}
+
+		fds[0].events = POLLIN;
+		fds[0].revents = 0;
+		nfds = 1 + nclients;
+
+		timeout = -1;
+		if (next) {
+			timeout = MAX(next - now, 0);
+		}
+
+		ret = poll(fds, nfds, timeout);
+		if (ret < 0) {
+			NET_ERR("poll failed (%d)", -errno);
+			return -errno;
+		}
+
+		for (i = 0; i < nclients; i++) {
+			client = polled[i];
+
+			if (!fds[1 + i].revents) {
+				continue;
+			}
+
+			if (client_out_empty(client)) {
+				ret = client_recv(ctx, client);
+			} else {
+				ret = client_send_ready(ctx, client);
+			}
+
+			client_done(client, ret);
+		}
+
+		now = k_uptime_get();
+
+		for (i = 0; i < nclients; i++) {
+			client = polled[i];
+
+			if (client->sock >= 0 && client->deadline <= now) {
+				NET_DBG("[%d] Idle timeout", client->sock);
+				client_release(client, true);
+			}
+		}
+
+		if (fds[0].revents & POLLIN) {
+			client_accept(ctx);
+		}
+	}
+
+	return 0;
+}
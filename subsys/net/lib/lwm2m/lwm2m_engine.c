@@ -35,6 +35,7 @@ LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 #include <net/net_ip.h>
 #include <net/http_parser_url.h>
 #include <net/socket.h>
+#include <sys/fdtable.h>
 #if defined(CONFIG_LWM2M_DTLS_SUPPORT)
 #include <net/tls_credentials.h>
 #endif
@@ -55,6 +56,17 @@ LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 
 #define ENGINE_UPDATE_INTERVAL K_MSEC(500)
 
+#if !defined(CONFIG_NET_SOCKETS_OFFLOAD)
+/* The engine thread polls a descriptor of its own with the sockets, which
+ * other threads make readable to wake it up. Offloaded sockets cannot be
+ * polled with it, the thread then wakes up at ENGINE_UPDATE_INTERVAL.
+ */
+#define ENGINE_WAKEUP_FD
+#endif
+
+/* No observer or service is due */
+#define NO_DEADLINE INT64_MAX
+
 #define WELL_KNOWN_CORE_PATH	"</.well-known/core>"
 
 /*
@@ -127,14 +139,44 @@ static sys_slist_t engine_obj_inst_list;
 static sys_slist_t engine_observer_list;
 static sys_slist_t engine_service_list;
 
+/* Objects and object instances sorted by id for lookups */
+struct engine_index_entry {
+	u32_t key;
+	void *ref;
+};
+
+struct engine_index {
+	struct engine_index_entry entries[CONFIG_LWM2M_ENGINE_INDEX_SIZE];
+	u16_t count;
+	/* Some references did not fit, the lookups walk the list */
+	bool full;
+};
+
+static struct engine_index engine_obj_index;
+static struct engine_index engine_obj_inst_index;
+
+#define OBJ_INST_KEY(obj_id, obj_inst_id) \
+	(((u32_t)(obj_id) << 16) + (u32_t)(obj_inst_id))
+
 static K_THREAD_STACK_DEFINE(engine_thread_stack,
 			      CONFIG_LWM2M_ENGINE_STACK_SIZE);
 static struct k_thread engine_thread_data;
 
+#if defined(ENGINE_WAKEUP_FD)
+/* The last poll() entry, sock_fds[MAX_POLL_FD], is the wakeup descriptor */
+#define MAX_POLL_FD		(CONFIG_NET_SOCKETS_POLL_MAX - 1)
+
+static struct k_poll_signal engine_wakeup_signal;
+static int engine_wakeup_fd = -1;
+#else
 #define MAX_POLL_FD		CONFIG_NET_SOCKETS_POLL_MAX
+#endif
 
+/* The sockets keep their slot until deleted, free slots have a -1 fd and
+ * are skipped by poll().
+ */
 static struct lwm2m_ctx *sock_ctx[MAX_POLL_FD];
-static struct pollfd sock_fds[MAX_POLL_FD];
+static struct pollfd sock_fds[MAX_POLL_FD + 1];
 static int sock_nfds;
 
 #define NUM_BLOCK1_CONTEXT	CONFIG_LWM2M_NUM_BLOCK1_CONTEXT
@@ -358,6 +400,14 @@ static int update_attrs(void *ref, struct notification_attrs *out)
 	return 0;
 }
 
+/* Have the engine thread compute its next deadline again */
+static void engine_wakeup(void)
+{
+#if defined(ENGINE_WAKEUP_FD)
+	k_poll_signal_raise(&engine_wakeup_signal, 0);
+#endif
+}
+
 static void clear_attrs(void *ref)
 {
 	int i;
@@ -391,6 +441,11 @@ int lwm2m_notify_observer(u16_t obj_id, u16_t obj_inst_id, u16_t res_id)
 		}
 	}
 
+	/* The observers can be due before the engine wakes up */
+	if (ret > 0) {
+		engine_wakeup();
+	}
+
 	return ret;
 }
 
@@ -601,23 +656,126 @@ static void engine_remove_observer_by_id(u16_t obj_id, s32_t obj_inst_id)
 	}
 }
 
+/* engine index */
+
+/* Position of the first entry with a key not lower than the given one */
+static int index_lower_bound(const struct engine_index *index, u32_t key)
+{
+	int low = 0;
+	int high = index->count;
+	int mid;
+
+	while (low < high) {
+		mid = (low + high) / 2;
+		if (index->entries[mid].key < key) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	return low;
+}
+
+static void index_add(struct engine_index *index, u32_t key, void *ref)
+{
+	int pos;
+
+	if (index->count == ARRAY_SIZE(index->entries)) {
+		index->full = true;
+		return;
+	}
+
+	pos = index_lower_bound(index, key);
+	memmove(&index->entries[pos + 1], &index->entries[pos],
+		(index->count - pos) * sizeof(index->entries[0]));
+
+	index->entries[pos].key = key;
+	index->entries[pos].ref = ref;
+	index->count++;
+}
+
+static void index_remove(struct engine_index *index, u32_t key)
+{
+	int pos;
+
+	pos = index_lower_bound(index, key);
+	if (pos == index->count || index->entries[pos].key != key) {
+		return;
+	}
+
+	index->count--;
+	memmove(&index->entries[pos], &index->entries[pos + 1],
+		(index->count - pos) * sizeof(index->entries[0]));
+}
+
+static void *index_find(const struct engine_index *index, u32_t key)
+{
+	int pos;
+
+	pos = index_lower_bound(index, key);
+	if (pos == index->count || index->entries[pos].key != key) {
+		return NULL;
+	}
+
+	return index->entries[pos].ref;
+}
+
+static void obj_index_rebuild(void)
+{
+	struct lwm2m_engine_obj *obj;
+
+	(void)memset(&engine_obj_index, 0, sizeof(engine_obj_index));
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&engine_obj_list, obj, node) {
+		index_add(&engine_obj_index, obj->obj_id, obj);
+	}
+}
+
+static void obj_inst_index_rebuild(void)
+{
+	struct lwm2m_engine_obj_inst *obj_inst;
+
+	(void)memset(&engine_obj_inst_index, 0,
+		     sizeof(engine_obj_inst_index));
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&engine_obj_inst_list, obj_inst, node) {
+		index_add(&engine_obj_inst_index,
+			  OBJ_INST_KEY(obj_inst->obj->obj_id,
+				       obj_inst->obj_inst_id),
+			  obj_inst);
+	}
+}
+
 /* engine object */
 
 void lwm2m_register_obj(struct lwm2m_engine_obj *obj)
 {
 	sys_slist_append(&engine_obj_list, &obj->node);
+	index_add(&engine_obj_index, obj->obj_id, obj);
 }
 
 void lwm2m_unregister_obj(struct lwm2m_engine_obj *obj)
 {
 	engine_remove_observer_by_id(obj->obj_id, -1);
 	sys_slist_find_and_remove(&engine_obj_list, &obj->node);
+
+	/* The objects left out of the index may fit now */
+	if (engine_obj_index.full) {
+		obj_index_rebuild();
+	} else {
+		index_remove(&engine_obj_index, obj->obj_id);
+	}
 }
 
 static struct lwm2m_engine_obj *get_engine_obj(int obj_id)
 {
 	struct lwm2m_engine_obj *obj;
 
+	if (!engine_obj_index.full) {
+		return index_find(&engine_obj_index, obj_id);
+	}
+
 	SYS_SLIST_FOR_EACH_CONTAINER(&engine_obj_list, obj, node) {
 		if (obj->obj_id == obj_id) {
 			return obj;
@@ -648,6 +806,9 @@ lwm2m_get_engine_obj_field(struct lwm2m_engine_obj *obj, int res_id)
 static void engine_register_obj_inst(struct lwm2m_engine_obj_inst *obj_inst)
 {
 	sys_slist_append(&engine_obj_inst_list, &obj_inst->node);
+	index_add(&engine_obj_inst_index,
+		  OBJ_INST_KEY(obj_inst->obj->obj_id, obj_inst->obj_inst_id),
+		  obj_inst);
 }
 
 static void engine_unregister_obj_inst(struct lwm2m_engine_obj_inst *obj_inst)
@@ -655,6 +816,15 @@ static void engine_unregister_obj_inst(struct lwm2m_engine_obj_inst *obj_inst)
 	engine_remove_observer_by_id(
 			obj_inst->obj->obj_id, obj_inst->obj_inst_id);
 	sys_slist_find_and_remove(&engine_obj_inst_list, &obj_inst->node);
+
+	/* The instances left out of the index may fit now */
+	if (engine_obj_inst_index.full) {
+		obj_inst_index_rebuild();
+	} else {
+		index_remove(&engine_obj_inst_index,
+			     OBJ_INST_KEY(obj_inst->obj->obj_id,
+					  obj_inst->obj_inst_id));
+	}
 }
 
 static struct lwm2m_engine_obj_inst *get_engine_obj_inst(int obj_id,
@@ -662,6 +832,11 @@ static struct lwm2m_engine_obj_inst *get_engine_obj_inst(int obj_id,
 {
 	struct lwm2m_engine_obj_inst *obj_inst;
 
+	if (!engine_obj_inst_index.full) {
+		return index_find(&engine_obj_inst_index,
+				  OBJ_INST_KEY(obj_id, obj_inst_id));
+	}
+
 	SYS_SLIST_FOR_EACH_CONTAINER(&engine_obj_inst_list, obj_inst,
 				     node) {
 		if (obj_inst->obj->obj_id == obj_id &&
@@ -677,6 +852,20 @@ static struct lwm2m_engine_obj_inst *
 next_engine_obj_inst(int obj_id, int obj_inst_id)
 {
 	struct lwm2m_engine_obj_inst *obj_inst, *next = NULL;
+	int pos;
+
+	if (!engine_obj_inst_index.full) {
+		/* Instances of an object follow each other in the index */
+		pos = index_lower_bound(&engine_obj_inst_index,
+					OBJ_INST_KEY(obj_id, obj_inst_id + 1));
+		if (pos == engine_obj_inst_index.count) {
+			return NULL;
+		}
+
+		next = engine_obj_inst_index.entries[pos].ref;
+
+		return next->obj->obj_id == obj_id ? next : NULL;
+	}
 
 	SYS_SLIST_FOR_EACH_CONTAINER(&engine_obj_inst_list, obj_inst,
 				     node) {
@@ -1015,6 +1204,23 @@ cleanup:
 	return r;
 }
 
+/* A single timer handles the retransmissions of all the pending requests
+ * of a context, it is armed for the one expiring first.
+ */
+static void retransmit_work_schedule(struct lwm2m_ctx *client_ctx)
+{
+	struct coap_pending *pending;
+
+	pending = coap_pending_next_to_expire(client_ctx->pendings,
+					      CONFIG_LWM2M_ENGINE_MAX_PENDING);
+	if (!pending) {
+		return;
+	}
+
+	k_delayed_work_submit(&client_ctx->retransmit_work,
+			      coap_pending_remaining(pending));
+}
+
 int lwm2m_send_message(struct lwm2m_message *msg)
 {
 	if (!msg || !msg->ctx) {
@@ -1042,8 +1248,8 @@ int lwm2m_send_message(struct lwm2m_message *msg)
 			return 0;
 		}
 
-		k_delayed_work_submit(&msg->ctx->retransmit_work,
-				      msg->pending->timeout);
+		/* Other requests might expire before this one */
+		retransmit_work_schedule(msg->ctx);
 	} else {
 		lwm2m_reset_message(msg, true);
 	}
@@ -3717,40 +3923,44 @@ static void retransmit_request(struct k_work *work)
 	struct coap_pending *pending;
 
 	client_ctx = CONTAINER_OF(work, struct lwm2m_ctx, retransmit_work);
-	pending = coap_pending_next_to_expire(client_ctx->pendings,
-					      CONFIG_LWM2M_ENGINE_MAX_PENDING);
-	if (!pending) {
-		return;
-	}
-
-	msg = find_msg(pending, NULL);
-	if (!msg) {
-		LOG_ERR("pending has no valid LwM2M message!");
-		return;
-	}
 
-	if (!coap_pending_cycle(pending)) {
-		/* pending request has expired */
-		if (msg->message_timeout_cb) {
-			msg->message_timeout_cb(msg);
+	/* Several requests might have expired at the same time */
+	while ((pending = coap_pending_next_to_expire(
+				client_ctx->pendings,
+				CONFIG_LWM2M_ENGINE_MAX_PENDING)) &&
+	       !coap_pending_remaining(pending)) {
+		msg = find_msg(pending, NULL);
+		if (!msg) {
+			LOG_ERR("pending has no valid LwM2M message!");
+			coap_pending_clear(pending);
+			continue;
 		}
 
-		/*
-		 * coap_pending_clear() is called in lwm2m_reset_message()
-		 * which balances the ref we made in coap_pending_cycle()
-		 */
-		lwm2m_reset_message(msg, true);
-		return;
-	}
+		if (!coap_pending_cycle(pending)) {
+			/* pending request has expired */
+			if (msg->message_timeout_cb) {
+				msg->message_timeout_cb(msg);
+			}
 
-	LOG_INF("Resending message: %p", msg);
-	msg->send_attempts++;
-	if (send(msg->ctx->sock_fd, msg->cpkt.data, msg->cpkt.offset, 0) < 0) {
-		LOG_ERR("Error sending lwm2m message: %d", -errno);
-		/* don't error here, retry until timeout */
+			/*
+			 * coap_pending_clear() is called in
+			 * lwm2m_reset_message() which balances the ref we
+			 * made in coap_pending_cycle()
+			 */
+			lwm2m_reset_message(msg, true);
+			continue;
+		}
+
+		LOG_INF("Resending message: %p", msg);
+		msg->send_attempts++;
+		if (send(msg->ctx->sock_fd, msg->cpkt.data, msg->cpkt.offset,
+			 0) < 0) {
+			LOG_ERR("Error sending lwm2m message: %d", -errno);
+			/* don't error here, retry until timeout */
+		}
 	}
 
-	k_delayed_work_submit(&client_ctx->retransmit_work, pending->timeout);
+	retransmit_work_schedule(client_ctx);
 }
 
 static int notify_message_reply_cb(const struct coap_packet *response,
@@ -3872,29 +4082,55 @@ cleanup:
 	return ret;
 }
 
-s32_t engine_next_service_timeout_ms(u32_t max_timeout)
+/*
+ * An observer with a value change is due once its minimum period elapsed,
+ * otherwise at the end of its maximum period. All the changes until then
+ * go in the same notification. An observer without a maximum period is
+ * only notified of changes.
+ */
+static s64_t observer_next_timestamp(const struct observe_node *obs,
+				     bool *manual_trigger)
+{
+	*manual_trigger = obs->event_timestamp > obs->last_timestamp;
+	if (*manual_trigger) {
+		return obs->last_timestamp + K_SECONDS(obs->min_period_sec);
+	}
+
+	if (!obs->max_period_sec) {
+		return NO_DEADLINE;
+	}
+
+	return obs->last_timestamp + K_SECONDS(obs->max_period_sec);
+}
+
+s32_t engine_next_service_timeout_ms(void)
 {
 	struct service_node *srv;
-	u64_t time_left_ms, timestamp = k_uptime_get();
-	u32_t timeout = max_timeout;
+	struct observe_node *obs;
+	s64_t timestamp = k_uptime_get();
+	s64_t next = NO_DEADLINE;
+	bool manual_trigger;
+
+	/* Sleep until the next notification instead of polling for it */
+	SYS_SLIST_FOR_EACH_CONTAINER(&engine_observer_list, obs, node) {
+		next = MIN(next, observer_next_timestamp(obs,
+							 &manual_trigger));
+	}
 
 	SYS_SLIST_FOR_EACH_CONTAINER(&engine_service_list, srv, node) {
-		time_left_ms = srv->last_timestamp +
-				  K_MSEC(srv->min_call_period);
+		next = MIN(next, srv->last_timestamp +
+			   K_MSEC(srv->min_call_period));
+	}
 
-		/* service is due */
-		if (time_left_ms < timestamp) {
-			return 0;
-		}
+	if (next == NO_DEADLINE) {
+		return K_FOREVER;
+	}
 
-		/* service timeout is less than the current timeout */
-		time_left_ms -= timestamp;
-		if (time_left_ms < timeout) {
-			timeout = time_left_ms;
-		}
+	if (next <= timestamp) {
+		return 0;
 	}
 
-	return timeout;
+	return MIN(next - timestamp, INT32_MAX);
 }
 
 int lwm2m_engine_add_service(k_work_handler_t service, u32_t period_ms)
@@ -3919,6 +4155,8 @@ int lwm2m_engine_add_service(k_work_handler_t service, u32_t period_ms)
 	sys_slist_append(&engine_service_list,
 			 &service_node_data[i].node);
 
+	engine_wakeup();
+
 	return 0;
 }
 
@@ -3927,36 +4165,29 @@ static int lwm2m_engine_service(void)
 	struct observe_node *obs;
 	struct service_node *srv;
 	s64_t timestamp, service_due_timestamp;
+	bool manual_trigger;
 
 	/*
 	 * 1. scan the observer list
-	 * 2. For each notify event found, scan the observer list
-	 * 3. For each observer match, generate a NOTIFY message,
+	 * 2. For each observer due, generate a NOTIFY message,
 	 *    attaching the notify response handler
+	 *
+	 * manual notify requirements:
+	 * - event_timestamp > last_timestamp
+	 * - current timestamp >= last_timestamp + min_period_sec
+	 *
+	 * automatic time-based notify requirements:
+	 * - current timestamp >= last_timestamp + max_period_sec
 	 */
 	timestamp = k_uptime_get();
 	SYS_SLIST_FOR_EACH_CONTAINER(&engine_observer_list, obs, node) {
-		/*
-		 * manual notify requirements:
-		 * - event_timestamp > last_timestamp
-		 * - current timestamp > last_timestamp + min_period_sec
-		 */
-		if (obs->event_timestamp > obs->last_timestamp &&
-		    timestamp > obs->last_timestamp +
-				K_SECONDS(obs->min_period_sec)) {
-			obs->last_timestamp = k_uptime_get();
-			generate_notify_message(obs, true);
-
-		/*
-		 * automatic time-based notify requirements:
-		 * - current timestamp > last_timestamp + max_period_sec
-		 */
-		} else if (timestamp > obs->last_timestamp +
-				K_SECONDS(obs->max_period_sec)) {
-			obs->last_timestamp = k_uptime_get();
-			generate_notify_message(obs, false);
+		if (observer_next_timestamp(obs, &manual_trigger) >
+		    timestamp) {
+			continue;
 		}
 
+		obs->last_timestamp = k_uptime_get();
+		generate_notify_message(obs, manual_trigger);
 	}
 
 	timestamp = k_uptime_get();
@@ -3971,7 +4202,7 @@ static int lwm2m_engine_service(void)
 	}
 
 	/* calculate how long to sleep till the next service */
-	return engine_next_service_timeout_ms(ENGINE_UPDATE_INTERVAL);
+	return engine_next_service_timeout_ms();
 }
 
 int lwm2m_engine_context_close(struct lwm2m_ctx *client_ctx)
@@ -4015,37 +4246,89 @@ int lwm2m_socket_add(struct lwm2m_ctx *ctx)
 {
 	int i;
 
-	if (sock_nfds < MAX_POLL_FD) {
-		i = sock_nfds++;
-	} else {
-		for (i = 0; i < MAX_POLL_FD; i++) {
-			if (sock_ctx[i] == NULL) {
-				goto found;
-			}
+	for (i = 0; i < MAX_POLL_FD; i++) {
+		if (sock_ctx[i] == NULL) {
+			goto found;
 		}
-
-		return -ENOMEM;
 	}
 
+	return -ENOMEM;
+
 found:
 	sock_ctx[i] = ctx;
+	sock_nfds++;
 	sock_fds[i].fd = ctx->sock_fd;
 	sock_fds[i].events = POLLIN;
+
+	/* Poll the new socket */
+	engine_wakeup();
+
 	return 0;
 }
 
 void lwm2m_socket_del(struct lwm2m_ctx *ctx)
 {
-	for (int i = 0; i < sock_nfds; i++) {
+	for (int i = 0; i < MAX_POLL_FD; i++) {
 		if (sock_ctx[i] == ctx) {
 			sock_ctx[i] = NULL;
 			sock_fds[i].fd = -1;
 			sock_nfds--;
+			engine_wakeup();
 			break;
 		}
 	}
 }
 
+#if defined(ENGINE_WAKEUP_FD)
+static int engine_wakeup_ioctl(void *obj, unsigned int request,
+			       va_list args)
+{
+	struct zsock_pollfd *pfd;
+	struct k_poll_event **pev;
+	struct k_poll_event *pev_end;
+	unsigned int signaled;
+	int result;
+
+	switch (request) {
+	case ZFD_IOCTL_POLL_PREPARE:
+		pfd = va_arg(args, struct zsock_pollfd *);
+		pev = va_arg(args, struct k_poll_event **);
+		pev_end = va_arg(args, struct k_poll_event *);
+
+		if (*pev == pev_end) {
+			return -ENOMEM;
+		}
+
+		k_poll_event_init(*pev, K_POLL_TYPE_SIGNAL,
+				  K_POLL_MODE_NOTIFY_ONLY, obj);
+		(*pev)++;
+
+		return 0;
+
+	case ZFD_IOCTL_POLL_UPDATE:
+		pfd = va_arg(args, struct zsock_pollfd *);
+		pev = va_arg(args, struct k_poll_event **);
+
+		k_poll_signal_check(obj, &signaled, &result);
+		if (signaled) {
+			pfd->revents |= ZSOCK_POLLIN;
+		}
+
+		(*pev)++;
+
+		return 0;
+
+	default:
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+}
+
+static const struct fd_op_vtable engine_wakeup_vtable = {
+	.ioctl = engine_wakeup_ioctl,
+};
+#endif /* ENGINE_WAKEUP_FD */
+
 /* LwM2M main work loop */
 
 static void socket_receive_loop(void)
@@ -4054,28 +4337,47 @@ static void socket_receive_loop(void)
 	static struct sockaddr from_addr;
 	socklen_t from_addr_len;
 	ssize_t len;
+	s32_t timeout;
+	int nfds;
 	int i;
 
 	from_addr_len = sizeof(from_addr);
 	while (1) {
+#if defined(ENGINE_WAKEUP_FD)
+		/* The wakeups until the poll() call are caught by it */
+		k_poll_signal_reset(&engine_wakeup_signal);
+#endif
+
+		timeout = lwm2m_engine_service();
+
+#if defined(ENGINE_WAKEUP_FD)
+		nfds = MAX_POLL_FD + 1;
+#else
+		nfds = MAX_POLL_FD;
+
+		if (timeout == K_FOREVER || timeout > ENGINE_UPDATE_INTERVAL) {
+			timeout = ENGINE_UPDATE_INTERVAL;
+		}
+
 		/* wait for sockets */
 		if (sock_nfds < 1) {
-			k_sleep(lwm2m_engine_service());
+			k_sleep(timeout);
 			continue;
 		}
+#endif
 
 		/*
 		 * FIXME: Currently we timeout and restart poll in case fds
 		 *        were modified.
 		 */
-		if (poll(sock_fds, sock_nfds, lwm2m_engine_service()) < 0) {
+		if (poll(sock_fds, nfds, timeout) < 0) {
 			LOG_ERR("Error in poll:%d", errno);
 			errno = 0;
 			k_sleep(ENGINE_UPDATE_INTERVAL);
 			continue;
 		}
 
-		for (i = 0; i < sock_nfds; i++) {
+		for (i = 0; i < MAX_POLL_FD; i++) {
 			if (sock_fds[i].revents & POLLERR) {
 				LOG_ERR("Error in poll.. waiting a moment.");
 				k_sleep(ENGINE_UPDATE_INTERVAL);
@@ -4354,6 +4656,24 @@ static int lwm2m_engine_init(struct device *dev)
 	(void)memset(block1_contexts, 0,
 		     sizeof(struct block_context) * NUM_BLOCK1_CONTEXT);
 
+	for (int i = 0; i < MAX_POLL_FD; i++) {
+		sock_fds[i].fd = -1;
+	}
+
+#if defined(ENGINE_WAKEUP_FD)
+	k_poll_signal_init(&engine_wakeup_signal);
+
+	engine_wakeup_fd = z_alloc_fd(&engine_wakeup_signal,
+				      &engine_wakeup_vtable);
+	if (engine_wakeup_fd < 0) {
+		LOG_ERR("Cannot allocate wakeup descriptor (%d)", errno);
+		return -errno;
+	}
+
+	sock_fds[MAX_POLL_FD].fd = engine_wakeup_fd;
+	sock_fds[MAX_POLL_FD].events = POLLIN;
+#endif
+
 	/* start sock receive thread */
 	k_thread_create(&engine_thread_data,
 			&engine_thread_stack[0],
@@ -69,6 +69,9 @@ int  lwm2m_get_or_create_engine_obj(struct lwm2m_message *msg,
 int lwm2m_engine_context_close(struct lwm2m_ctx *client_ctx);
 void lwm2m_engine_context_init(struct lwm2m_ctx *client_ctx);
 
+/* Time in ms until the next observer or service is due, K_FOREVER if none */
+s32_t engine_next_service_timeout_ms(void);
+
 /* Message buffer functions */
 u8_t *lwm2m_get_message_buf(void);
 int lwm2m_put_message_buf(u8_t *buf);
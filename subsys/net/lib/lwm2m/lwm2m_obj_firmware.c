@@ -72,6 +72,7 @@ static lwm2m_engine_user_cb_t update_cb;
 
 #ifdef CONFIG_LWM2M_FIRMWARE_UPDATE_PULL_SUPPORT
 extern int lwm2m_firmware_start_transfer(char *package_uri);
+extern int lwm2m_firmware_cancel_transfer(void);
 #endif
 
 u8_t lwm2m_firmware_get_update_state(void)
@@ -248,6 +249,10 @@ static int package_uri_write_cb(u16_t obj_inst_id, u16_t res_id,
 	if (state == STATE_IDLE) {
 		lwm2m_firmware_set_update_result(RESULT_DEFAULT);
 		lwm2m_firmware_start_transfer(package_uri);
+	} else if (state == STATE_DOWNLOADING && data_len == 0U) {
+		/* An empty URI cancels the download in progress */
+		lwm2m_firmware_cancel_transfer();
+		lwm2m_firmware_set_update_result(RESULT_DEFAULT);
 	} else if (state == STATE_DOWNLOADED && data_len == 0U) {
 		/* reset to state idle and result default */
 		lwm2m_firmware_set_update_result(RESULT_DEFAULT);
@@ -30,9 +30,40 @@ LOG_MODULE_REGISTER(LOG_MODULE_NAME);
 static struct k_work firmware_work;
 static char firmware_uri[URI_LEN];
 static struct lwm2m_ctx firmware_ctx;
-static int firmware_retry;
 static struct coap_block_context firmware_block_ctx;
 
+/* Offset of the next block to request, firmware_block_ctx.current is the
+ * offset of the next block to write.
+ */
+static size_t firmware_next_request;
+static u8_t firmware_inflight;
+
+#define FIRMWARE_WINDOW CONFIG_LWM2M_FIRMWARE_UPDATE_PULL_COAP_WINDOW
+
+/* Block request in flight, the message is released by the engine once
+ * the reply or the timeout callback has been called.
+ */
+struct firmware_request {
+	struct lwm2m_message *msg;
+	size_t offset;
+	u8_t retries;
+};
+
+static struct firmware_request firmware_requests[FIRMWARE_WINDOW];
+
+#if FIRMWARE_WINDOW > 1
+/* Block received before the ones preceding it */
+struct firmware_block {
+	size_t offset;
+	u16_t len;
+	bool last;
+	bool valid;
+	u8_t data[CONFIG_LWM2M_COAP_BLOCK_SIZE];
+};
+
+static struct firmware_block firmware_blocks[FIRMWARE_WINDOW];
+#endif
+
 #if defined(CONFIG_LWM2M_FIRMWARE_UPDATE_PULL_COAP_PROXY_SUPPORT)
 #define COAP2COAP_PROXY_URI_PATH	"coap2coap"
 #define COAP2HTTP_PROXY_URI_PATH	"coap2http"
@@ -41,6 +72,10 @@ static char proxy_uri[URI_LEN];
 #endif
 
 static void do_transmit_timeout_cb(struct lwm2m_message *msg);
+static int
+do_firmware_transfer_reply_cb(const struct coap_packet *response,
+			      struct coap_reply *reply,
+			      const struct sockaddr *from);
 
 static void set_update_result_from_error(int error_code)
 {
@@ -61,10 +96,10 @@ static void set_update_result_from_error(int error_code)
 	}
 }
 
-static int transfer_request(struct coap_block_context *ctx,
-			    u8_t *token, u8_t tkl,
-			    coap_reply_t reply_cb)
+static int transfer_request(size_t offset, coap_reply_t reply_cb,
+			    struct lwm2m_message **request)
 {
+	struct coap_block_context ctx = firmware_block_ctx;
 	struct lwm2m_message *msg;
 	int ret;
 	char *cursor;
@@ -83,8 +118,9 @@ static int transfer_request(struct coap_block_context *ctx,
 	msg->type = COAP_TYPE_CON;
 	msg->code = COAP_METHOD_GET;
 	msg->mid = 0U;
-	msg->token = token;
-	msg->tkl = tkl;
+	/* Each block has its own token as several of them can be pending */
+	msg->token = coap_next_token();
+	msg->tkl = 8U;
 	msg->reply_cb = reply_cb;
 	msg->message_timeout_cb = do_transmit_timeout_cb;
 
@@ -157,7 +193,8 @@ static int transfer_request(struct coap_block_context *ctx,
 	}
 #endif
 
-	ret = coap_append_block2_option(&msg->cpkt, ctx);
+	ctx.current = offset;
+	ret = coap_append_block2_option(&msg->cpkt, &ctx);
 	if (ret < 0) {
 		LOG_ERR("Unable to add block2 option.");
 		goto cleanup;
@@ -187,6 +224,8 @@ static int transfer_request(struct coap_block_context *ctx,
 		goto cleanup;
 	}
 
+	*request = msg;
+
 	return 0;
 
 cleanup:
@@ -227,6 +266,227 @@ cleanup:
 	return ret;
 }
 
+/* Hand a block of the image to the firmware write callback */
+static int firmware_write(const u8_t *data, u16_t data_len, bool last_block)
+{
+	struct lwm2m_engine_res *res = NULL;
+	lwm2m_engine_set_data_cb_t write_cb;
+	size_t write_buflen;
+	u8_t *write_buf;
+	u16_t len;
+	int ret;
+
+	if (!data_len) {
+		return 0;
+	}
+
+	LOG_DBG("total: %zd, current: %zd", firmware_block_ctx.total_size,
+		firmware_block_ctx.current);
+
+	/* look up firmware package resource */
+	ret = lwm2m_engine_get_resource("5/0/0", &res);
+	if (ret < 0) {
+		return ret;
+	}
+
+	/* get buffer data */
+	write_buf = res->res_instances->data_ptr;
+	write_buflen = res->res_instances->data_len;
+
+	/* check for user override to buffer */
+	if (res->pre_write_cb) {
+		write_buf = res->pre_write_cb(0, 0, 0, &write_buflen);
+	}
+
+	write_cb = lwm2m_firmware_get_write_cb();
+	if (!write_cb) {
+		return 0;
+	}
+
+	/* flush incoming data to write_cb */
+	while (data_len > 0) {
+		len = MIN(data_len, write_buflen);
+		memcpy(write_buf, data, len);
+		data += len;
+		data_len -= len;
+
+		ret = write_cb(0, 0, 0, write_buf, len,
+			       last_block && (data_len == 0U),
+			       firmware_block_ctx.total_size);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+#if FIRMWARE_WINDOW > 1
+static int firmware_block_store(size_t offset, const u8_t *data, u16_t len,
+				bool last)
+{
+	u16_t bytes = coap_block_size_to_bytes(firmware_block_ctx.block_size);
+	struct firmware_block *block;
+
+	if (len > sizeof(block->data)) {
+		return -EFAULT;
+	}
+
+	/* Requests are limited to the window, so the blocks in it never
+	 * share a slot.
+	 */
+	block = &firmware_blocks[(offset / bytes) % FIRMWARE_WINDOW];
+	block->offset = offset;
+	block->len = len;
+	block->last = last;
+	block->valid = true;
+	memcpy(block->data, data, len);
+
+	return 0;
+}
+
+/* Write the buffered blocks following the one just written. Returns 1
+ * once the last block has been written.
+ */
+static int firmware_blocks_flush(void)
+{
+	u16_t bytes = coap_block_size_to_bytes(firmware_block_ctx.block_size);
+	struct firmware_block *block;
+	int ret;
+
+	while (1) {
+		block = &firmware_blocks[(firmware_block_ctx.current / bytes) %
+					 FIRMWARE_WINDOW];
+		if (!block->valid ||
+		    block->offset != firmware_block_ctx.current) {
+			return 0;
+		}
+
+		block->valid = false;
+
+		ret = firmware_write(block->data, block->len, block->last);
+		if (ret < 0) {
+			return ret;
+		}
+
+		if (block->last) {
+			return 1;
+		}
+
+		firmware_block_ctx.current += bytes;
+	}
+}
+#else
+static int firmware_block_store(size_t offset, const u8_t *data, u16_t len,
+				bool last)
+{
+	/* Only the block being written is requested */
+	return -EFAULT;
+}
+
+static int firmware_blocks_flush(void)
+{
+	return 0;
+}
+#endif /* FIRMWARE_WINDOW > 1 */
+
+static struct firmware_request *firmware_request_find(
+	const struct lwm2m_message *msg, const struct coap_reply *reply)
+{
+	struct firmware_request *req;
+	int i;
+
+	for (i = 0; i < FIRMWARE_WINDOW; i++) {
+		req = &firmware_requests[i];
+		if (!req->msg) {
+			continue;
+		}
+
+		if (req->msg == msg || (reply && req->msg->reply == reply)) {
+			return req;
+		}
+	}
+
+	return NULL;
+}
+
+static struct firmware_request *firmware_request_get(void)
+{
+	int i;
+
+	for (i = 0; i < FIRMWARE_WINDOW; i++) {
+		if (!firmware_requests[i].msg) {
+			return &firmware_requests[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* The message of the request is left to the engine */
+static void firmware_request_done(struct firmware_request *req)
+{
+	req->msg = NULL;
+
+	if (firmware_inflight > 0) {
+		firmware_inflight--;
+	}
+}
+
+/* Release the messages of the requests in flight, so that the replies
+ * still to come for them are not handed to us anymore.
+ */
+static void firmware_transfer_abort(void)
+{
+	int i;
+
+	for (i = 0; i < FIRMWARE_WINDOW; i++) {
+		if (firmware_requests[i].msg) {
+			lwm2m_reset_message(firmware_requests[i].msg, true);
+			firmware_requests[i].msg = NULL;
+		}
+	}
+
+	firmware_inflight = 0U;
+}
+
+/* Keep up to FIRMWARE_WINDOW block requests outstanding. Blocks ahead of
+ * the one being written are only requested once the image size is known.
+ */
+static int firmware_request_blocks(void)
+{
+	u16_t bytes = coap_block_size_to_bytes(firmware_block_ctx.block_size);
+	size_t total = firmware_block_ctx.total_size;
+	size_t window = total ? FIRMWARE_WINDOW : 1;
+	struct firmware_request *req;
+	int ret;
+
+	while (firmware_inflight < window &&
+	       firmware_next_request < firmware_block_ctx.current +
+				       window * bytes &&
+	       (!total || firmware_next_request < total)) {
+		req = firmware_request_get();
+		if (!req) {
+			break;
+		}
+
+		ret = transfer_request(firmware_next_request,
+				       do_firmware_transfer_reply_cb,
+				       &req->msg);
+		if (ret < 0) {
+			return ret;
+		}
+
+		req->offset = firmware_next_request;
+		req->retries = 0U;
+
+		firmware_inflight++;
+		firmware_next_request += bytes;
+	}
+
+	return 0;
+}
+
 static int
 do_firmware_transfer_reply_cb(const struct coap_packet *response,
 			      struct coap_reply *reply,
@@ -234,23 +494,30 @@ do_firmware_transfer_reply_cb(const struct coap_packet *response,
 {
 	int ret;
 	bool last_block;
-	u8_t token[8];
-	u8_t tkl;
-	u16_t payload_len, payload_offset, len;
+	u16_t payload_len;
+	const u8_t *payload;
+	size_t offset;
 	struct coap_packet *check_response = (struct coap_packet *)response;
-	struct lwm2m_engine_res *res = NULL;
-	lwm2m_engine_set_data_cb_t write_cb;
-	size_t write_buflen;
-	u8_t resp_code, *write_buf;
+	u8_t resp_code;
 	struct coap_block_context received_block_ctx;
-
-	/* token is used to determine a valid ACK vs a separated response */
-	tkl = coap_header_get_token(check_response, token);
+	struct firmware_request *req;
 
 	/* If separated response (ACK) return and wait for response */
-	if (!tkl && coap_header_get_type(response) == COAP_TYPE_ACK) {
+	if (!coap_header_get_token(check_response, NULL) &&
+	    coap_header_get_type(response) == COAP_TYPE_ACK) {
+		return 0;
+	}
+
+	req = firmware_request_find(NULL, reply);
+	if (!req) {
+		LOG_WRN("Reply to a request of no transfer ignored");
 		return 0;
-	} else if (coap_header_get_type(response) == COAP_TYPE_CON) {
+	}
+
+	/* This request is done, whatever its response is */
+	firmware_request_done(req);
+
+	if (coap_header_get_type(response) == COAP_TYPE_CON) {
 		/* Send back ACK so the server knows we received the pkt */
 		ret = transfer_empty_ack(coap_header_get_id(check_response));
 		if (ret < 0) {
@@ -269,125 +536,132 @@ do_firmware_transfer_reply_cb(const struct coap_packet *response,
 		goto error;
 	}
 
-	/* save main firmware block context */
 	memcpy(&received_block_ctx, &firmware_block_ctx,
 	       sizeof(firmware_block_ctx));
 
-	ret = coap_update_from_block(check_response, &firmware_block_ctx);
+	ret = coap_update_from_block(check_response, &received_block_ctx);
 	if (ret < 0) {
 		LOG_ERR("Error from block update: %d", ret);
 		ret = -EFAULT;
 		goto error;
 	}
 
+	offset = received_block_ctx.current;
+
+	/* Reach last block if ret equals to 0 */
+	last_block = !coap_next_block(check_response, &received_block_ctx);
+
+	payload = coap_packet_get_payload(response, &payload_len);
+
 	/* test for duplicate transfer */
-	if (firmware_block_ctx.current < received_block_ctx.current) {
+	if (offset < firmware_block_ctx.current) {
 		LOG_WRN("Duplicate packet ignored");
+		goto next;
+	}
 
-		/* restore main firmware block context */
-		memcpy(&firmware_block_ctx, &received_block_ctx,
-		       sizeof(firmware_block_ctx));
+	if (received_block_ctx.block_size != firmware_block_ctx.block_size) {
+		/* The server chose a smaller block size, which is only
+		 * possible before blocks are requested ahead.
+		 */
+		if (firmware_inflight) {
+			LOG_ERR("Block size changed during transfer");
+			ret = -EFAULT;
+			goto error;
+		}
 
-		/* set reply->user_data to error to avoid releasing */
-		reply->user_data = (void *)COAP_REPLY_STATUS_ERROR;
-		return 0;
+		firmware_next_request = offset;
 	}
 
-	/* Reach last block if ret equals to 0 */
-	last_block = !coap_next_block(check_response, &firmware_block_ctx);
-
-	/* Process incoming data */
-	payload_offset = response->hdr_len + response->opt_len;
-	coap_packet_get_payload(response, &payload_len);
-	if (payload_len > 0) {
-		LOG_DBG("total: %zd, current: %zd",
-			firmware_block_ctx.total_size,
-			firmware_block_ctx.current);
-
-		/* look up firmware package resource */
-		ret = lwm2m_engine_get_resource("5/0/0", &res);
+	firmware_block_ctx.block_size = received_block_ctx.block_size;
+	firmware_block_ctx.total_size = received_block_ctx.total_size;
+
+	if (offset > firmware_block_ctx.current) {
+		/* Wait for the blocks in between */
+		ret = firmware_block_store(offset, payload, payload_len,
+					   last_block);
 		if (ret < 0) {
 			goto error;
 		}
 
-		/* get buffer data */
-		write_buf = res->res_instances->data_ptr;
-		write_buflen = res->res_instances->data_len;
-
-		/* check for user override to buffer */
-		if (res->pre_write_cb) {
-			write_buf = res->pre_write_cb(0, 0, 0, &write_buflen);
-		}
+		goto next;
+	}
 
-		write_cb = lwm2m_firmware_get_write_cb();
-		if (write_cb) {
-			/* flush incoming data to write_cb */
-			while (payload_len > 0) {
-				len = (payload_len > write_buflen) ?
-				       write_buflen : payload_len;
-				payload_len -= len;
-				/* check for end of packet */
-				if (buf_read(write_buf, len,
-					     CPKT_BUF_READ(response),
-					     &payload_offset) < 0) {
-					/* malformed packet */
-					ret = -EFAULT;
-					goto error;
-				}
-
-				ret = write_cb(0, 0, 0,
-					       write_buf, len,
-					       last_block &&
-							(payload_len == 0U),
-					       firmware_block_ctx.total_size);
-				if (ret < 0) {
-					goto error;
-				}
-			}
-		}
+	ret = firmware_write(payload, payload_len, last_block);
+	if (ret < 0) {
+		goto error;
 	}
 
 	if (!last_block) {
-		/* More block(s) to come, setup next transfer */
-		ret = transfer_request(&firmware_block_ctx, token, tkl,
-				       do_firmware_transfer_reply_cb);
+		firmware_block_ctx.current = received_block_ctx.current;
+
+		ret = firmware_blocks_flush();
 		if (ret < 0) {
 			goto error;
 		}
-	} else {
-		/* Download finished */
+
+		last_block = ret > 0;
+	}
+
+	if (last_block) {
+		/* Download finished, the requests still in flight can only
+		 * be for blocks past the end of the image.
+		 */
+		firmware_transfer_abort();
 		lwm2m_firmware_set_update_state(STATE_DOWNLOADED);
+		return 0;
+	}
+
+	if (firmware_next_request < firmware_block_ctx.current) {
+		firmware_next_request = firmware_block_ctx.current;
+	}
+
+next:
+	/* More block(s) to come, setup next transfers */
+	ret = firmware_request_blocks();
+	if (ret < 0) {
+		goto error;
 	}
 
 	return 0;
 
 error:
+	firmware_transfer_abort();
 	set_update_result_from_error(ret);
 	return ret;
 }
 
 static void do_transmit_timeout_cb(struct lwm2m_message *msg)
 {
+	struct firmware_request *req;
 	int ret;
 
-	if (firmware_retry < PACKET_TRANSFER_RETRY_MAX) {
+	req = firmware_request_find(msg, NULL);
+	if (!req) {
+		return;
+	}
+
+	/* The engine releases the timed out message after this call */
+	req->msg = NULL;
+
+	if (req->retries < PACKET_TRANSFER_RETRY_MAX) {
 		/* retry block */
 		LOG_WRN("TIMEOUT - Sending a retry packet!");
 
-		ret = transfer_request(&firmware_block_ctx,
-				       msg->token, msg->tkl,
-				       do_firmware_transfer_reply_cb);
+		ret = transfer_request(req->offset,
+				       do_firmware_transfer_reply_cb,
+				       &req->msg);
 		if (ret < 0) {
 			/* abort retries / transfer */
+			firmware_transfer_abort();
 			set_update_result_from_error(ret);
-			firmware_retry = PACKET_TRANSFER_RETRY_MAX;
 			return;
 		}
 
-		firmware_retry++;
+		req->retries++;
 	} else {
 		LOG_ERR("TIMEOUT - Too many retry packet attempts! "
 			"Aborting firmware download.");
+		firmware_transfer_abort();
 		lwm2m_firmware_set_update_result(RESULT_CONNECTION_LOST);
 	}
 }
@@ -431,8 +705,13 @@ static void firmware_transfer(struct k_work *work)
 	/* reset block transfer context */
 	coap_block_transfer_init(&firmware_block_ctx,
 				 lwm2m_default_block_size(), 0);
-	ret = transfer_request(&firmware_block_ctx, coap_next_token(), 8,
-			       do_firmware_transfer_reply_cb);
+	firmware_next_request = 0;
+	firmware_transfer_abort();
+#if FIRMWARE_WINDOW > 1
+	(void)memset(firmware_blocks, 0, sizeof(firmware_blocks));
+#endif
+
+	ret = firmware_request_blocks();
 	if (ret < 0) {
 		goto error;
 	}
@@ -443,9 +722,16 @@ error:
 	set_update_result_from_error(ret);
 }
 
-/* TODO: */
 int lwm2m_firmware_cancel_transfer(void)
 {
+	firmware_transfer_abort();
+
+	if (firmware_ctx.sock_fd > 0) {
+		lwm2m_socket_del(&firmware_ctx);
+		(void)close(firmware_ctx.sock_fd);
+		firmware_ctx.sock_fd = -1;
+	}
+
 	return 0;
 }
 
@@ -457,8 +743,8 @@ int lwm2m_firmware_start_transfer(char *package_uri)
 		(void)close(firmware_ctx.sock_fd);
 	}
 
+	firmware_transfer_abort();
 	(void)memset(&firmware_ctx, 0, sizeof(struct lwm2m_ctx));
-	firmware_retry = 0;
 	k_work_init(&firmware_work, firmware_transfer);
 	lwm2m_firmware_set_update_state(STATE_DOWNLOADING);
 
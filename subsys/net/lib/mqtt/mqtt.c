@@ -25,6 +25,11 @@ static void client_reset(struct mqtt_client *client)
 	client->internal.last_activity = 0U;
 	client->internal.rx_buf_datalen = 0U;
 	client->internal.remaining_payload = 0U;
+#if CONFIG_MQTT_INFLIGHT_MAX > 0
+	memset(client->internal.inflight, 0,
+	       sizeof(client->internal.inflight));
+	client->internal.inflight_count = 0U;
+#endif
 }
 
 /** @brief Initialize tx buffer. */
@@ -160,7 +165,7 @@ static int client_write(struct mqtt_client *client, const u8_t *data,
 }
 
 static int client_write_msg(struct mqtt_client *client,
-			    const struct msghdr *message)
+			    struct msghdr *message)
 {
 	int err_code;
 
@@ -249,13 +254,189 @@ static int verify_tx_state(const struct mqtt_client *client)
 	return 0;
 }
 
+#if CONFIG_MQTT_INFLIGHT_MAX > 0
+static int inflight_find(const struct mqtt_client *client, u16_t message_id)
+{
+	int i;
+
+	for (i = 0; i < CONFIG_MQTT_INFLIGHT_MAX; i++) {
+		if (client->internal.inflight[i] == message_id) {
+			return i;
+		}
+	}
+
+	return -ENOENT;
+}
+
+/**@brief Verifies that the QoS 1 and QoS 2 messages to publish fit in the
+ *        inflight window.
+ */
+static int inflight_check(const struct mqtt_client *client,
+			  const struct mqtt_publish_param *params,
+			  size_t count)
+{
+	size_t needed = 0;
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		if (!params[i].message.topic.qos) {
+			continue;
+		}
+
+		/* Message id zero is not permitted by spec. */
+		if (params[i].message_id == 0U) {
+			return -EINVAL;
+		}
+
+		if (inflight_find(client, params[i].message_id) >= 0) {
+			/* Only a retransmission can reuse the id */
+			if (!params[i].dup_flag) {
+				return -EALREADY;
+			}
+
+			continue;
+		}
+
+		needed++;
+	}
+
+	if (client->internal.inflight_count + needed >
+	    CONFIG_MQTT_INFLIGHT_MAX) {
+		return -EAGAIN;
+	}
+
+	return 0;
+}
+
+static void inflight_add(struct mqtt_client *client,
+			 const struct mqtt_publish_param *params,
+			 size_t count)
+{
+	size_t i;
+	int idx;
+
+	for (i = 0; i < count; i++) {
+		if (!params[i].message.topic.qos ||
+		    inflight_find(client, params[i].message_id) >= 0) {
+			continue;
+		}
+
+		/* Room was checked by inflight_check() */
+		idx = inflight_find(client, 0U);
+		client->internal.inflight[idx] = params[i].message_id;
+		client->internal.inflight_count++;
+	}
+}
+
+void mqtt_inflight_release(struct mqtt_client *client, u16_t message_id)
+{
+	int idx;
+
+	if (message_id == 0U) {
+		return;
+	}
+
+	idx = inflight_find(client, message_id);
+	if (idx < 0) {
+		MQTT_TRC("[CID %p]: Message id 0x%04x not in flight", client,
+			 message_id);
+		return;
+	}
+
+	client->internal.inflight[idx] = 0U;
+	client->internal.inflight_count--;
+}
+
+u32_t mqtt_inflight_count(const struct mqtt_client *client)
+{
+	return client->internal.inflight_count;
+}
+#else
+static int inflight_check(const struct mqtt_client *client,
+			  const struct mqtt_publish_param *params,
+			  size_t count)
+{
+	return 0;
+}
+
+static void inflight_add(struct mqtt_client *client,
+			 const struct mqtt_publish_param *params,
+			 size_t count)
+{
+}
+
+void mqtt_inflight_release(struct mqtt_client *client, u16_t message_id)
+{
+}
+
+u32_t mqtt_inflight_count(const struct mqtt_client *client)
+{
+	return 0;
+}
+#endif /* CONFIG_MQTT_INFLIGHT_MAX > 0 */
+
+/**@brief Encodes the headers of the messages in the transmit buffer and
+ *        sends them with their payloads in one transport write.
+ */
+static int client_publish(struct mqtt_client *client,
+			  const struct mqtt_publish_param *params,
+			  size_t count)
+{
+	struct iovec io_vector[2 * CONFIG_MQTT_PUBLISH_BATCH_MAX];
+	struct buf_ctx packet;
+	struct msghdr msg;
+	u8_t *end;
+	size_t i;
+	int err_code;
+
+	err_code = verify_tx_state(client);
+	if (err_code < 0) {
+		return err_code;
+	}
+
+	err_code = inflight_check(client, params, count);
+	if (err_code < 0) {
+		return err_code;
+	}
+
+	tx_buf_init(client, &packet);
+	end = packet.end;
+
+	for (i = 0; i < count; i++) {
+		err_code = publish_encode(&params[i], &packet);
+		if (err_code < 0) {
+			return err_code;
+		}
+
+		io_vector[2 * i].iov_base = packet.cur;
+		io_vector[2 * i].iov_len = packet.end - packet.cur;
+		io_vector[2 * i + 1].iov_base = params[i].message.payload.data;
+		io_vector[2 * i + 1].iov_len = params[i].message.payload.len;
+
+		/* Next header goes after this one */
+		packet.cur = packet.end;
+		packet.end = end;
+	}
+
+	memset(&msg, 0, sizeof(msg));
+
+	msg.msg_iov = io_vector;
+	msg.msg_iovlen = 2 * count;
+
+	err_code = client_write_msg(client, &msg);
+	if (err_code < 0) {
+		return err_code;
+	}
+
+	inflight_add(client, params, count);
+
+	return 0;
+}
+
 int mqtt_publish(struct mqtt_client *client,
 		 const struct mqtt_publish_param *param)
 {
 	int err_code;
-	struct buf_ctx packet;
-	struct iovec io_vector[2];
-	struct msghdr msg;
 
 	NULL_PARAM_CHECK(client);
 	NULL_PARAM_CHECK(param);
@@ -267,33 +448,37 @@ int mqtt_publish(struct mqtt_client *client,
 
 	mqtt_mutex_lock(client);
 
-	tx_buf_init(client, &packet);
+	err_code = client_publish(client, param, 1);
 
-	err_code = verify_tx_state(client);
-	if (err_code < 0) {
-		goto error;
-	}
+	MQTT_TRC("[CID %p]:[State 0x%02x]: << result 0x%08x",
+			 client, client->internal.state, err_code);
 
-	err_code = publish_encode(param, &packet);
-	if (err_code < 0) {
-		goto error;
-	}
+	mqtt_mutex_unlock(client);
+
+	return err_code;
+}
 
-	io_vector[0].iov_base = packet.cur;
-	io_vector[0].iov_len = packet.end - packet.cur;
-	io_vector[1].iov_base = param->message.payload.data;
-	io_vector[1].iov_len = param->message.payload.len;
+int mqtt_publish_batch(struct mqtt_client *client,
+		       const struct mqtt_publish_param *params, size_t count)
+{
+	int err_code;
 
-	memset(&msg, 0, sizeof(msg));
+	NULL_PARAM_CHECK(client);
+	NULL_PARAM_CHECK(params);
 
-	msg.msg_iov = io_vector;
-	msg.msg_iovlen = ARRAY_SIZE(io_vector);
+	if (count == 0 || count > CONFIG_MQTT_PUBLISH_BATCH_MAX) {
+		return -EINVAL;
+	}
 
-	err_code = client_write_msg(client, &msg);
+	MQTT_TRC("[CID %p]:[State 0x%02x]: >> Message count %zu",
+		 client, client->internal.state, count);
+
+	mqtt_mutex_lock(client);
+
+	err_code = client_publish(client, params, count);
 
-error:
 	MQTT_TRC("[CID %p]:[State 0x%02x]: << result 0x%08x",
-			 client, client->internal.state, err_code);
+		 client, client->internal.state, err_code);
 
 	mqtt_mutex_unlock(client);
 
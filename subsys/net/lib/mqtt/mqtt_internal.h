@@ -157,6 +157,14 @@ void event_notify(struct mqtt_client *client, const struct mqtt_evt *evt);
  */
 int mqtt_handle_rx(struct mqtt_client *client);
 
+/**@brief Removes a message from the inflight window once it is acknowledged.
+ *
+ * @param[in] client Identifies the client for which the message was
+ *                   acknowledged.
+ * @param[in] message_id Id of the acknowledged message.
+ */
+void mqtt_inflight_release(struct mqtt_client *client, u16_t message_id);
+
 /**@brief Constructs/encodes Connect packet.
  *
  * @param[in] client Identifies the client for which the procedure is requested.
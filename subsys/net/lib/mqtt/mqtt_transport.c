@@ -62,11 +62,27 @@ int mqtt_transport_write(struct mqtt_client *client, const u8_t *data,
 }
 
 int mqtt_transport_write_msg(struct mqtt_client *client,
-			     const struct msghdr *message)
+			     struct msghdr *message)
 {
 	return transport_fn[client->transport.type].write_msg(client, message);
 }
 
+void mqtt_transport_msg_skip(struct msghdr *message, size_t len)
+{
+	while (len > 0 && message->msg_iovlen > 0) {
+		if (len < message->msg_iov->iov_len) {
+			message->msg_iov->iov_base =
+				(u8_t *)message->msg_iov->iov_base + len;
+			message->msg_iov->iov_len -= len;
+			return;
+		}
+
+		len -= message->msg_iov->iov_len;
+		message->msg_iov++;
+		message->msg_iovlen--;
+	}
+}
+
 int mqtt_transport_read(struct mqtt_client *client, u8_t *data, u32_t buflen,
 			bool shall_block)
 {
@@ -25,9 +25,12 @@ typedef int (*transport_connect_handler_t)(struct mqtt_client *client);
 typedef int (*transport_write_handler_t)(struct mqtt_client *client,
 					 const u8_t *data, u32_t datalen);
 
-/**@brief Transport write message handler, similar to POSIX sendmsg function. */
+/**@brief Transport write message handler, similar to POSIX sendmsg function.
+ *        The whole message is written, the I/O vector array it points to is
+ *        modified along the way.
+ */
 typedef int (*transport_write_msg_handler_t)(struct mqtt_client *client,
-					     const struct msghdr *message);
+					     struct msghdr *message);
 
 /**@brief Transport read handler. */
 typedef int (*transport_read_handler_t)(struct mqtt_client *client, u8_t *data,
@@ -86,13 +89,24 @@ int mqtt_transport_write(struct mqtt_client *client, const u8_t *data,
 /**@brief Handles write message requests on configured transport.
  *
  * @param[in] client Identifies the client on which the procedure is requested.
- * @param[in] message Pointer to the `struct msghdr` structure, containing data
- *            to be written on the transport.
+ * @param[inout] message Pointer to the `struct msghdr` structure, containing
+ *               data to be written on the transport. The I/O vector array
+ *               it points to is consumed by the write and shall not be
+ *               reused afterwards.
  *
  * @retval 0 or an error code indicating reason for failure.
  */
 int mqtt_transport_write_msg(struct mqtt_client *client,
-			     const struct msghdr *message);
+			     struct msghdr *message);
+
+/**@brief Skips the beginning of a message after a partial write.
+ *
+ * @param[inout] message Message being written. The I/O vector array it
+ *               points to is modified to only describe the data not written
+ *               yet.
+ * @param[in] len Number of bytes written.
+ */
+void mqtt_transport_msg_skip(struct msghdr *message, size_t len);
 
 /**@brief Handles read requests on configured transport.
  *
@@ -120,7 +134,7 @@ int mqtt_client_tcp_connect(struct mqtt_client *client);
 int mqtt_client_tcp_write(struct mqtt_client *client, const u8_t *data,
 			  u32_t datalen);
 int mqtt_client_tcp_write_msg(struct mqtt_client *client,
-			      const struct msghdr *message);
+			      struct msghdr *message);
 int mqtt_client_tcp_read(struct mqtt_client *client, u8_t *data,
 			 u32_t buflen, bool shall_block);
 int mqtt_client_tcp_disconnect(struct mqtt_client *client);
@@ -131,7 +145,7 @@ int mqtt_client_tls_connect(struct mqtt_client *client);
 int mqtt_client_tls_write(struct mqtt_client *client, const u8_t *data,
 			  u32_t datalen);
 int mqtt_client_tls_write_msg(struct mqtt_client *client,
-			      const struct msghdr *message);
+			      struct msghdr *message);
 int mqtt_client_tls_read(struct mqtt_client *client, u8_t *data,
 			 u32_t buflen, bool shall_block);
 int mqtt_client_tls_disconnect(struct mqtt_client *client);
@@ -142,7 +156,7 @@ int mqtt_client_websocket_connect(struct mqtt_client *client);
 int mqtt_client_websocket_write(struct mqtt_client *client, const u8_t *data,
 				u32_t datalen);
 int mqtt_client_websocket_write_msg(struct mqtt_client *client,
-				    const struct msghdr *message);
+				    struct msghdr *message);
 int mqtt_client_websocket_read(struct mqtt_client *client, u8_t *data,
 			       u32_t buflen, bool shall_block);
 int mqtt_client_websocket_disconnect(struct mqtt_client *client);
@@ -16,6 +16,7 @@ LOG_MODULE_REGISTER(net_mqtt_sock_tls, CONFIG_MQTT_LOG_LEVEL);
 #include <net/socket.h>
 #include <net/mqtt.h>
 
+#include "mqtt_transport.h"
 #include "mqtt_os.h"
 
 int mqtt_client_tls_connect(struct mqtt_client *client)
@@ -118,13 +119,30 @@ int mqtt_client_tls_write(struct mqtt_client *client, const u8_t *data,
 }
 
 int mqtt_client_tls_write_msg(struct mqtt_client *client,
-			      const struct msghdr *message)
+			      struct msghdr *message)
 {
+	size_t total_len = 0;
+	size_t offset = 0;
 	int ret;
+	int i;
 
-	ret = sendmsg(client->transport.tls.sock, message, 0);
-	if (ret < 0) {
-		return -errno;
+	for (i = 0; i < message->msg_iovlen; i++) {
+		total_len += message->msg_iov[i].iov_len;
+	}
+
+	/* A batch of messages may not be sent at once */
+	while (1) {
+		ret = sendmsg(client->transport.tls.sock, message, 0);
+		if (ret < 0) {
+			return -errno;
+		}
+
+		offset += ret;
+		if (offset >= total_len) {
+			break;
+		}
+
+		mqtt_transport_msg_skip(message, ret);
 	}
 
 	return 0;
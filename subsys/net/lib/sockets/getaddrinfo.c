@@ -208,7 +208,7 @@ int z_impl_z_zsock_getaddrinfo_internal(const char *host, const char *service,
 
 	/* If the family is AF_UNSPEC, then we query IPv4 address first */
 	ret = exec_query(host, family, &ai_state);
-	if (ret == 0) {
+	if (ret >= 0) {
 		/* If the DNS query for reason fails so that the
 		 * dns_resolve_cb() would not be called, then we want the
 		 * semaphore to timeout so that we will not hang forever.
@@ -242,7 +242,7 @@ int z_impl_z_zsock_getaddrinfo_internal(const char *host, const char *service,
 	 */
 	if (family == AF_UNSPEC && IS_ENABLED(CONFIG_NET_IPV6)) {
 		ret = exec_query(host, AF_INET6, &ai_state);
-		if (ret == 0) {
+		if (ret >= 0) {
 			int ret = k_sem_take(&ai_state.sem,
 					     CONFIG_NET_SOCKETS_DNS_TIMEOUT +
 					     K_MSEC(100));
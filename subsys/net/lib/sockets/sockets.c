@@ -15,6 +15,7 @@ LOG_MODULE_REGISTER(net_sock, CONFIG_NET_SOCKETS_LOG_LEVEL);
 #include <net/net_context.h>
 #include <net/net_pkt.h>
 #include <net/socket.h>
+#include <net/bpf.h>
 #include <syscall_handler.h>
 #include <sys/fdtable.h>
 #include <sys/math_extras.h>
@@ -122,6 +123,10 @@ int zsock_socket_internal(int family, int type, int proto)
 	/* recv_q and accept_q are in union */
 	k_fifo_init(&ctx->recv_q);
 
+#if defined(CONFIG_NET_SOCKETS_EPOLL)
+	sys_slist_init(&ctx->epoll_items);
+#endif
+
 #ifdef CONFIG_USERSPACE
 	/* Set net context object as initialized and grant access to the
 	 * calling thread (and only the calling thread)
@@ -199,6 +204,7 @@ int zsock_close_ctx(struct net_context *ctx)
 		(void)net_context_recv(ctx, NULL, K_NO_WAIT, NULL);
 	}
 
+	zsock_epoll_ctx_closed(ctx);
 	zsock_flush_queue(ctx);
 
 	SET_ERRNO(net_context_put(ctx));
@@ -264,8 +270,12 @@ static void zsock_accepted_cb(struct net_context *new_ctx,
 		(void)net_context_recv(new_ctx, zsock_received_cb, K_NO_WAIT,
 				       NULL);
 		k_fifo_init(&new_ctx->recv_q);
+#if defined(CONFIG_NET_SOCKETS_EPOLL)
+		sys_slist_init(&new_ctx->epoll_items);
+#endif
 
 		k_fifo_put(&parent->accept_q, new_ctx);
+		zsock_epoll_notify(parent);
 	}
 }
 
@@ -295,6 +305,8 @@ static void zsock_received_cb(struct net_context *ctx,
 			net_pkt_set_eof(last_pkt, true);
 			NET_DBG("Set EOF flag on pkt %p", last_pkt);
 		}
+
+		zsock_epoll_notify(ctx);
 		return;
 	}
 
@@ -306,6 +318,7 @@ static void zsock_received_cb(struct net_context *ctx,
 	}
 
 	k_fifo_put(&ctx->recv_q, pkt);
+	zsock_epoll_notify(ctx);
 }
 
 int zsock_bind_ctx(struct net_context *ctx, const struct sockaddr *addr,
@@ -967,6 +980,236 @@ ssize_t z_vrfy_zsock_recvfrom(int sock, void *buf, size_t max_len, int flags,
 #include <syscalls/zsock_recvfrom_mrsh.c>
 #endif /* CONFIG_USERSPACE */
 
+#if defined(CONFIG_NET_SOCKETS_ZEROCOPY)
+struct zsock_zc_tx {
+	zsock_zc_sent_cb_t cb;
+	const void *buf;
+	size_t len;
+	void *user_data;
+};
+
+static struct zsock_zc_tx zc_tx[CONFIG_NET_SOCKETS_ZEROCOPY_TX_BUFS];
+
+static void zsock_zc_tx_destroy(struct net_buf *buf);
+
+NET_BUF_POOL_DEFINE(zsock_zc_tx_pool, CONFIG_NET_SOCKETS_ZEROCOPY_TX_BUFS,
+		    0, 0, zsock_zc_tx_destroy);
+
+static void zsock_zc_tx_destroy(struct net_buf *buf)
+{
+	struct zsock_zc_tx tx = zc_tx[net_buf_id(buf)];
+
+	net_buf_destroy(buf);
+
+	if (tx.cb) {
+		tx.cb(tx.buf, tx.len, tx.user_data);
+	}
+}
+
+static struct net_context *zsock_zc_get_ctx(int sock)
+{
+	const struct socket_op_vtable *vtable;
+	struct net_context *ctx;
+
+	ctx = get_sock_vtable(sock, &vtable);
+	if (ctx == NULL) {
+		return NULL;
+	}
+
+	/* Only native sockets can hand out the network buffers, others
+	 * (TLS, offloaded, ...) transform the payload on the way.
+	 */
+	if (vtable != &sock_fd_op_vtable) {
+		errno = EOPNOTSUPP;
+		return NULL;
+	}
+
+	return ctx;
+}
+
+static struct net_pkt *zsock_zc_get_pkt(struct net_context *ctx, int flags)
+{
+	s32_t timeout = K_FOREVER;
+	struct net_pkt *pkt;
+	int res;
+
+	if ((flags & ZSOCK_MSG_DONTWAIT) || sock_is_nonblock(ctx)) {
+		timeout = K_NO_WAIT;
+	}
+
+	if (net_context_get_type(ctx) == SOCK_STREAM && sock_is_eof(ctx)) {
+		errno = 0;
+		return NULL;
+	}
+
+	res = k_fifo_wait_non_empty(&ctx->recv_q, timeout);
+	/* EAGAIN when timeout expired, EINTR when cancelled */
+	if (res && res != -EAGAIN && res != -EINTR) {
+		errno = -res;
+		return NULL;
+	}
+
+	if (flags & ZSOCK_MSG_PEEK) {
+		pkt = k_fifo_peek_head(&ctx->recv_q);
+		if (pkt) {
+			net_pkt_ref(pkt);
+		}
+	} else {
+		pkt = k_fifo_get(&ctx->recv_q, K_NO_WAIT);
+	}
+
+	if (!pkt) {
+		if (net_context_get_type(ctx) == SOCK_STREAM &&
+		    sock_is_eof(ctx)) {
+			errno = 0;
+		} else {
+			errno = EAGAIN;
+		}
+	}
+
+	return pkt;
+}
+
+ssize_t zsock_recvfrom_zc(int sock, struct zsock_zc_buf *zc, int flags,
+			  struct sockaddr *src_addr, socklen_t *addrlen)
+{
+	struct net_context *ctx;
+	struct net_pkt *pkt;
+	enum net_sock_type sock_type;
+
+	if (zc == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	memset(zc, 0, sizeof(*zc));
+
+	ctx = zsock_zc_get_ctx(sock);
+	if (ctx == NULL) {
+		return -1;
+	}
+
+	sock_type = net_context_get_type(ctx);
+	if (sock_type != SOCK_DGRAM && sock_type != SOCK_STREAM) {
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	pkt = zsock_zc_get_pkt(ctx, flags);
+	if (!pkt) {
+		return errno ? -1 : 0;
+	}
+
+	if (sock_type == SOCK_DGRAM && src_addr && addrlen) {
+		int rv;
+
+		rv = sock_get_pkt_src_addr(pkt, net_context_get_ip_proto(ctx),
+					   src_addr, *addrlen);
+		if (rv < 0) {
+			net_pkt_unref(pkt);
+			errno = -rv;
+			return -1;
+		}
+
+		if (src_addr->sa_family == AF_INET) {
+			*addrlen = sizeof(struct sockaddr_in);
+		} else {
+			*addrlen = sizeof(struct sockaddr_in6);
+		}
+	}
+
+	/* The packet cursor points to the payload once it is queued */
+	zc->frags = pkt->cursor.buf;
+	zc->offset = pkt->cursor.buf ?
+		     pkt->cursor.pos - pkt->cursor.buf->data : 0;
+	zc->len = net_pkt_remaining_data(pkt);
+	zc->pkt = pkt;
+
+	if (!(flags & ZSOCK_MSG_PEEK)) {
+		if (sock_type == SOCK_STREAM) {
+			if (net_pkt_eof(pkt)) {
+				sock_set_eof(ctx);
+			}
+
+			net_context_update_recv_wnd(ctx, zc->len);
+		}
+
+		net_stats_update_tc_rx_time(net_pkt_iface(pkt),
+					    net_pkt_priority(pkt),
+					    net_pkt_timestamp(pkt)->nanosecond,
+					    k_cycle_get_32());
+	}
+
+	return zc->len;
+}
+
+void zsock_zc_release(struct zsock_zc_buf *zc)
+{
+	if (zc == NULL || zc->pkt == NULL) {
+		return;
+	}
+
+	net_pkt_unref(zc->pkt);
+	memset(zc, 0, sizeof(*zc));
+}
+
+ssize_t zsock_sendto_zc(int sock, const void *buf, size_t len, int flags,
+			const struct sockaddr *dest_addr, socklen_t addrlen,
+			zsock_zc_sent_cb_t cb, void *user_data)
+{
+	s32_t timeout = K_FOREVER;
+	struct net_context *ctx;
+	struct zsock_zc_tx *tx;
+	struct net_buf *frag;
+	int status;
+
+	ctx = zsock_zc_get_ctx(sock);
+	if (ctx == NULL) {
+		return -1;
+	}
+
+	if ((flags & ZSOCK_MSG_DONTWAIT) || sock_is_nonblock(ctx)) {
+		timeout = K_NO_WAIT;
+	}
+
+	frag = net_buf_alloc_with_const_data(&zsock_zc_tx_pool, buf, len,
+					     timeout);
+	if (!frag) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	tx = &zc_tx[net_buf_id(frag)];
+	tx->cb = cb;
+	tx->buf = buf;
+	tx->len = len;
+	tx->user_data = user_data;
+
+	/* Register the callback before sending in order to receive the
+	 * response from the peer.
+	 */
+	status = net_context_recv(ctx, zsock_received_cb, K_NO_WAIT,
+				  ctx->user_data);
+	if (status == 0) {
+		status = net_context_sendto_frags(ctx, frag, dest_addr,
+						  addrlen, NULL, timeout,
+						  ctx->user_data);
+	}
+
+	/* The stack holds its own reference for as long as it needs the
+	 * data, the callback is called once that one is dropped too.
+	 */
+	net_buf_unref(frag);
+
+	if (status < 0) {
+		errno = -status;
+		return -1;
+	}
+
+	return status;
+}
+#endif /* CONFIG_NET_SOCKETS_ZEROCOPY */
+
 /* As this is limited function, we don't follow POSIX signature, with
  * "..." instead of last arg.
  */
@@ -1268,6 +1511,23 @@ int zsock_getsockopt_ctx(struct net_context *ctx, int level, int optname,
 
 				return 0;
 			}
+
+			break;
+
+		case SO_RCVBUF:
+			if (IS_ENABLED(CONFIG_NET_CONTEXT_RCVBUF)) {
+				ret = net_context_get_option(ctx,
+							     NET_OPT_RCVBUF,
+							     optval, optlen);
+				if (ret < 0) {
+					errno = -ret;
+					return -1;
+				}
+
+				return 0;
+			}
+
+			break;
 		}
 
 		break;
@@ -1328,6 +1588,21 @@ int zsock_setsockopt_ctx(struct net_context *ctx, int level, int optname,
 			 */
 			return 0;
 
+		case SO_RCVBUF:
+			if (IS_ENABLED(CONFIG_NET_CONTEXT_RCVBUF)) {
+				ret = net_context_set_option(ctx,
+							     NET_OPT_RCVBUF,
+							     optval, optlen);
+				if (ret < 0) {
+					errno = -ret;
+					return -1;
+				}
+
+				return 0;
+			}
+
+			break;
+
 		case SO_PRIORITY:
 			if (IS_ENABLED(CONFIG_NET_CONTEXT_PRIORITY)) {
 				ret = net_context_set_option(ctx,
@@ -1389,6 +1664,27 @@ int zsock_setsockopt_ctx(struct net_context *ctx, int level, int optname,
 				return 0;
 			}
 
+			break;
+
+		case SO_ATTACH_FILTER:
+		case SO_DETACH_FILTER:
+			if (IS_ENABLED(CONFIG_NET_BPF)) {
+				if (optname == SO_DETACH_FILTER) {
+					optval = NULL;
+					optlen = 0;
+				}
+
+				ret = net_context_set_option(ctx,
+							     NET_OPT_BPF_FILTER,
+							     optval, optlen);
+				if (ret < 0) {
+					errno = -ret;
+					return -1;
+				}
+
+				return 0;
+			}
+
 			break;
 		}
 
@@ -1435,6 +1731,34 @@ int z_vrfy_zsock_setsockopt(int sock, int level, int optname,
 	kernel_optval = z_user_alloc_from_copy((const void *)optval, optlen);
 	Z_OOPS(!kernel_optval);
 
+#if defined(CONFIG_NET_BPF)
+	if (level == SOL_SOCKET && optname == SO_ATTACH_FILTER &&
+	    optlen == sizeof(struct sock_fprog)) {
+		/* The program is not part of the option value */
+		struct sock_fprog *prog = kernel_optval;
+		size_t size = prog->len * sizeof(struct sock_filter);
+		void *insns = NULL;
+
+		if (prog->len > 0 && prog->len <= BPF_MAXINSNS) {
+			insns = z_user_alloc_from_copy(prog->filter, size);
+			if (!insns) {
+				k_free(kernel_optval);
+				Z_OOPS(1);
+			}
+		}
+
+		prog->filter = insns;
+
+		ret = z_impl_zsock_setsockopt(sock, level, optname,
+					      kernel_optval, optlen);
+
+		k_free(insns);
+		k_free(kernel_optval);
+
+		return ret;
+	}
+#endif
+
 	ret = z_impl_zsock_setsockopt(sock, level, optname,
 				      kernel_optval, optlen);
 
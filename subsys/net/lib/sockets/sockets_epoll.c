@@ -0,0 +1,470 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <kernel.h>
+#include <errno.h>
+#include <sys/slist.h>
+#include <sys/fdtable.h>
+#include <net/net_context.h>
+#include <net/socket.h>
+
+#include "sockets_internal.h"
+
+extern const struct socket_op_vtable sock_fd_op_vtable;
+
+/* Event set created by zsock_epoll_create() */
+struct epoll_set {
+	/* Given when a socket of the set is put on the ready list */
+	struct k_sem wait;
+
+	/* All the registered sockets */
+	sys_slist_t items;
+
+	/* Registered sockets that may have events */
+	sys_slist_t ready;
+
+	bool in_use;
+};
+
+/* Registration of a socket in an event set */
+struct epoll_item {
+	/* Node in the items list of the set */
+	sys_snode_t set_node;
+
+	/* Node in the ready list of the set */
+	sys_snode_t ready_node;
+
+	/* Node in the epoll_items list of the context */
+	sys_snode_t ctx_node;
+
+	struct epoll_set *set;
+	struct net_context *ctx;
+	struct zsock_epoll_event event;
+	int fd;
+
+	/* On the ready list */
+	bool ready;
+
+	/* ZSOCK_EPOLLONESHOT registration that has been reported */
+	bool disabled;
+};
+
+static struct epoll_set sets[CONFIG_NET_SOCKETS_EPOLL_MAX];
+static struct epoll_item items[CONFIG_NET_SOCKETS_EPOLL_ENTRIES];
+
+/* Protects the sets, the items and the epoll_items lists of the contexts,
+ * which are also used from the receive and accept callbacks.
+ */
+static struct k_spinlock lock;
+
+static const struct fd_op_vtable epoll_fd_op_vtable;
+
+/* As with poll(), sockets are considered always writable */
+static u32_t epoll_ctx_events(struct net_context *ctx)
+{
+	u32_t events = ZSOCK_EPOLLOUT;
+
+	/* recv_q and accept_q are in union */
+	if (!k_fifo_is_empty(&ctx->recv_q)) {
+		events |= ZSOCK_EPOLLIN;
+	}
+
+	if (sock_is_eof(ctx)) {
+		events |= ZSOCK_EPOLLIN | ZSOCK_EPOLLHUP;
+	}
+
+	return events;
+}
+
+static u32_t epoll_item_events(struct epoll_item *item)
+{
+	return epoll_ctx_events(item->ctx) &
+		(item->event.events | ZSOCK_EPOLLERR | ZSOCK_EPOLLHUP);
+}
+
+static void epoll_item_queue(struct epoll_item *item)
+{
+	if (item->ready || item->disabled) {
+		return;
+	}
+
+	item->ready = true;
+	sys_slist_append(&item->set->ready, &item->ready_node);
+	k_sem_give(&item->set->wait);
+}
+
+static void epoll_item_free(struct epoll_item *item)
+{
+	struct epoll_set *set = item->set;
+
+	if (item->ready) {
+		sys_slist_find_and_remove(&set->ready, &item->ready_node);
+	}
+
+	sys_slist_find_and_remove(&set->items, &item->set_node);
+	sys_slist_find_and_remove(&item->ctx->epoll_items, &item->ctx_node);
+
+	item->set = NULL;
+}
+
+static struct epoll_item *epoll_item_find(struct epoll_set *set, int fd)
+{
+	struct epoll_item *item;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&set->items, item, set_node) {
+		if (item->fd == fd) {
+			return item;
+		}
+	}
+
+	return NULL;
+}
+
+void zsock_epoll_notify(struct net_context *ctx)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	struct epoll_item *item;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&ctx->epoll_items, item, ctx_node) {
+		epoll_item_queue(item);
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+void zsock_epoll_ctx_closed(struct net_context *ctx)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	struct epoll_item *item, *next;
+
+	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&ctx->epoll_items, item, next,
+					  ctx_node) {
+		epoll_item_free(item);
+	}
+
+	k_spin_unlock(&lock, key);
+}
+
+int zsock_epoll_create(int size)
+{
+	struct epoll_set *set = NULL;
+	k_spinlock_key_t key;
+	int fd, i;
+
+	if (size <= 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	fd = z_reserve_fd();
+	if (fd < 0) {
+		return -1;
+	}
+
+	key = k_spin_lock(&lock);
+
+	for (i = 0; i < ARRAY_SIZE(sets); i++) {
+		if (!sets[i].in_use) {
+			set = &sets[i];
+			set->in_use = true;
+			break;
+		}
+	}
+
+	k_spin_unlock(&lock, key);
+
+	if (!set) {
+		z_free_fd(fd);
+		errno = ENFILE;
+		return -1;
+	}
+
+	k_sem_init(&set->wait, 0, 1);
+	sys_slist_init(&set->items);
+	sys_slist_init(&set->ready);
+
+	z_finalize_fd(fd, set, &epoll_fd_op_vtable);
+
+	return fd;
+}
+
+static int epoll_ctl_add(struct epoll_set *set, int fd,
+			 struct net_context *ctx,
+			 struct zsock_epoll_event *event)
+{
+	struct epoll_item *item = NULL;
+	int i;
+
+	if (epoll_item_find(set, fd)) {
+		return -EEXIST;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(items); i++) {
+		if (!items[i].set) {
+			item = &items[i];
+			break;
+		}
+	}
+
+	if (!item) {
+		return -ENOSPC;
+	}
+
+	item->set = set;
+	item->ctx = ctx;
+	item->fd = fd;
+	item->event = *event;
+	item->ready = false;
+	item->disabled = false;
+
+	sys_slist_append(&set->items, &item->set_node);
+	sys_slist_append(&ctx->epoll_items, &item->ctx_node);
+
+	/* Report what is already there, data may not come again */
+	if (epoll_item_events(item)) {
+		epoll_item_queue(item);
+	}
+
+	return 0;
+}
+
+int zsock_epoll_ctl(int epfd, int op, int fd,
+		    struct zsock_epoll_event *event)
+{
+	const struct fd_op_vtable *vtable;
+	struct net_context *ctx;
+	struct epoll_set *set;
+	struct epoll_item *item;
+	k_spinlock_key_t key;
+	int ret = 0;
+
+	set = z_get_fd_obj(epfd, &epoll_fd_op_vtable, EINVAL);
+	if (!set) {
+		return -1;
+	}
+
+	ctx = z_get_fd_obj_and_vtable(fd, &vtable);
+	if (!ctx) {
+		return -1;
+	}
+
+	/* Only native sockets get their readiness from zsock_received_cb() */
+	if (vtable != (const struct fd_op_vtable *)&sock_fd_op_vtable) {
+		errno = EPERM;
+		return -1;
+	}
+
+	if (op != ZSOCK_EPOLL_CTL_DEL && !event) {
+		errno = EFAULT;
+		return -1;
+	}
+
+	key = k_spin_lock(&lock);
+
+	switch (op) {
+	case ZSOCK_EPOLL_CTL_ADD:
+		ret = epoll_ctl_add(set, fd, ctx, event);
+		break;
+
+	case ZSOCK_EPOLL_CTL_MOD:
+		item = epoll_item_find(set, fd);
+		if (!item) {
+			ret = -ENOENT;
+			break;
+		}
+
+		item->event = *event;
+		item->disabled = false;
+
+		if (epoll_item_events(item)) {
+			epoll_item_queue(item);
+		}
+
+		break;
+
+	case ZSOCK_EPOLL_CTL_DEL:
+		item = epoll_item_find(set, fd);
+		if (!item) {
+			ret = -ENOENT;
+			break;
+		}
+
+		epoll_item_free(item);
+		break;
+
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	k_spin_unlock(&lock, key);
+
+	if (ret < 0) {
+		errno = -ret;
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Take the ready sockets off the ready list, the level-triggered ones
+ * that still have events are put back at its tail.
+ */
+static int epoll_collect(struct epoll_set *set,
+			 struct zsock_epoll_event *events, int maxevents)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	struct epoll_item *item;
+	sys_slist_t requeue;
+	sys_snode_t *node;
+	u32_t revents;
+	int count = 0;
+
+	sys_slist_init(&requeue);
+
+	while (count < maxevents) {
+		node = sys_slist_get(&set->ready);
+		if (!node) {
+			break;
+		}
+
+		item = CONTAINER_OF(node, struct epoll_item, ready_node);
+
+		revents = epoll_item_events(item);
+		if (!revents) {
+			item->ready = false;
+			continue;
+		}
+
+		events[count].events = revents;
+		events[count].data = item->event.data;
+		count++;
+
+		if (item->event.events & ZSOCK_EPOLLONESHOT) {
+			item->ready = false;
+			item->disabled = true;
+		} else if (item->event.events & ZSOCK_EPOLLET) {
+			item->ready = false;
+		} else {
+			sys_slist_append(&requeue, node);
+		}
+	}
+
+	sys_slist_merge_slist(&set->ready, &requeue);
+
+	k_spin_unlock(&lock, key);
+
+	return count;
+}
+
+static inline int time_left(u32_t start, u32_t timeout)
+{
+	u32_t elapsed = k_uptime_get_32() - start;
+
+	return timeout - elapsed;
+}
+
+int zsock_epoll_wait(int epfd, struct zsock_epoll_event *events,
+		     int maxevents, int timeout)
+{
+	u32_t entry_time = k_uptime_get_32();
+	struct epoll_set *set;
+	int remaining_time = timeout;
+	int count;
+
+	set = z_get_fd_obj(epfd, &epoll_fd_op_vtable, EINVAL);
+	if (!set) {
+		return -1;
+	}
+
+	if (maxevents <= 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (timeout < 0) {
+		timeout = K_FOREVER;
+	}
+
+	while (true) {
+		count = epoll_collect(set, events, maxevents);
+		if (count > 0) {
+			return count;
+		}
+
+		if (timeout != K_FOREVER) {
+			remaining_time = time_left(entry_time, timeout);
+			if (remaining_time <= 0) {
+				return 0;
+			}
+		} else {
+			remaining_time = K_FOREVER;
+		}
+
+		/* The semaphore may have been given for sockets collected
+		 * already, so check the ready list again even if taken.
+		 */
+		if (k_sem_take(&set->wait, remaining_time) < 0) {
+			return epoll_collect(set, events, maxevents);
+		}
+	}
+}
+
+static int epoll_close(struct epoll_set *set)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	struct epoll_item *item, *next;
+
+	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&set->items, item, next, set_node) {
+		epoll_item_free(item);
+	}
+
+	set->in_use = false;
+
+	k_spin_unlock(&lock, key);
+
+	return 0;
+}
+
+static ssize_t epoll_read_vmeth(void *obj, void *buffer, size_t count)
+{
+	ARG_UNUSED(obj);
+	ARG_UNUSED(buffer);
+	ARG_UNUSED(count);
+
+	errno = EINVAL;
+	return -1;
+}
+
+static ssize_t epoll_write_vmeth(void *obj, const void *buffer, size_t count)
+{
+	ARG_UNUSED(obj);
+	ARG_UNUSED(buffer);
+	ARG_UNUSED(count);
+
+	errno = EINVAL;
+	return -1;
+}
+
+static int epoll_ioctl_vmeth(void *obj, unsigned int request, va_list args)
+{
+	ARG_UNUSED(args);
+
+	switch (request) {
+	case ZFD_IOCTL_CLOSE:
+		return epoll_close(obj);
+
+	default:
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+}
+
+static const struct fd_op_vtable epoll_fd_op_vtable = {
+	.read = epoll_read_vmeth,
+	.write = epoll_write_vmeth,
+	.ioctl = epoll_ioctl_vmeth,
+};
@@ -48,4 +48,19 @@ struct socket_op_vtable {
 	ssize_t (*sendmsg)(void *obj, const struct msghdr *msg, int flags);
 };
 
+#if defined(CONFIG_NET_SOCKETS_EPOLL)
+void zsock_epoll_notify(struct net_context *ctx);
+void zsock_epoll_ctx_closed(struct net_context *ctx);
+#else
+static inline void zsock_epoll_notify(struct net_context *ctx)
+{
+	ARG_UNUSED(ctx);
+}
+
+static inline void zsock_epoll_ctx_closed(struct net_context *ctx)
+{
+	ARG_UNUSED(ctx);
+}
+#endif /* CONFIG_NET_SOCKETS_EPOLL */
+
 #endif /* _SOCKETS_INTERNAL_H_ */
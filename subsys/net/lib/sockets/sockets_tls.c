@@ -34,6 +34,25 @@ LOG_MODULE_REGISTER(net_sock_tls, CONFIG_NET_SOCKETS_LOG_LEVEL);
 #include <mbedtls/ssl_cookie.h>
 #include <mbedtls/error.h>
 #include <mbedtls/debug.h>
+#if defined(MBEDTLS_SSL_CACHE_C)
+#include <mbedtls/ssl_cache.h>
+#endif
+#if defined(MBEDTLS_SSL_TICKET_C)
+#include <mbedtls/ssl_ticket.h>
+#endif
+#if defined(MBEDTLS_MEMORY_BUFFER_ALLOC_C) && defined(MBEDTLS_MEMORY_DEBUG)
+#include <mbedtls/memory_buffer_alloc.h>
+#define TLS_HANDSHAKE_MEM_STATS
+#endif
+#if defined(CONFIG_NET_SOCKETS_TLS_STATIC_BUFFERS)
+#if !defined(MBEDTLS_PLATFORM_MEMORY) || \
+	defined(MBEDTLS_MEMORY_BUFFER_ALLOC_C)
+#error "Static TLS buffers need MBEDTLS_PLATFORM_MEMORY and no mbedTLS heap"
+#endif
+#include <stdlib.h>
+#include <mbedtls/platform.h>
+#include <mbedtls/ssl_internal.h>
+#endif
 #endif /* CONFIG_MBEDTLS */
 
 #include "sockets_internal.h"
@@ -43,6 +62,16 @@ extern const struct socket_op_vtable sock_fd_op_vtable;
 
 static const struct socket_op_vtable tls_sock_fd_op_vtable;
 
+#if defined(CONFIG_NET_SOCKETS_TLS_MAX_FRAGMENT_LENGTH_512)
+#define TLS_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_512
+#elif defined(CONFIG_NET_SOCKETS_TLS_MAX_FRAGMENT_LENGTH_1024)
+#define TLS_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_1024
+#elif defined(CONFIG_NET_SOCKETS_TLS_MAX_FRAGMENT_LENGTH_2048)
+#define TLS_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_2048
+#elif defined(CONFIG_NET_SOCKETS_TLS_MAX_FRAGMENT_LENGTH_4096)
+#define TLS_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_4096
+#endif
+
 /** A list of secure tags that TLS context should use. */
 struct sec_tag_list {
 	/** An array of secure tags referencing TLS credentials. */
@@ -85,6 +114,28 @@ struct tls_context {
 	/** Information whether TLS handshake is complete or not. */
 	struct k_sem tls_established;
 
+	/** Information whether a handshake is running on the context. */
+	bool handshake_running;
+
+	/** Information whether the last handshake resumed a session. */
+	bool session_resumed;
+
+#if defined(CONFIG_NET_SOCKETS_TLS_STATIC_BUFFERS)
+	/** The static record input buffer is given to mbedTLS. */
+	bool in_buf_used;
+
+	/** The static record output buffer is given to mbedTLS. */
+	bool out_buf_used;
+#endif
+
+#if defined(TLS_HANDSHAKE_MEM_STATS)
+	/** mbedTLS heap use when the handshake started. */
+	size_t mem_start;
+
+	/** Peak mbedTLS heap use of the last handshake, above mem_start. */
+	size_t mem_peak;
+#endif
+
 	/** TLS specific option values. */
 	struct {
 		/** Select which credentials to use with TLS. */
@@ -102,6 +153,9 @@ struct tls_context {
 
 		/** DTLS role, client by default. */
 		s8_t role;
+
+		/** Information if sessions are stored for resumption. */
+		bool cache_enabled;
 	} options;
 
 #if defined(CONFIG_NET_SOCKETS_ENABLE_DTLS)
@@ -139,14 +193,84 @@ struct tls_context {
 #endif /* CONFIG_MBEDTLS */
 };
 
+/** A client session stored for resumption. */
+struct tls_session_cache {
+	/** Information whether the entry is used. */
+	bool is_used;
+
+	/** Time when the session was stored. */
+	u32_t timestamp;
+
+	/** Peer address the session was established with. */
+	struct sockaddr peer_addr;
+
+	/** Hostname the server was verified against, empty if none. */
+	char hostname[CONFIG_NET_SOCKETS_TLS_SESSION_HOSTNAME_LEN + 1];
+
+	/** Credentials the session was established with. */
+	struct sec_tag_list sec_tag_list;
+
+	/** mbedTLS session, including the session ticket if any. */
+	mbedtls_ssl_session session;
+};
+
 static mbedtls_ctr_drbg_context tls_ctr_drbg;
 
+/* Client sessions, the oldest one is replaced when all are used. */
+static struct tls_session_cache
+	client_cache[CONFIG_NET_SOCKETS_TLS_MAX_CLIENT_SESSION_COUNT];
+
+/* A mutex for protecting the client session cache. */
+static struct k_mutex session_cache_lock;
+
+/* A mutex for protecting the server session cache and ticket key, which
+ * the handshakes of several server sockets can use at the same time.
+ */
+static struct k_mutex server_session_lock;
+
+#if defined(MBEDTLS_SSL_CACHE_C)
+/* Server side session cache, shared by all the server sockets. */
+static mbedtls_ssl_cache_context server_cache;
+#endif
+
+#if defined(MBEDTLS_SSL_TICKET_C)
+/* Key for the session tickets issued by the server sockets. */
+static mbedtls_ssl_ticket_context server_ticket;
+static bool server_ticket_ready;
+#endif
+
 /* A global pool of TLS contexts. */
 static struct tls_context tls_contexts[CONFIG_NET_SOCKETS_TLS_MAX_CONTEXTS];
 
 /* A mutex for protecting TLS context allocation. */
 static struct k_mutex context_lock;
 
+#if CONFIG_NET_SOCKETS_TLS_MAX_HANDSHAKES > 0
+/* Bounds the heap memory used by the handshakes running at the same time. */
+static K_SEM_DEFINE(handshake_slots, CONFIG_NET_SOCKETS_TLS_MAX_HANDSHAKES,
+		    CONFIG_NET_SOCKETS_TLS_MAX_HANDSHAKES);
+#endif
+
+#if defined(TLS_HANDSHAKE_MEM_STATS)
+/* Number of handshakes sharing the maximum of the mbedTLS heap use. */
+static int handshakes_measured;
+#endif
+
+#if defined(CONFIG_NET_SOCKETS_TLS_STATIC_BUFFERS)
+/* Record buffers of each TLS context, taken by mbedtls_ssl_setup(). */
+static u8_t tls_in_bufs[CONFIG_NET_SOCKETS_TLS_MAX_CONTEXTS]
+		       [MBEDTLS_SSL_IN_BUFFER_LEN] __aligned(4);
+static u8_t tls_out_bufs[CONFIG_NET_SOCKETS_TLS_MAX_CONTEXTS]
+			[MBEDTLS_SSL_OUT_BUFFER_LEN] __aligned(4);
+
+/* Context being set up, and the thread doing it. Allocations of other
+ * threads meanwhile go to the heap.
+ */
+static struct tls_context *tls_bufs_owner;
+static k_tid_t tls_bufs_thread;
+static K_MUTEX_DEFINE(tls_bufs_lock);
+#endif
+
 #define IS_LISTENING(context) (net_context_get_state(context) == \
 			       NET_CONTEXT_LISTENING)
 
@@ -250,6 +374,76 @@ static int dtls_timing_get_delay(void *data)
 }
 #endif /* CONFIG_NET_SOCKETS_ENABLE_DTLS */
 
+#if defined(CONFIG_NET_SOCKETS_TLS_STATIC_BUFFERS)
+static void *tls_bufs_calloc(size_t n, size_t size)
+{
+	struct tls_context *tls = tls_bufs_owner;
+	int i;
+
+	if (tls && tls_bufs_thread == k_current_get() && n == 1) {
+		i = tls - tls_contexts;
+
+		/* The input buffer is allocated first if both have the
+		 * same length.
+		 */
+		if (size == MBEDTLS_SSL_IN_BUFFER_LEN && !tls->in_buf_used) {
+			tls->in_buf_used = true;
+			(void)memset(tls_in_bufs[i], 0, size);
+			return tls_in_bufs[i];
+		}
+
+		if (size == MBEDTLS_SSL_OUT_BUFFER_LEN && !tls->out_buf_used) {
+			tls->out_buf_used = true;
+			(void)memset(tls_out_bufs[i], 0, size);
+			return tls_out_bufs[i];
+		}
+	}
+
+	return calloc(n, size);
+}
+
+static void tls_bufs_free(void *ptr)
+{
+	u8_t *buf = ptr;
+	int i;
+
+	if (buf >= tls_in_bufs[0] &&
+	    buf < tls_in_bufs[ARRAY_SIZE(tls_in_bufs)]) {
+		i = (buf - tls_in_bufs[0]) / sizeof(tls_in_bufs[0]);
+		tls_contexts[i].in_buf_used = false;
+		return;
+	}
+
+	if (buf >= tls_out_bufs[0] &&
+	    buf < tls_out_bufs[ARRAY_SIZE(tls_out_bufs)]) {
+		i = (buf - tls_out_bufs[0]) / sizeof(tls_out_bufs[0]);
+		tls_contexts[i].out_buf_used = false;
+		return;
+	}
+
+	free(ptr);
+}
+
+/* mbedtls_ssl_setup() called in between gets the static buffers of the
+ * context for its records.
+ */
+static void tls_bufs_begin(struct tls_context *tls)
+{
+	k_mutex_lock(&tls_bufs_lock, K_FOREVER);
+
+	tls_bufs_thread = k_current_get();
+	tls_bufs_owner = tls;
+}
+
+static void tls_bufs_end(void)
+{
+	tls_bufs_owner = NULL;
+	tls_bufs_thread = NULL;
+
+	k_mutex_unlock(&tls_bufs_lock);
+}
+#endif /* CONFIG_NET_SOCKETS_TLS_STATIC_BUFFERS */
+
 /* Initialize TLS internals. */
 static int tls_init(struct device *unused)
 {
@@ -275,6 +469,10 @@ static int tls_init(struct device *unused)
 
 	k_mutex_init(&context_lock);
 
+#if defined(CONFIG_NET_SOCKETS_TLS_STATIC_BUFFERS)
+	mbedtls_platform_set_calloc_free(tls_bufs_calloc, tls_bufs_free);
+#endif
+
 	mbedtls_ctr_drbg_init(&tls_ctr_drbg);
 
 	ret = mbedtls_ctr_drbg_seed(&tls_ctr_drbg, tls_entropy_func, dev,
@@ -289,6 +487,33 @@ static int tls_init(struct device *unused)
 	mbedtls_debug_set_threshold(CONFIG_MBEDTLS_DEBUG_LEVEL);
 #endif
 
+	k_mutex_init(&session_cache_lock);
+	k_mutex_init(&server_session_lock);
+
+#if defined(MBEDTLS_SSL_CACHE_C)
+	mbedtls_ssl_cache_init(&server_cache);
+	mbedtls_ssl_cache_set_max_entries(
+		&server_cache, CONFIG_NET_SOCKETS_TLS_MAX_SERVER_SESSION_COUNT);
+#if defined(MBEDTLS_HAVE_TIME)
+	mbedtls_ssl_cache_set_timeout(&server_cache,
+				      CONFIG_NET_SOCKETS_TLS_SESSION_LIFETIME);
+#endif
+#endif /* MBEDTLS_SSL_CACHE_C */
+
+#if defined(MBEDTLS_SSL_TICKET_C)
+	mbedtls_ssl_ticket_init(&server_ticket);
+
+	ret = mbedtls_ssl_ticket_setup(&server_ticket, mbedtls_ctr_drbg_random,
+				       &tls_ctr_drbg,
+				       MBEDTLS_CIPHER_AES_256_GCM,
+				       CONFIG_NET_SOCKETS_TLS_SESSION_LIFETIME);
+	if (ret != 0) {
+		NET_WARN("Cannot set up TLS session tickets (-%x)", -ret);
+	} else {
+		server_ticket_ready = true;
+	}
+#endif /* MBEDTLS_SSL_TICKET_C */
+
 	return 0;
 }
 
@@ -299,6 +524,85 @@ static inline bool is_handshake_complete(struct net_context *ctx)
 	return k_sem_count_get(&ctx->tls->tls_established) != 0;
 }
 
+#if defined(TLS_HANDSHAKE_MEM_STATS)
+static void tls_mem_stats_begin(struct tls_context *tls)
+{
+	size_t used, blocks;
+
+	k_mutex_lock(&context_lock, K_FOREVER);
+
+	mbedtls_memory_buffer_alloc_cur_get(&used, &blocks);
+	tls->mem_start = used;
+
+	/* The maximum is global to the heap, so it is only restarted when no
+	 * other handshake is being measured.
+	 */
+	if (handshakes_measured++ == 0) {
+		mbedtls_memory_buffer_alloc_max_reset();
+	}
+
+	k_mutex_unlock(&context_lock);
+}
+
+static void tls_mem_stats_end(struct tls_context *tls)
+{
+	size_t max_used, max_blocks;
+
+	k_mutex_lock(&context_lock, K_FOREVER);
+
+	mbedtls_memory_buffer_alloc_max_get(&max_used, &max_blocks);
+	tls->mem_peak = max_used > tls->mem_start ?
+		max_used - tls->mem_start : 0;
+
+	handshakes_measured--;
+
+	k_mutex_unlock(&context_lock);
+
+	NET_DBG("Handshake of TLS context %p used up to %zu bytes", tls,
+		tls->mem_peak);
+}
+#endif /* TLS_HANDSHAKE_MEM_STATS */
+
+/* Take a handshake slot for the context, unless it already has one. */
+static int tls_handshake_begin(struct tls_context *tls, bool block)
+{
+	if (tls->handshake_running) {
+		return 0;
+	}
+
+#if CONFIG_NET_SOCKETS_TLS_MAX_HANDSHAKES > 0
+	if (k_sem_take(&handshake_slots, block ? K_FOREVER : K_NO_WAIT)) {
+		return -EAGAIN;
+	}
+#endif
+
+	tls->handshake_running = true;
+
+#if defined(TLS_HANDSHAKE_MEM_STATS)
+	tls_mem_stats_begin(tls);
+#endif
+
+	return 0;
+}
+
+/* Give back the handshake slot once the handshake succeeded or failed. */
+static void tls_handshake_end(struct tls_context *tls)
+{
+	if (!tls->handshake_running) {
+		return;
+	}
+
+	tls->handshake_running = false;
+
+#if defined(TLS_HANDSHAKE_MEM_STATS)
+	tls_mem_stats_end(tls);
+#endif
+
+#if CONFIG_NET_SOCKETS_TLS_MAX_HANDSHAKES > 0
+	k_sem_give(&handshake_slots);
+#endif
+}
+
 /* Allocate TLS context. */
 static struct tls_context *tls_alloc(void)
 {
@@ -394,6 +698,8 @@ static int tls_release(struct tls_context *tls)
 	mbedtls_pk_free(&tls->priv_key);
 #endif
 
+	tls_handshake_end(tls);
+
 	tls->is_used = false;
 
 	return 0;
@@ -753,6 +1059,273 @@ exit:
 	return err;
 }
 
+static bool tls_peer_addr_cmp(const struct sockaddr *addr1,
+			      const struct sockaddr *addr2)
+{
+	if (addr1->sa_family != addr2->sa_family) {
+		return false;
+	}
+
+	if (IS_ENABLED(CONFIG_NET_IPV6) && addr1->sa_family == AF_INET6) {
+		struct sockaddr_in6 *in6_1 = net_sin6(addr1);
+		struct sockaddr_in6 *in6_2 = net_sin6(addr2);
+
+		return (in6_1->sin6_port == in6_2->sin6_port) &&
+			net_ipv6_addr_cmp(&in6_1->sin6_addr, &in6_2->sin6_addr);
+	} else if (IS_ENABLED(CONFIG_NET_IPV4) &&
+		   addr1->sa_family == AF_INET) {
+		struct sockaddr_in *in_1 = net_sin(addr1);
+		struct sockaddr_in *in_2 = net_sin(addr2);
+
+		return (in_1->sin_port == in_2->sin_port) &&
+			net_ipv4_addr_cmp(&in_1->sin_addr, &in_2->sin_addr);
+	}
+
+	return false;
+}
+
+/* Address of the peer of a client socket, NULL if not known yet. */
+static const struct sockaddr *tls_peer_addr(struct net_context *context)
+{
+#if defined(CONFIG_NET_SOCKETS_ENABLE_DTLS)
+	if (net_context_get_type(context) == SOCK_DGRAM) {
+		if (context->tls->dtls_peer_addrlen == 0) {
+			return NULL;
+		}
+
+		return &context->tls->dtls_peer_addr;
+	}
+#endif
+
+	if (context->remote.sa_family == AF_UNSPEC) {
+		return NULL;
+	}
+
+	return &context->remote;
+}
+
+/* Hostname set on a client socket, empty if none. */
+static const char *tls_session_hostname(struct tls_context *tls)
+{
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+	if (tls->ssl.hostname) {
+		return tls->ssl.hostname;
+	}
+#endif
+
+	return "";
+}
+
+static bool tls_sec_tag_list_cmp(const struct sec_tag_list *list1,
+				 const struct sec_tag_list *list2)
+{
+	return list1->sec_tag_count == list2->sec_tag_count &&
+		memcmp(list1->sec_tags, list2->sec_tags,
+		       list1->sec_tag_count * sizeof(sec_tag_t)) == 0;
+}
+
+/* A session is only offered again to the same peer, for the same server
+ * name and with the same credentials, as the resumed session skips the
+ * verification of the server certificate.
+ */
+static struct tls_session_cache *tls_session_find(
+					const struct sockaddr *peer_addr,
+					struct tls_context *tls)
+{
+	const char *hostname = tls_session_hostname(tls);
+	struct tls_session_cache *entry;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(client_cache); i++) {
+		entry = &client_cache[i];
+
+		if (entry->is_used &&
+		    tls_peer_addr_cmp(&entry->peer_addr, peer_addr) &&
+		    strcmp(entry->hostname, hostname) == 0 &&
+		    tls_sec_tag_list_cmp(&entry->sec_tag_list,
+					 &tls->options.sec_tag_list)) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/* Store the session of a client after a successful handshake, so that the
+ * next connection to the same peer can resume it.
+ */
+static void tls_session_store(struct net_context *context)
+{
+	const struct sockaddr *peer_addr = tls_peer_addr(context);
+	const char *hostname = tls_session_hostname(context->tls);
+	struct tls_session_cache *entry;
+	int i, ret;
+
+	context->tls->session_resumed = false;
+
+	if (!peer_addr) {
+		return;
+	}
+
+	if (strlen(hostname) >= sizeof(entry->hostname)) {
+		NET_DBG("Hostname too long to store TLS session");
+		return;
+	}
+
+	k_mutex_lock(&session_cache_lock, K_FOREVER);
+
+	entry = tls_session_find(peer_addr, context->tls);
+
+	/* A resumed session keeps the master secret of the stored one, a
+	 * full handshake always derives a new one.
+	 */
+	if (entry && context->tls->ssl.session &&
+	    memcmp(entry->session.master, context->tls->ssl.session->master,
+		   sizeof(entry->session.master)) == 0) {
+		context->tls->session_resumed = true;
+	}
+
+	if (!entry) {
+		entry = &client_cache[0];
+
+		for (i = 0; i < ARRAY_SIZE(client_cache); i++) {
+			if (!client_cache[i].is_used) {
+				entry = &client_cache[i];
+				break;
+			}
+
+			if ((s32_t)(client_cache[i].timestamp -
+				    entry->timestamp) < 0) {
+				entry = &client_cache[i];
+			}
+		}
+	}
+
+	if (entry->is_used) {
+		mbedtls_ssl_session_free(&entry->session);
+	}
+
+	mbedtls_ssl_session_init(&entry->session);
+
+	ret = mbedtls_ssl_get_session(&context->tls->ssl, &entry->session);
+	if (ret != 0) {
+		NET_DBG("Cannot store TLS session (-%x)", -ret);
+		mbedtls_ssl_session_free(&entry->session);
+		entry->is_used = false;
+		goto out;
+	}
+
+	memcpy(&entry->peer_addr, peer_addr, sizeof(entry->peer_addr));
+	strcpy(entry->hostname, hostname);
+	memcpy(&entry->sec_tag_list, &context->tls->options.sec_tag_list,
+	       sizeof(entry->sec_tag_list));
+	entry->timestamp = k_uptime_get_32();
+	entry->is_used = true;
+
+out:
+	k_mutex_unlock(&session_cache_lock);
+}
+
+/* Offer the stored session of the peer, if any, in the client hello. */
+static void tls_session_restore(struct net_context *context)
+{
+	const struct sockaddr *peer_addr = tls_peer_addr(context);
+	struct tls_session_cache *entry;
+	int ret;
+
+	if (!peer_addr) {
+		return;
+	}
+
+	k_mutex_lock(&session_cache_lock, K_FOREVER);
+
+	entry = tls_session_find(peer_addr, context->tls);
+	if (entry) {
+		ret = mbedtls_ssl_set_session(&context->tls->ssl,
+					      &entry->session);
+		if (ret != 0) {
+			NET_DBG("Cannot restore TLS session (-%x)", -ret);
+		}
+	}
+
+	k_mutex_unlock(&session_cache_lock);
+}
+
+#if defined(MBEDTLS_SSL_CACHE_C)
+static int tls_server_cache_get(void *data, mbedtls_ssl_session *session)
+{
+	int ret;
+
+	k_mutex_lock(&server_session_lock, K_FOREVER);
+	ret = mbedtls_ssl_cache_get(data, session);
+	k_mutex_unlock(&server_session_lock);
+
+	return ret;
+}
+
+static int tls_server_cache_set(void *data,
+				const mbedtls_ssl_session *session)
+{
+	int ret;
+
+	k_mutex_lock(&server_session_lock, K_FOREVER);
+	ret = mbedtls_ssl_cache_set(data, session);
+	k_mutex_unlock(&server_session_lock);
+
+	return ret;
+}
+#endif /* MBEDTLS_SSL_CACHE_C */
+
+#if defined(MBEDTLS_SSL_TICKET_C)
+static int tls_server_ticket_write(void *ticket,
+				   const mbedtls_ssl_session *session,
+				   unsigned char *start,
+				   const unsigned char *end,
+				   size_t *tlen, uint32_t *lifetime)
+{
+	int ret;
+
+	k_mutex_lock(&server_session_lock, K_FOREVER);
+	ret = mbedtls_ssl_ticket_write(ticket, session, start, end, tlen,
+				       lifetime);
+	k_mutex_unlock(&server_session_lock);
+
+	return ret;
+}
+
+static int tls_server_ticket_parse(void *ticket,
+				   mbedtls_ssl_session *session,
+				   unsigned char *buf, size_t len)
+{
+	int ret;
+
+	k_mutex_lock(&server_session_lock, K_FOREVER);
+	ret = mbedtls_ssl_ticket_parse(ticket, session, buf, len);
+	k_mutex_unlock(&server_session_lock);
+
+	return ret;
+}
+#endif /* MBEDTLS_SSL_TICKET_C */
+
+/* Server side sessions are not purged, as the mbedTLS cache can be in use by
+ * a handshake. They expire after CONFIG_NET_SOCKETS_TLS_SESSION_LIFETIME.
+ */
+static void tls_session_purge(void)
+{
+	int i;
+
+	k_mutex_lock(&session_cache_lock, K_FOREVER);
+
+	for (i = 0; i < ARRAY_SIZE(client_cache); i++) {
+		if (client_cache[i].is_used) {
+			mbedtls_ssl_session_free(&client_cache[i].session);
+			client_cache[i].is_used = false;
+		}
+	}
+
+	k_mutex_unlock(&session_cache_lock);
+}
+
 static int tls_mbedtls_reset(struct net_context *context)
 {
 	int ret;
@@ -777,6 +1350,11 @@ static int tls_mbedtls_handshake(struct net_context *context, bool block)
 {
 	int ret;
 
+	ret = tls_handshake_begin(context->tls, block);
+	if (ret < 0) {
+		return ret;
+	}
+
 	while ((ret = mbedtls_ssl_handshake(&context->tls->ssl)) != 0) {
 		if (ret == MBEDTLS_ERR_SSL_WANT_READ ||
 		    ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
@@ -803,7 +1381,16 @@ static int tls_mbedtls_handshake(struct net_context *context, bool block)
 		break;
 	}
 
+	if (ret != -EAGAIN) {
+		tls_handshake_end(context->tls);
+	}
+
 	if (ret == 0) {
+		if (context->tls->options.cache_enabled &&
+		    context->tls->config.endpoint == MBEDTLS_SSL_IS_CLIENT) {
+			tls_session_store(context);
+		}
+
 		k_sem_give(&context->tls->tls_established);
 	}
 
@@ -900,13 +1487,48 @@ static int tls_mbedtls_init(struct net_context *context, bool is_server)
 			     mbedtls_ctr_drbg_random,
 			     &tls_ctr_drbg);
 
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH) && defined(TLS_MAX_FRAG_LEN)
+	/* Servers follow the length requested by the client */
+	if (!is_server) {
+		(void)mbedtls_ssl_conf_max_frag_len(&context->tls->config,
+						    TLS_MAX_FRAG_LEN);
+	}
+#endif
+
+	if (is_server && context->tls->options.cache_enabled) {
+#if defined(MBEDTLS_SSL_CACHE_C)
+		mbedtls_ssl_conf_session_cache(&context->tls->config,
+					       &server_cache,
+					       tls_server_cache_get,
+					       tls_server_cache_set);
+#endif
+#if defined(MBEDTLS_SSL_TICKET_C)
+		if (server_ticket_ready) {
+			mbedtls_ssl_conf_session_tickets_cb(
+				&context->tls->config,
+				tls_server_ticket_write,
+				tls_server_ticket_parse,
+				&server_ticket);
+		}
+#endif
+	}
+
 	ret = tls_mbedtls_set_credentials(context->tls);
 	if (ret != 0) {
 		return ret;
 	}
 
+#if defined(CONFIG_NET_SOCKETS_TLS_STATIC_BUFFERS)
+	tls_bufs_begin(context->tls);
+#endif
+
 	ret = mbedtls_ssl_setup(&context->tls->ssl,
 				&context->tls->config);
+
+#if defined(CONFIG_NET_SOCKETS_TLS_STATIC_BUFFERS)
+	tls_bufs_end();
+#endif
+
 	if (ret != 0) {
 		/* According to mbedTLS API documentation,
 		 * mbedtls_ssl_setup can fail due to memory allocation failure
@@ -914,6 +1536,10 @@ static int tls_mbedtls_init(struct net_context *context, bool is_server)
 		return -ENOMEM;
 	}
 
+	if (!is_server && context->tls->options.cache_enabled) {
+		tls_session_restore(context);
+	}
+
 	context->tls->is_initialized = true;
 
 	return 0;
@@ -1057,6 +1683,34 @@ static int tls_opt_ciphersuite_used_get(struct net_context *context,
 	return 0;
 }
 
+static int tls_opt_handshake_mem_peak_get(struct net_context *context,
+					  void *optval, socklen_t *optlen)
+{
+	if (*optlen != sizeof(int)) {
+		return -EINVAL;
+	}
+
+#if defined(TLS_HANDSHAKE_MEM_STATS)
+	*(int *)optval = context->tls->mem_peak;
+
+	return 0;
+#else
+	return -ENOTSUP;
+#endif
+}
+
+static int tls_opt_session_resumed_get(struct net_context *context,
+				       void *optval, socklen_t *optlen)
+{
+	if (*optlen != sizeof(int)) {
+		return -EINVAL;
+	}
+
+	*(int *)optval = context->tls->session_resumed;
+
+	return 0;
+}
+
 static int tls_opt_peer_verify_set(struct net_context *context,
 				   const void *optval, socklen_t optlen)
 {
@@ -1107,6 +1761,43 @@ static int tls_opt_dtls_role_set(struct net_context *context,
 	return 0;
 }
 
+static int tls_opt_session_cache_set(struct net_context *context,
+				     const void *optval, socklen_t optlen)
+{
+	int *cache;
+
+	if (!optval) {
+		return -EINVAL;
+	}
+
+	if (optlen != sizeof(int)) {
+		return -EINVAL;
+	}
+
+	cache = (int *)optval;
+	if (*cache != TLS_SESSION_CACHE_DISABLED &&
+	    *cache != TLS_SESSION_CACHE_ENABLED) {
+		return -EINVAL;
+	}
+
+	context->tls->options.cache_enabled = *cache;
+
+	return 0;
+}
+
+static int tls_opt_session_cache_get(struct net_context *context,
+				     void *optval, socklen_t *optlen)
+{
+	if (*optlen != sizeof(int)) {
+		return -EINVAL;
+	}
+
+	*(int *)optval = context->tls->options.cache_enabled ?
+		TLS_SESSION_CACHE_ENABLED : TLS_SESSION_CACHE_DISABLED;
+
+	return 0;
+}
+
 static int ztls_socket(int family, int type, int proto)
 {
 	enum net_ip_protocol_secure tls_proto = 0;
@@ -1867,6 +2558,18 @@ int ztls_getsockopt_ctx(struct net_context *ctx, int level, int optname,
 		err = tls_opt_ciphersuite_used_get(ctx, optval, optlen);
 		break;
 
+	case TLS_SESSION_CACHE:
+		err = tls_opt_session_cache_get(ctx, optval, optlen);
+		break;
+
+	case TLS_HANDSHAKE_MEM_PEAK:
+		err = tls_opt_handshake_mem_peak_get(ctx, optval, optlen);
+		break;
+
+	case TLS_SESSION_RESUMED:
+		err = tls_opt_session_resumed_get(ctx, optval, optlen);
+		break;
+
 	default:
 		/* Unknown or write-only option. */
 		err = -ENOPROTOOPT;
@@ -1917,6 +2620,15 @@ int ztls_setsockopt_ctx(struct net_context *ctx, int level, int optname,
 		err = tls_opt_dtls_role_set(ctx, optval, optlen);
 		break;
 
+	case TLS_SESSION_CACHE:
+		err = tls_opt_session_cache_set(ctx, optval, optlen);
+		break;
+
+	case TLS_SESSION_CACHE_PURGE:
+		tls_session_purge();
+		err = 0;
+		break;
+
 	default:
 		/* Unknown or read-only option. */
 		err = -ENOPROTOOPT;
@@ -365,6 +365,7 @@ int websocket_connect(int sock, struct websocket_request *wreq,
 	}
 
 	ctx->sock = fd;
+	ctx->is_client = 1;
 
 #ifdef CONFIG_USERSPACE
 	/* Set net context object as initialized and grant access to the
@@ -405,6 +406,54 @@ out:
 	return ret;
 }
 
+int websocket_register(int sock, u8_t *recv_buf, size_t recv_buf_len)
+{
+	struct websocket_context *ctx;
+	int fd;
+
+	if (sock < 0 || recv_buf == NULL || recv_buf_len == 0) {
+		return -EINVAL;
+	}
+
+	ctx = websocket_find(sock);
+	if (ctx) {
+		NET_DBG("[%p] Websocket for sock %d already exists!", ctx,
+			sock);
+		return -EEXIST;
+	}
+
+	ctx = websocket_get();
+	if (!ctx) {
+		return -ENOENT;
+	}
+
+	fd = z_reserve_fd();
+	if (fd < 0) {
+		websocket_context_unref(ctx);
+		return -ENOSPC;
+	}
+
+	ctx->real_sock = sock;
+	ctx->tmp_buf = recv_buf;
+	ctx->tmp_buf_len = recv_buf_len;
+	ctx->tmp_buf_pos = 0;
+	ctx->header_received = 0;
+	ctx->total_read = 0;
+	ctx->sock = fd;
+	ctx->is_client = 0;
+
+#ifdef CONFIG_USERSPACE
+	z_object_recycle(ctx);
+#endif
+
+	z_finalize_fd(fd, ctx,
+		      (const struct fd_op_vtable *)&websocket_fd_op_vtable);
+
+	NET_DBG("[%p] WS connection from peer registered (fd %d)", ctx, fd);
+
+	return fd;
+}
+
 int websocket_disconnect(int ws_sock)
 {
 	struct websocket_context *ctx;
@@ -866,7 +915,7 @@ static int websocket_send(struct websocket_context *ctx, const u8_t *buf,
 
 	ret = websocket_send_msg(ctx->sock, buf, buf_len,
 				 WEBSOCKET_OPCODE_DATA_TEXT,
-				 true, true, timeout);
+				 ctx->is_client, true, timeout);
 	if (ret < 0) {
 		errno = -ret;
 		return -1;
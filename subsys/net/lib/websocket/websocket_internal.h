@@ -105,6 +105,11 @@ struct websocket_context {
 
 	/** Header received */
 	u8_t header_received : 1;
+
+	/** Was the connection created by websocket_connect(), the messages
+	 * of a client must be masked.
+	 */
+	u8_t is_client : 1;
 };
 
 /**
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* CoAP parse and encode benchmark.
+ *
+ * A request similar to a block-wise LwM2M write is encoded, parsed, and
+ * parsed followed by the option lookups a server does for such a request.
+ * The average time per packet of each step is reported. Compare the
+ * results with and without CONFIG_COAP_OPTION_INDEX.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <string.h>
+
+#include <net/coap.h>
+
+#define ITERATIONS 1000
+#define BUF_SIZE 256
+#define PAYLOAD_LEN 64
+
+static const char * const uri_path[] = { "3303", "0", "5700" };
+static const char * const uri_query[] = { "pmin=10", "pmax=60" };
+
+static const u16_t lookups[] = {
+	COAP_OPTION_OBSERVE,
+	COAP_OPTION_URI_PATH,
+	COAP_OPTION_CONTENT_FORMAT,
+	COAP_OPTION_URI_QUERY,
+	COAP_OPTION_ACCEPT,
+	COAP_OPTION_BLOCK2,
+	COAP_OPTION_BLOCK1,
+	COAP_OPTION_SIZE1,
+};
+
+static u8_t buf[BUF_SIZE];
+static u8_t payload[PAYLOAD_LEN];
+
+static int encode(struct coap_packet *cpkt)
+{
+	static u8_t token[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	int r, i;
+
+	r = coap_packet_init(cpkt, buf, sizeof(buf), 1, COAP_TYPE_CON,
+			     sizeof(token), token, COAP_METHOD_PUT, 0x1234);
+	if (r < 0) {
+		return r;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(uri_path); i++) {
+		r = coap_packet_append_option(cpkt, COAP_OPTION_URI_PATH,
+					      (const u8_t *)uri_path[i],
+					      strlen(uri_path[i]));
+		if (r < 0) {
+			return r;
+		}
+	}
+
+	r = coap_append_option_int(cpkt, COAP_OPTION_CONTENT_FORMAT, 11543);
+	if (r < 0) {
+		return r;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(uri_query); i++) {
+		r = coap_packet_append_option(cpkt, COAP_OPTION_URI_QUERY,
+					      (const u8_t *)uri_query[i],
+					      strlen(uri_query[i]));
+		if (r < 0) {
+			return r;
+		}
+	}
+
+	r = coap_append_option_int(cpkt, COAP_OPTION_BLOCK1, 0x2e);
+	if (r < 0) {
+		return r;
+	}
+
+	r = coap_append_option_int(cpkt, COAP_OPTION_SIZE1, 1024);
+	if (r < 0) {
+		return r;
+	}
+
+	r = coap_packet_append_payload_marker(cpkt);
+	if (r < 0) {
+		return r;
+	}
+
+	return coap_packet_append_payload(cpkt, payload, sizeof(payload));
+}
+
+static int parse(struct coap_packet *cpkt, u16_t len, bool lookup)
+{
+	struct coap_option options[4];
+	int found = 0;
+	int r, i;
+
+	r = coap_packet_parse(cpkt, buf, len, NULL, 0);
+	if (r < 0 || !lookup) {
+		return r;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(lookups); i++) {
+		r = coap_find_options(cpkt, lookups[i], options,
+				      ARRAY_SIZE(options));
+		if (r < 0) {
+			return r;
+		}
+
+		found += r;
+	}
+
+	return found;
+}
+
+void main(void)
+{
+	struct coap_packet cpkt;
+	u32_t start, cycles;
+	u16_t len;
+	int r = 0;
+	int i;
+
+	memset(payload, 0xa5, sizeof(payload));
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < ITERATIONS && r >= 0; i++) {
+		r = encode(&cpkt);
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	if (r < 0) {
+		printk("Cannot encode packet (%d)\n", r);
+		return;
+	}
+
+	printk("coap encode: %u ns\n",
+	       (u32_t)(k_cyc_to_ns_floor64(cycles) / ITERATIONS));
+
+	len = cpkt.offset;
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < ITERATIONS && r >= 0; i++) {
+		r = parse(&cpkt, len, false);
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	if (r < 0) {
+		printk("Cannot parse packet (%d)\n", r);
+		return;
+	}
+
+	printk("coap parse: %u ns\n",
+	       (u32_t)(k_cyc_to_ns_floor64(cycles) / ITERATIONS));
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < ITERATIONS && r >= 0; i++) {
+		r = parse(&cpkt, len, true);
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	/* Uri-Path, Content-Format, Uri-Query, Block1 and Size1 */
+	if (r != ARRAY_SIZE(uri_path) + ARRAY_SIZE(uri_query) + 3) {
+		printk("Unexpected number of options found (%d)\n", r);
+		return;
+	}
+
+	printk("coap parse and %zu lookups: %u ns\n", ARRAY_SIZE(lookups),
+	       (u32_t)(k_cyc_to_ns_floor64(cycles) / ITERATIONS));
+
+	printk("fin\n");
+}
@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* HTTP server throughput and latency benchmark.
+ *
+ * The HTTP server runs in its own thread and is queried over the loopback
+ * interface with the HTTP client library. A static resource is requested
+ * with a new connection for each request, over a kept alive connection of
+ * a client session, and with pipelined requests. A dynamic resource sent
+ * with chunked transfer encoding is requested as well. The number of
+ * requests per second is reported for each case, and the average latency
+ * of a request over a kept alive connection.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <string.h>
+
+#include <net/socket.h>
+#include <net/http_client.h>
+#include <net/http_server.h>
+
+#define N_REQUESTS 500
+#define N_CONNECTIONS 100
+#define PIPELINE_DEPTH 8
+#define STATIC_LEN 512
+#define CHUNK_LEN 256
+#define N_CHUNKS 4
+#define SERVER_PORT 8080
+#define STACK_SIZE 3072
+#define THREAD_PRIORITY K_PRIO_PREEMPT(8)
+#define TIMEOUT K_SECONDS(5)
+
+static struct sockaddr_in server_addr = {
+	.sin_family = AF_INET,
+	.sin_port = htons(SERVER_PORT),
+	.sin_addr = { { { 127, 0, 0, 1 } } },
+};
+
+static u8_t static_data[STATIC_LEN];
+static u8_t chunk[CHUNK_LEN];
+
+static int chunked_cb(const struct http_server_request *req, void *user_data)
+{
+	int ret, i;
+
+	ret = http_server_response_begin(req->client, 200, "text/plain",
+					 HTTP_SERVER_CHUNKED);
+
+	for (i = 0; i < N_CHUNKS && ret == 0; i++) {
+		ret = http_server_response_write(req->client, chunk,
+						 sizeof(chunk));
+	}
+
+	return ret;
+}
+
+static const struct http_server_resource resources[] = {
+	{
+		.path = "/static",
+		.type = HTTP_SERVER_RESOURCE_STATIC,
+		.content_type = "text/plain",
+		.data = static_data,
+		.data_len = sizeof(static_data),
+	},
+	{
+		.path = "/chunked",
+		.type = HTTP_SERVER_RESOURCE_DYNAMIC,
+		.cb = chunked_cb,
+	},
+};
+
+static struct http_server_ctx server;
+static struct http_client_session session;
+
+static u8_t recv_bufs[PIPELINE_DEPTH][1024];
+static struct http_request requests[PIPELINE_DEPTH];
+static struct http_request *request_ptrs[PIPELINE_DEPTH];
+static size_t body_len;
+
+static void server_thread(void)
+{
+	int ret;
+
+	ret = http_server_run(&server);
+
+	printk("HTTP server stopped (%d)\n", ret);
+}
+
+K_THREAD_DEFINE(server_thread_id, STACK_SIZE,
+		server_thread, NULL, NULL, NULL,
+		THREAD_PRIORITY, 0, K_FOREVER);
+
+static void response_cb(struct http_response *rsp,
+			enum http_final_call final_data,
+			void *user_data)
+{
+	ARG_UNUSED(rsp);
+	ARG_UNUSED(final_data);
+	ARG_UNUSED(user_data);
+}
+
+static int body_cb(struct http_request *req, const u8_t *data, size_t len,
+		   void *user_data)
+{
+	ARG_UNUSED(req);
+	ARG_UNUSED(data);
+	ARG_UNUSED(user_data);
+
+	body_len += len;
+
+	return 0;
+}
+
+static void request_init(struct http_request *req, const char *url,
+			 u8_t *recv_buf, size_t recv_buf_len)
+{
+	memset(req, 0, sizeof(*req));
+
+	req->method = HTTP_GET;
+	req->url = url;
+	req->host = "127.0.0.1";
+	req->protocol = "HTTP/1.1";
+	req->response = response_cb;
+	req->body_cb = body_cb;
+	req->recv_buf = recv_buf;
+	req->recv_buf_len = recv_buf_len;
+}
+
+static u32_t per_second(u32_t count, u32_t cycles)
+{
+	u64_t ns = k_cyc_to_ns_floor64(cycles);
+
+	return ns ? (u32_t)(count * 1000000000ULL / ns) : 0;
+}
+
+static int bench_new_connection(void)
+{
+	u32_t start, cycles;
+	int sock, ret, i;
+
+	body_len = 0;
+	start = k_cycle_get_32();
+
+	for (i = 0; i < N_CONNECTIONS; i++) {
+		sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (sock < 0) {
+			return -errno;
+		}
+
+		ret = connect(sock, (struct sockaddr *)&server_addr,
+			      sizeof(server_addr));
+		if (ret < 0) {
+			ret = -errno;
+			(void)close(sock);
+			return ret;
+		}
+
+		request_init(&requests[0], "/static", recv_bufs[0],
+			     sizeof(recv_bufs[0]));
+
+		ret = http_client_req(sock, &requests[0], TIMEOUT, NULL);
+
+		(void)close(sock);
+
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	if (body_len != N_CONNECTIONS * STATIC_LEN) {
+		printk("Unexpected body length %zd\n", body_len);
+		return -EIO;
+	}
+
+	printk("http new connection: %u req/s\n",
+	       per_second(N_CONNECTIONS, cycles));
+
+	return 0;
+}
+
+static int bench_session(const char *url, size_t expected, bool latency)
+{
+	u32_t start, cycles;
+	int ret, i;
+
+	body_len = 0;
+	start = k_cycle_get_32();
+
+	for (i = 0; i < N_REQUESTS; i++) {
+		request_init(&requests[0], url, recv_bufs[0],
+			     sizeof(recv_bufs[0]));
+
+		ret = http_client_session_req(&session, &requests[0], TIMEOUT,
+					      NULL);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	if (body_len != N_REQUESTS * expected) {
+		printk("Unexpected body length %zd\n", body_len);
+		return -EIO;
+	}
+
+	if (latency) {
+		printk("http keep-alive: %u req/s, %u us/req\n",
+		       per_second(N_REQUESTS, cycles),
+		       (u32_t)(k_cyc_to_ns_floor64(cycles) / N_REQUESTS /
+			       1000U));
+	} else {
+		printk("http chunked: %u req/s\n",
+		       per_second(N_REQUESTS, cycles));
+	}
+
+	return 0;
+}
+
+static int bench_pipelined(void)
+{
+	u32_t start, cycles;
+	int ret, i, j;
+
+	body_len = 0;
+	start = k_cycle_get_32();
+
+	for (i = 0; i < N_REQUESTS / PIPELINE_DEPTH; i++) {
+		for (j = 0; j < PIPELINE_DEPTH; j++) {
+			request_init(&requests[j], "/static", recv_bufs[j],
+				     sizeof(recv_bufs[j]));
+			request_ptrs[j] = &requests[j];
+		}
+
+		ret = http_client_session_pipeline(&session, request_ptrs,
+						   PIPELINE_DEPTH, TIMEOUT,
+						   NULL);
+		if (ret != PIPELINE_DEPTH) {
+			printk("Only %d pipelined responses\n", ret);
+			return ret < 0 ? ret : -EIO;
+		}
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	if (body_len != (N_REQUESTS / PIPELINE_DEPTH) * PIPELINE_DEPTH *
+	    STATIC_LEN) {
+		printk("Unexpected body length %zd\n", body_len);
+		return -EIO;
+	}
+
+	printk("http pipelined: %u req/s\n",
+	       per_second((N_REQUESTS / PIPELINE_DEPTH) * PIPELINE_DEPTH,
+			  cycles));
+
+	return 0;
+}
+
+void main(void)
+{
+	int ret;
+
+	memset(static_data, 'a', sizeof(static_data));
+	memset(chunk, 'b', sizeof(chunk));
+
+	ret = http_server_init(&server, (struct sockaddr *)&server_addr,
+			       sizeof(server_addr), resources,
+			       ARRAY_SIZE(resources));
+	if (ret < 0) {
+		printk("Cannot start HTTP server (%d)\n", ret);
+		return;
+	}
+
+	k_thread_start(server_thread_id);
+
+	ret = http_client_session_init(&session,
+				       (struct sockaddr *)&server_addr,
+				       sizeof(server_addr), IPPROTO_TCP);
+	if (ret < 0) {
+		printk("Cannot init HTTP session (%d)\n", ret);
+		return;
+	}
+
+	ret = bench_new_connection();
+	if (ret < 0) {
+		printk("New connection benchmark failed (%d)\n", ret);
+		return;
+	}
+
+	ret = bench_session("/static", STATIC_LEN, true);
+	if (ret < 0) {
+		printk("Keep-alive benchmark failed (%d)\n", ret);
+		return;
+	}
+
+	ret = bench_pipelined();
+	if (ret < 0) {
+		printk("Pipelined benchmark failed (%d)\n", ret);
+		return;
+	}
+
+	ret = bench_session("/chunked", CHUNK_LEN * N_CHUNKS, false);
+	if (ret < 0) {
+		printk("Chunked benchmark failed (%d)\n", ret);
+		return;
+	}
+
+	http_client_session_close(&session);
+
+	printk("fin\n");
+}
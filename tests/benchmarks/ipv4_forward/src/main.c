@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* IPv4 forwarding benchmark.
+ *
+ * Small UDP packets from hosts on the subnet of the inside interface to a
+ * network routed through the outside interface are fed to the IPv4 input,
+ * and the time until all of them have been sent by the outside interface
+ * is reported per packet. Building the packets is part of that time, as
+ * receiving them would be. If CONFIG_NET_IPV4_NAT is set, the same is done
+ * with the outside interface as the external interface of the NAT, for a
+ * number of connections that all stay in the connection table.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <string.h>
+
+#include <net/net_if.h>
+#include <net/net_pkt.h>
+#include <net/dummy.h>
+
+#include "net_private.h"
+#include "ipv4.h"
+#include "route.h"
+
+#define PACKETS 10000
+#define PAYLOAD_LEN 18
+#define N_FLOWS 32
+
+static struct net_if *inside_iface;
+static struct net_if *outside_iface;
+static K_SEM_DEFINE(all_sent, 0, 1);
+static int sent;
+
+static void bench_iface_init(struct net_if *iface)
+{
+	static u8_t macs[2][6] = {
+		{ 0x00, 0x00, 0x5e, 0x00, 0x53, 0x01 },
+		{ 0x00, 0x00, 0x5e, 0x00, 0x53, 0x02 },
+	};
+	static int count;
+
+	net_if_set_link_addr(iface, macs[count], sizeof(macs[count]),
+			     NET_LINK_DUMMY);
+	count++;
+}
+
+static int bench_send(struct device *dev, struct net_pkt *pkt)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(pkt);
+
+	if (++sent == PACKETS) {
+		k_sem_give(&all_sent);
+	}
+
+	return 0;
+}
+
+static struct dummy_api bench_api = {
+	.iface_api.init = bench_iface_init,
+	.send = bench_send,
+};
+
+static int bench_dev_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return 0;
+}
+
+NET_DEVICE_INIT_INSTANCE(bench_inside, "bench_inside", inside,
+			 bench_dev_init, device_pm_control_nop, NULL, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &bench_api,
+			 DUMMY_L2, NET_L2_GET_CTX_TYPE(DUMMY_L2), 1500);
+
+NET_DEVICE_INIT_INSTANCE(bench_outside, "bench_outside", outside,
+			 bench_dev_init, device_pm_control_nop, NULL, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &bench_api,
+			 DUMMY_L2, NET_L2_GET_CTX_TYPE(DUMMY_L2), 1500);
+
+static int add_addr(struct net_if *iface, u32_t addr)
+{
+	struct in_addr in_addr = { .s_addr = htonl(addr) };
+	struct in_addr netmask = { .s_addr = htonl(0xffffff00) };
+
+	if (!net_if_ipv4_addr_add(iface, &in_addr, NET_ADDR_MANUAL, 0)) {
+		return -ENOMEM;
+	}
+
+	net_if_ipv4_set_netmask(iface, &netmask);
+
+	return 0;
+}
+
+static int setup(void)
+{
+	struct in_addr prefix = { .s_addr = htonl(0xcb007100) };
+	struct in_addr gw = { .s_addr = htonl(0xc63364fe) };
+
+	inside_iface = net_if_get_by_index(1);
+	outside_iface = net_if_get_by_index(2);
+	if (!inside_iface || !outside_iface) {
+		return -ENODEV;
+	}
+
+	/* 192.0.2.1/24 inside, 198.51.100.1/24 outside */
+	if (add_addr(inside_iface, 0xc0000201) < 0 ||
+	    add_addr(outside_iface, 0xc6336401) < 0) {
+		return -ENOMEM;
+	}
+
+	/* 203.0.113.0/24 through 198.51.100.254 */
+	if (!net_route_ipv4_add(outside_iface, &prefix, 24, &gw)) {
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static struct net_pkt *build_pkt(int flow)
+{
+	static const u8_t payload[PAYLOAD_LEN];
+	struct net_ipv4_hdr ip_hdr = { 0 };
+	struct net_udp_hdr udp_hdr;
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_rx_alloc_with_buffer(inside_iface,
+					   sizeof(ip_hdr) + sizeof(udp_hdr) +
+					   PAYLOAD_LEN, AF_INET, IPPROTO_UDP,
+					   K_FOREVER);
+	if (!pkt) {
+		return NULL;
+	}
+
+	/* From 192.0.2.(2 + flow % 8) to 203.0.113.1 */
+	ip_hdr.vhl = 0x45;
+	ip_hdr.len = htons(sizeof(ip_hdr) + sizeof(udp_hdr) + PAYLOAD_LEN);
+	ip_hdr.ttl = 64U;
+	ip_hdr.proto = IPPROTO_UDP;
+	ip_hdr.src.s_addr = htonl(0xc0000202 + flow % 8);
+	ip_hdr.dst.s_addr = htonl(0xcb007101);
+
+	udp_hdr.src_port = htons(20000 + flow);
+	udp_hdr.dst_port = htons(5001);
+	udp_hdr.len = htons(sizeof(udp_hdr) + PAYLOAD_LEN);
+	udp_hdr.chksum = htons(0x1234);
+
+	if (net_pkt_write(pkt, &ip_hdr, sizeof(ip_hdr)) ||
+	    net_pkt_write(pkt, &udp_hdr, sizeof(udp_hdr)) ||
+	    net_pkt_write(pkt, payload, sizeof(payload))) {
+		net_pkt_unref(pkt);
+		return NULL;
+	}
+
+	net_pkt_cursor_init(pkt);
+	net_pkt_set_overwrite(pkt, true);
+	net_pkt_set_ip_hdr_len(pkt, sizeof(ip_hdr));
+
+	/* The checksum is over the header as written */
+	ip_hdr.chksum = net_calc_chksum_ipv4(pkt);
+	net_pkt_cursor_init(pkt);
+	net_pkt_write(pkt, &ip_hdr, sizeof(ip_hdr));
+	net_pkt_cursor_init(pkt);
+
+	return pkt;
+}
+
+static int bench_forward(const char *name)
+{
+	u32_t start, cycles;
+	struct net_pkt *pkt;
+	int i;
+
+	sent = 0;
+	k_sem_reset(&all_sent);
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < PACKETS; i++) {
+		pkt = build_pkt(i % N_FLOWS);
+		if (!pkt) {
+			printk("Cannot build packet\n");
+			return -ENOMEM;
+		}
+
+		if (net_ipv4_input(pkt) == NET_DROP) {
+			printk("Packet was not forwarded\n");
+			net_pkt_unref(pkt);
+			return -EIO;
+		}
+	}
+
+	if (k_sem_take(&all_sent, K_SECONDS(10))) {
+		printk("Only %d packets sent\n", sent);
+		return -ETIMEDOUT;
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	printk("%s: %u ns\n", name,
+	       (u32_t)(k_cyc_to_ns_floor64(cycles) / PACKETS));
+
+	return 0;
+}
+
+void main(void)
+{
+	int ret;
+
+	ret = setup();
+	if (ret < 0) {
+		printk("Cannot set up the interfaces (%d)\n", ret);
+		return;
+	}
+
+	if (bench_forward("ipv4 forward") < 0) {
+		return;
+	}
+
+#if defined(CONFIG_NET_IPV4_NAT)
+	net_ipv4_nat_enable(outside_iface);
+
+	if (bench_forward("ipv4 forward nat") < 0) {
+		return;
+	}
+#endif
+
+	printk("fin\n");
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* LwM2M engine resource lookup benchmark.
+ *
+ * N_INSTANCES IPSO Temperature Sensor instances are created, which gives
+ * more than 1000 resources. The sensor value of every instance is then
+ * read and written by path, and the average time per access is reported.
+ * Compare the results with the default object instance index and with
+ * CONFIG_LWM2M_ENGINE_INDEX_SIZE=1, where the lookups walk the list of
+ * instances.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+
+#include <net/lwm2m.h>
+
+#define N_INSTANCES CONFIG_LWM2M_IPSO_TEMP_SENSOR_INSTANCE_COUNT
+#define N_RESOURCES_PER_INSTANCE 7
+#define ITERATIONS 10
+
+static char paths[N_INSTANCES][sizeof("3303/65535/5700")];
+
+static u32_t avg_ns(u32_t cycles)
+{
+	return (u32_t)(k_cyc_to_ns_floor64(cycles) /
+		       (ITERATIONS * N_INSTANCES));
+}
+
+void main(void)
+{
+	float32_value_t value;
+	u32_t start, get_cycles, set_cycles;
+	char path[sizeof("3303/65535")];
+	int i, j, ret;
+
+	for (i = 0; i < N_INSTANCES; i++) {
+		snprintk(path, sizeof(path), "3303/%d", i);
+		ret = lwm2m_engine_create_obj_inst(path);
+		if (ret < 0) {
+			printk("Cannot create %s (%d)\n", path, ret);
+			return;
+		}
+
+		snprintk(paths[i], sizeof(paths[i]), "3303/%d/5700", i);
+	}
+
+	printk("lwm2m %d resources\n", N_INSTANCES * N_RESOURCES_PER_INSTANCE);
+
+	start = k_cycle_get_32();
+
+	for (j = 0; j < ITERATIONS; j++) {
+		for (i = 0; i < N_INSTANCES; i++) {
+			value.val1 = i;
+			value.val2 = j;
+			ret = lwm2m_engine_set_float32(paths[i], &value);
+			if (ret < 0) {
+				printk("Cannot set %s (%d)\n", paths[i], ret);
+				return;
+			}
+		}
+	}
+
+	set_cycles = k_cycle_get_32() - start;
+
+	start = k_cycle_get_32();
+
+	for (j = 0; j < ITERATIONS; j++) {
+		for (i = 0; i < N_INSTANCES; i++) {
+			ret = lwm2m_engine_get_float32(paths[i], &value);
+			if (ret < 0 || value.val1 != i) {
+				printk("Cannot get %s (%d)\n", paths[i], ret);
+				return;
+			}
+		}
+	}
+
+	get_cycles = k_cycle_get_32() - start;
+
+	printk("lwm2m get: %u ns\n", avg_ns(get_cycles));
+	printk("lwm2m set: %u ns\n", avg_ns(set_cycles));
+
+	printk("fin\n");
+}
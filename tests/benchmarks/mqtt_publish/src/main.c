@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* MQTT publish throughput benchmark.
+ *
+ * The MQTT client publishes N_MESSAGES messages to a minimal broker
+ * stand-in running in another thread over the loopback interface. The
+ * broker only answers CONNECT, PINGREQ and QoS 1 PUBLISH packets. The
+ * QoS 0 messages are published one at a time and in batches, the QoS 1
+ * messages waiting for each PUBACK and with the inflight window of
+ * CONFIG_MQTT_INFLIGHT_MAX messages. The number of messages per second
+ * is reported for each case.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <string.h>
+
+#include <net/socket.h>
+#include <net/mqtt.h>
+
+#define N_MESSAGES 1000
+#define PAYLOAD_LEN 32
+#define SERVER_PORT 1883
+#define STACK_SIZE 2048
+#define THREAD_PRIORITY K_PRIO_PREEMPT(8)
+#define INPUT_TIMEOUT 1000
+
+static struct sockaddr_in server_addr = {
+	.sin_family = AF_INET,
+	.sin_port = htons(SERVER_PORT),
+	.sin_addr = { { { 127, 0, 0, 1 } } },
+};
+
+static int server_sock;
+
+static struct mqtt_client client;
+static u8_t rx_buffer[256];
+static u8_t tx_buffer[512];
+static u8_t payload[PAYLOAD_LEN];
+static u16_t message_id;
+static bool connected;
+static bool ping_acked;
+
+static struct mqtt_publish_param messages[CONFIG_MQTT_PUBLISH_BATCH_MAX];
+
+static int recv_all(int sock, u8_t *buf, size_t len)
+{
+	int ret;
+
+	while (len) {
+		ret = recv(sock, buf, len, 0);
+		if (ret <= 0) {
+			return -1;
+		}
+
+		buf += ret;
+		len -= ret;
+	}
+
+	return 0;
+}
+
+/* Read one MQTT packet, return its type or -1 on error */
+static int broker_read(int sock, u8_t *buf, size_t size, u32_t *len)
+{
+	u8_t type, byte;
+	int shift = 0;
+
+	if (recv_all(sock, &type, 1) < 0) {
+		return -1;
+	}
+
+	*len = 0U;
+
+	do {
+		if (recv_all(sock, &byte, 1) < 0 || shift > 21) {
+			return -1;
+		}
+
+		*len |= (byte & 0x7f) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+
+	if (*len > size || recv_all(sock, buf, *len) < 0) {
+		return -1;
+	}
+
+	return type;
+}
+
+static void broker(void)
+{
+	u8_t buf[128];
+	u8_t ack[4];
+	u16_t topic_len;
+	u32_t len;
+	int sock;
+	int type;
+
+	while (true) {
+		sock = accept(server_sock, NULL, NULL);
+		if (sock < 0) {
+			printk("Cannot accept (%d)\n", errno);
+			continue;
+		}
+
+		while ((type = broker_read(sock, buf, sizeof(buf), &len)) >= 0) {
+			switch (type & 0xf0) {
+			case 0x10: /* CONNECT */
+				ack[0] = 0x20;
+				ack[1] = 2U;
+				ack[2] = 0U;
+				ack[3] = 0U;
+				(void)send(sock, ack, 4, 0);
+				break;
+			case 0x30: /* PUBLISH */
+				if (!(type & 0x06) || len < 4) {
+					break;
+				}
+
+				/* Message id follows the topic */
+				topic_len = (buf[0] << 8) | buf[1];
+				ack[0] = 0x40;
+				ack[1] = 2U;
+				ack[2] = buf[2 + topic_len];
+				ack[3] = buf[3 + topic_len];
+				(void)send(sock, ack, 4, 0);
+				break;
+			case 0xc0: /* PINGREQ */
+				ack[0] = 0xd0;
+				ack[1] = 0U;
+				(void)send(sock, ack, 2, 0);
+				break;
+			default:
+				break;
+			}
+		}
+
+		(void)close(sock);
+	}
+}
+
+K_THREAD_DEFINE(broker_thread_id, STACK_SIZE,
+		broker, NULL, NULL, NULL,
+		THREAD_PRIORITY, 0, K_FOREVER);
+
+static int setup_broker(void)
+{
+	server_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (server_sock < 0) {
+		printk("Cannot create server socket (%d)\n", errno);
+		return -errno;
+	}
+
+	if (bind(server_sock, (struct sockaddr *)&server_addr,
+		 sizeof(server_addr)) < 0 ||
+	    listen(server_sock, 1) < 0) {
+		printk("Cannot listen (%d)\n", errno);
+		return -errno;
+	}
+
+	k_thread_start(broker_thread_id);
+
+	return 0;
+}
+
+static void mqtt_evt_handler(struct mqtt_client *const c,
+			     const struct mqtt_evt *evt)
+{
+	switch (evt->type) {
+	case MQTT_EVT_CONNACK:
+		connected = evt->result == 0;
+		break;
+	case MQTT_EVT_PINGRESP:
+		ping_acked = true;
+		break;
+	default:
+		break;
+	}
+}
+
+static int wait_input(void)
+{
+	struct pollfd fds = {
+		.fd = client.transport.tcp.sock,
+		.events = POLLIN,
+	};
+
+	if (poll(&fds, 1, INPUT_TIMEOUT) <= 0) {
+		return -ETIMEDOUT;
+	}
+
+	return mqtt_input(&client);
+}
+
+static int client_connect(void)
+{
+	static u8_t client_id[] = "benchmark";
+	int ret;
+
+	mqtt_client_init(&client);
+
+	client.broker = &server_addr;
+	client.evt_cb = mqtt_evt_handler;
+	client.client_id.utf8 = client_id;
+	client.client_id.size = sizeof(client_id) - 1;
+	client.keepalive = 0U;
+	client.rx_buf = rx_buffer;
+	client.rx_buf_size = sizeof(rx_buffer);
+	client.tx_buf = tx_buffer;
+	client.tx_buf_size = sizeof(tx_buffer);
+	client.transport.type = MQTT_TRANSPORT_NON_SECURE;
+
+	ret = mqtt_connect(&client);
+	if (ret < 0) {
+		printk("Cannot connect (%d)\n", ret);
+		return ret;
+	}
+
+	while (!connected) {
+		ret = wait_input();
+		if (ret < 0) {
+			printk("No CONNACK (%d)\n", ret);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+/* The broker has read everything sent before it answers the ping */
+static int sync_broker(void)
+{
+	int ret;
+
+	ping_acked = false;
+
+	ret = mqtt_ping(&client);
+
+	while (ret >= 0 && !ping_acked) {
+		ret = wait_input();
+	}
+
+	return ret;
+}
+
+static void messages_init(enum mqtt_qos qos, size_t count)
+{
+	static u8_t topic[] = "sensors/benchmark";
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		memset(&messages[i], 0, sizeof(messages[i]));
+		messages[i].message.topic.topic.utf8 = topic;
+		messages[i].message.topic.topic.size = sizeof(topic) - 1;
+		messages[i].message.topic.qos = qos;
+		messages[i].message.payload.data = payload;
+		messages[i].message.payload.len = sizeof(payload);
+
+		if (qos) {
+			if (++message_id == 0U) {
+				message_id = 1U;
+			}
+
+			messages[i].message_id = message_id;
+		}
+	}
+}
+
+static u32_t msg_per_sec(u32_t cycles)
+{
+	u64_t us = k_cyc_to_us_floor64(cycles);
+
+	return us ? (u32_t)((u64_t)N_MESSAGES * USEC_PER_SEC / us) : 0U;
+}
+
+/* Return the number of QoS 0 messages per second, or 0 on error */
+static u32_t run_qos0(size_t batch)
+{
+	u32_t start;
+	int i, ret = 0;
+
+	messages_init(MQTT_QOS_0_AT_MOST_ONCE, batch);
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < N_MESSAGES && ret >= 0; i += batch) {
+		if (batch == 1) {
+			ret = mqtt_publish(&client, &messages[0]);
+		} else {
+			ret = mqtt_publish_batch(&client, messages,
+						 MIN(batch, N_MESSAGES - i));
+		}
+	}
+
+	if (ret >= 0) {
+		ret = sync_broker();
+	}
+
+	if (ret < 0) {
+		printk("Cannot publish (%d)\n", ret);
+		return 0U;
+	}
+
+	return msg_per_sec(k_cycle_get_32() - start);
+}
+
+/* Return the number of QoS 1 messages per second with at most window
+ * messages in flight, or 0 on error.
+ */
+static u32_t run_qos1(u32_t window)
+{
+	u32_t start;
+	int i = 0, ret = 0;
+
+	start = k_cycle_get_32();
+
+	while (ret >= 0 && i < N_MESSAGES) {
+		if (mqtt_inflight_count(&client) < window) {
+			messages_init(MQTT_QOS_1_AT_LEAST_ONCE, 1);
+			ret = mqtt_publish(&client, &messages[0]);
+			i++;
+		} else {
+			ret = wait_input();
+		}
+	}
+
+	while (ret >= 0 && mqtt_inflight_count(&client)) {
+		ret = wait_input();
+	}
+
+	if (ret < 0) {
+		printk("Cannot publish (%d)\n", ret);
+		return 0U;
+	}
+
+	return msg_per_sec(k_cycle_get_32() - start);
+}
+
+void main(void)
+{
+	u32_t single, batch, stop_and_wait, windowed;
+
+	memset(payload, 0xa5, sizeof(payload));
+
+	if (setup_broker() < 0 || client_connect() < 0) {
+		return;
+	}
+
+	single = run_qos0(1);
+	batch = run_qos0(CONFIG_MQTT_PUBLISH_BATCH_MAX);
+	stop_and_wait = run_qos1(1);
+	windowed = run_qos1(CONFIG_MQTT_INFLIGHT_MAX);
+
+	(void)mqtt_disconnect(&client);
+
+	if (!single || !batch || !stop_and_wait || !windowed) {
+		return;
+	}
+
+	printk("mqtt qos0 single: %u msg/s\n", single);
+	printk("mqtt qos0 batch: %u msg/s\n", batch);
+	printk("mqtt qos1 window 1: %u msg/s\n", stop_and_wait);
+	printk("mqtt qos1 window %u: %u msg/s\n", CONFIG_MQTT_INFLIGHT_MAX,
+	       windowed);
+
+	printk("fin\n");
+}
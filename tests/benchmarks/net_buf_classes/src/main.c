@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Buffer size class benchmark.
+ *
+ * A trace of packet sizes, a mix of CoAP exchanges and a TCP transfer
+ * over IPv6, is replayed through a pool of fixed size 128 byte buffers
+ * and through a pool with 64/256/1536 byte size classes. A window of
+ * packets is kept allocated, as if queued in the stack, while new ones
+ * come in. For both pools the average number of buffers per packet, the
+ * most memory the allocated buffers took at once (payload storage and
+ * struct net_buf), how much of that memory held packet data on average,
+ * and the time to allocate and free a packet are reported.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+
+#include <net/buf.h>
+
+#define WINDOW 16
+#define ROUNDS 1000
+
+#define FIXED_SIZE 128
+#define LARGE_SIZE 1536
+
+struct bench_pool {
+	const char *name;
+	struct net_buf_pool *pool;
+
+	/* Payload storage per buffer, 0 if it depends on the buffer */
+	size_t data_size;
+
+	/* Largest buffer that can be allocated */
+	size_t max_len;
+
+	/* Storage not counted in the size of a buffer */
+	size_t overhead;
+};
+
+/* Packet sizes at the IPv6 layer */
+static const u16_t trace[] = {
+	68,	/* CoAP GET */
+	52,	/* CoAP empty ACK */
+	152,	/* CoAP piggybacked response */
+	60,	/* TCP ACK */
+	1514,	/* TCP full segment */
+	1514,	/* TCP full segment */
+	60,	/* TCP ACK */
+	68,	/* CoAP GET */
+	52,	/* CoAP empty ACK */
+	152,	/* CoAP piggybacked response */
+	400,	/* TCP last segment */
+	60,	/* TCP ACK */
+	68,	/* CoAP CON notification */
+	52,	/* CoAP empty ACK */
+	68,	/* CoAP GET */
+	52,	/* CoAP empty ACK */
+};
+
+NET_BUF_POOL_FIXED_DEFINE(fixed_pool, 64, FIXED_SIZE, NULL);
+
+NET_BUF_SLAB_CLASS_DEFINE(small_class, 64, 16);
+NET_BUF_SLAB_CLASS_DEFINE(medium_class, 256, 16);
+NET_BUF_SLAB_CLASS_DEFINE(large_class, LARGE_SIZE, 8);
+NET_BUF_POOL_SLAB_DEFINE(class_pool, 40, NULL, &small_class, &medium_class,
+			 &large_class);
+
+static struct bench_pool pools[] = {
+	{
+		.name = "fixed",
+		.pool = &fixed_pool,
+		.data_size = FIXED_SIZE,
+		.max_len = FIXED_SIZE,
+		.overhead = sizeof(struct net_buf),
+	},
+	{
+		.name = "classes",
+		.pool = &class_pool,
+		.max_len = LARGE_SIZE,
+		.overhead = sizeof(struct net_buf) + NET_BUF_SLAB_HDR_SIZE,
+	},
+};
+
+static struct net_buf *window[WINDOW];
+
+/* Memory taken by the buffers of a packet */
+static size_t pkt_footprint(struct bench_pool *bp, struct net_buf *frags)
+{
+	size_t len = 0;
+
+	for (; frags; frags = frags->frags) {
+		len += (bp->data_size ? bp->data_size : frags->size) +
+			bp->overhead;
+	}
+
+	return len;
+}
+
+static struct net_buf *pkt_alloc(struct bench_pool *bp, size_t len,
+				 u32_t *count)
+{
+	struct net_buf *frags = NULL;
+	struct net_buf *buf;
+
+	while (len) {
+		buf = net_buf_alloc_len(bp->pool, MIN(len, bp->max_len),
+					K_NO_WAIT);
+		if (!buf) {
+			if (frags) {
+				net_buf_unref(frags);
+			}
+
+			return NULL;
+		}
+
+		net_buf_add(buf, MIN(len, net_buf_tailroom(buf)));
+		len -= buf->len;
+
+		frags = frags ? net_buf_frag_add(frags, buf) : buf;
+		(*count)++;
+	}
+
+	return frags;
+}
+
+static int bench_run(struct bench_pool *bp)
+{
+	u64_t payload = 0, storage = 0;
+	size_t used = 0, peak = 0;
+	u32_t start, cycles;
+	u32_t bufs = 0;
+	int i, slot;
+
+	/* Only the allocations and frees are timed */
+	start = k_cycle_get_32();
+
+	for (i = 0; i < ROUNDS * ARRAY_SIZE(trace); i++) {
+		slot = i % WINDOW;
+
+		if (window[slot]) {
+			net_buf_unref(window[slot]);
+		}
+
+		window[slot] = pkt_alloc(bp, trace[i % ARRAY_SIZE(trace)],
+					 &bufs);
+		if (!window[slot]) {
+			printk("%s: cannot allocate packet %d\n", bp->name, i);
+			return -ENOMEM;
+		}
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	for (slot = 0; slot < WINDOW; slot++) {
+		net_buf_unref(window[slot]);
+		window[slot] = NULL;
+	}
+
+	/* Replay once more for the memory use, a window at a time */
+	for (i = 0; i < ARRAY_SIZE(trace) + WINDOW; i++) {
+		u32_t count = 0;
+		size_t len;
+
+		slot = i % WINDOW;
+
+		if (window[slot]) {
+			used -= pkt_footprint(bp, window[slot]);
+			net_buf_unref(window[slot]);
+		}
+
+		window[slot] = pkt_alloc(bp, trace[i % ARRAY_SIZE(trace)],
+					 &count);
+		if (!window[slot]) {
+			printk("%s: cannot allocate packet %d\n", bp->name, i);
+			return -ENOMEM;
+		}
+
+		len = pkt_footprint(bp, window[slot]);
+
+		payload += trace[i % ARRAY_SIZE(trace)];
+		storage += len;
+
+		used += len;
+		peak = MAX(peak, used);
+	}
+
+	for (slot = 0; slot < WINDOW; slot++) {
+		net_buf_unref(window[slot]);
+		window[slot] = NULL;
+	}
+
+	i = ROUNDS * ARRAY_SIZE(trace);
+
+	printk("%s: %u.%02u bufs/pkt, peak %u bytes, %u%% payload, "
+	       "%u ns/pkt\n", bp->name, bufs / i, (bufs * 100U / i) % 100U,
+	       (u32_t)peak, (u32_t)(payload * 100U / storage),
+	       (u32_t)(k_cyc_to_ns_floor64(cycles) / i));
+
+	return 0;
+}
+
+void main(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(pools); i++) {
+		if (bench_run(&pools[i]) < 0) {
+			return;
+		}
+	}
+
+	printk("fin\n");
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Software checksum benchmark.
+ *
+ * An IPv4/UDP packet is built for each of the packet sizes below, split in
+ * network buffers of CONFIG_NET_BUF_DATA_SIZE bytes like a received packet
+ * would be. The UDP checksum is calculated ITERATIONS times with
+ * net_calc_chksum() and with a byte by byte reference implementation, and
+ * the average time per packet of both is reported.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+
+#include <net/net_pkt.h>
+#include <net/net_ip.h>
+
+#include "net_private.h"
+
+#define ITERATIONS 1000
+
+static const u16_t pkt_sizes[] = { 64, 128, 256, 512, 1024, 1280, 1500 };
+
+/* Odd sized buffers make every other fragment start in the middle of a
+ * 16-bit word, which is the slow case of the checksum.
+ */
+#define ODD_FRAG_LEN (CONFIG_NET_BUF_DATA_SIZE - 1)
+
+static u16_t ref_chksum(struct net_pkt *pkt)
+{
+	struct net_buf *frag = pkt->buffer;
+	u32_t sum = IPPROTO_UDP + net_pkt_get_len(pkt) - NET_IPV4H_LEN;
+	size_t pos = 0;
+	size_t i;
+
+	for (i = 12; i < NET_IPV4H_LEN; i += 2) {
+		sum += (frag->data[i] << 8) | frag->data[i + 1];
+	}
+
+	for (i = NET_IPV4H_LEN; frag; frag = frag->frags, i = 0) {
+		for (; i < frag->len; i++, pos++) {
+			sum += (pos % 2) ? frag->data[i] : frag->data[i] << 8;
+		}
+	}
+
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	return htons((u16_t)~sum);
+}
+
+static struct net_pkt *build_pkt(size_t len, size_t frag_len, int *frags)
+{
+	struct net_pkt *pkt;
+	size_t i;
+
+	pkt = net_pkt_rx_alloc(K_NO_WAIT);
+	if (!pkt) {
+		return NULL;
+	}
+
+	net_pkt_set_family(pkt, AF_INET);
+	net_pkt_set_ip_hdr_len(pkt, NET_IPV4H_LEN);
+	net_pkt_set_ipv4_opts_len(pkt, 0);
+
+	*frags = 0;
+
+	for (i = 0; i < len; i++) {
+		struct net_buf *frag = net_buf_frag_last(pkt->buffer);
+
+		if (!frag || frag->len == frag_len) {
+			frag = net_pkt_get_reserve_rx_data(K_NO_WAIT);
+			if (!frag) {
+				net_pkt_unref(pkt);
+				return NULL;
+			}
+
+			net_pkt_frag_add(pkt, frag);
+			(*frags)++;
+		}
+
+		net_buf_add_u8(frag, (u8_t)(i * 37U + 0xa5));
+	}
+
+	return pkt;
+}
+
+static u32_t measure_ns(struct net_pkt *pkt, bool reference, u16_t *chksum)
+{
+	u32_t start, cycles;
+	int i;
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < ITERATIONS; i++) {
+		if (reference) {
+			*chksum = ref_chksum(pkt);
+		} else {
+			*chksum = net_calc_chksum(pkt, IPPROTO_UDP);
+		}
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	return (u32_t)(k_cyc_to_ns_floor64(cycles) / ITERATIONS);
+}
+
+static int run(size_t frag_len)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(pkt_sizes); i++) {
+		u16_t chksum, expected;
+		u32_t ns, ref_ns;
+		struct net_pkt *pkt;
+		int frags;
+
+		pkt = build_pkt(pkt_sizes[i], frag_len, &frags);
+		if (!pkt) {
+			printk("Cannot build %u byte packet\n", pkt_sizes[i]);
+			return -ENOMEM;
+		}
+
+		ns = measure_ns(pkt, false, &chksum);
+		ref_ns = measure_ns(pkt, true, &expected);
+
+		net_pkt_unref(pkt);
+
+		printk("chksum %u bytes in %d frags: %u ns, reference %u ns\n",
+		       pkt_sizes[i], frags, ns, ref_ns);
+
+		if (chksum != expected) {
+			printk("Checksum mismatch 0x%04x != 0x%04x\n",
+			       chksum, expected);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+void main(void)
+{
+	if (run(CONFIG_NET_BUF_DATA_SIZE) < 0 || run(ODD_FRAG_LEN) < 0) {
+		return;
+	}
+
+	printk("fin\n");
+}
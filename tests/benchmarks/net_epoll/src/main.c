@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Socket wakeup benchmark.
+ *
+ * A thread waits for data on one UDP socket among 200 idle ones, with
+ * zsock_epoll_wait() on an event set holding all of them and with
+ * zsock_poll() on an array of all of them. The time from sending a
+ * datagram over the loopback interface until the waiting thread runs
+ * again is reported, averaged over a number of rounds. The sender
+ * sleeps before each round so that the waiting thread is blocked when
+ * the datagram arrives. With zsock_poll() the waiting thread walks over
+ * all the sockets again when woken up, zsock_epoll_wait() only looks at
+ * the ready list.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <errno.h>
+
+#include <net/socket.h>
+
+#define IDLE_SOCKETS 200
+#define SOCKETS (IDLE_SOCKETS + 1)
+#define ROUNDS 100
+#define BASE_PORT 4000
+#define ADDR "192.0.2.1"
+
+#define WAITER_STACK_SIZE 8192
+
+static int socks[SOCKETS];
+static struct zsock_pollfd pfds[SOCKETS];
+static int epfd;
+
+/* The last socket is the one getting data */
+static int active;
+static struct sockaddr_in active_addr;
+
+static volatile u32_t sent_at;
+static u32_t wakeup_cycles;
+static bool use_epoll;
+
+static K_SEM_DEFINE(received, 0, 1);
+static K_THREAD_STACK_DEFINE(waiter_stack, WAITER_STACK_SIZE);
+static struct k_thread waiter_thread;
+
+static int bench_wait(void)
+{
+	struct zsock_epoll_event event;
+
+	if (use_epoll) {
+		return zsock_epoll_wait(epfd, &event, 1, -1);
+	}
+
+	return zsock_poll(pfds, SOCKETS, -1);
+}
+
+static void waiter(void *p1, void *p2, void *p3)
+{
+	u32_t woken_at;
+	char data[8];
+	int i;
+
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	for (i = 0; i < 2 * (ROUNDS + 1); i++) {
+		if (bench_wait() <= 0) {
+			printk("Wait failed (%d)\n", errno);
+			return;
+		}
+
+		woken_at = k_cycle_get_32();
+		wakeup_cycles += woken_at - sent_at;
+
+		(void)zsock_recv(active, data, sizeof(data),
+				 ZSOCK_MSG_DONTWAIT);
+
+		k_sem_give(&received);
+	}
+}
+
+static int bench_run(int sender)
+{
+	static const char data[8];
+	int i;
+
+	/* The first round is not counted: the waiter got back to waiting
+	 * before the mode was switched, so it only picks up the new mode
+	 * after that round.
+	 */
+	for (i = 0; i <= ROUNDS; i++) {
+		k_sleep(K_MSEC(2));
+
+		sent_at = k_cycle_get_32();
+
+		if (zsock_sendto(sender, data, sizeof(data), 0,
+				 (struct sockaddr *)&active_addr,
+				 sizeof(active_addr)) < 0) {
+			printk("Cannot send (%d)\n", errno);
+			return -1;
+		}
+
+		if (k_sem_take(&received, K_MSEC(1000)) < 0) {
+			printk("Datagram %d not received\n", i);
+			return -1;
+		}
+
+		if (i == 0) {
+			wakeup_cycles = 0U;
+		}
+	}
+
+	return (int)(k_cyc_to_ns_floor64(wakeup_cycles) / ROUNDS);
+}
+
+static int open_sockets(void)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+	};
+	struct zsock_epoll_event event;
+	int i;
+
+	zsock_inet_pton(AF_INET, ADDR, &addr.sin_addr);
+
+	epfd = zsock_epoll_create(1);
+	if (epfd < 0) {
+		printk("Cannot create event set (%d)\n", errno);
+		return -1;
+	}
+
+	for (i = 0; i < SOCKETS; i++) {
+		socks[i] = zsock_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if (socks[i] < 0) {
+			printk("Cannot create socket %d (%d)\n", i, errno);
+			return -1;
+		}
+
+		addr.sin_port = htons(BASE_PORT + i);
+
+		if (zsock_bind(socks[i], (struct sockaddr *)&addr,
+			       sizeof(addr)) < 0) {
+			printk("Cannot bind socket %d (%d)\n", i, errno);
+			return -1;
+		}
+
+		pfds[i].fd = socks[i];
+		pfds[i].events = ZSOCK_POLLIN;
+
+		event.events = ZSOCK_EPOLLIN;
+		event.data.fd = socks[i];
+
+		if (zsock_epoll_ctl(epfd, ZSOCK_EPOLL_CTL_ADD, socks[i],
+				    &event) < 0) {
+			printk("Cannot register socket %d (%d)\n", i, errno);
+			return -1;
+		}
+	}
+
+	active = socks[SOCKETS - 1];
+	active_addr = addr;
+
+	return 0;
+}
+
+void main(void)
+{
+	int sender;
+	int ns;
+
+	if (open_sockets() < 0) {
+		return;
+	}
+
+	sender = zsock_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (sender < 0) {
+		printk("Cannot create sender socket (%d)\n", errno);
+		return;
+	}
+
+	use_epoll = true;
+
+	k_thread_create(&waiter_thread, waiter_stack,
+			K_THREAD_STACK_SIZEOF(waiter_stack), waiter, NULL, NULL,
+			NULL, k_thread_priority_get(k_current_get()), 0,
+			K_NO_WAIT);
+
+	ns = bench_run(sender);
+	if (ns < 0) {
+		return;
+	}
+
+	printk("epoll wakeup: %d ns\n", ns);
+
+	use_epoll = false;
+
+	ns = bench_run(sender);
+	if (ns < 0) {
+		return;
+	}
+
+	printk("poll wakeup: %d ns\n", ns);
+
+	printk("fin\n");
+}
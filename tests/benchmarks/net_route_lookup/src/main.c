@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Route lookup benchmark.
+ *
+ * Routing tables of 10, 100 and 1000 pseudo random IPv6 prefixes between
+ * /40 and /64 are built on a dummy interface, and addresses inside the
+ * prefixes are looked up in turn. There are more distinct destinations
+ * than route cache entries, so these lookups miss the cache. The same
+ * destination is looked up repeatedly as well, which hits it. The
+ * average time of a lookup is reported for each case, and for an IPv4
+ * routing table of the same sizes if CONFIG_NET_ROUTE_IPV4 is set.
+ * Compare the results with CONFIG_NET_ROUTE_LPM disabled.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <string.h>
+
+#include <net/net_if.h>
+#include <net/dummy.h>
+
+#include "ipv6.h"
+#include "route.h"
+
+#define MAX_ROUTES 1000
+#define N_NEXTHOPS 8
+#define N_DESTINATIONS 256
+#define LOOKUPS 10000
+
+static const int table_sizes[] = { 10, 100, 1000 };
+
+static struct net_if *iface;
+static struct in6_addr nexthops[N_NEXTHOPS];
+static u8_t nexthop_lladdrs[N_NEXTHOPS][6];
+static struct net_route_entry *routes[MAX_ROUTES];
+static struct in6_addr destinations[N_DESTINATIONS];
+static u32_t seed = 1U;
+
+#if defined(CONFIG_NET_ROUTE_IPV4)
+static struct net_route_entry_ipv4 *routes_ipv4[MAX_ROUTES];
+static struct in_addr destinations_ipv4[N_DESTINATIONS];
+#endif
+
+static void bench_iface_init(struct net_if *iface)
+{
+	static u8_t mac[] = { 0x00, 0x00, 0x5e, 0x00, 0x53, 0x01 };
+
+	net_if_set_link_addr(iface, mac, sizeof(mac), NET_LINK_DUMMY);
+}
+
+static int bench_send(struct device *dev, struct net_pkt *pkt)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(pkt);
+
+	return 0;
+}
+
+static struct dummy_api bench_api = {
+	.iface_api.init = bench_iface_init,
+	.send = bench_send,
+};
+
+static int bench_dev_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return 0;
+}
+
+NET_DEVICE_INIT(bench_dummy, "bench_dummy", bench_dev_init,
+		device_pm_control_nop, NULL, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &bench_api,
+		DUMMY_L2, NET_L2_GET_CTX_TYPE(DUMMY_L2), 1280);
+
+/* Same tables on every run */
+static u32_t next_rand(void)
+{
+	seed = seed * 1103515245U + 12345U;
+
+	return (seed >> 16) | (seed << 16);
+}
+
+static u32_t ns_per_lookup(u32_t cycles)
+{
+	return (u32_t)(k_cyc_to_ns_floor64(cycles) / LOOKUPS);
+}
+
+static int add_nexthops(void)
+{
+	struct net_linkaddr lladdr;
+	int i;
+
+	for (i = 0; i < N_NEXTHOPS; i++) {
+		nexthops[i].s6_addr[0] = 0xfe;
+		nexthops[i].s6_addr[1] = 0x80;
+		nexthops[i].s6_addr[15] = i + 1;
+
+		nexthop_lladdrs[i][0] = 0x02;
+		nexthop_lladdrs[i][5] = i + 1;
+
+		lladdr.addr = nexthop_lladdrs[i];
+		lladdr.len = sizeof(nexthop_lladdrs[i]);
+		lladdr.type = NET_LINK_DUMMY;
+
+		if (!net_ipv6_nbr_add(iface, &nexthops[i], &lladdr, true,
+				      NET_IPV6_NBR_STATE_REACHABLE)) {
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+static int add_routes(int count)
+{
+	struct in6_addr prefix;
+	u8_t prefix_len;
+	int i = 0;
+
+	while (i < count) {
+		memset(&prefix, 0, sizeof(prefix));
+		UNALIGNED_PUT(htonl(0x20010db8), &prefix.s6_addr32[0]);
+		UNALIGNED_PUT(next_rand(), &prefix.s6_addr32[1]);
+
+		prefix_len = 40U + next_rand() % 25U;
+
+		/* Adding a prefix inside an existing route would update
+		 * that route instead.
+		 */
+		if (net_route_lookup(iface, &prefix)) {
+			continue;
+		}
+
+		routes[i] = net_route_add(iface, &prefix, prefix_len,
+					  &nexthops[i % N_NEXTHOPS]);
+		if (!routes[i]) {
+			return -ENOMEM;
+		}
+
+		i++;
+	}
+
+	for (i = 0; i < N_DESTINATIONS; i++) {
+		struct net_route_entry *route = routes[next_rand() % count];
+
+		net_ipaddr_copy(&destinations[i], &route->addr);
+		UNALIGNED_PUT(next_rand(), &destinations[i].s6_addr32[3]);
+	}
+
+	return 0;
+}
+
+static void del_routes(int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		(void)net_route_del(routes[i]);
+	}
+}
+
+static int bench_ipv6(int count)
+{
+	u32_t start, cycles;
+	int ret, i;
+
+	ret = add_routes(count);
+	if (ret < 0) {
+		printk("Cannot add %d routes (%d)\n", count, ret);
+		return ret;
+	}
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < LOOKUPS; i++) {
+		if (!net_route_lookup(iface,
+				      &destinations[i % N_DESTINATIONS])) {
+			printk("No route found\n");
+			return -ENOENT;
+		}
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	printk("route lookup %d routes: %u ns\n", count, ns_per_lookup(cycles));
+
+	if (count == MAX_ROUTES) {
+		start = k_cycle_get_32();
+
+		for (i = 0; i < LOOKUPS; i++) {
+			(void)net_route_lookup(iface, &destinations[0]);
+		}
+
+		cycles = k_cycle_get_32() - start;
+
+		printk("route lookup cached: %u ns\n", ns_per_lookup(cycles));
+	}
+
+	del_routes(count);
+
+	return 0;
+}
+
+#if defined(CONFIG_NET_ROUTE_IPV4)
+static int bench_ipv4(int count)
+{
+	struct in_addr prefix, gw;
+	u32_t start, cycles;
+	u8_t prefix_len;
+	int i = 0;
+
+	gw.s_addr = htonl(0xc0000201);
+
+	while (i < count) {
+		prefix.s_addr = htonl(0x0a000000 | (next_rand() & 0x00ffffff));
+		prefix_len = 16U + next_rand() % 17U;
+
+		/* Keep the prefixes distinct, as for IPv6 */
+		if (net_route_ipv4_lookup(iface, &prefix)) {
+			continue;
+		}
+
+		routes_ipv4[i] = net_route_ipv4_add(iface, &prefix,
+						    prefix_len, &gw);
+		if (!routes_ipv4[i]) {
+			printk("Cannot add %d IPv4 routes\n", count);
+			return -ENOMEM;
+		}
+
+		i++;
+	}
+
+	for (i = 0; i < N_DESTINATIONS; i++) {
+		struct net_route_entry_ipv4 *route =
+			routes_ipv4[next_rand() % count];
+		u32_t host = 0U;
+
+		if (route->prefix_len < 32) {
+			host = next_rand() >> route->prefix_len;
+		}
+
+		destinations_ipv4[i].s_addr = route->addr.s_addr | htonl(host);
+	}
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < LOOKUPS; i++) {
+		struct in_addr *dst = &destinations_ipv4[i % N_DESTINATIONS];
+
+		if (!net_route_ipv4_lookup(iface, dst)) {
+			printk("No IPv4 route found\n");
+			return -ENOENT;
+		}
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	printk("route ipv4 lookup %d routes: %u ns\n", count,
+	       ns_per_lookup(cycles));
+
+	for (i = 0; i < count; i++) {
+		(void)net_route_ipv4_del(routes_ipv4[i]);
+	}
+
+	return 0;
+}
+#endif
+
+void main(void)
+{
+	int ret, i;
+
+	iface = net_if_get_first_by_type(&NET_L2_GET_NAME(DUMMY));
+	if (!iface) {
+		printk("No dummy interface\n");
+		return;
+	}
+
+	ret = add_nexthops();
+	if (ret < 0) {
+		printk("Cannot add nexthops (%d)\n", ret);
+		return;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(table_sizes); i++) {
+		if (bench_ipv6(table_sizes[i]) < 0) {
+			return;
+		}
+	}
+
+#if defined(CONFIG_NET_ROUTE_IPV4)
+	for (i = 0; i < ARRAY_SIZE(table_sizes); i++) {
+		if (bench_ipv4(table_sizes[i]) < 0) {
+			return;
+		}
+	}
+#endif
+
+	printk("fin\n");
+}
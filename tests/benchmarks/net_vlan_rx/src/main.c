@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* VLAN receive benchmark.
+ *
+ * An Ethernet device has one network interface per VLAN, and every one of
+ * them has a number of global IPv6 addresses. VLAN tagged IPv6/UDP frames
+ * to all those addresses are fed to the interfaces the way a driver would
+ * do it, and the time until all of them have been delivered to a UDP
+ * context is reported together with the resulting packet rate. Every
+ * packet needs the destination address to be found among the addresses of
+ * all the interfaces, so the rate depends on how that lookup scales, see
+ * CONFIG_NET_IF_ADDR_HASH.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <sys/atomic.h>
+#include <string.h>
+
+#include <net/net_if.h>
+#include <net/net_pkt.h>
+#include <net/net_context.h>
+#include <net/ethernet.h>
+
+#include "ipv6.h"
+#include "udp_internal.h"
+
+#define N_IFACES NET_VLAN_MAX_COUNT
+#define ADDRS_PER_IFACE 4
+#define N_ADDRS (N_IFACES * ADDRS_PER_IFACE)
+#define PACKETS 10000
+#define PAYLOAD_LEN 16
+#define IP_LEN (sizeof(struct net_ipv6_hdr) + sizeof(struct net_udp_hdr) + \
+		PAYLOAD_LEN)
+
+#define VLAN_TAG_BASE 100
+#define SRC_PORT 20000
+#define DST_PORT 4242
+
+static u8_t my_mac[] = { 0x00, 0x00, 0x5e, 0x00, 0x53, 0x01 };
+static u8_t peer_mac[] = { 0x00, 0x00, 0x5e, 0x00, 0x53, 0x02 };
+
+static struct in6_addr peer_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 0xff, 0xff,
+					 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+
+static struct net_if *ifaces[N_IFACES];
+static struct net_context *ctx;
+
+/* IPv6/UDP part of the frames, one per address */
+static u8_t datagrams[N_ADDRS][IP_LEN];
+
+static atomic_t received;
+static K_SEM_DEFINE(all_received, 0, 1);
+
+static void bench_iface_init(struct net_if *iface)
+{
+	net_if_set_link_addr(iface, my_mac, sizeof(my_mac),
+			     NET_LINK_ETHERNET);
+
+	ethernet_init(iface);
+}
+
+static int bench_send(struct device *dev, struct net_pkt *pkt)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(pkt);
+
+	return 0;
+}
+
+static enum ethernet_hw_caps bench_capabilities(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return ETHERNET_HW_VLAN;
+}
+
+static struct ethernet_api bench_api = {
+	.iface_api.init = bench_iface_init,
+	.get_capabilities = bench_capabilities,
+	.send = bench_send,
+};
+
+static int bench_dev_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return 0;
+}
+
+ETH_NET_DEVICE_INIT(bench_eth, "bench_eth", bench_dev_init,
+		    device_pm_control_nop, NULL, NULL,
+		    CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &bench_api,
+		    NET_ETH_MTU);
+
+static void recv_cb(struct net_context *context, struct net_pkt *pkt,
+		    union net_ip_header *ip_hdr,
+		    union net_proto_header *proto_hdr,
+		    int status, void *user_data)
+{
+	if (!pkt) {
+		return;
+	}
+
+	net_pkt_unref(pkt);
+
+	if (atomic_inc(&received) + 1 == PACKETS) {
+		k_sem_give(&all_received);
+	}
+}
+
+/* 2001:db8:<iface>::<addr + 1> */
+static void bench_addr(struct in6_addr *addr, int iface, int idx)
+{
+	net_ipv6_addr_create(addr, 0x2001, 0x0db8, iface, 0, 0, 0, 0,
+			     idx + 1);
+}
+
+static int build_datagram(int iface, int idx, u8_t *buf)
+{
+	static const u8_t payload[PAYLOAD_LEN];
+	struct in6_addr dst;
+	struct net_pkt *pkt;
+	int ret;
+
+	pkt = net_pkt_alloc_with_buffer(ifaces[iface], PAYLOAD_LEN, AF_INET6,
+					IPPROTO_UDP, K_FOREVER);
+	if (!pkt) {
+		return -ENOMEM;
+	}
+
+	bench_addr(&dst, iface, idx);
+
+	if (net_ipv6_create(pkt, &peer_addr, &dst) ||
+	    net_udp_create(pkt, htons(SRC_PORT), htons(DST_PORT)) ||
+	    net_pkt_write(pkt, payload, sizeof(payload))) {
+		net_pkt_unref(pkt);
+		return -ENOMEM;
+	}
+
+	net_pkt_cursor_init(pkt);
+	net_ipv6_finalize(pkt, IPPROTO_UDP);
+	net_pkt_cursor_init(pkt);
+
+	ret = net_pkt_read(pkt, buf, IP_LEN);
+
+	net_pkt_unref(pkt);
+
+	return ret;
+}
+
+static int setup(void)
+{
+	struct sockaddr_in6 addr = {
+		.sin6_family = AF_INET6,
+		.sin6_port = htons(DST_PORT),
+	};
+	struct in6_addr in6_addr;
+	int ret, i, j;
+	u8_t *buf;
+
+	for (i = 0; i < N_IFACES; i++) {
+		ifaces[i] = net_if_get_by_index(i + 1);
+		if (!ifaces[i] ||
+		    net_if_l2(ifaces[i]) != &NET_L2_GET_NAME(ETHERNET)) {
+			printk("No interface %d\n", i + 1);
+			return -ENOENT;
+		}
+
+		ret = net_eth_vlan_enable(ifaces[i], VLAN_TAG_BASE + i);
+		if (ret < 0) {
+			printk("Cannot enable VLAN tag %d (%d)\n",
+			       VLAN_TAG_BASE + i, ret);
+			return ret;
+		}
+
+		for (j = 0; j < ADDRS_PER_IFACE; j++) {
+			bench_addr(&in6_addr, i, j);
+
+			if (!net_if_ipv6_addr_add(ifaces[i], &in6_addr,
+						  NET_ADDR_MANUAL, 0)) {
+				printk("Cannot add IPv6 address\n");
+				return -ENOMEM;
+			}
+
+			buf = datagrams[i * ADDRS_PER_IFACE + j];
+
+			ret = build_datagram(i, j, buf);
+			if (ret < 0) {
+				printk("Cannot build datagram (%d)\n", ret);
+				return ret;
+			}
+		}
+	}
+
+	ret = net_context_get(AF_INET6, SOCK_DGRAM, IPPROTO_UDP, &ctx);
+	if (ret < 0) {
+		printk("Cannot get context (%d)\n", ret);
+		return ret;
+	}
+
+	ret = net_context_bind(ctx, (struct sockaddr *)&addr, sizeof(addr));
+	if (ret < 0) {
+		printk("Cannot bind context (%d)\n", ret);
+		return ret;
+	}
+
+	return net_context_recv(ctx, recv_cb, K_NO_WAIT, NULL);
+}
+
+/* What the driver does: allocate the frame, and pass it to the interface
+ * of its VLAN tag.
+ */
+static int inject(int idx)
+{
+	struct net_eth_vlan_hdr hdr;
+	u16_t tag = VLAN_TAG_BASE + idx / ADDRS_PER_IFACE;
+	struct net_if *iface;
+	struct net_pkt *pkt;
+
+	iface = net_eth_get_vlan_iface(ifaces[0], tag);
+
+	pkt = net_pkt_rx_alloc_with_buffer(iface, sizeof(hdr) + IP_LEN,
+					   AF_UNSPEC, 0, K_FOREVER);
+	if (!pkt) {
+		return -ENOMEM;
+	}
+
+	memcpy(&hdr.dst, my_mac, sizeof(hdr.dst));
+	memcpy(&hdr.src, peer_mac, sizeof(hdr.src));
+	hdr.vlan.tpid = htons(NET_ETH_PTYPE_VLAN);
+	hdr.vlan.tci = htons(tag);
+	hdr.type = htons(NET_ETH_PTYPE_IPV6);
+
+	if (net_pkt_write(pkt, &hdr, sizeof(hdr)) ||
+	    net_pkt_write(pkt, datagrams[idx], IP_LEN)) {
+		net_pkt_unref(pkt);
+		return -ENOMEM;
+	}
+
+	net_pkt_cursor_init(pkt);
+
+	if (net_recv_data(iface, pkt) < 0) {
+		net_pkt_unref(pkt);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+void main(void)
+{
+	u32_t start, cycles, us;
+	int i;
+
+	if (setup() < 0) {
+		return;
+	}
+
+	start = k_cycle_get_32();
+
+	/* Go through the addresses of all the interfaces in turn */
+	for (i = 0; i < PACKETS; i++) {
+		if (inject(i % N_ADDRS) < 0) {
+			printk("Cannot inject packet %d\n", i);
+			return;
+		}
+	}
+
+	if (k_sem_take(&all_received, K_SECONDS(30))) {
+		printk("Timeout, received %d/%d\n",
+		       (int)atomic_get(&received), PACKETS);
+		return;
+	}
+
+	cycles = k_cycle_get_32() - start;
+	us = (u32_t)k_cyc_to_us_floor64(cycles);
+
+	printk("vlan rx %d ifaces %d addrs: %d pkts in %u us, %u pps\n",
+	       N_IFACES, N_ADDRS, PACKETS, us,
+	       (u32_t)(((u64_t)PACKETS * USEC_PER_SEC) / MAX(us, 1U)));
+
+	printk("fin\n");
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* PPP HDLC framing benchmark.
+ *
+ * The FCS of a frame is computed with the shift and xor crc16_ccitt()
+ * used by the PPP driver before and with the lookup table, and the frame is
+ * escaped for sending and scanned for the flag and escape bytes as the
+ * receive path does. The throughput of each step is reported. The frame
+ * contains pseudo random data, so about one byte in eight needs escaping.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+#include <sys/crc.h>
+#include <string.h>
+
+#include "ppp_hdlc.h"
+
+#define ITERATIONS 1000
+#define FRAME_LEN 1500
+
+static u8_t frame[FRAME_LEN];
+static u8_t escaped[2 * FRAME_LEN];
+
+static u32_t kb_per_second(u32_t cycles)
+{
+	u64_t ns = k_cyc_to_ns_floor64(cycles);
+
+	return ns ? (u32_t)((u64_t)ITERATIONS * FRAME_LEN * 1000000ULL / ns) :
+		0;
+}
+
+void main(void)
+{
+	u32_t start, cycles;
+	u16_t fcs_shift = 0, fcs_table = 0;
+	size_t len = 0, consumed, found = 0;
+	u32_t seed = 1U;
+	int i;
+
+	/* Same data on every run */
+	for (i = 0; i < sizeof(frame); i++) {
+		seed = seed * 1103515245U + 12345U;
+		frame[i] = seed >> 16;
+	}
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < ITERATIONS; i++) {
+		fcs_shift = crc16_ccitt(PPP_HDLC_FCS_INIT, frame,
+					sizeof(frame));
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	printk("ppp fcs shift: %u KB/s\n", kb_per_second(cycles));
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < ITERATIONS; i++) {
+		fcs_table = ppp_hdlc_fcs(PPP_HDLC_FCS_INIT, frame,
+					 sizeof(frame));
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	if (fcs_table != fcs_shift) {
+		printk("FCS mismatch 0x%04x != 0x%04x\n", fcs_table, fcs_shift);
+		return;
+	}
+
+	printk("ppp fcs table: %u KB/s\n", kb_per_second(cycles));
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < ITERATIONS; i++) {
+		len = ppp_hdlc_escape(frame, sizeof(frame), escaped,
+				      sizeof(escaped), &consumed);
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	if (consumed != sizeof(frame)) {
+		printk("Frame not escaped (%zu bytes)\n", consumed);
+		return;
+	}
+
+	printk("ppp escape: %u KB/s\n", kb_per_second(cycles));
+
+	start = k_cycle_get_32();
+
+	for (i = 0; i < ITERATIONS; i++) {
+		size_t off = 0;
+
+		found = 0;
+
+		/* Walk the escaped frame the way the receive path does */
+		while (off < len) {
+			off += ppp_hdlc_scan(&escaped[off], len - off);
+			if (off < len) {
+				found++;
+				off++;
+			}
+		}
+	}
+
+	cycles = k_cycle_get_32() - start;
+
+	if (found < len - sizeof(frame)) {
+		printk("Escapes not found (%zu)\n", found);
+		return;
+	}
+
+	printk("ppp scan: %u KB/s\n", kb_per_second(cycles));
+
+	printk("fin\n");
+}
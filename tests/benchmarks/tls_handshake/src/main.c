@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* TLS handshake benchmark for the session cache of the TLS sockets.
+ *
+ * A client connects N_HANDSHAKES times to a TLS server over the loopback
+ * interface, first with the session cache disabled so that every
+ * connection does a full handshake, then with the cache enabled so that
+ * all but the first connection resume the session of the previous one.
+ * The benchmark reports the average time spent in connect(), which
+ * includes the handshake. It fails if a handshake that should have
+ * resumed the session was a full one, or the other way around.
+ */
+
+#include <zephyr.h>
+#include <sys/printk.h>
+
+#include <net/socket.h>
+#include <net/tls_credentials.h>
+
+#define N_HANDSHAKES 8
+#define SERVER_PORT 4243
+#define SERVER_CERTIFICATE_TAG 1
+#define STACK_SIZE 4096
+#define THREAD_PRIORITY K_PRIO_PREEMPT(8)
+
+static const unsigned char server_certificate[] = {
+#include "echo-apps-cert.der.inc"
+};
+
+/* This is the private key in pkcs#8 format. */
+static const unsigned char private_key[] = {
+#include "echo-apps-key.der.inc"
+};
+
+static struct sockaddr_in server_addr = {
+	.sin_family = AF_INET,
+	.sin_port = htons(SERVER_PORT),
+	.sin_addr = { { { 127, 0, 0, 1 } } },
+};
+
+static int server_sock;
+
+static void tls_server(void)
+{
+	int client;
+	char c;
+
+	while (true) {
+		client = accept(server_sock, NULL, NULL);
+		if (client < 0) {
+			printk("Cannot accept (%d)\n", errno);
+			continue;
+		}
+
+		/* Wait for the client to close the connection */
+		(void)recv(client, &c, sizeof(c), 0);
+		(void)close(client);
+	}
+}
+
+K_THREAD_DEFINE(tls_server_thread_id, STACK_SIZE,
+		tls_server, NULL, NULL, NULL,
+		THREAD_PRIORITY, 0, K_FOREVER);
+
+static int setup_server(void)
+{
+	sec_tag_t sec_tag_list[] = { SERVER_CERTIFICATE_TAG };
+	int cache = TLS_SESSION_CACHE_ENABLED;
+	int ret;
+
+	ret = tls_credential_add(SERVER_CERTIFICATE_TAG,
+				 TLS_CREDENTIAL_SERVER_CERTIFICATE,
+				 server_certificate,
+				 sizeof(server_certificate));
+	if (ret < 0) {
+		printk("Cannot add server certificate (%d)\n", ret);
+		return ret;
+	}
+
+	ret = tls_credential_add(SERVER_CERTIFICATE_TAG,
+				 TLS_CREDENTIAL_PRIVATE_KEY,
+				 private_key, sizeof(private_key));
+	if (ret < 0) {
+		printk("Cannot add private key (%d)\n", ret);
+		return ret;
+	}
+
+	server_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TLS_1_2);
+	if (server_sock < 0) {
+		printk("Cannot create server socket (%d)\n", errno);
+		return -errno;
+	}
+
+	if (setsockopt(server_sock, SOL_TLS, TLS_SEC_TAG_LIST,
+		       sec_tag_list, sizeof(sec_tag_list)) < 0 ||
+	    setsockopt(server_sock, SOL_TLS, TLS_SESSION_CACHE,
+		       &cache, sizeof(cache)) < 0) {
+		printk("Cannot set TLS options (%d)\n", errno);
+		return -errno;
+	}
+
+	if (bind(server_sock, (struct sockaddr *)&server_addr,
+		 sizeof(server_addr)) < 0 ||
+	    listen(server_sock, 1) < 0) {
+		printk("Cannot listen (%d)\n", errno);
+		return -errno;
+	}
+
+	k_thread_start(tls_server_thread_id);
+
+	return 0;
+}
+
+/* Return the average connect() time in microseconds, or 0 on error */
+static u32_t run_handshakes(int cache)
+{
+	int verify = TLS_PEER_VERIFY_NONE;
+	u32_t start, cycles = 0U;
+	socklen_t optlen;
+	int i, sock, ret;
+	int resumed;
+
+	for (i = 0; i < N_HANDSHAKES; i++) {
+		sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TLS_1_2);
+		if (sock < 0) {
+			printk("Cannot create client socket (%d)\n", errno);
+			return 0U;
+		}
+
+		if (setsockopt(sock, SOL_TLS, TLS_PEER_VERIFY,
+			       &verify, sizeof(verify)) < 0 ||
+		    setsockopt(sock, SOL_TLS, TLS_SESSION_CACHE,
+			       &cache, sizeof(cache)) < 0) {
+			printk("Cannot set TLS options (%d)\n", errno);
+			(void)close(sock);
+			return 0U;
+		}
+
+		start = k_cycle_get_32();
+
+		ret = connect(sock, (struct sockaddr *)&server_addr,
+			      sizeof(server_addr));
+
+		cycles += k_cycle_get_32() - start;
+
+		if (ret < 0) {
+			printk("Cannot connect (%d)\n", errno);
+			(void)close(sock);
+			return 0U;
+		}
+
+		optlen = sizeof(resumed);
+		ret = getsockopt(sock, SOL_TLS, TLS_SESSION_RESUMED,
+				 &resumed, &optlen);
+
+		(void)close(sock);
+
+		if (ret < 0) {
+			printk("Cannot get TLS session state (%d)\n", errno);
+			return 0U;
+		}
+
+		/* Only the first handshake with the cache is a full one */
+		if (resumed != (cache == TLS_SESSION_CACHE_ENABLED && i > 0)) {
+			printk("Handshake %d %s\n", i,
+			       resumed ? "resumed unexpectedly" :
+			       "did not resume the session");
+			return 0U;
+		}
+	}
+
+	return (u32_t)k_cyc_to_us_floor64(cycles) / N_HANDSHAKES;
+}
+
+void main(void)
+{
+	int purge = 0;
+	u32_t full, resumed;
+
+	if (setup_server() < 0) {
+		return;
+	}
+
+	full = run_handshakes(TLS_SESSION_CACHE_DISABLED);
+
+	/* Start from an empty cache, the first handshake is a full one and
+	 * stores the session for the others.
+	 */
+	(void)setsockopt(server_sock, SOL_TLS, TLS_SESSION_CACHE_PURGE,
+			 &purge, sizeof(purge));
+
+	resumed = run_handshakes(TLS_SESSION_CACHE_ENABLED);
+
+	if (!full || !resumed) {
+		return;
+	}
+
+	printk("TLS handshake full: %u us, resumed: %u us\n", full, resumed);
+
+	printk("fin\n");
+}
@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Added at the end of the generic mbedTLS config */
+
+/* The server side session cache and the session tickets of the TLS
+ * sockets, which the resumed handshakes use.
+ */
+#define MBEDTLS_SSL_CACHE_C
+#define MBEDTLS_SSL_TICKET_C
+#define MBEDTLS_SSL_SESSION_TICKETS
@@ -641,9 +641,228 @@ void test_arp(void)
 	}
 }
 
+/* The following tests use the address and the netmask set by test_arp() */
+static struct in_addr my_addr = { { { 192, 168, 0, 1 } } };
+
+static struct net_eth_addr hwaddr_a = {
+	{ 0x02, 0x00, 0x5e, 0x10, 0x00, 0xa1 }
+};
+static struct net_eth_addr hwaddr_b = {
+	{ 0x02, 0x00, 0x5e, 0x10, 0x00, 0xa2 }
+};
+static struct net_eth_addr hwaddr_c = {
+	{ 0x02, 0x00, 0x5e, 0x10, 0x00, 0xa3 }
+};
+
+/* Same hash as arp_hash_bucket(), to pick addresses sharing a bucket */
+static int arp_bucket(struct net_if *iface, struct in_addr *addr)
+{
+	u32_t hash = UNALIGNED_GET(&addr->s_addr) ^
+		     (u32_t)((uintptr_t)iface >> 2);
+
+	hash *= 0x9e3779b1U;
+
+	return (hash >> 16) % CONFIG_NET_ARP_TABLE_SIZE;
+}
+
+/* Feed an ARP request for our address, which adds or updates the entry of
+ * the sender.
+ */
+static void arp_add_entry(struct net_if *iface, struct in_addr *addr,
+			  struct net_eth_addr *addr_hw)
+{
+	struct net_eth_hdr *eth_hdr;
+	struct net_arp_hdr *arp_hdr;
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_alloc_with_buffer(iface, sizeof(struct net_eth_hdr) +
+					sizeof(struct net_arp_hdr),
+					AF_UNSPEC, 0, K_SECONDS(1));
+	zassert_not_null(pkt, "out of mem request");
+
+	eth_hdr = (struct net_eth_hdr *)net_pkt_data(pkt);
+	memcpy(&eth_hdr->dst, net_if_get_link_addr(iface)->addr,
+	       sizeof(struct net_eth_addr));
+	memcpy(&eth_hdr->src, addr_hw, sizeof(struct net_eth_addr));
+	eth_hdr->type = htons(NET_ETH_PTYPE_ARP);
+
+	net_buf_add(pkt->buffer, sizeof(struct net_eth_hdr));
+	net_buf_pull(pkt->buffer, sizeof(struct net_eth_hdr));
+	arp_hdr = NET_ARP_HDR(pkt);
+
+	arp_hdr->hwtype = htons(NET_ARP_HTYPE_ETH);
+	arp_hdr->protocol = htons(NET_ETH_PTYPE_IP);
+	arp_hdr->hwlen = sizeof(struct net_eth_addr);
+	arp_hdr->protolen = sizeof(struct in_addr);
+	arp_hdr->opcode = htons(NET_ARP_REQUEST);
+	memcpy(&arp_hdr->src_hwaddr, addr_hw, sizeof(struct net_eth_addr));
+	(void)memset(&arp_hdr->dst_hwaddr, 0, sizeof(struct net_eth_addr));
+	net_ipaddr_copy(&arp_hdr->src_ipaddr, addr);
+	net_ipaddr_copy(&arp_hdr->dst_ipaddr, &my_addr);
+
+	net_buf_add(pkt->buffer, sizeof(struct net_arp_hdr));
+
+	/* Our reply is not checked */
+	req_test = true;
+
+	zassert_equal(net_arp_input(pkt, eth_hdr), NET_OK,
+		      "ARP request dropped");
+
+	k_yield();
+}
+
+static bool arp_entry_present(struct in_addr *addr,
+			      struct net_eth_addr *addr_hw)
+{
+	entry_found = false;
+	expected_hwaddr = addr_hw;
+	net_arp_foreach(arp_cb, addr);
+
+	return entry_found;
+}
+
+/* Resolve addr as done for a sent packet, return true if it was found in
+ * the cache with the link address addr_hw.
+ */
+static bool arp_resolve(struct net_if *iface, struct in_addr *addr,
+			struct net_eth_addr *addr_hw)
+{
+	struct net_ipv4_hdr *ipv4;
+	struct net_pkt *pkt, *ret;
+	bool found;
+
+	pkt = net_pkt_alloc_with_buffer(iface, sizeof(struct net_ipv4_hdr),
+					AF_INET, 0, K_SECONDS(1));
+	zassert_not_null(pkt, "out of mem");
+
+	ipv4 = (struct net_ipv4_hdr *)net_buf_add(pkt->buffer,
+						  sizeof(struct net_ipv4_hdr));
+	net_ipaddr_copy(&ipv4->src, &my_addr);
+	net_ipaddr_copy(&ipv4->dst, addr);
+
+	ret = net_arp_prepare(pkt, addr, NULL);
+	zassert_not_null(ret, "no packet to send");
+
+	found = ret == pkt;
+	if (found) {
+		found = memcmp(net_pkt_lladdr_dst(pkt)->addr, addr_hw,
+			       sizeof(struct net_eth_addr)) == 0;
+	} else {
+		/* An ARP request, the packet waits for the reply */
+		net_pkt_unref(ret);
+	}
+
+	net_pkt_unref(pkt);
+
+	return found;
+}
+
+static void test_arp_hash_collision(void)
+{
+	struct net_if *iface = net_if_get_default();
+	struct in_addr addr_a = { { { 192, 168, 0, 10 } } };
+	struct in_addr addr_b = { { { 192, 168, 0, 11 } } };
+
+	net_arp_clear_cache(iface);
+
+	while (arp_bucket(iface, &addr_b) != arp_bucket(iface, &addr_a)) {
+		addr_b.s4_addr[3]++;
+		zassert_true(addr_b.s4_addr[3] < 255, "no colliding address");
+	}
+
+	arp_add_entry(iface, &addr_a, &hwaddr_a);
+	arp_add_entry(iface, &addr_b, &hwaddr_b);
+
+	zassert_true(arp_resolve(iface, &addr_a, &hwaddr_a),
+		     "first entry of the bucket not found");
+	zassert_true(arp_resolve(iface, &addr_b, &hwaddr_b),
+		     "second entry of the bucket not found");
+
+	/* Updating one entry leaves the other one alone */
+	arp_add_entry(iface, &addr_b, &hwaddr_c);
+
+	zassert_true(arp_resolve(iface, &addr_b, &hwaddr_c),
+		     "entry not updated");
+	zassert_true(arp_resolve(iface, &addr_a, &hwaddr_a),
+		     "other entry of the bucket changed");
+
+	net_arp_clear_cache(iface);
+
+	zassert_false(arp_entry_present(&addr_a, &hwaddr_a),
+		      "entry not flushed");
+	zassert_false(arp_entry_present(&addr_b, &hwaddr_c),
+		      "entry not flushed");
+}
+
+static void test_arp_lru_eviction(void)
+{
+	struct net_if *iface = net_if_get_default();
+	struct in_addr addr_a = { { { 192, 168, 0, 20 } } };
+	struct in_addr addr_b = { { { 192, 168, 0, 21 } } };
+	struct in_addr addr_c = { { { 192, 168, 0, 22 } } };
+
+	zassert_equal(CONFIG_NET_ARP_TABLE_SIZE, 2,
+		      "the test expects a table of 2 entries");
+
+	net_arp_clear_cache(iface);
+
+	arp_add_entry(iface, &addr_a, &hwaddr_a);
+	arp_add_entry(iface, &addr_b, &hwaddr_b);
+
+	/* Using a makes b the least recently used entry */
+	zassert_true(arp_resolve(iface, &addr_a, &hwaddr_a),
+		     "entry a not found");
+
+	arp_add_entry(iface, &addr_c, &hwaddr_c);
+
+	zassert_true(arp_entry_present(&addr_a, &hwaddr_a),
+		     "most recently used entry evicted");
+	zassert_false(arp_entry_present(&addr_b, &hwaddr_b),
+		      "least recently used entry kept");
+	zassert_true(arp_entry_present(&addr_c, &hwaddr_c),
+		     "new entry not added");
+
+	net_arp_clear_cache(iface);
+}
+
+static void test_arp_entry_expiry(void)
+{
+	struct net_if *iface = net_if_get_default();
+	struct in_addr addr_a = { { { 192, 168, 0, 30 } } };
+
+	zassert_true(CONFIG_NET_ARP_ENTRY_LIFETIME > 0, "aging disabled");
+
+	net_arp_clear_cache(iface);
+
+	arp_add_entry(iface, &addr_a, &hwaddr_a);
+
+	/* An ARP packet from the neighbor renews the entry */
+	k_sleep(K_MSEC(CONFIG_NET_ARP_ENTRY_LIFETIME * MSEC_PER_SEC / 2));
+	arp_add_entry(iface, &addr_a, &hwaddr_a);
+	k_sleep(K_MSEC(CONFIG_NET_ARP_ENTRY_LIFETIME * MSEC_PER_SEC / 2 +
+		       100));
+
+	zassert_true(arp_resolve(iface, &addr_a, &hwaddr_a),
+		     "renewed entry expired");
+
+	/* Using the entry does not renew it */
+	k_sleep(K_SECONDS(CONFIG_NET_ARP_ENTRY_LIFETIME));
+
+	zassert_false(arp_resolve(iface, &addr_a, &hwaddr_a),
+		      "expired entry used");
+	zassert_false(arp_entry_present(&addr_a, &hwaddr_a),
+		      "expired entry still in the table");
+
+	/* Also drops the packet waiting for the ARP reply */
+	net_arp_clear_cache(iface);
+}
+
 void test_main(void)
 {
 	ztest_test_suite(test_arp_fn,
-		ztest_unit_test(test_arp));
+		ztest_unit_test(test_arp),
+		ztest_unit_test(test_arp_hash_collision),
+		ztest_unit_test(test_arp_lru_eviction),
+		ztest_unit_test(test_arp_entry_expiry));
 	ztest_run_test_suite(test_arp_fn);
 }
@@ -0,0 +1,533 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_BPF_LOG_LEVEL);
+
+#include <ztest.h>
+#include <string.h>
+#include <sys/byteorder.h>
+
+#include <net/net_if.h>
+#include <net/net_pkt.h>
+#include <net/ethernet.h>
+#include <net/socket.h>
+#include <net/bpf.h>
+
+#include "net_private.h"
+#include "ipv4.h"
+
+#define TEST_PORT 4242
+#define ETH_P_TEST 0x88b5
+
+/* Ethernet, IPv4 and UDP headers, then the payload */
+#define ETH_HDR_LEN 14
+#define UDP_OFFSET (ETH_HDR_LEN + 20)
+#define PAYLOAD_LEN 4
+#define FRAME_LEN (UDP_OFFSET + 8 + PAYLOAD_LEN)
+
+#define WAIT_TIME K_MSEC(100)
+
+static u8_t lladdr[] = { 0x02, 0x00, 0x5e, 0x00, 0x53, 0x01 };
+static u8_t peer_lladdr[] = { 0x02, 0x00, 0x5e, 0x00, 0x53, 0x02 };
+
+static struct in_addr my_addr = { { { 192, 0, 2, 1 } } };
+static struct in_addr peer_addr = { { { 192, 0, 2, 2 } } };
+
+static struct net_if *iface;
+
+static void eth_fake_iface_init(struct net_if *iface)
+{
+	net_if_set_link_addr(iface, lladdr, sizeof(lladdr),
+			     NET_LINK_ETHERNET);
+
+	ethernet_init(iface);
+}
+
+static int eth_fake_send(struct device *dev, struct net_pkt *pkt)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(pkt);
+
+	return 0;
+}
+
+/* The test frames carry no checksums */
+static enum ethernet_hw_caps eth_fake_get_capabilities(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return ETHERNET_HW_RX_CHKSUM_OFFLOAD;
+}
+
+static struct ethernet_api eth_fake_api_funcs = {
+	.iface_api.init = eth_fake_iface_init,
+	.get_capabilities = eth_fake_get_capabilities,
+	.send = eth_fake_send,
+};
+
+static int eth_fake_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return 0;
+}
+
+ETH_NET_DEVICE_INIT(eth_fake, "eth_fake", eth_fake_init,
+		    device_pm_control_nop, NULL, NULL,
+		    CONFIG_ETH_INIT_PRIORITY, &eth_fake_api_funcs,
+		    NET_ETH_MTU);
+
+/* An Ethernet frame for us, with a UDP datagram to TEST_PORT if type is
+ * IPv4.
+ */
+static void frame_build(u8_t *frame, u16_t type)
+{
+	u8_t *ip = frame + ETH_HDR_LEN;
+	u8_t *udp = frame + UDP_OFFSET;
+
+	(void)memset(frame, 0, FRAME_LEN);
+
+	memcpy(frame, lladdr, sizeof(lladdr));
+	memcpy(frame + 6, peer_lladdr, sizeof(peer_lladdr));
+	sys_put_be16(type, frame + 12);
+
+	if (type != NET_ETH_PTYPE_IP) {
+		return;
+	}
+
+	ip[0] = 0x45;
+	sys_put_be16(FRAME_LEN - ETH_HDR_LEN, ip + 2);
+	ip[8] = 64;
+	ip[9] = IPPROTO_UDP;
+	memcpy(ip + 12, &peer_addr, sizeof(peer_addr));
+	memcpy(ip + 16, &my_addr, sizeof(my_addr));
+
+	sys_put_be16(TEST_PORT, udp);
+	sys_put_be16(TEST_PORT, udp + 2);
+	sys_put_be16(8 + PAYLOAD_LEN, udp + 4);
+	memcpy(udp + 8, "test", PAYLOAD_LEN);
+}
+
+static struct net_pkt *frame_pkt(u16_t type)
+{
+	u8_t frame[FRAME_LEN];
+	struct net_pkt *pkt;
+
+	frame_build(frame, type);
+
+	pkt = net_pkt_rx_alloc_with_buffer(iface, sizeof(frame), AF_UNSPEC,
+					   0, K_NO_WAIT);
+	zassert_not_null(pkt, "cannot allocate packet");
+	zassert_equal(net_pkt_write(pkt, frame, sizeof(frame)), 0,
+		      "cannot write");
+
+	return pkt;
+}
+
+static void frame_recv(u16_t type)
+{
+	zassert_equal(net_recv_data(iface, frame_pkt(type)), 0,
+		      "cannot receive");
+
+	k_sleep(WAIT_TIME);
+}
+
+static u32_t run(struct sock_filter *insns, u16_t len)
+{
+	struct net_bpf_filter filter = {
+		.insns = insns,
+		.len = len,
+	};
+	struct net_pkt *pkt;
+	u32_t ret;
+
+	zassert_equal(net_bpf_check(insns, len), 0, "program not valid");
+
+	pkt = frame_pkt(NET_ETH_PTYPE_IP);
+	ret = net_bpf_run(&filter, pkt);
+	net_pkt_unref(pkt);
+
+	return ret;
+}
+
+#define CHECK(...) ({							\
+		struct sock_filter insns[] = { __VA_ARGS__ };		\
+		net_bpf_check(insns, ARRAY_SIZE(insns));		\
+	})
+
+#define RUN(...) ({							\
+		struct sock_filter insns[] = { __VA_ARGS__ };		\
+		run(insns, ARRAY_SIZE(insns));				\
+	})
+
+static void test_check(void)
+{
+	struct sock_filter ret = BPF_STMT(BPF_RET | BPF_K, 0);
+
+	zassert_equal(CHECK(BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+			    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+				     NET_ETH_PTYPE_IP, 0, 1),
+			    BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+			    BPF_STMT(BPF_RET | BPF_K, 0)),
+		      0, "valid program rejected");
+
+	zassert_equal(net_bpf_check(NULL, 1), -EINVAL, "no program");
+	zassert_equal(net_bpf_check(&ret, 0), -EINVAL, "empty program");
+	zassert_equal(net_bpf_check(&ret, CONFIG_NET_BPF_MAX_INSNS + 1),
+		      -EINVAL, "program too long");
+
+	/* Backward jump, the offset wraps */
+	zassert_equal(CHECK(BPF_STMT(BPF_LD | BPF_IMM, 0),
+			    BPF_STMT(BPF_JMP | BPF_JA, (u32_t)-2),
+			    BPF_STMT(BPF_RET | BPF_K, 0)),
+		      -EINVAL, "backward jump accepted");
+
+	/* Jumps past the last instruction */
+	zassert_equal(CHECK(BPF_STMT(BPF_JMP | BPF_JA, 1),
+			    BPF_STMT(BPF_RET | BPF_K, 0)),
+		      -EINVAL, "out of range jump accepted");
+	zassert_equal(CHECK(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 0, 1),
+			    BPF_STMT(BPF_RET | BPF_K, 0)),
+		      -EINVAL, "out of range false jump accepted");
+	zassert_equal(CHECK(BPF_JUMP(BPF_JMP | BPF_JGT | BPF_X, 0, 1, 0),
+			    BPF_STMT(BPF_RET | BPF_K, 0)),
+		      -EINVAL, "out of range true jump accepted");
+
+	/* Missing return */
+	zassert_equal(CHECK(BPF_STMT(BPF_LD | BPF_IMM, 0)),
+		      -EINVAL, "program without return accepted");
+	zassert_equal(CHECK(BPF_STMT(BPF_RET | BPF_K, 0),
+			    BPF_STMT(BPF_LD | BPF_IMM, 0)),
+		      -EINVAL, "program not ending with return accepted");
+
+	zassert_equal(CHECK(BPF_STMT(BPF_ALU | BPF_DIV | BPF_K, 0),
+			    BPF_STMT(BPF_RET | BPF_A, 0)),
+		      -EINVAL, "division by zero accepted");
+	zassert_equal(CHECK(BPF_STMT(BPF_ST, BPF_MEMWORDS),
+			    BPF_STMT(BPF_RET | BPF_A, 0)),
+		      -EINVAL, "scratch memory overflow accepted");
+	zassert_equal(CHECK(BPF_STMT(0xffff, 0),
+			    BPF_STMT(BPF_RET | BPF_A, 0)),
+		      -EINVAL, "unknown instruction accepted");
+}
+
+static void test_exec(void)
+{
+	/* Division by a zero register ends the program with 0 */
+	zassert_equal(RUN(BPF_STMT(BPF_LDX | BPF_IMM, 0),
+			  BPF_STMT(BPF_LD | BPF_IMM, 10),
+			  BPF_STMT(BPF_ALU | BPF_DIV | BPF_X, 0),
+			  BPF_STMT(BPF_RET | BPF_K, 1)),
+		      0, "division by zero not stopped");
+	zassert_equal(RUN(BPF_STMT(BPF_LDX | BPF_IMM, 0),
+			  BPF_STMT(BPF_LD | BPF_IMM, 10),
+			  BPF_STMT(BPF_ALU | BPF_MOD | BPF_X, 0),
+			  BPF_STMT(BPF_RET | BPF_K, 1)),
+		      0, "modulo by zero not stopped");
+	zassert_equal(RUN(BPF_STMT(BPF_LDX | BPF_IMM, 2),
+			  BPF_STMT(BPF_LD | BPF_IMM, 10),
+			  BPF_STMT(BPF_ALU | BPF_DIV | BPF_X, 0),
+			  BPF_STMT(BPF_RET | BPF_A, 0)),
+		      5, "wrong division");
+
+	/* Loads from outside of the packet end the program with 0 */
+	zassert_equal(RUN(BPF_STMT(BPF_LD | BPF_B | BPF_ABS, FRAME_LEN - 1),
+			  BPF_STMT(BPF_RET | BPF_K, 1)),
+		      1, "last byte not loaded");
+	zassert_equal(RUN(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, FRAME_LEN - 2),
+			  BPF_STMT(BPF_RET | BPF_K, 1)),
+		      0, "load past the end not stopped");
+	zassert_equal(RUN(BPF_STMT(BPF_LD | BPF_B | BPF_ABS, FRAME_LEN),
+			  BPF_STMT(BPF_RET | BPF_K, 1)),
+		      0, "load after the end not stopped");
+	zassert_equal(RUN(BPF_STMT(BPF_LDX | BPF_IMM, 0xffffffff),
+			  BPF_STMT(BPF_LD | BPF_B | BPF_IND, 2),
+			  BPF_STMT(BPF_RET | BPF_K, 1)),
+		      0, "wrapping indirect load not stopped");
+	zassert_equal(RUN(BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, FRAME_LEN),
+			  BPF_STMT(BPF_RET | BPF_K, 1)),
+		      0, "header length load past the end not stopped");
+
+	/* IPv4 header length, then the UDP destination port after it */
+	zassert_equal(RUN(BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, ETH_HDR_LEN),
+			  BPF_STMT(BPF_MISC | BPF_TXA, 0),
+			  BPF_STMT(BPF_RET | BPF_A, 0)),
+		      20, "wrong header length");
+	zassert_equal(RUN(BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, ETH_HDR_LEN),
+			  BPF_STMT(BPF_LD | BPF_H | BPF_IND, ETH_HDR_LEN + 2),
+			  BPF_STMT(BPF_RET | BPF_A, 0)),
+		      TEST_PORT, "wrong port");
+
+	zassert_equal(RUN(BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+			  BPF_STMT(BPF_RET | BPF_A, 0)),
+		      FRAME_LEN, "wrong length");
+}
+
+static int udp_setup(void)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(TEST_PORT),
+	};
+	int sock;
+
+	sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(sock >= 0, "cannot create UDP socket");
+	zassert_equal(bind(sock, (struct sockaddr *)&addr, sizeof(addr)), 0,
+		      "cannot bind UDP socket");
+
+	return sock;
+}
+
+static bool sock_got(int sock, size_t len)
+{
+	u8_t buf[FRAME_LEN + 1];
+	ssize_t ret;
+
+	ret = recv(sock, buf, sizeof(buf), MSG_DONTWAIT);
+	if (ret < 0) {
+		zassert_equal(errno, EAGAIN, "recv failed (%d)", errno);
+		return false;
+	}
+
+	zassert_equal(ret, len, "wrong length");
+
+	return true;
+}
+
+static void test_setup(void)
+{
+	iface = net_if_get_first_by_type(&NET_L2_GET_NAME(ETHERNET));
+	zassert_not_null(iface, "no interface");
+
+	zassert_not_null(net_if_ipv4_addr_add(iface, &my_addr,
+					      NET_ADDR_MANUAL, 0),
+			 "cannot add address");
+}
+
+/* Drops the UDP datagrams to TEST_PORT */
+static struct sock_filter port_insns[] = {
+	BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, ETH_HDR_LEN),
+	BPF_STMT(BPF_LD | BPF_H | BPF_IND, ETH_HDR_LEN + 2),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, TEST_PORT, 0, 1),
+	BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+	BPF_STMT(BPF_RET | BPF_K, 0),
+};
+
+static struct sock_filter all_insns[] = {
+	BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+};
+
+static void test_iface_filter(void)
+{
+	static struct net_bpf_filter filters[CONFIG_NET_BPF_IFACE_FILTERS];
+	struct net_bpf_filter drop = {
+		.insns = port_insns,
+		.len = ARRAY_SIZE(port_insns),
+		.action = NET_BPF_DROP,
+	};
+	int sock, i;
+
+	sock = udp_setup();
+
+	zassert_equal(net_bpf_attach(iface, &drop), 0, "cannot attach");
+	zassert_equal(net_bpf_attach(iface, &drop), -EALREADY,
+		      "attached twice");
+
+	frame_recv(NET_ETH_PTYPE_IP);
+	zassert_false(sock_got(sock, PAYLOAD_LEN), "datagram not dropped");
+
+	zassert_equal(net_bpf_detach(iface, &drop), 0, "cannot detach");
+	zassert_equal(net_bpf_detach(iface, &drop), -ENOENT,
+		      "detached twice");
+
+	frame_recv(NET_ETH_PTYPE_IP);
+	zassert_true(sock_got(sock, PAYLOAD_LEN), "datagram dropped");
+
+	/* The number of filters of an interface is limited */
+	for (i = 0; i < ARRAY_SIZE(filters); i++) {
+		filters[i].insns = all_insns;
+		filters[i].len = ARRAY_SIZE(all_insns);
+		filters[i].action = NET_BPF_PRIORITY;
+
+		zassert_equal(net_bpf_attach(iface, &filters[i]), 0,
+			      "cannot attach filter %d", i);
+	}
+
+	zassert_equal(net_bpf_attach(iface, &drop), -ENOMEM,
+		      "too many filters attached");
+
+	for (i = 0; i < ARRAY_SIZE(filters); i++) {
+		zassert_equal(net_bpf_detach(iface, &filters[i]), 0,
+			      "cannot detach filter %d", i);
+	}
+
+	zassert_equal(close(sock), 0, "close failed");
+}
+
+/* Accepts the frames of the test Ethernet type */
+static struct sock_filter type_insns[] = {
+	BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_TEST, 0, 1),
+	BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+	BPF_STMT(BPF_RET | BPF_K, 0),
+};
+
+static void test_sock_filter(void)
+{
+	struct sock_filter no_ret_insns[] = {
+		BPF_STMT(BPF_LD | BPF_IMM, 0),
+	};
+	struct sock_fprog prog = {
+		.len = ARRAY_SIZE(type_insns),
+		.filter = type_insns,
+	};
+	struct sock_fprog bad_prog = {
+		.len = ARRAY_SIZE(no_ret_insns),
+		.filter = no_ret_insns,
+	};
+	struct sockaddr_ll addr = {
+		.sll_family = AF_PACKET,
+	};
+	int udp_sock, sock;
+
+	udp_sock = udp_setup();
+
+	sock = socket(AF_PACKET, SOCK_RAW, ETH_P_ALL);
+	zassert_true(sock >= 0, "cannot create packet socket");
+
+	addr.sll_ifindex = net_if_get_by_iface(iface);
+	zassert_equal(bind(sock, (struct sockaddr *)&addr, sizeof(addr)), 0,
+		      "cannot bind packet socket");
+
+	zassert_equal(setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER,
+				 &bad_prog, sizeof(bad_prog)), -1,
+		      "invalid program attached");
+	zassert_equal(errno, EINVAL, "wrong errno");
+
+	zassert_equal(setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &prog,
+				 sizeof(prog)), 0, "cannot attach filter");
+
+	/* The frames the filter rejects go to the stack */
+	frame_recv(NET_ETH_PTYPE_IP);
+	zassert_false(sock_got(sock, FRAME_LEN), "frame not filtered");
+	zassert_true(sock_got(udp_sock, PAYLOAD_LEN),
+		     "filtered frame not given to the stack");
+
+	frame_recv(ETH_P_TEST);
+	zassert_true(sock_got(sock, FRAME_LEN), "frame filtered");
+
+	/* Without a filter, the socket takes all the frames */
+	zassert_equal(setsockopt(sock, SOL_SOCKET, SO_DETACH_FILTER, NULL, 0),
+		      0, "cannot detach filter");
+	zassert_equal(setsockopt(sock, SOL_SOCKET, SO_DETACH_FILTER, NULL, 0),
+		      -1, "detached twice");
+	zassert_equal(errno, ENOENT, "wrong errno");
+
+	frame_recv(NET_ETH_PTYPE_IP);
+	zassert_true(sock_got(sock, FRAME_LEN), "frame not received");
+	zassert_false(sock_got(udp_sock, PAYLOAD_LEN),
+		      "frame given to the stack too");
+
+	zassert_equal(close(sock), 0, "close failed");
+	zassert_equal(close(udp_sock), 0, "close failed");
+}
+
+/* Accepts the IPv4 frames only */
+static struct sock_filter ipv4_insns[] = {
+	BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, NET_ETH_PTYPE_IP, 0, 1),
+	BPF_STMT(BPF_RET | BPF_K, 0xffffffff),
+	BPF_STMT(BPF_RET | BPF_K, 0),
+};
+
+#define FRAG_PAYLOAD "fragmented datagram!"
+#define FRAG_PAYLOAD_LEN (sizeof(FRAG_PAYLOAD) - 1)
+#define FRAG_FIRST_LEN 16
+
+/* A fragment of a UDP datagram to TEST_PORT carrying FRAG_PAYLOAD */
+static void frag_recv(u16_t offset, const u8_t *data, u16_t len, bool more)
+{
+	u8_t frame[ETH_HDR_LEN + 20 + FRAG_FIRST_LEN];
+	u8_t *ip = frame + ETH_HDR_LEN;
+	struct net_pkt *pkt;
+
+	(void)memset(frame, 0, sizeof(frame));
+
+	memcpy(frame, lladdr, sizeof(lladdr));
+	memcpy(frame + 6, peer_lladdr, sizeof(peer_lladdr));
+	sys_put_be16(NET_ETH_PTYPE_IP, frame + 12);
+
+	ip[0] = 0x45;
+	sys_put_be16(20 + len, ip + 2);
+	sys_put_be16(0x1234, ip + 4);
+	sys_put_be16(offset / 8 | (more ? NET_IPV4_MF : 0), ip + 6);
+	ip[8] = 64;
+	ip[9] = IPPROTO_UDP;
+	memcpy(ip + 12, &peer_addr, sizeof(peer_addr));
+	memcpy(ip + 16, &my_addr, sizeof(my_addr));
+	memcpy(ip + 20, data, len);
+
+	pkt = net_pkt_rx_alloc_with_buffer(iface, ETH_HDR_LEN + 20 + len,
+					   AF_UNSPEC, 0, K_NO_WAIT);
+	zassert_not_null(pkt, "cannot allocate packet");
+	zassert_equal(net_pkt_write(pkt, frame, ETH_HDR_LEN + 20 + len), 0,
+		      "cannot write");
+
+	zassert_equal(net_recv_data(iface, pkt), 0, "cannot receive");
+
+	k_sleep(WAIT_TIME);
+}
+
+static void test_iface_filter_reassembled(void)
+{
+	struct net_bpf_filter accept = {
+		.insns = ipv4_insns,
+		.len = ARRAY_SIZE(ipv4_insns),
+		.action = NET_BPF_ACCEPT,
+	};
+	u8_t datagram[8 + FRAG_PAYLOAD_LEN];
+	int sock;
+
+	sock = udp_setup();
+
+	sys_put_be16(TEST_PORT, datagram);
+	sys_put_be16(TEST_PORT, datagram + 2);
+	sys_put_be16(sizeof(datagram), datagram + 4);
+	sys_put_be16(0, datagram + 6);
+	memcpy(datagram + 8, FRAG_PAYLOAD, FRAG_PAYLOAD_LEN);
+
+	zassert_equal(net_bpf_attach(iface, &accept), 0, "cannot attach");
+
+	/* The fragments are filtered, the reassembled datagram that has no
+	 * Ethernet header is not.
+	 */
+	frag_recv(0, datagram, FRAG_FIRST_LEN, true);
+	zassert_false(sock_got(sock, FRAG_PAYLOAD_LEN),
+		      "datagram received before its last fragment");
+
+	frag_recv(FRAG_FIRST_LEN, datagram + FRAG_FIRST_LEN,
+		  sizeof(datagram) - FRAG_FIRST_LEN, false);
+	zassert_true(sock_got(sock, FRAG_PAYLOAD_LEN),
+		     "reassembled datagram dropped");
+
+	zassert_equal(net_bpf_detach(iface, &accept), 0, "cannot detach");
+	zassert_equal(close(sock), 0, "close failed");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(net_bpf,
+			 ztest_unit_test(test_setup),
+			 ztest_unit_test(test_check),
+			 ztest_unit_test(test_exec),
+			 ztest_unit_test(test_iface_filter),
+			 ztest_unit_test(test_iface_filter_reassembled),
+			 ztest_unit_test(test_sock_filter));
+
+	ztest_run_test_suite(net_bpf);
+}
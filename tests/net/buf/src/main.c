@@ -62,10 +62,15 @@ static int destroy_called;
 static void buf_destroy(struct net_buf *buf);
 static void fixed_destroy(struct net_buf *buf);
 static void var_destroy(struct net_buf *buf);
+static void slab_destroy(struct net_buf *buf);
 
 NET_BUF_POOL_HEAP_DEFINE(bufs_pool, 10, buf_destroy);
 NET_BUF_POOL_FIXED_DEFINE(fixed_pool, 10, 128, fixed_destroy);
 NET_BUF_POOL_VAR_DEFINE(var_pool, 10, 1024, var_destroy);
+NET_BUF_SLAB_CLASS_DEFINE(small_class, 32, 2);
+NET_BUF_SLAB_CLASS_DEFINE(large_class, 256, 2);
+NET_BUF_POOL_SLAB_DEFINE(slab_pool, 10, slab_destroy, &small_class,
+			 &large_class);
 
 static void buf_destroy(struct net_buf *buf)
 {
@@ -94,6 +99,15 @@ static void var_destroy(struct net_buf *buf)
 	net_buf_destroy(buf);
 }
 
+static void slab_destroy(struct net_buf *buf)
+{
+	struct net_buf_pool *pool = net_buf_pool_get(buf->pool_id);
+
+	destroy_called++;
+	zassert_equal(pool, &slab_pool, "Invalid free pointer in buffer");
+	net_buf_destroy(buf);
+}
+
 static const char example_data[] = "0123456789"
 				   "abcdefghijklmnopqrstuvxyz"
 				   "!#¤%&/()=?";
@@ -457,6 +471,48 @@ static void net_buf_test_var_pool(void)
 	zassert_equal(destroy_called, 3, "Incorrect destroy callback count");
 }
 
+static void net_buf_test_slab_pool(void)
+{
+	struct net_buf *buf1, *buf2, *buf3, *buf4, *buf5;
+
+	destroy_called = 0;
+
+	buf1 = net_buf_alloc_len(&slab_pool, 20, K_NO_WAIT);
+	zassert_not_null(buf1, "Failed to get buffer");
+	zassert_true(buf1->size >= 20 && buf1->size < 256,
+		     "Not from the small class");
+
+	buf2 = net_buf_alloc_len(&slab_pool, 200, K_NO_WAIT);
+	zassert_not_null(buf2, "Failed to get buffer");
+	zassert_true(buf2->size >= 256, "Not from the large class");
+
+	buf3 = net_buf_clone(buf2, K_NO_WAIT);
+	zassert_not_null(buf3, "Failed to clone buffer");
+	zassert_equal(buf3->data, buf2->data, "Cloned data doesn't match");
+
+	buf4 = net_buf_alloc_len(&slab_pool, 20, K_NO_WAIT);
+	zassert_not_null(buf4, "Failed to get buffer");
+	zassert_true(buf4->size < 256, "Not from the small class");
+
+	/* The small class is used up, so the large one is taken */
+	buf5 = net_buf_alloc_len(&slab_pool, 20, K_NO_WAIT);
+	zassert_not_null(buf5, "Failed to get buffer");
+	zassert_true(buf5->size >= 256, "Not from the large class");
+
+	zassert_is_null(net_buf_alloc_len(&slab_pool, 20, K_NO_WAIT),
+			"Got buffer with all classes used up");
+	zassert_is_null(net_buf_alloc_len(&slab_pool, 300, K_NO_WAIT),
+			"Got buffer larger than the largest class");
+
+	net_buf_unref(buf1);
+	net_buf_unref(buf2);
+	net_buf_unref(buf3);
+	net_buf_unref(buf4);
+	net_buf_unref(buf5);
+
+	zassert_equal(destroy_called, 5, "Incorrect destroy callback count");
+}
+
 static void net_buf_test_byte_order(void)
 {
 	struct net_buf *buf;
@@ -585,6 +641,7 @@ void test_main(void)
 			 ztest_unit_test(net_buf_test_clone),
 			 ztest_unit_test(net_buf_test_fixed_pool),
 			 ztest_unit_test(net_buf_test_var_pool),
+			 ztest_unit_test(net_buf_test_slab_pool),
 			 ztest_unit_test(net_buf_test_byte_order)
 			 );
 
@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_CAPTURE_LOG_LEVEL);
+
+#include <ztest.h>
+#include <string.h>
+
+#include <net/net_if.h>
+#include <net/net_pkt.h>
+#include <net/dummy.h>
+#include <net/capture.h>
+
+#include "net_private.h"
+
+#define PCAPNG_SHB		0x0A0D0D0AU
+#define PCAPNG_IDB		0x00000001U
+#define PCAPNG_EPB		0x00000006U
+#define PCAPNG_BYTE_ORDER	0x1A2B3C4DU
+
+#define SNAPLEN 64
+
+/* Lengths not multiple of 4 so that the data is padded */
+#define RX_LEN 61
+#define RX_LONG_LEN 101
+#define TX_LEN 30
+
+static struct net_if *iface;
+static u8_t output[1024];
+static size_t output_len;
+
+static void test_iface_init(struct net_if *iface)
+{
+	static u8_t mac[] = { 0x00, 0x00, 0x5e, 0x00, 0x53, 0x01 };
+
+	net_if_set_link_addr(iface, mac, sizeof(mac), NET_LINK_DUMMY);
+}
+
+static int test_send(struct device *dev, struct net_pkt *pkt)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(pkt);
+
+	return 0;
+}
+
+static struct dummy_api test_api = {
+	.iface_api.init = test_iface_init,
+	.send = test_send,
+};
+
+static int test_dev_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return 0;
+}
+
+NET_DEVICE_INIT(capture_test, "capture_test", test_dev_init,
+		device_pm_control_nop, NULL, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &test_api,
+		DUMMY_L2, NET_L2_GET_CTX_TYPE(DUMMY_L2), 1500);
+
+static void test_output(const u8_t *data, size_t len, void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	zassert_true(output_len + len <= sizeof(output), "output too long");
+
+	memcpy(output + output_len, data, len);
+	output_len += len;
+}
+
+static struct net_pkt *test_pkt(size_t len, sa_family_t family, bool tx)
+{
+	struct net_pkt *pkt;
+	u8_t data[RX_LONG_LEN];
+	int i;
+
+	for (i = 0; i < len; i++) {
+		data[i] = i;
+	}
+
+	if (tx) {
+		pkt = net_pkt_alloc_with_buffer(iface, len, family, 0,
+						K_NO_WAIT);
+	} else {
+		pkt = net_pkt_rx_alloc_with_buffer(iface, len, family, 0,
+						   K_NO_WAIT);
+	}
+
+	zassert_not_null(pkt, "cannot allocate packet");
+	zassert_equal(net_pkt_write(pkt, data, len), 0, "cannot write");
+
+	return pkt;
+}
+
+static u32_t word(size_t offset)
+{
+	u32_t value;
+
+	memcpy(&value, output + offset, sizeof(value));
+
+	return value;
+}
+
+static u16_t half(size_t offset)
+{
+	u16_t value;
+
+	memcpy(&value, output + offset, sizeof(value));
+
+	return value;
+}
+
+/* Check an enhanced packet block, returns its length */
+static size_t check_epb(size_t offset, u32_t ifid, size_t len, bool tx)
+{
+	size_t caplen = MIN(len, SNAPLEN);
+	size_t block_len = 7 * sizeof(u32_t) + ROUND_UP(caplen, 4) +
+		4 * sizeof(u32_t);
+	size_t opt = offset + 7 * sizeof(u32_t) + ROUND_UP(caplen, 4);
+	int i;
+
+	zassert_equal(word(offset), PCAPNG_EPB, "not an EPB");
+	zassert_equal(word(offset + 4), block_len, "wrong block length");
+	zassert_equal(word(offset + 8), ifid, "wrong interface");
+	zassert_equal(word(offset + 20), caplen, "wrong captured length");
+	zassert_equal(word(offset + 24), len, "wrong original length");
+
+	for (i = 0; i < caplen; i++) {
+		zassert_equal(output[offset + 28 + i], i, "wrong data");
+	}
+
+	for (; i < ROUND_UP(caplen, 4); i++) {
+		zassert_equal(output[offset + 28 + i], 0, "wrong padding");
+	}
+
+	/* Flags option, then end of options */
+	zassert_equal(half(opt), 2, "no flags option");
+	zassert_equal(half(opt + 2), sizeof(u32_t), "wrong flags length");
+	zassert_equal(word(opt + 4), tx ? 2 : 1, "wrong direction");
+	zassert_equal(word(opt + 8), 0, "no end of options");
+
+	/* Both length fields match */
+	zassert_equal(word(offset + block_len - 4), block_len,
+		      "wrong trailing block length");
+
+	return block_len;
+}
+
+static void test_capture_blocks(void)
+{
+	struct net_capture_cfg cfg = {
+		.output = test_output,
+		.snaplen = SNAPLEN,
+	};
+	struct net_capture_stats stats;
+	struct net_pkt *reassembled;
+	struct net_pkt *pkts[3];
+	u32_t ifid;
+	size_t offset;
+	int ifaces = 0;
+	int i;
+
+	iface = net_if_get_first_by_type(&NET_L2_GET_NAME(DUMMY));
+	zassert_not_null(iface, "no interface");
+
+	while (net_if_get_by_index(ifaces + 1)) {
+		ifaces++;
+	}
+
+	ifid = (net_if_get_by_iface(iface) - 1) * 2;
+
+	pkts[0] = test_pkt(RX_LEN, AF_UNSPEC, false);
+	pkts[1] = test_pkt(RX_LONG_LEN, AF_UNSPEC, false);
+	pkts[2] = test_pkt(TX_LEN, AF_INET, true);
+
+	reassembled = test_pkt(RX_LEN, AF_INET, false);
+	net_pkt_set_ip_reassembled(reassembled, true);
+
+	zassert_equal(net_capture_start(&cfg), 0, "cannot start capture");
+
+	net_capture_rx(iface, pkts[0]);
+	net_capture_rx(iface, pkts[1]);
+	net_capture_tx(iface, pkts[2]);
+
+	/* Its fragments were captured already, and it has no L2 header */
+	net_capture_rx(iface, reassembled);
+
+	zassert_equal(net_capture_stop(), 0, "cannot stop capture");
+
+	net_capture_get_stats(&stats);
+	zassert_equal(stats.captured, 3, "wrong number of packets");
+	zassert_equal(stats.dropped, 0, "packets dropped");
+
+	/* Section header */
+	zassert_equal(word(0), PCAPNG_SHB, "not a SHB");
+	zassert_equal(word(4), 28, "wrong SHB length");
+	zassert_equal(word(8), PCAPNG_BYTE_ORDER, "wrong byte order");
+	zassert_equal(word(24), 28, "wrong trailing SHB length");
+	offset = 28;
+
+	/* Interface descriptions, received frames then sent packets */
+	for (i = 0; i < 2 * ifaces; i++) {
+		zassert_equal(word(offset), PCAPNG_IDB, "not an IDB");
+		zassert_equal(word(offset + 4), 20, "wrong IDB length");
+		zassert_equal(word(offset + 12), SNAPLEN, "wrong snap length");
+		zassert_equal(word(offset + 16), 20,
+			      "wrong trailing IDB length");
+		offset += 20;
+	}
+
+	offset += check_epb(offset, ifid, RX_LEN, false);
+	offset += check_epb(offset, ifid, RX_LONG_LEN, false);
+	offset += check_epb(offset, ifid + 1, TX_LEN, true);
+
+	zassert_equal(offset, output_len, "trailing data");
+
+	for (i = 0; i < ARRAY_SIZE(pkts); i++) {
+		net_pkt_unref(pkts[i]);
+	}
+
+	net_pkt_unref(reassembled);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(net_capture,
+			 ztest_unit_test(test_capture_blocks));
+
+	ztest_run_test_suite(net_capture);
+}
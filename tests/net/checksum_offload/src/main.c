@@ -51,6 +51,10 @@ static struct in6_addr my_addr1 = { { { 0x20, 0x01, 0x0d, 0xb8, 1, 0, 0, 0,
 static struct in6_addr my_addr2 = { { { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0,
 					0, 0, 0, 0, 0, 0, 0, 0x1 } } };
 
+/* Interface 3 addresses */
+static struct in6_addr my_addr3 = { { { 0x20, 0x01, 0x0d, 0xb8, 2, 0, 0, 0,
+					0, 0, 0, 0, 0, 0, 0, 0x1 } } };
+
 /* Destination address for test packets */
 static struct in6_addr dst_addr = { { { 0x20, 0x01, 0x0d, 0xb8, 9, 0, 0, 0,
 					0, 0, 0, 0, 0, 0, 0, 0x1 } } };
@@ -63,17 +67,20 @@ static struct in6_addr ll_addr = { { { 0xfe, 0x80, 0x43, 0xb8, 0, 0, 0, 0,
 static struct in_addr in4addr_my = { { { 192, 0, 2, 1 } } };
 static struct in_addr in4addr_dst = { { { 192, 168, 1, 1 } } };
 static struct in_addr in4addr_my2 = { { { 192, 0, 42, 1 } } };
+static struct in_addr in4addr_my3 = { { { 192, 0, 43, 1 } } };
 
 /* Keep track of all ethernet interfaces. For native_posix board, we need
  * to increase the count as it has one extra network interface defined in
  * eth_native_posix driver.
  */
-static struct net_if *eth_interfaces[2 + IS_ENABLED(CONFIG_ETH_NATIVE_POSIX)];
+static struct net_if *eth_interfaces[3 + IS_ENABLED(CONFIG_ETH_NATIVE_POSIX)];
 
 static struct net_context *udp_v6_ctx_1;
 static struct net_context *udp_v6_ctx_2;
 static struct net_context *udp_v4_ctx_1;
 static struct net_context *udp_v4_ctx_2;
+static struct net_context *udp_v6_ctx_3;
+static struct net_context *udp_v4_ctx_3;
 
 static bool test_failed;
 static bool test_started;
@@ -92,6 +99,10 @@ struct eth_context {
 
 static struct eth_context eth_context_offloading_disabled;
 static struct eth_context eth_context_offloading_enabled;
+static struct eth_context eth_context_offloading_partial;
+
+/* Frame sent by the device with partial checksum offloading */
+static u8_t frame[sizeof(struct net_eth_hdr) + NET_ETH_MTU];
 
 static void eth_iface_init(struct net_if *iface)
 {
@@ -242,6 +253,139 @@ static int eth_tx_offloading_enabled(struct device *dev, struct net_pkt *pkt)
 	return 0;
 }
 
+/* Sum the frame from the checksum start to the end, with the pseudo header
+ * sum in the checksum field, and store the result as the device would.
+ */
+static u16_t finish_chksum(size_t len, u16_t start, u16_t offset)
+{
+	u32_t sum = 0U;
+	u16_t chksum;
+	size_t i;
+
+	for (i = start; i < len; i += 2) {
+		sum += frame[i] << 8;
+
+		if (i + 1 < len) {
+			sum += frame[i + 1];
+		}
+	}
+
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	/* A zero UDP checksum means no checksum, it is sent as all ones */
+	chksum = ~sum & 0xffff;
+	chksum = chksum == 0U ? 0xffff : htons(chksum);
+
+	UNALIGNED_PUT(chksum, (u16_t *)&frame[offset]);
+
+	return chksum;
+}
+
+/* Calculate the checksum of the frame fully in software */
+static u16_t calc_udp_chksum(struct net_pkt *pkt, size_t len, u16_t offset)
+{
+	size_t hdr_len = sizeof(struct net_eth_hdr);
+	struct net_pkt *ref;
+	u16_t chksum;
+
+	ref = net_pkt_alloc_with_buffer(net_pkt_iface(pkt), len - hdr_len,
+					net_pkt_family(pkt), IPPROTO_UDP,
+					K_NO_WAIT);
+	zassert_not_null(ref, "Cannot allocate packet");
+
+	zassert_equal(net_pkt_write(ref, &frame[hdr_len], len - hdr_len), 0,
+		      "Cannot copy frame");
+
+	net_pkt_set_ip_hdr_len(ref, net_pkt_ip_hdr_len(pkt));
+
+	if (net_pkt_family(pkt) == AF_INET6) {
+		net_pkt_set_ipv6_ext_len(ref, net_pkt_ipv6_ext_len(pkt));
+	} else {
+		net_pkt_set_ipv4_opts_len(ref, net_pkt_ipv4_opts_len(pkt));
+	}
+
+	/* The checksum is calculated over a zero checksum field */
+	net_pkt_cursor_init(ref);
+	net_pkt_set_overwrite(ref, true);
+	zassert_equal(net_pkt_skip(ref, offset - hdr_len), 0, "Cannot skip");
+	zassert_equal(net_pkt_write_be16(ref, 0), 0, "Cannot clear checksum");
+
+	chksum = net_calc_chksum_udp(ref);
+
+	net_pkt_unref(ref);
+
+	return chksum;
+}
+
+static bool frame_is_udp(void)
+{
+	struct net_eth_hdr *hdr = (struct net_eth_hdr *)frame;
+	u8_t *ip_hdr = &frame[sizeof(struct net_eth_hdr)];
+
+	if (hdr->type == htons(NET_ETH_PTYPE_IPV6)) {
+		return ((struct net_ipv6_hdr *)ip_hdr)->nexthdr == IPPROTO_UDP;
+	}
+
+	return hdr->type == htons(NET_ETH_PTYPE_IP) &&
+		((struct net_ipv4_hdr *)ip_hdr)->proto == IPPROTO_UDP;
+}
+
+static int eth_tx_offloading_partial(struct device *dev, struct net_pkt *pkt)
+{
+	struct eth_context *context = dev->driver_data;
+	struct net_pkt_cursor backup;
+	u16_t start, offset;
+	u16_t chksum;
+	size_t len;
+
+	zassert_equal_ptr(&eth_context_offloading_partial, context,
+			  "Context pointers do not match (%p vs %p)",
+			  eth_context_offloading_partial, context);
+
+	if (!pkt->buffer) {
+		DBG("No data to send!\n");
+		return -ENODATA;
+	}
+
+	len = net_pkt_get_len(pkt);
+	zassert_true(len <= sizeof(frame), "Packet too long");
+
+	net_pkt_cursor_backup(pkt, &backup);
+	net_pkt_cursor_init(pkt);
+	zassert_equal(net_pkt_read(pkt, frame, len), 0, "Cannot read packet");
+	net_pkt_cursor_restore(pkt, &backup);
+
+	if (!test_started || !frame_is_udp()) {
+		return 0;
+	}
+
+	zassert_true(net_pkt_is_chksum_partial(pkt), "Checksum not partial");
+
+	start = net_eth_chksum_start(pkt);
+	offset = start + net_pkt_chksum_offset(pkt);
+
+	zassert_equal(start, sizeof(struct net_eth_hdr) +
+		      net_pkt_ip_hdr_len(pkt) + net_pkt_ip_opts_len(pkt),
+		      "Wrong checksum start %u", start);
+	zassert_equal(offset, start + offsetof(struct net_udp_hdr, chksum),
+		      "Wrong checksum offset %u", offset);
+	zassert_not_equal(UNALIGNED_GET((u16_t *)&frame[offset]), 0,
+			  "No pseudo header sum");
+
+	chksum = finish_chksum(len, start, offset);
+
+	DBG("Chksum 0x%x offloading partial\n", chksum);
+
+	zassert_equal(chksum, calc_udp_chksum(pkt, len, offset),
+		      "Checksum 0x%04x does not match", ntohs(chksum));
+
+	k_sem_give(&wait_data);
+
+	return 0;
+}
+
 static enum ethernet_hw_caps eth_offloading_enabled(struct device *dev)
 {
 	return ETHERNET_HW_TX_CHKSUM_OFFLOAD |
@@ -253,6 +397,11 @@ static enum ethernet_hw_caps eth_offloading_disabled(struct device *dev)
 	return 0;
 }
 
+static enum ethernet_hw_caps eth_offloading_partial(struct device *dev)
+{
+	return ETHERNET_HW_TX_CHKSUM_PARTIAL;
+}
+
 static struct ethernet_api api_funcs_offloading_disabled = {
 	.iface_api.init = eth_iface_init,
 
@@ -267,6 +416,13 @@ static struct ethernet_api api_funcs_offloading_enabled = {
 	.send = eth_tx_offloading_enabled,
 };
 
+static struct ethernet_api api_funcs_offloading_partial = {
+	.iface_api.init = eth_iface_init,
+
+	.get_capabilities = eth_offloading_partial,
+	.send = eth_tx_offloading_partial,
+};
+
 static void generate_mac(u8_t *mac_addr)
 {
 	/* 00-00-5E-00-53-xx Documentation RFC 7042 */
@@ -303,6 +459,14 @@ ETH_NET_DEVICE_INIT(eth_offloading_enabled_test,
 		    &api_funcs_offloading_enabled,
 		    NET_ETH_MTU);
 
+ETH_NET_DEVICE_INIT(eth_offloading_partial_test,
+		    "eth_offloading_partial_test",
+		    eth_init, device_pm_control_nop,
+		    &eth_context_offloading_partial, NULL,
+		    CONFIG_ETH_INIT_PRIORITY,
+		    &api_funcs_offloading_partial,
+		    NET_ETH_MTU);
+
 struct user_data {
 	int eth_if_count;
 	int total_if_count;
@@ -348,6 +512,11 @@ static void iface_cb(struct net_if *iface, void *user_data)
 			eth_interfaces[1] = iface;
 		}
 
+		if (eth_ctx == &eth_context_offloading_partial) {
+			DBG("Iface %p with partial offloading\n", iface);
+			eth_interfaces[2] = iface;
+		}
+
 		ud->eth_if_count++;
 	}
 
@@ -373,13 +542,15 @@ static void eth_setup(void)
 static void address_setup(void)
 {
 	struct net_if_addr *ifaddr;
-	struct net_if *iface1, *iface2;
+	struct net_if *iface1, *iface2, *iface3;
 
 	iface1 = eth_interfaces[0];
 	iface2 = eth_interfaces[1];
+	iface3 = eth_interfaces[2];
 
 	zassert_not_null(iface1, "Interface 1");
 	zassert_not_null(iface2, "Interface 2");
+	zassert_not_null(iface3, "Interface 3");
 
 	ifaddr = net_if_ipv6_addr_add(iface1, &my_addr1,
 				      NET_ADDR_MANUAL, 0);
@@ -420,8 +591,23 @@ static void address_setup(void)
 				      NET_ADDR_MANUAL, 0);
 	zassert_not_null(ifaddr, "Cannot add IPv4 address");
 
+	ifaddr = net_if_ipv6_addr_add(iface3, &my_addr3,
+				      NET_ADDR_MANUAL, 0);
+	if (!ifaddr) {
+		DBG("Cannot add IPv6 address %s\n",
+		       net_sprint_ipv6_addr(&my_addr3));
+		zassert_not_null(ifaddr, "addr3");
+	}
+
+	ifaddr->addr_state = NET_ADDR_PREFERRED;
+
+	ifaddr = net_if_ipv4_addr_add(iface3, &in4addr_my3,
+				      NET_ADDR_MANUAL, 0);
+	zassert_not_null(ifaddr, "Cannot add IPv4 address");
+
 	net_if_up(iface1);
 	net_if_up(iface2);
+	net_if_up(iface3);
 
 	/* The interface might receive data which might fail the checks
 	 * in the iface sending function, so we need to reset the failure
@@ -662,6 +848,105 @@ static void tx_chksum_offload_enabled_test_v4(void)
 	net_context_unref(udp_v4_ctx_2);
 }
 
+static void tx_chksum_offload_partial_test_v6(void)
+{
+	struct eth_context *ctx; /* This is interface context */
+	struct net_if *iface;
+	int ret, len;
+	struct sockaddr_in6 dst_addr6 = {
+		.sin6_family = AF_INET6,
+		.sin6_port = htons(PORT),
+	};
+	struct sockaddr_in6 src_addr6 = {
+		.sin6_family = AF_INET6,
+		.sin6_port = 0,
+	};
+
+	ret = net_context_get(AF_INET6, SOCK_DGRAM, IPPROTO_UDP,
+			      &udp_v6_ctx_3);
+	zassert_equal(ret, 0, "Create IPv6 UDP context failed");
+
+	memcpy(&src_addr6.sin6_addr, &my_addr3, sizeof(struct in6_addr));
+	memcpy(&dst_addr6.sin6_addr, &dst_addr, sizeof(struct in6_addr));
+
+	ret = net_context_bind(udp_v6_ctx_3, (struct sockaddr *)&src_addr6,
+			       sizeof(struct sockaddr_in6));
+	zassert_equal(ret, 0, "Context bind failure test failed");
+
+	iface = eth_interfaces[2];
+	ctx = net_if_get_device(iface)->driver_data;
+	zassert_equal_ptr(&eth_context_offloading_partial, ctx,
+			  "eth context mismatch");
+
+	len = strlen(test_data);
+
+	test_started = true;
+
+	ret = add_neighbor(iface, &dst_addr);
+	zassert_true(ret, "Cannot add neighbor");
+
+	ret = net_context_sendto(udp_v6_ctx_3, test_data, len,
+				 (struct sockaddr *)&dst_addr6,
+				 sizeof(struct sockaddr_in6),
+				 NULL, K_FOREVER, NULL);
+	zassert_equal(ret, len, "Send UDP pkt failed (%d)\n", ret);
+
+	if (k_sem_take(&wait_data, WAIT_TIME)) {
+		DBG("Timeout while waiting interface data\n");
+		zassert_false(true, "Timeout");
+	}
+
+	net_context_unref(udp_v6_ctx_3);
+}
+
+static void tx_chksum_offload_partial_test_v4(void)
+{
+	struct eth_context *ctx; /* This is interface context */
+	struct net_if *iface;
+	int ret, len;
+	struct sockaddr_in dst_addr4 = {
+		.sin_family = AF_INET,
+		.sin_port = htons(PORT),
+	};
+	struct sockaddr_in src_addr4 = {
+		.sin_family = AF_INET,
+		.sin_port = 0,
+	};
+
+	ret = net_context_get(AF_INET, SOCK_DGRAM, IPPROTO_UDP,
+			      &udp_v4_ctx_3);
+	zassert_equal(ret, 0, "Create IPv4 UDP context failed");
+
+	memcpy(&src_addr4.sin_addr, &in4addr_my3, sizeof(struct in_addr));
+	memcpy(&dst_addr4.sin_addr, &in4addr_dst, sizeof(struct in_addr));
+
+	ret = net_context_bind(udp_v4_ctx_3, (struct sockaddr *)&src_addr4,
+			       sizeof(struct sockaddr_in));
+	zassert_equal(ret, 0, "Context bind failure test failed");
+
+	iface = eth_interfaces[2];
+	ctx = net_if_get_device(iface)->driver_data;
+	zassert_equal_ptr(&eth_context_offloading_partial, ctx,
+			  "eth context mismatch");
+
+	len = strlen(test_data);
+
+	test_started = true;
+
+	ret = net_context_sendto(udp_v4_ctx_3, test_data, len,
+				 (struct sockaddr *)&dst_addr4,
+				 sizeof(struct sockaddr_in),
+				 NULL, K_FOREVER, NULL);
+	zassert_equal(ret, len, "Send UDP pkt failed (%d)\n", ret);
+
+	if (k_sem_take(&wait_data, WAIT_TIME)) {
+		DBG("Timeout while waiting interface data\n");
+		zassert_false(true, "Timeout");
+	}
+
+	net_context_unref(udp_v4_ctx_3);
+}
+
 static void recv_cb_offload_disabled(struct net_context *context,
 				     struct net_pkt *pkt,
 				     union net_ip_header *ip_hdr,
@@ -934,6 +1219,8 @@ void test_main(void)
 			 ztest_unit_test(tx_chksum_offload_disabled_test_v4),
 			 ztest_unit_test(tx_chksum_offload_enabled_test_v6),
 			 ztest_unit_test(tx_chksum_offload_enabled_test_v4),
+			 ztest_unit_test(tx_chksum_offload_partial_test_v6),
+			 ztest_unit_test(tx_chksum_offload_partial_test_v4),
 			 ztest_unit_test(rx_chksum_offload_disabled_test_v6),
 			 ztest_unit_test(rx_chksum_offload_disabled_test_v4),
 			 ztest_unit_test(rx_chksum_offload_enabled_test_v6),
@@ -0,0 +1,374 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_TCP_LOG_LEVEL);
+
+#include <zephyr.h>
+#include <ztest.h>
+
+#include <net/net_core.h>
+#include <net/net_pkt.h>
+#include <net/net_ip.h>
+#include <net/net_if.h>
+#include <net/dummy.h>
+
+#include "net_private.h"
+#include "connection.h"
+#include "tcp_internal.h"
+#include "ipv4.h"
+
+#define MY_PORT 4242
+#define PEER_PORT 9876
+#define SEG_LEN 100
+#define MAX_RECORDS 8
+#define WAIT_TIME K_MSEC(100)
+
+static struct in_addr my_addr = { { { 192, 0, 2, 1 } } };
+static struct in_addr peer_addr = { { { 192, 0, 2, 2 } } };
+
+static struct net_if *iface;
+static struct net_conn_handle *handle;
+
+struct record {
+	u16_t port;
+	u32_t seq;
+	u32_t len;
+	u8_t flags;
+	bool data_ok;
+};
+
+static struct record records[MAX_RECORDS];
+static int record_count;
+static K_SEM_DEFINE(recv_sem, 0, MAX_RECORDS);
+
+static void gro_iface_init(struct net_if *iface)
+{
+	static u8_t mac[] = { 0x00, 0x00, 0x5e, 0x00, 0x53, 0x01 };
+
+	net_if_set_link_addr(iface, mac, sizeof(mac), NET_LINK_DUMMY);
+}
+
+static int gro_send(struct device *dev, struct net_pkt *pkt)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(pkt);
+
+	return 0;
+}
+
+static struct dummy_api gro_api = {
+	.iface_api.init = gro_iface_init,
+	.send = gro_send,
+};
+
+static int gro_dev_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return 0;
+}
+
+NET_DEVICE_INIT(gro_test, "gro_test", gro_dev_init, device_pm_control_nop,
+		NULL, NULL, CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &gro_api,
+		DUMMY_L2, NET_L2_GET_CTX_TYPE(DUMMY_L2), 1500);
+
+static enum net_verdict tcp_cb(struct net_conn *conn, struct net_pkt *pkt,
+			       union net_ip_header *ip_hdr,
+			       union net_proto_header *proto_hdr,
+			       void *user_data)
+{
+	struct record *rec = &records[record_count];
+	u32_t i;
+	u8_t c;
+
+	zassert_true(record_count < MAX_RECORDS, "too many packets");
+
+	rec->port = ntohs(proto_hdr->tcp->src_port);
+	rec->seq = sys_get_be32(proto_hdr->tcp->seq);
+	rec->flags = proto_hdr->tcp->flags;
+	rec->len = ntohs(ip_hdr->ipv4->len) - sizeof(struct net_ipv4_hdr) -
+		NET_TCP_HDR_LEN(proto_hdr->tcp);
+	rec->data_ok = true;
+
+	/* The cursor is right after the TCP header */
+	for (i = 0U; i < rec->len; i++) {
+		if (net_pkt_read_u8(pkt, &c) || c != (u8_t)(rec->seq + i)) {
+			rec->data_ok = false;
+			break;
+		}
+	}
+
+	record_count++;
+	net_pkt_unref(pkt);
+
+	k_sem_give(&recv_sem);
+
+	return NET_OK;
+}
+
+static struct net_pkt *build_seg(u16_t port, u32_t seq, u8_t flags)
+{
+	struct net_tcp_hdr tcp_hdr = { 0 };
+	struct net_pkt *pkt;
+	u32_t i;
+
+	pkt = net_pkt_alloc_with_buffer(iface, sizeof(tcp_hdr) + SEG_LEN,
+					AF_INET, IPPROTO_TCP, K_FOREVER);
+	zassert_not_null(pkt, "cannot allocate pkt");
+
+	zassert_equal(net_ipv4_create(pkt, &peer_addr, &my_addr), 0,
+		      "cannot create IPv4 header");
+
+	tcp_hdr.src_port = htons(port);
+	tcp_hdr.dst_port = htons(MY_PORT);
+	sys_put_be32(seq, tcp_hdr.seq);
+	sys_put_be32(1, tcp_hdr.ack);
+	tcp_hdr.offset = (sizeof(tcp_hdr) / 4U) << 4;
+	tcp_hdr.flags = flags;
+	sys_put_be16(1000, tcp_hdr.wnd);
+
+	net_pkt_write(pkt, &tcp_hdr, sizeof(tcp_hdr));
+
+	for (i = 0U; i < SEG_LEN; i++) {
+		net_pkt_write_u8(pkt, (u8_t)(seq + i));
+	}
+
+	net_pkt_cursor_init(pkt);
+	net_ipv4_finalize(pkt, IPPROTO_TCP);
+	net_pkt_cursor_init(pkt);
+
+	return pkt;
+}
+
+/* Inject all the segments before the RX thread gets to run, as they would
+ * be received in one burst from the device.
+ */
+static void inject(const u16_t *ports, const u32_t *seqs, const u8_t *flags,
+		   int count)
+{
+	int i;
+
+	(void)memset(records, 0, sizeof(records));
+	record_count = 0;
+	k_sem_reset(&recv_sem);
+
+	k_sched_lock();
+
+	for (i = 0; i < count; i++) {
+		zassert_equal(net_recv_data(iface,
+					    build_seg(ports[i], seqs[i],
+						      flags[i])),
+			      0, "cannot inject segment %d", i);
+	}
+
+	k_sched_unlock();
+}
+
+static void wait_records(int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		zassert_equal(k_sem_take(&recv_sem, WAIT_TIME), 0,
+			      "packet %d not received", i);
+	}
+
+	zassert_not_equal(k_sem_take(&recv_sem, WAIT_TIME), 0,
+			  "too many packets received");
+	zassert_equal(record_count, count, "wrong number of packets");
+
+	for (i = 0; i < count; i++) {
+		zassert_true(records[i].data_ok, "bad payload in packet %d", i);
+	}
+}
+
+static void test_gro_setup(void)
+{
+	struct sockaddr_in local = {
+		.sin_family = AF_INET,
+	};
+	int ret;
+
+	iface = net_if_get_first_by_type(&NET_L2_GET_NAME(DUMMY));
+	zassert_not_null(iface, "no dummy interface");
+
+	zassert_not_null(net_if_ipv4_addr_add(iface, &my_addr,
+					      NET_ADDR_MANUAL, 0),
+			 "cannot add IPv4 address");
+
+	net_ipaddr_copy(&local.sin_addr, &my_addr);
+
+	ret = net_conn_register(IPPROTO_TCP, AF_INET, NULL,
+				(struct sockaddr *)&local, 0, MY_PORT,
+				tcp_cb, NULL, &handle);
+	zassert_equal(ret, 0, "cannot register TCP handler (%d)", ret);
+}
+
+static void test_gro_merge(void)
+{
+	const u16_t ports[] = { PEER_PORT, PEER_PORT, PEER_PORT };
+	const u32_t seqs[] = { 1000, 1000 + SEG_LEN, 1000 + 2 * SEG_LEN };
+	const u8_t flags[] = { NET_TCP_ACK, NET_TCP_ACK, NET_TCP_ACK };
+
+	inject(ports, seqs, flags, ARRAY_SIZE(seqs));
+	wait_records(1);
+
+	zassert_equal(records[0].seq, 1000, "wrong sequence number");
+	zassert_equal(records[0].len, 3 * SEG_LEN, "segments not merged");
+}
+
+static void test_gro_push(void)
+{
+	const u16_t ports[] = { PEER_PORT, PEER_PORT, PEER_PORT };
+	const u32_t seqs[] = { 2000, 2000 + SEG_LEN, 2000 + 2 * SEG_LEN };
+	const u8_t flags[] = { NET_TCP_ACK, NET_TCP_ACK | NET_TCP_PSH,
+			       NET_TCP_ACK };
+
+	inject(ports, seqs, flags, ARRAY_SIZE(seqs));
+	wait_records(2);
+
+	zassert_equal(records[0].len, 2 * SEG_LEN, "segments not merged");
+	zassert_true(records[0].flags & NET_TCP_PSH, "PSH flag lost");
+	zassert_equal(records[1].seq, 2000 + 2 * SEG_LEN,
+		      "wrong sequence number");
+	zassert_equal(records[1].len, SEG_LEN, "wrong length");
+}
+
+static void test_gro_max_segments(void)
+{
+	const u16_t ports[] = { PEER_PORT, PEER_PORT, PEER_PORT, PEER_PORT,
+				PEER_PORT };
+	const u32_t seqs[] = { 3000, 3000 + SEG_LEN, 3000 + 2 * SEG_LEN,
+			       3000 + 3 * SEG_LEN, 3000 + 4 * SEG_LEN };
+	const u8_t flags[] = { NET_TCP_ACK, NET_TCP_ACK, NET_TCP_ACK,
+			       NET_TCP_ACK, NET_TCP_ACK };
+
+	inject(ports, seqs, flags, ARRAY_SIZE(seqs));
+	wait_records(2);
+
+	zassert_equal(records[0].len, CONFIG_NET_GRO_MAX_SEGMENTS * SEG_LEN,
+		      "wrong merged length");
+	zassert_equal(records[1].seq,
+		      3000 + CONFIG_NET_GRO_MAX_SEGMENTS * SEG_LEN,
+		      "wrong sequence number");
+}
+
+static void test_gro_out_of_order(void)
+{
+	const u16_t ports[] = { PEER_PORT, PEER_PORT };
+	const u32_t seqs[] = { 4000, 4000 + 2 * SEG_LEN };
+	const u8_t flags[] = { NET_TCP_ACK, NET_TCP_ACK };
+
+	inject(ports, seqs, flags, ARRAY_SIZE(seqs));
+	wait_records(2);
+
+	zassert_equal(records[0].seq, 4000, "segments reordered");
+	zassert_equal(records[0].len, SEG_LEN, "gap was merged");
+	zassert_equal(records[1].seq, 4000 + 2 * SEG_LEN,
+		      "segments reordered");
+}
+
+static void test_gro_flows(void)
+{
+	const u16_t ports[] = { PEER_PORT, PEER_PORT + 1, PEER_PORT,
+				PEER_PORT + 1 };
+	const u32_t seqs[] = { 5000, 6000, 5000 + SEG_LEN, 6000 + SEG_LEN };
+	const u8_t flags[] = { NET_TCP_ACK, NET_TCP_ACK, NET_TCP_ACK,
+			       NET_TCP_ACK };
+	int i;
+
+	inject(ports, seqs, flags, ARRAY_SIZE(seqs));
+	wait_records(2);
+
+	for (i = 0; i < 2; i++) {
+		zassert_equal(records[i].len, 2 * SEG_LEN,
+			      "flow %u not merged", records[i].port);
+		zassert_equal(records[i].seq,
+			      records[i].port == PEER_PORT ? 5000 : 6000,
+			      "wrong sequence number");
+	}
+}
+
+static void test_gro_not_mergeable(void)
+{
+	const u16_t ports[] = { PEER_PORT, PEER_PORT };
+	const u32_t seqs[] = { 7000, 7000 + SEG_LEN };
+	const u8_t flags[] = { NET_TCP_ACK, NET_TCP_ACK | NET_TCP_FIN };
+
+	inject(ports, seqs, flags, ARRAY_SIZE(seqs));
+	wait_records(2);
+
+	zassert_equal(records[0].seq, 7000, "segments reordered");
+	zassert_equal(records[0].len, SEG_LEN, "FIN segment was merged");
+	zassert_true(records[1].flags & NET_TCP_FIN, "FIN flag lost");
+}
+
+/* A segment with a bad checksum is neither merged nor delivered, the
+ * segments around it are delivered on their own.
+ */
+static void test_gro_bad_checksum(void)
+{
+	const u32_t seqs[] = { 8000, 8000 + SEG_LEN, 8000 + 2 * SEG_LEN };
+	struct net_pkt *pkts[ARRAY_SIZE(seqs)];
+	struct net_pkt_cursor backup;
+	u8_t c;
+	int i;
+
+	if (!IS_ENABLED(CONFIG_NET_TCP_CHECKSUM)) {
+		ztest_test_skip();
+	}
+
+	for (i = 0; i < ARRAY_SIZE(seqs); i++) {
+		pkts[i] = build_seg(PEER_PORT, seqs[i], NET_TCP_ACK);
+	}
+
+	/* Flip the first payload byte of the middle segment */
+	net_pkt_set_overwrite(pkts[1], true);
+	zassert_equal(net_pkt_skip(pkts[1], sizeof(struct net_ipv4_hdr) +
+				   sizeof(struct net_tcp_hdr)), 0,
+		      "cannot skip headers");
+	net_pkt_cursor_backup(pkts[1], &backup);
+	zassert_equal(net_pkt_read_u8(pkts[1], &c), 0, "cannot read payload");
+	net_pkt_cursor_restore(pkts[1], &backup);
+	zassert_equal(net_pkt_write_u8(pkts[1], ~c), 0, "cannot corrupt");
+	net_pkt_cursor_init(pkts[1]);
+
+	(void)memset(records, 0, sizeof(records));
+	record_count = 0;
+	k_sem_reset(&recv_sem);
+
+	k_sched_lock();
+
+	for (i = 0; i < ARRAY_SIZE(pkts); i++) {
+		zassert_equal(net_recv_data(iface, pkts[i]), 0,
+			      "cannot inject segment %d", i);
+	}
+
+	k_sched_unlock();
+
+	wait_records(2);
+
+	zassert_equal(records[0].seq, seqs[0], "wrong sequence number");
+	zassert_equal(records[0].len, SEG_LEN, "bad segment was merged");
+	zassert_equal(records[1].seq, seqs[2], "bad segment was delivered");
+	zassert_equal(records[1].len, SEG_LEN, "wrong length");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(net_gro_test,
+			 ztest_unit_test(test_gro_setup),
+			 ztest_unit_test(test_gro_merge),
+			 ztest_unit_test(test_gro_push),
+			 ztest_unit_test(test_gro_max_segments),
+			 ztest_unit_test(test_gro_out_of_order),
+			 ztest_unit_test(test_gro_flows),
+			 ztest_unit_test(test_gro_not_mergeable),
+			 ztest_unit_test(test_gro_bad_checksum));
+
+	ztest_run_test_suite(net_gro_test);
+}
@@ -0,0 +1,363 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_TCP_LOG_LEVEL);
+
+#include <zephyr.h>
+#include <ztest.h>
+
+#include <net/net_core.h>
+#include <net/net_pkt.h>
+#include <net/net_ip.h>
+#include <net/net_if.h>
+#include <net/net_context.h>
+#include <net/ethernet.h>
+
+#include "net_private.h"
+#include "tcp_internal.h"
+#include "ipv4.h"
+
+#define MY_PORT 4242
+#define PEER_PORT 9876
+#define MSS 1000
+#define MAX_RECORDS 4
+#define MAX_FRAME (sizeof(struct net_eth_hdr) + NET_IPV4TCPH_LEN + 3000)
+
+static struct in_addr my_addr = { { { 192, 0, 2, 1 } } };
+static struct in_addr peer_addr = { { { 192, 0, 2, 2 } } };
+
+struct eth_context {
+	u8_t mac_addr[6];
+	enum ethernet_hw_caps caps;
+};
+
+/* A segment seen by the driver */
+struct record {
+	u32_t seq;
+	u32_t len;
+	u8_t flags;
+	bool ip_chksum_ok;
+	bool tcp_chksum_ok;
+	bool data_ok;
+};
+
+static struct eth_context sw_context = {
+	.mac_addr = { 0x00, 0x00, 0x5e, 0x00, 0x53, 0x01 },
+};
+
+static struct eth_context tso_context = {
+	.mac_addr = { 0x00, 0x00, 0x5e, 0x00, 0x53, 0x02 },
+	.caps = ETHERNET_HW_TSO,
+};
+
+static struct net_if *sw_iface;
+static struct net_if *tso_iface;
+
+static struct record records[MAX_RECORDS];
+static int record_count;
+
+/* The driver fails to send the segment with this index */
+static int fail_at = -1;
+
+static u16_t sum16(const u8_t *data, size_t len, u32_t sum)
+{
+	size_t i;
+
+	for (i = 0; i + 1 < len; i += 2) {
+		sum += data[i] << 8 | data[i + 1];
+	}
+
+	if (len & 1) {
+		sum += data[len - 1] << 8;
+	}
+
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	return sum;
+}
+
+static void eth_iface_init(struct net_if *iface)
+{
+	struct eth_context *context = net_if_get_device(iface)->driver_data;
+
+	net_if_set_link_addr(iface, context->mac_addr,
+			     sizeof(context->mac_addr), NET_LINK_ETHERNET);
+
+	ethernet_init(iface);
+}
+
+static enum ethernet_hw_caps eth_capabilities(struct device *dev)
+{
+	struct eth_context *context = dev->driver_data;
+
+	return context->caps;
+}
+
+static int eth_send(struct device *dev, struct net_pkt *pkt)
+{
+	static u8_t frame[MAX_FRAME];
+	struct record *rec = &records[record_count];
+	size_t len = net_pkt_get_len(pkt);
+	size_t ip_hdr_len, tcp_hdr_len, ip_len;
+	u8_t *ip, *tcp;
+	u16_t sum;
+	u32_t i;
+
+	ARG_UNUSED(dev);
+
+	zassert_true(record_count < MAX_RECORDS, "too many segments");
+
+	if (record_count == fail_at) {
+		return -EIO;
+	}
+	zassert_true(len <= sizeof(frame), "frame too large");
+
+	net_pkt_cursor_init(pkt);
+	zassert_equal(net_pkt_read(pkt, frame, len), 0, "cannot read frame");
+	net_pkt_cursor_init(pkt);
+
+	ip = frame + sizeof(struct net_eth_hdr);
+	ip_hdr_len = (ip[0] & 0x0f) * 4U;
+	ip_len = sys_get_be16(ip + 2);
+	tcp = ip + ip_hdr_len;
+	tcp_hdr_len = (tcp[12] >> 4) * 4U;
+
+	zassert_equal(ip_len, len - sizeof(struct net_eth_hdr),
+		      "wrong IP length");
+
+	rec->seq = sys_get_be32(tcp + 4);
+	rec->flags = tcp[13];
+	rec->len = ip_len - ip_hdr_len - tcp_hdr_len;
+	rec->ip_chksum_ok = sum16(ip, ip_hdr_len, 0) == 0xffff;
+
+	/* Pseudo header, then the TCP header and the payload */
+	sum = sum16(ip + 12, 8, IPPROTO_TCP + ip_len - ip_hdr_len);
+	rec->tcp_chksum_ok = sum16(tcp, ip_len - ip_hdr_len, sum) == 0xffff;
+
+	rec->data_ok = true;
+	for (i = 0U; i < rec->len; i++) {
+		if (tcp[tcp_hdr_len + i] != (u8_t)(rec->seq + i)) {
+			rec->data_ok = false;
+			break;
+		}
+	}
+
+	record_count++;
+
+	return 0;
+}
+
+static const struct ethernet_api eth_api = {
+	.iface_api.init = eth_iface_init,
+	.get_capabilities = eth_capabilities,
+	.send = eth_send,
+};
+
+static int eth_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return 0;
+}
+
+ETH_NET_DEVICE_INIT(gso_sw_test, "gso_sw_test", eth_init,
+		    device_pm_control_nop, &sw_context, NULL,
+		    CONFIG_ETH_INIT_PRIORITY, &eth_api, NET_ETH_MTU);
+
+ETH_NET_DEVICE_INIT(gso_tso_test, "gso_tso_test", eth_init,
+		    device_pm_control_nop, &tso_context, NULL,
+		    CONFIG_ETH_INIT_PRIORITY, &eth_api, NET_ETH_MTU);
+
+/* Build a TCP packet as net_context does when GSO is used */
+static struct net_pkt *build_pkt(struct net_if *iface, u32_t seq,
+				 size_t len)
+{
+	struct net_tcp_hdr tcp_hdr = { 0 };
+	struct net_pkt *pkt;
+	u32_t i;
+
+	pkt = net_pkt_alloc_on_iface(iface, K_NO_WAIT);
+	zassert_not_null(pkt, "cannot allocate pkt");
+
+	net_pkt_set_family(pkt, AF_INET);
+	net_pkt_set_gso_size(pkt, MSS);
+
+	zassert_equal(net_pkt_alloc_buffer(pkt, sizeof(tcp_hdr) + len,
+					   IPPROTO_TCP, K_NO_WAIT), 0,
+		      "cannot allocate buffer");
+
+	zassert_equal(net_ipv4_create(pkt, &my_addr, &peer_addr), 0,
+		      "cannot create IPv4 header");
+
+	tcp_hdr.src_port = htons(MY_PORT);
+	tcp_hdr.dst_port = htons(PEER_PORT);
+	sys_put_be32(seq, tcp_hdr.seq);
+	sys_put_be32(1, tcp_hdr.ack);
+	tcp_hdr.offset = (sizeof(tcp_hdr) / 4U) << 4;
+	tcp_hdr.flags = NET_TCP_ACK | NET_TCP_PSH;
+	sys_put_be16(1000, tcp_hdr.wnd);
+
+	zassert_equal(net_pkt_write(pkt, &tcp_hdr, sizeof(tcp_hdr)), 0,
+		      "cannot write TCP header");
+
+	for (i = 0U; i < len; i++) {
+		zassert_equal(net_pkt_write_u8(pkt, (u8_t)(seq + i)), 0,
+			      "cannot write payload");
+	}
+
+	net_pkt_cursor_init(pkt);
+	net_ipv4_finalize(pkt, IPPROTO_TCP);
+	net_pkt_cursor_init(pkt);
+
+	return pkt;
+}
+
+static void send_pkt(struct net_if *iface, u32_t seq, size_t len)
+{
+	(void)memset(records, 0, sizeof(records));
+	record_count = 0;
+
+	zassert_true(net_gso_send(iface, build_pkt(iface, seq, len)) > 0,
+		     "send failed");
+}
+
+static void check_record(int i, u32_t seq, u32_t len, bool last)
+{
+	struct record *rec = &records[i];
+
+	zassert_equal(rec->seq, seq, "wrong sequence number in %d", i);
+	zassert_equal(rec->len, len, "wrong length in %d", i);
+	zassert_true(rec->ip_chksum_ok, "bad IPv4 checksum in %d", i);
+	zassert_true(rec->tcp_chksum_ok, "bad TCP checksum in %d", i);
+	zassert_true(rec->data_ok, "bad payload in %d", i);
+	zassert_true(rec->flags & NET_TCP_ACK, "ACK flag lost in %d", i);
+	zassert_equal(!!(rec->flags & NET_TCP_PSH), last,
+		      "PSH flag wrong in %d", i);
+}
+
+static void test_gso_setup(void)
+{
+	sw_iface = net_if_lookup_by_dev(device_get_binding("gso_sw_test"));
+	tso_iface = net_if_lookup_by_dev(device_get_binding("gso_tso_test"));
+
+	zassert_not_null(sw_iface, "no interface without TSO");
+	zassert_not_null(tso_iface, "no interface with TSO");
+
+	zassert_not_null(net_if_ipv4_addr_add(sw_iface, &my_addr,
+					      NET_ADDR_MANUAL, 0),
+			 "cannot add IPv4 address");
+}
+
+static void test_gso_split(void)
+{
+	send_pkt(sw_iface, 1000, 2 * MSS + MSS / 2);
+
+	zassert_equal(record_count, 3, "wrong number of segments");
+	check_record(0, 1000, MSS, false);
+	check_record(1, 1000 + MSS, MSS, false);
+	check_record(2, 1000 + 2 * MSS, MSS / 2, true);
+}
+
+static void test_gso_small(void)
+{
+	send_pkt(sw_iface, 5000, MSS);
+
+	zassert_equal(record_count, 1, "packet was split");
+	check_record(0, 5000, MSS, true);
+}
+
+static void test_gso_hw_tso(void)
+{
+	send_pkt(tso_iface, 7000, 2 * MSS + MSS / 2);
+
+	zassert_equal(record_count, 1, "packet split for a TSO device");
+	check_record(0, 7000, 2 * MSS + MSS / 2, true);
+}
+
+/* Segments sent before a failure are in flight, so they are reported as
+ * a short send and the packet is released as after a full send.
+ */
+static void test_gso_partial_failure(void)
+{
+	struct net_pkt *pkt;
+	int ret;
+
+	(void)memset(records, 0, sizeof(records));
+	record_count = 0;
+	fail_at = 1;
+
+	pkt = build_pkt(sw_iface, 9000, 2 * MSS + MSS / 2);
+	net_pkt_ref(pkt);
+
+	ret = net_gso_send(sw_iface, pkt);
+
+	fail_at = -1;
+
+	zassert_equal(ret, sizeof(struct net_eth_hdr) + NET_IPV4TCPH_LEN + MSS,
+		      "wrong number of bytes sent (%d)", ret);
+	zassert_equal(record_count, 1, "segments sent after the failure");
+	check_record(0, 9000, MSS, false);
+	zassert_equal(atomic_get(&pkt->atomic_ref), 1, "pkt not released");
+
+	net_pkt_unref(pkt);
+
+	/* Nothing sent, the error is returned and the packet is kept */
+	record_count = 0;
+	fail_at = 0;
+
+	pkt = build_pkt(sw_iface, 9000, 2 * MSS + MSS / 2);
+
+	ret = net_gso_send(sw_iface, pkt);
+
+	fail_at = -1;
+
+	zassert_equal(ret, -EIO, "error not returned (%d)", ret);
+	zassert_equal(record_count, 0, "segment sent");
+	zassert_equal(atomic_get(&pkt->atomic_ref), 1, "pkt released");
+
+	net_pkt_unref(pkt);
+}
+
+/* The segments are as large as the peer takes, within the interface MTU */
+static void test_gso_send_mss(void)
+{
+	struct net_context *context;
+	u16_t mtu_mss = NET_ETH_MTU - NET_IPV4TCPH_LEN;
+
+	zassert_equal(net_context_get(AF_INET, SOCK_STREAM, IPPROTO_TCP,
+				      &context), 0, "cannot get context");
+	net_context_set_iface(context, sw_iface);
+
+	context->tcp->send_mss = 536;
+	zassert_equal(net_tcp_get_send_mss(context->tcp), 536,
+		      "MSS of the peer not used");
+
+	context->tcp->send_mss = 9000;
+	zassert_equal(net_tcp_get_send_mss(context->tcp), mtu_mss,
+		      "MSS not bounded by the MTU");
+
+	context->tcp->send_mss = 0;
+	zassert_equal(net_tcp_get_send_mss(context->tcp), mtu_mss,
+		      "MSS of the interface not used");
+
+	net_context_put(context);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(net_gso_test,
+			 ztest_unit_test(test_gso_setup),
+			 ztest_unit_test(test_gso_split),
+			 ztest_unit_test(test_gso_small),
+			 ztest_unit_test(test_gso_hw_tso),
+			 ztest_unit_test(test_gso_partial_failure),
+			 ztest_unit_test(test_gso_send_mss));
+
+	ztest_run_test_suite(net_gso_test);
+}
@@ -0,0 +1,490 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_IPV4_LOG_LEVEL);
+
+#include <ztest.h>
+#include <string.h>
+
+#include <net/net_if.h>
+#include <net/net_pkt.h>
+#include <net/dummy.h>
+
+#include "net_private.h"
+#include "icmpv4.h"
+#include "ipv4.h"
+#include "route.h"
+
+/* 192.0.2.1/24 inside, 198.51.100.1/24 outside, and 203.0.113.0/24
+ * routed through 198.51.100.254.
+ */
+#define INSIDE_ADDR	0xc0000201
+#define INSIDE_HOST	0xc0000202
+#define OUTSIDE_ADDR	0xc6336401
+#define OUTSIDE_HOST	0xc6336407
+#define GATEWAY		0xc63364fe
+#define ROUTED_PREFIX	0xcb007100
+#define ROUTED_HOST	0xcb007101
+#define UNROUTED_HOST	0x64400001
+
+#define OUTSIDE_MTU 576
+
+#define UDP_OFF sizeof(struct net_ipv4_hdr)
+#define ICMP_OFF sizeof(struct net_ipv4_hdr)
+#define PAYLOAD_LEN 18
+#define MAX_PKT_LEN 800
+
+/* A fragment of 700 bytes of data at offset 1480, split in pieces of 552
+ * and 148 bytes on the outside iface.
+ */
+#define FRAG_ID 0x1234
+#define FRAG_OFFSET 1480
+#define FRAG_DATA_LEN 700
+#define FRAG_PIECE_LEN 552
+#define MAX_PIECES 2
+
+#define WAIT_TIME K_MSEC(200)
+
+static struct net_if *inside_iface;
+static struct net_if *outside_iface;
+
+/* The last packet sent, by either interface */
+static struct {
+	struct net_if *iface;
+	u8_t data[MAX_PKT_LEN];
+	size_t len;
+} sent;
+
+static K_SEM_DEFINE(sent_sem, 0, 1);
+
+/* The pieces of a fragment forwarded on a smaller MTU */
+static struct {
+	u8_t data[MAX_PKT_LEN];
+	size_t len;
+} pieces[MAX_PIECES];
+
+static int piece_count;
+static bool log_pieces;
+
+static K_SEM_DEFINE(piece_sem, 0, MAX_PIECES);
+
+static void test_iface_init(struct net_if *iface)
+{
+	static u8_t macs[2][6] = {
+		{ 0x00, 0x00, 0x5e, 0x00, 0x53, 0x01 },
+		{ 0x00, 0x00, 0x5e, 0x00, 0x53, 0x02 },
+	};
+	static int count;
+
+	net_if_set_link_addr(iface, macs[count], sizeof(macs[count]),
+			     NET_LINK_DUMMY);
+	count++;
+}
+
+static int test_send(struct device *dev, struct net_pkt *pkt)
+{
+	sent.iface = net_if_lookup_by_dev(dev);
+	sent.len = net_pkt_get_len(pkt);
+
+	zassert_true(sent.len <= sizeof(sent.data), "packet too long");
+
+	net_pkt_cursor_init(pkt);
+	zassert_equal(net_pkt_read(pkt, sent.data, sent.len), 0,
+		      "cannot read packet");
+
+	if (log_pieces && piece_count < MAX_PIECES) {
+		memcpy(pieces[piece_count].data, sent.data, sent.len);
+		pieces[piece_count].len = sent.len;
+		piece_count++;
+		k_sem_give(&piece_sem);
+	}
+
+	k_sem_give(&sent_sem);
+
+	return 0;
+}
+
+static struct dummy_api test_api = {
+	.iface_api.init = test_iface_init,
+	.send = test_send,
+};
+
+static int test_dev_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return 0;
+}
+
+NET_DEVICE_INIT_INSTANCE(forward_inside, "forward_inside", inside,
+			 test_dev_init, device_pm_control_nop, NULL, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &test_api,
+			 DUMMY_L2, NET_L2_GET_CTX_TYPE(DUMMY_L2), 1500);
+
+NET_DEVICE_INIT_INSTANCE(forward_outside, "forward_outside", outside,
+			 test_dev_init, device_pm_control_nop, NULL, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &test_api,
+			 DUMMY_L2, NET_L2_GET_CTX_TYPE(DUMMY_L2), OUTSIDE_MTU);
+
+/* Ones' complement sum of the data, folded to 16 bits */
+static u16_t sum16(const u8_t *data, size_t len, u32_t sum)
+{
+	size_t i;
+
+	for (i = 0; i + 1 < len; i += 2) {
+		sum += data[i] << 8 | data[i + 1];
+	}
+
+	if (len & 1) {
+		sum += data[len - 1] << 8;
+	}
+
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	return sum;
+}
+
+static size_t build_udp(u8_t *buf, u32_t src, u32_t dst, u8_t ttl,
+			bool df, size_t payload_len)
+{
+	struct net_ipv4_hdr *ip_hdr = (struct net_ipv4_hdr *)buf;
+	struct net_udp_hdr *udp_hdr = (struct net_udp_hdr *)(buf + UDP_OFF);
+	size_t len = UDP_OFF + sizeof(*udp_hdr) + payload_len;
+	size_t i;
+
+	memset(buf, 0, UDP_OFF + sizeof(*udp_hdr));
+
+	ip_hdr->vhl = 0x45;
+	ip_hdr->len = htons(len);
+	ip_hdr->offset = df ? htons(NET_IPV4_DF) : 0;
+	ip_hdr->ttl = ttl;
+	ip_hdr->proto = IPPROTO_UDP;
+	ip_hdr->src.s_addr = htonl(src);
+	ip_hdr->dst.s_addr = htonl(dst);
+	ip_hdr->chksum = htons(~sum16(buf, UDP_OFF, 0));
+
+	udp_hdr->src_port = htons(20000);
+	udp_hdr->dst_port = htons(5001);
+	udp_hdr->len = htons(sizeof(*udp_hdr) + payload_len);
+
+	for (i = UDP_OFF + sizeof(*udp_hdr); i < len; i++) {
+		buf[i] = i;
+	}
+
+	return len;
+}
+
+static enum net_verdict input(struct net_if *iface, const u8_t *data,
+			      size_t len)
+{
+	enum net_verdict verdict;
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_rx_alloc_with_buffer(iface, len, AF_INET, 0, K_NO_WAIT);
+	zassert_not_null(pkt, "cannot allocate packet");
+
+	zassert_equal(net_pkt_write(pkt, data, len), 0, "cannot write");
+	net_pkt_cursor_init(pkt);
+
+	verdict = net_ipv4_input(pkt);
+	if (verdict == NET_DROP) {
+		net_pkt_unref(pkt);
+	}
+
+	return verdict;
+}
+
+/* Check that a packet went out as it came in, with the TTL one less */
+static void check_forwarded(struct net_if *iface, const u8_t *orig,
+			    size_t len)
+{
+	const struct net_ipv4_hdr *orig_hdr = (struct net_ipv4_hdr *)orig;
+	struct net_ipv4_hdr *hdr = (struct net_ipv4_hdr *)sent.data;
+
+	zassert_equal(k_sem_take(&sent_sem, WAIT_TIME), 0,
+		      "packet not forwarded");
+	zassert_equal(sent.iface, iface, "forwarded to the wrong iface");
+	zassert_equal(sent.len, len, "wrong length");
+
+	zassert_equal(hdr->ttl, orig_hdr->ttl - 1, "TTL not decremented");
+	zassert_equal(sum16(sent.data, UDP_OFF, 0), 0xffff,
+		      "wrong header checksum");
+
+	zassert_mem_equal(sent.data, orig, offsetof(struct net_ipv4_hdr, ttl),
+			  "header changed");
+	zassert_equal(hdr->proto, orig_hdr->proto, "protocol changed");
+	zassert_mem_equal(sent.data + offsetof(struct net_ipv4_hdr, src),
+			  orig + offsetof(struct net_ipv4_hdr, src),
+			  len - offsetof(struct net_ipv4_hdr, src),
+			  "addresses or payload changed");
+}
+
+/* Check the ICMPv4 error returned to the inside host */
+static void check_icmp_error(const u8_t *orig, u8_t type, u8_t code)
+{
+	struct net_ipv4_hdr *hdr = (struct net_ipv4_hdr *)sent.data;
+	struct net_icmp_hdr *icmp_hdr =
+		(struct net_icmp_hdr *)(sent.data + ICMP_OFF);
+	size_t quoted = UDP_OFF + sizeof(struct net_udp_hdr);
+
+	zassert_equal(k_sem_take(&sent_sem, WAIT_TIME), 0, "no ICMPv4 error");
+	zassert_equal(sent.iface, inside_iface, "error sent to wrong iface");
+
+	zassert_equal(hdr->proto, IPPROTO_ICMP, "not an ICMPv4 packet");
+	zassert_equal(ntohl(hdr->src.s_addr), INSIDE_ADDR,
+		      "not from the address of the ingress iface");
+	zassert_equal(ntohl(hdr->dst.s_addr), INSIDE_HOST,
+		      "not to the sender");
+	zassert_equal(sum16(sent.data, UDP_OFF, 0), 0xffff,
+		      "wrong header checksum");
+
+	zassert_equal(icmp_hdr->type, type, "wrong type");
+	zassert_equal(icmp_hdr->code, code, "wrong code");
+	zassert_equal(sum16(sent.data + ICMP_OFF, sent.len - ICMP_OFF, 0),
+		      0xffff, "wrong ICMPv4 checksum");
+
+	/* The header of the packet, as it came in */
+	zassert_equal(sent.len, ICMP_OFF + sizeof(*icmp_hdr) +
+		      NET_ICMPV4_UNUSED_LEN + quoted, "wrong error length");
+	zassert_mem_equal(sent.data + ICMP_OFF + sizeof(*icmp_hdr) +
+			  NET_ICMPV4_UNUSED_LEN, orig, quoted,
+			  "wrong packet quoted");
+}
+
+static void add_addr(struct net_if *iface, u32_t addr)
+{
+	struct in_addr in_addr = { .s_addr = htonl(addr) };
+	struct in_addr netmask = { .s_addr = htonl(0xffffff00) };
+
+	zassert_not_null(net_if_ipv4_addr_add(iface, &in_addr,
+					      NET_ADDR_MANUAL, 0),
+			 "cannot add address");
+
+	net_if_ipv4_set_netmask(iface, &netmask);
+}
+
+static void test_setup(void)
+{
+	struct in_addr prefix = { .s_addr = htonl(ROUTED_PREFIX) };
+	struct in_addr gw = { .s_addr = htonl(GATEWAY) };
+
+	inside_iface = net_if_lookup_by_dev(device_get_binding(
+						    "forward_inside"));
+	outside_iface = net_if_lookup_by_dev(device_get_binding(
+						     "forward_outside"));
+	zassert_not_null(inside_iface, "no inside iface");
+	zassert_not_null(outside_iface, "no outside iface");
+
+	add_addr(inside_iface, INSIDE_ADDR);
+	add_addr(outside_iface, OUTSIDE_ADDR);
+
+	zassert_not_null(net_route_ipv4_add(outside_iface, &prefix, 24, &gw),
+			 "cannot add route");
+}
+
+static void test_forward_route(void)
+{
+	u8_t buf[MAX_PKT_LEN];
+	size_t len;
+
+	len = build_udp(buf, INSIDE_HOST, ROUTED_HOST, 64, false,
+			PAYLOAD_LEN);
+
+	zassert_equal(input(inside_iface, buf, len), NET_OK,
+		      "packet dropped");
+	check_forwarded(outside_iface, buf, len);
+}
+
+static void test_forward_onlink(void)
+{
+	u8_t buf[MAX_PKT_LEN];
+	size_t len;
+
+	/* Both ways between directly connected subnets */
+	len = build_udp(buf, INSIDE_HOST, OUTSIDE_HOST, 64, false,
+			PAYLOAD_LEN);
+
+	zassert_equal(input(inside_iface, buf, len), NET_OK,
+		      "packet dropped");
+	check_forwarded(outside_iface, buf, len);
+
+	len = build_udp(buf, OUTSIDE_HOST, INSIDE_HOST, 64, false,
+			PAYLOAD_LEN);
+
+	zassert_equal(input(outside_iface, buf, len), NET_OK,
+		      "packet dropped");
+	check_forwarded(inside_iface, buf, len);
+}
+
+static void test_ttl_chksum(void)
+{
+	static const u8_t ttls[] = { 2, 128, 255 };
+	u8_t buf[MAX_PKT_LEN];
+	size_t len;
+	int i;
+
+	/* The checksum is adjusted rather than computed again, and the
+	 * carry out of the TTL byte has to be folded back in.
+	 */
+	for (i = 0; i < ARRAY_SIZE(ttls); i++) {
+		len = build_udp(buf, INSIDE_HOST, ROUTED_HOST, ttls[i], true,
+				PAYLOAD_LEN);
+
+		zassert_equal(input(inside_iface, buf, len), NET_OK,
+			      "packet dropped");
+		check_forwarded(outside_iface, buf, len);
+	}
+}
+
+static void test_ttl_exceeded(void)
+{
+	u8_t buf[MAX_PKT_LEN];
+	size_t len;
+
+	len = build_udp(buf, INSIDE_HOST, ROUTED_HOST, 1, false,
+			PAYLOAD_LEN);
+
+	zassert_equal(input(inside_iface, buf, len), NET_DROP,
+		      "packet forwarded");
+	check_icmp_error(buf, NET_ICMPV4_TIME_EXCEEDED,
+			 NET_ICMPV4_TIME_EXCEEDED_TTL);
+}
+
+static void test_no_route(void)
+{
+	u8_t buf[MAX_PKT_LEN];
+	size_t len;
+
+	/* The default iface has no gateway */
+	len = build_udp(buf, INSIDE_HOST, UNROUTED_HOST, 64, false,
+			PAYLOAD_LEN);
+
+	zassert_equal(input(inside_iface, buf, len), NET_DROP,
+		      "packet forwarded");
+	check_icmp_error(buf, NET_ICMPV4_DST_UNREACH,
+			 NET_ICMPV4_DST_UNREACH_NO_NET);
+}
+
+static void test_frag_needed(void)
+{
+	size_t payload_len = OUTSIDE_MTU - UDP_OFF -
+		sizeof(struct net_udp_hdr) + 1;
+	u8_t buf[MAX_PKT_LEN];
+	size_t len;
+
+	len = build_udp(buf, INSIDE_HOST, ROUTED_HOST, 64, true,
+			payload_len);
+
+	zassert_equal(input(inside_iface, buf, len), NET_DROP,
+		      "packet forwarded");
+	check_icmp_error(buf, NET_ICMPV4_DST_UNREACH,
+			 NET_ICMPV4_DST_UNREACH_FRAG);
+
+	/* One byte less fits */
+	len = build_udp(buf, INSIDE_HOST, ROUTED_HOST, 64, true,
+			payload_len - 1);
+
+	zassert_equal(input(inside_iface, buf, len), NET_OK,
+		      "packet dropped");
+	check_forwarded(outside_iface, buf, len);
+}
+
+/* Forward a non-DF fragment larger than the outside MTU, and check that
+ * the pieces keep its identification, its place in the datagram and its
+ * MF flag.
+ */
+static void forward_fragment(bool more)
+{
+	struct net_ipv4_hdr *ip_hdr;
+	u8_t buf[MAX_PKT_LEN];
+	size_t piece_len;
+	size_t offset;
+	u16_t flag;
+	size_t len;
+	int i;
+
+	len = build_udp(buf, INSIDE_HOST, ROUTED_HOST, 64, false,
+			FRAG_DATA_LEN - sizeof(struct net_udp_hdr));
+
+	ip_hdr = (struct net_ipv4_hdr *)buf;
+	sys_put_be16(FRAG_ID, ip_hdr->id);
+	sys_put_be16(FRAG_OFFSET / 8 | (more ? NET_IPV4_MF : 0),
+		     ip_hdr->offset);
+	ip_hdr->chksum = 0U;
+	ip_hdr->chksum = htons(~sum16(buf, UDP_OFF, 0));
+
+	piece_count = 0;
+	log_pieces = true;
+
+	zassert_equal(input(inside_iface, buf, len), NET_OK,
+		      "fragment dropped");
+
+	for (i = 0; i < MAX_PIECES; i++) {
+		zassert_equal(k_sem_take(&piece_sem, WAIT_TIME), 0,
+			      "piece %d not sent", i);
+	}
+
+	log_pieces = false;
+	k_sem_reset(&sent_sem);
+
+	zassert_equal(sent.iface, outside_iface, "wrong iface");
+
+	for (i = 0, offset = 0; i < MAX_PIECES; i++) {
+		ip_hdr = (struct net_ipv4_hdr *)pieces[i].data;
+		piece_len = MIN(FRAG_PIECE_LEN, FRAG_DATA_LEN - offset);
+
+		zassert_equal(pieces[i].len, UDP_OFF + piece_len,
+			      "wrong length of piece %d", i);
+		zassert_true(pieces[i].len <= OUTSIDE_MTU,
+			     "piece %d larger than the MTU", i);
+		zassert_equal(ntohs(ip_hdr->len), pieces[i].len,
+			      "wrong IPv4 length of piece %d", i);
+		zassert_equal(sys_get_be16(ip_hdr->id), FRAG_ID,
+			      "wrong id of piece %d", i);
+		zassert_equal(ip_hdr->ttl, 63, "TTL not decremented");
+		zassert_equal(sum16(pieces[i].data, UDP_OFF, 0), 0xffff,
+			      "wrong header checksum of piece %d", i);
+
+		flag = sys_get_be16(ip_hdr->offset);
+		zassert_equal((flag & NET_IPV4_FRAGH_OFFSET_MASK) * 8,
+			      FRAG_OFFSET + offset,
+			      "wrong offset of piece %d", i);
+		zassert_equal(!!(flag & NET_IPV4_MF),
+			      i < MAX_PIECES - 1 || more,
+			      "wrong MF flag of piece %d", i);
+
+		zassert_mem_equal(pieces[i].data + UDP_OFF,
+				  buf + UDP_OFF + offset, piece_len,
+				  "wrong data in piece %d", i);
+
+		offset += piece_len;
+	}
+}
+
+static void test_forward_fragment(void)
+{
+	/* A fragment from the middle of the datagram, then the last one */
+	forward_fragment(true);
+	forward_fragment(false);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(net_ipv4_forward,
+			 ztest_unit_test(test_setup),
+			 ztest_unit_test(test_forward_route),
+			 ztest_unit_test(test_forward_onlink),
+			 ztest_unit_test(test_ttl_chksum),
+			 ztest_unit_test(test_ttl_exceeded),
+			 ztest_unit_test(test_no_route),
+			 ztest_unit_test(test_frag_needed),
+			 ztest_unit_test(test_forward_fragment));
+
+	ztest_run_test_suite(net_ipv4_forward);
+}
@@ -0,0 +1,571 @@
+/* main.c - Application main entry point */
+
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_IPV4_LOG_LEVEL);
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/printk.h>
+#include <linker/sections.h>
+
+#include <ztest.h>
+
+#include <net/ethernet.h>
+#include <net/dummy.h>
+#include <net/buf.h>
+#include <net/net_ip.h>
+#include <net/net_if.h>
+
+#define NET_LOG_ENABLED 1
+#include "net_private.h"
+
+#include "ipv4.h"
+#include "udp_internal.h"
+
+#define WAIT_TIME K_MSEC(250)
+#define ALLOC_TIMEOUT K_MSEC(500)
+
+/* UDP payload that does not fit in the 576 bytes MTU of the interface */
+#define DATA_LEN 1400
+
+/* The fragments carry 552, 552 and 304 bytes of the 1408 bytes UDP
+ * datagram.
+ */
+#define FRAG_COUNT 3
+#define FRAG_PAYLOAD_LEN 552
+
+/* Router Alert is copied into all the fragments, Record Route only
+ * goes into the first one.
+ */
+#define OPTS_LEN 12
+#define COPIED_OPTS_LEN 4
+#define OPTS_FRAG_PAYLOAD_LEN 544
+
+static const u8_t opts[OPTS_LEN] = {
+	0x94, 0x04, 0x00, 0x00,
+	NET_IPV4_OPTS_RR, 0x07, 0x04, 0x00, 0x00, 0x00, 0x00,
+	NET_IPV4_OPTS_EO
+};
+
+#define LOCAL_PORT 4242
+#define REMOTE_PORT 4243
+
+static struct in_addr my_addr = { { { 192, 0, 2, 1 } } };
+static struct in_addr peer_addr = { { { 192, 0, 2, 2 } } };
+
+static struct net_if *iface1;
+
+static struct k_sem wait_data;
+static struct k_sem wait_recv;
+
+static bool test_started;
+static int recv_count;
+
+/* Fragments sent by the stack, with source and destination addresses
+ * swapped so that they can be fed back as received fragments. Swapping
+ * the addresses does not change any checksum.
+ */
+static struct net_pkt *frags[FRAG_COUNT];
+static int frag_count;
+
+static int net_iface_dev_init(struct device *dev)
+{
+	return 0;
+}
+
+static u8_t *net_iface_get_mac(struct device *dev)
+{
+	static u8_t mac_addr[] = { 0x00, 0x00, 0x5E, 0x00, 0x53, 0x01 };
+
+	return mac_addr;
+}
+
+static void net_iface_init(struct net_if *iface)
+{
+	u8_t *mac = net_iface_get_mac(net_if_get_device(iface));
+
+	net_if_set_link_addr(iface, mac, 6, NET_LINK_ETHERNET);
+}
+
+static int swap_addresses(struct net_pkt *pkt)
+{
+	struct in_addr src;
+	struct in_addr dst;
+
+	net_pkt_set_overwrite(pkt, true);
+	net_pkt_cursor_init(pkt);
+
+	if (net_pkt_skip(pkt, offsetof(struct net_ipv4_hdr, src)) ||
+	    net_pkt_read(pkt, &src, sizeof(src)) ||
+	    net_pkt_read(pkt, &dst, sizeof(dst))) {
+		return -ENOBUFS;
+	}
+
+	net_pkt_cursor_init(pkt);
+
+	if (net_pkt_skip(pkt, offsetof(struct net_ipv4_hdr, src)) ||
+	    net_pkt_write(pkt, &dst, sizeof(dst)) ||
+	    net_pkt_write(pkt, &src, sizeof(src))) {
+		return -ENOBUFS;
+	}
+
+	net_pkt_cursor_init(pkt);
+
+	return 0;
+}
+
+static int sender_iface(struct device *dev, struct net_pkt *pkt)
+{
+	struct net_pkt *clone;
+
+	if (!pkt->buffer) {
+		NET_DBG("No data to send!");
+		return -ENODATA;
+	}
+
+	if (test_started && frag_count < FRAG_COUNT) {
+		clone = net_pkt_clone(pkt, K_NO_WAIT);
+		if (clone && swap_addresses(clone) == 0) {
+			frags[frag_count++] = clone;
+			k_sem_give(&wait_data);
+		} else if (clone) {
+			net_pkt_unref(clone);
+		}
+	}
+
+	net_pkt_unref(pkt);
+
+	return 0;
+}
+
+static struct dummy_api net_iface_api = {
+	.iface_api.init = net_iface_init,
+	.send = sender_iface,
+};
+
+#define _ETH_L2_LAYER DUMMY_L2
+#define _ETH_L2_CTX_TYPE NET_L2_GET_CTX_TYPE(DUMMY_L2)
+
+NET_DEVICE_INIT(net_ipv4_frag_test,
+		"net_ipv4_frag_test",
+		net_iface_dev_init,
+		device_pm_control_nop,
+		NULL,
+		NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT,
+		&net_iface_api,
+		_ETH_L2_LAYER,
+		_ETH_L2_CTX_TYPE,
+		NET_IPV4_MTU);
+
+static enum net_verdict udp_data_received(struct net_conn *conn,
+					  struct net_pkt *pkt,
+					  union net_ip_header *ip_hdr,
+					  union net_proto_header *proto_hdr,
+					  void *user_data)
+{
+	NET_PKT_DATA_ACCESS_DEFINE(udp_access, struct net_udp_hdr);
+	size_t len = net_pkt_get_len(pkt);
+	bool valid = true;
+	u8_t data;
+	int i;
+
+	NET_DBG("Data %p received", pkt);
+
+	net_pkt_cursor_init(pkt);
+
+	if (net_pkt_skip(pkt, net_pkt_ip_hdr_len(pkt) +
+			 net_pkt_ipv4_opts_len(pkt)) ||
+	    !net_pkt_get_data(pkt, &udp_access) ||
+	    net_pkt_set_data(pkt, &udp_access)) {
+		valid = false;
+	}
+
+	if (len - net_pkt_ip_hdr_len(pkt) - net_pkt_ipv4_opts_len(pkt) -
+	    NET_UDPH_LEN != DATA_LEN) {
+		NET_DBG("Invalid length %zd", len);
+		valid = false;
+	}
+
+	for (i = 0; valid && i < DATA_LEN; i++) {
+		if (net_pkt_read_u8(pkt, &data) || data != (u8_t)i) {
+			NET_DBG("Invalid data at %d", i);
+			valid = false;
+		}
+	}
+
+	net_pkt_unref(pkt);
+
+	if (valid) {
+		recv_count++;
+		k_sem_give(&wait_recv);
+	}
+
+	return NET_OK;
+}
+
+static void test_setup(void)
+{
+	static struct net_conn_handle *handle;
+	struct sockaddr remote_addr = { 0 };
+	struct sockaddr local_addr = { 0 };
+	struct net_if_addr *ifaddr;
+	int ret;
+
+	k_sem_init(&wait_data, 0, UINT_MAX);
+	k_sem_init(&wait_recv, 0, UINT_MAX);
+
+	iface1 = net_if_get_default();
+	zassert_not_null(iface1, "Interface 1");
+
+	ifaddr = net_if_ipv4_addr_add(iface1, &my_addr, NET_ADDR_MANUAL, 0);
+	zassert_not_null(ifaddr, "Cannot add IPv4 address");
+
+	net_ipaddr_copy(&net_sin(&local_addr)->sin_addr, &my_addr);
+	local_addr.sa_family = AF_INET;
+
+	net_ipaddr_copy(&net_sin(&remote_addr)->sin_addr, &peer_addr);
+	remote_addr.sa_family = AF_INET;
+
+	ret = net_udp_register(AF_INET, &remote_addr, &local_addr,
+			       REMOTE_PORT, LOCAL_PORT, udp_data_received,
+			       NULL, &handle);
+	zassert_equal(ret, 0, "Cannot register UDP handler");
+}
+
+static void verify_fragment(struct net_pkt *pkt, int idx, u16_t id)
+{
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	struct net_ipv4_hdr *hdr;
+	u16_t payload_len;
+	u16_t flag;
+
+	net_pkt_cursor_init(pkt);
+
+	hdr = (struct net_ipv4_hdr *)net_pkt_get_data(pkt, &ipv4_access);
+	zassert_not_null(hdr, "Cannot access IPv4 header");
+
+	payload_len = idx < FRAG_COUNT - 1 ? FRAG_PAYLOAD_LEN :
+		NET_UDPH_LEN + DATA_LEN - (FRAG_COUNT - 1) * FRAG_PAYLOAD_LEN;
+
+	zassert_equal(ntohs(hdr->len), sizeof(*hdr) + payload_len,
+		      "Invalid length of fragment %d", idx);
+	zassert_equal(net_pkt_get_len(pkt), sizeof(*hdr) + payload_len,
+		      "Invalid packet length of fragment %d", idx);
+	zassert_equal(sys_get_be16(hdr->id), id,
+		      "Invalid id of fragment %d", idx);
+
+	flag = sys_get_be16(hdr->offset);
+
+	zassert_equal((flag & NET_IPV4_FRAGH_OFFSET_MASK) * 8,
+		      idx * FRAG_PAYLOAD_LEN,
+		      "Invalid offset of fragment %d", idx);
+	zassert_equal(!!(flag & NET_IPV4_MF), idx < FRAG_COUNT - 1,
+		      "Invalid MF flag of fragment %d", idx);
+	zassert_equal(net_calc_chksum_ipv4(pkt), 0,
+		      "Invalid checksum of fragment %d", idx);
+}
+
+static void test_send_ipv4_fragment(void)
+{
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	struct net_ipv4_hdr *hdr;
+	struct net_pkt *pkt;
+	u16_t id;
+	int i;
+
+	pkt = net_pkt_alloc_with_buffer(iface1, NET_UDPH_LEN + DATA_LEN,
+					AF_INET, IPPROTO_UDP, ALLOC_TIMEOUT);
+	zassert_not_null(pkt, "Cannot allocate packet");
+
+	zassert_equal(net_ipv4_create(pkt, &my_addr, &peer_addr), 0,
+		      "Cannot create IPv4 header");
+	zassert_equal(net_udp_create(pkt, htons(LOCAL_PORT),
+				     htons(REMOTE_PORT)), 0,
+		      "Cannot create UDP header");
+
+	for (i = 0; i < DATA_LEN; i++) {
+		zassert_equal(net_pkt_write_u8(pkt, (u8_t)i), 0,
+			      "Cannot write data");
+	}
+
+	net_pkt_cursor_init(pkt);
+	zassert_equal(net_ipv4_finalize(pkt, IPPROTO_UDP), 0,
+		      "Cannot finalize packet");
+
+	test_started = true;
+
+	zassert_true(net_send_data(pkt) >= 0, "Cannot send packet");
+
+	for (i = 0; i < FRAG_COUNT; i++) {
+		zassert_equal(k_sem_take(&wait_data, WAIT_TIME), 0,
+			      "Fragment %d not sent", i);
+	}
+
+	test_started = false;
+
+	zassert_equal(frag_count, FRAG_COUNT, "Invalid number of fragments");
+
+	net_pkt_cursor_init(frags[0]);
+	hdr = (struct net_ipv4_hdr *)net_pkt_get_data(frags[0], &ipv4_access);
+	zassert_not_null(hdr, "Cannot access IPv4 header");
+	id = sys_get_be16(hdr->id);
+
+	for (i = 0; i < FRAG_COUNT; i++) {
+		verify_fragment(frags[i], i, id);
+	}
+}
+
+static void recv_fragment(int idx)
+{
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_clone(frags[idx], ALLOC_TIMEOUT);
+	zassert_not_null(pkt, "Cannot clone fragment %d", idx);
+
+	net_pkt_cursor_init(pkt);
+
+	zassert_equal(net_recv_data(iface1, pkt), 0,
+		      "Cannot receive fragment %d", idx);
+}
+
+static void test_recv_ipv4_fragment(void)
+{
+	int i;
+
+	recv_count = 0;
+
+	/* The last fragment arrives first */
+	for (i = FRAG_COUNT - 1; i >= 0; i--) {
+		recv_fragment(i);
+	}
+
+	zassert_equal(k_sem_take(&wait_recv, WAIT_TIME), 0,
+		      "Datagram not reassembled");
+	zassert_equal(recv_count, 1, "Invalid number of datagrams");
+}
+
+static void test_recv_ipv4_fragment_duplicate(void)
+{
+	recv_count = 0;
+
+	recv_fragment(0);
+	recv_fragment(0);
+	recv_fragment(1);
+	recv_fragment(1);
+	recv_fragment(2);
+
+	zassert_equal(k_sem_take(&wait_recv, WAIT_TIME), 0,
+		      "Datagram not reassembled");
+
+	/* Only one datagram is delivered */
+	zassert_not_equal(k_sem_take(&wait_recv, WAIT_TIME), 0,
+			  "Duplicate datagram received");
+	zassert_equal(recv_count, 1, "Invalid number of datagrams");
+}
+
+static void test_recv_ipv4_fragment_overlap(void)
+{
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	struct net_ipv4_hdr *hdr;
+	struct net_pkt *pkt;
+	u16_t flag;
+
+	recv_count = 0;
+
+	recv_fragment(0);
+
+	/* Second fragment moved back by 8 bytes over the first one */
+	pkt = net_pkt_clone(frags[1], ALLOC_TIMEOUT);
+	zassert_not_null(pkt, "Cannot clone fragment");
+
+	net_pkt_set_overwrite(pkt, true);
+	net_pkt_cursor_init(pkt);
+
+	hdr = (struct net_ipv4_hdr *)net_pkt_get_data(pkt, &ipv4_access);
+	zassert_not_null(hdr, "Cannot access IPv4 header");
+
+	flag = sys_get_be16(hdr->offset) - 1;
+	sys_put_be16(flag, hdr->offset);
+	hdr->chksum = 0U;
+	hdr->chksum = net_calc_chksum_ipv4(pkt);
+
+	zassert_equal(net_pkt_set_data(pkt, &ipv4_access), 0,
+		      "Cannot update IPv4 header");
+
+	net_pkt_cursor_init(pkt);
+	zassert_equal(net_recv_data(iface1, pkt), 0,
+		      "Cannot receive fragment");
+
+	/* The overlap discarded the first fragment */
+	recv_fragment(1);
+	recv_fragment(2);
+
+	zassert_not_equal(k_sem_take(&wait_recv, WAIT_TIME), 0,
+			  "Overlapping datagram received");
+	zassert_equal(recv_count, 0, "Invalid number of datagrams");
+
+	/* The first fragment completes the new reassembly */
+	recv_fragment(0);
+
+	zassert_equal(k_sem_take(&wait_recv, WAIT_TIME), 0,
+		      "Datagram not reassembled");
+	zassert_equal(recv_count, 1, "Invalid number of datagrams");
+}
+
+static void test_recv_ipv4_fragment_timeout(void)
+{
+	recv_count = 0;
+
+	recv_fragment(0);
+	recv_fragment(1);
+
+	/* Let the reassembly time out */
+	k_sleep(K_SECONDS(CONFIG_NET_IPV4_FRAGMENT_TIMEOUT) + WAIT_TIME);
+
+	recv_fragment(2);
+
+	zassert_not_equal(k_sem_take(&wait_recv, WAIT_TIME), 0,
+			  "Timed out datagram received");
+	zassert_equal(recv_count, 0, "Invalid number of datagrams");
+
+	/* Let the pending last fragment time out too */
+	k_sleep(K_SECONDS(CONFIG_NET_IPV4_FRAGMENT_TIMEOUT));
+}
+
+static void test_release(void)
+{
+	int i;
+
+	for (i = 0; i < frag_count; i++) {
+		net_pkt_unref(frags[i]);
+		frags[i] = NULL;
+	}
+
+	frag_count = 0;
+}
+
+static void verify_opts_fragment(struct net_pkt *pkt, int idx)
+{
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	u8_t pkt_opts[OPTS_LEN];
+	struct net_ipv4_hdr *hdr;
+	u16_t payload_len;
+	u16_t opts_len;
+
+	net_pkt_cursor_init(pkt);
+
+	hdr = (struct net_ipv4_hdr *)net_pkt_get_data(pkt, &ipv4_access);
+	zassert_not_null(hdr, "Cannot access IPv4 header");
+
+	opts_len = idx ? COPIED_OPTS_LEN : OPTS_LEN;
+	payload_len = idx < FRAG_COUNT - 1 ? OPTS_FRAG_PAYLOAD_LEN :
+		NET_UDPH_LEN + DATA_LEN -
+		(FRAG_COUNT - 1) * OPTS_FRAG_PAYLOAD_LEN;
+
+	zassert_equal((hdr->vhl & NET_IPV4_IHL_MASK) * 4U,
+		      sizeof(*hdr) + opts_len,
+		      "Invalid header length of fragment %d", idx);
+	zassert_equal(ntohs(hdr->len), sizeof(*hdr) + opts_len + payload_len,
+		      "Invalid length of fragment %d", idx);
+	zassert_equal((sys_get_be16(hdr->offset) &
+		       NET_IPV4_FRAGH_OFFSET_MASK) * 8,
+		      idx * OPTS_FRAG_PAYLOAD_LEN,
+		      "Invalid offset of fragment %d", idx);
+	zassert_equal(net_pkt_ipv4_opts_len(pkt), opts_len,
+		      "Invalid options length of fragment %d", idx);
+	zassert_equal(net_calc_chksum_ipv4(pkt), 0,
+		      "Invalid checksum of fragment %d", idx);
+
+	zassert_equal(net_pkt_skip(pkt, sizeof(*hdr)), 0,
+		      "Cannot skip IPv4 header");
+	zassert_equal(net_pkt_read(pkt, pkt_opts, opts_len), 0,
+		      "Cannot read options of fragment %d", idx);
+	zassert_mem_equal(pkt_opts, opts, opts_len,
+			  "Invalid options in fragment %d", idx);
+}
+
+static void test_send_ipv4_fragment_opts(void)
+{
+	NET_PKT_DATA_ACCESS_CONTIGUOUS_DEFINE(ipv4_access, struct net_ipv4_hdr);
+	struct net_ipv4_hdr *hdr;
+	struct net_pkt *pkt;
+	int i;
+
+	pkt = net_pkt_alloc_with_buffer(iface1,
+					OPTS_LEN + NET_UDPH_LEN + DATA_LEN,
+					AF_INET, IPPROTO_UDP, ALLOC_TIMEOUT);
+	zassert_not_null(pkt, "Cannot allocate packet");
+
+	zassert_equal(net_ipv4_create(pkt, &my_addr, &peer_addr), 0,
+		      "Cannot create IPv4 header");
+	zassert_equal(net_pkt_write(pkt, opts, sizeof(opts)), 0,
+		      "Cannot write options");
+	net_pkt_set_ipv4_opts_len(pkt, sizeof(opts));
+
+	zassert_equal(net_udp_create(pkt, htons(LOCAL_PORT),
+				     htons(REMOTE_PORT)), 0,
+		      "Cannot create UDP header");
+
+	for (i = 0; i < DATA_LEN; i++) {
+		zassert_equal(net_pkt_write_u8(pkt, (u8_t)i), 0,
+			      "Cannot write data");
+	}
+
+	net_pkt_set_overwrite(pkt, true);
+	net_pkt_cursor_init(pkt);
+
+	hdr = (struct net_ipv4_hdr *)net_pkt_get_data(pkt, &ipv4_access);
+	zassert_not_null(hdr, "Cannot access IPv4 header");
+	hdr->vhl = 0x40 | ((sizeof(*hdr) + sizeof(opts)) / 4U);
+	zassert_equal(net_pkt_set_data(pkt, &ipv4_access), 0,
+		      "Cannot update IPv4 header");
+
+	net_pkt_cursor_init(pkt);
+	zassert_equal(net_ipv4_finalize(pkt, IPPROTO_UDP), 0,
+		      "Cannot finalize packet");
+
+	test_started = true;
+
+	zassert_true(net_send_data(pkt) >= 0, "Cannot send packet");
+
+	for (i = 0; i < FRAG_COUNT; i++) {
+		zassert_equal(k_sem_take(&wait_data, WAIT_TIME), 0,
+			      "Fragment %d not sent", i);
+	}
+
+	test_started = false;
+
+	zassert_equal(frag_count, FRAG_COUNT, "Invalid number of fragments");
+
+	for (i = 0; i < FRAG_COUNT; i++) {
+		verify_opts_fragment(frags[i], i);
+	}
+
+	test_release();
+}
+
+void test_main(void)
+{
+	ztest_test_suite(net_ipv4_fragment_test,
+			 ztest_unit_test(test_setup),
+			 ztest_unit_test(test_send_ipv4_fragment),
+			 ztest_unit_test(test_recv_ipv4_fragment),
+			 ztest_unit_test(test_recv_ipv4_fragment_duplicate),
+			 ztest_unit_test(test_recv_ipv4_fragment_overlap),
+			 ztest_unit_test(test_recv_ipv4_fragment_timeout),
+			 ztest_unit_test(test_release),
+			 ztest_unit_test(test_send_ipv4_fragment_opts)
+			 );
+
+	ztest_run_test_suite(net_ipv4_fragment_test);
+}
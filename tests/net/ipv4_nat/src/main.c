@@ -0,0 +1,535 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_IPV4_NAT_LOG_LEVEL);
+
+#include <ztest.h>
+#include <string.h>
+
+#include <net/net_if.h>
+#include <net/net_pkt.h>
+#include <net/dummy.h>
+
+#include "net_private.h"
+#include "icmpv4.h"
+#include "ipv4.h"
+#include "route.h"
+#include "tcp_internal.h"
+
+/* 192.0.2.1/24 inside, 198.51.100.1/24 outside as the external iface of
+ * the NAT, and 203.0.113.0/24 routed through 198.51.100.254.
+ */
+#define INSIDE_ADDR	0xc0000201
+#define INSIDE_HOST	0xc0000202
+#define OUTSIDE_ADDR	0xc6336401
+#define GATEWAY		0xc63364fe
+#define ROUTED_PREFIX	0xcb007100
+#define REMOTE_HOST	0xcb007101
+#define OTHER_HOST	0xcb007102
+
+#define INSIDE_PORT	20000
+#define REMOTE_PORT	5001
+#define ECHO_ID		0x1234
+
+#define L4_OFF sizeof(struct net_ipv4_hdr)
+#define PAYLOAD_LEN 18
+#define MAX_PKT_LEN 128
+
+#define PORT_MIN CONFIG_NET_IPV4_NAT_PORT_MIN
+#define PORT_MAX CONFIG_NET_IPV4_NAT_PORT_MAX
+
+#define WAIT_TIME K_MSEC(200)
+
+struct icmp_echo_hdr {
+	struct net_icmp_hdr hdr;
+	struct net_icmpv4_echo_req echo;
+} __packed;
+
+static struct net_if *inside_iface;
+static struct net_if *outside_iface;
+
+/* The last packet sent, by either interface */
+static struct {
+	struct net_if *iface;
+	u8_t data[MAX_PKT_LEN];
+	size_t len;
+} sent;
+
+static K_SEM_DEFINE(sent_sem, 0, 1);
+
+/* External port of the first UDP connection, and ICMPv4 echo identifier
+ * of the first echo query, in network byte order.
+ */
+static u16_t udp_ext_port;
+static u16_t icmp_ext_id;
+
+static void test_iface_init(struct net_if *iface)
+{
+	static u8_t macs[2][6] = {
+		{ 0x00, 0x00, 0x5e, 0x00, 0x53, 0x01 },
+		{ 0x00, 0x00, 0x5e, 0x00, 0x53, 0x02 },
+	};
+	static int count;
+
+	net_if_set_link_addr(iface, macs[count], sizeof(macs[count]),
+			     NET_LINK_DUMMY);
+	count++;
+}
+
+static int test_send(struct device *dev, struct net_pkt *pkt)
+{
+	sent.iface = net_if_lookup_by_dev(dev);
+	sent.len = net_pkt_get_len(pkt);
+
+	zassert_true(sent.len <= sizeof(sent.data), "packet too long");
+
+	net_pkt_cursor_init(pkt);
+	zassert_equal(net_pkt_read(pkt, sent.data, sent.len), 0,
+		      "cannot read packet");
+
+	k_sem_give(&sent_sem);
+
+	return 0;
+}
+
+static struct dummy_api test_api = {
+	.iface_api.init = test_iface_init,
+	.send = test_send,
+};
+
+static int test_dev_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return 0;
+}
+
+NET_DEVICE_INIT_INSTANCE(nat_inside, "nat_inside", inside,
+			 test_dev_init, device_pm_control_nop, NULL, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &test_api,
+			 DUMMY_L2, NET_L2_GET_CTX_TYPE(DUMMY_L2), 1500);
+
+NET_DEVICE_INIT_INSTANCE(nat_outside, "nat_outside", outside,
+			 test_dev_init, device_pm_control_nop, NULL, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &test_api,
+			 DUMMY_L2, NET_L2_GET_CTX_TYPE(DUMMY_L2), 1500);
+
+/* Ones' complement sum of the data, folded to 16 bits */
+static u16_t sum16(const u8_t *data, size_t len, u32_t sum)
+{
+	size_t i;
+
+	for (i = 0; i + 1 < len; i += 2) {
+		sum += data[i] << 8 | data[i + 1];
+	}
+
+	if (len & 1) {
+		sum += data[len - 1] << 8;
+	}
+
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	return sum;
+}
+
+/* Sum of the UDP pseudo header, the header and the data */
+static u16_t sum_udp(const u8_t *pkt, size_t len)
+{
+	const struct net_ipv4_hdr *ip_hdr = (struct net_ipv4_hdr *)pkt;
+	u32_t sum;
+
+	sum = sum16((u8_t *)&ip_hdr->src, 2 * sizeof(struct in_addr), 0);
+	sum += IPPROTO_UDP + len - L4_OFF;
+
+	return sum16(pkt + L4_OFF, len - L4_OFF, sum);
+}
+
+static size_t build_ip(u8_t *buf, u8_t proto, u32_t src, u32_t dst,
+		       size_t l4_len)
+{
+	struct net_ipv4_hdr *ip_hdr = (struct net_ipv4_hdr *)buf;
+
+	memset(ip_hdr, 0, sizeof(*ip_hdr));
+
+	ip_hdr->vhl = 0x45;
+	ip_hdr->len = htons(L4_OFF + l4_len);
+	ip_hdr->ttl = 64U;
+	ip_hdr->proto = proto;
+	ip_hdr->src.s_addr = htonl(src);
+	ip_hdr->dst.s_addr = htonl(dst);
+	ip_hdr->chksum = htons(~sum16(buf, L4_OFF, 0));
+
+	return L4_OFF + l4_len;
+}
+
+/* The ports are in network byte order */
+static size_t build_udp(u8_t *buf, u32_t src, u16_t src_port, u32_t dst,
+			u16_t dst_port)
+{
+	struct net_udp_hdr *udp_hdr = (struct net_udp_hdr *)(buf + L4_OFF);
+	size_t len;
+	int i;
+
+	len = build_ip(buf, IPPROTO_UDP, src, dst,
+		       sizeof(*udp_hdr) + PAYLOAD_LEN);
+
+	udp_hdr->src_port = src_port;
+	udp_hdr->dst_port = dst_port;
+	udp_hdr->len = htons(sizeof(*udp_hdr) + PAYLOAD_LEN);
+	udp_hdr->chksum = 0U;
+
+	for (i = 0; i < PAYLOAD_LEN; i++) {
+		buf[L4_OFF + sizeof(*udp_hdr) + i] = i;
+	}
+
+	udp_hdr->chksum = htons(~sum_udp(buf, len));
+
+	return len;
+}
+
+/* The identifier is in network byte order */
+static size_t build_echo(u8_t *buf, u8_t type, u32_t src, u32_t dst,
+			 u16_t id)
+{
+	struct icmp_echo_hdr *icmp_hdr = (struct icmp_echo_hdr *)(buf + L4_OFF);
+	size_t len;
+
+	len = build_ip(buf, IPPROTO_ICMP, src, dst, sizeof(*icmp_hdr));
+
+	icmp_hdr->hdr.type = type;
+	icmp_hdr->hdr.code = 0U;
+	icmp_hdr->hdr.chksum = 0U;
+	icmp_hdr->echo.identifier = id;
+	icmp_hdr->echo.sequence = htons(1);
+	icmp_hdr->hdr.chksum = htons(~sum16(buf + L4_OFF, sizeof(*icmp_hdr),
+					    0));
+
+	return len;
+}
+
+static enum net_verdict input(struct net_if *iface, const u8_t *data,
+			      size_t len)
+{
+	enum net_verdict verdict;
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_rx_alloc_with_buffer(iface, len, AF_INET, 0, K_NO_WAIT);
+	zassert_not_null(pkt, "cannot allocate packet");
+
+	zassert_equal(net_pkt_write(pkt, data, len), 0, "cannot write");
+	net_pkt_cursor_init(pkt);
+
+	verdict = net_ipv4_input(pkt);
+	if (verdict == NET_DROP) {
+		net_pkt_unref(pkt);
+	}
+
+	return verdict;
+}
+
+/* Check the addresses of a packet that was forwarded to an iface, and
+ * that its checksums are still valid.
+ */
+static void check_sent(struct net_if *iface, u32_t src, u32_t dst)
+{
+	struct net_ipv4_hdr *ip_hdr = (struct net_ipv4_hdr *)sent.data;
+
+	zassert_equal(k_sem_take(&sent_sem, WAIT_TIME), 0,
+		      "packet not forwarded");
+	zassert_equal(sent.iface, iface, "forwarded to the wrong iface");
+
+	zassert_equal(ntohl(ip_hdr->src.s_addr), src, "wrong source");
+	zassert_equal(ntohl(ip_hdr->dst.s_addr), dst, "wrong destination");
+	zassert_equal(ip_hdr->ttl, 63, "TTL not decremented");
+	zassert_equal(sum16(sent.data, L4_OFF, 0), 0xffff,
+		      "wrong header checksum");
+
+	if (ip_hdr->proto == IPPROTO_UDP) {
+		zassert_equal(sum_udp(sent.data, sent.len), 0xffff,
+			      "wrong UDP checksum");
+	} else {
+		zassert_equal(sum16(sent.data + L4_OFF, sent.len - L4_OFF, 0),
+			      0xffff, "wrong ICMPv4 checksum");
+	}
+}
+
+static void check_not_sent(void)
+{
+	zassert_equal(k_sem_take(&sent_sem, WAIT_TIME), -EAGAIN,
+		      "packet forwarded");
+}
+
+static struct net_udp_hdr *sent_udp_hdr(void)
+{
+	return (struct net_udp_hdr *)(sent.data + L4_OFF);
+}
+
+static struct icmp_echo_hdr *sent_echo_hdr(void)
+{
+	return (struct icmp_echo_hdr *)(sent.data + L4_OFF);
+}
+
+static bool port_in_range(u16_t port)
+{
+	return ntohs(port) >= PORT_MIN && ntohs(port) <= PORT_MAX;
+}
+
+/* Send a UDP packet from the inside host, returns the external port it
+ * was given, or 0 if it was dropped.
+ */
+static u16_t udp_out(u16_t int_port)
+{
+	u8_t buf[MAX_PKT_LEN];
+	size_t len;
+
+	len = build_udp(buf, INSIDE_HOST, htons(int_port), REMOTE_HOST,
+			htons(REMOTE_PORT));
+
+	if (input(inside_iface, buf, len) == NET_DROP) {
+		check_not_sent();
+		return 0U;
+	}
+
+	check_sent(outside_iface, OUTSIDE_ADDR, REMOTE_HOST);
+	zassert_equal(sent_udp_hdr()->dst_port, htons(REMOTE_PORT),
+		      "destination port changed");
+	zassert_true(port_in_range(sent_udp_hdr()->src_port),
+		     "port %u out of range", ntohs(sent_udp_hdr()->src_port));
+
+	return sent_udp_hdr()->src_port;
+}
+
+/* Send an echo request from the inside host, returns the external
+ * identifier it was given, or 0 if it was dropped.
+ */
+static u16_t echo_out(u16_t id)
+{
+	u8_t buf[MAX_PKT_LEN];
+	size_t len;
+
+	len = build_echo(buf, NET_ICMPV4_ECHO_REQUEST, INSIDE_HOST,
+			 REMOTE_HOST, htons(id));
+
+	if (input(inside_iface, buf, len) == NET_DROP) {
+		check_not_sent();
+		return 0U;
+	}
+
+	check_sent(outside_iface, OUTSIDE_ADDR, REMOTE_HOST);
+	zassert_true(port_in_range(sent_echo_hdr()->echo.identifier),
+		     "identifier %u out of range",
+		     ntohs(sent_echo_hdr()->echo.identifier));
+
+	return sent_echo_hdr()->echo.identifier;
+}
+
+/* Send an echo reply from a remote host to the external address, returns
+ * true if it was forwarded to the inside host.
+ */
+static bool echo_in(u32_t src, u16_t ext_id)
+{
+	u8_t buf[MAX_PKT_LEN];
+	size_t len;
+
+	len = build_echo(buf, NET_ICMPV4_ECHO_REPLY, src, OUTSIDE_ADDR,
+			 ext_id);
+
+	/* A reply that is not translated is for this host, which does
+	 * not answer it.
+	 */
+	if (input(outside_iface, buf, len) == NET_DROP ||
+	    k_sem_take(&sent_sem, WAIT_TIME) == -EAGAIN) {
+		return false;
+	}
+
+	k_sem_give(&sent_sem);
+	check_sent(inside_iface, src, INSIDE_HOST);
+
+	return true;
+}
+
+static void add_addr(struct net_if *iface, u32_t addr)
+{
+	struct in_addr in_addr = { .s_addr = htonl(addr) };
+	struct in_addr netmask = { .s_addr = htonl(0xffffff00) };
+
+	zassert_not_null(net_if_ipv4_addr_add(iface, &in_addr,
+					      NET_ADDR_MANUAL, 0),
+			 "cannot add address");
+
+	net_if_ipv4_set_netmask(iface, &netmask);
+}
+
+static void test_setup(void)
+{
+	struct in_addr prefix = { .s_addr = htonl(ROUTED_PREFIX) };
+	struct in_addr gw = { .s_addr = htonl(GATEWAY) };
+
+	inside_iface = net_if_lookup_by_dev(device_get_binding("nat_inside"));
+	outside_iface = net_if_lookup_by_dev(device_get_binding(
+						     "nat_outside"));
+	zassert_not_null(inside_iface, "no inside iface");
+	zassert_not_null(outside_iface, "no outside iface");
+
+	add_addr(inside_iface, INSIDE_ADDR);
+	add_addr(outside_iface, OUTSIDE_ADDR);
+
+	zassert_not_null(net_route_ipv4_add(outside_iface, &prefix, 24, &gw),
+			 "cannot add route");
+
+	zassert_equal(net_ipv4_nat_enable(outside_iface), 0,
+		      "cannot enable NAT");
+}
+
+static void test_udp_out(void)
+{
+	udp_ext_port = udp_out(INSIDE_PORT);
+	zassert_not_equal(udp_ext_port, 0U, "packet dropped");
+
+	/* The connection keeps its port */
+	zassert_equal(udp_out(INSIDE_PORT), udp_ext_port, "port changed");
+}
+
+static void test_udp_in(void)
+{
+	u8_t buf[MAX_PKT_LEN];
+	size_t len;
+
+	len = build_udp(buf, REMOTE_HOST, htons(REMOTE_PORT), OUTSIDE_ADDR,
+			udp_ext_port);
+
+	zassert_equal(input(outside_iface, buf, len), NET_OK,
+		      "reply dropped");
+
+	check_sent(inside_iface, REMOTE_HOST, INSIDE_HOST);
+	zassert_equal(sent_udp_hdr()->src_port, htons(REMOTE_PORT),
+		      "source port changed");
+	zassert_equal(sent_udp_hdr()->dst_port, htons(INSIDE_PORT),
+		      "port of the inside host not restored");
+}
+
+static void test_udp_no_chksum(void)
+{
+	u8_t buf[MAX_PKT_LEN];
+	size_t len;
+
+	/* A zero checksum means none, and stays so */
+	len = build_udp(buf, REMOTE_HOST, htons(REMOTE_PORT), OUTSIDE_ADDR,
+			udp_ext_port);
+	((struct net_udp_hdr *)(buf + L4_OFF))->chksum = 0U;
+
+	zassert_equal(input(outside_iface, buf, len), NET_OK,
+		      "reply dropped");
+
+	zassert_equal(k_sem_take(&sent_sem, WAIT_TIME), 0,
+		      "packet not forwarded");
+	zassert_equal(sent.iface, inside_iface, "forwarded to wrong iface");
+	zassert_equal(sent_udp_hdr()->chksum, 0U, "checksum added");
+}
+
+static void test_icmp_echo(void)
+{
+	icmp_ext_id = echo_out(ECHO_ID);
+	zassert_not_equal(icmp_ext_id, 0U, "echo request dropped");
+
+	zassert_true(echo_in(REMOTE_HOST, icmp_ext_id), "reply dropped");
+	zassert_equal(sent_echo_hdr()->echo.identifier, htons(ECHO_ID),
+		      "identifier not restored");
+
+	/* Only the remote host of the connection gets through */
+	zassert_false(echo_in(OTHER_HOST, icmp_ext_id),
+		      "reply from another host translated");
+}
+
+static void test_port_exhaustion(void)
+{
+	u8_t buf[MAX_PKT_LEN];
+	struct net_tcp_hdr *tcp_hdr = (struct net_tcp_hdr *)(buf + L4_OFF);
+	size_t len;
+	u16_t port;
+
+	zassert_equal(PORT_MAX - PORT_MIN + 1, 2, "test expects two ports");
+	zassert_equal(CONFIG_NET_IPV4_NAT_MAX_CONNS, 4,
+		      "test expects four connections");
+
+	/* The other port, then none left for UDP */
+	port = udp_out(INSIDE_PORT + 1);
+	zassert_not_equal(port, 0U, "packet dropped");
+	zassert_not_equal(port, udp_ext_port, "port reused");
+
+	zassert_equal(udp_out(INSIDE_PORT + 2), 0U,
+		      "packet forwarded without a free port");
+
+	/* The ports of other protocols are separate, the table is full
+	 * with this one.
+	 */
+	zassert_not_equal(echo_out(ECHO_ID + 1), 0U, "echo request dropped");
+
+	len = build_ip(buf, IPPROTO_TCP, INSIDE_HOST, REMOTE_HOST,
+		       sizeof(*tcp_hdr));
+	memset(tcp_hdr, 0, sizeof(*tcp_hdr));
+	tcp_hdr->src_port = htons(INSIDE_PORT);
+	tcp_hdr->dst_port = htons(REMOTE_PORT);
+	tcp_hdr->offset = (sizeof(*tcp_hdr) / 4U) << 4;
+	tcp_hdr->flags = NET_TCP_SYN;
+
+	zassert_equal(input(inside_iface, buf, len), NET_DROP,
+		      "packet forwarded with the table full");
+	check_not_sent();
+}
+
+static void test_mapping_timeout(void)
+{
+	k_sleep(K_SECONDS(MAX(CONFIG_NET_IPV4_NAT_UDP_TIMEOUT,
+			      CONFIG_NET_IPV4_NAT_ICMP_TIMEOUT)));
+	k_sleep(WAIT_TIME);
+
+	/* Replies are not translated once the connection timed out */
+	zassert_false(echo_in(REMOTE_HOST, icmp_ext_id),
+		      "reply to a timed out connection translated");
+
+	/* and the connections are reclaimed when the table is full */
+	zassert_not_equal(udp_out(INSIDE_PORT + 2), 0U,
+			  "timed out connection not reclaimed");
+	zassert_not_equal(echo_out(ECHO_ID + 2), 0U,
+			  "timed out connection not reclaimed");
+}
+
+static void test_disable(void)
+{
+	u8_t buf[MAX_PKT_LEN];
+	size_t len;
+
+	net_ipv4_nat_disable();
+
+	/* Forwarded as is */
+	len = build_udp(buf, INSIDE_HOST, htons(INSIDE_PORT), REMOTE_HOST,
+			htons(REMOTE_PORT));
+
+	zassert_equal(input(inside_iface, buf, len), NET_OK,
+		      "packet dropped");
+	check_sent(outside_iface, INSIDE_HOST, REMOTE_HOST);
+	zassert_equal(sent_udp_hdr()->src_port, htons(INSIDE_PORT),
+		      "port translated");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(net_ipv4_nat,
+			 ztest_unit_test(test_setup),
+			 ztest_unit_test(test_udp_out),
+			 ztest_unit_test(test_udp_in),
+			 ztest_unit_test(test_udp_no_chksum),
+			 ztest_unit_test(test_icmp_echo),
+			 ztest_unit_test(test_port_exhaustion),
+			 ztest_unit_test(test_mapping_timeout),
+			 ztest_unit_test(test_disable));
+
+	ztest_run_test_suite(net_ipv4_nat);
+}
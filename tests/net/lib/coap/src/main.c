@@ -523,6 +523,98 @@ done:
 	return result;
 }
 
+/* An option of 269 bytes or more has a two bytes extended length, even
+ * when its delta fits in the option header.
+ */
+#define LONG_OPT_LEN 300
+#define LONG_OPT_BUF_SIZE (4 + 3 + LONG_OPT_LEN + 1 + 7)
+
+static int test_option_len_ext_16(void)
+{
+	u8_t opt_hdr[] = { 0xBE, 0x00, LONG_OPT_LEN - 269 };
+	u8_t payload[] = "payload";
+	struct coap_packet cpkt;
+	const u8_t *parsed;
+	u8_t *value = NULL;
+	u8_t *data;
+	int result = TC_FAIL;
+	u16_t len;
+	int r;
+
+	data = (u8_t *)k_malloc(LONG_OPT_BUF_SIZE);
+	if (!data) {
+		goto done;
+	}
+
+	value = (u8_t *)k_malloc(LONG_OPT_LEN);
+	if (!value) {
+		goto done;
+	}
+
+	memset(value, 'v', LONG_OPT_LEN);
+
+	r = coap_packet_init(&cpkt, data, LONG_OPT_BUF_SIZE,
+			     1, COAP_TYPE_CON, 0, NULL,
+			     COAP_METHOD_GET, 0x1234);
+	if (r < 0) {
+		TC_PRINT("Could not initialize packet\n");
+		goto done;
+	}
+
+	r = coap_packet_append_option(&cpkt, COAP_OPTION_URI_PATH,
+				      value, LONG_OPT_LEN);
+	if (r < 0) {
+		TC_PRINT("Could not append option\n");
+		goto done;
+	}
+
+	r = coap_packet_append_payload_marker(&cpkt);
+	if (r < 0) {
+		TC_PRINT("Failed to set the payload marker\n");
+		goto done;
+	}
+
+	r = coap_packet_append_payload(&cpkt, payload, sizeof(payload) - 1);
+	if (r < 0) {
+		TC_PRINT("Failed to append the payload\n");
+		goto done;
+	}
+
+	if (cpkt.offset != LONG_OPT_BUF_SIZE) {
+		TC_PRINT("Wrong packet length %u\n", cpkt.offset);
+		goto done;
+	}
+
+	if (memcmp(cpkt.data + 4, opt_hdr, sizeof(opt_hdr)) ||
+	    memcmp(cpkt.data + 4 + sizeof(opt_hdr), value, LONG_OPT_LEN)) {
+		TC_PRINT("Wrong option encoding\n");
+		goto done;
+	}
+
+	r = coap_packet_parse(&cpkt, data, LONG_OPT_BUF_SIZE, NULL, 0);
+	if (r < 0) {
+		TC_PRINT("Could not parse packet\n");
+		goto done;
+	}
+
+	parsed = coap_packet_get_payload(&cpkt, &len);
+	if (!parsed || len != sizeof(payload) - 1 ||
+	    memcmp(parsed, payload, len)) {
+		TC_PRINT("Wrong payload after the option\n");
+		goto done;
+	}
+
+	result = TC_PASS;
+
+done:
+	k_free(value);
+	k_free(data);
+
+	TC_END_RESULT(result);
+
+	return result;
+}
+
 static int test_match_path_uri(void)
 {
 	int result = TC_FAIL;
@@ -588,6 +680,142 @@ out:
 
 }
 
+static int verify_options(const struct coap_packet *cpkt, int path_count)
+{
+	struct coap_option options[20];
+	int count, i;
+
+	count = coap_find_options(cpkt, COAP_OPTION_URI_PATH, options,
+				  ARRAY_SIZE(options));
+	if (count != path_count) {
+		TC_PRINT("Found %d Uri-Path options, expected %d\n", count,
+			 path_count);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (options[i].len != 2U || options[i].value[0] != 'p' ||
+		    options[i].value[1] != 'a' + i) {
+			TC_PRINT("Invalid Uri-Path option %d\n", i);
+			return -EINVAL;
+		}
+	}
+
+	/* Only as many options as requested are returned */
+	count = coap_find_options(cpkt, COAP_OPTION_URI_PATH, options, 2);
+	if (count != 2) {
+		TC_PRINT("Found %d Uri-Path options, expected 2\n", count);
+		return -EINVAL;
+	}
+
+	count = coap_find_options(cpkt, COAP_OPTION_OBSERVE, options,
+				  ARRAY_SIZE(options));
+	if (count != 1 || coap_option_value_to_int(&options[0]) != 0U) {
+		TC_PRINT("Invalid Observe option\n");
+		return -EINVAL;
+	}
+
+	count = coap_find_options(cpkt, COAP_OPTION_BLOCK2, options,
+				  ARRAY_SIZE(options));
+	if (count != 1 || coap_option_value_to_int(&options[0]) != 0x123U) {
+		TC_PRINT("Invalid Block2 option\n");
+		return -EINVAL;
+	}
+
+	count = coap_find_options(cpkt, COAP_OPTION_ETAG, options,
+				  ARRAY_SIZE(options));
+	if (count != 0) {
+		TC_PRINT("There shouldn't be any ETAG option in the packet\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int find_options(int path_count)
+{
+	struct coap_packet cpkt;
+	struct coap_packet parsed;
+	u8_t *data;
+	u8_t path[2];
+	int result = TC_FAIL;
+	int r, i;
+
+	data = (u8_t *)k_malloc(COAP_BUF_SIZE);
+	if (!data) {
+		goto done;
+	}
+
+	r = coap_packet_init(&cpkt, data, COAP_BUF_SIZE, 1, COAP_TYPE_CON,
+			     0, NULL, COAP_METHOD_GET, coap_next_id());
+	if (r) {
+		TC_PRINT("Could not initialize packet\n");
+		goto done;
+	}
+
+	r = coap_append_option_int(&cpkt, COAP_OPTION_OBSERVE, 0);
+	if (r) {
+		TC_PRINT("Could not append Observe option\n");
+		goto done;
+	}
+
+	for (i = 0; i < path_count; i++) {
+		path[0] = 'p';
+		path[1] = 'a' + i;
+
+		r = coap_packet_append_option(&cpkt, COAP_OPTION_URI_PATH,
+					      path, sizeof(path));
+		if (r) {
+			TC_PRINT("Could not append Uri-Path option\n");
+			goto done;
+		}
+	}
+
+	r = coap_append_option_int(&cpkt, COAP_OPTION_BLOCK2, 0x123);
+	if (r) {
+		TC_PRINT("Could not append Block2 option\n");
+		goto done;
+	}
+
+	if (verify_options(&cpkt, path_count)) {
+		TC_PRINT("Options of the built packet don't match\n");
+		goto done;
+	}
+
+	r = coap_packet_parse(&parsed, data, cpkt.offset, NULL, 0);
+	if (r) {
+		TC_PRINT("Could not parse packet\n");
+		goto done;
+	}
+
+	if (verify_options(&parsed, path_count)) {
+		TC_PRINT("Options of the parsed packet don't match\n");
+		goto done;
+	}
+
+	result = TC_PASS;
+
+done:
+	k_free(data);
+
+	return result;
+}
+
+static int test_find_options(void)
+{
+	int result;
+
+	/* The second packet has more options than the option index */
+	result = find_options(3);
+	if (result == TC_PASS) {
+		result = find_options(16);
+	}
+
+	TC_END_RESULT(result);
+
+	return result;
+}
+
 #define BLOCK_WISE_TRANSFER_SIZE_GET 128
 
 static int prepare_block1_request(struct coap_packet *req,
@@ -1158,6 +1386,281 @@ done:
 	return result;
 }
 
+static int verify_update(struct coap_packet *cpkt, u8_t tkl,
+			 const u8_t *token, u16_t id)
+{
+	const char payload[] = "notification";
+	struct coap_option option;
+	u8_t rsp_token[8];
+	const u8_t *data;
+	u16_t len;
+	int r;
+
+	if (coap_header_get_token(cpkt, rsp_token) != tkl ||
+	    (tkl && memcmp(rsp_token, token, tkl))) {
+		TC_PRINT("Invalid token\n");
+		return -EINVAL;
+	}
+
+	if (coap_header_get_id(cpkt) != id ||
+	    coap_header_get_type(cpkt) != COAP_TYPE_NON_CON ||
+	    coap_header_get_code(cpkt) != COAP_RESPONSE_CODE_CONTENT) {
+		TC_PRINT("Invalid header\n");
+		return -EINVAL;
+	}
+
+	r = coap_find_options(cpkt, COAP_OPTION_OBSERVE, &option, 1);
+	if (r != 1 || coap_option_value_to_int(&option) != 7) {
+		TC_PRINT("Invalid observe option\n");
+		return -EINVAL;
+	}
+
+	data = coap_packet_get_payload(cpkt, &len);
+	if (!data || len != sizeof(payload) - 1 ||
+	    memcmp(data, payload, len)) {
+		TC_PRINT("Invalid payload\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int test_update_header(void)
+{
+	const char payload[] = "notification";
+	const u8_t short_token[] = { 0x01, 0x02 };
+	const u8_t long_token[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	struct coap_packet cpkt;
+	struct coap_packet parsed;
+	u8_t data[COAP_BUF_SIZE];
+	int result = TC_FAIL;
+	int r;
+
+	r = coap_packet_init(&cpkt, data, sizeof(data), 1, COAP_TYPE_NON_CON,
+			     sizeof(short_token), short_token,
+			     COAP_RESPONSE_CODE_CONTENT, 0x1234);
+	if (r < 0) {
+		TC_PRINT("Could not initialize packet\n");
+		goto done;
+	}
+
+	r = coap_append_option_int(&cpkt, COAP_OPTION_OBSERVE, 7);
+	r |= coap_packet_append_payload_marker(&cpkt);
+	r |= coap_packet_append_payload(&cpkt, (u8_t *)payload,
+					sizeof(payload) - 1);
+	if (r < 0) {
+		TC_PRINT("Could not build packet\n");
+		goto done;
+	}
+
+	/* Grow the token, the options and payload move forward */
+	r = coap_packet_update_header(&cpkt, COAP_TYPE_NON_CON,
+				      sizeof(long_token), long_token, 0x4321);
+	if (r < 0) {
+		TC_PRINT("Could not grow the token\n");
+		goto done;
+	}
+
+	r = coap_packet_parse(&parsed, data, cpkt.offset, NULL, 0);
+	if (r < 0 || verify_update(&parsed, sizeof(long_token), long_token,
+				   0x4321) < 0) {
+		TC_PRINT("Invalid packet with a longer token\n");
+		goto done;
+	}
+
+	/* And shrink it again */
+	r = coap_packet_update_header(&cpkt, COAP_TYPE_NON_CON, 0, NULL,
+				      0x5678);
+	if (r < 0) {
+		TC_PRINT("Could not remove the token\n");
+		goto done;
+	}
+
+	r = coap_packet_parse(&parsed, data, cpkt.offset, NULL, 0);
+	if (r < 0 || verify_update(&parsed, 0, NULL, 0x5678) < 0) {
+		TC_PRINT("Invalid packet without token\n");
+		goto done;
+	}
+
+	result = TC_PASS;
+
+done:
+	TC_END_RESULT(result);
+
+	return result;
+}
+
+/* Notifications seen by notify_send() */
+static struct {
+	struct coap_observer *observer[NUM_OBSERVERS];
+	u16_t id[NUM_OBSERVERS];
+	int count;
+	bool valid;
+} notified;
+
+static int notify_send(struct coap_resource *resource,
+		       struct coap_observer *observer,
+		       const struct coap_packet *cpkt, void *user_data)
+{
+	struct coap_packet parsed;
+	u16_t id;
+	int r;
+
+	if (notified.count == NUM_OBSERVERS) {
+		notified.valid = false;
+		return -ENOMEM;
+	}
+
+	r = coap_packet_parse(&parsed, cpkt->data, cpkt->offset, NULL, 0);
+	if (r < 0) {
+		notified.valid = false;
+		return r;
+	}
+
+	/* The observer's own token, the options and payload unchanged */
+	id = coap_header_get_id(&parsed);
+	if (verify_update(&parsed, observer->tkl, observer->token, id) < 0) {
+		notified.valid = false;
+	}
+
+	notified.observer[notified.count] = observer;
+	notified.id[notified.count] = id;
+	notified.count++;
+
+	return 0;
+}
+
+static int test_notify_packet(void)
+{
+	const char payload[] = "notification";
+	const u8_t tokens[NUM_OBSERVERS][8] = {
+		{ 0x01 },
+		{ 1, 2, 3, 4, 5, 6, 7, 8 },
+		{ 0 },
+	};
+	const u8_t tkls[NUM_OBSERVERS] = { 1, 8, 0 };
+	static struct coap_observer fan_observers[NUM_OBSERVERS];
+	static struct coap_resource resource;
+	struct coap_packet cpkt;
+	u8_t data[COAP_BUF_SIZE];
+	int result = TC_FAIL;
+	int i;
+	int r;
+
+	for (i = 0; i < NUM_OBSERVERS; i++) {
+		memcpy(fan_observers[i].token, tokens[i], tkls[i]);
+		fan_observers[i].tkl = tkls[i];
+		coap_register_observer(&resource, &fan_observers[i]);
+	}
+
+	/* Built once, with a token of another length than the observers */
+	r = coap_packet_init(&cpkt, data, sizeof(data), 1, COAP_TYPE_NON_CON,
+			     2, tokens[1], COAP_RESPONSE_CODE_CONTENT, 0);
+	if (r < 0) {
+		TC_PRINT("Could not initialize packet\n");
+		goto done;
+	}
+
+	r = coap_append_option_int(&cpkt, COAP_OPTION_OBSERVE, 7);
+	r |= coap_packet_append_payload_marker(&cpkt);
+	r |= coap_packet_append_payload(&cpkt, (u8_t *)payload,
+					sizeof(payload) - 1);
+	if (r < 0) {
+		TC_PRINT("Could not build packet\n");
+		goto done;
+	}
+
+	(void)memset(&notified, 0, sizeof(notified));
+	notified.valid = true;
+
+	r = coap_resource_notify_packet(&resource, &cpkt, notify_send, NULL);
+	if (r != NUM_OBSERVERS || notified.count != NUM_OBSERVERS) {
+		TC_PRINT("Not all the observers were notified (%d)\n", r);
+		goto done;
+	}
+
+	if (!notified.valid) {
+		TC_PRINT("Invalid notification\n");
+		goto done;
+	}
+
+	/* Every observer once, each with a message id of its own */
+	for (i = 0; i < NUM_OBSERVERS; i++) {
+		if (notified.observer[i] != &fan_observers[i]) {
+			TC_PRINT("Observer %d not notified\n", i);
+			goto done;
+		}
+
+		if (i > 0 && notified.id[i] == notified.id[i - 1]) {
+			TC_PRINT("Message id reused for observer %d\n", i);
+			goto done;
+		}
+	}
+
+	result = TC_PASS;
+
+done:
+	for (i = 0; i < NUM_OBSERVERS; i++) {
+		coap_remove_observer(&resource, &fan_observers[i]);
+	}
+
+	TC_END_RESULT(result);
+
+	return result;
+}
+
+static int test_pending_next_to_expire(void)
+{
+	struct coap_pending *first = &pendings[0];
+	struct coap_pending *second = &pendings[1];
+	struct coap_packet cpkt;
+	u8_t data[COAP_BUF_SIZE];
+	int result = TC_FAIL;
+	int r;
+
+	r = coap_packet_init(&cpkt, data, sizeof(data), 1, COAP_TYPE_CON,
+			     0, NULL, COAP_METHOD_GET, coap_next_id());
+	if (r < 0) {
+		TC_PRINT("Could not initialize packet\n");
+		goto done;
+	}
+
+	r = coap_pending_init(first, &cpkt, (struct sockaddr *)&dummy_addr);
+	r |= coap_pending_init(second, &cpkt, (struct sockaddr *)&dummy_addr);
+	if (r < 0) {
+		TC_PRINT("Could not initialize pendings\n");
+		goto done;
+	}
+
+	/* The second one is sent later but expires first */
+	first->timeout = 2000;
+	second->timeout = 1000;
+	first->t0 = k_uptime_get_32();
+	k_sleep(K_MSEC(100));
+	second->t0 = k_uptime_get_32();
+
+	if (coap_pending_next_to_expire(pendings, NUM_PENDINGS) != second) {
+		TC_PRINT("The earliest deadline should come first\n");
+		goto done;
+	}
+
+	if (coap_pending_remaining(second) > 1000 ||
+	    coap_pending_remaining(first) > 1900) {
+		TC_PRINT("Invalid remaining time\n");
+		goto done;
+	}
+
+	result = TC_PASS;
+
+done:
+	coap_pending_clear(first);
+	coap_pending_clear(second);
+
+	TC_END_RESULT(result);
+
+	return result;
+}
+
 static bool ipaddr_cmp(const struct sockaddr *a, const struct sockaddr *b)
 {
 	if (a->sa_family != b->sa_family) {
@@ -1470,10 +1973,15 @@ static const struct {
 		test_parse_malformed_opt_len_ext },
 	{ "Parse malformed empty payload with marker",
 		test_parse_malformed_marker, },
+	{ "Two bytes extended option length", test_option_len_ext_16, },
 	{ "Test match path uri", test_match_path_uri, },
+	{ "Test find options", test_find_options, },
 	{ "Test block sized 1 transfer", test_block1_size, },
 	{ "Test block sized 2 transfer", test_block2_size, },
 	{ "Test retransmission", test_retransmit_second_round, },
+	{ "Test pending next to expire", test_pending_next_to_expire, },
+	{ "Test update header", test_update_header, },
+	{ "Test notify packet", test_notify_packet, },
 	{ "Test observer server", test_observer_server, },
 	{ "Test observer client", test_observer_client, },
 };
@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_DNS_RESOLVER_LOG_LEVEL);
+
+#include <zephyr.h>
+#include <ztest.h>
+
+#include <net/socket.h>
+#include <net/dns_resolve.h>
+
+#include "dns_pack.h"
+
+/* The stand-in server resolves CACHED_NAME only */
+#define CACHED_NAME "cached.zephyr.test"
+#define CACHED_QNAME "\x06" "cached" "\x06" "zephyr" "\x04" "test"
+#define MISSING_NAME "missing.zephyr.test"
+
+#define DNS_TIMEOUT K_MSEC(500)
+#define WAIT_TIME K_MSEC(800)
+#define STACK_SIZE (1024 + CONFIG_TEST_EXTRA_STACKSIZE)
+#define THREAD_PRIORITY K_PRIO_COOP(8)
+#define MAX_BUF_SIZE 128
+
+static const u8_t cached_addr[] = { 192, 0, 2, 10 };
+
+static int server_sock;
+static u8_t server_buf[MAX_BUF_SIZE];
+static int queries_received;
+static u32_t answer_ttl;
+static K_SEM_DEFINE(query_sem, 0, UINT_MAX);
+
+static int resolve_status;
+static int resolve_count;
+static struct in_addr resolve_addr;
+static K_SEM_DEFINE(resolve_sem, 0, 1);
+
+/* Answer the A query of CACHED_NAME, all other names do not exist */
+static int dns_answer(u8_t *buf, int len)
+{
+	static const u8_t answer[] = {
+		0xc0, 0x0c,		/* Pointer to the query name */
+		0x00, 0x01,		/* A */
+		0x00, 0x01,		/* IN */
+	};
+	bool found;
+
+	if (len < DNS_MSG_HEADER_SIZE + sizeof(CACHED_QNAME) + 4 ||
+	    len + sizeof(answer) + 4 + 2 + sizeof(cached_addr) >
+	    MAX_BUF_SIZE) {
+		return -EINVAL;
+	}
+
+	found = !memcmp(buf + DNS_MSG_HEADER_SIZE, CACHED_QNAME,
+			sizeof(CACHED_QNAME));
+
+	/* Response, recursion desired and available */
+	buf[2] = 0x81;
+	buf[3] = found ? 0x80 : 0x80 | DNS_HEADER_NAMEERROR;
+	sys_put_be16(found ? 1 : 0, buf + 6);
+
+	if (!found) {
+		return len;
+	}
+
+	memcpy(buf + len, answer, sizeof(answer));
+	len += sizeof(answer);
+	sys_put_be32(answer_ttl, buf + len);
+	len += 4;
+	sys_put_be16(sizeof(cached_addr), buf + len);
+	len += 2;
+	memcpy(buf + len, cached_addr, sizeof(cached_addr));
+	len += sizeof(cached_addr);
+
+	return len;
+}
+
+static void dns_server(void)
+{
+	struct sockaddr addr;
+	socklen_t addr_len;
+	int len;
+
+	while (true) {
+		addr_len = sizeof(addr);
+		len = recvfrom(server_sock, server_buf, sizeof(server_buf), 0,
+			       &addr, &addr_len);
+		if (len < 0) {
+			continue;
+		}
+
+		queries_received++;
+
+		len = dns_answer(server_buf, len);
+		if (len > 0) {
+			(void)sendto(server_sock, server_buf, len, 0, &addr,
+				     addr_len);
+		}
+
+		k_sem_give(&query_sem);
+	}
+}
+
+K_THREAD_DEFINE(dns_server_thread_id, STACK_SIZE,
+		dns_server, NULL, NULL, NULL,
+		THREAD_PRIORITY, 0, K_FOREVER);
+
+static void resolve_cb(enum dns_resolve_status status,
+		       struct dns_addrinfo *info,
+		       void *user_data)
+{
+	if (status == DNS_EAI_INPROGRESS && info) {
+		resolve_addr = net_sin(&info->ai_addr)->sin_addr;
+		resolve_count++;
+		return;
+	}
+
+	resolve_status = status;
+	k_sem_give(&resolve_sem);
+}
+
+static int resolve(const char *name)
+{
+	int ret;
+
+	resolve_status = 0;
+	resolve_count = 0;
+	(void)memset(&resolve_addr, 0, sizeof(resolve_addr));
+
+	ret = dns_get_addr_info(name, DNS_QUERY_TYPE_A, NULL, resolve_cb,
+				NULL, DNS_TIMEOUT);
+	zassert_equal(ret, 0, "cannot resolve %s (%d)", name, ret);
+
+	zassert_equal(k_sem_take(&resolve_sem, WAIT_TIME), 0,
+		      "no result for %s", name);
+
+	return resolve_status;
+}
+
+static void check_cached_addr(void)
+{
+	zassert_equal(resolve_count, 1, "wrong number of addresses");
+	zassert_mem_equal(&resolve_addr, cached_addr, sizeof(cached_addr),
+			  "wrong address");
+}
+
+static void test_dns_cache_setup(void)
+{
+	struct sockaddr addr;
+	int ret;
+
+	ret = net_ipaddr_parse(CONFIG_DNS_SERVER1,
+			       sizeof(CONFIG_DNS_SERVER1) - 1, &addr);
+	zassert_true(ret, "cannot parse %s", CONFIG_DNS_SERVER1);
+
+	server_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(server_sock >= 0, "cannot create socket");
+
+	ret = bind(server_sock, &addr, sizeof(struct sockaddr_in));
+	zassert_equal(ret, 0, "cannot bind server socket");
+
+	k_thread_start(dns_server_thread_id);
+
+	k_yield();
+}
+
+static void test_dns_cache_hit(void)
+{
+	queries_received = 0;
+	answer_ttl = 60U;
+
+	zassert_equal(resolve(CACHED_NAME), DNS_EAI_ALLDONE, "query failed");
+	check_cached_addr();
+	zassert_equal(queries_received, 1, "query not sent");
+
+	/* Names are not case sensitive */
+	zassert_equal(resolve("Cached.Zephyr.Test"), DNS_EAI_ALLDONE,
+		      "cached query failed");
+	check_cached_addr();
+	zassert_equal(queries_received, 1, "answer not cached");
+}
+
+static void test_dns_cache_negative(void)
+{
+	queries_received = 0;
+
+	zassert_equal(resolve(MISSING_NAME), DNS_EAI_NONAME, "name found");
+	zassert_equal(queries_received, 1, "query not sent");
+
+	zassert_equal(resolve(MISSING_NAME), DNS_EAI_NONAME, "name found");
+	zassert_equal(resolve_count, 0, "addresses for a negative answer");
+	zassert_equal(queries_received, 1, "negative answer not cached");
+}
+
+static void cache_cb(const struct dns_cache_info *info, void *user_data)
+{
+	int *count = user_data;
+
+	if (!strcmp(info->name, CACHED_NAME)) {
+		zassert_equal(info->count, 1, "wrong number of addresses");
+		zassert_true(info->ttl <= 60U, "TTL too long");
+		(*count)++;
+	} else if (!strcmp(info->name, MISSING_NAME)) {
+		zassert_equal(info->count, 0,
+			      "negative answer has addresses");
+		zassert_equal(info->status, DNS_EAI_NONAME, "wrong status");
+		(*count)++;
+	}
+}
+
+static void test_dns_cache_foreach(void)
+{
+	int count = 0;
+
+	dns_cache_foreach(cache_cb, &count);
+
+	zassert_equal(count, 2, "cached answers not found");
+}
+
+static void test_dns_cache_flush(void)
+{
+	int count = 0;
+
+	queries_received = 0;
+
+	dns_cache_flush();
+
+	dns_cache_foreach(cache_cb, &count);
+	zassert_equal(count, 0, "cache not flushed");
+
+	zassert_equal(resolve(CACHED_NAME), DNS_EAI_ALLDONE, "query failed");
+	zassert_equal(queries_received, 1, "answer not flushed");
+}
+
+static void test_dns_cache_expire(void)
+{
+	dns_cache_flush();
+
+	queries_received = 0;
+	answer_ttl = 1U;
+
+	zassert_equal(resolve(CACHED_NAME), DNS_EAI_ALLDONE, "query failed");
+	zassert_equal(queries_received, 1, "query not sent");
+
+	k_sleep(K_MSEC(1100));
+
+	zassert_equal(resolve(CACHED_NAME), DNS_EAI_ALLDONE, "query failed");
+	check_cached_addr();
+	zassert_equal(queries_received, 2, "expired answer used");
+}
+
+static void test_dns_cache_prefetch(void)
+{
+	dns_cache_flush();
+	k_sem_reset(&query_sem);
+
+	queries_received = 0;
+	answer_ttl = 4U;
+
+	zassert_equal(resolve(CACHED_NAME), DNS_EAI_ALLDONE, "query failed");
+	zassert_equal(k_sem_take(&query_sem, WAIT_TIME), 0, "no query");
+
+	/* Less than half of the TTL is left, the answer is still used but
+	 * it is refreshed in the background.
+	 */
+	k_sleep(K_MSEC(2900));
+
+	zassert_equal(resolve(CACHED_NAME), DNS_EAI_ALLDONE, "query failed");
+	check_cached_addr();
+	zassert_equal(k_sem_take(&query_sem, WAIT_TIME), 0, "no prefetch");
+	zassert_equal(queries_received, 2, "wrong number of queries");
+
+	/* The first answer has expired now, the refreshed one is used and
+	 * it has more than half of its TTL left.
+	 */
+	k_sleep(K_MSEC(1300));
+
+	zassert_equal(resolve(CACHED_NAME), DNS_EAI_ALLDONE, "query failed");
+	check_cached_addr();
+	zassert_equal(queries_received, 2, "refreshed answer not used");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(dns_cache,
+			 ztest_unit_test(test_dns_cache_setup),
+			 ztest_unit_test(test_dns_cache_hit),
+			 ztest_unit_test(test_dns_cache_negative),
+			 ztest_unit_test(test_dns_cache_foreach),
+			 ztest_unit_test(test_dns_cache_flush),
+			 ztest_unit_test(test_dns_cache_expire),
+			 ztest_unit_test(test_dns_cache_prefetch));
+
+	ztest_run_test_suite(dns_cache);
+}
@@ -710,7 +710,8 @@ static void dns_query_ipv4_numeric(void)
 				dns_result_numeric_cb,
 				&status,
 				DNS_TIMEOUT);
-	zassert_equal(ret, 0, "Cannot create IPv4 numeric query");
+	zassert_equal(ret, DNS_RESOLVE_DONE,
+		      "Cannot create IPv4 numeric query");
 
 	DBG("Query id %u\n", current_dns_id);
 
@@ -721,6 +722,33 @@ static void dns_query_ipv4_numeric(void)
 	}
 }
 
+/* A numeric address is answered at once, without a query to cancel */
+static void dns_query_ipv4_numeric_done(void)
+{
+	struct expected_addr_status status = {
+		.status1 = DNS_EAI_INPROGRESS,
+		.status2 = DNS_EAI_ALLDONE,
+		.caller = __func__,
+	};
+	u16_t dns_id = 0xffff;
+	int ret;
+
+	timeout_query = false;
+	k_sem_reset(&wait_data2);
+
+	ret = dns_get_addr_info(NAME_IPV4,
+				DNS_QUERY_TYPE_A,
+				&dns_id,
+				dns_result_numeric_cb,
+				&status,
+				DNS_TIMEOUT);
+	zassert_equal(ret, DNS_RESOLVE_DONE,
+		      "Numeric address not reported as done (%d)", ret);
+	zassert_equal(dns_id, 0xffff, "Query id set without a query");
+	zassert_equal(k_sem_take(&wait_data2, K_NO_WAIT), 0,
+		      "Callback not called before returning");
+}
+
 #if defined(TEMPORARILY_DISABLED_TEST)
 static void dns_query_ipv6_numeric(void)
 {
@@ -739,7 +767,7 @@ static void dns_query_ipv6_numeric(void)
 				dns_result_numeric_cb,
 				&status,
 				DNS_TIMEOUT);
-	zassert_equal(ret, 0, "Cannot create IPv6 query");
+	zassert_equal(ret, DNS_RESOLVE_DONE, "Cannot create IPv6 query");
 
 	DBG("Query id %u\n", current_dns_id);
 
@@ -768,7 +796,8 @@ void test_main(void)
 			 ztest_unit_test(dns_query_ipv4_cancel),
 			 ztest_unit_test(dns_query_ipv6_cancel),
 			 ztest_unit_test(dns_query_ipv4),
-			 ztest_unit_test(dns_query_ipv4_numeric));
+			 ztest_unit_test(dns_query_ipv4_numeric),
+			 ztest_unit_test(dns_query_ipv4_numeric_done));
 
 	ztest_run_test_suite(dns_tests);
 }
@@ -0,0 +1,494 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_HTTP_LOG_LEVEL);
+
+#include <ztest.h>
+#include <string.h>
+
+#include <net/socket.h>
+#include <net/http_client.h>
+
+#define SERVER_PORT 8080
+#define TIMEOUT K_SECONDS(2)
+
+/* Requests received within this time are answered together */
+#define BATCH_MS 50
+
+#define SERVER_STACK_SIZE 2048
+#define SERVER_PRIORITY K_PRIO_PREEMPT(8)
+
+static struct sockaddr_in server_addr;
+static int listen_sock = -1;
+
+/* Updated by the server thread */
+static int accepted;
+static int served;
+static bool drop_next;
+static bool close_after;
+static char last_req[256];
+
+static char in_buf[512];
+static char out_buf[512];
+
+static K_THREAD_STACK_DEFINE(server_stack, SERVER_STACK_SIZE);
+static struct k_thread server_thread;
+
+static struct http_client_session session;
+
+static u8_t recv_bufs[3][256];
+static char bodies[3][32];
+static size_t body_lens[3];
+static size_t data_lens[3];
+static struct http_request reqs[3];
+
+static const char *const chunks[] = { "hello", " world" };
+static int chunk_idx;
+
+static int format_reply(const char *path, char *out, size_t size)
+{
+	if (!strcmp(path, "/busy")) {
+		return snprintk(out, size, "HTTP/1.1 503 Service Unavailable"
+				"\r\nContent-Length: 0\r\n\r\n");
+	}
+
+	if (!strcmp(path, "/truncated")) {
+		/* The connection is closed in the middle of the body */
+		close_after = true;
+		return snprintk(out, size, "HTTP/1.1 200 OK\r\n"
+				"Content-Length: 10\r\n\r\nbody");
+	}
+
+	if (!strcmp(path, "/silent")) {
+		return 0;
+	}
+
+	if (!strcmp(path, "/chunked")) {
+		return snprintk(out, size, "HTTP/1.1 200 OK\r\n"
+				"Transfer-Encoding: chunked\r\n\r\n"
+				"4\r\nbody\r\n5\r\n part\r\n0\r\n\r\n");
+	}
+
+	/* The body tells which request the response is for */
+	return snprintk(out, size, "HTTP/1.1 200 OK\r\nContent-Length: %zd"
+			"\r\n\r\n%s", strlen(path), path);
+}
+
+/* Length of the first complete request in the buffer, 0 if none */
+static size_t request_len(const char *buf)
+{
+	const char *chunked;
+	const char *end;
+
+	end = strstr(buf, "\r\n\r\n");
+	if (!end) {
+		return 0;
+	}
+
+	end += 4;
+
+	chunked = strstr(buf, "Transfer-Encoding: chunked");
+	if (chunked && chunked < end) {
+		/* The last chunk follows the CRLF ending the headers or
+		 * the previous chunk.
+		 */
+		end = strstr(end - 2, "\r\n0\r\n\r\n");
+		if (!end) {
+			return 0;
+		}
+
+		end += strlen("\r\n0\r\n\r\n");
+	}
+
+	return end - buf;
+}
+
+static int server_answer(const char *req, char *out, size_t size)
+{
+	char path[16];
+	const char *start, *end;
+
+	if (drop_next) {
+		drop_next = false;
+		return -1;
+	}
+
+	start = strchr(req, ' ') + 1;
+	end = strchr(start, ' ');
+	zassert_true(end - start < sizeof(path), "path too long");
+
+	memcpy(path, start, end - start);
+	path[end - start] = '\0';
+
+	return format_reply(path, out, size);
+}
+
+static void server_conn(int sock)
+{
+	struct pollfd pfd = {
+		.fd = sock,
+		.events = POLLIN,
+	};
+	size_t in_len = 0;
+	size_t out_len;
+	ssize_t ret;
+	size_t len;
+
+	while (true) {
+		ret = recv(sock, in_buf + in_len, sizeof(in_buf) - 1 - in_len,
+			   0);
+		if (ret <= 0) {
+			break;
+		}
+
+		in_len += ret;
+
+		if (poll(&pfd, 1, BATCH_MS) > 0) {
+			continue;
+		}
+
+		in_buf[in_len] = '\0';
+		out_len = 0;
+
+		while ((len = request_len(in_buf)) > 0) {
+			size_t copy = MIN(len, sizeof(last_req) - 1);
+
+			memcpy(last_req, in_buf, copy);
+			last_req[copy] = '\0';
+			served++;
+
+			ret = server_answer(in_buf, out_buf + out_len,
+					    sizeof(out_buf) - out_len);
+
+			memmove(in_buf, in_buf + len, in_len - len + 1);
+			in_len -= len;
+
+			if (ret < 0) {
+				/* As a server closing an idle connection */
+				(void)close(sock);
+				return;
+			}
+
+			out_len += ret;
+		}
+
+		if (out_len) {
+			ret = send(sock, out_buf, out_len, 0);
+			zassert_equal(ret, out_len, "send failed");
+		}
+
+		if (close_after) {
+			close_after = false;
+			break;
+		}
+	}
+
+	(void)close(sock);
+}
+
+static void server_fn(void *p1, void *p2, void *p3)
+{
+	int sock;
+
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	while (true) {
+		sock = accept(listen_sock, NULL, NULL);
+		if (sock < 0) {
+			return;
+		}
+
+		accepted++;
+		server_conn(sock);
+	}
+}
+
+static int req_index(struct http_request *req)
+{
+	int i = req - reqs;
+
+	zassert_true(i >= 0 && i < ARRAY_SIZE(reqs), "unknown request");
+
+	return i;
+}
+
+static void response_cb(struct http_response *rsp,
+			enum http_final_call final_data, void *user_data)
+{
+	struct http_request *req = CONTAINER_OF(rsp, struct http_request,
+						internal.response);
+
+	data_lens[req_index(req)] += rsp->data_len;
+}
+
+static int body_cb(struct http_request *req, const u8_t *data, size_t len,
+		   void *user_data)
+{
+	int i = req_index(req);
+
+	zassert_true(body_lens[i] + len < sizeof(bodies[i]), "body too long");
+
+	memcpy(&bodies[i][body_lens[i]], data, len);
+	body_lens[i] += len;
+
+	return 0;
+}
+
+static int chunk_cb(struct http_request *req, const u8_t **data,
+		    void *user_data)
+{
+	if (chunk_idx == ARRAY_SIZE(chunks)) {
+		return 0;
+	}
+
+	*data = (const u8_t *)chunks[chunk_idx];
+
+	return strlen(chunks[chunk_idx++]);
+}
+
+static struct http_request *req_init(int i, enum http_method method,
+				     const char *url, bool use_body_cb)
+{
+	struct http_request *req = &reqs[i];
+
+	memset(req, 0, sizeof(*req));
+	memset(bodies[i], 0, sizeof(bodies[i]));
+	body_lens[i] = 0;
+	data_lens[i] = 0;
+
+	req->method = method;
+	req->url = url;
+	req->host = CONFIG_NET_CONFIG_MY_IPV4_ADDR;
+	req->protocol = "HTTP/1.1";
+	req->response = response_cb;
+	req->recv_buf = recv_bufs[i];
+	req->recv_buf_len = sizeof(recv_bufs[i]);
+
+	if (use_body_cb) {
+		req->body_cb = body_cb;
+	}
+
+	return req;
+}
+
+static void check_body(int i, const char *body)
+{
+	zassert_equal(reqs[i].internal.parser.status_code, 200,
+		      "wrong status");
+	zassert_equal(body_lens[i], strlen(body), "wrong body length");
+	zassert_mem_equal(bodies[i], body, body_lens[i], "wrong body");
+}
+
+static void test_setup(void)
+{
+	int ret;
+
+	server_addr.sin_family = AF_INET;
+	server_addr.sin_port = htons(SERVER_PORT);
+	inet_pton(AF_INET, CONFIG_NET_CONFIG_MY_IPV4_ADDR,
+		  &server_addr.sin_addr);
+
+	listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(listen_sock >= 0, "socket failed");
+
+	ret = bind(listen_sock, (struct sockaddr *)&server_addr,
+		   sizeof(server_addr));
+	zassert_equal(ret, 0, "bind failed");
+	zassert_equal(listen(listen_sock, 1), 0, "listen failed");
+
+	k_thread_create(&server_thread, server_stack,
+			K_THREAD_STACK_SIZEOF(server_stack), server_fn,
+			NULL, NULL, NULL, SERVER_PRIORITY, 0, K_NO_WAIT);
+
+	ret = http_client_session_init(&session,
+				       (struct sockaddr *)&server_addr,
+				       sizeof(server_addr), IPPROTO_TCP);
+	zassert_equal(ret, 0, "session init failed");
+}
+
+static void test_session_reuse(void)
+{
+	int conns = accepted;
+	int ret;
+
+	ret = http_client_session_req(&session,
+				      req_init(0, HTTP_GET, "/one", true),
+				      TIMEOUT, NULL);
+	zassert_true(ret > 0, "first request failed (%d)", ret);
+	check_body(0, "/one");
+
+	ret = http_client_session_req(&session,
+				      req_init(1, HTTP_GET, "/two", true),
+				      TIMEOUT, NULL);
+	zassert_true(ret > 0, "second request failed (%d)", ret);
+	check_body(1, "/two");
+
+	zassert_equal(accepted, conns + 1, "connection not reused");
+}
+
+static void test_body_cb(void)
+{
+	int ret;
+
+	/* The chunk framing is not given to the callback */
+	ret = http_client_session_req(&session,
+				      req_init(0, HTTP_GET, "/chunked", true),
+				      TIMEOUT, NULL);
+	zassert_true(ret > 0, "request failed (%d)", ret);
+	check_body(0, "body part");
+}
+
+static void test_chunked_upload(void)
+{
+	static const char body[] = "Transfer-Encoding: chunked\r\n\r\n"
+		"5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n";
+	struct http_request *req;
+	size_t len;
+	int ret;
+
+	req = req_init(0, HTTP_POST, "/upload", true);
+	req->chunk_cb = chunk_cb;
+	chunk_idx = 0;
+
+	ret = http_client_session_req(&session, req, TIMEOUT, NULL);
+	zassert_true(ret > 0, "request failed (%d)", ret);
+	check_body(0, "/upload");
+
+	len = strlen(last_req);
+	zassert_true(len > sizeof(body) - 1, "request too short");
+	zassert_mem_equal(last_req + len - (sizeof(body) - 1), body,
+			  sizeof(body) - 1, "wrong chunked body");
+}
+
+static void test_retry(void)
+{
+	int conns = accepted;
+	int requests;
+	int ret;
+
+	/* Make sure that the next request goes on an idle connection */
+	ret = http_client_session_req(&session,
+				      req_init(0, HTTP_GET, "/a", true),
+				      TIMEOUT, NULL);
+	zassert_true(ret > 0, "request failed (%d)", ret);
+
+	/* An idempotent request on a connection the server closed is sent
+	 * again on a new connection.
+	 */
+	drop_next = true;
+	ret = http_client_session_req(&session,
+				      req_init(0, HTTP_GET, "/b", true),
+				      TIMEOUT, NULL);
+	zassert_true(ret > 0, "request not retried (%d)", ret);
+	check_body(0, "/b");
+	zassert_equal(accepted, conns + 1, "no new connection");
+
+	/* Other requests may have had effects, they are not retried */
+	drop_next = true;
+	requests = served;
+	ret = http_client_session_req(&session,
+				      req_init(0, HTTP_POST, "/c", true),
+				      TIMEOUT, NULL);
+	zassert_equal(ret, -ECONNRESET, "wrong error (%d)", ret);
+	zassert_equal(served, requests + 1, "request retried");
+
+	/* Neither is a request that got a response */
+	requests = served;
+	ret = http_client_session_req(&session,
+				      req_init(0, HTTP_GET, "/busy", true),
+				      TIMEOUT, NULL);
+	zassert_true(ret > 0, "request failed (%d)", ret);
+	zassert_equal(reqs[0].internal.parser.status_code, 503,
+		      "wrong status");
+	zassert_equal(served, requests + 1, "request retried");
+}
+
+static int connect_server(void)
+{
+	int sock, ret;
+
+	sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(sock >= 0, "socket failed");
+
+	ret = connect(sock, (struct sockaddr *)&server_addr,
+		      sizeof(server_addr));
+	zassert_equal(ret, 0, "connect failed");
+
+	return sock;
+}
+
+static void test_incomplete_response(void)
+{
+	int sock, ret;
+
+	/* The server handles one connection at a time */
+	http_client_session_close(&session);
+
+	sock = connect_server();
+	ret = http_client_req(sock, req_init(0, HTTP_GET, "/truncated", true),
+			      TIMEOUT, NULL);
+	zassert_equal(ret, -ECONNRESET, "wrong error (%d)", ret);
+	zassert_equal(close(sock), 0, "close failed");
+
+	/* The socket is closed by the timeout, and it is closed before
+	 * the request returns.
+	 */
+	sock = connect_server();
+	ret = http_client_req(sock, req_init(0, HTTP_GET, "/silent", true),
+			      K_MSEC(200), NULL);
+	zassert_equal(ret, -ETIMEDOUT, "wrong error (%d)", ret);
+	zassert_true(reqs[0].internal.sock < 0, "socket not closed");
+	zassert_not_equal(close(sock), 0, "socket still open");
+}
+
+static void test_pipeline(void)
+{
+	struct http_request *batch[3];
+	char reply[128];
+	int sock, ret;
+
+	sock = connect_server();
+
+	/* The server answers them in one go, so that each response
+	 * begins in the data received for the previous one.
+	 */
+	batch[0] = req_init(0, HTTP_GET, "/p1", false);
+	batch[1] = req_init(1, HTTP_GET, "/chunked", true);
+	batch[2] = req_init(2, HTTP_GET, "/p3", false);
+
+	ret = http_client_req_pipeline(sock, batch, ARRAY_SIZE(batch),
+				       TIMEOUT, NULL);
+	zassert_equal(ret, ARRAY_SIZE(batch), "responses missing (%d)", ret);
+
+	check_body(1, "body part");
+
+	/* Only the bytes of its own response are counted for each */
+	zassert_equal(data_lens[0], format_reply("/p1", reply, sizeof(reply)),
+		      "wrong length of the first response");
+	zassert_equal(data_lens[2], format_reply("/p3", reply, sizeof(reply)),
+		      "wrong length of the last response");
+	zassert_equal(reqs[2].internal.parser.status_code, 200,
+		      "wrong status");
+
+	zassert_equal(close(sock), 0, "close failed");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(http_client,
+			 ztest_unit_test(test_setup),
+			 ztest_unit_test(test_session_reuse),
+			 ztest_unit_test(test_body_cb),
+			 ztest_unit_test(test_chunked_upload),
+			 ztest_unit_test(test_retry),
+			 ztest_unit_test(test_incomplete_response),
+			 ztest_unit_test(test_pipeline));
+
+	ztest_run_test_suite(http_client);
+}
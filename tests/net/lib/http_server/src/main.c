@@ -0,0 +1,536 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_HTTP_LOG_LEVEL);
+
+#include <ztest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <net/socket.h>
+#include <net/http_server.h>
+
+/* The server runs in its own thread and is queried over the loopback
+ * interface with plain sockets, so that the exact bytes on the wire are
+ * checked.
+ */
+#define SERVER_PORT 8080
+#define STACK_SIZE 3072
+#define THREAD_PRIORITY K_PRIO_PREEMPT(8)
+#define TIMEOUT_MS 2000
+
+/* Larger than CONFIG_HTTP_SERVER_CLIENT_TX_BUFFER_SIZE, so that it is
+ * sent from the queue of the connection.
+ */
+#define LARGE_LEN 8192
+
+#define WS_KEY "dGhlIHNhbXBsZSBub25jZQ=="
+#define WS_ACCEPT "s3pPLMBiTxaQ9kYGzzhZRbK+xOo="
+
+static struct sockaddr_in server_addr = {
+	.sin_family = AF_INET,
+	.sin_port = htons(SERVER_PORT),
+	.sin_addr = { { { 127, 0, 0, 1 } } },
+};
+
+/* Connection of the test, with the data received but not parsed yet */
+struct conn {
+	int sock;
+	size_t len;
+	size_t consumed;
+	char buf[LARGE_LEN + 1024];
+};
+
+/* A response received on a connection */
+struct response {
+	int status;
+	bool close;
+	bool has_length;
+	const char *body;
+	size_t body_len;
+};
+
+static const char small_data[] = "hello";
+static u8_t large_data[LARGE_LEN];
+
+static struct http_server_ctx server;
+static struct conn conns[2];
+
+static int ws_sock = -1;
+static K_SEM_DEFINE(ws_sem, 0, 1);
+
+static int echo_cb(const struct http_server_request *req, void *user_data)
+{
+	int ret;
+
+	ret = http_server_response_begin(req->client, 200, "text/plain",
+					 req->body_len);
+	if (ret < 0) {
+		return ret;
+	}
+
+	return http_server_response_write(req->client, req->body,
+					  req->body_len);
+}
+
+/* Handled without a response, so the server answers 204 */
+static int no_content_cb(const struct http_server_request *req,
+			 void *user_data)
+{
+	return 0;
+}
+
+static int ws_cb(int sock, const struct http_server_request *req,
+		 void *user_data)
+{
+	ws_sock = sock;
+	k_sem_give(&ws_sem);
+
+	return 0;
+}
+
+static const struct http_server_resource resources[] = {
+	{
+		.path = "/small",
+		.type = HTTP_SERVER_RESOURCE_STATIC,
+		.content_type = "text/plain",
+		.data = (const u8_t *)small_data,
+		.data_len = sizeof(small_data) - 1,
+	},
+	{
+		.path = "/large",
+		.type = HTTP_SERVER_RESOURCE_STATIC,
+		.content_type = "application/octet-stream",
+		.data = large_data,
+		.data_len = sizeof(large_data),
+	},
+	{
+		.path = "/echo",
+		.type = HTTP_SERVER_RESOURCE_DYNAMIC,
+		.cb = echo_cb,
+	},
+	{
+		.path = "/nocontent",
+		.type = HTTP_SERVER_RESOURCE_DYNAMIC,
+		.cb = no_content_cb,
+	},
+	{
+		.path = "/ws",
+		.type = HTTP_SERVER_RESOURCE_WEBSOCKET,
+		.ws_cb = ws_cb,
+	},
+};
+
+static void server_thread(void)
+{
+	int ret;
+
+	ret = http_server_run(&server);
+
+	NET_ERR("HTTP server stopped (%d)", ret);
+}
+
+K_THREAD_DEFINE(server_thread_id, STACK_SIZE,
+		server_thread, NULL, NULL, NULL,
+		THREAD_PRIORITY, 0, K_FOREVER);
+
+static void conn_open(struct conn *conn)
+{
+	conn->len = 0;
+	conn->consumed = 0;
+	conn->sock = zsock_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(conn->sock >= 0, "socket failed");
+	zassert_equal(zsock_connect(conn->sock,
+				    (struct sockaddr *)&server_addr,
+				    sizeof(server_addr)), 0, "connect failed");
+}
+
+static void conn_close(struct conn *conn)
+{
+	(void)zsock_close(conn->sock);
+	conn->sock = -1;
+}
+
+static void conn_send(struct conn *conn, const char *data, size_t len)
+{
+	ssize_t ret;
+
+	while (len) {
+		ret = zsock_send(conn->sock, data, len, 0);
+		zassert_true(ret > 0, "send failed");
+
+		data += ret;
+		len -= ret;
+	}
+}
+
+static void conn_send_str(struct conn *conn, const char *str)
+{
+	conn_send(conn, str, strlen(str));
+}
+
+/* Receive more data on the connection. Returns 0 when the server closed
+ * it, -EAGAIN if nothing came in time.
+ */
+static ssize_t conn_recv(struct conn *conn)
+{
+	struct zsock_pollfd pfd = {
+		.fd = conn->sock,
+		.events = ZSOCK_POLLIN,
+	};
+	ssize_t ret;
+
+	/* Room is kept for a NUL after the data */
+	zassert_true(conn->len < sizeof(conn->buf) - 1, "receive buffer full");
+
+	ret = zsock_poll(&pfd, 1, TIMEOUT_MS);
+	zassert_true(ret >= 0, "poll failed");
+	if (ret == 0) {
+		return -EAGAIN;
+	}
+
+	ret = zsock_recv(conn->sock, conn->buf + conn->len,
+			 sizeof(conn->buf) - conn->len - 1, 0);
+	zassert_true(ret >= 0, "recv failed");
+
+	conn->len += ret;
+
+	return ret;
+}
+
+static const char *find_header(const char *headers, size_t len,
+			       const char *name)
+{
+	size_t name_len = strlen(name);
+	const char *end = headers + len;
+	const char *line = headers;
+
+	while (line < end) {
+		if (strncmp(line, name, name_len) == 0) {
+			return line + name_len;
+		}
+
+		line = strstr(line, "\r\n");
+		if (!line) {
+			break;
+		}
+
+		line += 2;
+	}
+
+	return NULL;
+}
+
+/* Receive a response with a Content-Length framed body. The response is
+ * removed from the connection buffer when the next one is received.
+ */
+static void conn_response(struct conn *conn, struct response *rsp)
+{
+	const char *end, *value;
+	size_t header_len;
+	char *buf;
+
+	if (conn->consumed) {
+		conn->len -= conn->consumed;
+		memmove(conn->buf, conn->buf + conn->consumed, conn->len);
+		conn->consumed = 0;
+	}
+
+	buf = conn->buf;
+
+	while (true) {
+		buf[conn->len] = '\0';
+		end = strstr(buf, "\r\n\r\n");
+		if (end) {
+			break;
+		}
+
+		zassert_true(conn_recv(conn) > 0, "no response");
+	}
+
+	header_len = end + 4 - buf;
+
+	zassert_equal(sscanf(buf, "HTTP/1.1 %d", &rsp->status), 1,
+		      "invalid status line");
+
+	rsp->close = find_header(buf, header_len, "Connection: close") != NULL;
+
+	value = find_header(buf, header_len, "Content-Length: ");
+	rsp->has_length = value != NULL;
+	rsp->body_len = value ? strtoul(value, NULL, 10) : 0;
+
+	while (conn->len < header_len + rsp->body_len) {
+		zassert_true(conn_recv(conn) > 0, "body not complete");
+	}
+
+	rsp->body = buf + header_len;
+	conn->consumed = header_len + rsp->body_len;
+}
+
+static void conn_closed(struct conn *conn)
+{
+	zassert_equal(conn->len, conn->consumed, "data after the response");
+	zassert_equal(conn_recv(conn), 0, "connection not closed");
+}
+
+static void request(const char *req, int status)
+{
+	struct conn *conn = &conns[0];
+	struct response rsp;
+
+	conn_open(conn);
+	conn_send_str(conn, req);
+	conn_response(conn, &rsp);
+
+	zassert_equal(rsp.status, status, "wrong status %d", rsp.status);
+	zassert_true(rsp.close, "connection not closed after an error");
+	conn_closed(conn);
+
+	conn_close(conn);
+}
+
+static void test_setup(void)
+{
+	int i;
+
+	for (i = 0; i < sizeof(large_data); i++) {
+		large_data[i] = i;
+	}
+
+	zassert_equal(http_server_init(&server,
+				       (struct sockaddr *)&server_addr,
+				       sizeof(server_addr), resources,
+				       ARRAY_SIZE(resources)), 0,
+		      "cannot start the server");
+
+	k_thread_start(server_thread_id);
+}
+
+static void test_get(void)
+{
+	struct conn *conn = &conns[0];
+	struct response rsp;
+
+	conn_open(conn);
+	conn_send_str(conn, "GET /small HTTP/1.1\r\nHost: test\r\n\r\n");
+	conn_response(conn, &rsp);
+
+	zassert_equal(rsp.status, 200, "wrong status %d", rsp.status);
+	zassert_false(rsp.close, "connection not kept alive");
+	zassert_equal(rsp.body_len, strlen(small_data), "wrong body length");
+	zassert_mem_equal(rsp.body, small_data, rsp.body_len, "wrong body");
+
+	conn_close(conn);
+}
+
+static void test_no_content(void)
+{
+	struct conn *conn = &conns[0];
+	struct response rsp;
+
+	conn_open(conn);
+	conn_send_str(conn, "GET /nocontent HTTP/1.1\r\nHost: test\r\n\r\n"
+		      "GET /small HTTP/1.1\r\nHost: test\r\n\r\n");
+
+	/* RFC 7230 3.3.2, a 204 response has no Content-Length */
+	conn_response(conn, &rsp);
+	zassert_equal(rsp.status, 204, "wrong status %d", rsp.status);
+	zassert_false(rsp.has_length, "Content-Length in a 204 response");
+	zassert_false(rsp.close, "connection not kept alive");
+
+	/* The connection goes on right after the headers */
+	conn_response(conn, &rsp);
+	zassert_equal(rsp.status, 200, "wrong status %d", rsp.status);
+	zassert_equal(rsp.body_len, strlen(small_data), "wrong body length");
+	zassert_mem_equal(rsp.body, small_data, rsp.body_len, "wrong body");
+
+	conn_close(conn);
+}
+
+static void test_not_found(void)
+{
+	request("GET /missing HTTP/1.1\r\nHost: test\r\n\r\n", 404);
+}
+
+static void test_method_not_allowed(void)
+{
+	request("POST /small HTTP/1.1\r\nHost: test\r\n"
+		"Content-Length: 2\r\n\r\nhi", 405);
+}
+
+static void test_too_large(void)
+{
+	char req[CONFIG_HTTP_SERVER_CLIENT_BUFFER_SIZE + 1];
+	int len;
+
+	/* The request headers do not end before the buffer is full. The
+	 * request fills it exactly, so that no data is left unread when the
+	 * server closes the connection.
+	 */
+	len = snprintf(req, sizeof(req), "GET /small HTTP/1.1\r\nX-Pad: ");
+	memset(req + len, 'a', sizeof(req) - len - 1);
+	req[sizeof(req) - 1] = '\0';
+
+	request(req, 413);
+}
+
+static void test_chunked_body(void)
+{
+	static const char body[] = "hello, chunked world";
+	struct conn *conn = &conns[0];
+	struct response rsp;
+
+	conn_open(conn);
+	conn_send_str(conn, "POST /echo HTTP/1.1\r\nHost: test\r\n"
+		      "Transfer-Encoding: chunked\r\n\r\n"
+		      "5\r\nhello\r\n");
+
+	/* The rest of the body comes later, in several chunks */
+	k_sleep(K_MSEC(50));
+
+	conn_send_str(conn, "8\r\n, chunke\r\n"
+		      "7;ext=1\r\nd world\r\n"
+		      "0\r\n\r\n");
+	conn_response(conn, &rsp);
+
+	zassert_equal(rsp.status, 200, "wrong status %d", rsp.status);
+	zassert_equal(rsp.body_len, strlen(body), "wrong body length");
+	zassert_mem_equal(rsp.body, body, rsp.body_len, "wrong body");
+
+	conn_close(conn);
+}
+
+static void test_pipelined(void)
+{
+	struct conn *conn = &conns[0];
+	struct response rsp;
+
+	conn_open(conn);
+	conn_send_str(conn, "POST /echo HTTP/1.1\r\nHost: test\r\n"
+		      "Content-Length: 5\r\n\r\nfirst"
+		      "GET /large HTTP/1.1\r\nHost: test\r\n\r\n"
+		      "POST /echo HTTP/1.1\r\nHost: test\r\n"
+		      "Content-Length: 6\r\n\r\nsecond");
+
+	conn_response(conn, &rsp);
+	zassert_equal(rsp.status, 200, "wrong status %d", rsp.status);
+	zassert_equal(rsp.body_len, 5, "wrong body length");
+	zassert_mem_equal(rsp.body, "first", 5, "wrong order");
+
+	conn_response(conn, &rsp);
+	zassert_equal(rsp.status, 200, "wrong status %d", rsp.status);
+	zassert_equal(rsp.body_len, sizeof(large_data), "wrong body length");
+	zassert_mem_equal(rsp.body, large_data, rsp.body_len, "wrong body");
+
+	conn_response(conn, &rsp);
+	zassert_equal(rsp.status, 200, "wrong status %d", rsp.status);
+	zassert_equal(rsp.body_len, 6, "wrong body length");
+	zassert_mem_equal(rsp.body, "second", 6, "wrong order");
+
+	conn_close(conn);
+}
+
+static void test_slow_reader(void)
+{
+	struct conn *slow = &conns[0];
+	struct conn *conn = &conns[1];
+	struct response rsp;
+	int i;
+
+	/* A client that does not read its response must not hold up the
+	 * other clients.
+	 */
+	conn_open(slow);
+	conn_send_str(slow, "GET /large HTTP/1.1\r\nHost: test\r\n\r\n"
+		      "GET /large HTTP/1.1\r\nHost: test\r\n\r\n");
+
+	conn_open(conn);
+	conn_send_str(conn, "GET /small HTTP/1.1\r\nHost: test\r\n\r\n");
+	conn_response(conn, &rsp);
+
+	zassert_equal(rsp.status, 200, "wrong status %d", rsp.status);
+	zassert_mem_equal(rsp.body, small_data, rsp.body_len, "wrong body");
+	conn_close(conn);
+
+	/* Both responses are complete once the client reads them */
+	for (i = 0; i < 2; i++) {
+		conn_response(slow, &rsp);
+
+		zassert_equal(rsp.status, 200, "wrong status %d", rsp.status);
+		zassert_equal(rsp.body_len, sizeof(large_data),
+			      "wrong body length");
+		zassert_mem_equal(rsp.body, large_data, rsp.body_len,
+				  "wrong body");
+	}
+
+	conn_close(slow);
+}
+
+static void test_websocket(void)
+{
+	struct conn *conn = &conns[0];
+	struct response rsp;
+	const char *value;
+	char buf[8];
+
+	if (!IS_ENABLED(CONFIG_HTTP_SERVER_WEBSOCKET)) {
+		ztest_test_skip();
+	}
+
+	conn_open(conn);
+	conn_send_str(conn, "GET /ws HTTP/1.1\r\nHost: test\r\n"
+		      "Upgrade: websocket\r\n"
+		      "Connection: Upgrade\r\n"
+		      "Sec-WebSocket-Key: " WS_KEY "\r\n"
+		      "Sec-WebSocket-Version: 13\r\n\r\n");
+	conn_response(conn, &rsp);
+
+	zassert_equal(rsp.status, 101, "wrong status %d", rsp.status);
+
+	value = find_header(conn->buf, rsp.body - conn->buf,
+			    "Sec-WebSocket-Accept: ");
+	zassert_not_null(value, "no Sec-WebSocket-Accept");
+	zassert_mem_equal(value, WS_ACCEPT, strlen(WS_ACCEPT),
+			  "wrong Sec-WebSocket-Accept");
+
+	/* The connection belongs to the websocket resource now */
+	zassert_equal(k_sem_take(&ws_sem, K_MSEC(TIMEOUT_MS)), 0,
+		      "websocket callback not called");
+
+	conn_send_str(conn, "ping");
+	zassert_equal(zsock_recv(ws_sock, buf, sizeof(buf), 0), 4,
+		      "websocket data not received");
+	zassert_mem_equal(buf, "ping", 4, "wrong websocket data");
+
+	zassert_equal(zsock_send(ws_sock, "pong", 4, 0), 4,
+		      "websocket send failed");
+	conn->len = 0;
+	conn->consumed = 0;
+	zassert_equal(conn_recv(conn), 4, "websocket data not received");
+	zassert_mem_equal(conn->buf, "pong", 4, "data from the HTTP server");
+
+	(void)zsock_close(ws_sock);
+	conn_close(conn);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(http_server,
+			 ztest_unit_test(test_setup),
+			 ztest_unit_test(test_get),
+			 ztest_unit_test(test_no_content),
+			 ztest_unit_test(test_not_found),
+			 ztest_unit_test(test_method_not_allowed),
+			 ztest_unit_test(test_too_large),
+			 ztest_unit_test(test_chunked_body),
+			 ztest_unit_test(test_pipelined),
+			 ztest_unit_test(test_slow_reader),
+			 ztest_unit_test(test_websocket));
+
+	ztest_run_test_suite(http_server);
+}
@@ -0,0 +1,352 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_LWM2M_LOG_LEVEL);
+
+#include <ztest.h>
+#include <string.h>
+
+#include <net/socket.h>
+#include <net/coap.h>
+#include <net/lwm2m.h>
+
+#include "lwm2m_engine.h"
+
+/* The firmware pull requests the image from this test, acting as the
+ * CoAP server, over the local address.
+ */
+#define SERVER_PORT 5699
+#define SERVER_URI "coap://" CONFIG_NET_CONFIG_MY_IPV4_ADDR ":5699/fw"
+
+#define BLOCK_SIZE CONFIG_LWM2M_COAP_BLOCK_SIZE
+#define BLOCK_SZX COAP_BLOCK_64
+#define BLOCKS 10
+#define IMAGE_SIZE (BLOCKS * BLOCK_SIZE)
+#define WINDOW CONFIG_LWM2M_FIRMWARE_UPDATE_PULL_COAP_WINDOW
+
+/* Longer than the first retransmission of a request */
+#define RETRANSMIT_MS 5000
+#define IDLE_MS 200
+
+extern int lwm2m_firmware_start_transfer(char *package_uri);
+extern int lwm2m_firmware_cancel_transfer(void);
+
+struct fw_request {
+	struct sockaddr addr;
+	socklen_t addrlen;
+	u8_t token[8];
+	u8_t tkl;
+	u16_t id;
+	u32_t num;
+};
+
+static int server_sock = -1;
+static u8_t image[IMAGE_SIZE];
+static u8_t received[IMAGE_SIZE];
+static size_t received_len;
+static u8_t write_buf[BLOCK_SIZE];
+
+static void *fw_get_buf(u16_t obj_inst_id, u16_t res_id, u16_t res_inst_id,
+			size_t *data_len)
+{
+	*data_len = sizeof(write_buf);
+
+	return write_buf;
+}
+
+static int fw_write(u16_t obj_inst_id, u16_t res_id, u16_t res_inst_id,
+		    u8_t *data, u16_t data_len, bool last_block,
+		    size_t total_size)
+{
+	zassert_true(received_len + data_len <= sizeof(received),
+		     "image overflow");
+
+	memcpy(received + received_len, data, data_len);
+	received_len += data_len;
+
+	return 0;
+}
+
+static int server_recv(struct fw_request *req, int timeout)
+{
+	struct zsock_pollfd pfd = {
+		.fd = server_sock,
+		.events = ZSOCK_POLLIN,
+	};
+	struct coap_packet cpkt;
+	struct coap_option option;
+	u8_t buf[128];
+	ssize_t len;
+	int ret;
+
+	ret = zsock_poll(&pfd, 1, timeout);
+	zassert_true(ret >= 0, "poll failed");
+	if (ret == 0) {
+		return -EAGAIN;
+	}
+
+	req->addrlen = sizeof(req->addr);
+	len = zsock_recvfrom(server_sock, buf, sizeof(buf), 0, &req->addr,
+			     &req->addrlen);
+	zassert_true(len > 0, "recvfrom failed");
+
+	ret = coap_packet_parse(&cpkt, buf, len, NULL, 0);
+	zassert_equal(ret, 0, "invalid request");
+
+	req->tkl = coap_header_get_token(&cpkt, req->token);
+	req->id = coap_header_get_id(&cpkt);
+
+	ret = coap_find_options(&cpkt, COAP_OPTION_BLOCK2, &option, 1);
+	zassert_equal(ret, 1, "no block2 option");
+
+	req->num = coap_option_value_to_int(&option) >> 4;
+	zassert_true(req->num < BLOCKS, "block past the image");
+
+	return 0;
+}
+
+static void server_reply(struct fw_request *req, u8_t code)
+{
+	struct coap_packet cpkt;
+	u8_t buf[128];
+	bool more = req->num < BLOCKS - 1;
+	int ret;
+
+	ret = coap_packet_init(&cpkt, buf, sizeof(buf), 1, COAP_TYPE_ACK,
+			       req->tkl, req->token, code, req->id);
+	zassert_equal(ret, 0, "cannot build reply");
+
+	if (code == COAP_RESPONSE_CODE_CONTENT) {
+		ret = coap_append_option_int(&cpkt, COAP_OPTION_BLOCK2,
+					     (req->num << 4) | (more << 3) |
+					     BLOCK_SZX);
+		zassert_equal(ret, 0, "cannot add block2 option");
+
+		ret = coap_append_option_int(&cpkt, COAP_OPTION_SIZE2,
+					     IMAGE_SIZE);
+		zassert_equal(ret, 0, "cannot add size2 option");
+
+		ret = coap_packet_append_payload_marker(&cpkt);
+		zassert_equal(ret, 0, "cannot add payload marker");
+
+		ret = coap_packet_append_payload(&cpkt,
+						 image + req->num * BLOCK_SIZE,
+						 BLOCK_SIZE);
+		zassert_equal(ret, 0, "cannot add payload");
+	}
+
+	ret = zsock_sendto(server_sock, cpkt.data, cpkt.offset, 0,
+			   &req->addr, req->addrlen);
+	zassert_equal(ret, cpkt.offset, "sendto failed");
+}
+
+/* Requests in flight after the first block, which gives the image size */
+static int server_collect(struct fw_request *reqs, int timeout)
+{
+	int count = 0;
+
+	while (count < WINDOW && server_recv(&reqs[count], timeout) == 0) {
+		count++;
+		timeout = IDLE_MS;
+	}
+
+	return count;
+}
+
+static u8_t fw_state(void)
+{
+	u8_t state;
+
+	zassert_equal(lwm2m_engine_get_u8("5/0/3", &state), 0,
+		      "cannot read state");
+
+	return state;
+}
+
+static u8_t fw_result(void)
+{
+	u8_t result;
+
+	zassert_equal(lwm2m_engine_get_u8("5/0/5", &result), 0,
+		      "cannot read result");
+
+	return result;
+}
+
+static void transfer_start(void)
+{
+	struct fw_request req;
+
+	lwm2m_firmware_set_update_result(RESULT_DEFAULT);
+	received_len = 0;
+
+	zassert_equal(lwm2m_firmware_start_transfer(SERVER_URI), 0,
+		      "cannot start transfer");
+
+	/* Only the first block is requested until the size is known */
+	zassert_equal(server_recv(&req, RETRANSMIT_MS), 0,
+		      "first block not requested");
+	zassert_equal(req.num, 0, "first request not for block 0");
+	zassert_equal(server_recv(&req, IDLE_MS), -EAGAIN,
+		      "blocks requested before the size is known");
+
+	req.num = 0U;
+	server_reply(&req, COAP_RESPONSE_CODE_CONTENT);
+}
+
+static void transfer_check_done(void)
+{
+	struct fw_request req;
+
+	zassert_equal(server_recv(&req, IDLE_MS), -EAGAIN,
+		      "request after the last block");
+	zassert_equal(fw_state(), STATE_DOWNLOADED, "download not done");
+	zassert_equal(received_len, IMAGE_SIZE, "wrong image size");
+	zassert_mem_equal(received, image, IMAGE_SIZE, "wrong image");
+}
+
+static void test_setup(void)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(SERVER_PORT),
+	};
+	int i;
+
+	for (i = 0; i < IMAGE_SIZE; i++) {
+		image[i] = i * 7;
+	}
+
+	zsock_inet_pton(AF_INET, CONFIG_NET_CONFIG_MY_IPV4_ADDR,
+			&addr.sin_addr);
+
+	server_sock = zsock_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(server_sock >= 0, "socket failed");
+	zassert_equal(zsock_bind(server_sock, (struct sockaddr *)&addr,
+				 sizeof(addr)), 0, "bind failed");
+
+	zassert_equal(lwm2m_engine_register_pre_write_callback("5/0/0",
+							       fw_get_buf),
+		      0, "cannot set buffer");
+	lwm2m_firmware_set_write_cb(fw_write);
+}
+
+static void test_out_of_order(void)
+{
+	struct fw_request reqs[WINDOW];
+	int served = 1;
+	int count, i;
+
+	transfer_start();
+
+	while (served < BLOCKS) {
+		count = server_collect(reqs, RETRANSMIT_MS);
+		zassert_true(count > 0, "blocks not requested");
+
+		/* The first block of the window comes last */
+		for (i = count - 1; i >= 0; i--) {
+			server_reply(&reqs[i], COAP_RESPONSE_CODE_CONTENT);
+		}
+
+		served += count;
+	}
+
+	k_sleep(K_MSEC(IDLE_MS));
+	transfer_check_done();
+}
+
+static void test_lost_block(void)
+{
+	struct fw_request req;
+	int requests[BLOCKS] = { 0 };
+	int served = 1;
+
+	transfer_start();
+
+	while (served < BLOCKS) {
+		zassert_equal(server_recv(&req, RETRANSMIT_MS), 0,
+			      "blocks not requested");
+
+		/* Drop the first request of block 3, the other blocks of
+		 * the window still go through.
+		 */
+		if (req.num == 3 && requests[3]++ == 0) {
+			continue;
+		}
+
+		requests[req.num]++;
+		server_reply(&req, COAP_RESPONSE_CODE_CONTENT);
+		served++;
+	}
+
+	zassert_equal(requests[3], 2, "block 3 not requested again");
+
+	k_sleep(K_MSEC(IDLE_MS));
+	transfer_check_done();
+}
+
+static void test_abort_on_error(void)
+{
+	struct fw_request reqs[WINDOW];
+	struct fw_request req;
+	int count, i;
+
+	transfer_start();
+
+	count = server_collect(reqs, RETRANSMIT_MS);
+	zassert_equal(count, WINDOW, "window not filled");
+
+	/* The error aborts the transfer, the replies to the other
+	 * requests in flight are then dropped.
+	 */
+	server_reply(&reqs[0], COAP_RESPONSE_CODE_NOT_FOUND);
+	for (i = 1; i < count; i++) {
+		server_reply(&reqs[i], COAP_RESPONSE_CODE_CONTENT);
+	}
+
+	/* No retransmission nor new request */
+	zassert_equal(server_recv(&req, RETRANSMIT_MS), -EAGAIN,
+		      "request after the abort");
+
+	zassert_equal(received_len, BLOCK_SIZE, "blocks written after abort");
+	zassert_equal(fw_state(), STATE_IDLE, "transfer not aborted");
+	zassert_equal(fw_result(), RESULT_CONNECTION_LOST, "wrong result");
+}
+
+static void test_cancel(void)
+{
+	struct fw_request reqs[WINDOW];
+	struct fw_request req;
+	int count;
+
+	transfer_start();
+
+	count = server_collect(reqs, RETRANSMIT_MS);
+	zassert_equal(count, WINDOW, "window not filled");
+
+	zassert_equal(lwm2m_firmware_cancel_transfer(), 0, "cancel failed");
+	lwm2m_firmware_set_update_result(RESULT_DEFAULT);
+
+	/* The requests in flight are not retransmitted */
+	zassert_equal(server_recv(&req, RETRANSMIT_MS), -EAGAIN,
+		      "request after the cancel");
+
+	zassert_equal(received_len, BLOCK_SIZE, "blocks written after cancel");
+	zassert_equal(fw_state(), STATE_IDLE, "transfer not cancelled");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(lwm2m_fw_pull,
+			 ztest_unit_test(test_setup),
+			 ztest_unit_test(test_out_of_order),
+			 ztest_unit_test(test_lost_block),
+			 ztest_unit_test(test_abort_on_error),
+			 ztest_unit_test(test_cancel));
+
+	ztest_run_test_suite(lwm2m_fw_pull);
+}
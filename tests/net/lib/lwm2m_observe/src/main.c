@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_LWM2M_LOG_LEVEL);
+
+#include <ztest.h>
+#include <string.h>
+
+#include <net/socket.h>
+#include <net/coap.h>
+#include <net/lwm2m.h>
+
+#include "lwm2m_engine.h"
+
+/* The test is the LwM2M server, over the local address */
+#define SERVER_PORT 5683
+
+#define PMIN_MS (CONFIG_LWM2M_SERVER_DEFAULT_PMIN * MSEC_PER_SEC)
+#define PMAX_MS (CONFIG_LWM2M_SERVER_DEFAULT_PMAX * MSEC_PER_SEC)
+
+/* How late a notification can be */
+#define MARGIN_MS 200
+
+static u8_t token[] = { 0x12, 0x34, 0x56, 0x78 };
+
+static struct lwm2m_ctx client;
+static struct sockaddr client_addr;
+static socklen_t client_addrlen;
+static int server_sock = -1;
+static u8_t battery_level;
+
+static void server_send(struct coap_packet *cpkt)
+{
+	zassert_equal(zsock_sendto(server_sock, cpkt->data, cpkt->offset, 0,
+				   &client_addr, client_addrlen),
+		      cpkt->offset, "sendto failed");
+}
+
+/* Wait for a notification, or the response to the Observe request, and
+ * acknowledge it. Returns the time it came at, or -EAGAIN.
+ */
+static s64_t server_recv(int timeout)
+{
+	struct zsock_pollfd pfd = {
+		.fd = server_sock,
+		.events = ZSOCK_POLLIN,
+	};
+	struct coap_packet cpkt, ack;
+	struct coap_option option;
+	u8_t buf[128];
+	u8_t tkn[8];
+	s64_t timestamp;
+	ssize_t len;
+	int ret;
+
+	ret = zsock_poll(&pfd, 1, timeout);
+	zassert_true(ret >= 0, "poll failed");
+	if (ret == 0) {
+		return -EAGAIN;
+	}
+
+	timestamp = k_uptime_get();
+
+	len = zsock_recv(server_sock, buf, sizeof(buf), 0);
+	zassert_true(len > 0, "recv failed");
+
+	zassert_equal(coap_packet_parse(&cpkt, buf, len, NULL, 0), 0,
+		      "invalid notification");
+	zassert_equal(coap_header_get_code(&cpkt), COAP_RESPONSE_CODE_CONTENT,
+		      "not a notification");
+	zassert_equal(coap_header_get_token(&cpkt, tkn), sizeof(token),
+		      "wrong token length");
+	zassert_mem_equal(tkn, token, sizeof(token), "wrong token");
+	zassert_equal(coap_find_options(&cpkt, COAP_OPTION_OBSERVE,
+					&option, 1), 1, "no observe option");
+
+	if (coap_header_get_type(&cpkt) == COAP_TYPE_CON) {
+		ret = coap_packet_init(&ack, buf, sizeof(buf), 1,
+				       COAP_TYPE_ACK, 0, NULL, 0,
+				       coap_header_get_id(&cpkt));
+		zassert_equal(ret, 0, "cannot build ack");
+
+		server_send(&ack);
+	}
+
+	return timestamp;
+}
+
+static void battery_set(void)
+{
+	zassert_equal(lwm2m_engine_set_u8("3/0/9", ++battery_level), 0,
+		      "cannot set battery level");
+}
+
+static void test_setup(void)
+{
+	struct sockaddr_in *addr = (struct sockaddr_in *)&client.remote_addr;
+	struct sockaddr_in server_addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(SERVER_PORT),
+	};
+
+	zassert_equal(lwm2m_engine_set_res_data("3/0/9", &battery_level,
+						sizeof(battery_level), 0),
+		      0, "cannot set battery level buffer");
+
+	zsock_inet_pton(AF_INET, CONFIG_NET_CONFIG_MY_IPV4_ADDR,
+			&server_addr.sin_addr);
+
+	server_sock = zsock_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	zassert_true(server_sock >= 0, "socket failed");
+	zassert_equal(zsock_bind(server_sock, (struct sockaddr *)&server_addr,
+				 sizeof(server_addr)), 0, "bind failed");
+
+	memcpy(addr, &server_addr, sizeof(server_addr));
+
+	lwm2m_engine_context_init(&client);
+	zassert_equal(lwm2m_socket_start(&client), 0, "cannot start client");
+
+	client_addrlen = sizeof(client_addr);
+	zassert_equal(zsock_getsockname(client.sock_fd, &client_addr,
+					&client_addrlen), 0,
+		      "getsockname failed");
+}
+
+static void test_observe(void)
+{
+	static const char * const path[] = { "3", "0", "9" };
+	struct coap_packet cpkt;
+	u8_t buf[64];
+	s32_t timeout;
+	int i, ret;
+
+	ret = coap_packet_init(&cpkt, buf, sizeof(buf), 1, COAP_TYPE_CON,
+			       sizeof(token), token, COAP_METHOD_GET,
+			       coap_next_id());
+	zassert_equal(ret, 0, "cannot build request");
+
+	zassert_equal(coap_append_option_int(&cpkt, COAP_OPTION_OBSERVE, 0),
+		      0, "cannot add observe option");
+	for (i = 0; i < ARRAY_SIZE(path); i++) {
+		ret = coap_packet_append_option(&cpkt, COAP_OPTION_URI_PATH,
+						(const u8_t *)path[i],
+						strlen(path[i]));
+		zassert_equal(ret, 0, "cannot add path");
+	}
+
+	server_send(&cpkt);
+
+	zassert_true(server_recv(MSEC_PER_SEC) >= 0, "no observe response");
+
+	/* The engine sleeps until the maximum period ends, the device
+	 * object service runs every 10 seconds.
+	 */
+	timeout = engine_next_service_timeout_ms();
+	zassert_true(timeout > PMAX_MS - MARGIN_MS && timeout <= PMAX_MS,
+		     "wrong timeout %d", timeout);
+}
+
+static void test_pmax(void)
+{
+	s64_t start, timestamp;
+
+	start = server_recv(PMAX_MS + MARGIN_MS);
+	zassert_true(start >= 0, "no notification at the maximum period");
+
+	/* Nothing changes, the next one comes after the maximum period */
+	zassert_equal(server_recv(PMAX_MS - MARGIN_MS), -EAGAIN,
+		      "notification before the maximum period");
+
+	timestamp = server_recv(2 * MARGIN_MS);
+	zassert_true(timestamp >= 0, "no notification at the maximum period");
+	zassert_true(timestamp - start >= PMAX_MS, "notification too early");
+}
+
+static void test_pmin(void)
+{
+	s64_t start, timestamp;
+
+	start = server_recv(PMAX_MS + MARGIN_MS);
+	zassert_true(start >= 0, "no notification");
+
+	/* Changes during the minimum period are sent together at its end */
+	battery_set();
+	k_sleep(K_MSEC(100));
+	battery_set();
+
+	timestamp = server_recv(PMIN_MS + MARGIN_MS);
+	zassert_true(timestamp >= 0, "no notification at the minimum period");
+	zassert_true(timestamp - start >= PMIN_MS, "notification too early");
+	zassert_equal(server_recv(PMIN_MS), -EAGAIN,
+		      "changes not coalesced");
+}
+
+static void test_change_wakeup(void)
+{
+	s64_t start, timestamp;
+
+	start = server_recv(PMAX_MS + MARGIN_MS);
+	zassert_true(start >= 0, "no notification");
+
+	/* The engine sleeps until the maximum period, a change after the
+	 * minimum period must wake it up.
+	 */
+	k_sleep(K_MSEC(PMIN_MS + MARGIN_MS));
+
+	start = k_uptime_get();
+	battery_set();
+
+	timestamp = server_recv(MARGIN_MS);
+	zassert_true(timestamp >= 0, "change did not wake up the engine");
+	zassert_true(timestamp - start < MARGIN_MS, "notification too late");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(lwm2m_observe,
+			 ztest_unit_test(test_setup),
+			 ztest_unit_test(test_observe),
+			 ztest_unit_test(test_pmax),
+			 ztest_unit_test(test_pmin),
+			 ztest_unit_test(test_change_wakeup));
+
+	ztest_run_test_suite(lwm2m_observe);
+}
@@ -0,0 +1,402 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_MQTT_LOG_LEVEL);
+
+#include <ztest.h>
+#include <string.h>
+#include <sys/byteorder.h>
+
+#include <net/socket.h>
+#include <net/mqtt.h>
+
+/* The broker side of the connection is a plain socket driven by the test
+ * itself over the loopback interface, so that every packet sent by the
+ * client is checked and every acknowledgment is sent on purpose.
+ */
+#define SERVER_PORT 1883
+#define TIMEOUT_MS 2000
+#define NO_DATA_TIMEOUT_MS 100
+#define PAYLOAD_LEN 16
+
+#define MQTT_PUBLISH 0x30
+#define MQTT_PUBACK 0x40
+#define MQTT_PUBREC 0x50
+#define MQTT_PUBREL 0x62
+#define MQTT_PUBCOMP 0x70
+#define MQTT_DUP 0x08
+
+static struct sockaddr_in server_addr = {
+	.sin_family = AF_INET,
+	.sin_port = htons(SERVER_PORT),
+	.sin_addr = { { { 127, 0, 0, 1 } } },
+};
+
+static u8_t topic[] = "sensors/inflight";
+
+static struct mqtt_client client;
+static u8_t rx_buffer[128];
+static u8_t tx_buffer[256];
+static bool connected;
+
+static struct mqtt_publish_param
+	messages[CONFIG_MQTT_PUBLISH_BATCH_MAX + 1];
+static u8_t payloads[CONFIG_MQTT_PUBLISH_BATCH_MAX + 1][PAYLOAD_LEN];
+
+static int server_sock = -1;
+static int broker_sock = -1;
+
+static void recv_all(u8_t *buf, size_t len)
+{
+	struct pollfd fds = {
+		.fd = broker_sock,
+		.events = POLLIN,
+	};
+	int ret;
+
+	while (len) {
+		zassert_equal(poll(&fds, 1, TIMEOUT_MS), 1,
+			      "nothing received by the broker");
+
+		ret = recv(broker_sock, buf, len, 0);
+		zassert_true(ret > 0, "broker recv failed (%d)", errno);
+
+		buf += ret;
+		len -= ret;
+	}
+}
+
+/* Read one MQTT packet, return its first byte */
+static u8_t broker_read(u8_t *buf, size_t size, u32_t *len)
+{
+	u8_t type, byte;
+	int shift = 0;
+
+	recv_all(&type, 1);
+
+	*len = 0U;
+
+	do {
+		zassert_true(shift <= 21, "bad remaining length");
+		recv_all(&byte, 1);
+
+		*len |= (byte & 0x7f) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+
+	zassert_true(*len <= size, "packet too large");
+	recv_all(buf, *len);
+
+	return type;
+}
+
+static void broker_no_data(void)
+{
+	struct pollfd fds = {
+		.fd = broker_sock,
+		.events = POLLIN,
+	};
+
+	zassert_equal(poll(&fds, 1, NO_DATA_TIMEOUT_MS), 0,
+		      "unexpected data received by the broker");
+}
+
+static void wait_input(void)
+{
+	struct pollfd fds = {
+		.fd = client.transport.tcp.sock,
+		.events = POLLIN,
+	};
+
+	zassert_equal(poll(&fds, 1, TIMEOUT_MS), 1, "no input for the client");
+	zassert_equal(mqtt_input(&client), 0, "mqtt_input failed");
+}
+
+/* Send an acknowledgment to the client and let it process it */
+static void broker_ack(u8_t type, u16_t message_id)
+{
+	u8_t ack[4] = { type, 2U, message_id >> 8, message_id & 0xff };
+
+	zassert_equal(send(broker_sock, ack, sizeof(ack), 0), sizeof(ack),
+		      "cannot send ack");
+
+	wait_input();
+}
+
+static void expect_publish(enum mqtt_qos qos, u16_t message_id, bool dup,
+			   u8_t fill)
+{
+	u8_t buf[64];
+	u8_t *data = buf;
+	u32_t len;
+	u8_t type;
+	int i;
+
+	type = broker_read(buf, sizeof(buf), &len);
+
+	zassert_equal(type, MQTT_PUBLISH | (dup ? MQTT_DUP : 0U) | qos << 1,
+		      "wrong PUBLISH header 0x%02x", type);
+	zassert_equal(len, 2 + sizeof(topic) - 1 + (qos ? 2 : 0) + PAYLOAD_LEN,
+		      "wrong PUBLISH length");
+
+	zassert_equal(sys_get_be16(data), sizeof(topic) - 1,
+		      "wrong topic length");
+	data += 2;
+	zassert_mem_equal(data, topic, sizeof(topic) - 1, "wrong topic");
+	data += sizeof(topic) - 1;
+
+	if (qos) {
+		zassert_equal(sys_get_be16(data), message_id,
+			      "wrong message id");
+		data += 2;
+	}
+
+	for (i = 0; i < PAYLOAD_LEN; i++) {
+		zassert_equal(data[i], fill, "wrong payload");
+	}
+}
+
+static void mqtt_evt_handler(struct mqtt_client *const c,
+			     const struct mqtt_evt *evt)
+{
+	struct mqtt_pubrel_param rel;
+
+	switch (evt->type) {
+	case MQTT_EVT_CONNACK:
+		connected = evt->result == 0;
+		break;
+	case MQTT_EVT_PUBREC:
+		rel.message_id = evt->param.pubrec.message_id;
+		(void)mqtt_publish_qos2_release(c, &rel);
+		break;
+	default:
+		break;
+	}
+}
+
+/* Fill message i, its payload is made of its index */
+static struct mqtt_publish_param *message_init(int i, enum mqtt_qos qos,
+					       u16_t message_id, bool dup)
+{
+	struct mqtt_publish_param *msg = &messages[i];
+
+	memset(msg, 0, sizeof(*msg));
+	memset(payloads[i], i, PAYLOAD_LEN);
+
+	msg->message.topic.topic.utf8 = topic;
+	msg->message.topic.topic.size = sizeof(topic) - 1;
+	msg->message.topic.qos = qos;
+	msg->message.payload.data = payloads[i];
+	msg->message.payload.len = PAYLOAD_LEN;
+	msg->message_id = message_id;
+	msg->dup_flag = dup;
+
+	return msg;
+}
+
+static void test_mqtt_inflight_setup(void)
+{
+	static u8_t client_id[] = "inflight";
+	u8_t buf[64];
+	u8_t connack[4] = { 0x20, 2U, 0U, 0U };
+	u32_t len;
+
+	server_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(server_sock >= 0, "cannot create server socket");
+	zassert_equal(bind(server_sock, (struct sockaddr *)&server_addr,
+			   sizeof(server_addr)), 0, "cannot bind");
+	zassert_equal(listen(server_sock, 1), 0, "cannot listen");
+
+	mqtt_client_init(&client);
+
+	client.broker = &server_addr;
+	client.evt_cb = mqtt_evt_handler;
+	client.client_id.utf8 = client_id;
+	client.client_id.size = sizeof(client_id) - 1;
+	client.keepalive = 0U;
+	client.rx_buf = rx_buffer;
+	client.rx_buf_size = sizeof(rx_buffer);
+	client.tx_buf = tx_buffer;
+	client.tx_buf_size = sizeof(tx_buffer);
+	client.transport.type = MQTT_TRANSPORT_NON_SECURE;
+
+	zassert_equal(mqtt_connect(&client), 0, "cannot connect");
+
+	broker_sock = accept(server_sock, NULL, NULL);
+	zassert_true(broker_sock >= 0, "cannot accept");
+
+	zassert_equal(broker_read(buf, sizeof(buf), &len) & 0xf0, 0x10,
+		      "CONNECT expected");
+	zassert_equal(send(broker_sock, connack, sizeof(connack), 0),
+		      sizeof(connack), "cannot send CONNACK");
+
+	wait_input();
+	zassert_true(connected, "not connected");
+	zassert_equal(mqtt_inflight_count(&client), 0, "messages in flight");
+}
+
+static void test_mqtt_inflight_window(void)
+{
+	zassert_equal(mqtt_publish(&client,
+				   message_init(0, MQTT_QOS_1_AT_LEAST_ONCE,
+						1U, false)), 0,
+		      "cannot publish 1");
+	expect_publish(MQTT_QOS_1_AT_LEAST_ONCE, 1U, false, 0U);
+
+	zassert_equal(mqtt_publish(&client,
+				   message_init(1, MQTT_QOS_2_EXACTLY_ONCE,
+						2U, false)), 0,
+		      "cannot publish 2");
+	expect_publish(MQTT_QOS_2_EXACTLY_ONCE, 2U, false, 1U);
+
+	zassert_equal(mqtt_inflight_count(&client), 2,
+		      "wrong number of messages in flight");
+
+	/* The window is full */
+	zassert_equal(mqtt_publish(&client,
+				   message_init(2, MQTT_QOS_1_AT_LEAST_ONCE,
+						3U, false)), -EAGAIN,
+		      "window overrun");
+	broker_no_data();
+
+	/* QoS 0 messages are not tracked */
+	zassert_equal(mqtt_publish(&client,
+				   message_init(3, MQTT_QOS_0_AT_MOST_ONCE,
+						0U, false)), 0,
+		      "cannot publish QoS 0");
+	expect_publish(MQTT_QOS_0_AT_MOST_ONCE, 0U, false, 3U);
+
+	zassert_equal(mqtt_inflight_count(&client), 2,
+		      "QoS 0 message counted");
+}
+
+static void test_mqtt_inflight_duplicate(void)
+{
+	/* The id of a message in flight cannot be reused... */
+	zassert_equal(mqtt_publish(&client,
+				   message_init(0, MQTT_QOS_1_AT_LEAST_ONCE,
+						1U, false)), -EALREADY,
+		      "id in flight reused");
+	broker_no_data();
+
+	/* ...unless the message is retransmitted */
+	zassert_equal(mqtt_publish(&client,
+				   message_init(0, MQTT_QOS_1_AT_LEAST_ONCE,
+						1U, true)), 0,
+		      "cannot retransmit");
+	expect_publish(MQTT_QOS_1_AT_LEAST_ONCE, 1U, true, 0U);
+
+	zassert_equal(mqtt_inflight_count(&client), 2,
+		      "retransmission counted");
+}
+
+static void test_mqtt_inflight_release(void)
+{
+	u8_t buf[8];
+	u32_t len;
+
+	broker_ack(MQTT_PUBACK, 1U);
+	zassert_equal(mqtt_inflight_count(&client), 1,
+		      "PUBACK did not release the message");
+
+	/* Unknown ids are ignored */
+	broker_ack(MQTT_PUBACK, 99U);
+	zassert_equal(mqtt_inflight_count(&client), 1,
+		      "unknown id released a message");
+
+	zassert_equal(mqtt_publish(&client,
+				   message_init(2, MQTT_QOS_1_AT_LEAST_ONCE,
+						3U, false)), 0,
+		      "released slot not reused");
+	expect_publish(MQTT_QOS_1_AT_LEAST_ONCE, 3U, false, 2U);
+
+	/* A QoS 2 message is in flight until PUBCOMP */
+	broker_ack(MQTT_PUBREC, 2U);
+	zassert_equal(broker_read(buf, sizeof(buf), &len), MQTT_PUBREL,
+		      "PUBREL expected");
+	zassert_equal(sys_get_be16(buf), 2U, "wrong PUBREL id");
+	zassert_equal(mqtt_inflight_count(&client), 2,
+		      "PUBREC released the message");
+
+	broker_ack(MQTT_PUBCOMP, 2U);
+	zassert_equal(mqtt_inflight_count(&client), 1,
+		      "PUBCOMP did not release the message");
+
+	broker_ack(MQTT_PUBACK, 3U);
+	zassert_equal(mqtt_inflight_count(&client), 0,
+		      "messages still in flight");
+}
+
+static void test_mqtt_inflight_batch(void)
+{
+	zassert_equal(mqtt_publish_batch(&client, messages, 0), -EINVAL,
+		      "empty batch accepted");
+	zassert_equal(mqtt_publish_batch(&client, messages,
+					 CONFIG_MQTT_PUBLISH_BATCH_MAX + 1),
+		      -EINVAL, "batch too large accepted");
+
+	message_init(0, MQTT_QOS_0_AT_MOST_ONCE, 0U, false);
+	message_init(1, MQTT_QOS_1_AT_LEAST_ONCE, 0U, false);
+	zassert_equal(mqtt_publish_batch(&client, messages, 2), -EINVAL,
+		      "message id 0 accepted");
+	broker_no_data();
+
+	/* Every message of the batch reaches the broker, in order */
+	message_init(0, MQTT_QOS_0_AT_MOST_ONCE, 0U, false);
+	message_init(1, MQTT_QOS_1_AT_LEAST_ONCE, 5U, false);
+	message_init(2, MQTT_QOS_1_AT_LEAST_ONCE, 6U, false);
+	message_init(3, MQTT_QOS_0_AT_MOST_ONCE, 0U, false);
+	zassert_equal(mqtt_publish_batch(&client, messages, 4), 0,
+		      "cannot publish batch");
+
+	expect_publish(MQTT_QOS_0_AT_MOST_ONCE, 0U, false, 0U);
+	expect_publish(MQTT_QOS_1_AT_LEAST_ONCE, 5U, false, 1U);
+	expect_publish(MQTT_QOS_1_AT_LEAST_ONCE, 6U, false, 2U);
+	expect_publish(MQTT_QOS_0_AT_MOST_ONCE, 0U, false, 3U);
+
+	zassert_equal(mqtt_inflight_count(&client), 2,
+		      "wrong number of messages in flight");
+
+	/* Nothing is sent when a message does not fit */
+	broker_ack(MQTT_PUBACK, 5U);
+	message_init(0, MQTT_QOS_0_AT_MOST_ONCE, 0U, false);
+	message_init(1, MQTT_QOS_1_AT_LEAST_ONCE, 7U, false);
+	message_init(2, MQTT_QOS_1_AT_LEAST_ONCE, 8U, false);
+	zassert_equal(mqtt_publish_batch(&client, messages, 3), -EAGAIN,
+		      "window overrun");
+	broker_no_data();
+
+	message_init(1, MQTT_QOS_1_AT_LEAST_ONCE, 6U, false);
+	zassert_equal(mqtt_publish_batch(&client, messages, 2), -EALREADY,
+		      "id in flight reused");
+	broker_no_data();
+
+	broker_ack(MQTT_PUBACK, 6U);
+	zassert_equal(mqtt_inflight_count(&client), 0,
+		      "messages still in flight");
+}
+
+static void test_mqtt_inflight_teardown(void)
+{
+	zassert_equal(mqtt_disconnect(&client), 0, "cannot disconnect");
+
+	(void)close(broker_sock);
+	(void)close(server_sock);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(mqtt_inflight,
+			 ztest_unit_test(test_mqtt_inflight_setup),
+			 ztest_unit_test(test_mqtt_inflight_window),
+			 ztest_unit_test(test_mqtt_inflight_duplicate),
+			 ztest_unit_test(test_mqtt_inflight_release),
+			 ztest_unit_test(test_mqtt_inflight_batch),
+			 ztest_unit_test(test_mqtt_inflight_teardown));
+
+	ztest_run_test_suite(mqtt_inflight);
+}
@@ -24,6 +24,7 @@ LOG_MODULE_REGISTER(net_test, CONFIG_NET_IPV6_NBR_CACHE_LOG_LEVEL);
 #include <linker/sections.h>
 
 #include "nbr.h"
+#include "ipv6.h"
 
 #define NET_LOG_ENABLED 1
 #include "net_private.h"
@@ -293,12 +294,143 @@ static void test_neighbor(void)
 	return;
 }
 
+/* The IPv6 neighbor cache hashes the interface identifier only, so these
+ * addresses all end up in the same hash chain.
+ */
+static struct in6_addr ipv6_nbr_addrs[] = {
+	{ { { 0x20, 0x01, 0x0d, 0xb8, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 } } },
+	{ { { 0x20, 0x01, 0x0d, 0xb8, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 } } },
+	{ { { 0x20, 0x01, 0x0d, 0xb8, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 } } },
+	{ { { 0x20, 0x01, 0x0d, 0xb8, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 } } },
+	{ { { 0x20, 0x01, 0x0d, 0xb8, 0, 5, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 } } },
+};
+
+static struct net_eth_addr *ipv6_nbr_hwaddrs[] = {
+	&hwaddr1, &hwaddr2, &hwaddr3, &hwaddr4, &hwaddr5,
+};
+
+static struct net_nbr *ipv6_nbr_add(struct net_if *iface, int i,
+				    bool is_router)
+{
+	struct net_linkaddr lladdr = {
+		.addr = ipv6_nbr_hwaddrs[i]->addr,
+		.len = sizeof(struct net_eth_addr),
+		.type = NET_LINK_ETHERNET,
+	};
+
+	return net_ipv6_nbr_add(iface, &ipv6_nbr_addrs[i], &lladdr,
+				is_router, NET_IPV6_NBR_STATE_STALE);
+}
+
+static void ipv6_nbr_rm_all(struct net_if *iface)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ipv6_nbr_addrs); i++) {
+		(void)net_ipv6_nbr_rm(iface, &ipv6_nbr_addrs[i]);
+	}
+}
+
+static void test_ipv6_nbr_hash(void)
+{
+	struct net_if *iface1 = INT_TO_POINTER(1);
+	struct net_if *iface2 = INT_TO_POINTER(2);
+	struct net_nbr *nbrs[CONFIG_NET_IPV6_MAX_NEIGHBORS];
+	struct net_nbr *nbr;
+	int i;
+
+	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+		nbrs[i] = ipv6_nbr_add(iface1, i, false);
+		zassert_not_null(nbrs[i], "Cannot add neighbor %d", i);
+	}
+
+	/* Every entry of the chain is found */
+	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+		nbr = net_ipv6_nbr_lookup(iface1, &ipv6_nbr_addrs[i]);
+		zassert_equal_ptr(nbr, nbrs[i], "Wrong neighbor %d", i);
+
+		nbr = net_ipv6_nbr_lookup(NULL, &ipv6_nbr_addrs[i]);
+		zassert_equal_ptr(nbr, nbrs[i], "Neighbor %d not found", i);
+
+		nbr = net_ipv6_nbr_lookup(iface2, &ipv6_nbr_addrs[i]);
+		zassert_is_null(nbr, "Neighbor %d found on wrong iface", i);
+	}
+
+	/* Removing one entry keeps the rest of the chain */
+	zassert_true(net_ipv6_nbr_rm(iface1, &ipv6_nbr_addrs[1]),
+		     "Cannot remove neighbor 1");
+	zassert_is_null(net_ipv6_nbr_lookup(iface1, &ipv6_nbr_addrs[1]),
+			"Removed neighbor found");
+
+	for (i = 0; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+		if (i == 1) {
+			continue;
+		}
+
+		nbr = net_ipv6_nbr_lookup(iface1, &ipv6_nbr_addrs[i]);
+		zassert_equal_ptr(nbr, nbrs[i], "Neighbor %d lost", i);
+	}
+
+	/* The released entry is reused for another address */
+	nbr = ipv6_nbr_add(iface1, CONFIG_NET_IPV6_MAX_NEIGHBORS, false);
+	zassert_not_null(nbr, "Cannot reuse the released neighbor");
+	zassert_equal_ptr(net_ipv6_nbr_lookup(iface1,
+			  &ipv6_nbr_addrs[CONFIG_NET_IPV6_MAX_NEIGHBORS]),
+			  nbr, "Reused neighbor not found");
+	zassert_is_null(net_ipv6_nbr_lookup(iface1, &ipv6_nbr_addrs[1]),
+			"Old address of the reused neighbor found");
+
+	ipv6_nbr_rm_all(iface1);
+
+	for (i = 0; i < ARRAY_SIZE(ipv6_nbr_addrs); i++) {
+		zassert_is_null(net_ipv6_nbr_lookup(NULL, &ipv6_nbr_addrs[i]),
+				"Neighbor %d still found", i);
+	}
+}
+
+static void test_ipv6_nbr_evict(void)
+{
+	struct net_if *iface = INT_TO_POINTER(1);
+	int i;
+
+	/* Routers are never evicted, the other entries are stale from the
+	 * oldest to the newest one.
+	 */
+	zassert_not_null(ipv6_nbr_add(iface, 0, true), "Cannot add router");
+
+	for (i = 1; i < CONFIG_NET_IPV6_MAX_NEIGHBORS; i++) {
+		zassert_not_null(ipv6_nbr_add(iface, i, false),
+				 "Cannot add neighbor %d", i);
+	}
+
+	/* The cache is full, the oldest stale neighbor makes room */
+	zassert_not_null(ipv6_nbr_add(iface, CONFIG_NET_IPV6_MAX_NEIGHBORS,
+				      false),
+			 "Cannot add neighbor to a full cache");
+
+	zassert_is_null(net_ipv6_nbr_lookup(iface, &ipv6_nbr_addrs[1]),
+			"Oldest neighbor not evicted");
+
+	for (i = 0; i < ARRAY_SIZE(ipv6_nbr_addrs); i++) {
+		if (i == 1) {
+			continue;
+		}
+
+		zassert_not_null(net_ipv6_nbr_lookup(iface,
+						     &ipv6_nbr_addrs[i]),
+				 "Neighbor %d evicted", i);
+	}
+
+	ipv6_nbr_rm_all(iface);
+}
 
 /*test case main entry*/
 void test_main(void)
 {
 	k_thread_priority_set(k_current_get(), K_PRIO_COOP(7));
 	ztest_test_suite(neighbor,
-			 ztest_unit_test(test_neighbor));
+			 ztest_unit_test(test_neighbor),
+			 ztest_unit_test(test_ipv6_nbr_hash),
+			 ztest_unit_test(test_ipv6_nbr_evict));
 	ztest_run_test_suite(neighbor);
 }
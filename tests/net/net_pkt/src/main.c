@@ -12,6 +12,8 @@
 #include <net/net_if.h>
 #include <net/net_ip.h>
 #include <net/ethernet.h>
+#include <net/net_mgmt.h>
+#include <net/net_stats.h>
 
 #include <ztest.h>
 
@@ -711,6 +713,215 @@ void test_net_pkt_clone(void)
 	net_pkt_unref(cloned_pkt);
 }
 
+NET_BUF_POOL_DEFINE(read_only_pool, 1, 0, 0, NULL);
+
+/* Data lent read-only can be read and skipped, but it is never written */
+void test_net_pkt_read_only(void)
+{
+	static const u8_t lent[] = "lent data";
+	u8_t data[sizeof(lent)];
+	struct net_buf *frag;
+	struct net_pkt *pkt;
+
+	pkt = net_pkt_alloc_on_iface(eth_if, K_NO_WAIT);
+	zassert_true(pkt != NULL, "Pkt not allocated");
+
+	frag = net_buf_alloc_with_const_data(&read_only_pool, lent,
+					     sizeof(lent), K_NO_WAIT);
+	zassert_true(frag != NULL, "Buffer not allocated");
+	zassert_true(frag->flags & NET_BUF_READ_ONLY, "Buffer not read-only");
+
+	net_pkt_append_buffer(pkt, frag);
+	net_pkt_cursor_init(pkt);
+
+	zassert_equal(net_pkt_read(pkt, data, sizeof(data)), 0,
+		      "Read failed");
+	zassert_mem_equal(data, lent, sizeof(lent), "Wrong data read");
+
+	net_pkt_cursor_init(pkt);
+	net_pkt_set_overwrite(pkt, true);
+
+	zassert_equal(net_pkt_skip(pkt, 1), 0, "Skip failed");
+	zassert_equal(net_pkt_write_u8(pkt, 'x'), -EPERM,
+		      "Read-only data written");
+	zassert_equal(net_pkt_memset(pkt, 0, 1), -EPERM,
+		      "Read-only data cleared");
+	zassert_mem_equal(frag->data, lent, sizeof(lent), "Data changed");
+
+	net_pkt_unref(pkt);
+}
+
+/***************************\
+ * SIZE CLASS BUFFER TESTS *
+\***************************/
+
+#if defined(CONFIG_NET_BUF_SLAB_DATA_SIZE)
+static void test_net_pkt_size_classes(void)
+{
+	struct net_pkt *pkts[CONFIG_NET_BUF_SLAB_LARGE_COUNT];
+	struct net_buf *buf;
+	struct net_pkt *pkt;
+	size_t size = NET_ETH_MTU;
+	int i;
+
+	/* Each packet fits in a single large buffer */
+	for (i = 0; i < ARRAY_SIZE(pkts); i++) {
+		pkts[i] = net_pkt_alloc_with_buffer(eth_if, size, AF_UNSPEC,
+						    0, K_NO_WAIT);
+		zassert_not_null(pkts[i], "Pkt not allocated");
+		zassert_is_null(pkts[i]->buffer->frags,
+				"Large packet split into a chain");
+	}
+
+	/* With the large class used up, the packet is a chain of smaller
+	 * class buffers instead of a failure.
+	 */
+	pkt = net_pkt_alloc_with_buffer(eth_if, size, AF_UNSPEC, 0,
+					K_NO_WAIT);
+	zassert_not_null(pkt, "Pkt not allocated from the smaller classes");
+	zassert_true(pkt_is_of_size(pkt, size), "Pkt has wrong size");
+	zassert_not_null(pkt->buffer->frags, "Pkt not chained");
+
+	for (buf = pkt->buffer; buf; buf = buf->frags) {
+		zassert_true(buf->size <= CONFIG_NET_BUF_SLAB_MEDIUM_SIZE,
+			     "Buffer from the large class");
+	}
+
+	net_pkt_unref(pkt);
+
+	for (i = 0; i < ARRAY_SIZE(pkts); i++) {
+		net_pkt_unref(pkts[i]);
+	}
+
+	/* Small packets take small buffers again */
+	pkt = net_pkt_alloc_with_buffer(eth_if, CONFIG_NET_BUF_SLAB_SMALL_SIZE,
+					AF_UNSPEC, 0, K_NO_WAIT);
+	zassert_not_null(pkt, "Pkt not allocated");
+	zassert_true(pkt_is_of_size(pkt, CONFIG_NET_BUF_SLAB_SMALL_SIZE),
+		     "Pkt has wrong size");
+	zassert_is_null(pkt->buffer->frags, "Small packet chained");
+
+	net_pkt_unref(pkt);
+}
+#else
+static void test_net_pkt_size_classes(void)
+{
+	ztest_test_skip();
+}
+#endif /* CONFIG_NET_BUF_SLAB_DATA_SIZE */
+
+/*************************\
+ * POOL STATISTICS TESTS *
+\*************************/
+
+#if defined(CONFIG_NET_STATISTICS_PKT_POOLS)
+static void get_pool_stats(struct net_stats_pkt_pools *stats)
+{
+	zassert_equal(net_mgmt(NET_REQUEST_STATS_GET_PKT_POOLS, NULL,
+			       stats, sizeof(*stats)), 0,
+		      "Cannot get pool statistics");
+}
+
+/* Return the failures counted for all the sites, and how many sites */
+static u32_t get_site_failures(const struct net_stats_pkt_pools *stats,
+			       int *sites)
+{
+	u32_t failed = 0U;
+	int i;
+
+	*sites = 0;
+
+	for (i = 0; i < ARRAY_SIZE(stats->sites); i++) {
+		if (stats->sites[i].caller) {
+			failed += stats->sites[i].alloc_failed;
+			(*sites)++;
+		}
+	}
+
+	return failed;
+}
+
+static void test_net_pkt_pool_stats(void)
+{
+	struct net_pkt *pkts[CONFIG_NET_PKT_TX_COUNT];
+	struct net_stats_pkt_pools before, after;
+	u32_t failed_before, failed_after;
+	int sites_before, sites_after;
+	struct k_mem_slab *tx;
+	struct net_buf *buf;
+	struct net_pkt *pkt;
+	int count, frags, i;
+
+	net_pkt_get_info(NULL, &tx, NULL, NULL);
+
+	get_pool_stats(&before);
+	failed_before = get_site_failures(&before, &sites_before);
+
+	/* Take all the free TX packets, the watermark is the slab size */
+	for (count = 0; k_mem_slab_num_free_get(tx); count++) {
+		pkts[count] = net_pkt_alloc(K_NO_WAIT);
+		zassert_not_null(pkts[count], "Pkt not allocated");
+	}
+
+	/* Two failures at one site and one at another site */
+	for (i = 0; i < 2; i++) {
+		zassert_is_null(net_pkt_alloc(K_NO_WAIT),
+				"Pkt allocated from an empty slab");
+	}
+
+	zassert_is_null(net_pkt_alloc_on_iface(eth_if, K_NO_WAIT),
+			"Pkt allocated from an empty slab");
+
+	get_pool_stats(&after);
+	failed_after = get_site_failures(&after, &sites_after);
+
+	zassert_equal(after.tx_pkts.max_used, CONFIG_NET_PKT_TX_COUNT,
+		      "Wrong TX packet watermark");
+	zassert_equal(after.tx_pkts.alloc_failed,
+		      before.tx_pkts.alloc_failed + 3,
+		      "Wrong number of failed TX packet allocations");
+	zassert_equal(failed_after, failed_before + 3,
+		      "Failures not counted per site");
+	zassert_equal(sites_after, sites_before + 2,
+		      "Wrong number of failing sites");
+
+	for (i = 0; i < count; i++) {
+		net_pkt_unref(pkts[i]);
+	}
+
+	/* The data buffers of a packet count for the buffer watermark */
+	pkt = net_pkt_alloc_with_buffer(eth_if, sizeof(small_buffer),
+					AF_UNSPEC, 0, K_NO_WAIT);
+	zassert_not_null(pkt, "Pkt not allocated");
+
+	for (buf = pkt->buffer, frags = 0; buf; buf = buf->frags) {
+		frags++;
+	}
+
+	get_pool_stats(&after);
+	zassert_true(after.tx_bufs.max_used >= frags,
+		     "Wrong TX buffer watermark");
+
+	net_pkt_unref(pkt);
+
+	/* The RX packets have their own watermark */
+	pkt = net_pkt_rx_alloc(K_NO_WAIT);
+	zassert_not_null(pkt, "Pkt not allocated");
+
+	get_pool_stats(&after);
+	zassert_true(after.rx_pkts.max_used >= 1, "Wrong RX packet watermark");
+	zassert_equal(after.rx_pkts.alloc_failed, before.rx_pkts.alloc_failed,
+		      "RX failures counted for TX");
+
+	net_pkt_unref(pkt);
+}
+#else
+static void test_net_pkt_pool_stats(void)
+{
+	ztest_test_skip();
+}
+#endif /* CONFIG_NET_STATISTICS_PKT_POOLS */
+
 void test_main(void)
 {
 	eth_if = net_if_get_default();
@@ -723,7 +934,10 @@ void test_main(void)
 			 ztest_unit_test(test_net_pkt_easier_rw_usage),
 			 ztest_unit_test(test_net_pkt_copy),
 			 ztest_unit_test(test_net_pkt_pull),
-			 ztest_unit_test(test_net_pkt_clone)
+			 ztest_unit_test(test_net_pkt_clone),
+			 ztest_unit_test(test_net_pkt_read_only),
+			 ztest_unit_test(test_net_pkt_size_classes),
+			 ztest_unit_test(test_net_pkt_pool_stats)
 		);
 
 	ztest_run_test_suite(net_pkt_tests);
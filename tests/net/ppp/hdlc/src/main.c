@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* The frames are escaped and then decoded back, in blocks of every size,
+ * as the PPP driver does with the data of the UART.
+ */
+
+#include <ztest.h>
+#include <string.h>
+
+#include "ppp_hdlc.h"
+
+#define FCS_LEN 2
+#define MAX_STREAM_LEN 128
+
+/* Address, control, protocol and a payload with the bytes to escape */
+static const u8_t frame[] = {
+	0xff, 0x03, 0x00, 0x21,
+	0x7e, 0x7d, 0x7e, 0x7e, 0x7d, 0x7d, 0x00, 0x1f, 0x20, 0x5d, 0x5e,
+	'P', 'P', 'P', ' ', 'f', 'r', 'a', 'm', 'e', 0x7d, 0x5e, 0x7e,
+	0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x80, 0xfe, 0x7e,
+};
+
+static u8_t stream[MAX_STREAM_LEN];
+static u8_t decoded[MAX_STREAM_LEN];
+
+static bool needs_escape(u8_t byte)
+{
+	return byte == PPP_HDLC_FLAG || byte == PPP_HDLC_ESCAPE ||
+		byte < PPP_HDLC_XOR;
+}
+
+/* Flag, escaped data and FCS, flag. The FCS is the one of fcs_data. */
+static size_t encode(const u8_t *data, const u8_t *fcs_data, size_t len)
+{
+	u8_t fcs[FCS_LEN];
+	size_t consumed;
+	size_t off = 0;
+	u16_t value;
+
+	value = ppp_hdlc_fcs(PPP_HDLC_FCS_INIT, fcs_data, len) ^ 0xffff;
+	fcs[0] = value & 0xff;
+	fcs[1] = value >> 8;
+
+	stream[off++] = PPP_HDLC_FLAG;
+
+	off += ppp_hdlc_escape(data, len, &stream[off],
+			       sizeof(stream) - off, &consumed);
+	zassert_equal(consumed, len, "frame not escaped");
+
+	off += ppp_hdlc_escape(fcs, sizeof(fcs), &stream[off],
+			       sizeof(stream) - off, &consumed);
+	zassert_equal(consumed, sizeof(fcs), "FCS not escaped");
+
+	stream[off++] = PPP_HDLC_FLAG;
+
+	return off;
+}
+
+/* Decode the frame after the opening flag, chunk bytes at a time */
+static size_t decode(size_t len, size_t chunk)
+{
+	size_t off = 1, out = 0, run, n;
+	bool escaped = false;
+	bool end = false;
+
+	while (off < len && !end) {
+		run = ppp_hdlc_unescape(&stream[off], MIN(chunk, len - off),
+					&escaped, &n, &end);
+		zassert_true(run > 0, "no data consumed");
+
+		memcpy(&decoded[out], &stream[off], n);
+		out += n;
+		off += run;
+	}
+
+	zassert_true(end, "no end of frame");
+	zassert_equal(off, len, "data left after the frame");
+	zassert_false(escaped, "escape left pending");
+
+	return out;
+}
+
+static void test_escape(void)
+{
+	size_t len = encode(frame, frame, sizeof(frame));
+	size_t i;
+
+	/* Only the closing flag is left, and every escape byte is
+	 * followed by the escaped form of a byte that needs it.
+	 */
+	for (i = 1; i < len - 1; i++) {
+		zassert_not_equal(stream[i], PPP_HDLC_FLAG,
+				  "flag at %zu", i);
+		zassert_true(stream[i] >= PPP_HDLC_XOR,
+			     "control character at %zu", i);
+
+		if (stream[i] == PPP_HDLC_ESCAPE) {
+			i++;
+			zassert_true(needs_escape(stream[i] ^ PPP_HDLC_XOR),
+				     "needless escape at %zu", i);
+		}
+	}
+}
+
+static void test_escape_small_buffer(void)
+{
+	u8_t full[MAX_STREAM_LEN];
+	u8_t part[3];
+	size_t full_len, len, out, in, consumed, dst_len;
+
+	full_len = ppp_hdlc_escape(frame, sizeof(frame), full, sizeof(full),
+				   &consumed);
+
+	/* An escape sequence is never split between two buffers */
+	for (dst_len = 1; dst_len <= sizeof(part); dst_len++) {
+		in = 0;
+		out = 0;
+
+		while (in < sizeof(frame)) {
+			len = ppp_hdlc_escape(&frame[in], sizeof(frame) - in,
+					      part, dst_len, &consumed);
+			zassert_true(len > 0 || dst_len == 1,
+				     "nothing escaped");
+
+			if (len == 0) {
+				/* An escape needs two bytes of room */
+				zassert_true(needs_escape(frame[in]),
+					     "plain byte not copied");
+				break;
+			}
+
+			zassert_mem_equal(&full[out], part, len,
+					  "wrong escaped data");
+			in += consumed;
+			out += len;
+		}
+
+		if (dst_len > 1) {
+			zassert_equal(out, full_len, "wrong escaped length");
+		}
+	}
+}
+
+static void test_scan(void)
+{
+	u8_t data[16];
+	size_t i;
+
+	(void)memset(data, 'a', sizeof(data));
+	zassert_equal(ppp_hdlc_scan(data, sizeof(data)), sizeof(data),
+		      "special byte found in plain data");
+
+	/* At every place in and around the words that are scanned */
+	for (i = 0; i < sizeof(data); i++) {
+		data[i] = PPP_HDLC_FLAG;
+		zassert_equal(ppp_hdlc_scan(data, sizeof(data)), i,
+			      "flag at %zu not found", i);
+
+		data[i] = PPP_HDLC_ESCAPE;
+		zassert_equal(ppp_hdlc_scan(data, sizeof(data)), i,
+			      "escape at %zu not found", i);
+
+		data[i] = 'a';
+	}
+}
+
+static void test_round_trip(void)
+{
+	size_t len, chunk;
+
+	len = encode(frame, frame, sizeof(frame));
+
+	/* The frame split across buffers at every place, escape
+	 * sequences included.
+	 */
+	for (chunk = 1; chunk <= len; chunk++) {
+		len = encode(frame, frame, sizeof(frame));
+
+		zassert_equal(decode(len, chunk), sizeof(frame) + FCS_LEN,
+			      "wrong length in chunks of %zu", chunk);
+		zassert_mem_equal(decoded, frame, sizeof(frame),
+				  "wrong data in chunks of %zu", chunk);
+		zassert_equal(ppp_hdlc_fcs(PPP_HDLC_FCS_INIT, decoded,
+					   sizeof(frame) + FCS_LEN),
+			      PPP_HDLC_FCS_GOOD,
+			      "bad FCS in chunks of %zu", chunk);
+	}
+}
+
+static void test_bad_fcs(void)
+{
+	u8_t corrupted[sizeof(frame)];
+	size_t len, chunk;
+
+	memcpy(corrupted, frame, sizeof(frame));
+	corrupted[sizeof(frame) / 2] ^= 0x01;
+
+	for (chunk = 1; chunk <= 8; chunk++) {
+		len = encode(corrupted, frame, sizeof(frame));
+
+		zassert_equal(decode(len, chunk), sizeof(frame) + FCS_LEN,
+			      "wrong length in chunks of %zu", chunk);
+		zassert_not_equal(ppp_hdlc_fcs(PPP_HDLC_FCS_INIT, decoded,
+					       sizeof(frame) + FCS_LEN),
+				  PPP_HDLC_FCS_GOOD,
+				  "bad FCS not detected");
+	}
+}
+
+static void test_flag_after_escape(void)
+{
+	u8_t data[] = { 'a', PPP_HDLC_ESCAPE, PPP_HDLC_FLAG, 'b' };
+	bool escaped = false;
+	bool end;
+	size_t n;
+
+	/* The flag aborts the frame and the escape with it */
+	zassert_equal(ppp_hdlc_unescape(data, sizeof(data), &escaped, &n,
+					&end), 3, "flag not consumed");
+	zassert_true(end, "no end of frame");
+	zassert_false(escaped, "escape left pending");
+	zassert_equal(n, 1, "wrong decoded length");
+	zassert_equal(data[0], 'a', "wrong decoded data");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(ppp_hdlc,
+			 ztest_unit_test(test_escape),
+			 ztest_unit_test(test_escape_small_buffer),
+			 ztest_unit_test(test_scan),
+			 ztest_unit_test(test_round_trip),
+			 ztest_unit_test(test_bad_fcs),
+			 ztest_unit_test(test_flag_after_escape));
+
+	ztest_run_test_suite(ppp_hdlc);
+}
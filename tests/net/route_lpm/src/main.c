@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_ROUTE_IPV4_LOG_LEVEL);
+
+#include <ztest.h>
+#include <string.h>
+
+#include <net/net_if.h>
+#include <net/net_pkt.h>
+#include <net/dummy.h>
+
+#include "net_private.h"
+#include "route.h"
+#include "route_lpm.h"
+
+#define MAX_PREFIXES 8
+
+#define ADDR(a, b, c, d) { .s4_addr = { a, b, c, d } }
+
+struct test_route {
+	sys_snode_t node;
+	struct in_addr prefix;
+	u8_t prefix_len;
+};
+
+/* Exactly as many nodes as the bound allows */
+static struct net_route_lpm_node nodes[2 * MAX_PREFIXES - 1];
+static struct net_route_lpm lpm;
+
+static struct net_if *iface1;
+static struct net_if *iface2;
+
+static void test_iface_init(struct net_if *iface)
+{
+	static u8_t macs[2][6] = {
+		{ 0x00, 0x00, 0x5e, 0x00, 0x53, 0x01 },
+		{ 0x00, 0x00, 0x5e, 0x00, 0x53, 0x02 },
+	};
+	static int count;
+
+	net_if_set_link_addr(iface, macs[count], sizeof(macs[count]),
+			     NET_LINK_DUMMY);
+	count++;
+}
+
+static int test_send(struct device *dev, struct net_pkt *pkt)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(pkt);
+
+	return 0;
+}
+
+static struct dummy_api test_api = {
+	.iface_api.init = test_iface_init,
+	.send = test_send,
+};
+
+static int test_dev_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return 0;
+}
+
+NET_DEVICE_INIT_INSTANCE(route_lpm_1, "route_lpm_1", iface1,
+			 test_dev_init, device_pm_control_nop, NULL, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &test_api,
+			 DUMMY_L2, NET_L2_GET_CTX_TYPE(DUMMY_L2), 1500);
+
+NET_DEVICE_INIT_INSTANCE(route_lpm_2, "route_lpm_2", iface2,
+			 test_dev_init, device_pm_control_nop, NULL, NULL,
+			 CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &test_api,
+			 DUMMY_L2, NET_L2_GET_CTX_TYPE(DUMMY_L2), 1500);
+
+static int free_nodes(void)
+{
+	struct net_route_lpm_node *node;
+	int count = 0;
+
+	for (node = lpm.free; node; node = node->child[0]) {
+		count++;
+	}
+
+	return count;
+}
+
+static int route_add(struct test_route *route)
+{
+	return net_route_lpm_add(&lpm, route->prefix.s4_addr,
+				 route->prefix_len, &route->node);
+}
+
+static int route_del(struct test_route *route)
+{
+	return net_route_lpm_del(&lpm, route->prefix.s4_addr,
+				 route->prefix_len, &route->node);
+}
+
+static struct test_route *route_lookup(const struct in_addr *addr)
+{
+	sys_snode_t *entry;
+
+	entry = net_route_lpm_lookup(&lpm, addr->s4_addr, 32, NULL, NULL);
+	if (!entry) {
+		return NULL;
+	}
+
+	return CONTAINER_OF(entry, struct test_route, node);
+}
+
+static void test_lpm_add_del(void)
+{
+	struct test_route routes[] = {
+		{ .prefix = ADDR(10, 1, 0, 0), .prefix_len = 16 },
+		{ .prefix = ADDR(10, 2, 0, 0), .prefix_len = 16 },
+		{ .prefix = ADDR(10, 0, 0, 0), .prefix_len = 8 },
+	};
+	struct in_addr addr1 = ADDR(10, 1, 2, 3);
+	struct in_addr addr2 = ADDR(10, 2, 2, 3);
+	struct in_addr addr3 = ADDR(10, 3, 2, 3);
+	int i;
+
+	net_route_lpm_init(&lpm, nodes, ARRAY_SIZE(nodes));
+	zassert_equal(free_nodes(), ARRAY_SIZE(nodes), "nodes not free");
+	zassert_is_null(route_lookup(&addr1), "route in an empty index");
+
+	for (i = 0; i < ARRAY_SIZE(routes); i++) {
+		zassert_equal(route_add(&routes[i]), 0, "cannot add route %d",
+			      i);
+	}
+
+	/* Two diverging /16 need a branch at 10.0.0.0/14, which the /8
+	 * goes above of.
+	 */
+	zassert_equal(free_nodes(), ARRAY_SIZE(nodes) - 4,
+		      "wrong number of nodes used");
+	zassert_equal(lpm.root->prefix_len, 8, "/8 not at the root");
+
+	zassert_equal_ptr(route_lookup(&addr1), &routes[0], "wrong route");
+	zassert_equal_ptr(route_lookup(&addr2), &routes[1], "wrong route");
+	zassert_equal_ptr(route_lookup(&addr3), &routes[2], "wrong route");
+
+	/* Deleting a /16 leaves a branch with one child, which goes too */
+	zassert_equal(route_del(&routes[0]), 0, "cannot delete route");
+	zassert_equal(free_nodes(), ARRAY_SIZE(nodes) - 2,
+		      "branch not collapsed");
+	zassert_equal_ptr(route_lookup(&addr1), &routes[2], "wrong route");
+	zassert_equal_ptr(route_lookup(&addr2), &routes[1], "wrong route");
+
+	zassert_equal(route_del(&routes[0]), -ENOENT,
+		      "route deleted twice");
+
+	/* Deleting the /8 moves the /16 up to the root */
+	zassert_equal(route_del(&routes[2]), 0, "cannot delete route");
+	zassert_equal(free_nodes(), ARRAY_SIZE(nodes) - 1,
+		      "node not freed");
+	zassert_equal(lpm.root->prefix_len, 16, "/16 not at the root");
+	zassert_is_null(route_lookup(&addr3), "route not deleted");
+
+	zassert_equal(route_del(&routes[1]), 0, "cannot delete route");
+	zassert_is_null(lpm.root, "index not empty");
+	zassert_equal(free_nodes(), ARRAY_SIZE(nodes), "nodes leaked");
+}
+
+static void test_lpm_longest_match(void)
+{
+	struct test_route routes[] = {
+		{ .prefix = ADDR(0, 0, 0, 0), .prefix_len = 0 },
+		{ .prefix = ADDR(10, 0, 0, 0), .prefix_len = 8 },
+		{ .prefix = ADDR(10, 1, 2, 3), .prefix_len = 32 },
+		{ .prefix = ADDR(10, 1, 0, 0), .prefix_len = 16 },
+		{ .prefix = ADDR(10, 1, 2, 0), .prefix_len = 24 },
+		{ .prefix = ADDR(10, 1, 2, 128), .prefix_len = 25 },
+	};
+	static const struct {
+		struct in_addr addr;
+		int route;
+	} lookups[] = {
+		{ ADDR(10, 1, 2, 3), 2 },
+		{ ADDR(10, 1, 2, 4), 4 },
+		{ ADDR(10, 1, 2, 200), 5 },
+		{ ADDR(10, 1, 3, 3), 3 },
+		{ ADDR(10, 2, 2, 3), 1 },
+		{ ADDR(11, 1, 2, 3), 0 },
+		{ ADDR(255, 255, 255, 255), 0 },
+	};
+	struct in_addr addr = ADDR(11, 1, 2, 3);
+	int i;
+
+	net_route_lpm_init(&lpm, nodes, ARRAY_SIZE(nodes));
+
+	/* Added out of order, the trie is the same */
+	for (i = 0; i < ARRAY_SIZE(routes); i++) {
+		zassert_equal(route_add(&routes[i]), 0, "cannot add route %d",
+			      i);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(lookups); i++) {
+		zassert_equal_ptr(route_lookup(&lookups[i].addr),
+				  &routes[lookups[i].route],
+				  "wrong route for lookup %d", i);
+	}
+
+	/* Only the default route matched */
+	zassert_equal(route_del(&routes[0]), 0, "cannot delete route");
+	zassert_is_null(route_lookup(&addr), "deleted /0 matched");
+
+	/* The /32 goes, its /24 is next */
+	zassert_equal(route_del(&routes[2]), 0, "cannot delete route");
+	zassert_equal_ptr(route_lookup(&lookups[0].addr), &routes[4],
+			  "wrong route after deleting the /32");
+
+	for (i = 1; i < ARRAY_SIZE(routes); i++) {
+		if (i != 2) {
+			zassert_equal(route_del(&routes[i]), 0,
+				      "cannot delete route %d", i);
+		}
+	}
+
+	zassert_is_null(lpm.root, "index not empty");
+	zassert_equal(free_nodes(), ARRAY_SIZE(nodes), "nodes leaked");
+}
+
+static void test_lpm_node_bound(void)
+{
+	struct test_route routes[MAX_PREFIXES + 1];
+	int i;
+
+	net_route_lpm_init(&lpm, nodes, ARRAY_SIZE(nodes));
+
+	/* Host routes that diverge at every bit of the first byte need a
+	 * branch node for all but one of them.
+	 */
+	for (i = 0; i < ARRAY_SIZE(routes); i++) {
+		routes[i].prefix.s_addr = 0;
+		routes[i].prefix.s4_addr[0] = i * 0x1f;
+		routes[i].prefix_len = 32;
+	}
+
+	for (i = 0; i < MAX_PREFIXES; i++) {
+		zassert_equal(route_add(&routes[i]), 0, "cannot add route %d",
+			      i);
+	}
+
+	zassert_equal(free_nodes(), 0, "bound not reached");
+
+	/* Past the bound, and the index is left as it was */
+	zassert_equal(route_add(&routes[MAX_PREFIXES]), -ENOMEM,
+		      "route added past the bound");
+
+	for (i = 0; i < MAX_PREFIXES; i++) {
+		zassert_equal_ptr(route_lookup(&routes[i].prefix), &routes[i],
+				  "wrong route %d", i);
+	}
+
+	zassert_is_null(route_lookup(&routes[MAX_PREFIXES].prefix),
+			"route past the bound found");
+
+	for (i = 0; i < MAX_PREFIXES; i++) {
+		zassert_equal(route_del(&routes[i]), 0,
+			      "cannot delete route %d", i);
+	}
+
+	zassert_is_null(lpm.root, "index not empty");
+	zassert_equal(free_nodes(), ARRAY_SIZE(nodes), "nodes leaked");
+}
+
+static void count_route(struct net_route_entry_ipv4 *entry,
+			void *user_data)
+{
+	zassert_true(entry->is_used, "unused route");
+
+	(*(int *)user_data)++;
+}
+
+static void test_ipv4_iface_lookup(void)
+{
+	struct in_addr prefix8 = ADDR(10, 0, 0, 0);
+	struct in_addr prefix16 = ADDR(10, 1, 0, 0);
+	struct in_addr host = ADDR(10, 1, 2, 3);
+	struct in_addr other = ADDR(10, 2, 0, 1);
+	struct in_addr gw1 = ADDR(192, 0, 2, 1);
+	struct in_addr gw2 = ADDR(192, 0, 2, 2);
+	struct net_route_entry_ipv4 *route8, *route16, *route16_2;
+	int count = 0;
+
+	iface1 = net_if_lookup_by_dev(device_get_binding("route_lpm_1"));
+	iface2 = net_if_lookup_by_dev(device_get_binding("route_lpm_2"));
+	zassert_not_null(iface1, "no iface 1");
+	zassert_not_null(iface2, "no iface 2");
+
+	route8 = net_route_ipv4_add(iface1, &prefix8, 8, &gw1);
+	route16 = net_route_ipv4_add(iface2, &prefix16, 16, NULL);
+	zassert_not_null(route8, "cannot add route");
+	zassert_not_null(route16, "cannot add route");
+
+	zassert_is_null(net_route_ipv4_add(iface1, &prefix8, 33, NULL),
+			"route with a prefix longer than 32 added");
+
+	zassert_equal_ptr(net_route_ipv4_lookup(NULL, &host), route16,
+			  "longest prefix not found");
+	zassert_equal_ptr(net_route_ipv4_lookup(iface1, &host), route8,
+			  "route of another iface found");
+	zassert_equal_ptr(net_route_ipv4_lookup(iface2, &host), route16,
+			  "route of the iface not found");
+	zassert_is_null(net_route_ipv4_lookup(iface2, &other),
+			"route of another iface found");
+
+	/* The same prefix on both ifaces, each found by its own iface */
+	route16_2 = net_route_ipv4_add(iface1, &prefix16, 16, &gw2);
+	zassert_not_null(route16_2, "cannot add route");
+	zassert_not_equal(route16_2, route16, "route of the other iface");
+
+	zassert_equal_ptr(net_route_ipv4_lookup(iface1, &host), route16_2,
+			  "wrong route for iface 1");
+	zassert_equal_ptr(net_route_ipv4_lookup(iface2, &host), route16,
+			  "wrong route for iface 2");
+
+	/* Adding it again updates the gateway */
+	zassert_equal_ptr(net_route_ipv4_add(iface1, &prefix16, 16, &gw1),
+			  route16_2, "route added twice");
+	zassert_true(net_ipv4_addr_cmp(&route16_2->gw, &gw1),
+		     "gateway not updated");
+
+	zassert_equal(net_route_ipv4_foreach(count_route, &count), 3,
+		      "wrong number of routes");
+	zassert_equal(count, 3, "callback not called for every route");
+
+	/* With the route of iface 1 gone, its /8 is next */
+	zassert_equal(net_route_ipv4_del(route16_2), 0,
+		      "cannot delete route");
+	zassert_equal_ptr(net_route_ipv4_lookup(iface1, &host), route8,
+			  "deleted route found");
+	zassert_equal(net_route_ipv4_del(route16_2), -ENOENT,
+		      "route deleted twice");
+
+	zassert_equal(net_route_ipv4_del(route16), 0, "cannot delete route");
+	zassert_equal(net_route_ipv4_del(route8), 0, "cannot delete route");
+	zassert_is_null(net_route_ipv4_lookup(NULL, &host),
+			"deleted route found");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(net_route_lpm,
+			 ztest_unit_test(test_lpm_add_del),
+			 ztest_unit_test(test_lpm_longest_match),
+			 ztest_unit_test(test_lpm_node_bound),
+			 ztest_unit_test(test_ipv4_iface_lookup));
+
+	ztest_run_test_suite(net_route_lpm);
+}
@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_SOCKETS_LOG_LEVEL);
+
+#include <ztest_assert.h>
+
+#include <net/socket.h>
+
+#include "../../socket_helpers.h"
+
+#define ANY_PORT 0
+#define SERVER_PORT 4242
+#define WAIT_MS 100
+#define TCP_TEARDOWN_TIMEOUT K_SECONDS(1)
+
+static const char test_str[] = "foo";
+
+struct epoll_test {
+	int epfd;
+	int client;
+	int server;
+	struct sockaddr_in server_addr;
+};
+
+static void test_setup(struct epoll_test *t, u32_t events)
+{
+	struct zsock_epoll_event event = {
+		.events = events,
+		.data.u32 = SERVER_PORT,
+	};
+	struct sockaddr_in client_addr;
+	int rv;
+
+	prepare_sock_udp_v4(CONFIG_NET_CONFIG_MY_IPV4_ADDR, ANY_PORT,
+			    &t->client, &client_addr);
+	prepare_sock_udp_v4(CONFIG_NET_CONFIG_MY_IPV4_ADDR, SERVER_PORT,
+			    &t->server, &t->server_addr);
+
+	rv = bind(t->server, (struct sockaddr *)&t->server_addr,
+		  sizeof(t->server_addr));
+	zassert_equal(rv, 0, "bind failed");
+
+	t->epfd = zsock_epoll_create(1);
+	zassert_true(t->epfd >= 0, "epoll_create failed");
+
+	rv = zsock_epoll_ctl(t->epfd, ZSOCK_EPOLL_CTL_ADD, t->server, &event);
+	zassert_equal(rv, 0, "epoll_ctl add failed");
+}
+
+static void test_teardown(struct epoll_test *t)
+{
+	zassert_equal(close(t->client), 0, "close failed");
+	zassert_equal(close(t->server), 0, "close failed");
+	zassert_equal(close(t->epfd), 0, "close failed");
+}
+
+static void test_send(struct epoll_test *t)
+{
+	ssize_t ret;
+
+	ret = sendto(t->client, test_str, sizeof(test_str), 0,
+		     (struct sockaddr *)&t->server_addr,
+		     sizeof(t->server_addr));
+	zassert_equal(ret, sizeof(test_str), "sendto failed");
+}
+
+static void test_recv(struct epoll_test *t)
+{
+	char buf[sizeof(test_str)];
+	ssize_t ret;
+
+	ret = recv(t->server, buf, sizeof(buf), ZSOCK_MSG_DONTWAIT);
+	zassert_equal(ret, sizeof(test_str), "recv failed");
+}
+
+static int test_wait(struct epoll_test *t, int timeout)
+{
+	struct zsock_epoll_event events[2];
+	int ret;
+
+	ret = zsock_epoll_wait(t->epfd, events, ARRAY_SIZE(events), timeout);
+	zassert_true(ret >= 0, "epoll_wait failed (%d)", errno);
+
+	if (ret > 0) {
+		zassert_equal(ret, 1, "too many events");
+		zassert_equal(events[0].events, ZSOCK_EPOLLIN,
+			      "unexpected events");
+		zassert_equal(events[0].data.u32, SERVER_PORT,
+			      "unexpected user data");
+	}
+
+	return ret;
+}
+
+void test_epoll_level(void)
+{
+	struct zsock_epoll_event event = {
+		.events = ZSOCK_EPOLLIN,
+	};
+	struct epoll_test t;
+	int rv;
+
+	test_setup(&t, ZSOCK_EPOLLIN);
+
+	zassert_equal(test_wait(&t, 0), 0, "socket should not be ready");
+
+	test_send(&t);
+	zassert_equal(test_wait(&t, WAIT_MS), 1, "socket not reported");
+
+	/* Reported as long as the data is there */
+	zassert_equal(test_wait(&t, 0), 1, "socket not reported again");
+
+	test_recv(&t);
+	zassert_equal(test_wait(&t, 0), 0, "socket should not be ready");
+
+	rv = zsock_epoll_ctl(t.epfd, ZSOCK_EPOLL_CTL_ADD, t.server, &event);
+	zassert_equal(rv, -1, "second add should fail");
+	zassert_equal(errno, EEXIST, "unexpected errno");
+
+	rv = zsock_epoll_ctl(t.epfd, ZSOCK_EPOLL_CTL_MOD, t.client, &event);
+	zassert_equal(rv, -1, "mod of unregistered socket should fail");
+	zassert_equal(errno, ENOENT, "unexpected errno");
+
+	/* Only sockets can be registered */
+	rv = zsock_epoll_ctl(t.epfd, ZSOCK_EPOLL_CTL_ADD, t.epfd, &event);
+	zassert_equal(rv, -1, "add of event set should fail");
+	zassert_equal(errno, EPERM, "unexpected errno");
+
+	rv = zsock_epoll_ctl(t.epfd, ZSOCK_EPOLL_CTL_DEL, t.server, NULL);
+	zassert_equal(rv, 0, "epoll_ctl del failed");
+
+	test_send(&t);
+	zassert_equal(test_wait(&t, WAIT_MS), 0,
+		      "removed socket should not be reported");
+	test_recv(&t);
+
+	test_teardown(&t);
+}
+
+void test_epoll_edge(void)
+{
+	struct epoll_test t;
+
+	test_setup(&t, ZSOCK_EPOLLIN | ZSOCK_EPOLLET);
+
+	test_send(&t);
+	zassert_equal(test_wait(&t, WAIT_MS), 1, "socket not reported");
+
+	/* Not reported again until more data comes */
+	zassert_equal(test_wait(&t, 0), 0, "socket reported twice");
+
+	test_send(&t);
+	zassert_equal(test_wait(&t, WAIT_MS), 1, "socket not reported");
+
+	test_recv(&t);
+	test_recv(&t);
+
+	test_teardown(&t);
+}
+
+void test_epoll_oneshot(void)
+{
+	struct zsock_epoll_event event = {
+		.events = ZSOCK_EPOLLIN | ZSOCK_EPOLLONESHOT,
+		.data.u32 = SERVER_PORT,
+	};
+	struct epoll_test t;
+	int rv;
+
+	test_setup(&t, event.events);
+
+	test_send(&t);
+	zassert_equal(test_wait(&t, WAIT_MS), 1, "socket not reported");
+
+	test_send(&t);
+	zassert_equal(test_wait(&t, WAIT_MS), 0,
+		      "disabled socket should not be reported");
+
+	/* Enabling it again reports the queued data */
+	rv = zsock_epoll_ctl(t.epfd, ZSOCK_EPOLL_CTL_MOD, t.server, &event);
+	zassert_equal(rv, 0, "epoll_ctl mod failed");
+	zassert_equal(test_wait(&t, 0), 1, "socket not reported");
+
+	test_recv(&t);
+	test_recv(&t);
+
+	test_teardown(&t);
+}
+
+void test_epoll_close(void)
+{
+	struct epoll_test t;
+
+	test_setup(&t, ZSOCK_EPOLLIN);
+
+	test_send(&t);
+	zassert_equal(test_wait(&t, WAIT_MS), 1, "socket not reported");
+
+	/* A closed socket is removed from the event set */
+	zassert_equal(close(t.server), 0, "close failed");
+	zassert_equal(test_wait(&t, 0), 0,
+		      "closed socket should not be reported");
+
+	zassert_equal(close(t.client), 0, "close failed");
+	zassert_equal(close(t.epfd), 0, "close failed");
+}
+
+void test_epoll_accept(void)
+{
+	struct zsock_epoll_event event = {
+		.events = ZSOCK_EPOLLIN,
+		.data.u32 = SERVER_PORT,
+	};
+	struct sockaddr_in client_addr;
+	struct sockaddr addr;
+	socklen_t addrlen = sizeof(addr);
+	struct epoll_test t;
+	int new_sock;
+	int rv;
+
+	prepare_sock_tcp_v4(CONFIG_NET_CONFIG_MY_IPV4_ADDR, ANY_PORT,
+			    &t.client, &client_addr);
+	prepare_sock_tcp_v4(CONFIG_NET_CONFIG_MY_IPV4_ADDR, SERVER_PORT,
+			    &t.server, &t.server_addr);
+
+	rv = bind(t.server, (struct sockaddr *)&t.server_addr,
+		  sizeof(t.server_addr));
+	zassert_equal(rv, 0, "bind failed");
+	zassert_equal(listen(t.server, 1), 0, "listen failed");
+
+	t.epfd = zsock_epoll_create(1);
+	zassert_true(t.epfd >= 0, "epoll_create failed");
+
+	rv = zsock_epoll_ctl(t.epfd, ZSOCK_EPOLL_CTL_ADD, t.server, &event);
+	zassert_equal(rv, 0, "epoll_ctl add failed");
+
+	zassert_equal(test_wait(&t, 0), 0, "socket should not be ready");
+
+	/* A pending connection makes the listening socket readable */
+	rv = connect(t.client, (struct sockaddr *)&t.server_addr,
+		     sizeof(t.server_addr));
+	zassert_equal(rv, 0, "connect failed");
+	zassert_equal(test_wait(&t, WAIT_MS), 1, "connection not reported");
+	zassert_equal(test_wait(&t, 0), 1, "connection not reported again");
+
+	new_sock = accept(t.server, &addr, &addrlen);
+	zassert_true(new_sock >= 0, "accept failed");
+	zassert_equal(test_wait(&t, 0), 0, "socket should not be ready");
+
+	zassert_equal(close(new_sock), 0, "close failed");
+	test_teardown(&t);
+
+	k_sleep(TCP_TEARDOWN_TIMEOUT);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(socket_epoll,
+			 ztest_unit_test(test_epoll_level),
+			 ztest_unit_test(test_epoll_edge),
+			 ztest_unit_test(test_epoll_oneshot),
+			 ztest_unit_test(test_epoll_close),
+			 ztest_unit_test(test_epoll_accept));
+
+	ztest_run_test_suite(socket_epoll);
+}
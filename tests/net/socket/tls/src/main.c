@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_SOCKETS_LOG_LEVEL);
+
+#include <ztest.h>
+#include <string.h>
+
+#include <net/socket.h>
+#include <net/tls_credentials.h>
+
+#define SERVER_PORT 4243
+#define SILENT_PORT 4244
+#define SERVER_CERTIFICATE_TAG 1
+#define STACK_SIZE 4096
+#define THREAD_PRIORITY K_PRIO_PREEMPT(8)
+
+/* Both ends of a connection run a handshake, so a limit of two lets one
+ * connection over the loopback interface be set up at a time.
+ */
+#define MAX_HANDSHAKES CONFIG_NET_SOCKETS_TLS_MAX_HANDSHAKES
+
+static const unsigned char server_certificate[] = {
+#include "echo-apps-cert.der.inc"
+};
+
+/* This is the private key in pkcs#8 format. */
+static const unsigned char private_key[] = {
+#include "echo-apps-key.der.inc"
+};
+
+static const char test_str[] = "test data";
+
+static struct sockaddr_in server_addr = {
+	.sin_family = AF_INET,
+	.sin_port = htons(SERVER_PORT),
+	.sin_addr = { { { 127, 0, 0, 1 } } },
+};
+
+/* Accepts TCP connections but never answers a TLS handshake */
+static struct sockaddr_in silent_addr = {
+	.sin_family = AF_INET,
+	.sin_port = htons(SILENT_PORT),
+	.sin_addr = { { { 127, 0, 0, 1 } } },
+};
+
+static int server_sock = -1;
+static int silent_sock = -1;
+
+struct client {
+	struct sockaddr_in *addr;
+	struct k_sem done;
+	int sock;
+	int err;
+};
+
+static K_THREAD_STACK_ARRAY_DEFINE(client_stacks, 2, STACK_SIZE);
+static struct k_thread client_threads[2];
+
+static void tls_server(void)
+{
+	char buf[32];
+	ssize_t len;
+	int client;
+
+	while (true) {
+		client = accept(server_sock, NULL, NULL);
+		if (client < 0) {
+			continue;
+		}
+
+		/* Echo until the client closes the connection */
+		while ((len = recv(client, buf, sizeof(buf), 0)) > 0) {
+			(void)send(client, buf, len, 0);
+		}
+
+		(void)close(client);
+	}
+}
+
+K_THREAD_DEFINE(tls_server_thread_id, STACK_SIZE,
+		tls_server, NULL, NULL, NULL,
+		THREAD_PRIORITY, 0, K_FOREVER);
+
+static int client_connect(struct sockaddr_in *addr)
+{
+	int verify = TLS_PEER_VERIFY_NONE;
+	int sock, err;
+
+	sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TLS_1_2);
+	if (sock < 0) {
+		return -1;
+	}
+
+	if (setsockopt(sock, SOL_TLS, TLS_PEER_VERIFY, &verify,
+		       sizeof(verify)) < 0 ||
+	    connect(sock, (struct sockaddr *)addr, sizeof(*addr)) < 0) {
+		err = errno;
+		(void)close(sock);
+		errno = err;
+		return -1;
+	}
+
+	return sock;
+}
+
+static void client_fn(void *p1, void *p2, void *p3)
+{
+	struct client *client = p1;
+
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	client->sock = client_connect(client->addr);
+	client->err = client->sock < 0 ? errno : 0;
+
+	k_sem_give(&client->done);
+}
+
+static void client_start(int i, struct client *client,
+			 struct sockaddr_in *addr)
+{
+	client->addr = addr;
+	client->sock = -1;
+	k_sem_init(&client->done, 0, 1);
+
+	k_thread_create(&client_threads[i], client_stacks[i],
+			K_THREAD_STACK_SIZEOF(client_stacks[i]), client_fn,
+			client, NULL, NULL, THREAD_PRIORITY, 0, K_NO_WAIT);
+}
+
+static void test_setup(void)
+{
+	sec_tag_t sec_tag_list[] = { SERVER_CERTIFICATE_TAG };
+	int ret;
+
+	ret = tls_credential_add(SERVER_CERTIFICATE_TAG,
+				 TLS_CREDENTIAL_SERVER_CERTIFICATE,
+				 server_certificate,
+				 sizeof(server_certificate));
+	zassert_equal(ret, 0, "cannot add server certificate");
+
+	ret = tls_credential_add(SERVER_CERTIFICATE_TAG,
+				 TLS_CREDENTIAL_PRIVATE_KEY,
+				 private_key, sizeof(private_key));
+	zassert_equal(ret, 0, "cannot add private key");
+
+	server_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TLS_1_2);
+	zassert_true(server_sock >= 0, "socket failed");
+
+	ret = setsockopt(server_sock, SOL_TLS, TLS_SEC_TAG_LIST,
+			 sec_tag_list, sizeof(sec_tag_list));
+	zassert_equal(ret, 0, "cannot set credentials");
+
+	zassert_equal(bind(server_sock, (struct sockaddr *)&server_addr,
+			   sizeof(server_addr)), 0, "bind failed");
+	zassert_equal(listen(server_sock, 1), 0, "listen failed");
+
+	silent_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	zassert_true(silent_sock >= 0, "socket failed");
+
+	zassert_equal(bind(silent_sock, (struct sockaddr *)&silent_addr,
+			   sizeof(silent_addr)), 0, "bind failed");
+	zassert_equal(listen(silent_sock, 1), 0, "listen failed");
+
+	k_thread_start(tls_server_thread_id);
+}
+
+static void test_echo(void)
+{
+	char buf[sizeof(test_str)];
+	int sock;
+
+	sock = client_connect(&server_addr);
+	zassert_true(sock >= 0, "connect failed (%d)", errno);
+
+	zassert_equal(send(sock, test_str, sizeof(test_str), 0),
+		      sizeof(test_str), "send failed");
+	zassert_equal(recv(sock, buf, sizeof(buf), 0), sizeof(buf),
+		      "recv failed");
+	zassert_mem_equal(buf, test_str, sizeof(test_str), "wrong data");
+
+	zassert_equal(close(sock), 0, "close failed");
+}
+
+static void test_handshake_mem_peak(void)
+{
+	socklen_t optlen;
+	int peak = 0;
+	int sock, ret;
+
+	sock = client_connect(&server_addr);
+	zassert_true(sock >= 0, "connect failed (%d)", errno);
+
+	optlen = sizeof(peak);
+	ret = getsockopt(sock, SOL_TLS, TLS_HANDSHAKE_MEM_PEAK, &peak,
+			 &optlen);
+
+#if defined(CONFIG_MBEDTLS_ENABLE_HEAP)
+	zassert_equal(ret, 0, "getsockopt failed (%d)", errno);
+	zassert_true(peak > 0, "no memory measured");
+	zassert_true(peak <= CONFIG_MBEDTLS_HEAP_SIZE, "peak past the heap");
+#else
+	/* Only the mbedTLS heap can be measured */
+	zassert_equal(ret, -1, "getsockopt should fail");
+	zassert_equal(errno, ENOTSUP, "wrong errno");
+#endif
+
+	optlen = sizeof(peak) - 1;
+	ret = getsockopt(sock, SOL_TLS, TLS_HANDSHAKE_MEM_PEAK, &peak,
+			 &optlen);
+	zassert_equal(ret, -1, "getsockopt should fail");
+	zassert_equal(errno, EINVAL, "wrong errno");
+
+	zassert_equal(close(sock), 0, "close failed");
+}
+
+static void test_handshake_limit(void)
+{
+	struct client stalled, waiting;
+	int silent_client;
+
+	zassert_equal(MAX_HANDSHAKES, 2, "test expects two handshake slots");
+
+	/* Takes a slot, and keeps it as the server does not answer */
+	client_start(0, &stalled, &silent_addr);
+
+	silent_client = accept(silent_sock, NULL, NULL);
+	zassert_true(silent_client >= 0, "accept failed");
+	k_sleep(K_MSEC(200));
+
+	/* The client side takes the last slot, the server side of the
+	 * connection has to wait.
+	 */
+	client_start(1, &waiting, &server_addr);
+	zassert_equal(k_sem_take(&waiting.done, K_MSEC(500)), -EAGAIN,
+		      "handshake past the limit did not wait");
+
+	/* Closing the connection ends the stalled handshake */
+	zassert_equal(close(silent_client), 0, "close failed");
+
+	zassert_equal(k_sem_take(&stalled.done, K_SECONDS(5)), 0,
+		      "stalled handshake did not end");
+	zassert_true(stalled.sock < 0, "stalled handshake succeeded");
+
+	zassert_equal(k_sem_take(&waiting.done, K_SECONDS(10)), 0,
+		      "waiting handshake did not resume");
+	zassert_true(waiting.sock >= 0, "waiting handshake failed (%d)",
+		     waiting.err);
+
+	zassert_equal(close(waiting.sock), 0, "close failed");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(socket_tls,
+			 ztest_unit_test(test_setup),
+			 ztest_unit_test(test_echo),
+			 ztest_unit_test(test_handshake_mem_peak),
+			 ztest_unit_test(test_handshake_limit));
+
+	ztest_run_test_suite(socket_tls);
+}
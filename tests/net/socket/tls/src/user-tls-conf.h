@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Added at the end of the generic mbedTLS config */
+
+#if defined(CONFIG_MBEDTLS_ENABLE_HEAP)
+/* Needed for the TLS_HANDSHAKE_MEM_PEAK socket option */
+#define MBEDTLS_MEMORY_DEBUG
+#else
+/* Needed for CONFIG_NET_SOCKETS_TLS_STATIC_BUFFERS */
+#define MBEDTLS_PLATFORM_C
+#define MBEDTLS_PLATFORM_MEMORY
+#endif
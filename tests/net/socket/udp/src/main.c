@@ -13,6 +13,8 @@ LOG_MODULE_REGISTER(net_test, CONFIG_NET_SOCKETS_LOG_LEVEL);
 
 #include <net/socket.h>
 #include <net/ethernet.h>
+#include <net/net_mgmt.h>
+#include <net/net_stats.h>
 
 #include "ipv6.h"
 #include "../../socket_helpers.h"
@@ -344,6 +346,202 @@ void test_so_priority(void)
 	zassert_equal(rv, 0, "close failed");
 }
 
+void test_so_rcvbuf(void)
+{
+	struct sockaddr_in bind_addr4;
+	socklen_t optlen;
+	int sock, rv;
+	int optval;
+	int buf_size;
+
+	if (!IS_ENABLED(CONFIG_NET_CONTEXT_RCVBUF)) {
+		ztest_test_skip();
+	}
+
+	prepare_sock_udp_v4(CONFIG_NET_CONFIG_MY_IPV4_ADDR, 55556,
+			    &sock, &bind_addr4);
+
+	optlen = sizeof(optval);
+	rv = getsockopt(sock, SOL_SOCKET, SO_RCVBUF, &optval, &optlen);
+	zassert_equal(rv, 0, "getsockopt failed (%d)", errno);
+	zassert_equal(optlen, sizeof(optval), "invalid optlen");
+	zassert_true(optval > 0, "no default quota");
+
+	/* The quota is kept in whole buffers, rounded up */
+	optval = 1;
+	rv = setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &optval, sizeof(optval));
+	zassert_equal(rv, 0, "setsockopt failed (%d)", errno);
+
+	optlen = sizeof(optval);
+	rv = getsockopt(sock, SOL_SOCKET, SO_RCVBUF, &buf_size, &optlen);
+	zassert_equal(rv, 0, "getsockopt failed (%d)", errno);
+	zassert_true(buf_size >= 1, "quota not rounded up");
+
+	optval = buf_size + 1;
+	rv = setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &optval, sizeof(optval));
+	zassert_equal(rv, 0, "setsockopt failed (%d)", errno);
+
+	optlen = sizeof(optval);
+	rv = getsockopt(sock, SOL_SOCKET, SO_RCVBUF, &optval, &optlen);
+	zassert_equal(rv, 0, "getsockopt failed (%d)", errno);
+	zassert_equal(optval, 2 * buf_size, "quota not rounded up");
+
+	optval = 0;
+	rv = setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &optval, sizeof(optval));
+	zassert_equal(rv, -1, "empty quota accepted");
+	zassert_equal(errno, EINVAL, "wrong errno %d", errno);
+
+	rv = close(sock);
+	zassert_equal(rv, 0, "close failed");
+}
+
+#if defined(CONFIG_NET_CONTEXT_RCVBUF) && \
+	defined(CONFIG_NET_STATISTICS_PKT_POOLS)
+static void get_pool_stats(struct net_stats_pkt_pools *stats)
+{
+	zassert_equal(net_mgmt(NET_REQUEST_STATS_GET_PKT_POOLS, NULL,
+			       stats, sizeof(*stats)), 0,
+		      "cannot get pool statistics");
+}
+
+/* Open a pair of sockets on the local address, the datagrams sent to the
+ * server are received synchronously through the loopback path.
+ */
+static void prepare_rcvbuf_socks(u16_t port, int *client, int *server,
+				 struct sockaddr_in *server_addr)
+{
+	struct sockaddr_in client_addr;
+	int rv;
+
+	prepare_sock_udp_v4(CONFIG_NET_CONFIG_MY_IPV4_ADDR, ANY_PORT,
+			    client, &client_addr);
+	prepare_sock_udp_v4(CONFIG_NET_CONFIG_MY_IPV4_ADDR, port,
+			    server, server_addr);
+
+	rv = bind(*server, (struct sockaddr *)server_addr,
+		  sizeof(*server_addr));
+	zassert_equal(rv, 0, "bind failed");
+}
+
+static void send_small(int sock, struct sockaddr_in *addr)
+{
+	ssize_t sent;
+
+	sent = sendto(sock, BUF_AND_SIZE(TEST_STR_SMALL), 0,
+		      (struct sockaddr *)addr, sizeof(*addr));
+	zassert_equal(sent, STRLEN(TEST_STR_SMALL), "sendto failed");
+}
+
+static void check_recv(int sock, bool received)
+{
+	char buf[16];
+	ssize_t len;
+
+	len = recv(sock, buf, sizeof(buf), MSG_DONTWAIT);
+	if (received) {
+		zassert_equal(len, STRLEN(TEST_STR_SMALL), "recv failed");
+	} else {
+		zassert_equal(len, -1, "datagram not dropped");
+		zassert_equal(errno, EAGAIN, "wrong errno %d", errno);
+	}
+}
+
+void test_so_rcvbuf_drop(void)
+{
+	struct net_stats_pkt_pools before, after;
+	struct sockaddr_in server_addr;
+	int client, server, rv;
+	int optval;
+
+	prepare_rcvbuf_socks(SERVER_PORT + 10, &client, &server,
+			     &server_addr);
+
+	/* One buffer: a queued datagram fills the quota */
+	optval = 1;
+	rv = setsockopt(server, SOL_SOCKET, SO_RCVBUF, &optval,
+			sizeof(optval));
+	zassert_equal(rv, 0, "setsockopt failed (%d)", errno);
+
+	get_pool_stats(&before);
+
+	send_small(client, &server_addr);
+	send_small(client, &server_addr);
+	send_small(client, &server_addr);
+
+	get_pool_stats(&after);
+	zassert_equal(after.rcvbuf_drop, before.rcvbuf_drop + 2,
+		      "drops not counted");
+
+	check_recv(server, true);
+	check_recv(server, false);
+
+	/* Reading the datagram gives its buffers back to the quota */
+	send_small(client, &server_addr);
+	check_recv(server, true);
+
+	rv = close(client);
+	zassert_equal(rv, 0, "close failed");
+	rv = close(server);
+	zassert_equal(rv, 0, "close failed");
+}
+
+void test_rx_reserve_drop(void)
+{
+	static struct net_buf *bufs[CONFIG_NET_BUF_RX_COUNT];
+	struct net_stats_pkt_pools before, after;
+	struct sockaddr_in server_addr;
+	struct net_buf_pool *rx_data;
+	int client, server, rv;
+	int count, i;
+
+	prepare_rcvbuf_socks(SERVER_PORT + 11, &client, &server,
+			     &server_addr);
+
+	/* Leave fewer RX buffers than the reserve */
+	net_pkt_get_info(NULL, NULL, &rx_data, NULL);
+
+	for (count = 0; rx_data->avail_count >= CONFIG_NET_BUF_RX_RESERVE;
+	     count++) {
+		bufs[count] = net_buf_alloc_len(rx_data, 1, K_NO_WAIT);
+		zassert_not_null(bufs[count], "cannot take RX buffer");
+	}
+
+	get_pool_stats(&before);
+
+	send_small(client, &server_addr);
+
+	get_pool_stats(&after);
+	zassert_equal(after.reserve_drop, before.reserve_drop + 1,
+		      "drop not counted");
+	zassert_equal(after.rcvbuf_drop, before.rcvbuf_drop,
+		      "dropped for the quota instead");
+
+	check_recv(server, false);
+
+	for (i = 0; i < count; i++) {
+		net_buf_unref(bufs[i]);
+	}
+
+	send_small(client, &server_addr);
+	check_recv(server, true);
+
+	rv = close(client);
+	zassert_equal(rv, 0, "close failed");
+	rv = close(server);
+	zassert_equal(rv, 0, "close failed");
+}
+#else
+void test_so_rcvbuf_drop(void)
+{
+	ztest_test_skip();
+}
+
+void test_rx_reserve_drop(void)
+{
+	ztest_test_skip();
+}
+#endif /* CONFIG_NET_CONTEXT_RCVBUF && CONFIG_NET_STATISTICS_PKT_POOLS */
+
 static void comm_sendmsg_recvfrom(int client_sock,
 				  struct sockaddr *client_addr,
 				  socklen_t client_addrlen,
@@ -918,6 +1116,9 @@ void test_main(void)
 			 ztest_unit_test(test_v6_bind_sendto),
 			 ztest_unit_test(test_so_priority),
 			 ztest_unit_test(test_so_txtime),
+			 ztest_unit_test(test_so_rcvbuf),
+			 ztest_unit_test(test_so_rcvbuf_drop),
+			 ztest_unit_test(test_rx_reserve_drop),
 			 ztest_unit_test(test_v4_sendmsg_recvfrom),
 			 ztest_unit_test(test_v6_sendmsg_recvfrom),
 			 ztest_unit_test(test_v4_sendmsg_recvfrom_connected),
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_SOCKETS_LOG_LEVEL);
+
+#include <ztest_assert.h>
+
+#include <net/socket.h>
+#include <net/buf.h>
+
+#include "../../socket_helpers.h"
+
+#define BUF_AND_SIZE(buf) buf, sizeof(buf) - 1
+#define STRLEN(buf) (sizeof(buf) - 1)
+
+/* More than 128 bytes, to use >1 net_buf on receive. */
+#define TEST_STR \
+	"The Zephyr Project, a Linux Foundation hosted Collaboration " \
+	"Project, is an open source collaborative effort uniting leaders " \
+	"from across the industry to build a best-in-breed small, scalable, " \
+	"real-time operating system (RTOS) optimized for resource-" \
+	"constrained devices, across multiple architectures."
+
+#define ANY_PORT 0
+#define SERVER_PORT 4242
+
+static const char tx_data[] = TEST_STR;
+static K_SEM_DEFINE(tx_done, 0, 1);
+
+static void sent_cb(const void *buf, size_t len, void *user_data)
+{
+	zassert_equal_ptr(buf, tx_data, "wrong buffer released");
+	zassert_equal(len, STRLEN(TEST_STR), "wrong length released");
+	zassert_equal_ptr(user_data, &tx_done, "wrong user data");
+
+	k_sem_give(&tx_done);
+}
+
+/* Copy the payload out of the lent fragments to check its content */
+static size_t zc_linearize(struct zsock_zc_buf *zc, u8_t *out, size_t len)
+{
+	const struct net_buf *frag = zc->frags;
+	size_t offset = zc->offset;
+	size_t copied = 0;
+
+	while (frag && copied < zc->len && copied < len) {
+		size_t chunk = MIN(frag->len - offset, zc->len - copied);
+
+		chunk = MIN(chunk, len - copied);
+		memcpy(out + copied, frag->data + offset, chunk);
+		copied += chunk;
+		offset = 0;
+		frag = frag->frags;
+	}
+
+	return copied;
+}
+
+static void comm_zc(int client_sock, struct sockaddr *server_addr,
+		    socklen_t server_addrlen, int server_sock)
+{
+	static u8_t rx_buf[400];
+	struct zsock_zc_buf zc;
+	struct sockaddr addr;
+	socklen_t addrlen;
+	ssize_t ret;
+
+	ret = zsock_sendto_zc(client_sock, tx_data, STRLEN(TEST_STR), 0,
+			      server_addr, server_addrlen, sent_cb, &tx_done);
+	zassert_equal(ret, STRLEN(TEST_STR), "sendto_zc failed (%d)", errno);
+
+	/* Peek first, the packet must stay queued */
+	ret = zsock_recv_zc(server_sock, &zc, ZSOCK_MSG_PEEK);
+	zassert_equal(ret, STRLEN(TEST_STR), "recv_zc peek failed");
+	zsock_zc_release(&zc);
+	zassert_is_null(zc.pkt, "descriptor not cleared");
+
+	addrlen = sizeof(addr);
+	ret = zsock_recvfrom_zc(server_sock, &zc, 0, &addr, &addrlen);
+	zassert_equal(ret, STRLEN(TEST_STR), "recvfrom_zc failed");
+	zassert_equal(addrlen, server_addrlen, "unexpected addrlen");
+	zassert_not_null(zc.frags, "no fragments lent");
+
+	clear_buf(rx_buf);
+	zassert_equal(zc_linearize(&zc, rx_buf, sizeof(rx_buf)),
+		      STRLEN(TEST_STR), "short payload");
+	zassert_mem_equal(rx_buf, BUF_AND_SIZE(TEST_STR), "wrong data");
+
+	zsock_zc_release(&zc);
+
+	/* The packet was looped back to us, so the application buffer is
+	 * referenced until the receiver has released it.
+	 */
+	zassert_equal(k_sem_take(&tx_done, K_MSEC(100)), 0,
+		      "buffer not released");
+
+	/* Queue is empty now */
+	ret = zsock_recv_zc(server_sock, &zc, ZSOCK_MSG_DONTWAIT);
+	zassert_equal(ret, -1, "recv_zc should fail");
+	zassert_equal(errno, EAGAIN, "unexpected errno");
+}
+
+void test_v4_zerocopy(void)
+{
+	int client_sock;
+	int server_sock;
+	struct sockaddr_in client_addr;
+	struct sockaddr_in server_addr;
+	int rv;
+
+	prepare_sock_udp_v4(CONFIG_NET_CONFIG_MY_IPV4_ADDR, ANY_PORT,
+			    &client_sock, &client_addr);
+	prepare_sock_udp_v4(CONFIG_NET_CONFIG_MY_IPV4_ADDR, SERVER_PORT,
+			    &server_sock, &server_addr);
+
+	rv = bind(server_sock, (struct sockaddr *)&server_addr,
+		  sizeof(server_addr));
+	zassert_equal(rv, 0, "bind failed");
+
+	comm_zc(client_sock, (struct sockaddr *)&server_addr,
+		sizeof(server_addr), server_sock);
+
+	rv = close(client_sock);
+	zassert_equal(rv, 0, "close failed");
+	rv = close(server_sock);
+	zassert_equal(rv, 0, "close failed");
+}
+
+void test_v6_zerocopy(void)
+{
+	int client_sock;
+	int server_sock;
+	struct sockaddr_in6 client_addr;
+	struct sockaddr_in6 server_addr;
+	int rv;
+
+	prepare_sock_udp_v6(CONFIG_NET_CONFIG_MY_IPV6_ADDR, ANY_PORT,
+			    &client_sock, &client_addr);
+	prepare_sock_udp_v6(CONFIG_NET_CONFIG_MY_IPV6_ADDR, SERVER_PORT,
+			    &server_sock, &server_addr);
+
+	rv = bind(server_sock, (struct sockaddr *)&server_addr,
+		  sizeof(server_addr));
+	zassert_equal(rv, 0, "bind failed");
+
+	comm_zc(client_sock, (struct sockaddr *)&server_addr,
+		sizeof(server_addr), server_sock);
+
+	rv = close(client_sock);
+	zassert_equal(rv, 0, "close failed");
+	rv = close(server_sock);
+	zassert_equal(rv, 0, "close failed");
+}
+
+void test_zerocopy_too_big(void)
+{
+	static u8_t big[2048];
+	struct sockaddr_in6 server_addr;
+	int sock;
+	ssize_t ret;
+
+	prepare_sock_udp_v6(CONFIG_NET_CONFIG_MY_IPV6_ADDR, SERVER_PORT,
+			    &sock, &server_addr);
+
+	ret = zsock_sendto_zc(sock, big, sizeof(big), 0,
+			      (struct sockaddr *)&server_addr,
+			      sizeof(server_addr), NULL, NULL);
+	zassert_equal(ret, -1, "oversized send should fail");
+	zassert_equal(errno, EMSGSIZE, "unexpected errno");
+
+	zassert_equal(close(sock), 0, "close failed");
+}
+
+void test_main(void)
+{
+	ztest_test_suite(socket_zerocopy,
+			 ztest_unit_test(test_v4_zerocopy),
+			 ztest_unit_test(test_v6_zerocopy),
+			 ztest_unit_test(test_zerocopy_too_big));
+
+	ztest_run_test_suite(socket_zerocopy);
+}
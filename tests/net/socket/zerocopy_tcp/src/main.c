@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2020 Intel Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(net_test, CONFIG_NET_SOCKETS_LOG_LEVEL);
+
+#include <ztest_assert.h>
+
+#include <net/socket.h>
+#include <net/buf.h>
+#include <net/dummy.h>
+#include <net/net_pkt.h>
+#include <net/net_if.h>
+
+#include "../../socket_helpers.h"
+
+#define BUF_AND_SIZE(buf) buf, sizeof(buf) - 1
+#define STRLEN(buf) (sizeof(buf) - 1)
+
+#define TEST_STR \
+	"The Zephyr Project, a Linux Foundation hosted Collaboration " \
+	"Project, is an open source collaborative effort uniting leaders " \
+	"from across the industry to build a best-in-breed small, scalable, " \
+	"real-time operating system (RTOS) optimized for resource-" \
+	"constrained devices, across multiple architectures."
+
+#define ANY_PORT 0
+#define SERVER_PORT 4242
+#define TEST_MTU 1280
+
+/* Long enough for a few retransmission timeouts */
+#define RX_TIMEOUT 2000
+#define TCP_TEARDOWN_TIMEOUT K_SECONDS(1)
+
+static const char tx_data[] = TEST_STR;
+static K_SEM_DEFINE(tx_done, 0, 1);
+
+/* Data segments seen by the driver, how many of them still pointed to the
+ * application buffer, and how many are still to be dropped.
+ */
+static int data_tx_count;
+static int data_zc_count;
+static int drop_count;
+
+static u8_t test_mac[] = { 0x02, 0x00, 0x5e, 0x10, 0x00, 0x01 };
+
+static void sent_cb(const void *buf, size_t len, void *user_data)
+{
+	zassert_equal_ptr(buf, tx_data, "wrong buffer released");
+	zassert_equal(len, STRLEN(TEST_STR), "wrong length released");
+	zassert_equal_ptr(user_data, &tx_done, "wrong user data");
+
+	k_sem_give(&tx_done);
+}
+
+static bool pkt_uses_tx_data(struct net_pkt *pkt)
+{
+	struct net_buf *frag;
+
+	for (frag = pkt->buffer; frag; frag = frag->frags) {
+		if (frag->data == (u8_t *)tx_data) {
+			zassert_true(frag->flags & NET_BUF_READ_ONLY,
+				     "application buffer is writable");
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void lossy_iface_init(struct net_if *iface)
+{
+	net_if_set_link_addr(iface, test_mac, sizeof(test_mac),
+			     NET_LINK_DUMMY);
+}
+
+/* Loop the packets back to ourselves, optionally losing data segments.
+ * The packet sent is kept by TCP for retransmission, so the copy given to
+ * the receiving side is a clone.
+ */
+static int lossy_send(struct device *dev, struct net_pkt *pkt)
+{
+	struct net_pkt *cloned;
+
+	ARG_UNUSED(dev);
+
+	if (net_pkt_get_len(pkt) >= NET_IPV4TCPH_LEN + STRLEN(TEST_STR)) {
+		data_tx_count++;
+
+		if (pkt_uses_tx_data(pkt)) {
+			data_zc_count++;
+		}
+
+		if (drop_count > 0) {
+			drop_count--;
+			return 0;
+		}
+	}
+
+	cloned = net_pkt_clone(pkt, K_MSEC(100));
+	if (!cloned) {
+		return -ENOMEM;
+	}
+
+	if (net_recv_data(net_pkt_iface(cloned), cloned) < 0) {
+		net_pkt_unref(cloned);
+		return -EIO;
+	}
+
+	k_yield();
+
+	return 0;
+}
+
+static int lossy_dev_init(struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return 0;
+}
+
+static struct dummy_api lossy_api = {
+	.iface_api.init = lossy_iface_init,
+	.send = lossy_send,
+};
+
+NET_DEVICE_INIT(zc_tcp_test, "zc_tcp_test", lossy_dev_init,
+		device_pm_control_nop, NULL, NULL,
+		CONFIG_KERNEL_INIT_PRIORITY_DEFAULT, &lossy_api, DUMMY_L2,
+		NET_L2_GET_CTX_TYPE(DUMMY_L2), TEST_MTU);
+
+static void connect_pair(int *client_sock, int *server_sock, int *new_sock)
+{
+	struct sockaddr_in client_addr;
+	struct sockaddr_in server_addr;
+	struct sockaddr addr;
+	socklen_t addrlen = sizeof(addr);
+
+	prepare_sock_tcp_v4(CONFIG_NET_CONFIG_MY_IPV4_ADDR, ANY_PORT,
+			    client_sock, &client_addr);
+	prepare_sock_tcp_v4(CONFIG_NET_CONFIG_MY_IPV4_ADDR, SERVER_PORT,
+			    server_sock, &server_addr);
+
+	zassert_equal(bind(*server_sock, (struct sockaddr *)&server_addr,
+			   sizeof(server_addr)), 0, "bind failed");
+	zassert_equal(listen(*server_sock, 1), 0, "listen failed");
+	zassert_equal(connect(*client_sock, (struct sockaddr *)&server_addr,
+			      sizeof(server_addr)), 0, "connect failed");
+
+	*new_sock = accept(*server_sock, &addr, &addrlen);
+	zassert_true(*new_sock >= 0, "accept failed");
+}
+
+static void close_pair(int client_sock, int server_sock, int new_sock)
+{
+	zassert_equal(close(new_sock), 0, "close failed");
+	zassert_equal(close(client_sock), 0, "close failed");
+	zassert_equal(close(server_sock), 0, "close failed");
+
+	k_sleep(TCP_TEARDOWN_TIMEOUT);
+}
+
+static void recv_all(int sock)
+{
+	static u8_t rx_buf[400];
+	struct pollfd pfd = { .fd = sock, .events = POLLIN };
+	size_t received = 0;
+	ssize_t ret;
+
+	clear_buf(rx_buf);
+
+	while (received < STRLEN(TEST_STR)) {
+		zassert_equal(poll(&pfd, 1, RX_TIMEOUT), 1,
+			      "data not received");
+
+		ret = recv(sock, rx_buf + received,
+			   sizeof(rx_buf) - received, 0);
+		zassert_true(ret > 0, "recv failed");
+		received += ret;
+	}
+
+	zassert_equal(received, STRLEN(TEST_STR), "unexpected length");
+	zassert_mem_equal(rx_buf, BUF_AND_SIZE(TEST_STR), "wrong data");
+}
+
+static void send_zc(int sock)
+{
+	ssize_t ret;
+
+	data_tx_count = 0;
+	data_zc_count = 0;
+	k_sem_reset(&tx_done);
+
+	ret = zsock_sendto_zc(sock, tx_data, STRLEN(TEST_STR), 0, NULL, 0,
+			      sent_cb, &tx_done);
+	zassert_equal(ret, STRLEN(TEST_STR), "sendto_zc failed (%d)", errno);
+}
+
+void test_tcp_zerocopy(void)
+{
+	int client_sock, server_sock, new_sock;
+
+	connect_pair(&client_sock, &server_sock, &new_sock);
+
+	send_zc(client_sock);
+	recv_all(new_sock);
+
+	/* The buffer is released once the data is acknowledged */
+	zassert_equal(k_sem_take(&tx_done, K_MSEC(RX_TIMEOUT)), 0,
+		      "buffer not released");
+
+	zassert_equal(data_tx_count, 1, "unexpected number of segments");
+	zassert_equal(data_zc_count, 1, "data was copied");
+
+	close_pair(client_sock, server_sock, new_sock);
+}
+
+void test_tcp_zerocopy_retransmit(void)
+{
+	int client_sock, server_sock, new_sock;
+
+	connect_pair(&client_sock, &server_sock, &new_sock);
+
+	drop_count = 1;
+	send_zc(client_sock);
+
+	/* Nothing was acknowledged, the buffer is kept for the
+	 * retransmission.
+	 */
+	zassert_not_equal(k_sem_take(&tx_done, K_NO_WAIT), 0,
+			  "buffer released before it was acknowledged");
+
+	recv_all(new_sock);
+
+	zassert_equal(k_sem_take(&tx_done, K_MSEC(RX_TIMEOUT)), 0,
+		      "buffer not released");
+
+	zassert_equal(drop_count, 0, "segment not dropped");
+	zassert_equal(data_tx_count, 2, "segment not retransmitted");
+	zassert_equal(data_zc_count, 2, "retransmitted data was copied");
+
+	close_pair(client_sock, server_sock, new_sock);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(socket_zerocopy_tcp,
+			 ztest_unit_test(test_tcp_zerocopy),
+			 ztest_unit_test(test_tcp_zerocopy_retransmit));
+
+	ztest_run_test_suite(socket_zerocopy_tcp);
+}
@@ -832,12 +832,117 @@ void test_addr_parse(void)
 #endif
 }
 
+#define CHKSUM_PAYLOAD_LEN 200
+#define CHKSUM_PKT_LEN (NET_IPV4H_LEN + NET_UDPH_LEN + CHKSUM_PAYLOAD_LEN)
+#define CHKSUM_MAX_FRAGS 5
+
+static u8_t chksum_pkt_data[CHKSUM_PKT_LEN];
+
+/* Fragment lengths, including empty and odd sized fragments */
+static const size_t chksum_layouts[][CHKSUM_MAX_FRAGS] = {
+	{ 114, 114 },
+	{ 29, 1, 3, 100, 95 },
+	{ 28, 0, 101, 99 },
+	{ 31, 97, 100 },
+	{ 47, 125, 1, 55 },
+};
+
+/* Byte by byte reference of the UDP checksum over IPv4 (RFC 1071) */
+static u16_t chksum_ref(const u8_t *data, size_t len)
+{
+	u32_t sum = IPPROTO_UDP + len - NET_IPV4H_LEN;
+	size_t i;
+
+	/* Source and destination addresses of the pseudo header */
+	for (i = 12; i < NET_IPV4H_LEN; i += 2) {
+		sum += (data[i] << 8) | data[i + 1];
+	}
+
+	for (i = NET_IPV4H_LEN; i < len; i++) {
+		sum += ((i - NET_IPV4H_LEN) % 2) ? data[i] : data[i] << 8;
+	}
+
+	while (sum >> 16) {
+		sum = (sum & 0xffff) + (sum >> 16);
+	}
+
+	return htons((u16_t)~sum);
+}
+
+static struct net_pkt *chksum_build_pkt(const size_t *layout, int reserve)
+{
+	struct net_pkt *pkt;
+	size_t offset = 0;
+	int i;
+
+	pkt = net_pkt_rx_alloc(K_NO_WAIT);
+	zassert_not_null(pkt, "cannot allocate pkt");
+
+	net_pkt_set_family(pkt, AF_INET);
+	net_pkt_set_ip_hdr_len(pkt, NET_IPV4H_LEN);
+	net_pkt_set_ipv4_opts_len(pkt, 0);
+
+	for (i = 0; i < CHKSUM_MAX_FRAGS && offset < CHKSUM_PKT_LEN; i++) {
+		struct net_buf *frag;
+
+		frag = net_pkt_get_reserve_rx_data(K_NO_WAIT);
+		zassert_not_null(frag, "cannot allocate fragment");
+
+		/* Misalign the data of every fragment differently */
+		net_buf_reserve(frag, (reserve + i) % 4);
+		net_buf_add_mem(frag, chksum_pkt_data + offset, layout[i]);
+		offset += layout[i];
+
+		net_pkt_frag_add(pkt, frag);
+	}
+
+	zassert_equal(offset, CHKSUM_PKT_LEN, "bad fragment layout");
+
+	return pkt;
+}
+
+void test_chksum(void)
+{
+	u16_t expected;
+	int i, reserve;
+
+	for (i = 0; i < sizeof(chksum_pkt_data); i++) {
+		chksum_pkt_data[i] = (u8_t)(i * 37U + 0xa5);
+	}
+
+	/* Many all-ones words to make the sum carry */
+	(void)memset(chksum_pkt_data + NET_IPV4H_LEN + NET_UDPH_LEN + 16,
+		     0xff, 64);
+
+	/* The checksum field is part of the sum, leave it out */
+	chksum_pkt_data[NET_IPV4H_LEN + 6] = 0U;
+	chksum_pkt_data[NET_IPV4H_LEN + 7] = 0U;
+
+	expected = chksum_ref(chksum_pkt_data, CHKSUM_PKT_LEN);
+
+	for (i = 0; i < ARRAY_SIZE(chksum_layouts); i++) {
+		for (reserve = 0; reserve < 4; reserve++) {
+			struct net_pkt *pkt;
+			u16_t chksum;
+
+			pkt = chksum_build_pkt(chksum_layouts[i], reserve);
+			chksum = net_calc_chksum(pkt, IPPROTO_UDP);
+			net_pkt_unref(pkt);
+
+			zassert_equal(chksum, expected,
+				      "layout %d reserve %d: 0x%04x != 0x%04x",
+				      i, reserve, chksum, expected);
+		}
+	}
+}
+
 void test_main(void)
 {
 	ztest_test_suite(test_utils_fn,
 			 ztest_unit_test(test_net_addr),
 			 ztest_user_unit_test(test_net_addr),
-			 ztest_unit_test(test_addr_parse));
+			 ztest_unit_test(test_addr_parse),
+			 ztest_unit_test(test_chksum));
 
 	ztest_run_test_suite(test_utils_fn);
 }